@@ -42,6 +42,7 @@
 #include "event_groups.h"
 #include "semphr.h"
 #include "task.h"
+#include "fast_mutex.h"
 
 /* FreeRTOS+POSIX data types and internal structs. */
 #include "FreeRTOS_POSIX/sys/types.h"
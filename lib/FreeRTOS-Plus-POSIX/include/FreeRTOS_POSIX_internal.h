@@ -98,6 +98,29 @@
         )
 #endif
 
+#if posixconfigENABLE_PTHREAD_RWLOCK_T == 1
+    /**
+     * @brief Reader-writer lock.
+     */
+    typedef struct pthread_rwlock_internal
+    {
+        BaseType_t xIsInitialized; /**< Set to pdTRUE if this lock is initialized, pdFALSE otherwise. */
+        RWLock_t xLock;            /**< FreeRTOS reader-writer lock. */
+    } pthread_rwlock_internal_t;
+
+    /**
+     * @brief Compile-time initializer of pthread_rwlock_internal_t.
+     */
+    #define FREERTOS_POSIX_RWLOCK_INITIALIZER \
+        ( ( ( pthread_rwlock_internal_t )     \
+        {                                     \
+            .xIsInitialized = pdFALSE,        \
+            .xLock = { 0 }                    \
+        }                                     \
+          )                                   \
+        )
+#endif
+
 #if posixconfigENABLE_SEM_T == 1
     /**
      * @brief Semaphore type.
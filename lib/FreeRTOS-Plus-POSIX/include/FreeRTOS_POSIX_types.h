@@ -48,6 +48,12 @@
     typedef void    * PthreadCondType_t;
 #endif
 
+#if posixconfigENABLE_PTHREAD_RWLOCK_T == 1
+    typedef pthread_rwlock_internal_t PthreadRWLockType_t;
+#else
+    typedef void    * PthreadRWLockType_t;
+#endif
+
 #if posixconfigENABLE_SEM_T == 1
     typedef sem_internal_t PosixSemType_t;
 #else
@@ -56,6 +56,14 @@
 #ifndef posixconfigMQ_MAX_SIZE
     #define posixconfigMQ_MAX_SIZE    128 /**< Maximum size (in bytes) of each message. */
 #endif
+
+#ifndef posixconfigMQ_MAX_QUEUES
+    #define posixconfigMQ_MAX_QUEUES    32 /**< Maximum number of mqs that exist at one time. */
+#endif
+
+#ifndef posixconfigMQ_HASH_BUCKETS
+    #define posixconfigMQ_HASH_BUCKETS    16 /**< Number of buckets of the table of mq names. Must be a power of 2. */
+#endif
 /**@} */
 
 /**
@@ -109,6 +117,12 @@
 #ifndef posixconfigENABLE_PTHREAD_MUTEXATTR_T
     #define posixconfigENABLE_PTHREAD_MUTEXATTR_T    1 /**< pthread_mutexattr_t in sys/types.h */
 #endif
+#ifndef posixconfigENABLE_PTHREAD_RWLOCK_T
+    #define posixconfigENABLE_PTHREAD_RWLOCK_T       1 /**< pthread_rwlock_t in sys/types.h */
+#endif
+#ifndef posixconfigENABLE_PTHREAD_RWLOCKATTR_T
+    #define posixconfigENABLE_PTHREAD_RWLOCKATTR_T   1 /**< pthread_rwlockattr_t in sys/types.h */
+#endif
 #ifndef posixconfigENABLE_PTHREAD_T
     #define posixconfigENABLE_PTHREAD_T              1 /**< pthread_t in sys/types.h */
 #endif
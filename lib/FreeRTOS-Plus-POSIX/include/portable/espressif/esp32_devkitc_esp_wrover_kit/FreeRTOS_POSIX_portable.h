@@ -40,6 +40,8 @@
 #define posixconfigENABLE_PTHREAD_CONDATTR_T     0
 #define posixconfigENABLE_PTHREAD_MUTEX_T        0
 #define posixconfigENABLE_PTHREAD_MUTEXATTR_T    0
+#define posixconfigENABLE_PTHREAD_RWLOCK_T       0
+#define posixconfigENABLE_PTHREAD_RWLOCKATTR_T   0
 #define posixconfigENABLE_PTHREAD_T              0
 #define posixconfigENABLE_TIME_T                 0
 #define posixconfigENABLE_TIMESPEC               0
@@ -38,29 +38,59 @@
 #include "FreeRTOS_POSIX/mqueue.h"
 #include "FreeRTOS_POSIX/utils.h"
 
+/* FreeRTOS includes. */
+#include "message_buffer.h"
+
+#if ( ( posixconfigMQ_HASH_BUCKETS & ( posixconfigMQ_HASH_BUCKETS - 1 ) ) != 0 )
+    #error posixconfigMQ_HASH_BUCKETS must be a power of 2.
+#endif
+
 /**
- * @brief Element of the FreeRTOS queues that store mq data.
+ * @brief Bytes stored in front of each message in its message buffer record.
+ *
+ * A message buffer returns 0 both for an empty message and when nothing was
+ * received in time, so every record is at least this long, and an empty
+ * message can be told apart from a timeout.
  */
-typedef struct QueueElement
-{
-    char * pcData;    /**< Data in queue. Type char* to match msg_ptr. */
-    size_t xDataSize; /**< Size of data pointed by pcData. */
-} QueueElement_t;
+#define mqueueRECORD_HEADER_BYTES         ( ( size_t ) 1 )
+
+/**
+ * @brief Bytes taken in a message buffer by each message, in addition to the
+ * message itself.
+ */
+#define mqueueMESSAGE_OVERHEAD            ( sizeof( configMESSAGE_BUFFER_LENGTH_TYPE ) + mqueueRECORD_HEADER_BYTES )
+
+/**
+ * @brief Number of times the descriptors of a slot in the descriptor table
+ * can be reused before they wrap.
+ *
+ * Descriptors are never 0 or ( mqd_t ) -1.
+ */
+#define mqueueDESCRIPTOR_SEQUENCE_LIMIT    ( ( ( ( size_t ) -1 ) / posixconfigMQ_MAX_QUEUES ) - 1 )
 
 /**
  * @brief Data structure of an mq.
  *
  * FreeRTOS isn't guaranteed to have a file-like abstraction, so message
- * queues in this implementation are stored as a linked list (in RAM).
+ * queues in this implementation are stored in RAM, in a table hashed by name.
+ * Each one is a single allocation holding this structure, the storage of its
+ * message buffer and its name.
  */
 typedef struct QueueListElement
 {
-    Link_t xLink;              /**< Pointer to the next element in the list. */
-    QueueHandle_t xQueue;      /**< FreeRTOS queue handle. */
-    size_t xOpenDescriptors;   /**< Number of threads that have opened this queue. */
-    char * pcName;             /**< Null-terminated queue name. */
-    struct mq_attr xAttr;      /**< Queue attibutes. */
-    BaseType_t xPendingUnlink; /**< If pdTRUE, this queue will be unlinked once all descriptors close. */
+    Link_t xLink;                                 /**< Link in the hash bucket of the queue name. */
+    MessageBufferHandle_t xMessageBuffer;         /**< FreeRTOS message buffer holding the messages. */
+    StaticMessageBuffer_t xMessageBufferStruct;   /**< Storage of the message buffer structure. */
+    StaticSemaphore_t xSendMutex;                 /**< Serializes senders, as a message buffer takes one writer at a time. */
+    StaticSemaphore_t xReceiveMutex;              /**< Serializes receivers, as a message buffer takes one reader at a time. */
+    volatile size_t xMessagesSent;                /**< Number of messages sent, written with xSendMutex held. */
+    volatile size_t xMessagesReceived;            /**< Number of messages received, written with xReceiveMutex held. */
+    size_t xDescriptor;                           /**< Descriptor of this queue, returned by mq_open. */
+    uint32_t ulNameHash;                          /**< Hash of pcName. */
+    size_t xOpenDescriptors;                      /**< Number of threads that have opened this queue. */
+    char * pcName;                                /**< Null-terminated queue name. */
+    struct mq_attr xAttr;                         /**< Queue attibutes. */
+    BaseType_t xPendingUnlink;                    /**< If pdTRUE, this queue will be unlinked once all descriptors close. */
 } QueueListElement_t;
 
 /*-----------------------------------------------------------*/
@@ -81,19 +111,51 @@ static int prvCalculateTickTimeout( long lMessageQueueFlags,
                                     TickType_t * pxTimeoutTicks );
 
 /**
- * @brief Add a new queue to the queue list.
+ * @brief Copy bytes out of the regions of a message buffer record.
+ *
+ * @param[in] pxRegions The regions of the record, as set by xMessageBufferPeek.
+ * @param[in] xOffset Offset in the record of the first byte to copy.
+ * @param[out] pucData Where to copy the bytes.
+ * @param[in] xLength Number of bytes to copy.
+ *
+ * @return nothing
+ */
+static void prvCopyFromRecord( const StreamBufferRegions_t * const pxRegions,
+                               size_t xOffset,
+                               uint8_t * pucData,
+                               size_t xLength );
+
+/**
+ * @brief Copy bytes into the regions of a message buffer record.
+ *
+ * @param[in] pxRegions The regions of the record, as set by xMessageBufferReserve.
+ * @param[in] xOffset Offset in the record of the first byte to copy to.
+ * @param[in] pucData The bytes to copy.
+ * @param[in] xLength Number of bytes to copy.
+ *
+ * @return nothing
+ */
+static void prvCopyToRecord( const StreamBufferRegions_t * const pxRegions,
+                             size_t xOffset,
+                             const uint8_t * pucData,
+                             size_t xLength );
+
+/**
+ * @brief Add a new queue to the queue table.
  *
  * @param[out] ppxMessageQueue Pointer to new queue.
  * @param[in] pxAttr mq_attr of the new queue.
  * @param[in] pcName Name of new queue.
  * @param[in] xNameLength Length of pcName.
+ * @param[in] ulNameHash Hash of pcName.
  *
- * @return pdTRUE if the queue is found; pdFALSE otherwise.
+ * @return pdTRUE if the queue is created; pdFALSE otherwise.
  */
 static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueue,
                                             const struct mq_attr * const pxAttr,
                                             const char * const pcName,
-                                            size_t xNameLength );
+                                            size_t xNameLength,
+                                            uint32_t ulNameHash );
 
 /**
  * @brief Free all the resources used by a message queue.
@@ -102,31 +164,67 @@ static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueu
  *
  * @return nothing
  */
-static void prvDeleteMessageQueue( const QueueListElement_t * const pxMessageQueue );
+static void prvDeleteMessageQueue( QueueListElement_t * const pxMessageQueue );
 
 /**
- * @brief Attempt to find the queue identified by pcName or xMqId in the queue list.
+ * @brief Attempt to find the queue named pcName in the queue table.
  *
- * Matches queues by pcName first; if pcName is NULL, matches by xMqId.
  * @param[out] ppxQueueListElement Output parameter set when queue is found.
  * @param[in] pcName A queue name to match.
- * @param[in] xMessageQueueDescriptor A queue descriptor to match.
+ * @param[in] ulNameHash Hash of pcName.
  *
  * @return pdTRUE if the queue is found; pdFALSE otherwise.
  */
 static BaseType_t prvFindQueueInList( QueueListElement_t ** const ppxQueueListElement,
                                       const char * const pcName,
-                                      mqd_t xMessageQueueDescriptor );
+                                      uint32_t ulNameHash );
 
 /**
- * @brief Initialize the queue list.
+ * @brief Look up the queue of a descriptor in the descriptor table.
  *
- * Performs initialization of the queue list mutex and queue list head.
+ * This takes no lock, so it may be called without xQueueListMutex. As with
+ * any other use of a descriptor, the queue must not be closed and unlinked by
+ * another thread while it is used.
+ *
+ * @param[in] xMessageQueueDescriptor A queue descriptor.
+ *
+ * @return The queue, or NULL if xMessageQueueDescriptor is not valid.
+ */
+static QueueListElement_t * prvGetMessageQueue( mqd_t xMessageQueueDescriptor );
+
+/**
+ * @brief Compute the hash of a queue name.
+ *
+ * @param[in] pcName The name to hash.
+ *
+ * @return The 32-bit FNV-1a hash of pcName.
+ */
+static uint32_t prvHashQueueName( const char * pcName );
+
+/**
+ * @brief Initialize the queue table.
+ *
+ * Performs initialization of the queue table mutex and hash buckets.
  *
  * @return nothing
  */
 static void prvInitializeQueueList( void );
 
+/**
+ * @brief Take the sender or receiver mutex of a queue.
+ *
+ * Takes the mutex without blocking first, so an uncontended queue costs no
+ * more than that. Otherwise blocks for up to *pxTicksToWait, and leaves in it
+ * the ticks that remain to block on the message buffer.
+ *
+ * @param[in] xMutex The mutex to take.
+ * @param[in,out] pxTicksToWait Ticks to block for.
+ *
+ * @return pdTRUE if the mutex was taken; pdFALSE otherwise.
+ */
+static BaseType_t prvLockMessageQueue( SemaphoreHandle_t xMutex,
+                                       TickType_t * pxTicksToWait );
+
 /**
  * @brief Checks that pcName is a valid name for a message queue.
  *
@@ -140,14 +238,28 @@ static BaseType_t prvValidateQueueName( const char * const pcName,
                                         size_t * pxNameLength );
 
 /**
- * @brief Guards access to the list of message queues.
+ * @brief Guards access to the queue table.
  */
 static StaticSemaphore_t xQueueListMutex = { { 0 }, .u = { 0 } };
 
 /**
- * @brief Head of the linked list of queues.
+ * @brief Heads of the lists of queues in each hash bucket.
  */
-static Link_t xQueueListHead = { 0 };
+static Link_t xQueueHashBuckets[ posixconfigMQ_HASH_BUCKETS ] = { { 0 } };
+
+/**
+ * @brief Queues by descriptor.
+ *
+ * A descriptor minus 1 modulo posixconfigMQ_MAX_QUEUES is its slot in this
+ * table. Slots are only written with xQueueListMutex held.
+ */
+static QueueListElement_t * volatile pxQueueDescriptorTable[ posixconfigMQ_MAX_QUEUES ] = { 0 };
+
+/**
+ * @brief Incremented each time a slot of the descriptor table is used, so a
+ * descriptor isn't reused soon after its queue is deleted.
+ */
+static size_t xDescriptorSequence = 0;
 
 /*-----------------------------------------------------------*/
 
@@ -200,69 +312,171 @@ static int prvCalculateTickTimeout( long lMessageQueueFlags,
 
 /*-----------------------------------------------------------*/
 
+static void prvCopyFromRecord( const StreamBufferRegions_t * const pxRegions,
+                               size_t xOffset,
+                               uint8_t * pucData,
+                               size_t xLength )
+{
+    size_t xRegion = 0, xBytes = 0;
+
+    /* The record may wrap from the end of the storage area to its start. */
+    for( xRegion = 0; ( xRegion < 2 ) && ( xLength > 0 ); xRegion++ )
+    {
+        if( xOffset >= pxRegions->xLength[ xRegion ] )
+        {
+            xOffset -= pxRegions->xLength[ xRegion ];
+        }
+        else
+        {
+            xBytes = pxRegions->xLength[ xRegion ] - xOffset;
+
+            if( xBytes > xLength )
+            {
+                xBytes = xLength;
+            }
+
+            ( void ) memcpy( pucData, pxRegions->pucData[ xRegion ] + xOffset, xBytes );
+            pucData += xBytes;
+            xLength -= xBytes;
+            xOffset = 0;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCopyToRecord( const StreamBufferRegions_t * const pxRegions,
+                             size_t xOffset,
+                             const uint8_t * pucData,
+                             size_t xLength )
+{
+    size_t xRegion = 0, xBytes = 0;
+
+    /* The record may wrap from the end of the storage area to its start. */
+    for( xRegion = 0; ( xRegion < 2 ) && ( xLength > 0 ); xRegion++ )
+    {
+        if( xOffset >= pxRegions->xLength[ xRegion ] )
+        {
+            xOffset -= pxRegions->xLength[ xRegion ];
+        }
+        else
+        {
+            xBytes = pxRegions->xLength[ xRegion ] - xOffset;
+
+            if( xBytes > xLength )
+            {
+                xBytes = xLength;
+            }
+
+            ( void ) memcpy( pxRegions->pucData[ xRegion ] + xOffset, pucData, xBytes );
+            pucData += xBytes;
+            xLength -= xBytes;
+            xOffset = 0;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueue,
                                             const struct mq_attr * const pxAttr,
                                             const char * const pcName,
-                                            size_t xNameLength )
+                                            size_t xNameLength,
+                                            uint32_t ulNameHash )
 {
     BaseType_t xStatus = pdTRUE;
+    size_t xSlot = 0;
+    size_t xMessageBytes = ( size_t ) pxAttr->mq_msgsize + mqueueMESSAGE_OVERHEAD;
+    size_t xStorageBytes = 0;
+    uint8_t * pucStorage = NULL;
 
-    /* Allocate space for a new queue element. */
-    *ppxMessageQueue = pvPortMalloc( sizeof( QueueListElement_t ) );
+    /* Find a free slot in the descriptor table. */
+    for( xSlot = 0; xSlot < posixconfigMQ_MAX_QUEUES; xSlot++ )
+    {
+        if( pxQueueDescriptorTable[ xSlot ] == NULL )
+        {
+            break;
+        }
+    }
 
-    /* Check that memory allocation succeeded. */
-    if( *ppxMessageQueue == NULL )
+    if( xSlot == posixconfigMQ_MAX_QUEUES )
     {
+        /* Too many queues. */
         xStatus = pdFALSE;
     }
 
-    /* Create the FreeRTOS queue. */
+    /* The message buffer holds mq_maxmsg messages of mq_msgsize, each
+     * preceded by its length and the record header. Messages take only the
+     * space they need, so more of them fit if they are shorter. One more byte
+     * is needed because a message buffer is full with one byte free. Check
+     * the size doesn't overflow. */
     if( xStatus == pdTRUE )
     {
-        ( *ppxMessageQueue )->xQueue =
-            xQueueCreate( pxAttr->mq_maxmsg, sizeof( QueueElement_t ) );
-
-        /* Check that queue creation succeeded. */
-        if( ( *ppxMessageQueue )->xQueue == NULL )
+        if( ( xMessageBytes < mqueueMESSAGE_OVERHEAD ) ||
+            ( ( size_t ) pxAttr->mq_maxmsg > ( ( ( size_t ) -1 ) - sizeof( QueueListElement_t ) - xNameLength - 2 ) / xMessageBytes ) )
         {
-            vPortFree( *ppxMessageQueue );
             xStatus = pdFALSE;
         }
+        else
+        {
+            xStorageBytes = ( ( size_t ) pxAttr->mq_maxmsg * xMessageBytes ) + 1;
+        }
     }
 
+    /* Allocate the queue, the storage of its message buffer and its name, plus
+     * null-terminator, in a single block. */
     if( xStatus == pdTRUE )
     {
-        /* Allocate space for the queue name plus null-terminator. */
-        ( *ppxMessageQueue )->pcName = pvPortMalloc( xNameLength + 1 );
+        *ppxMessageQueue = pvPortMalloc( sizeof( QueueListElement_t ) + xStorageBytes + xNameLength + 1 );
 
-        /* Check that memory was successfully allocated for queue name. */
-        if( ( *ppxMessageQueue )->pcName == NULL )
+        /* Check that memory allocation succeeded. */
+        if( *ppxMessageQueue == NULL )
         {
-            vQueueDelete( ( *ppxMessageQueue )->xQueue );
-            vPortFree( *ppxMessageQueue );
             xStatus = pdFALSE;
         }
-        else
-        {
-            /* Copy queue name. Copying xNameLength+1 will cause strncpy to add
-             * the null-terminator. */
-            ( void ) strncpy( ( *ppxMessageQueue )->pcName, pcName, xNameLength + 1 );
-        }
     }
 
     if( xStatus == pdTRUE )
     {
+        pucStorage = ( uint8_t * ) ( *ppxMessageQueue + 1 );
+
+        /* Create the FreeRTOS message buffer and the mutexes of the senders
+         * and receivers. None of these fail, as their memory is given. */
+        ( *ppxMessageQueue )->xMessageBuffer = xMessageBufferCreateStatic( xStorageBytes,
+                                                                           pucStorage,
+                                                                           &( *ppxMessageQueue )->xMessageBufferStruct );
+        ( void ) xSemaphoreCreateMutexStatic( &( *ppxMessageQueue )->xSendMutex );
+        ( void ) xSemaphoreCreateMutexStatic( &( *ppxMessageQueue )->xReceiveMutex );
+
+        /* Copy queue name. Copying xNameLength+1 will cause strncpy to add
+         * the null-terminator. */
+        ( *ppxMessageQueue )->pcName = ( char * ) ( pucStorage + xStorageBytes );
+        ( void ) strncpy( ( *ppxMessageQueue )->pcName, pcName, xNameLength + 1 );
+        ( *ppxMessageQueue )->ulNameHash = ulNameHash;
+
         /* Copy attributes. */
         ( *ppxMessageQueue )->xAttr = *pxAttr;
 
+        /* A newly-created queue has no messages. */
+        ( *ppxMessageQueue )->xMessagesSent = 0;
+        ( *ppxMessageQueue )->xMessagesReceived = 0;
+
         /* A newly-created queue will have 1 open descriptor for it. */
         ( *ppxMessageQueue )->xOpenDescriptors = 1;
 
         /* A newly-created queue will not be pending unlink. */
         ( *ppxMessageQueue )->xPendingUnlink = pdFALSE;
 
-        /* Add the new queue to the list. */
-        listADD( &xQueueListHead, &( *ppxMessageQueue )->xLink );
+        /* Give the queue a descriptor in its slot that differs from the ones
+         * the slot had before. */
+        xDescriptorSequence = ( xDescriptorSequence + 1 ) % mqueueDESCRIPTOR_SEQUENCE_LIMIT;
+        ( *ppxMessageQueue )->xDescriptor = ( xDescriptorSequence * posixconfigMQ_MAX_QUEUES ) + xSlot + 1;
+
+        /* Add the new queue to its hash bucket and to the descriptor table.
+         * The table is written last, once the queue can be used. */
+        listADD( &xQueueHashBuckets[ ulNameHash & ( posixconfigMQ_HASH_BUCKETS - 1 ) ],
+                 &( *ppxMessageQueue )->xLink );
+        pxQueueDescriptorTable[ xSlot ] = *ppxMessageQueue;
     }
 
     return xStatus;
@@ -270,22 +484,16 @@ static BaseType_t prvCreateNewMessageQueue( QueueListElement_t ** ppxMessageQueu
 
 /*-----------------------------------------------------------*/
 
-static void prvDeleteMessageQueue( const QueueListElement_t * const pxMessageQueue )
+static void prvDeleteMessageQueue( QueueListElement_t * const pxMessageQueue )
 {
-    QueueElement_t xQueueElement = { 0 };
-
-    /* Free all data in the queue. It's assumed that no more data will be added
-     * to the queue, so xQueueReceive does not block. */
-    while( xQueueReceive( pxMessageQueue->xQueue,
-                          ( void * ) &xQueueElement,
-                          0 ) == pdTRUE )
-    {
-        vPortFree( xQueueElement.pcData );
-    }
+    /* The messages are held in the queue's own memory, so nothing else needs
+     * to be freed. It's assumed that no more data will be added to the
+     * queue. */
+    vMessageBufferDelete( pxMessageQueue->xMessageBuffer );
+    vSemaphoreDelete( ( SemaphoreHandle_t ) &pxMessageQueue->xSendMutex );
+    vSemaphoreDelete( ( SemaphoreHandle_t ) &pxMessageQueue->xReceiveMutex );
 
     /* Free memory used by this message queue. */
-    vQueueDelete( pxMessageQueue->xQueue );
-    vPortFree( ( void * ) pxMessageQueue->pcName );
     vPortFree( ( void * ) pxMessageQueue );
 }
 
@@ -293,32 +501,24 @@ static void prvDeleteMessageQueue( const QueueListElement_t * const pxMessageQue
 
 static BaseType_t prvFindQueueInList( QueueListElement_t ** const ppxQueueListElement,
                                       const char * const pcName,
-                                      mqd_t xMessageQueueDescriptor )
+                                      uint32_t ulNameHash )
 {
     Link_t * pxQueueListLink = NULL;
     QueueListElement_t * pxMessageQueue = NULL;
     BaseType_t xQueueFound = pdFALSE;
 
-    /* Iterate through the list of queues. */
-    listFOR_EACH( pxQueueListLink, &xQueueListHead )
+    /* Iterate through the queues in the hash bucket of the name. Only names
+     * of the same hash are compared. */
+    listFOR_EACH( pxQueueListLink, &xQueueHashBuckets[ ulNameHash & ( posixconfigMQ_HASH_BUCKETS - 1 ) ] )
     {
         pxMessageQueue = listCONTAINER( pxQueueListLink, QueueListElement_t, xLink );
 
-        /* Match by name first if provided. */
-        if( ( pcName != NULL ) && ( strcmp( pxMessageQueue->pcName, pcName ) == 0 ) )
+        if( ( pxMessageQueue->ulNameHash == ulNameHash ) &&
+            ( strcmp( pxMessageQueue->pcName, pcName ) == 0 ) )
         {
             xQueueFound = pdTRUE;
             break;
         }
-        /* If name doesn't match, match by descriptor. */
-        else
-        {
-            if( ( mqd_t ) pxMessageQueue == xMessageQueueDescriptor )
-            {
-                xQueueFound = pdTRUE;
-                break;
-            }
-        }
     }
 
     /* If the queue was found, set the output parameter. */
@@ -332,10 +532,45 @@ static BaseType_t prvFindQueueInList( QueueListElement_t ** const ppxQueueListEl
 
 /*-----------------------------------------------------------*/
 
+static QueueListElement_t * prvGetMessageQueue( mqd_t xMessageQueueDescriptor )
+{
+    size_t xDescriptor = ( size_t ) xMessageQueueDescriptor;
+    QueueListElement_t * pxMessageQueue = NULL;
+
+    /* The descriptor selects a slot of the table, and is only valid if the
+     * queue in that slot has the same descriptor. */
+    pxMessageQueue = pxQueueDescriptorTable[ ( xDescriptor - 1 ) % posixconfigMQ_MAX_QUEUES ];
+
+    if( ( pxMessageQueue != NULL ) && ( pxMessageQueue->xDescriptor != xDescriptor ) )
+    {
+        pxMessageQueue = NULL;
+    }
+
+    return pxMessageQueue;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHashQueueName( const char * pcName )
+{
+    uint32_t ulHash = 2166136261UL;
+
+    while( *pcName != '\0' )
+    {
+        ulHash = ( ulHash ^ ( uint8_t ) *pcName ) * 16777619UL;
+        pcName++;
+    }
+
+    return ulHash;
+}
+
+/*-----------------------------------------------------------*/
+
 static void prvInitializeQueueList( void )
 {
     /* Keep track of whether the queue list has been initialized. */
     static BaseType_t xQueueListInitialized = pdFALSE;
+    size_t xBucket = 0;
 
     /* Check if queue list needs to be initialized. */
     if( xQueueListInitialized == pdFALSE )
@@ -349,9 +584,14 @@ static void prvInitializeQueueList( void )
          * section. */
         if( xQueueListInitialized == pdFALSE )
         {
-            /* Initialize the queue list mutex and list head. */
+            /* Initialize the queue list mutex and hash buckets. */
             ( void ) xSemaphoreCreateMutexStatic( &xQueueListMutex );
-            listINIT_HEAD( &xQueueListHead );
+
+            for( xBucket = 0; xBucket < posixconfigMQ_HASH_BUCKETS; xBucket++ )
+            {
+                listINIT_HEAD( &xQueueHashBuckets[ xBucket ] );
+            }
+
             xQueueListInitialized = pdTRUE;
         }
 
@@ -362,6 +602,36 @@ static void prvInitializeQueueList( void )
 
 /*-----------------------------------------------------------*/
 
+static BaseType_t prvLockMessageQueue( SemaphoreHandle_t xMutex,
+                                       TickType_t * pxTicksToWait )
+{
+    BaseType_t xStatus = pdTRUE;
+    TimeOut_t xTimeOut;
+
+    /* Try to take the mutex without blocking. No time passes if it succeeds,
+     * so the whole timeout remains. */
+    if( xSemaphoreTake( xMutex, 0 ) == pdFALSE )
+    {
+        xStatus = pdFALSE;
+
+        if( *pxTicksToWait != 0 )
+        {
+            vTaskSetTimeOutState( &xTimeOut );
+
+            if( xSemaphoreTake( xMutex, *pxTicksToWait ) == pdTRUE )
+            {
+                /* Set *pxTicksToWait to the ticks left, or 0 if none. */
+                ( void ) xTaskCheckForTimeOut( &xTimeOut, pxTicksToWait );
+                xStatus = pdTRUE;
+            }
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 static BaseType_t prvValidateQueueName( const char * const pcName,
                                         size_t * pxNameLength )
 {
@@ -398,7 +668,7 @@ static BaseType_t prvValidateQueueName( const char * const pcName,
 int mq_close( mqd_t mqdes )
 {
     int iStatus = 0;
-    QueueListElement_t * pxMessageQueue = ( QueueListElement_t * ) mqdes;
+    QueueListElement_t * pxMessageQueue = NULL;
     BaseType_t xQueueRemoved = pdFALSE;
 
     /* Initialize the queue list, if needed. */
@@ -409,7 +679,9 @@ int mq_close( mqd_t mqdes )
     ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
 
     /* Attempt to find the message queue based on the given descriptor. */
-    if( prvFindQueueInList( NULL, NULL, mqdes ) == pdTRUE )
+    pxMessageQueue = prvGetMessageQueue( mqdes );
+
+    if( pxMessageQueue != NULL )
     {
         /* Decrement the number of open descriptors. */
         if(pxMessageQueue->xOpenDescriptors > 0)
@@ -425,6 +697,7 @@ int mq_close( mqd_t mqdes )
             if( pxMessageQueue->xPendingUnlink == pdTRUE )
             {
                 listREMOVE( &pxMessageQueue->xLink );
+                pxQueueDescriptorTable[ ( pxMessageQueue->xDescriptor - 1 ) % posixconfigMQ_MAX_QUEUES ] = NULL;
 
                 /* Set the flag to delete the queue. Deleting the queue is deferred
                  * until xQueueListMutex is released. */
@@ -462,19 +735,23 @@ int mq_getattr( mqd_t mqdes,
                 struct mq_attr * mqstat )
 {
     int iStatus = 0;
-    QueueListElement_t * pxMessageQueue = ( QueueListElement_t * ) mqdes;
-
-    /* Lock the mutex that guards access to the queue list. This call will
-     * never fail because it blocks forever. */
-    ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
+    QueueListElement_t * pxMessageQueue = prvGetMessageQueue( mqdes );
+    size_t xMessagesReceived = 0;
 
     /* Find the mq referenced by mqdes. */
-    if( prvFindQueueInList( NULL, NULL, mqdes ) == pdTRUE )
+    if( pxMessageQueue != NULL )
     {
-        /* Update the number of messages in the queue and copy the attributes
-         * into mqstat. */
-        pxMessageQueue->xAttr.mq_curmsgs = ( long ) uxQueueMessagesWaiting( pxMessageQueue->xQueue );
+        /* Copy the attributes into mqstat, with the number of messages in the
+         * queue. A receiver may count a message before its sender does, so
+         * the count read is never allowed to go below 0. */
         *mqstat = pxMessageQueue->xAttr;
+        xMessagesReceived = pxMessageQueue->xMessagesReceived;
+        mqstat->mq_curmsgs = ( long ) ( pxMessageQueue->xMessagesSent - xMessagesReceived );
+
+        if( mqstat->mq_curmsgs < 0 )
+        {
+            mqstat->mq_curmsgs = 0;
+        }
     }
     else
     {
@@ -483,9 +760,6 @@ int mq_getattr( mqd_t mqdes,
         iStatus = -1;
     }
 
-    /* Release the mutex protecting the queue list. */
-    ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &xQueueListMutex );
-
     return iStatus;
 }
 
@@ -497,7 +771,9 @@ mqd_t mq_open( const char * name,
                struct mq_attr * attr )
 {
     mqd_t xMessageQueue = NULL;
+    QueueListElement_t * pxMessageQueue = NULL;
     size_t xNameLength = 0;
+    uint32_t ulNameHash = 0;
 
     /* Default mq_attr. */
     struct mq_attr xQueueCreationAttr =
@@ -525,7 +801,7 @@ mqd_t mq_open( const char * name,
     /* Check attributes, if given. */
     if( xMessageQueue == NULL )
     {
-        if( ( attr != NULL ) && ( ( attr->mq_maxmsg < 0 ) || ( attr->mq_msgsize < 0 ) ) )
+        if( ( attr != NULL ) && ( ( attr->mq_maxmsg <= 0 ) || ( attr->mq_msgsize <= 0 ) ) )
         {
             /* Invalid mq_attr.mq_maxmsg or mq_attr.mq_msgsize. */
             errno = EINVAL;
@@ -535,14 +811,15 @@ mqd_t mq_open( const char * name,
 
     if( xMessageQueue == NULL )
     {
+        /* Hash the name before taking the mutex. */
+        ulNameHash = prvHashQueueName( name );
+
         /* Lock the mutex that guards access to the queue list. This call will
          * never fail because it blocks forever. */
         ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
 
-        /* Search the queue list to check if the queue exists. */
-        if( prvFindQueueInList( ( QueueListElement_t ** ) &xMessageQueue,
-                                name,
-                                ( mqd_t ) NULL ) == pdTRUE )
+        /* Search the queue table to check if the queue exists. */
+        if( prvFindQueueInList( &pxMessageQueue, name, ulNameHash ) == pdTRUE )
         {
             /* If the mq exists, check that this function wasn't called with
              * O_CREAT and O_EXCL. */
@@ -554,7 +831,7 @@ mqd_t mq_open( const char * name,
             else
             {
                 /* Check if the mq has been unlinked and is pending removal. */
-                if( ( ( QueueListElement_t * ) xMessageQueue )->xPendingUnlink == pdTRUE )
+                if( pxMessageQueue->xPendingUnlink == pdTRUE )
                 {
                     /* Queue pending deletion. Don't allow it to be re-opened. */
                     errno = EINVAL;
@@ -563,7 +840,8 @@ mqd_t mq_open( const char * name,
                 else
                 {
                     /* Increase count of open file descriptors for queue. */
-                    ( ( QueueListElement_t * ) xMessageQueue )->xOpenDescriptors++;
+                    pxMessageQueue->xOpenDescriptors++;
+                    xMessageQueue = ( mqd_t ) pxMessageQueue->xDescriptor;
                 }
             }
         }
@@ -583,14 +861,19 @@ mqd_t mq_open( const char * name,
                 xQueueCreationAttr.mq_flags = ( long ) oflag;
 
                 /* Create the new message queue. */
-                if( prvCreateNewMessageQueue( ( QueueListElement_t ** ) &xMessageQueue,
+                if( prvCreateNewMessageQueue( &pxMessageQueue,
                                               &xQueueCreationAttr,
                                               name,
-                                              xNameLength ) == pdFALSE )
+                                              xNameLength,
+                                              ulNameHash ) == pdFALSE )
                 {
                     errno = ENOSPC;
                     xMessageQueue = ( mqd_t ) -1;
                 }
+                else
+                {
+                    xMessageQueue = ( mqd_t ) pxMessageQueue->xDescriptor;
+                }
             }
             else
             {
@@ -637,18 +920,15 @@ ssize_t mq_timedreceive( mqd_t mqdes,
     ssize_t xStatus = 0;
     int iCalculateTimeoutReturn = 0;
     TickType_t xTimeoutTicks = 0;
-    QueueListElement_t * pxMessageQueue = ( QueueListElement_t * ) mqdes;
-    QueueElement_t xReceiveData = { 0 };
+    QueueListElement_t * pxMessageQueue = prvGetMessageQueue( mqdes );
+    StreamBufferRegions_t xRegions = { { NULL }, { 0 } };
+    size_t xRecordBytes = 0;
 
     /* Silence warnings about unused parameters. */
     ( void ) msg_prio;
 
-    /* Lock the mutex that guards access to the queue list. This call will
-     * never fail because it blocks forever. */
-    ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
-
     /* Find the mq referenced by mqdes. */
-    if( prvFindQueueInList( NULL, NULL, mqdes ) == pdFALSE )
+    if( pxMessageQueue == NULL )
     {
         /* Queue not found; bad descriptor. */
         errno = EBADF;
@@ -680,15 +960,33 @@ ssize_t mq_timedreceive( mqd_t mqdes,
         }
     }
 
-    /* Release the mutex protecting the queue list. */
-    ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &xQueueListMutex );
-
     if( xStatus == 0 )
     {
-        /* Receive data from the FreeRTOS queue. */
-        if( xQueueReceive( pxMessageQueue->xQueue,
-                           &xReceiveData,
-                           xTimeoutTicks ) == pdFALSE )
+        /* Copy the message straight from the message buffer into msg_ptr. The
+         * receiver mutex is held while blocking on the message buffer, so
+         * other receivers wait on the mutex. msg_len was checked against
+         * mq_msgsize, so the message fits. */
+        if( prvLockMessageQueue( ( SemaphoreHandle_t ) &pxMessageQueue->xReceiveMutex,
+                                 &xTimeoutTicks ) == pdTRUE )
+        {
+            xRecordBytes = xMessageBufferPeek( pxMessageQueue->xMessageBuffer,
+                                               &xRegions,
+                                               xTimeoutTicks );
+
+            if( xRecordBytes != 0 )
+            {
+                prvCopyFromRecord( &xRegions,
+                                   mqueueRECORD_HEADER_BYTES,
+                                   ( uint8_t * ) msg_ptr,
+                                   xRecordBytes - mqueueRECORD_HEADER_BYTES );
+                ( void ) xMessageBufferConsume( pxMessageQueue->xMessageBuffer, xRecordBytes );
+                pxMessageQueue->xMessagesReceived++;
+            }
+
+            ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &pxMessageQueue->xReceiveMutex );
+        }
+
+        if( xRecordBytes == 0 )
         {
             /* If queue receive fails, set the appropriate errno. */
             if( pxMessageQueue->xAttr.mq_flags & O_NONBLOCK )
@@ -704,16 +1002,11 @@ ssize_t mq_timedreceive( mqd_t mqdes,
 
             xStatus = -1;
         }
-    }
-
-    if( xStatus == 0 )
-    {
-        /* Get the length of data for return value. */
-        xStatus = ( ssize_t ) xReceiveData.xDataSize;
-
-        /* Copy received data into given buffer, then free it. */
-        ( void ) memcpy( msg_ptr, xReceiveData.pcData, xReceiveData.xDataSize );
-        vPortFree( xReceiveData.pcData );
+        else
+        {
+            /* Return the length of the message, which may be 0. */
+            xStatus = ( ssize_t ) ( xRecordBytes - mqueueRECORD_HEADER_BYTES );
+        }
     }
 
     return xStatus;
@@ -729,18 +1022,16 @@ int mq_timedsend( mqd_t mqdes,
 {
     int iStatus = 0, iCalculateTimeoutReturn = 0;
     TickType_t xTimeoutTicks = 0;
-    QueueListElement_t * pxMessageQueue = ( QueueListElement_t * ) mqdes;
-    QueueElement_t xSendData = { 0 };
+    QueueListElement_t * pxMessageQueue = prvGetMessageQueue( mqdes );
+    StreamBufferRegions_t xRegions = { { NULL }, { 0 } };
+    const uint8_t ucRecordHeader = 0;
+    size_t xRecordBytes = 0;
 
     /* Silence warnings about unused parameters. */
     ( void ) msg_prio;
 
-    /* Lock the mutex that guards access to the queue list. This call will
-     * never fail because it blocks forever. */
-    ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
-
     /* Find the mq referenced by mqdes. */
-    if( prvFindQueueInList( NULL, NULL, mqdes ) == pdFALSE )
+    if( pxMessageQueue == NULL )
     {
         /* Queue not found; bad descriptor. */
         errno = EBADF;
@@ -772,35 +1063,34 @@ int mq_timedsend( mqd_t mqdes,
         }
     }
 
-    /* Release the mutex protecting the queue list. */
-    ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &xQueueListMutex );
-
-    /* Allocate memory for the message. */
     if( iStatus == 0 )
     {
-        xSendData.xDataSize = msg_len;
-        xSendData.pcData = pvPortMalloc( msg_len );
-
-        /* Check that memory allocation succeeded. */
-        if( xSendData.pcData == NULL )
-        {
-            /* msg_len too large. */
-            errno = EMSGSIZE;
-            iStatus = -1;
-        }
-        else
+        /* Copy the message straight from msg_ptr into the message buffer,
+         * after the record header. The sender mutex is held while blocking on
+         * the message buffer, so other senders wait on the mutex. */
+        if( prvLockMessageQueue( ( SemaphoreHandle_t ) &pxMessageQueue->xSendMutex,
+                                 &xTimeoutTicks ) == pdTRUE )
         {
-            /* Copy the data to send. */
-            ( void ) memcpy( xSendData.pcData, msg_ptr, msg_len );
+            xRecordBytes = xMessageBufferReserve( pxMessageQueue->xMessageBuffer,
+                                                  msg_len + mqueueRECORD_HEADER_BYTES,
+                                                  &xRegions,
+                                                  xTimeoutTicks );
+
+            if( xRecordBytes != 0 )
+            {
+                prvCopyToRecord( &xRegions, 0, &ucRecordHeader, mqueueRECORD_HEADER_BYTES );
+                prvCopyToRecord( &xRegions,
+                                 mqueueRECORD_HEADER_BYTES,
+                                 ( const uint8_t * ) msg_ptr,
+                                 msg_len );
+                ( void ) xMessageBufferCommit( pxMessageQueue->xMessageBuffer, xRecordBytes );
+                pxMessageQueue->xMessagesSent++;
+            }
+
+            ( void ) xSemaphoreGive( ( SemaphoreHandle_t ) &pxMessageQueue->xSendMutex );
         }
-    }
 
-    if( iStatus == 0 )
-    {
-        /* Send data to the FreeRTOS queue. */
-        if( xQueueSend( pxMessageQueue->xQueue,
-                        &xSendData,
-                        xTimeoutTicks ) == pdFALSE )
+        if( xRecordBytes == 0 )
         {
             /* If queue send fails, set the appropriate errno. */
             if( pxMessageQueue->xAttr.mq_flags & O_NONBLOCK )
@@ -814,9 +1104,6 @@ int mq_timedsend( mqd_t mqdes,
                 errno = ETIMEDOUT;
             }
 
-            /* Free the allocated queue data. */
-            vPortFree( xSendData.pcData );
-
             iStatus = -1;
         }
     }
@@ -851,13 +1138,14 @@ int mq_unlink( const char * name )
         ( void ) xSemaphoreTake( ( SemaphoreHandle_t ) &xQueueListMutex, portMAX_DELAY );
 
         /* Check if the named queue exists. */
-        if( prvFindQueueInList( &pxMessageQueue, name, ( mqd_t ) NULL ) == pdTRUE )
+        if( prvFindQueueInList( &pxMessageQueue, name, prvHashQueueName( name ) ) == pdTRUE )
         {
             /* If the queue exists and there are no open descriptors to it,
              * remove it from the list. */
             if( pxMessageQueue->xOpenDescriptors == 0 )
             {
                 listREMOVE( &pxMessageQueue->xLink );
+                pxQueueDescriptorTable[ ( pxMessageQueue->xDescriptor - 1 ) % posixconfigMQ_MAX_QUEUES ] = NULL;
 
                 /* Set the flag to delete the queue. Deleting the queue is deferred
                  * until xQueueListMutex is released. */
@@ -0,0 +1,303 @@
+/*
+ * Amazon FreeRTOS+POSIX V1.0.3
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file FreeRTOS_POSIX_pthread_rwlock.c
+ * @brief Implementation of read-write lock functions in pthread.h
+ */
+
+/* C standard library includes. */
+#include <stddef.h>
+
+/* FreeRTOS+POSIX includes. */
+#include "FreeRTOS_POSIX.h"
+#include "FreeRTOS_POSIX/errno.h"
+#include "FreeRTOS_POSIX/pthread.h"
+#include "FreeRTOS_POSIX/utils.h"
+
+#if posixconfigENABLE_PTHREAD_RWLOCK_T == 1
+
+/**
+ * @brief Initialize a PTHREAD_RWLOCK_INITIALIZER lock.
+ *
+ * PTHREAD_RWLOCK_INITIALIZER sets a flag for a lock to be initialized later.
+ * This function performs the initialization.
+ * @param[in] pxRWLock The lock to initialize.
+ *
+ * @return nothing
+ */
+static void prvInitializeStaticRWLock( pthread_rwlock_internal_t * pxRWLock );
+
+/**
+ * @brief Convert the absolute timeout of a timed lock to a delay in ticks.
+ *
+ * @param[in] abstime The absolute timeout, or NULL to wait indefinitely.
+ * @param[out] pxDelay The delay. 0 if abstime has already passed, so the lock
+ * is still attempted without blocking, per POSIX spec.
+ *
+ * @return 0 on success, EINVAL if abstime is invalid.
+ */
+static int prvAbsoluteTimeToDelay( const struct timespec * abstime,
+                                   TickType_t * pxDelay );
+
+/*-----------------------------------------------------------*/
+
+static void prvInitializeStaticRWLock( pthread_rwlock_internal_t * pxRWLock )
+{
+    /* Check if the lock needs to be initialized. */
+    if( pxRWLock->xIsInitialized == pdFALSE )
+    {
+        /* Lock initialization must be in a critical section to prevent two threads
+         * from initializing it at the same time. */
+        taskENTER_CRITICAL();
+
+        /* Check again that the lock is still uninitialized, i.e. it wasn't
+         * initialized while this function was waiting to enter the critical
+         * section. */
+        if( pxRWLock->xIsInitialized == pdFALSE )
+        {
+            vRWLockInit( &pxRWLock->xLock );
+            pxRWLock->xIsInitialized = pdTRUE;
+        }
+
+        /* Exit the critical section. */
+        taskEXIT_CRITICAL();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvAbsoluteTimeToDelay( const struct timespec * abstime,
+                                   TickType_t * pxDelay )
+{
+    int iStatus = 0;
+    struct timespec xCurrentTime = { 0 };
+
+    *pxDelay = portMAX_DELAY;
+
+    if( abstime != NULL )
+    {
+        /* Get current time */
+        if( clock_gettime( CLOCK_REALTIME, &xCurrentTime ) != 0 )
+        {
+            iStatus = EINVAL;
+        }
+        else
+        {
+            iStatus = UTILS_AbsoluteTimespecToDeltaTicks( abstime, &xCurrentTime, pxDelay );
+        }
+
+        /* If abstime was in the past, still attempt to take the lock without
+         * blocking, per POSIX spec. */
+        if( iStatus == ETIMEDOUT )
+        {
+            *pxDelay = 0;
+            iStatus = 0;
+        }
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_destroy( pthread_rwlock_t * rwlock )
+{
+    /* The lock holds no resources. */
+    ( void ) rwlock;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_init( pthread_rwlock_t * rwlock,
+                         const pthread_rwlockattr_t * attr )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRWLock = ( pthread_rwlock_internal_t * ) rwlock;
+
+    /* Silence warnings about unused parameters. */
+    ( void ) attr;
+
+    if( pxRWLock == NULL )
+    {
+        /* No memory. */
+        iStatus = ENOMEM;
+    }
+    else
+    {
+        vRWLockInit( &pxRWLock->xLock );
+        pxRWLock->xIsInitialized = pdTRUE;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_rdlock( pthread_rwlock_t * rwlock )
+{
+    return pthread_rwlock_timedrdlock( rwlock, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_timedrdlock( pthread_rwlock_t * rwlock,
+                                const struct timespec * abstime )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRWLock = ( pthread_rwlock_internal_t * ) rwlock;
+    TickType_t xDelay = portMAX_DELAY;
+
+    /* If lock in uninitialized, perform initialization. */
+    prvInitializeStaticRWLock( pxRWLock );
+
+    iStatus = prvAbsoluteTimeToDelay( abstime, &xDelay );
+
+    /* A thread that holds the lock for writing would wait for itself. */
+    if( ( iStatus == 0 ) && ( xRWLockIsWriteOwner( &pxRWLock->xLock ) == pdTRUE ) )
+    {
+        iStatus = EDEADLK;
+    }
+
+    if( ( iStatus == 0 ) && ( xRWLockReadTake( &pxRWLock->xLock, xDelay ) == pdFAIL ) )
+    {
+        iStatus = ETIMEDOUT;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_timedwrlock( pthread_rwlock_t * rwlock,
+                                const struct timespec * abstime )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRWLock = ( pthread_rwlock_internal_t * ) rwlock;
+    TickType_t xDelay = portMAX_DELAY;
+
+    /* If lock in uninitialized, perform initialization. */
+    prvInitializeStaticRWLock( pxRWLock );
+
+    iStatus = prvAbsoluteTimeToDelay( abstime, &xDelay );
+
+    /* Check if trying to lock a lock the thread already holds for writing. */
+    if( ( iStatus == 0 ) && ( xRWLockIsWriteOwner( &pxRWLock->xLock ) == pdTRUE ) )
+    {
+        iStatus = EDEADLK;
+    }
+
+    if( ( iStatus == 0 ) && ( xRWLockWriteTake( &pxRWLock->xLock, xDelay ) == pdFAIL ) )
+    {
+        iStatus = ETIMEDOUT;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_tryrdlock( pthread_rwlock_t * rwlock )
+{
+    int iStatus = 0;
+    struct timespec xTimeout =
+    {
+        .tv_sec  = 0,
+        .tv_nsec = 0
+    };
+
+    /* Attempt to lock with no timeout. */
+    iStatus = pthread_rwlock_timedrdlock( rwlock, &xTimeout );
+
+    /* POSIX specifies that this function should return EBUSY instead of
+     * ETIMEDOUT for attempting to lock a locked lock. */
+    if( iStatus == ETIMEDOUT )
+    {
+        iStatus = EBUSY;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_trywrlock( pthread_rwlock_t * rwlock )
+{
+    int iStatus = 0;
+    struct timespec xTimeout =
+    {
+        .tv_sec  = 0,
+        .tv_nsec = 0
+    };
+
+    /* Attempt to lock with no timeout. */
+    iStatus = pthread_rwlock_timedwrlock( rwlock, &xTimeout );
+
+    /* POSIX specifies that this function should return EBUSY instead of
+     * ETIMEDOUT for attempting to lock a locked lock. */
+    if( ( iStatus == ETIMEDOUT ) || ( iStatus == EDEADLK ) )
+    {
+        iStatus = EBUSY;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_unlock( pthread_rwlock_t * rwlock )
+{
+    int iStatus = 0;
+    pthread_rwlock_internal_t * pxRWLock = ( pthread_rwlock_internal_t * ) rwlock;
+
+    /* If lock in uninitialized, perform initialization. */
+    prvInitializeStaticRWLock( pxRWLock );
+
+    /* The lock only records the thread that holds it for writing, so any other
+     * thread is taken to hold it for reading. */
+    if( xRWLockIsWriteOwner( &pxRWLock->xLock ) == pdTRUE )
+    {
+        ( void ) xRWLockWriteGive( &pxRWLock->xLock );
+    }
+    else if( xRWLockReadGive( &pxRWLock->xLock ) == pdFAIL )
+    {
+        iStatus = EPERM;
+    }
+
+    return iStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int pthread_rwlock_wrlock( pthread_rwlock_t * rwlock )
+{
+    return pthread_rwlock_timedwrlock( rwlock, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+#endif /* posixconfigENABLE_PTHREAD_RWLOCK_T == 1 */
@@ -0,0 +1,242 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * The built in event recorder, compiled in when configUSE_EVENT_TRACE is set
+ * to 1 in FreeRTOSConfig.h.  See event_trace.h.
+ *
+ * The records are kept in a ring of configEVENT_TRACE_RECORDS records.  The
+ * kernel, from tasks and interrupts, is the writer and the application is the
+ * reader.  ulWritten and ulRead count the records written to and read from the
+ * ring since it started, so the records ready to read are those from ulRead to
+ * ulWritten.  Only the writer changes ulWritten, and only with interrupts
+ * masked, and only the reader changes ulRead, so neither ever waits for the
+ * other: the writer drops records when the ring is full and the reader finds
+ * no records when it is empty.
+ */
+#include <string.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configUSE_EVENT_TRACE == 1 )
+
+/* The writer and the reader only interleave through interrupts and context
+switches on a single core, so keeping the compiler from reordering the stores
+to a record and to the counts is enough. */
+#ifndef portMEMORY_BARRIER
+	#if defined( __GNUC__ )
+		#define portMEMORY_BARRIER() __asm volatile( "" ::: "memory" )
+	#else
+		#define portMEMORY_BARRIER()
+	#endif
+#endif
+
+/* The index in the ring of the record with the given count. */
+#define eventtraceINDEX( ulCount )	( ( ulCount ) & ( uint32_t ) ( configEVENT_TRACE_RECORDS - 1 ) )
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Fill in the next record of the ring.  Called with interrupts masked, when
+ * the ring is known to have space.
+ */
+static void prvWriteRecord( uint32_t ulTimestamp, uint8_t ucEvent, uint8_t ucInfo, uint16_t usTask, uint32_t ulObject, uint32_t ulValue );
+
+/*-----------------------------------------------------------*/
+
+/* The ring starts with the eventtraceSTART record, so it is read first. */
+static EventTraceRecord_t xRecords[ configEVENT_TRACE_RECORDS ] = { { 0UL, eventtraceSTART, 0U, 0U, eventtraceBYTE_ORDER_MARK, ( uint32_t ) configEVENT_TRACE_RECORDS } };
+static volatile uint32_t ulWritten = 1, ulRead = 0;
+
+/* The records dropped since the last eventtraceDROPPED record, and since the
+recorder started.  Only changed with interrupts masked. */
+static uint32_t ulDroppedPending = 0, ulDroppedTotal = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvWriteRecord( uint32_t ulTimestamp, uint8_t ucEvent, uint8_t ucInfo, uint16_t usTask, uint32_t ulObject, uint32_t ulValue )
+{
+EventTraceRecord_t * const pxRecord = &( xRecords[ eventtraceINDEX( ulWritten ) ] );
+
+	pxRecord->ulTimestamp = ulTimestamp;
+	pxRecord->ucEvent = ucEvent;
+	pxRecord->ucInfo = ucInfo;
+	pxRecord->usTask = usTask;
+	pxRecord->ulObject = ulObject;
+	pxRecord->ulValue = ulValue;
+
+	/* The record must be complete before the reader can see it.  The
+	record is not volatile, so the compiler is told not to move the stores to
+	it past the store to ulWritten. */
+	portMEMORY_BARRIER();
+	ulWritten = ulWritten + 1UL;
+}
+/*-----------------------------------------------------------*/
+
+void vEventTraceRecord( uint8_t ucEvent, uint8_t ucInfo, uint16_t usTask, uint32_t ulObject, uint32_t ulValue )
+{
+UBaseType_t uxSavedInterruptStatus;
+uint32_t ulFree;
+
+	/* This function is called from the kernel in critical sections, with the
+	scheduler suspended and from interrupts, so interrupts are masked, which
+	works in all of them, just while the record is filled in. */
+	uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+	{
+		const uint32_t ulTimestamp = portEVENT_TRACE_TIMESTAMP();
+
+		ulFree = ( uint32_t ) configEVENT_TRACE_RECORDS - ( ulWritten - ulRead );
+
+		/* After records were dropped, they are recorded before the next
+		record, so space is needed for both. */
+		if( ulDroppedPending != 0UL )
+		{
+			if( ulFree >= 2UL )
+			{
+				prvWriteRecord( ulTimestamp, eventtraceDROPPED, 0U, 0U, 0UL, ulDroppedPending );
+				ulDroppedPending = 0UL;
+				ulFree--;
+			}
+			else
+			{
+				ulFree = 0UL;
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		if( ulFree > 0UL )
+		{
+			prvWriteRecord( ulTimestamp, ucEvent, ucInfo, usTask, ulObject, ulValue );
+		}
+		else
+		{
+			ulDroppedPending++;
+			ulDroppedTotal++;
+		}
+	}
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+void vEventTraceTaskCreate( uint16_t usTask, const char *pcName )
+{
+char cName[ 8 ] = { 0 };
+uint32_t ulName[ 2 ];
+size_t x;
+
+	for( x = 0; ( x < sizeof( cName ) ) && ( pcName[ x ] != ( char ) 0x00 ); x++ )
+	{
+		cName[ x ] = pcName[ x ];
+	}
+
+	( void ) memcpy( ( void * ) ulName, ( const void * ) cName, sizeof( ulName ) );
+	vEventTraceRecord( eventtraceTASK_CREATE, 0U, usTask, ulName[ 0 ], ulName[ 1 ] );
+}
+/*-----------------------------------------------------------*/
+
+size_t xEventTraceRead( EventTraceRecord_t *pxRecords, size_t xMaxRecords )
+{
+const uint32_t ulReady = ulWritten - ulRead;
+size_t xCount, x;
+
+	/* The records up to ulWritten are complete, see prvWriteRecord(), and the
+	writer won't reuse them until ulRead has moved past them. */
+	portMEMORY_BARRIER();
+	xCount = ( ( size_t ) ulReady < xMaxRecords ) ? ( size_t ) ulReady : xMaxRecords;
+
+	for( x = 0; x < xCount; x++ )
+	{
+		pxRecords[ x ] = xRecords[ eventtraceINDEX( ulRead + ( uint32_t ) x ) ];
+	}
+
+	portMEMORY_BARRIER();
+	ulRead = ulRead + ( uint32_t ) xCount;
+
+	return xCount;
+}
+/*-----------------------------------------------------------*/
+
+size_t xEventTraceDrain( EventTraceWriter_t pxWriter, void *pvContext )
+{
+size_t xTotal = 0, xRecordsInSpan, xBytes;
+uint32_t ulReady, ulIndex;
+
+	configASSERT( pxWriter );
+
+	/* The ready records are passed in at most two spans, the second one from
+	the start of the ring if they wrap.  Records written meanwhile are left
+	for the next call. */
+	ulReady = ulWritten - ulRead;
+	portMEMORY_BARRIER();
+
+	while( ulReady > 0UL )
+	{
+		ulIndex = eventtraceINDEX( ulRead );
+		xRecordsInSpan = ( size_t ) configMIN( ulReady, ( uint32_t ) configEVENT_TRACE_RECORDS - ulIndex );
+
+		xBytes = pxWriter( pvContext, ( const uint8_t * ) &( xRecords[ ulIndex ] ), xRecordsInSpan * sizeof( EventTraceRecord_t ) );
+		configASSERT( ( xBytes % sizeof( EventTraceRecord_t ) ) == 0U );
+		xBytes /= sizeof( EventTraceRecord_t );
+
+		portMEMORY_BARRIER();
+		ulRead = ulRead + ( uint32_t ) xBytes;
+		ulReady -= ( uint32_t ) xBytes;
+		xTotal += xBytes;
+
+		if( xBytes < xRecordsInSpan )
+		{
+			/* The writer is full. */
+			break;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+	return xTotal;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulEventTraceDropped( void )
+{
+	return ulDroppedTotal;
+}
+/*-----------------------------------------------------------*/
+
+#endif /* configUSE_EVENT_TRACE */
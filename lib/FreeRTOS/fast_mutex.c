@@ -0,0 +1,893 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+
+/* Standard includes. */
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "fast_mutex.h"
+
+/* Lint e961, e750 and e9021 are suppressed as a MISRA exception justified
+because the MPU ports require MPU_WRAPPERS_INCLUDED_FROM_API_FILE to be defined
+for the header files above, but not in this file, in order to generate the
+correct privileged Vs unprivileged linkage and placement. */
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE /*lint !e961 !e750 !e9021 See comment above. */
+
+/* The states of a fast mutex.  A task that finds the mutex held marks it
+contended before it blocks, so the task that gives it only calls into the
+kernel to wake a waiting task if the mutex was contended. */
+#define fastmutexFREE			( ( uint32_t ) 0 )
+#define fastmutexHELD			( ( uint32_t ) 1 )
+#define fastmutexCONTENDED		( ( uint32_t ) 2 )
+
+/* The state of a reader-writer lock counts the readers that hold it in the low
+bits, and has the top bit set while a writer holds or waits for it. */
+#define rwlockWRITER			( ( uint32_t ) 0x80000000UL )
+#define rwlockREADERS_MASK		( ( uint32_t ) 0x7fffffffUL )
+
+#if( configUSE_PREEMPTION == 0 )
+	/* If the cooperative scheduler is being used then a yield should not be
+	performed just because a higher priority task has been woken. */
+	#define fastmutexYIELD_IF_USING_PREEMPTION()
+#else
+	#define fastmutexYIELD_IF_USING_PREEMPTION() portYIELD_WITHIN_API()
+#endif
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Atomic operations on the state words, which all return the value the word
+ * had before.  Without configUSE_ATOMIC_BUILTINS they use task level critical
+ * sections, so they must not be called from interrupts.
+ */
+static uint32_t prvAtomicCompareAndSwap( volatile uint32_t *pulState, uint32_t ulExpected, uint32_t ulNew );
+static uint32_t prvAtomicSwap( volatile uint32_t *pulState, uint32_t ulNew );
+static uint32_t prvAtomicOr( volatile uint32_t *pulState, uint32_t ulBits );
+static uint32_t prvAtomicAnd( volatile uint32_t *pulState, uint32_t ulBits );
+static uint32_t prvAtomicAdd( volatile uint32_t *pulState, uint32_t ulValue );
+
+/*
+ * Set a reader slot of a reader-writer lock to a task if it is NULL, and
+ * return pdTRUE if it was.
+ */
+static BaseType_t prvAtomicClaimSlot( TaskHandle_t volatile *pxSlot, TaskHandle_t xTask );
+
+/*
+ * The part of xFastMutexTake() that runs when the mutex is held by another
+ * task, and blocks the calling task until the mutex is given or the time runs
+ * out.
+ */
+static BaseType_t prvFastMutexTakeBlocking( FastMutex_t *pxMutex, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/*
+ * The priority of the highest priority task waiting for a mutex, to which the
+ * holder's priority drops when a task that raised it times out.
+ */
+static UBaseType_t prvGetDisinheritPriorityAfterTimeout( const FastMutex_t *pxMutex ) PRIVILEGED_FUNCTION;
+
+/*
+ * Wake the highest priority task in an event list, if there is one, and
+ * return pdTRUE if it has a priority above the calling task's.
+ */
+static BaseType_t prvWakeWaitingTask( List_t *pxEventList ) PRIVILEGED_FUNCTION;
+
+/*
+ * Block a writer that holds the writer mutex of a reader-writer lock until the
+ * readers have given the lock, or the time runs out, in which case the writer
+ * gives up the lock again.
+ */
+static BaseType_t prvWaitForReaders( RWLock_t *pxLock, TimeOut_t *pxTimeOut, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/*
+ * Record the calling task in a free reader slot of a reader-writer lock, if
+ * there is one, before it counts itself in as a reader, so a writer that
+ * waits for the readers finds it there and can raise its priority.  The slot
+ * counts as a mutex held by the task, so its priority drops back when it
+ * clears the slot again with prvForgetReader().
+ */
+static void prvRecordReader( RWLock_t *pxLock ) PRIVILEGED_FUNCTION;
+
+/*
+ * Clear the reader slot of the calling task, if it has one, and drop the
+ * priority a writer might have raised.
+ */
+static void prvForgetReader( RWLock_t *pxLock ) PRIVILEGED_FUNCTION;
+
+/*-----------------------------------------------------------*/
+
+#if( configUSE_ATOMIC_BUILTINS == 1 )
+
+	static uint32_t prvAtomicCompareAndSwap( volatile uint32_t *pulState, uint32_t ulExpected, uint32_t ulNew )
+	{
+		/* On failure the builtin writes the value it found to ulExpected. */
+		( void ) __atomic_compare_exchange_n( pulState, &ulExpected, ulNew, pdFALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+		return ulExpected;
+	}
+
+	static uint32_t prvAtomicSwap( volatile uint32_t *pulState, uint32_t ulNew )
+	{
+		return __atomic_exchange_n( pulState, ulNew, __ATOMIC_SEQ_CST );
+	}
+
+	static uint32_t prvAtomicOr( volatile uint32_t *pulState, uint32_t ulBits )
+	{
+		return __atomic_fetch_or( pulState, ulBits, __ATOMIC_SEQ_CST );
+	}
+
+	static uint32_t prvAtomicAnd( volatile uint32_t *pulState, uint32_t ulBits )
+	{
+		return __atomic_fetch_and( pulState, ulBits, __ATOMIC_SEQ_CST );
+	}
+
+	static uint32_t prvAtomicAdd( volatile uint32_t *pulState, uint32_t ulValue )
+	{
+		return __atomic_fetch_add( pulState, ulValue, __ATOMIC_SEQ_CST );
+	}
+
+	static BaseType_t prvAtomicClaimSlot( TaskHandle_t volatile *pxSlot, TaskHandle_t xTask )
+	{
+	TaskHandle_t xExpected = NULL;
+
+		return ( BaseType_t ) __atomic_compare_exchange_n( pxSlot, &xExpected, xTask, pdFALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+	}
+
+#else /* configUSE_ATOMIC_BUILTINS */
+
+	static uint32_t prvAtomicCompareAndSwap( volatile uint32_t *pulState, uint32_t ulExpected, uint32_t ulNew )
+	{
+	uint32_t ulBefore;
+
+		taskENTER_CRITICAL();
+		{
+			ulBefore = *pulState;
+
+			if( ulBefore == ulExpected )
+			{
+				*pulState = ulNew;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		return ulBefore;
+	}
+
+	static uint32_t prvAtomicSwap( volatile uint32_t *pulState, uint32_t ulNew )
+	{
+	uint32_t ulBefore;
+
+		taskENTER_CRITICAL();
+		{
+			ulBefore = *pulState;
+			*pulState = ulNew;
+		}
+		taskEXIT_CRITICAL();
+
+		return ulBefore;
+	}
+
+	static uint32_t prvAtomicOr( volatile uint32_t *pulState, uint32_t ulBits )
+	{
+	uint32_t ulBefore;
+
+		taskENTER_CRITICAL();
+		{
+			ulBefore = *pulState;
+			*pulState = ulBefore | ulBits;
+		}
+		taskEXIT_CRITICAL();
+
+		return ulBefore;
+	}
+
+	static uint32_t prvAtomicAnd( volatile uint32_t *pulState, uint32_t ulBits )
+	{
+	uint32_t ulBefore;
+
+		taskENTER_CRITICAL();
+		{
+			ulBefore = *pulState;
+			*pulState = ulBefore & ulBits;
+		}
+		taskEXIT_CRITICAL();
+
+		return ulBefore;
+	}
+
+	static uint32_t prvAtomicAdd( volatile uint32_t *pulState, uint32_t ulValue )
+	{
+	uint32_t ulBefore;
+
+		taskENTER_CRITICAL();
+		{
+			ulBefore = *pulState;
+			*pulState = ulBefore + ulValue;
+		}
+		taskEXIT_CRITICAL();
+
+		return ulBefore;
+	}
+
+	static BaseType_t prvAtomicClaimSlot( TaskHandle_t volatile *pxSlot, TaskHandle_t xTask )
+	{
+	BaseType_t xReturn = pdFALSE;
+
+		taskENTER_CRITICAL();
+		{
+			if( *pxSlot == NULL )
+			{
+				*pxSlot = xTask;
+				xReturn = pdTRUE;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		return xReturn;
+	}
+
+#endif /* configUSE_ATOMIC_BUILTINS */
+/*-----------------------------------------------------------*/
+
+void vFastMutexInit( FastMutex_t *pxMutex )
+{
+	configASSERT( pxMutex );
+
+	pxMutex->ulState = fastmutexFREE;
+	pxMutex->xOwner = NULL;
+	vListInitialise( &( pxMutex->xTasksWaitingToTake ) );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xFastMutexTake( FastMutex_t *pxMutex, TickType_t xTicksToWait )
+{
+BaseType_t xReturn;
+
+	configASSERT( pxMutex );
+
+	if( prvAtomicCompareAndSwap( &( pxMutex->ulState ), fastmutexFREE, fastmutexHELD ) == fastmutexFREE )
+	{
+		/* The mutex was free, which is the common case. */
+		pxMutex->xOwner = pvTaskIncrementMutexHeldCount();
+		xReturn = pdPASS;
+	}
+	else if( xTicksToWait == ( TickType_t ) 0 )
+	{
+		xReturn = pdFAIL;
+	}
+	else
+	{
+		xReturn = prvFastMutexTakeBlocking( pxMutex, xTicksToWait );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvFastMutexTakeBlocking( FastMutex_t *pxMutex, TickType_t xTicksToWait )
+{
+TimeOut_t xTimeOut;
+BaseType_t xReturn, xInheritanceOccurred = pdFALSE;
+
+	/* The mutex is not recursive, and the task cannot block with the
+	scheduler suspended. */
+	configASSERT( pxMutex->xOwner != xTaskGetCurrentTaskHandle() );
+	#if ( ( INCLUDE_xTaskGetSchedulerState == 1 ) || ( configUSE_TIMERS == 1 ) )
+	{
+		configASSERT( xTaskGetSchedulerState() != taskSCHEDULER_SUSPENDED );
+	}
+	#endif
+
+	vTaskSetTimeOutState( &xTimeOut );
+
+	for( ;; )
+	{
+		/* Mark the mutex contended, so the task that gives it wakes this task.
+		If it was given in the mean time this takes it instead.  The state then
+		stays contended even if no other task waits, which only costs the next
+		give a check of the event list. */
+		if( prvAtomicSwap( &( pxMutex->ulState ), fastmutexCONTENDED ) == fastmutexFREE )
+		{
+			pxMutex->xOwner = pvTaskIncrementMutexHeldCount();
+			xReturn = pdPASS;
+			break;
+		}
+
+		vTaskSuspendAll();
+
+		if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE )
+		{
+			/* No task can give the mutex while the scheduler is suspended, so
+			if it is still contended the task that gives it will find this task
+			in the event list. */
+			if( pxMutex->ulState == fastmutexCONTENDED )
+			{
+				taskENTER_CRITICAL();
+				{
+					/* The holder is NULL for the few instructions after it
+					took the mutex, in which case it simply doesn't inherit the
+					priority of this task. */
+					if( xTaskPriorityInherit( pxMutex->xOwner ) != pdFALSE )
+					{
+						xInheritanceOccurred = pdTRUE;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				taskEXIT_CRITICAL();
+
+				vTaskPlaceOnEventList( &( pxMutex->xTasksWaitingToTake ), xTicksToWait );
+
+				if( xTaskResumeAll() == pdFALSE )
+				{
+					portYIELD_WITHIN_API();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				/* The mutex was given, try again. */
+				( void ) xTaskResumeAll();
+			}
+		}
+		else
+		{
+			( void ) xTaskResumeAll();
+
+			/* Timed out.  If this task raised the holder's priority, the
+			holder drops back to the priority of the highest priority task
+			still waiting. */
+			if( xInheritanceOccurred != pdFALSE )
+			{
+				taskENTER_CRITICAL();
+				{
+					vTaskPriorityDisinheritAfterTimeout( pxMutex->xOwner, prvGetDisinheritPriorityAfterTimeout( pxMutex ) );
+				}
+				taskEXIT_CRITICAL();
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			xReturn = pdFAIL;
+			break;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xFastMutexGive( FastMutex_t *pxMutex )
+{
+TaskHandle_t xCurrentTask;
+BaseType_t xReturn = pdPASS, xYieldRequired = pdFALSE;
+
+	configASSERT( pxMutex );
+
+	xCurrentTask = xTaskGetCurrentTaskHandle();
+
+	if( pxMutex->xOwner != xCurrentTask )
+	{
+		xReturn = pdFAIL;
+	}
+	else
+	{
+		pxMutex->xOwner = NULL;
+
+		if( ( prvAtomicSwap( &( pxMutex->ulState ), fastmutexFREE ) == fastmutexHELD ) &&
+			( xTaskDecrementMutexHeldCount() != pdFALSE ) )
+		{
+			/* No task waited for the mutex, and the priority of this task
+			doesn't change. */
+			mtCOVERAGE_TEST_MARKER();
+		}
+		else
+		{
+			taskENTER_CRITICAL();
+			{
+				xYieldRequired = prvWakeWaitingTask( &( pxMutex->xTasksWaitingToTake ) );
+
+				if( xTaskPriorityDisinherit( xCurrentTask ) != pdFALSE )
+				{
+					xYieldRequired = pdTRUE;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			if( xYieldRequired != pdFALSE )
+			{
+				fastmutexYIELD_IF_USING_PREEMPTION();
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+TaskHandle_t xFastMutexGetOwner( const FastMutex_t *pxMutex )
+{
+	configASSERT( pxMutex );
+
+	return pxMutex->xOwner;
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvGetDisinheritPriorityAfterTimeout( const FastMutex_t *pxMutex )
+{
+UBaseType_t uxHighestPriorityOfWaitingTasks;
+
+	if( listCURRENT_LIST_LENGTH( &( pxMutex->xTasksWaitingToTake ) ) > 0U )
+	{
+		uxHighestPriorityOfWaitingTasks = ( UBaseType_t ) configMAX_PRIORITIES - ( UBaseType_t ) listGET_ITEM_VALUE_OF_HEAD_ENTRY( &( pxMutex->xTasksWaitingToTake ) );
+	}
+	else
+	{
+		uxHighestPriorityOfWaitingTasks = tskIDLE_PRIORITY;
+	}
+
+	return uxHighestPriorityOfWaitingTasks;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvWakeWaitingTask( List_t *pxEventList )
+{
+BaseType_t xReturn = pdFALSE;
+
+	/* Called in a critical section. */
+	if( listLIST_IS_EMPTY( pxEventList ) == pdFALSE )
+	{
+		xReturn = xTaskRemoveFromEventList( pxEventList );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vRWLockInit( RWLock_t *pxLock )
+{
+UBaseType_t uxSlot;
+
+	configASSERT( pxLock );
+
+	pxLock->ulState = 0UL;
+	vFastMutexInit( &( pxLock->xWriterMutex ) );
+	vListInitialise( &( pxLock->xWriterWaitingForReaders ) );
+
+	for( uxSlot = 0; uxSlot < ( UBaseType_t ) configRWLOCK_TRACKED_READERS; uxSlot++ )
+	{
+		pxLock->xReaders[ uxSlot ] = NULL;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvRecordReader( RWLock_t *pxLock )
+{
+TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+UBaseType_t uxSlot;
+
+	for( uxSlot = 0; uxSlot < ( UBaseType_t ) configRWLOCK_TRACKED_READERS; uxSlot++ )
+	{
+		if( ( pxLock->xReaders[ uxSlot ] == NULL ) &&
+			( prvAtomicClaimSlot( &( pxLock->xReaders[ uxSlot ] ), xCurrentTask ) != pdFALSE ) )
+		{
+			( void ) pvTaskIncrementMutexHeldCount();
+			break;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvForgetReader( RWLock_t *pxLock )
+{
+TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+UBaseType_t uxSlot;
+BaseType_t xYieldRequired = pdFALSE;
+
+	for( uxSlot = 0; uxSlot < ( UBaseType_t ) configRWLOCK_TRACKED_READERS; uxSlot++ )
+	{
+		if( pxLock->xReaders[ uxSlot ] == xCurrentTask )
+		{
+			/* Only this task clears its slot, and once it is clear no writer
+			can raise the priority of this task through it, so the priority
+			checked below is final. */
+			pxLock->xReaders[ uxSlot ] = NULL;
+
+			if( xTaskDecrementMutexHeldCount() == pdFALSE )
+			{
+				taskENTER_CRITICAL();
+				{
+					xYieldRequired = xTaskPriorityDisinherit( xCurrentTask );
+				}
+				taskEXIT_CRITICAL();
+
+				if( xYieldRequired != pdFALSE )
+				{
+					fastmutexYIELD_IF_USING_PREEMPTION();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			break;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xRWLockReadTake( RWLock_t *pxLock, TickType_t xTicksToWait )
+{
+uint32_t ulState, ulBefore;
+BaseType_t xReturn = pdFAIL;
+
+	configASSERT( pxLock );
+
+	/* Record this task before it counts itself in, so a writer that sets the
+	writer bit in between still finds it. */
+	prvRecordReader( pxLock );
+
+	/* Count this task in as a reader while no writer holds or waits for the
+	lock, which is the common case. */
+	ulState = pxLock->ulState;
+
+	while( ( ulState & rwlockWRITER ) == 0UL )
+	{
+		configASSERT( ulState != rwlockREADERS_MASK );
+		ulBefore = prvAtomicCompareAndSwap( &( pxLock->ulState ), ulState, ulState + 1UL );
+
+		if( ulBefore == ulState )
+		{
+			xReturn = pdPASS;
+			break;
+		}
+
+		ulState = ulBefore;
+	}
+
+	if( xReturn == pdFAIL )
+	{
+		/* A writer holds or waits for the lock, so this task is not a reader
+		until it has waited for the writer. */
+		prvForgetReader( pxLock );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( ( xReturn == pdFAIL ) && ( xTicksToWait != ( TickType_t ) 0 ) )
+	{
+		/* Queue behind the writer on the writer mutex, which raises the
+		writer's priority if need be.  The writer clears the writer bit before
+		it gives the mutex, so while this task holds it no writer holds the lock
+		and the reader can be counted in. */
+		if( xFastMutexTake( &( pxLock->xWriterMutex ), xTicksToWait ) != pdFAIL )
+		{
+			prvRecordReader( pxLock );
+			( void ) prvAtomicAdd( &( pxLock->ulState ), 1UL );
+			( void ) xFastMutexGive( &( pxLock->xWriterMutex ) );
+			xReturn = pdPASS;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xRWLockReadGive( RWLock_t *pxLock )
+{
+uint32_t ulState, ulBefore;
+BaseType_t xReturn = pdFAIL, xYieldRequired = pdFALSE;
+
+	configASSERT( pxLock );
+
+	ulState = pxLock->ulState;
+
+	while( ( ulState & rwlockREADERS_MASK ) != 0UL )
+	{
+		ulBefore = prvAtomicCompareAndSwap( &( pxLock->ulState ), ulState, ulState - 1UL );
+
+		if( ulBefore == ulState )
+		{
+			xReturn = pdPASS;
+			break;
+		}
+
+		ulState = ulBefore;
+	}
+
+	if( ( xReturn != pdFAIL ) && ( ulState == ( rwlockWRITER | 1UL ) ) )
+	{
+		/* The last reader gave the lock while a writer waits for it.  The
+		writer might not have blocked yet, in which case it finds no readers
+		left when it checks.  The writer only runs once this task has dropped
+		the priority the writer gave it, so waking the writer alone doesn't
+		need a yield. */
+		taskENTER_CRITICAL();
+		{
+			xYieldRequired = prvWakeWaitingTask( &( pxLock->xWriterWaitingForReaders ) );
+		}
+		taskEXIT_CRITICAL();
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( xReturn != pdFAIL )
+	{
+		prvForgetReader( pxLock );
+
+		if( xYieldRequired != pdFALSE )
+		{
+			fastmutexYIELD_IF_USING_PREEMPTION();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xRWLockWriteTake( RWLock_t *pxLock, TickType_t xTicksToWait )
+{
+TimeOut_t xTimeOut;
+BaseType_t xReturn, xEntryTimeSet = pdFALSE;
+
+	configASSERT( pxLock );
+
+	xReturn = xFastMutexTake( &( pxLock->xWriterMutex ), 0 );
+
+	if( ( xReturn == pdFAIL ) && ( xTicksToWait != ( TickType_t ) 0 ) )
+	{
+		/* Another writer holds or waits for the lock.  Remember when the wait
+		began, as the time spent waiting for the mutex counts against the wait
+		for the readers. */
+		vTaskSetTimeOutState( &xTimeOut );
+		xEntryTimeSet = pdTRUE;
+		xReturn = xFastMutexTake( &( pxLock->xWriterMutex ), xTicksToWait );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( xReturn != pdFAIL )
+	{
+		/* Keep further readers out, and wait for any that hold the lock. */
+		if( ( prvAtomicOr( &( pxLock->ulState ), rwlockWRITER ) & rwlockREADERS_MASK ) != 0UL )
+		{
+			if( xEntryTimeSet == pdFALSE )
+			{
+				vTaskSetTimeOutState( &xTimeOut );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			xReturn = prvWaitForReaders( pxLock, &xTimeOut, xTicksToWait );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvWaitForReaders( RWLock_t *pxLock, TimeOut_t *pxTimeOut, TickType_t xTicksToWait )
+{
+BaseType_t xReturn, xInheritanceOccurred = pdFALSE;
+UBaseType_t uxSlot;
+
+	for( ;; )
+	{
+		vTaskSuspendAll();
+
+		if( ( pxLock->ulState & rwlockREADERS_MASK ) == 0UL )
+		{
+			( void ) xTaskResumeAll();
+			xReturn = pdPASS;
+			break;
+		}
+		else if( xTaskCheckForTimeOut( pxTimeOut, &xTicksToWait ) == pdFALSE )
+		{
+			/* Raise the readers recorded in the slots to the priority of this
+			task.  No reader counts itself in while the writer bit is set, so
+			all that hold the lock with a slot are in the slots by now. */
+			taskENTER_CRITICAL();
+			{
+				for( uxSlot = 0; uxSlot < ( UBaseType_t ) configRWLOCK_TRACKED_READERS; uxSlot++ )
+				{
+					if( xTaskPriorityInherit( pxLock->xReaders[ uxSlot ] ) != pdFALSE )
+					{
+						xInheritanceOccurred = pdTRUE;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			/* No reader can give the lock while the scheduler is suspended, so
+			the last one will find this task in the event list. */
+			vTaskPlaceOnEventList( &( pxLock->xWriterWaitingForReaders ), xTicksToWait );
+
+			if( xTaskResumeAll() == pdFALSE )
+			{
+				portYIELD_WITHIN_API();
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			( void ) xTaskResumeAll();
+
+			/* Timed out.  The readers that still hold the lock drop back to
+			their own priority, as no other task waits for them. */
+			if( xInheritanceOccurred != pdFALSE )
+			{
+				taskENTER_CRITICAL();
+				{
+					for( uxSlot = 0; uxSlot < ( UBaseType_t ) configRWLOCK_TRACKED_READERS; uxSlot++ )
+					{
+						if( pxLock->xReaders[ uxSlot ] != NULL )
+						{
+							vTaskPriorityDisinheritAfterTimeout( pxLock->xReaders[ uxSlot ], tskIDLE_PRIORITY );
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
+					}
+				}
+				taskEXIT_CRITICAL();
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* Let the readers in again. */
+			( void ) prvAtomicAnd( &( pxLock->ulState ), rwlockREADERS_MASK );
+			( void ) xFastMutexGive( &( pxLock->xWriterMutex ) );
+			xReturn = pdFAIL;
+			break;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xRWLockWriteGive( RWLock_t *pxLock )
+{
+BaseType_t xReturn;
+
+	configASSERT( pxLock );
+
+	if( xRWLockIsWriteOwner( pxLock ) != pdFALSE )
+	{
+		/* Clear the writer bit before the readers waiting for the writer mutex
+		can take it. */
+		( void ) prvAtomicAnd( &( pxLock->ulState ), rwlockREADERS_MASK );
+		xReturn = xFastMutexGive( &( pxLock->xWriterMutex ) );
+	}
+	else
+	{
+		xReturn = pdFAIL;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xRWLockIsWriteOwner( const RWLock_t *pxLock )
+{
+BaseType_t xReturn = pdFALSE;
+
+	configASSERT( pxLock );
+
+	/* Readers hold the writer mutex too, but only within xRWLockReadTake(). */
+	if( ( ( pxLock->ulState & rwlockWRITER ) != 0UL ) &&
+		( pxLock->xWriterMutex.xOwner == xTaskGetCurrentTaskHandle() ) )
+	{
+		xReturn = pdTRUE;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return xReturn;
+}
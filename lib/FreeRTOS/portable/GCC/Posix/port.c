@@ -0,0 +1,601 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*-----------------------------------------------------------
+ * Implementation of functions defined in portable.h for the Linux/POSIX
+ * simulator.
+ *
+ * Each task runs in a POSIX thread of its own, and only the thread of the task
+ * in the Running state is allowed to run.  A task that yields selects the next
+ * task, wakes its thread and waits until its own thread is woken again.  The
+ * tick interrupt is simulated by a thread that waits on a timerfd and processes
+ * the tick with the simulated interrupt mutex held.  While it does, the thread
+ * of the running task is stopped with a signal whose handler waits until the
+ * task is selected to run again, which is the simulated equivalent of an
+ * interrupt.  If the tick selects another task, the thread of that task is
+ * woken instead, which switches the context.
+ *
+ * A task is stopped this way wherever it happens to be, which may be in the
+ * middle of a C library call that holds a lock of the library, such as malloc()
+ * or printf().  The lock stays held until the task runs again, which the port
+ * does not prevent, so it is a limit of the simulator:
+ *
+ * - The tick hook, and any other code that runs in the tick thread, must not
+ *   call functions of the library that take such a lock, or the tick thread
+ *   can wait forever for a task it has stopped itself.
+ * - A task that waits for the lock runs until the tick stops it, but a task of
+ *   higher priority that does can keep the task of lower priority that holds
+ *   the lock from ever running again, so tasks of different priorities should
+ *   not share such calls without a critical section or a mutex around them.
+ * - A task should delete itself rather than be deleted by another task, as a
+ *   thread deleted while it is stopped exits with the locks it holds.
+ *----------------------------------------------------------*/
+
+/* Standard includes.  _GNU_SOURCE for pthread_setname_np(). */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define portNO_CRITICAL_NESTING 		( ( uint32_t ) 0 )
+
+/* The signal used to stop the thread of a task that is switched out by the
+tick. */
+#define portSIG_SUSPEND					SIGUSR1
+
+/* Nanoseconds per tick. */
+#define portTICK_PERIOD_NS				( 1000000000ULL / ( unsigned long long ) configTICK_RATE_HZ )
+
+/*
+ * Created when the scheduler is started, this thread uses a timerfd to
+ * simulate a tick interrupt being generated on an embedded target.  Timer
+ * expirations missed while the host did not run the thread are processed as
+ * ticks all at once, so the tick count follows the host clock.
+ */
+static void *prvSimulatedPeripheralTimer( void *pvParameters );
+
+/*
+ * The start routine of the thread of each task.  Waits until the task runs for
+ * the first time, then calls the task function.
+ */
+static void *prvTaskThread( void *pvParameters );
+
+/*
+ * Select the next task to run and switch to its thread, then wait until this
+ * thread is selected again.  Called by a task with the simulated interrupt mutex
+ * held and no critical section nesting, returns with the mutex released.
+ */
+static void prvSwitchThread( void );
+
+/*
+ * Block the calling thread until its task is selected to run, or until the task
+ * is deleted, in which case the thread exits.
+ */
+static void prvWaitToRun( void *pvThreadState );
+
+/*
+ * The handler of portSIG_SUSPEND, executed by the thread of a task that was
+ * stopped by the tick thread.
+ */
+static void prvSuspendSignalHandler( int lSignal );
+
+/*
+ * Stop the thread of a task with portSIG_SUSPEND, and return once it has
+ * stopped.  The thread runs again when its run semaphore is posted.
+ */
+static void prvSuspendThread( void *pvThreadState );
+
+/*-----------------------------------------------------------*/
+
+/* As in the Windows simulator, the task stack does not have to be managed
+directly, as the context switching is managed by the threads.  The task stack
+is still used to hold an xThreadState structure, which is the only thing it
+will ever hold.  The structure maps the task to the thread that executes it. */
+typedef struct
+{
+	/* The thread that executes the task. */
+	pthread_t xThread;
+
+	/* Posted when the task is selected to run. */
+	sem_t xRunSemaphore;
+
+	/* The task function and its parameter. */
+	TaskFunction_t pxCode;
+	void *pvParameters;
+
+	/* Set when the task has been deleted, so the thread exits when it is
+	woken instead of running the task. */
+	volatile BaseType_t xDeleted;
+
+} xThreadState;
+
+/* Mutex held while simulated interrupts are disabled, which is the case for
+the duration of every critical section and while the tick is processed. */
+static pthread_mutex_t xInterruptMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The critical nesting count.  Only the task in the Running state can be in a
+critical section, and no context switch happens while it is, so a single count
+serves all tasks.  It is initialised to a non-zero value so the tick is not
+processed during the initialisation phase. */
+static volatile uint32_t ulCriticalNesting = 9999UL;
+
+/* Set when a context switch was requested within a critical section, in which
+case it is performed when the critical section is left. */
+static volatile BaseType_t xPendingYield = pdFALSE;
+
+/* Set when a context switch was requested from the tick thread by
+portYIELD_FROM_ISR(). */
+static volatile BaseType_t xSwitchRequiredFromISR = pdFALSE;
+
+/* The tick thread, and the timerfd it waits on. */
+static pthread_t xTimerThread;
+static int lTimerFd = -1;
+
+/* The thread state of a task that the tick thread is stopping.  The handler
+of portSIG_SUSPEND acknowledges the stop with xSuspendedSemaphore before it
+waits to run again. */
+static xThreadState * volatile pxSuspendingThread = NULL;
+static sem_t xSuspendedSemaphore;
+
+/* Used by the idle task to sleep until the next tick. */
+static pthread_mutex_t xTickMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xTickCondition = PTHREAD_COND_INITIALIZER;
+static volatile uint32_t ulTicksProcessed = 0UL;
+
+/* Posted by vPortEndScheduler() to let xPortStartScheduler() return. */
+static sem_t xSchedulerEndSemaphore;
+
+/* Pointer to the TCB of the currently executing task. */
+extern void * volatile pxCurrentTCB;
+
+/* Used to ensure nothing is processed during the startup sequence. */
+static volatile BaseType_t xPortRunning = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+static xThreadState *prvGetThreadState( void *pvTCB )
+{
+	/* The first member of the TCB is the top of stack, which points to the
+	thread state. */
+	return ( xThreadState * ) *( ( size_t * ) pvTCB );
+}
+/*-----------------------------------------------------------*/
+
+StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters )
+{
+xThreadState *pxThreadState;
+size_t xTop = ( size_t ) pxTopOfStack;
+int lResult;
+
+	/* In this simulated case a stack is not initialised, but instead a thread
+	is created that will execute the task being created.  The xThreadState
+	object is placed onto the stack that was created for the task, so the stack
+	buffer is still used, just not in the conventional way. */
+	xTop -= sizeof( xThreadState );
+	xTop &= ~( ( size_t ) ( sizeof( void * ) * 2U ) - 1U );
+	pxThreadState = ( xThreadState * ) xTop;
+
+	pxThreadState->pxCode = pxCode;
+	pxThreadState->pvParameters = pvParameters;
+	pxThreadState->xDeleted = pdFALSE;
+	lResult = sem_init( &( pxThreadState->xRunSemaphore ), 0, 0 );
+	configASSERT( lResult == 0 );
+
+	/* The thread waits on xRunSemaphore until the task runs for the first
+	time. */
+	lResult = pthread_create( &( pxThreadState->xThread ), NULL, prvTaskThread, pxThreadState );
+	configASSERT( lResult == 0 );
+	( void ) lResult;
+
+	return ( StackType_t * ) pxThreadState;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortStartScheduler( void )
+{
+struct sigaction xAction;
+struct itimerspec xPeriod;
+xThreadState *pxThreadState;
+
+	/* The handler that stops the thread of a task switched out by the tick.
+	System calls of the task interrupted by it are restarted. */
+	memset( &xAction, 0, sizeof( xAction ) );
+	xAction.sa_handler = prvSuspendSignalHandler;
+	xAction.sa_flags = SA_RESTART;
+	sigemptyset( &( xAction.sa_mask ) );
+	if( sigaction( portSIG_SUSPEND, &xAction, NULL ) != 0 )
+	{
+		return pdFAIL;
+	}
+
+	if( ( sem_init( &xSuspendedSemaphore, 0, 0 ) != 0 ) || ( sem_init( &xSchedulerEndSemaphore, 0, 0 ) != 0 ) )
+	{
+		return pdFAIL;
+	}
+
+	lTimerFd = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC );
+	if( lTimerFd < 0 )
+	{
+		return pdFAIL;
+	}
+
+	xPeriod.it_interval.tv_sec = ( time_t ) ( portTICK_PERIOD_NS / 1000000000ULL );
+	xPeriod.it_interval.tv_nsec = ( long ) ( portTICK_PERIOD_NS % 1000000000ULL );
+	xPeriod.it_value = xPeriod.it_interval;
+
+	/* Interrupts were disabled by vTaskStartScheduler(). */
+	if( ulCriticalNesting != portNO_CRITICAL_NESTING )
+	{
+		ulCriticalNesting = portNO_CRITICAL_NESTING;
+		pthread_mutex_unlock( &xInterruptMutex );
+	}
+
+	xPortRunning = pdTRUE;
+
+	if( ( pthread_create( &xTimerThread, NULL, prvSimulatedPeripheralTimer, NULL ) != 0 ) ||
+		( timerfd_settime( lTimerFd, 0, &xPeriod, NULL ) != 0 ) )
+	{
+		xPortRunning = pdFALSE;
+		return pdFAIL;
+	}
+
+	/* Start the highest priority task by waking the thread stored in its
+	thread state structure. */
+	pxThreadState = prvGetThreadState( pxCurrentTCB );
+	sem_post( &( pxThreadState->xRunSemaphore ) );
+
+	/* Wait until vPortEndScheduler() is called. */
+	while( sem_wait( &xSchedulerEndSemaphore ) != 0 )
+	{
+	}
+
+	return 0;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvSimulatedPeripheralTimer( void *pvParameters )
+{
+uint64_t ullExpirations;
+xThreadState *pxOldThreadState, *pxNewThreadState;
+BaseType_t xSwitchRequired;
+sigset_t xSignals;
+
+	/* Just to prevent compiler warnings. */
+	( void ) pvParameters;
+
+	/* This thread sends portSIG_SUSPEND, so it never handles it itself. */
+	sigemptyset( &xSignals );
+	sigaddset( &xSignals, portSIG_SUSPEND );
+	pthread_sigmask( SIG_BLOCK, &xSignals, NULL );
+	( void ) pthread_setname_np( pthread_self(), "Tick" );
+
+	for( ;; )
+	{
+		if( read( lTimerFd, &ullExpirations, sizeof( ullExpirations ) ) != ( ssize_t ) sizeof( ullExpirations ) )
+		{
+			continue;
+		}
+
+		/* Simulate the tick interrupt, which can only be taken while
+		interrupts are enabled. */
+		pthread_mutex_lock( &xInterruptMutex );
+
+		if( xPortRunning == pdFALSE )
+		{
+			pthread_mutex_unlock( &xInterruptMutex );
+			break;
+		}
+
+		/* Stop the thread of the running task while the tick is processed, as
+		the tick interrupt would stop the task.  Outside of a critical section
+		the task may still be in the kernel, with the scheduler suspended or
+		about to suspend it, which is not safe to run alongside the tick. */
+		pxOldThreadState = prvGetThreadState( pxCurrentTCB );
+		prvSuspendThread( pxOldThreadState );
+
+		xSwitchRequired = pdFALSE;
+
+		while( ullExpirations > 0ULL )
+		{
+			if( xTaskIncrementTick() != pdFALSE )
+			{
+				xSwitchRequired = pdTRUE;
+			}
+
+			ullExpirations--;
+		}
+
+		if( xSwitchRequiredFromISR != pdFALSE )
+		{
+			xSwitchRequiredFromISR = pdFALSE;
+			xSwitchRequired = pdTRUE;
+		}
+
+		if( xSwitchRequired != pdFALSE )
+		{
+			/* Select the next task to run. */
+			vTaskSwitchContext();
+		}
+
+		/* Resume the running task, which is the task stopped above unless the
+		tick selected another one. */
+		pxNewThreadState = prvGetThreadState( pxCurrentTCB );
+		sem_post( &( pxNewThreadState->xRunSemaphore ) );
+
+		/* Wake the idle task if it is sleeping.  The idle task only holds the
+		tick mutex with the scheduler suspended, so it was not switched out and
+		releases the mutex once it runs again. */
+		pthread_mutex_lock( &xTickMutex );
+		ulTicksProcessed++;
+		pthread_cond_broadcast( &xTickCondition );
+		pthread_mutex_unlock( &xTickMutex );
+
+		pthread_mutex_unlock( &xInterruptMutex );
+	}
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSuspendThread( void *pvThreadState )
+{
+xThreadState *pxThreadState = ( xThreadState * ) pvThreadState;
+
+	pxSuspendingThread = pxThreadState;
+	pthread_kill( pxThreadState->xThread, portSIG_SUSPEND );
+
+	while( sem_wait( &xSuspendedSemaphore ) != 0 )
+	{
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvSuspendSignalHandler( int lSignal )
+{
+xThreadState *pxThreadState = pxSuspendingThread;
+int lErrno = errno;
+
+	( void ) lSignal;
+
+	/* Let the tick thread know this thread has stopped running the task,
+	then wait until the task is selected again. */
+	sem_post( &xSuspendedSemaphore );
+	prvWaitToRun( pxThreadState );
+
+	errno = lErrno;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvTaskThread( void *pvParameters )
+{
+xThreadState *pxThreadState = ( xThreadState * ) pvParameters;
+
+	prvWaitToRun( pxThreadState );
+
+	/* Name the thread after the task, so host tools such as top and gdb show
+	which task a thread runs. */
+	( void ) pthread_setname_np( pthread_self(), pcTaskGetName( NULL ) );
+
+	pxThreadState->pxCode( pxThreadState->pvParameters );
+
+	/* Tasks must not return from their implementing function. */
+	configASSERT( pdFALSE );
+	vTaskDelete( NULL );
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWaitToRun( void *pvThreadState )
+{
+xThreadState *pxThreadState = ( xThreadState * ) pvThreadState;
+
+	while( sem_wait( &( pxThreadState->xRunSemaphore ) ) != 0 )
+	{
+		/* Interrupted by a signal. */
+	}
+
+	if( pxThreadState->xDeleted != pdFALSE )
+	{
+		pthread_exit( NULL );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvSwitchThread( void )
+{
+xThreadState *pxOldThreadState, *pxNewThreadState;
+
+	pxOldThreadState = prvGetThreadState( pxCurrentTCB );
+
+	/* Select the next task to run. */
+	vTaskSwitchContext();
+
+	pxNewThreadState = prvGetThreadState( pxCurrentTCB );
+
+	if( pxOldThreadState != pxNewThreadState )
+	{
+		/* The new thread is woken before the mutex is released, so the tick
+		thread can't switch it out before it has been woken. */
+		sem_post( &( pxNewThreadState->xRunSemaphore ) );
+		pthread_mutex_unlock( &xInterruptMutex );
+
+		prvWaitToRun( pxOldThreadState );
+	}
+	else
+	{
+		pthread_mutex_unlock( &xInterruptMutex );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+	vPortEnterCritical();
+	xPendingYield = pdTRUE;
+	vPortExitCritical();
+}
+/*-----------------------------------------------------------*/
+
+void vPortYieldFromISR( void )
+{
+	if( pthread_equal( pthread_self(), xTimerThread ) != 0 )
+	{
+		/* Performed by the tick thread once the tick has been processed. */
+		xSwitchRequiredFromISR = pdTRUE;
+	}
+	else
+	{
+		/* Only the tick thread and the thread of the running task may call
+		FreeRTOS functions. */
+		configASSERT( pthread_equal( pthread_self(), prvGetThreadState( pxCurrentTCB )->xThread ) != 0 );
+		vPortYield();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortDeleteThread( void *pvTaskToDelete )
+{
+xThreadState *pxThreadState;
+
+	/* Find the thread of the task being deleted.  It is not running: it is
+	either waiting to run or, if the task deleted itself, about to wait. */
+	pxThreadState = prvGetThreadState( pvTaskToDelete );
+
+	/* Wake the thread so it exits, and wait until it has before the stack
+	holding the thread state is freed. */
+	pxThreadState->xDeleted = pdTRUE;
+	sem_post( &( pxThreadState->xRunSemaphore ) );
+	pthread_join( pxThreadState->xThread, NULL );
+	sem_destroy( &( pxThreadState->xRunSemaphore ) );
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+	/* Called by a task with interrupts disabled.  Stop the tick thread, which
+	exits when it takes the next tick. */
+	xPortRunning = pdFALSE;
+	ulCriticalNesting = portNO_CRITICAL_NESTING;
+	pthread_mutex_unlock( &xInterruptMutex );
+
+	/* Let xPortStartScheduler() return, and stop the calling task for good. */
+	sem_post( &xSchedulerEndSemaphore );
+
+	for( ;; )
+	{
+		pause();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+	/* The interrupt mutex is held for the entire critical section, effectively
+	disabling (simulated) interrupts. */
+	if( ulCriticalNesting == portNO_CRITICAL_NESTING )
+	{
+		pthread_mutex_lock( &xInterruptMutex );
+	}
+
+	ulCriticalNesting++;
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+	configASSERT( ulCriticalNesting > portNO_CRITICAL_NESTING );
+
+	ulCriticalNesting--;
+
+	if( ulCriticalNesting == portNO_CRITICAL_NESTING )
+	{
+		/* Was a context switch requested while interrupts were (simulated)
+		disabled? */
+		if( ( xPendingYield != pdFALSE ) && ( xPortRunning != pdFALSE ) )
+		{
+			xPendingYield = pdFALSE;
+
+			/* Releases the mutex. */
+			prvSwitchThread();
+		}
+		else
+		{
+			pthread_mutex_unlock( &xInterruptMutex );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+uint32_t ulTicks;
+
+	/* Called by the idle task with the scheduler suspended.  The tick is not
+	actually suppressed: the task sleeps until the next tick, after which the
+	kernel processes the tick as a pended tick. */
+	( void ) xExpectedIdleTime;
+
+	pthread_mutex_lock( &xTickMutex );
+	ulTicks = ulTicksProcessed;
+	pthread_mutex_unlock( &xTickMutex );
+
+	#if( configUSE_TICKLESS_IDLE != 0 )
+	{
+	eSleepModeStatus eSleepStatus;
+
+		/* Don't sleep if a task was readied from the tick hook. */
+		vPortEnterCritical();
+		eSleepStatus = eTaskConfirmSleepModeStatus();
+		vPortExitCritical();
+
+		if( eSleepStatus == eAbortSleep )
+		{
+			return;
+		}
+	}
+	#endif
+
+	pthread_mutex_lock( &xTickMutex );
+
+	while( ( ulTicks == ulTicksProcessed ) && ( xPortRunning != pdFALSE ) )
+	{
+		pthread_cond_wait( &xTickCondition, &xTickMutex );
+	}
+
+	pthread_mutex_unlock( &xTickMutex );
+}
+/*-----------------------------------------------------------*/
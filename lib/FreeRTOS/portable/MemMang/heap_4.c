@@ -70,6 +70,9 @@ typedef struct A_BLOCK_LINK
 {
 	struct A_BLOCK_LINK *pxNextFreeBlock;	/*<< The next free block in the list. */
 	size_t xBlockSize;						/*<< The size of the free block. */
+	#if( configUSE_HEAP_ACCOUNTING == 1 )
+		uint32_t ulHeapTag;					/*<< The task and the call site that allocated the block, from ulPortHeapAccountMalloc(). */
+	#endif
 } BlockLink_t;
 
 /*-----------------------------------------------------------*/
@@ -101,6 +104,8 @@ static BlockLink_t xStart, *pxEnd = NULL;
 fragmentation. */
 static size_t xFreeBytesRemaining = 0U;
 static size_t xMinimumEverFreeBytesRemaining = 0U;
+static size_t xNumberOfSuccessfulAllocations = 0U;
+static size_t xNumberOfSuccessfulFrees = 0U;
 
 /* Gets set to the top bit of an size_t type.  When this bit in the xBlockSize
 member of an BlockLink_t structure is set then the block belongs to the
@@ -114,6 +119,9 @@ void *pvPortMalloc( size_t xWantedSize )
 {
 BlockLink_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
 void *pvReturn = NULL;
+#if( configUSE_HEAP_ACCOUNTING == 1 )
+	const size_t xRequestedSize = xWantedSize;
+#endif
 
 	vTaskSuspendAll();
 	{
@@ -221,6 +229,13 @@ void *pvReturn = NULL;
 					by the application and has no "next" block. */
 					pxBlock->xBlockSize |= xBlockAllocatedBit;
 					pxBlock->pxNextFreeBlock = NULL;
+					xNumberOfSuccessfulAllocations++;
+
+					#if( configUSE_HEAP_ACCOUNTING == 1 )
+					{
+						pxBlock->ulHeapTag = ulPortHeapAccountMalloc( pvReturn, xRequestedSize, pxBlock->xBlockSize & ~xBlockAllocatedBit, portHEAP_CALL_SITE() );
+					}
+					#endif
 				}
 				else
 				{
@@ -291,7 +306,15 @@ BlockLink_t *pxLink;
 					/* Add this block to the list of free blocks. */
 					xFreeBytesRemaining += pxLink->xBlockSize;
 					traceFREE( pv, pxLink->xBlockSize );
+
+					#if( configUSE_HEAP_ACCOUNTING == 1 )
+					{
+						vPortHeapAccountFree( pv, pxLink->xBlockSize, pxLink->ulHeapTag );
+					}
+					#endif
+
 					prvInsertBlockIntoFreeList( ( ( BlockLink_t * ) pxLink ) );
+					xNumberOfSuccessfulFrees++;
 				}
 				( void ) xTaskResumeAll();
 			}
@@ -320,6 +343,45 @@ size_t xPortGetMinimumEverFreeHeapSize( void )
 }
 /*-----------------------------------------------------------*/
 
+void vPortGetHeapStats( HeapStats_t *pxHeapStats )
+{
+BlockLink_t *pxBlock;
+size_t xBlocks = 0, xMaxSize = 0, xMinSize = 0;
+
+	vTaskSuspendAll();
+	{
+		/* pxEnd is NULL until the first allocation initialises the heap. */
+		if( pxEnd != NULL )
+		{
+			/* Walk the list of free blocks. */
+			for( pxBlock = xStart.pxNextFreeBlock; pxBlock != pxEnd; pxBlock = pxBlock->pxNextFreeBlock )
+			{
+				if( ( xBlocks == 0 ) || ( pxBlock->xBlockSize < xMinSize ) )
+				{
+					xMinSize = pxBlock->xBlockSize;
+				}
+
+				if( pxBlock->xBlockSize > xMaxSize )
+				{
+					xMaxSize = pxBlock->xBlockSize;
+				}
+
+				xBlocks++;
+			}
+		}
+
+		pxHeapStats->xAvailableHeapSpaceInBytes = xFreeBytesRemaining;
+		pxHeapStats->xSizeOfLargestFreeBlockInBytes = xMaxSize;
+		pxHeapStats->xSizeOfSmallestFreeBlockInBytes = xMinSize;
+		pxHeapStats->xNumberOfFreeBlocks = xBlocks;
+		pxHeapStats->xMinimumEverFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+		pxHeapStats->xNumberOfSuccessfulAllocations = xNumberOfSuccessfulAllocations;
+		pxHeapStats->xNumberOfSuccessfulFrees = xNumberOfSuccessfulFrees;
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
 void vPortInitialiseBlocks( void )
 {
 	/* This just exists to keep the linker quiet. */
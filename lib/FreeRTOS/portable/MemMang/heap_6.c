@@ -0,0 +1,755 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * A sample implementation of pvPortMalloc() and vPortFree() that take a
+ * constant time, however many blocks are allocated or free.  Like heap_5.c,
+ * the heap can be defined across multiple non-contiguous regions, and adjacent
+ * memory blocks are combined (coalesced) as they are freed.
+ *
+ * heap_4.c and heap_5.c keep the free blocks in a single list in address
+ * order, which pvPortMalloc() searches for the first block that is large
+ * enough and vPortFree() searches for the place to insert the freed block.
+ * Both take longer the more free blocks there are, and the scheduler is
+ * suspended for all of that time.  This implementation is a two-level
+ * segregated fit (TLSF) allocator instead: free blocks are kept in lists of
+ * blocks of similar size, and a bit map of the lists that are not empty finds
+ * a list whose blocks are all large enough with two bit scans.  Each block
+ * records the block in front of it in memory, so vPortFree() finds the blocks
+ * to combine with without a search.
+ *
+ * The first level of lists divides the block sizes in powers of two, the
+ * second level divides each power of two in heapSL_INDEX_COUNT lists of equal
+ * width.  pvPortMalloc() takes the first block of the list the size maps to if
+ * it is large enough.  Otherwise it rounds the size up to the next list boundary,
+ * so it can take the first block of the first list that isn't empty.  The part
+ * of the block that isn't needed is split off.  The block is at most
+ * 1 / heapSL_INDEX_COUNT larger than the list boundary, which bounds the waste
+ * of this good fit compared with the best fit.
+ *
+ * See heap_1.c, heap_2.c, heap_3.c, heap_4.c and heap_5.c for alternative
+ * implementations, and the memory management pages of http://www.FreeRTOS.org
+ * for more information.
+ *
+ * Usage notes:
+ *
+ * vPortDefineHeapRegions() ***must*** be called before pvPortMalloc(), as with
+ * heap_5.c, and takes the same array of HeapRegion_t structures terminated by
+ * a NULL zero sized region.  Unlike heap_5.c the regions can be given in any
+ * order.  A block can't be larger than heapMAX_BLOCK_SIZE, so a larger region
+ * is added to the heap as several blocks.
+ *
+ * vPortGetHeapStats() reports the free blocks in addition to the free space,
+ * from which the fragmentation of the heap can be seen.
+ */
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
+	#error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
+#endif
+
+/* Assumes 8bit bytes! */
+#define heapBITS_PER_BYTE		( ( size_t ) 8 )
+
+/* The number of second level lists in each power of two. */
+#define heapSL_INDEX_COUNT_LOG2	( 4U )
+#define heapSL_INDEX_COUNT		( 1U << heapSL_INDEX_COUNT_LOG2 )
+
+/* Blocks are smaller than 2 ^ heapFL_INDEX_MAX bytes.  Each power of two costs
+heapSL_INDEX_COUNT list heads, so this is not larger than it needs to be for the
+heaps of microcontrollers. */
+#define heapFL_INDEX_MAX		( 24U )
+#define heapMAX_BLOCK_SIZE		( ( ( ( size_t ) 1 ) << heapFL_INDEX_MAX ) - ( size_t ) portBYTE_ALIGNMENT )
+
+/* Block sizes are multiples of portBYTE_ALIGNMENT, so the blocks smaller than
+heapSMALL_BLOCK_SIZE are kept in the heapSL_INDEX_COUNT lists of the first first
+level list, one per size.  Each power of two from there on has a first level
+list of its own. */
+#if( portBYTE_ALIGNMENT == 32 )
+	#define heapALIGNMENT_LOG2	( 5U )
+#elif( portBYTE_ALIGNMENT == 16 )
+	#define heapALIGNMENT_LOG2	( 4U )
+#elif( portBYTE_ALIGNMENT == 8 )
+	#define heapALIGNMENT_LOG2	( 3U )
+#elif( portBYTE_ALIGNMENT == 4 )
+	#define heapALIGNMENT_LOG2	( 2U )
+#elif( portBYTE_ALIGNMENT == 2 )
+	#define heapALIGNMENT_LOG2	( 1U )
+#else
+	#define heapALIGNMENT_LOG2	( 0U )
+#endif
+
+#define heapFL_INDEX_SHIFT		( heapSL_INDEX_COUNT_LOG2 + heapALIGNMENT_LOG2 )
+#define heapFL_INDEX_COUNT		( heapFL_INDEX_MAX - heapFL_INDEX_SHIFT + 1U )
+#define heapSMALL_BLOCK_SIZE	( ( ( size_t ) 1 ) << heapFL_INDEX_SHIFT )
+
+#if( heapFL_INDEX_COUNT > 31U )
+	#error The first level bit map of heap_6.c holds less than 32 lists.
+#endif
+
+/* Define the block header.  The members up to the free list links are kept in
+front of every block.  The free list links are only used while the block is free, and are in
+the space returned to the application while it is allocated. */
+typedef struct A_BLOCK_LINK
+{
+	struct A_BLOCK_LINK *pxPreviousPhysicalBlock;	/*<< The block in front of this one in memory, or NULL for the first block of a region. */
+	size_t xBlockSize;								/*<< The size of the block, including the header.  The top bit is set while the block is allocated. */
+	#if( configUSE_HEAP_ACCOUNTING == 1 )
+		uint32_t ulHeapTag;							/*<< The task and the call site that allocated the block, from ulPortHeapAccountMalloc(). */
+	#endif
+	struct A_BLOCK_LINK *pxNextFreeBlock;			/*<< The next block in the same free list. */
+	struct A_BLOCK_LINK *pxPreviousFreeBlock;		/*<< The previous block in the same free list. */
+} BlockLink_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Returns the index of the highest and of the lowest bit set in ulValue, which
+ * must not be 0.
+ */
+static UBaseType_t prvHighestBit( uint32_t ulValue );
+static UBaseType_t prvLowestBit( uint32_t ulValue );
+
+/*
+ * Calculates the first and second level index of the free list that holds
+ * blocks of xBlockSize bytes.
+ */
+static void prvMapBlockSize( size_t xBlockSize, UBaseType_t *puxFirstLevel, UBaseType_t *puxSecondLevel );
+
+/*
+ * Finds a free block of at least xBlockSize bytes and takes it out of its free
+ * list, or returns NULL if there is none.
+ */
+static BlockLink_t *prvTakeSuitableBlock( size_t xBlockSize );
+
+/*
+ * Adds a free block to the free list for its size, and takes it out again.
+ */
+static void prvInsertBlockIntoFreeList( BlockLink_t *pxBlockToInsert );
+static void prvRemoveBlockFromFreeList( BlockLink_t *pxBlockToRemove );
+
+/*-----------------------------------------------------------*/
+
+/* The size of the part of the header kept in front of an allocated block must
+be correctly byte aligned. */
+static const size_t xHeapStructSize	= ( offsetof( BlockLink_t, pxNextFreeBlock ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* A free block must hold the whole header. */
+static const size_t xMinimumBlockSize = ( sizeof( BlockLink_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* The free lists, and bit maps of the lists that are not empty.  Bit n of
+ulFirstLevelBitMap is set if any bit of ulSecondLevelBitMap[ n ] is set. */
+static BlockLink_t *pxFreeLists[ heapFL_INDEX_COUNT ][ heapSL_INDEX_COUNT ];
+static uint32_t ulFirstLevelBitMap = 0U;
+static uint32_t ulSecondLevelBitMap[ heapFL_INDEX_COUNT ];
+
+/* Keeps track of the free bytes remaining and of the free blocks. */
+static size_t xFreeBytesRemaining = 0U;
+static size_t xMinimumEverFreeBytesRemaining = 0U;
+static size_t xNumberOfFreeBlocks = 0U;
+static size_t xNumberOfSuccessfulAllocations = 0U;
+static size_t xNumberOfSuccessfulFrees = 0U;
+
+/* Gets set to the top bit of an size_t type.  When this bit in the xBlockSize
+member of an BlockLink_t structure is set then the block belongs to the
+application.  When the bit is free the block is still part of the free heap
+space. */
+static size_t xBlockAllocatedBit = 0;
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+BlockLink_t *pxBlock, *pxNewBlockLink, *pxNextBlock;
+void *pvReturn = NULL;
+#if( configUSE_HEAP_ACCOUNTING == 1 )
+	const size_t xRequestedSize = xWantedSize;
+#endif
+
+	/* The heap must be initialised before the first call to
+	pvPortMalloc(). */
+	configASSERT( xBlockAllocatedBit );
+
+	vTaskSuspendAll();
+	{
+		/* Check the requested block size is not larger than the largest block,
+		which also keeps the block size from overflowing. */
+		if( ( xWantedSize > 0 ) && ( xWantedSize <= ( heapMAX_BLOCK_SIZE - xHeapStructSize ) ) )
+		{
+			/* The wanted size is increased so it can contain the block header
+			in addition to the requested amount of bytes, and aligned. */
+			xWantedSize += xHeapStructSize;
+
+			if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+			{
+				/* Byte alignment required. */
+				xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* The block has to hold the free list links once it is freed. */
+			if( xWantedSize < xMinimumBlockSize )
+			{
+				xWantedSize = xMinimumBlockSize;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			pxBlock = prvTakeSuitableBlock( xWantedSize );
+
+			if( pxBlock != NULL )
+			{
+				/* If the block is larger than required it can be split into
+				two.  The block after the new block now follows the new one. */
+				if( ( pxBlock->xBlockSize - xWantedSize ) >= xMinimumBlockSize )
+				{
+					pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+					pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xWantedSize;
+					pxNewBlockLink->pxPreviousPhysicalBlock = pxBlock;
+					pxBlock->xBlockSize = xWantedSize;
+
+					pxNextBlock = ( void * ) ( ( ( uint8_t * ) pxNewBlockLink ) + pxNewBlockLink->xBlockSize );
+					pxNextBlock->pxPreviousPhysicalBlock = pxNewBlockLink;
+
+					prvInsertBlockIntoFreeList( pxNewBlockLink );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				xFreeBytesRemaining -= pxBlock->xBlockSize;
+
+				if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				{
+					xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* The block is being returned - it is allocated and owned by
+				the application. */
+				pxBlock->xBlockSize |= xBlockAllocatedBit;
+				xNumberOfSuccessfulAllocations++;
+
+				pvReturn = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xHeapStructSize );
+
+				#if( configUSE_HEAP_ACCOUNTING == 1 )
+				{
+					pxBlock->ulHeapTag = ulPortHeapAccountMalloc( pvReturn, xRequestedSize, pxBlock->xBlockSize & ~xBlockAllocatedBit, portHEAP_CALL_SITE() );
+				}
+				#endif
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		traceMALLOC( pvReturn, xWantedSize );
+	}
+	( void ) xTaskResumeAll();
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	configASSERT( ( ( ( size_t ) pvReturn ) & ( size_t ) portBYTE_ALIGNMENT_MASK ) == 0 );
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+uint8_t *puc = ( uint8_t * ) pv;
+BlockLink_t *pxLink, *pxPreviousBlock, *pxNextBlock;
+
+	if( pv != NULL )
+	{
+		/* The memory being freed will have the block header immediately
+		before it. */
+		puc -= xHeapStructSize;
+
+		/* This casting is to keep the compiler from issuing warnings. */
+		pxLink = ( void * ) puc;
+
+		/* Check the block is actually allocated. */
+		configASSERT( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 );
+
+		if( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 )
+		{
+			vTaskSuspendAll();
+			{
+				/* The block is being returned to the heap - it is no longer
+				allocated. */
+				pxLink->xBlockSize &= ~xBlockAllocatedBit;
+				xFreeBytesRemaining += pxLink->xBlockSize;
+				xNumberOfSuccessfulFrees++;
+				traceFREE( pv, pxLink->xBlockSize );
+
+				#if( configUSE_HEAP_ACCOUNTING == 1 )
+				{
+					vPortHeapAccountFree( pv, pxLink->xBlockSize, pxLink->ulHeapTag );
+				}
+				#endif
+
+				/* Combine the block with the block in front of it if that is
+				free.  The end marker of each region is allocated, so there is
+				always a block after this one. */
+				pxPreviousBlock = pxLink->pxPreviousPhysicalBlock;
+
+				if( ( pxPreviousBlock != NULL ) &&
+					( ( pxPreviousBlock->xBlockSize & xBlockAllocatedBit ) == 0 ) &&
+					( ( pxPreviousBlock->xBlockSize + pxLink->xBlockSize ) <= heapMAX_BLOCK_SIZE ) )
+				{
+					prvRemoveBlockFromFreeList( pxPreviousBlock );
+					pxPreviousBlock->xBlockSize += pxLink->xBlockSize;
+					pxLink = pxPreviousBlock;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* And with the block after it. */
+				pxNextBlock = ( void * ) ( ( ( uint8_t * ) pxLink ) + pxLink->xBlockSize );
+
+				if( ( ( pxNextBlock->xBlockSize & xBlockAllocatedBit ) == 0 ) &&
+					( ( pxLink->xBlockSize + pxNextBlock->xBlockSize ) <= heapMAX_BLOCK_SIZE ) )
+				{
+					prvRemoveBlockFromFreeList( pxNextBlock );
+					pxLink->xBlockSize += pxNextBlock->xBlockSize;
+					pxNextBlock = ( void * ) ( ( ( uint8_t * ) pxLink ) + pxLink->xBlockSize );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				pxNextBlock->pxPreviousPhysicalBlock = pxLink;
+				prvInsertBlockIntoFreeList( pxLink );
+			}
+			( void ) xTaskResumeAll();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t *pxHeapStats )
+{
+BlockLink_t *pxBlock;
+UBaseType_t uxFirstLevel, uxSecondLevel;
+size_t xMaxSize = 0, xMinSize = 0;
+
+	vTaskSuspendAll();
+	{
+		/* The largest free block is in the highest list that isn't empty, and
+		the smallest in the lowest, so only those two lists are searched. */
+		if( ulFirstLevelBitMap != 0U )
+		{
+			uxFirstLevel = prvHighestBit( ulFirstLevelBitMap );
+			uxSecondLevel = prvHighestBit( ulSecondLevelBitMap[ uxFirstLevel ] );
+
+			for( pxBlock = pxFreeLists[ uxFirstLevel ][ uxSecondLevel ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+			{
+				if( pxBlock->xBlockSize > xMaxSize )
+				{
+					xMaxSize = pxBlock->xBlockSize;
+				}
+			}
+
+			uxFirstLevel = prvLowestBit( ulFirstLevelBitMap );
+			uxSecondLevel = prvLowestBit( ulSecondLevelBitMap[ uxFirstLevel ] );
+			xMinSize = xMaxSize;
+
+			for( pxBlock = pxFreeLists[ uxFirstLevel ][ uxSecondLevel ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+			{
+				if( pxBlock->xBlockSize < xMinSize )
+				{
+					xMinSize = pxBlock->xBlockSize;
+				}
+			}
+		}
+
+		pxHeapStats->xAvailableHeapSpaceInBytes = xFreeBytesRemaining;
+		pxHeapStats->xSizeOfLargestFreeBlockInBytes = xMaxSize;
+		pxHeapStats->xSizeOfSmallestFreeBlockInBytes = xMinSize;
+		pxHeapStats->xNumberOfFreeBlocks = xNumberOfFreeBlocks;
+		pxHeapStats->xMinimumEverFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+		pxHeapStats->xNumberOfSuccessfulAllocations = xNumberOfSuccessfulAllocations;
+		pxHeapStats->xNumberOfSuccessfulFrees = xNumberOfSuccessfulFrees;
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvHighestBit( uint32_t ulValue )
+{
+UBaseType_t uxBit;
+
+	#if defined( __GNUC__ )
+	{
+		uxBit = ( UBaseType_t ) ( 31 - __builtin_clz( ulValue ) );
+	}
+	#else
+	{
+	UBaseType_t uxShift;
+
+		/* A binary search, which takes the same five steps for any value. */
+		uxBit = 0U;
+
+		for( uxShift = 16U; uxShift > 0U; uxShift >>= 1 )
+		{
+			if( ( ulValue >> uxShift ) != 0U )
+			{
+				ulValue >>= uxShift;
+				uxBit += uxShift;
+			}
+		}
+	}
+	#endif
+
+	return uxBit;
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvLowestBit( uint32_t ulValue )
+{
+	/* Only the lowest bit remains set in ulValue & -ulValue. */
+	return prvHighestBit( ulValue & ( ~ulValue + 1U ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvMapBlockSize( size_t xBlockSize, UBaseType_t *puxFirstLevel, UBaseType_t *puxSecondLevel )
+{
+UBaseType_t uxBit;
+
+	if( xBlockSize < heapSMALL_BLOCK_SIZE )
+	{
+		/* One list per size. */
+		*puxFirstLevel = 0U;
+		*puxSecondLevel = ( UBaseType_t ) ( xBlockSize >> heapALIGNMENT_LOG2 );
+	}
+	else
+	{
+		/* The bits below the highest bit set select the second level list.
+		The highest bit itself is removed by the exclusive or. */
+		uxBit = prvHighestBit( ( uint32_t ) xBlockSize );
+		*puxFirstLevel = uxBit - ( heapFL_INDEX_SHIFT - 1U );
+		*puxSecondLevel = ( UBaseType_t ) ( ( xBlockSize >> ( uxBit - heapSL_INDEX_COUNT_LOG2 ) ) ^ heapSL_INDEX_COUNT );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static BlockLink_t *prvTakeSuitableBlock( size_t xBlockSize )
+{
+BlockLink_t *pxBlock = NULL;
+UBaseType_t uxFirstLevel, uxSecondLevel;
+uint32_t ulBitMap;
+
+	if( xBlockSize >= heapSMALL_BLOCK_SIZE )
+	{
+		/* The first block of the list the size maps to may be large enough,
+		which keeps the larger blocks whole.  Otherwise round the size up to
+		the next list boundary, so every block in the list it maps to is large
+		enough. */
+		prvMapBlockSize( xBlockSize, &uxFirstLevel, &uxSecondLevel );
+		pxBlock = pxFreeLists[ uxFirstLevel ][ uxSecondLevel ];
+
+		if( ( pxBlock != NULL ) && ( pxBlock->xBlockSize >= xBlockSize ) )
+		{
+			prvRemoveBlockFromFreeList( pxBlock );
+		}
+		else
+		{
+			pxBlock = NULL;
+			xBlockSize += ( ( ( size_t ) 1 ) << ( prvHighestBit( ( uint32_t ) xBlockSize ) - heapSL_INDEX_COUNT_LOG2 ) ) - 1U;
+		}
+	}
+	else
+	{
+		/* Every block in the list of a small size has that size. */
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( ( pxBlock == NULL ) && ( xBlockSize <= heapMAX_BLOCK_SIZE ) )
+	{
+		prvMapBlockSize( xBlockSize, &uxFirstLevel, &uxSecondLevel );
+
+		/* Look for a list that isn't empty in this power of two first, and
+		then in the next power of two that has one. */
+		ulBitMap = ulSecondLevelBitMap[ uxFirstLevel ] & ( ~0UL << uxSecondLevel );
+
+		if( ulBitMap == 0U )
+		{
+			ulBitMap = ulFirstLevelBitMap & ( uint32_t ) ( ~0UL << ( uxFirstLevel + 1U ) );
+
+			if( ulBitMap != 0U )
+			{
+				uxFirstLevel = prvLowestBit( ulBitMap );
+				ulBitMap = ulSecondLevelBitMap[ uxFirstLevel ];
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		if( ulBitMap != 0U )
+		{
+			uxSecondLevel = prvLowestBit( ulBitMap );
+			pxBlock = pxFreeLists[ uxFirstLevel ][ uxSecondLevel ];
+			prvRemoveBlockFromFreeList( pxBlock );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return pxBlock;
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertBlockIntoFreeList( BlockLink_t *pxBlockToInsert )
+{
+UBaseType_t uxFirstLevel, uxSecondLevel;
+BlockLink_t *pxHead;
+
+	prvMapBlockSize( pxBlockToInsert->xBlockSize, &uxFirstLevel, &uxSecondLevel );
+
+	pxHead = pxFreeLists[ uxFirstLevel ][ uxSecondLevel ];
+	pxBlockToInsert->pxNextFreeBlock = pxHead;
+	pxBlockToInsert->pxPreviousFreeBlock = NULL;
+
+	if( pxHead != NULL )
+	{
+		pxHead->pxPreviousFreeBlock = pxBlockToInsert;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	pxFreeLists[ uxFirstLevel ][ uxSecondLevel ] = pxBlockToInsert;
+	ulFirstLevelBitMap |= 1UL << uxFirstLevel;
+	ulSecondLevelBitMap[ uxFirstLevel ] |= 1UL << uxSecondLevel;
+	xNumberOfFreeBlocks++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveBlockFromFreeList( BlockLink_t *pxBlockToRemove )
+{
+UBaseType_t uxFirstLevel, uxSecondLevel;
+
+	prvMapBlockSize( pxBlockToRemove->xBlockSize, &uxFirstLevel, &uxSecondLevel );
+
+	if( pxBlockToRemove->pxNextFreeBlock != NULL )
+	{
+		pxBlockToRemove->pxNextFreeBlock->pxPreviousFreeBlock = pxBlockToRemove->pxPreviousFreeBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( pxBlockToRemove->pxPreviousFreeBlock != NULL )
+	{
+		pxBlockToRemove->pxPreviousFreeBlock->pxNextFreeBlock = pxBlockToRemove->pxNextFreeBlock;
+	}
+	else
+	{
+		/* The block was the head of its list.  Clear the bits of the list if
+		it is empty now. */
+		pxFreeLists[ uxFirstLevel ][ uxSecondLevel ] = pxBlockToRemove->pxNextFreeBlock;
+
+		if( pxBlockToRemove->pxNextFreeBlock == NULL )
+		{
+			ulSecondLevelBitMap[ uxFirstLevel ] &= ~( 1UL << uxSecondLevel );
+
+			if( ulSecondLevelBitMap[ uxFirstLevel ] == 0U )
+			{
+				ulFirstLevelBitMap &= ~( 1UL << uxFirstLevel );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+	xNumberOfFreeBlocks--;
+}
+/*-----------------------------------------------------------*/
+
+void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions )
+{
+BlockLink_t *pxBlock, *pxPreviousBlock, *pxEnd;
+size_t xAddress, xEndAddress, xBlockSize;
+size_t xTotalHeapSize = 0;
+BaseType_t xDefinedRegions = 0;
+const HeapRegion_t *pxHeapRegion;
+
+	/* Can only call once! */
+	configASSERT( xBlockAllocatedBit == 0 );
+
+	/* Work out the position of the top bit in a size_t variable. */
+	xBlockAllocatedBit = ( ( size_t ) 1 ) << ( ( sizeof( size_t ) * heapBITS_PER_BYTE ) - 1 );
+
+	pxHeapRegion = &( pxHeapRegions[ xDefinedRegions ] );
+
+	while( pxHeapRegion->xSizeInBytes > 0 )
+	{
+		/* Ensure the heap region starts and ends on a correctly aligned
+		boundary. */
+		xAddress = ( size_t ) pxHeapRegion->pucStartAddress;
+		xEndAddress = xAddress + pxHeapRegion->xSizeInBytes;
+		xAddress += ( portBYTE_ALIGNMENT - 1 );
+		xAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+		xEndAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+		/* The end marker of the region takes the header of an allocated block,
+		so the next block of the last block of the region is never free. */
+		if( ( xEndAddress > xAddress ) && ( ( xEndAddress - xAddress ) >= ( xMinimumBlockSize + xHeapStructSize ) ) )
+		{
+			xEndAddress -= xHeapStructSize;
+			pxPreviousBlock = NULL;
+
+			/* The region is a single free block, or several if it is larger
+			than the largest block. */
+			while( xAddress < xEndAddress )
+			{
+				xBlockSize = xEndAddress - xAddress;
+
+				if( xBlockSize > heapMAX_BLOCK_SIZE )
+				{
+					xBlockSize = heapMAX_BLOCK_SIZE;
+
+					/* Don't leave a remainder too small to be a block. */
+					if( ( xEndAddress - xAddress - xBlockSize ) < xMinimumBlockSize )
+					{
+						xBlockSize -= xMinimumBlockSize;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				pxBlock = ( BlockLink_t * ) xAddress;
+				pxBlock->xBlockSize = xBlockSize;
+				pxBlock->pxPreviousPhysicalBlock = pxPreviousBlock;
+				prvInsertBlockIntoFreeList( pxBlock );
+
+				xTotalHeapSize += xBlockSize;
+				xAddress += xBlockSize;
+				pxPreviousBlock = pxBlock;
+			}
+
+			pxEnd = ( BlockLink_t * ) xEndAddress;
+			pxEnd->xBlockSize = xBlockAllocatedBit;
+			pxEnd->pxPreviousPhysicalBlock = pxPreviousBlock;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		/* Move onto the next HeapRegion_t structure. */
+		xDefinedRegions++;
+		pxHeapRegion = &( pxHeapRegions[ xDefinedRegions ] );
+	}
+
+	xMinimumEverFreeBytesRemaining = xTotalHeapSize;
+	xFreeBytesRemaining = xTotalHeapSize;
+
+	/* Check something was actually defined before it is accessed. */
+	configASSERT( xTotalHeapSize );
+}
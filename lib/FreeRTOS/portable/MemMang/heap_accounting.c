@@ -0,0 +1,421 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * Heap accounting for heap_4.c and heap_6.c, built with them when
+ * configUSE_HEAP_ACCOUNTING is set to 1 in FreeRTOSConfig.h.
+ *
+ * Every block the heap allocates is tagged with the task that allocated it and
+ * the call site of pvPortMalloc() it was allocated from, as returned by
+ * portHEAP_CALL_SITE().  The heap in use by each task and by each call site is
+ * kept, with the peak of each, and every allocation and free is recorded into a
+ * buffer of compact events for the application to read and send on, from which
+ * the use of the heap can be followed over time on a host.
+ *
+ * Both tables are of a fixed size.  The task table is searched, starting with
+ * the task found last, and the call site table is hashed.  The entries of the
+ * block are kept in its header, so a free finds them without a search.  The
+ * entry of a task is kept after the task is deleted, which is seen when its TCB
+ * is freed, until all the blocks it allocated have been freed too.  Only blocks
+ * of the size of a TCB are looked for in the task table when they are freed.
+ */
+#include <string.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configUSE_HEAP_ACCOUNTING == 1 )
+
+#if( ( INCLUDE_xTaskGetCurrentTaskHandle == 0 ) && ( configUSE_MUTEXES == 0 ) )
+	#error Heap accounting needs xTaskGetCurrentTaskHandle(), so INCLUDE_xTaskGetCurrentTaskHandle must be set to 1.
+#endif
+
+#if( ( INCLUDE_xTaskGetSchedulerState == 0 ) && ( configUSE_TIMERS == 0 ) )
+	#error Heap accounting needs xTaskGetSchedulerState(), so INCLUDE_xTaskGetSchedulerState must be set to 1.
+#endif
+
+#if( ( configHEAP_ACCOUNTING_MAX_TASKS < 2 ) || ( configHEAP_ACCOUNTING_MAX_TASKS > 0xffff ) )
+	#error configHEAP_ACCOUNTING_MAX_TASKS must be from 2 to 65535.
+#endif
+
+#if( ( configHEAP_ACCOUNTING_MAX_CALL_SITES < 2 ) || ( configHEAP_ACCOUNTING_MAX_CALL_SITES > 0x7fff ) )
+	#error configHEAP_ACCOUNTING_MAX_CALL_SITES must be from 2 to 32767.
+#endif
+
+/* The task and the call site of a block are kept in its header as one value,
+with a bit that is set if the block has the size of a TCB, so could be the TCB
+of a task in the task table. */
+#define heapTAG_TCB_SIZED				( ( uint32_t ) 0x8000UL )
+#define heapTAG( uxTask, uxCallSite )	( ( ( uint32_t ) ( uxTask ) << 16 ) | ( uint32_t ) ( uxCallSite ) )
+#define heapTAG_TASK( ulTag )			( ( UBaseType_t ) ( ( ulTag ) >> 16 ) )
+#define heapTAG_CALL_SITE( ulTag )		( ( UBaseType_t ) ( ( ulTag ) & 0x7fffUL ) )
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Return the entry of the calling task, which is added to the table if it is
+ * not in it yet.  Entry 0 is returned before the scheduler is started and when
+ * the table is full.
+ */
+static UBaseType_t prvGetTaskEntry( void );
+
+/*
+ * Return the entry of the call site, which is added to the table if it is not
+ * in it yet.  Entry 0 is returned when the table is full.
+ */
+static UBaseType_t prvGetCallSiteEntry( const void *pvCallSite );
+
+#if( configHEAP_ACCOUNTING_EVENT_COUNT > 0 )
+	/*
+	 * Add an event to the event buffer, or count it as dropped if the buffer
+	 * is full.
+	 */
+	static void prvRecordEvent( const void *pvAddress, uint32_t ulSize, uint32_t ulTag );
+#endif
+
+/*-----------------------------------------------------------*/
+
+/* The heap in use by each task and call site.  They are only accessed with the
+scheduler suspended. */
+static HeapTaskUsage_t xTaskUsage[ configHEAP_ACCOUNTING_MAX_TASKS ];
+static HeapCallSiteUsage_t xCallSiteUsage[ configHEAP_ACCOUNTING_MAX_CALL_SITES ];
+
+/* The task that allocated last, and its entry, which saves the search of the
+task table while a task allocates several blocks. */
+static void *pvLastTask = NULL;
+static UBaseType_t uxLastTaskEntry = 0;
+
+#if( configHEAP_ACCOUNTING_EVENT_COUNT > 0 )
+	/* The events not read yet are the uxEventCount events from uxEventHead,
+	which wrap around the end of the buffer. */
+	static HeapEvent_t xEvents[ configHEAP_ACCOUNTING_EVENT_COUNT ];
+	static UBaseType_t uxEventHead = 0, uxEventCount = 0;
+	static uint32_t ulEventsDropped = 0;
+#endif
+
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvGetTaskEntry( void )
+{
+void *pvTask;
+UBaseType_t uxEntry, uxFreeEntry = 0;
+
+	if( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED )
+	{
+		return 0;
+	}
+
+	pvTask = ( void * ) xTaskGetCurrentTaskHandle();
+
+	if( pvTask == pvLastTask )
+	{
+		return uxLastTaskEntry;
+	}
+
+	for( uxEntry = 1; uxEntry < ( UBaseType_t ) configHEAP_ACCOUNTING_MAX_TASKS; uxEntry++ )
+	{
+		if( xTaskUsage[ uxEntry ].pvTask == pvTask )
+		{
+			break;
+		}
+		else if( ( uxFreeEntry == 0 ) && ( xTaskUsage[ uxEntry ].pvTask == NULL ) && ( xTaskUsage[ uxEntry ].xLiveBytes == 0 ) )
+		{
+			/* Never used, or used by a deleted task whose blocks have all
+			been freed. */
+			uxFreeEntry = uxEntry;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+	if( uxEntry == ( UBaseType_t ) configHEAP_ACCOUNTING_MAX_TASKS )
+	{
+		uxEntry = uxFreeEntry;
+
+		if( uxEntry != 0 )
+		{
+			xTaskUsage[ uxEntry ].pvTask = pvTask;
+			strncpy( xTaskUsage[ uxEntry ].pcTaskName, pcTaskGetName( NULL ), configMAX_TASK_NAME_LEN - 1 );
+			xTaskUsage[ uxEntry ].pcTaskName[ configMAX_TASK_NAME_LEN - 1 ] = '\0';
+			xTaskUsage[ uxEntry ].xPeakBytes = 0;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	pvLastTask = pvTask;
+	uxLastTaskEntry = uxEntry;
+
+	return uxEntry;
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvGetCallSiteEntry( const void *pvCallSite )
+{
+UBaseType_t uxEntry, uxProbes;
+const UBaseType_t uxSlots = ( UBaseType_t ) configHEAP_ACCOUNTING_MAX_CALL_SITES - 1;
+
+	/* The call sites are hashed into entries 1 onwards, and the next entry is
+	tried while the entry is taken by another call site.  Return addresses are
+	at least 2 byte aligned, so the lowest bit carries nothing. */
+	uxEntry = ( UBaseType_t ) ( ( ( size_t ) pvCallSite >> 1 ) % uxSlots ) + 1;
+
+	for( uxProbes = 0; uxProbes < uxSlots; uxProbes++ )
+	{
+		if( xCallSiteUsage[ uxEntry ].pvCallSite == pvCallSite )
+		{
+			return uxEntry;
+		}
+		else if( xCallSiteUsage[ uxEntry ].pvCallSite == NULL )
+		{
+			xCallSiteUsage[ uxEntry ].pvCallSite = pvCallSite;
+			return uxEntry;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		uxEntry = ( uxEntry == uxSlots ) ? 1 : ( uxEntry + 1 );
+	}
+
+	return 0;
+}
+/*-----------------------------------------------------------*/
+
+#if( configHEAP_ACCOUNTING_EVENT_COUNT > 0 )
+
+	static void prvRecordEvent( const void *pvAddress, uint32_t ulSize, uint32_t ulTag )
+	{
+	HeapEvent_t *pxEvent;
+
+		if( uxEventCount < ( UBaseType_t ) configHEAP_ACCOUNTING_EVENT_COUNT )
+		{
+			pxEvent = &( xEvents[ ( uxEventHead + uxEventCount ) % ( UBaseType_t ) configHEAP_ACCOUNTING_EVENT_COUNT ] );
+			pxEvent->ulTime = ( uint32_t ) xTaskGetTickCount();
+			pxEvent->ulAddress = ( uint32_t ) ( size_t ) pvAddress;
+			pxEvent->ulSize = ulSize;
+			pxEvent->usTask = ( uint16_t ) heapTAG_TASK( ulTag );
+			pxEvent->usCallSite = ( uint16_t ) heapTAG_CALL_SITE( ulTag );
+			uxEventCount++;
+		}
+		else
+		{
+			ulEventsDropped++;
+		}
+	}
+
+#endif /* configHEAP_ACCOUNTING_EVENT_COUNT */
+/*-----------------------------------------------------------*/
+
+uint32_t ulPortHeapAccountMalloc( const void *pvAddress, size_t xRequestedSize, size_t xBlockSize, const void *pvCallSite )
+{
+UBaseType_t uxTask, uxCallSite;
+uint32_t ulTag;
+
+	uxTask = prvGetTaskEntry();
+	uxCallSite = prvGetCallSiteEntry( pvCallSite );
+	ulTag = heapTAG( uxTask, uxCallSite );
+
+	xTaskUsage[ uxTask ].xLiveBytes += xBlockSize;
+
+	if( xTaskUsage[ uxTask ].xLiveBytes > xTaskUsage[ uxTask ].xPeakBytes )
+	{
+		xTaskUsage[ uxTask ].xPeakBytes = xTaskUsage[ uxTask ].xLiveBytes;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	xCallSiteUsage[ uxCallSite ].xLiveBytes += xBlockSize;
+	xCallSiteUsage[ uxCallSite ].xAllocations++;
+
+	if( xCallSiteUsage[ uxCallSite ].xLiveBytes > xCallSiteUsage[ uxCallSite ].xPeakBytes )
+	{
+		xCallSiteUsage[ uxCallSite ].xPeakBytes = xCallSiteUsage[ uxCallSite ].xLiveBytes;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	#if( configHEAP_ACCOUNTING_EVENT_COUNT > 0 )
+	{
+		prvRecordEvent( pvAddress, ( uint32_t ) xRequestedSize, ulTag );
+	}
+	#else
+	{
+		( void ) pvAddress;
+	}
+	#endif
+
+	/* A TCB has the size of a StaticTask_t, which the kernel checks. */
+	if( xRequestedSize == sizeof( StaticTask_t ) )
+	{
+		ulTag |= heapTAG_TCB_SIZED;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return ulTag;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapAccountFree( const void *pvAddress, size_t xBlockSize, uint32_t ulHeapTag )
+{
+UBaseType_t uxEntry;
+
+	xTaskUsage[ heapTAG_TASK( ulHeapTag ) ].xLiveBytes -= xBlockSize;
+	xCallSiteUsage[ heapTAG_CALL_SITE( ulHeapTag ) ].xLiveBytes -= xBlockSize;
+
+	/* The handle of a task is the address of its TCB, so the task has been
+	deleted if this is the block of a task in the table.  Only blocks of the
+	size of a TCB can be. */
+	if( ( ulHeapTag & heapTAG_TCB_SIZED ) != 0UL )
+	{
+		for( uxEntry = 1; uxEntry < ( UBaseType_t ) configHEAP_ACCOUNTING_MAX_TASKS; uxEntry++ )
+		{
+			if( xTaskUsage[ uxEntry ].pvTask == pvAddress )
+			{
+				xTaskUsage[ uxEntry ].pvTask = NULL;
+
+				if( pvLastTask == pvAddress )
+				{
+					pvLastTask = NULL;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				break;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	#if( configHEAP_ACCOUNTING_EVENT_COUNT > 0 )
+	{
+		prvRecordEvent( pvAddress, portHEAP_EVENT_FREE, ulHeapTag );
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPortGetHeapTaskUsage( HeapTaskUsage_t *pxUsage, UBaseType_t uxArraySize )
+{
+	if( uxArraySize > ( UBaseType_t ) configHEAP_ACCOUNTING_MAX_TASKS )
+	{
+		uxArraySize = ( UBaseType_t ) configHEAP_ACCOUNTING_MAX_TASKS;
+	}
+
+	vTaskSuspendAll();
+	{
+		memcpy( pxUsage, xTaskUsage, uxArraySize * sizeof( HeapTaskUsage_t ) );
+	}
+	( void ) xTaskResumeAll();
+
+	return uxArraySize;
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPortGetHeapCallSiteUsage( HeapCallSiteUsage_t *pxUsage, UBaseType_t uxArraySize )
+{
+	if( uxArraySize > ( UBaseType_t ) configHEAP_ACCOUNTING_MAX_CALL_SITES )
+	{
+		uxArraySize = ( UBaseType_t ) configHEAP_ACCOUNTING_MAX_CALL_SITES;
+	}
+
+	vTaskSuspendAll();
+	{
+		memcpy( pxUsage, xCallSiteUsage, uxArraySize * sizeof( HeapCallSiteUsage_t ) );
+	}
+	( void ) xTaskResumeAll();
+
+	return uxArraySize;
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPortReadHeapEvents( HeapEvent_t *pxEvents, UBaseType_t uxArraySize, uint32_t *pulDropped )
+{
+UBaseType_t uxRead = 0;
+
+	#if( configHEAP_ACCOUNTING_EVENT_COUNT > 0 )
+	{
+		vTaskSuspendAll();
+		{
+			while( ( uxRead < uxArraySize ) && ( uxEventCount > 0 ) )
+			{
+				pxEvents[ uxRead ] = xEvents[ uxEventHead ];
+				uxRead++;
+				uxEventHead = ( uxEventHead + 1 ) % ( UBaseType_t ) configHEAP_ACCOUNTING_EVENT_COUNT;
+				uxEventCount--;
+			}
+
+			*pulDropped = ulEventsDropped;
+			ulEventsDropped = 0;
+		}
+		( void ) xTaskResumeAll();
+	}
+	#else
+	{
+		( void ) pxEvents;
+		( void ) uxArraySize;
+		*pulDropped = 0;
+	}
+	#endif
+
+	return uxRead;
+}
+
+#endif /* configUSE_HEAP_ACCOUNTING */
+
@@ -51,6 +51,7 @@ correct privileged Vs unprivileged linkage and placement. */
 /* Constants used with the cRxLock and cTxLock structure members. */
 #define queueUNLOCKED					( ( int8_t ) -1 )
 #define queueLOCKED_UNMODIFIED			( ( int8_t ) 0 )
+#define queueMAX_LOCK_COUNT				( ( UBaseType_t ) 127 )
 
 /* When the Queue_t structure is used to represent a base queue its pcHead and
 pcTail members are used as pointers into the queue storage area.  When the
@@ -198,6 +199,29 @@ static BaseType_t prvCopyDataToQueue( Queue_t * const pxQueue, const void *pvIte
  */
 static void prvCopyDataFromQueue( Queue_t * const pxQueue, void * const pvBuffer ) PRIVILEGED_FUNCTION;
 
+/*
+ * Copies uxCount items into the back of a queue, or out of the front of a
+ * queue, with at most two calls to memcpy().  The caller must already have
+ * checked there is enough space or there are enough items.
+ */
+static void prvCopyItemsToQueue( Queue_t * const pxQueue, const int8_t *pcItems, const UBaseType_t uxCount ) PRIVILEGED_FUNCTION;
+static void prvCopyItemsFromQueue( Queue_t * const pxQueue, int8_t *pcBuffer, const UBaseType_t uxCount ) PRIVILEGED_FUNCTION;
+
+/*
+ * Called from a critical section to remove up to uxCount tasks from an event
+ * list, one for each item added to or removed from an unlocked queue.
+ *
+ * @return pdTRUE if a task with a priority above the running task was
+ * unblocked, otherwise pdFALSE.
+ */
+static BaseType_t prvUnblockTasks( List_t * const pxEventList, const UBaseType_t uxCount ) PRIVILEGED_FUNCTION;
+
+/*
+ * As prvUnblockTasks() for the tasks waiting to receive uxCount items added
+ * to a queue, or, if the queue is in a queue set, posts each item to the set.
+ */
+static BaseType_t prvUnblockReceivers( Queue_t * const pxQueue, const UBaseType_t uxCount ) PRIVILEGED_FUNCTION;
+
 #if ( configUSE_QUEUE_SETS == 1 )
 	/*
 	 * Checks to see if a queue is a member of a queue set, and if so, notifies
@@ -1923,6 +1947,386 @@ Queue_t * const pxQueue = xQueue;
 }
 /*-----------------------------------------------------------*/
 
+BaseType_t xQueueSendMultiple( QueueHandle_t xQueue, const void * const pvItems, const UBaseType_t uxItemCount, TickType_t xTicksToWait )
+{
+BaseType_t xEntryTimeSet = pdFALSE;
+UBaseType_t uxCount;
+TimeOut_t xTimeOut;
+Queue_t * const pxQueue = xQueue;
+
+	configASSERT( pxQueue );
+	configASSERT( pvItems );
+	configASSERT( pxQueue->uxItemSize != 0 ); /* Semaphores use xSemaphoreGive(). */
+	#if ( ( INCLUDE_xTaskGetSchedulerState == 1 ) || ( configUSE_TIMERS == 1 ) )
+	{
+		configASSERT( !( ( xTaskGetSchedulerState() == taskSCHEDULER_SUSPENDED ) && ( xTicksToWait != 0 ) ) );
+	}
+	#endif
+
+	/*lint -save -e904 This function relaxes the coding standard somewhat to
+	allow return statements within the function itself.  This is done in the
+	interest of execution time efficiency. */
+	if( uxItemCount == ( UBaseType_t ) 0 )
+	{
+		return 0;
+	}
+
+	for( ;; )
+	{
+		taskENTER_CRITICAL();
+		{
+			/* Is there room on the queue now?  As many of the items as fit are
+			copied in one go, and the tasks waiting for them are unblocked
+			together, so there is at most one context switch. */
+			uxCount = pxQueue->uxLength - pxQueue->uxMessagesWaiting;
+
+			if( uxCount > ( UBaseType_t ) 0 )
+			{
+				uxCount = configMIN( uxCount, uxItemCount );
+				traceQUEUE_SEND( pxQueue );
+				prvCopyItemsToQueue( pxQueue, ( const int8_t * ) pvItems, uxCount );
+
+				if( prvUnblockReceivers( pxQueue, uxCount ) != pdFALSE )
+				{
+					/* A task with a priority above our own was unblocked, so
+					yield now.  Yes it is ok to do this from within the
+					critical section - the kernel takes care of that. */
+					queueYIELD_IF_USING_PREEMPTION();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				taskEXIT_CRITICAL();
+				return ( BaseType_t ) uxCount;
+			}
+			else
+			{
+				if( xTicksToWait == ( TickType_t ) 0 )
+				{
+					/* The queue was full and no block time is specified (or
+					the block time has expired) so leave now. */
+					taskEXIT_CRITICAL();
+					traceQUEUE_SEND_FAILED( pxQueue );
+					return 0;
+				}
+				else if( xEntryTimeSet == pdFALSE )
+				{
+					vTaskInternalSetTimeOutState( &xTimeOut );
+					xEntryTimeSet = pdTRUE;
+				}
+				else
+				{
+					/* Entry time was already set. */
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		/* Block in the same way as xQueueGenericSend(). */
+		vTaskSuspendAll();
+		prvLockQueue( pxQueue );
+
+		if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE )
+		{
+			if( prvIsQueueFull( pxQueue ) != pdFALSE )
+			{
+				traceBLOCKING_ON_QUEUE_SEND( pxQueue );
+				vTaskPlaceOnEventList( &( pxQueue->xTasksWaitingToSend ), xTicksToWait );
+				prvUnlockQueue( pxQueue );
+
+				if( xTaskResumeAll() == pdFALSE )
+				{
+					portYIELD_WITHIN_API();
+				}
+			}
+			else
+			{
+				/* Try again. */
+				prvUnlockQueue( pxQueue );
+				( void ) xTaskResumeAll();
+			}
+		}
+		else
+		{
+			/* The timeout has expired. */
+			prvUnlockQueue( pxQueue );
+			( void ) xTaskResumeAll();
+
+			traceQUEUE_SEND_FAILED( pxQueue );
+			return 0;
+		}
+	} /*lint -restore */
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueSendMultipleFromISR( QueueHandle_t xQueue, const void * const pvItems, const UBaseType_t uxItemCount, BaseType_t * const pxHigherPriorityTaskWoken )
+{
+UBaseType_t uxCount, uxSavedInterruptStatus;
+Queue_t * const pxQueue = xQueue;
+
+	configASSERT( pxQueue );
+	configASSERT( pvItems );
+	configASSERT( pxQueue->uxItemSize != 0 );
+
+	/* See the comments in xQueueGenericSendFromISR(). */
+	portASSERT_IF_INTERRUPT_PRIORITY_INVALID();
+
+	uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+	{
+		const int8_t cTxLock = pxQueue->cTxLock;
+
+		uxCount = configMIN( pxQueue->uxLength - pxQueue->uxMessagesWaiting, uxItemCount );
+
+		#if ( configUSE_QUEUE_SETS == 1 )
+		{
+			/* A queue that is a member of a queue set posts its handle to the
+			set once for each item counted while it was locked, so no more
+			items are posted than the lock count can hold.  The caller posts
+			the rest once the queue is unlocked. */
+			if( ( pxQueue->pxQueueSetContainer != NULL ) && ( cTxLock != queueUNLOCKED ) )
+			{
+				uxCount = configMIN( uxCount, queueMAX_LOCK_COUNT - ( UBaseType_t ) cTxLock );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		#endif /* configUSE_QUEUE_SETS */
+
+		if( uxCount > ( UBaseType_t ) 0 )
+		{
+			traceQUEUE_SEND_FROM_ISR( pxQueue );
+			prvCopyItemsToQueue( pxQueue, ( const int8_t * ) pvItems, uxCount );
+
+			/* The event list is not altered if the queue is locked.  This will
+			be done when the queue is unlocked later. */
+			if( cTxLock == queueUNLOCKED )
+			{
+				if( prvUnblockReceivers( pxQueue, uxCount ) != pdFALSE )
+				{
+					if( pxHigherPriorityTaskWoken != NULL )
+					{
+						*pxHigherPriorityTaskWoken = pdTRUE;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				/* Add the items to the lock count so the task that unlocks the
+				queue knows that data was posted while it was locked.  Outside
+				a queue set, more than the count can hold only means that many
+				tasks are woken. */
+				pxQueue->cTxLock = ( int8_t ) configMIN( ( UBaseType_t ) cTxLock + uxCount, queueMAX_LOCK_COUNT );
+			}
+		}
+		else
+		{
+			traceQUEUE_SEND_FROM_ISR_FAILED( pxQueue );
+		}
+	}
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+	return ( BaseType_t ) uxCount;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueReceiveMultiple( QueueHandle_t xQueue, void * const pvBuffer, const UBaseType_t uxMaxItems, TickType_t xTicksToWait )
+{
+BaseType_t xEntryTimeSet = pdFALSE;
+UBaseType_t uxCount;
+TimeOut_t xTimeOut;
+Queue_t * const pxQueue = xQueue;
+
+	configASSERT( pxQueue );
+	configASSERT( pvBuffer );
+	configASSERT( pxQueue->uxItemSize != 0 ); /* Semaphores use xSemaphoreTake(). */
+	#if ( ( INCLUDE_xTaskGetSchedulerState == 1 ) || ( configUSE_TIMERS == 1 ) )
+	{
+		configASSERT( !( ( xTaskGetSchedulerState() == taskSCHEDULER_SUSPENDED ) && ( xTicksToWait != 0 ) ) );
+	}
+	#endif
+
+	/*lint -save -e904  This function relaxes the coding standard somewhat to
+	allow return statements within the function itself.  This is done in the
+	interest of execution time efficiency. */
+	if( uxMaxItems == ( UBaseType_t ) 0 )
+	{
+		return 0;
+	}
+
+	for( ;; )
+	{
+		taskENTER_CRITICAL();
+		{
+			/* Is there data in the queue now?  As many items as there are, up
+			to uxMaxItems, are copied out in one go, and the tasks waiting for
+			the space are unblocked together. */
+			uxCount = configMIN( pxQueue->uxMessagesWaiting, uxMaxItems );
+
+			if( uxCount > ( UBaseType_t ) 0 )
+			{
+				traceQUEUE_RECEIVE( pxQueue );
+				prvCopyItemsFromQueue( pxQueue, ( int8_t * ) pvBuffer, uxCount );
+
+				if( prvUnblockTasks( &( pxQueue->xTasksWaitingToSend ), uxCount ) != pdFALSE )
+				{
+					queueYIELD_IF_USING_PREEMPTION();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				taskEXIT_CRITICAL();
+				return ( BaseType_t ) uxCount;
+			}
+			else
+			{
+				if( xTicksToWait == ( TickType_t ) 0 )
+				{
+					/* The queue was empty and no block time is specified (or
+					the block time has expired) so leave now. */
+					taskEXIT_CRITICAL();
+					traceQUEUE_RECEIVE_FAILED( pxQueue );
+					return 0;
+				}
+				else if( xEntryTimeSet == pdFALSE )
+				{
+					vTaskInternalSetTimeOutState( &xTimeOut );
+					xEntryTimeSet = pdTRUE;
+				}
+				else
+				{
+					/* Entry time was already set. */
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		/* Block in the same way as xQueueReceive(). */
+		vTaskSuspendAll();
+		prvLockQueue( pxQueue );
+
+		if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE )
+		{
+			if( prvIsQueueEmpty( pxQueue ) != pdFALSE )
+			{
+				traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue );
+				vTaskPlaceOnEventList( &( pxQueue->xTasksWaitingToReceive ), xTicksToWait );
+				prvUnlockQueue( pxQueue );
+
+				if( xTaskResumeAll() == pdFALSE )
+				{
+					portYIELD_WITHIN_API();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				/* The queue contains data again.  Loop back to try and read the
+				data. */
+				prvUnlockQueue( pxQueue );
+				( void ) xTaskResumeAll();
+			}
+		}
+		else
+		{
+			/* Timed out.  If there is no data in the queue exit, otherwise loop
+			back and attempt to read the data. */
+			prvUnlockQueue( pxQueue );
+			( void ) xTaskResumeAll();
+
+			if( prvIsQueueEmpty( pxQueue ) != pdFALSE )
+			{
+				traceQUEUE_RECEIVE_FAILED( pxQueue );
+				return 0;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+	} /*lint -restore */
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueReceiveMultipleFromISR( QueueHandle_t xQueue, void * const pvBuffer, const UBaseType_t uxMaxItems, BaseType_t * const pxHigherPriorityTaskWoken )
+{
+UBaseType_t uxCount, uxSavedInterruptStatus;
+Queue_t * const pxQueue = xQueue;
+
+	configASSERT( pxQueue );
+	configASSERT( pvBuffer );
+	configASSERT( pxQueue->uxItemSize != 0 );
+
+	/* See the comments in xQueueReceiveFromISR(). */
+	portASSERT_IF_INTERRUPT_PRIORITY_INVALID();
+
+	uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+	{
+		uxCount = configMIN( pxQueue->uxMessagesWaiting, uxMaxItems );
+
+		if( uxCount > ( UBaseType_t ) 0 )
+		{
+			const int8_t cRxLock = pxQueue->cRxLock;
+
+			traceQUEUE_RECEIVE_FROM_ISR( pxQueue );
+			prvCopyItemsFromQueue( pxQueue, ( int8_t * ) pvBuffer, uxCount );
+
+			/* If the queue is locked the event list will not be modified.
+			Instead update the lock count so the task that unlocks the queue
+			will know that an ISR has removed data while the queue was
+			locked. */
+			if( cRxLock == queueUNLOCKED )
+			{
+				if( prvUnblockTasks( &( pxQueue->xTasksWaitingToSend ), uxCount ) != pdFALSE )
+				{
+					if( pxHigherPriorityTaskWoken != NULL )
+					{
+						*pxHigherPriorityTaskWoken = pdTRUE;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				pxQueue->cRxLock = ( int8_t ) configMIN( ( UBaseType_t ) cRxLock + uxCount, queueMAX_LOCK_COUNT );
+			}
+		}
+		else
+		{
+			traceQUEUE_RECEIVE_FROM_ISR_FAILED( pxQueue );
+		}
+	}
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+	return ( BaseType_t ) uxCount;
+}
+/*-----------------------------------------------------------*/
+
 UBaseType_t uxQueueMessagesWaiting( const QueueHandle_t xQueue )
 {
 UBaseType_t uxReturn;
@@ -2164,6 +2568,136 @@ static void prvCopyDataFromQueue( Queue_t * const pxQueue, void * const pvBuffer
 }
 /*-----------------------------------------------------------*/
 
+static void prvCopyItemsToQueue( Queue_t * const pxQueue, const int8_t *pcItems, const UBaseType_t uxCount )
+{
+size_t xBytes, xFirstBytes;
+
+	/* This function is called from a critical section. */
+
+	xBytes = ( size_t ) uxCount * ( size_t ) pxQueue->uxItemSize;
+	xFirstBytes = configMIN( xBytes, ( size_t ) ( pxQueue->u.xQueue.pcTail - pxQueue->pcWriteTo ) ); /*lint !e946 !e9033 Pointer subtraction within the storage area. */
+
+	( void ) memcpy( ( void * ) pxQueue->pcWriteTo, ( const void * ) pcItems, xFirstBytes ); /*lint !e9087 memcpy() requires void *. */
+	pxQueue->pcWriteTo += xFirstBytes; /*lint !e9016 Pointer arithmetic on char types ok. */
+
+	if( xBytes > xFirstBytes )
+	{
+		/* The items wrap back to the start of the storage area. */
+		( void ) memcpy( ( void * ) pxQueue->pcHead, ( const void * ) &( pcItems[ xFirstBytes ] ), xBytes - xFirstBytes ); /*lint !e9087 memcpy() requires void *. */
+		pxQueue->pcWriteTo = pxQueue->pcHead + ( xBytes - xFirstBytes ); /*lint !e9016 Pointer arithmetic on char types ok. */
+	}
+	else if( pxQueue->pcWriteTo >= pxQueue->u.xQueue.pcTail ) /*lint !e946 MISRA exception justified as comparison of pointers is the cleanest solution. */
+	{
+		pxQueue->pcWriteTo = pxQueue->pcHead;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	pxQueue->uxMessagesWaiting += uxCount;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCopyItemsFromQueue( Queue_t * const pxQueue, int8_t *pcBuffer, const UBaseType_t uxCount )
+{
+size_t xBytes, xFirstBytes;
+int8_t *pcReadFrom;
+
+	/* This function is called from a critical section.  pcReadFrom points
+	to the last item read, so the first item is the one after it. */
+
+	pcReadFrom = pxQueue->u.xQueue.pcReadFrom + pxQueue->uxItemSize; /*lint !e9016 Pointer arithmetic on char types ok. */
+	if( pcReadFrom >= pxQueue->u.xQueue.pcTail ) /*lint !e946 MISRA exception justified as comparison of pointers is the cleanest solution. */
+	{
+		pcReadFrom = pxQueue->pcHead;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	xBytes = ( size_t ) uxCount * ( size_t ) pxQueue->uxItemSize;
+	xFirstBytes = configMIN( xBytes, ( size_t ) ( pxQueue->u.xQueue.pcTail - pcReadFrom ) ); /*lint !e946 !e9033 Pointer subtraction within the storage area. */
+
+	( void ) memcpy( ( void * ) pcBuffer, ( const void * ) pcReadFrom, xFirstBytes ); /*lint !e9087 memcpy() requires void *. */
+
+	if( xBytes > xFirstBytes )
+	{
+		/* The items wrap back to the start of the storage area. */
+		( void ) memcpy( ( void * ) &( pcBuffer[ xFirstBytes ] ), ( const void * ) pxQueue->pcHead, xBytes - xFirstBytes ); /*lint !e9087 memcpy() requires void *. */
+		pcReadFrom = pxQueue->pcHead + ( xBytes - xFirstBytes ); /*lint !e9016 Pointer arithmetic on char types ok. */
+	}
+	else
+	{
+		pcReadFrom += xFirstBytes; /*lint !e9016 Pointer arithmetic on char types ok. */
+	}
+
+	/* Leave pcReadFrom at the last item read. */
+	pxQueue->u.xQueue.pcReadFrom = pcReadFrom - pxQueue->uxItemSize; /*lint !e9016 Pointer arithmetic on char types ok. */
+	pxQueue->uxMessagesWaiting -= uxCount;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvUnblockTasks( List_t * const pxEventList, const UBaseType_t uxCount )
+{
+BaseType_t xReturn = pdFALSE;
+UBaseType_t uxTask;
+
+	for( uxTask = 0; ( uxTask < uxCount ) && ( listLIST_IS_EMPTY( pxEventList ) == pdFALSE ); uxTask++ )
+	{
+		if( xTaskRemoveFromEventList( pxEventList ) != pdFALSE )
+		{
+			xReturn = pdTRUE;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvUnblockReceivers( Queue_t * const pxQueue, const UBaseType_t uxCount )
+{
+BaseType_t xReturn = pdFALSE;
+
+	#if ( configUSE_QUEUE_SETS == 1 )
+	{
+	UBaseType_t uxItem;
+
+		if( pxQueue->pxQueueSetContainer != NULL )
+		{
+			/* The queue set holds the handle of the queue once per item. */
+			for( uxItem = 0; uxItem < uxCount; uxItem++ )
+			{
+				if( prvNotifyQueueSetContainer( pxQueue, queueSEND_TO_BACK ) != pdFALSE )
+				{
+					xReturn = pdTRUE;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+		}
+		else
+		{
+			xReturn = prvUnblockTasks( &( pxQueue->xTasksWaitingToReceive ), uxCount );
+		}
+	}
+	#else /* configUSE_QUEUE_SETS */
+	{
+		xReturn = prvUnblockTasks( &( pxQueue->xTasksWaitingToReceive ), uxCount );
+	}
+	#endif /* configUSE_QUEUE_SETS */
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
 static void prvUnlockQueue( Queue_t * const pxQueue )
 {
 	/* THIS FUNCTION MUST BE CALLED WITH THE SCHEDULER SUSPENDED. */
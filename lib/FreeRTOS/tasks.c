@@ -217,6 +217,7 @@ count overflows. */
  */
 #define prvAddTaskToReadyList( pxTCB )																\
 	traceMOVED_TASK_TO_READY_STATE( pxTCB );														\
+	taskPROFILE_TASK_READY( pxTCB );																\
 	taskRECORD_READY_PRIORITY( ( pxTCB )->uxPriority );												\
 	vListInsertEnd( &( pxReadyTasksLists[ ( pxTCB )->uxPriority ] ), &( ( pxTCB )->xStateListItem ) ); \
 	tracePOST_MOVED_TASK_TO_READY_STATE( pxTCB )
@@ -293,6 +294,16 @@ typedef struct tskTaskControlBlock 			/* The old naming convention is used to pr
 		uint32_t		ulRunTimeCounter;	/*< Stores the amount of time the task has spent in the Running state. */
 	#endif
 
+	#if( configUSE_TASK_PROFILING == 1 )
+		uint64_t		ullTotalWakeLatency;	/*< The sum of the wake latencies measured since they were last cleared, 64 bits wide as 32 would overflow after a few seconds of latency in total. */
+		uint32_t		ulSwitchCount;		/*< The number of times the task has been switched in. */
+		uint32_t		ulReadyTime;		/*< The run time counter when the task was last made ready. */
+		uint32_t		ulWakeCount;		/*< The number of wake latencies in ullTotalWakeLatency... */
+		uint32_t		ulMaxWakeLatency;	/*< ...and the longest of them. */
+		UBaseType_t		uxProfileEpoch;		/*< The value of uxProfileEpoch when the latencies were last cleared. */
+		uint8_t			ucWaitingToRun;		/*< Set to pdTRUE while ulReadyTime holds the time the task was made ready and it has not run since. */
+	#endif
+
 	#if ( configUSE_NEWLIB_REENTRANT == 1 )
 		/* Allocate a Newlib reent structure that is specific to this task.
 		Note Newlib support has been included by popular demand, but is not
@@ -394,6 +405,13 @@ PRIVILEGED_DATA static volatile UBaseType_t uxSchedulerSuspended	= ( UBaseType_t
 
 #endif
 
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	PRIVILEGED_DATA static volatile UBaseType_t uxProfileEpoch = ( UBaseType_t ) 0U;	/*< Incremented by vTaskResetLatencyStats() to clear the latencies of all the tasks. */
+	PRIVILEGED_DATA static ISRStatus_t xISRStatus[ configMAX_PROFILED_ISRS ];			/*< The statistics of the interrupt handlers, indexed by their number. */
+
+#endif
+
 /*lint -restore */
 
 /*-----------------------------------------------------------*/
@@ -560,6 +578,33 @@ static void prvInitialiseNewTask( 	TaskFunction_t pxTaskCode,
  */
 static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB ) PRIVILEGED_FUNCTION;
 
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	/*
+	 * Return the current value of the run time stats clock.
+	 */
+	static uint32_t prvGetRunTimeCounterValue( void ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Record the time at which a task other than the running task was moved to
+	 * the Ready state, unless it was already waiting to run.
+	 */
+	static void prvProfileTaskReady( TCB_t * const pxTCB ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Count the switch to the task that was just selected to run, and record
+	 * its wake latency if it was made ready since it last ran.
+	 */
+	static void prvProfileTaskSwitchedIn( const uint32_t ulSwitchTime ) PRIVILEGED_FUNCTION;
+
+	#define taskPROFILE_TASK_READY( pxTCB ) prvProfileTaskReady( pxTCB )
+
+#else
+
+	#define taskPROFILE_TASK_READY( pxTCB )
+
+#endif
+
 /*
  * freertos_tasks_c_additions_init() should only be called if the user definable
  * macro FREERTOS_TASKS_C_ADDITIONS_INIT() is defined, as that is the only macro
@@ -964,6 +1009,18 @@ UBaseType_t x;
 	}
 	#endif /* configGENERATE_RUN_TIME_STATS */
 
+	#if ( configUSE_TASK_PROFILING == 1 )
+	{
+		pxNewTCB->ulSwitchCount = 0UL;
+		pxNewTCB->ulReadyTime = 0UL;
+		pxNewTCB->ulWakeCount = 0UL;
+		pxNewTCB->ulMaxWakeLatency = 0UL;
+		pxNewTCB->ullTotalWakeLatency = 0ULL;
+		pxNewTCB->uxProfileEpoch = uxProfileEpoch;
+		pxNewTCB->ucWaitingToRun = pdFALSE;
+	}
+	#endif /* configUSE_TASK_PROFILING */
+
 	#if ( portUSING_MPU_WRAPPERS == 1 )
 	{
 		vPortStoreTaskMPUSettings( &( pxNewTCB->xMPUSettings ), xRegions, pxNewTCB->pxStack, ulStackDepth );
@@ -1728,6 +1785,14 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 
 			vListInsertEnd( &xSuspendedTaskList, &( pxTCB->xStateListItem ) );
 
+			#if( configUSE_TASK_PROFILING == 1 )
+			{
+				/* The time the task spends suspended is not part of its wake
+				latency. */
+				pxTCB->ucWaitingToRun = pdFALSE;
+			}
+			#endif
+
 			#if( configUSE_TASK_NOTIFICATIONS == 1 )
 			{
 				if( pxTCB->ucNotifyState == taskWAITING_NOTIFICATION )
@@ -1949,6 +2014,7 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 					is held in the pending ready list until the scheduler is
 					unsuspended. */
 					vListInsertEnd( &( xPendingReadyList ), &( pxTCB->xEventListItem ) );
+					taskPROFILE_TASK_READY( pxTCB );
 				}
 			}
 			else
@@ -2945,6 +3011,10 @@ BaseType_t xSwitchRequired = pdFALSE;
 
 void vTaskSwitchContext( void )
 {
+#if ( configUSE_TASK_PROFILING == 1 )
+	TCB_t * const pxPreviousTCB = pxCurrentTCB;
+#endif
+
 	if( uxSchedulerSuspended != ( UBaseType_t ) pdFALSE )
 	{
 		/* The scheduler is currently suspended - do not allow a context
@@ -2998,6 +3068,21 @@ void vTaskSwitchContext( void )
 		taskSELECT_HIGHEST_PRIORITY_TASK(); /*lint !e9079 void * is used as this macro is used with timers and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
 		traceTASK_SWITCHED_IN();
 
+		#if ( configUSE_TASK_PROFILING == 1 )
+		{
+			/* The run time counter was read above, as switching the task
+			out. */
+			if( pxCurrentTCB != pxPreviousTCB )
+			{
+				prvProfileTaskSwitchedIn( ulTotalRunTime );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		#endif /* configUSE_TASK_PROFILING */
+
 		/* After the new task is switched in, update the global errno. */
 		#if( configUSE_POSIX_ERRNO == 1 )
 		{
@@ -3136,6 +3221,7 @@ BaseType_t xReturn;
 		/* The delayed and ready lists cannot be accessed, so hold this task
 		pending until the scheduler is resumed. */
 		vListInsertEnd( &( xPendingReadyList ), &( pxUnblockedTCB->xEventListItem ) );
+		taskPROFILE_TASK_READY( pxUnblockedTCB );
 	}
 
 	if( pxUnblockedTCB->uxPriority > pxCurrentTCB->uxPriority )
@@ -3638,6 +3724,35 @@ static void prvCheckTasksWaitingTermination( void )
 		}
 		#endif
 
+		#if ( configUSE_TASK_PROFILING == 1 )
+		{
+			pxTaskStatus->ulSwitchCount = pxTCB->ulSwitchCount;
+
+			/* The latencies of a task are only cleared when it next wakes after
+			vTaskResetLatencyStats() has been called, so until then they are
+			stale. */
+			if( ( pxTCB->uxProfileEpoch == uxProfileEpoch ) && ( pxTCB->ulWakeCount != 0UL ) )
+			{
+				pxTaskStatus->ulWakeCount = pxTCB->ulWakeCount;
+				pxTaskStatus->ulMaxWakeLatency = pxTCB->ulMaxWakeLatency;
+				pxTaskStatus->ulAverageWakeLatency = ( uint32_t ) ( pxTCB->ullTotalWakeLatency / pxTCB->ulWakeCount );
+			}
+			else
+			{
+				pxTaskStatus->ulWakeCount = 0;
+				pxTaskStatus->ulMaxWakeLatency = 0;
+				pxTaskStatus->ulAverageWakeLatency = 0;
+			}
+		}
+		#else
+		{
+			pxTaskStatus->ulSwitchCount = 0;
+			pxTaskStatus->ulWakeCount = 0;
+			pxTaskStatus->ulMaxWakeLatency = 0;
+			pxTaskStatus->ulAverageWakeLatency = 0;
+		}
+		#endif
+
 		/* Obtaining the task state is a little fiddly, so is only done if the
 		value of eState passed into this function is eInvalid - otherwise the
 		state is just set to whatever is passed in. */
@@ -4560,6 +4675,33 @@ TickType_t uxReturn;
 #endif /* configUSE_MUTEXES */
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_MUTEXES == 1 )
+
+	BaseType_t xTaskDecrementMutexHeldCount( void )
+	{
+	BaseType_t xReturn = pdFALSE;
+
+		/* Only the running task changes its own count, and no other task can
+		raise its priority through a mutex no task waits for, so no critical
+		section is needed unless the priority must be disinherited. */
+		configASSERT( pxCurrentTCB->uxMutexesHeld );
+
+		if( ( pxCurrentTCB->uxMutexesHeld > ( UBaseType_t ) 1 ) || ( pxCurrentTCB->uxPriority == pxCurrentTCB->uxBasePriority ) )
+		{
+			( pxCurrentTCB->uxMutexesHeld )--;
+			xReturn = pdTRUE;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		return xReturn;
+	}
+
+#endif /* configUSE_MUTEXES */
+/*-----------------------------------------------------------*/
+
 #if( configUSE_TASK_NOTIFICATIONS == 1 )
 
 	uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit, TickType_t xTicksToWait )
@@ -4921,6 +5063,7 @@ TickType_t uxReturn;
 					/* The delayed and ready lists cannot be accessed, so hold
 					this task pending until the scheduler is resumed. */
 					vListInsertEnd( &( xPendingReadyList ), &( pxTCB->xEventListItem ) );
+					taskPROFILE_TASK_READY( pxTCB );
 				}
 
 				if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
@@ -5009,6 +5152,7 @@ TickType_t uxReturn;
 					/* The delayed and ready lists cannot be accessed, so hold
 					this task pending until the scheduler is resumed. */
 					vListInsertEnd( &( xPendingReadyList ), &( pxTCB->xEventListItem ) );
+					taskPROFILE_TASK_READY( pxTCB );
 				}
 
 				if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
@@ -5077,6 +5221,207 @@ TickType_t uxReturn;
 #endif
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	static uint32_t prvGetRunTimeCounterValue( void )
+	{
+	uint32_t ulValue;
+
+		#ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
+			portALT_GET_RUN_TIME_COUNTER_VALUE( ulValue );
+		#else
+			ulValue = portGET_RUN_TIME_COUNTER_VALUE();
+		#endif
+
+		return ulValue;
+	}
+
+#endif /* configUSE_TASK_PROFILING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	static void prvProfileTaskReady( TCB_t * const pxTCB )
+	{
+		/* A task that is already waiting to run can be moved between the ready
+		lists, for example when its priority changes, which must not restart
+		the measurement of its latency.  The running task can be added to the
+		ready lists too, but has no latency. */
+		if( ( pxTCB->ucWaitingToRun == pdFALSE ) && ( pxTCB != pxCurrentTCB ) )
+		{
+			pxTCB->ulReadyTime = prvGetRunTimeCounterValue();
+			pxTCB->ucWaitingToRun = pdTRUE;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+#endif /* configUSE_TASK_PROFILING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	static void prvProfileTaskSwitchedIn( const uint32_t ulSwitchTime )
+	{
+	uint32_t ulLatency;
+
+		( pxCurrentTCB->ulSwitchCount )++;
+
+		if( pxCurrentTCB->ucWaitingToRun != pdFALSE )
+		{
+			pxCurrentTCB->ucWaitingToRun = pdFALSE;
+
+			/* Unsigned arithmetic gives the right latency even if the run time
+			counter wrapped since the task was made ready. */
+			ulLatency = ulSwitchTime - pxCurrentTCB->ulReadyTime;
+
+			if( pxCurrentTCB->uxProfileEpoch != uxProfileEpoch )
+			{
+				/* vTaskResetLatencyStats() was called since the last latency of
+				this task was recorded. */
+				pxCurrentTCB->uxProfileEpoch = uxProfileEpoch;
+				pxCurrentTCB->ulWakeCount = 0UL;
+				pxCurrentTCB->ulMaxWakeLatency = 0UL;
+				pxCurrentTCB->ullTotalWakeLatency = 0ULL;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			( pxCurrentTCB->ulWakeCount )++;
+			pxCurrentTCB->ullTotalWakeLatency += ulLatency;
+
+			if( ulLatency > pxCurrentTCB->ulMaxWakeLatency )
+			{
+				pxCurrentTCB->ulMaxWakeLatency = ulLatency;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			/* The task was preempted, or yielded, while it was ready, so it
+			wasn't woken. */
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+#endif /* configUSE_TASK_PROFILING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	uint32_t ulTaskProfileISREnter( void )
+	{
+		return prvGetRunTimeCounterValue();
+	}
+
+#endif /* configUSE_TASK_PROFILING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	void vTaskProfileISRExit( UBaseType_t uxISRNumber, uint32_t ulEnterTime )
+	{
+	ISRStatus_t *pxISR;
+	uint32_t ulRunTime;
+
+		configASSERT( uxISRNumber < ( UBaseType_t ) configMAX_PROFILED_ISRS );
+
+		/* Only the handler that uses uxISRNumber writes to its statistics, so
+		interrupts don't need to be masked. */
+		ulRunTime = prvGetRunTimeCounterValue() - ulEnterTime;
+		pxISR = &( xISRStatus[ uxISRNumber ] );
+		( pxISR->ulCount )++;
+		pxISR->ulRunTimeCounter += ulRunTime;
+
+		if( ulRunTime > pxISR->ulMaxRunTime )
+		{
+			pxISR->ulMaxRunTime = ulRunTime;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+#endif /* configUSE_TASK_PROFILING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	void vTaskSetISRName( UBaseType_t uxISRNumber, const char *pcISRName ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	{
+		configASSERT( uxISRNumber < ( UBaseType_t ) configMAX_PROFILED_ISRS );
+		xISRStatus[ uxISRNumber ].pcISRName = pcISRName;
+	}
+
+#endif /* configUSE_TASK_PROFILING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	UBaseType_t uxTaskGetISRState( ISRStatus_t * const pxISRStatusArray, const UBaseType_t uxArraySize )
+	{
+	UBaseType_t uxISRNumber, uxCount = ( UBaseType_t ) 0;
+
+		taskENTER_CRITICAL();
+		{
+			for( uxISRNumber = ( UBaseType_t ) 0; uxISRNumber < ( UBaseType_t ) configMAX_PROFILED_ISRS; uxISRNumber++ )
+			{
+				if( uxCount >= uxArraySize )
+				{
+					break;
+				}
+
+				if( ( xISRStatus[ uxISRNumber ].ulCount != 0UL ) || ( xISRStatus[ uxISRNumber ].pcISRName != NULL ) )
+				{
+					pxISRStatusArray[ uxCount ] = xISRStatus[ uxISRNumber ];
+					pxISRStatusArray[ uxCount ].uxISRNumber = uxISRNumber;
+					uxCount++;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		return uxCount;
+	}
+
+#endif /* configUSE_TASK_PROFILING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	void vTaskResetLatencyStats( void )
+	{
+	UBaseType_t uxISRNumber;
+
+		taskENTER_CRITICAL();
+		{
+			/* The latencies of each task are cleared when it next wakes, so
+			the call doesn't have to walk the task lists. */
+			uxProfileEpoch++;
+
+			for( uxISRNumber = ( UBaseType_t ) 0; uxISRNumber < ( UBaseType_t ) configMAX_PROFILED_ISRS; uxISRNumber++ )
+			{
+				xISRStatus[ uxISRNumber ].ulMaxRunTime = 0UL;
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+#endif /* configUSE_TASK_PROFILING */
+/*-----------------------------------------------------------*/
+
 static void prvAddCurrentTaskToDelayedList( TickType_t xTicksToWait, const BaseType_t xCanBlockIndefinitely )
 {
 TickType_t xTimeToWake;
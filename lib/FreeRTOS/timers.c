@@ -69,6 +69,17 @@ defining trmTIMER_SERVICE_TASK_NAME in FreeRTOSConfig.h. */
 #define tmrSTATUS_IS_STATICALLY_ALLOCATED	( ( uint8_t ) 0x02 )
 #define tmrSTATUS_IS_AUTORELOAD				( ( uint8_t ) 0x04 )
 
+#if( configUSE_TIMER_WHEEL == 1 )
+	/* The timer wheel has tmrWHEEL_LEVELS levels of tmrWHEEL_SLOTS slots.  Each
+	slot of level 0 is one tick, and each slot of a level above is a whole turn
+	of the level below it, so the levels together cover any time a TickType_t
+	can hold. */
+	#define tmrWHEEL_SLOT_BITS		( 5U )
+	#define tmrWHEEL_SLOTS			( 1U << tmrWHEEL_SLOT_BITS )
+	#define tmrWHEEL_SLOT_MASK		( ( TickType_t ) tmrWHEEL_SLOTS - ( TickType_t ) 1U )
+	#define tmrWHEEL_LEVELS			( ( ( sizeof( TickType_t ) * 8U ) + tmrWHEEL_SLOT_BITS - 1U ) / tmrWHEEL_SLOT_BITS )
+#endif
+
 /* The definition of the timers themselves. */
 typedef struct tmrTimerControl /* The old naming convention is used to prevent breaking kernel aware debuggers. */
 {
@@ -132,10 +143,29 @@ timer service task is allowed to access these lists.
 xActiveTimerList1 and xActiveTimerList2 could be at function scope but that
 breaks some kernel aware debuggers, and debuggers that reply on removing the
 static qualifier. */
-PRIVILEGED_DATA static List_t xActiveTimerList1;
-PRIVILEGED_DATA static List_t xActiveTimerList2;
-PRIVILEGED_DATA static List_t *pxCurrentTimerList;
-PRIVILEGED_DATA static List_t *pxOverflowTimerList;
+#if( configUSE_TIMER_WHEEL == 0 )
+	PRIVILEGED_DATA static List_t xActiveTimerList1;
+	PRIVILEGED_DATA static List_t xActiveTimerList2;
+	PRIVILEGED_DATA static List_t *pxCurrentTimerList;
+	PRIVILEGED_DATA static List_t *pxOverflowTimerList;
+#else
+	/* With configUSE_TIMER_WHEEL set to 1 the active timers are instead
+	referenced from the slot of the timer wheel their expiry time falls in,
+	in no particular order, so starting and stopping a timer takes the same
+	time however many timers are active.  A timer is kept in the lowest level
+	a turn of which reaches its expiry time, and is moved down a level each
+	time the tick count reaches the slot it is in, until it expires in a slot
+	of level 0 together with the other timers that expire on the same tick.
+	A bit is set in ulWheelSlotsInUse for each slot that is not empty, and the
+	wheel has processed every tick up to and including xLastWheelTick.  The
+	tick count is only ever compared relative to xLastWheelTick, so the wheel
+	needs no second list for the times after the tick count overflows, as long
+	as prvSampleTimeNow() keeps xLastWheelTick within a range of the tick count
+	of the time now. */
+	PRIVILEGED_DATA static List_t xTimerWheel[ tmrWHEEL_LEVELS ][ tmrWHEEL_SLOTS ];
+	PRIVILEGED_DATA static uint32_t ulWheelSlotsInUse[ tmrWHEEL_LEVELS ];
+	PRIVILEGED_DATA static TickType_t xLastWheelTick;
+#endif
 
 /* A queue that is used to send commands to the timer service task. */
 PRIVILEGED_DATA static QueueHandle_t xTimerQueue = NULL;
@@ -187,10 +217,43 @@ static BaseType_t prvInsertTimerInActiveList( Timer_t * const pxTimer, const Tic
 static void prvProcessExpiredTimer( const TickType_t xNextExpireTime, const TickType_t xTimeNow ) PRIVILEGED_FUNCTION;
 
 /*
- * The tick count has overflowed.  Switch the timer lists after ensuring the
- * current timer list does not still reference some timers.
+ * Remove an active timer from the list or the slot of the timer wheel that
+ * references it.
  */
-static void prvSwitchTimerLists( void ) PRIVILEGED_FUNCTION;
+static void prvRemoveTimerFromActiveList( Timer_t * const pxTimer ) PRIVILEGED_FUNCTION;
+
+#if( configUSE_TIMER_WHEEL == 0 )
+	/*
+	 * The tick count has overflowed.  Switch the timer lists after ensuring the
+	 * current timer list does not still reference some timers.
+	 */
+	static void prvSwitchTimerLists( void ) PRIVILEGED_FUNCTION;
+#else
+	/*
+	 * Insert an active timer into the slot of the timer wheel for its expiry
+	 * time, which is the value of its list item.
+	 */
+	static void prvInsertTimerInWheel( Timer_t * const pxTimer ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Return the next tick on which the timer wheel has a timer to expire or a
+	 * slot to move down a level, and set *pxWheelWasEmpty to pdTRUE if there
+	 * is no active timer.
+	 */
+	static TickType_t prvGetNextWheelTime( BaseType_t * const pxWheelWasEmpty ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Process the ticks of the timer wheel up to xTimeNow: move the timers of
+	 * each slot that has been reached down a level, and process the timers
+	 * that expire on each tick together.
+	 */
+	static void prvProcessTimerWheel( const TickType_t xTimeNow ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Return the index of the lowest bit set in ulValue, which must not be 0.
+	 */
+	static UBaseType_t prvLowestBit( uint32_t ulValue ) PRIVILEGED_FUNCTION;
+#endif
 
 /*
  * Obtain the current tick count, setting *pxTimerListsWereSwitched to pdTRUE
@@ -482,11 +545,15 @@ Timer_t *pxTimer = xTimer;
 static void prvProcessExpiredTimer( const TickType_t xNextExpireTime, const TickType_t xTimeNow )
 {
 BaseType_t xResult;
-Timer_t * const pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTimerList ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+#if( configUSE_TIMER_WHEEL == 0 )
+	Timer_t * const pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTimerList ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+#else
+	Timer_t * const pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( &( xTimerWheel[ 0 ][ xNextExpireTime & tmrWHEEL_SLOT_MASK ] ) ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+#endif
 
 	/* Remove the timer from the list of active timers.  A check has already
 	been performed to ensure the list is not empty. */
-	( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+	prvRemoveTimerFromActiveList( pxTimer );
 	traceTIMER_EXPIRED( pxTimer );
 
 	/* If the timer is an auto reload timer then calculate the next
@@ -572,11 +639,19 @@ BaseType_t xTimerListsWereSwitched;
 		if( xTimerListsWereSwitched == pdFALSE )
 		{
 			/* The tick count has not overflowed, has the timer expired? */
+			#if( configUSE_TIMER_WHEEL == 0 )
 			if( ( xListWasEmpty == pdFALSE ) && ( xNextExpireTime <= xTimeNow ) )
 			{
 				( void ) xTaskResumeAll();
 				prvProcessExpiredTimer( xNextExpireTime, xTimeNow );
 			}
+			#else
+			if( ( xListWasEmpty == pdFALSE ) && ( ( TickType_t ) ( xNextExpireTime - xLastWheelTick ) <= ( TickType_t ) ( xTimeNow - xLastWheelTick ) ) )
+			{
+				( void ) xTaskResumeAll();
+				prvProcessTimerWheel( xTimeNow );
+			}
+			#endif
 			else
 			{
 				/* The tick count has not overflowed, and the next expire
@@ -585,12 +660,16 @@ BaseType_t xTimerListsWereSwitched;
 				received - whichever comes first.  The following line cannot
 				be reached unless xNextExpireTime > xTimeNow, except in the
 				case when the current timer list is empty. */
-				if( xListWasEmpty != pdFALSE )
+				#if( configUSE_TIMER_WHEEL == 0 )
 				{
-					/* The current timer list is empty - is the overflow list
-					also empty? */
-					xListWasEmpty = listLIST_IS_EMPTY( pxOverflowTimerList );
+					if( xListWasEmpty != pdFALSE )
+					{
+						/* The current timer list is empty - is the overflow
+						list also empty? */
+						xListWasEmpty = listLIST_IS_EMPTY( pxOverflowTimerList );
+					}
 				}
+				#endif
 
 				vQueueWaitForMessageRestricted( xTimerQueue, ( xNextExpireTime - xTimeNow ), xListWasEmpty );
 
@@ -620,23 +699,31 @@ static TickType_t prvGetNextExpireTime( BaseType_t * const pxListWasEmpty )
 {
 TickType_t xNextExpireTime;
 
-	/* Timers are listed in expiry time order, with the head of the list
-	referencing the task that will expire first.  Obtain the time at which
-	the timer with the nearest expiry time will expire.  If there are no
-	active timers then just set the next expire time to 0.  That will cause
-	this task to unblock when the tick count overflows, at which point the
-	timer lists will be switched and the next expiry time can be
-	re-assessed.  */
-	*pxListWasEmpty = listLIST_IS_EMPTY( pxCurrentTimerList );
-	if( *pxListWasEmpty == pdFALSE )
+	#if( configUSE_TIMER_WHEEL == 0 )
 	{
-		xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxCurrentTimerList );
+		/* Timers are listed in expiry time order, with the head of the list
+		referencing the task that will expire first.  Obtain the time at which
+		the timer with the nearest expiry time will expire.  If there are no
+		active timers then just set the next expire time to 0.  That will cause
+		this task to unblock when the tick count overflows, at which point the
+		timer lists will be switched and the next expiry time can be
+		re-assessed.  */
+		*pxListWasEmpty = listLIST_IS_EMPTY( pxCurrentTimerList );
+		if( *pxListWasEmpty == pdFALSE )
+		{
+			xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxCurrentTimerList );
+		}
+		else
+		{
+			/* Ensure the task unblocks when the tick count rolls over. */
+			xNextExpireTime = ( TickType_t ) 0U;
+		}
 	}
-	else
+	#else
 	{
-		/* Ensure the task unblocks when the tick count rolls over. */
-		xNextExpireTime = ( TickType_t ) 0U;
+		xNextExpireTime = prvGetNextWheelTime( pxListWasEmpty );
 	}
+	#endif
 
 	return xNextExpireTime;
 }
@@ -649,15 +736,55 @@ PRIVILEGED_DATA static TickType_t xLastTime = ( TickType_t ) 0U; /*lint !e956 Va
 
 	xTimeNow = xTaskGetTickCount();
 
-	if( xTimeNow < xLastTime )
+	#if( configUSE_TIMER_WHEEL == 0 )
 	{
-		prvSwitchTimerLists();
-		*pxTimerListsWereSwitched = pdTRUE;
+		if( xTimeNow < xLastTime )
+		{
+			prvSwitchTimerLists();
+			*pxTimerListsWereSwitched = pdTRUE;
+		}
+		else
+		{
+			*pxTimerListsWereSwitched = pdFALSE;
+		}
 	}
-	else
+	#else
 	{
-		*pxTimerListsWereSwitched = pdFALSE;
+	TickType_t xNextWheelTime;
+	BaseType_t xWheelWasEmpty;
+
+		if( xTimeNow < xLastTime )
+		{
+			/* The tick count has overflowed.  The wheel has no lists to
+			switch, but it is brought up to date, processing the timers that
+			expired before the overflow, just as the list implementation
+			processes those left in the current list. */
+			prvProcessTimerWheel( xTimeNow );
+			*pxTimerListsWereSwitched = pdTRUE;
+		}
+		else
+		{
+			/* The wheel only counts ticks relative to xLastWheelTick, which
+			prvProcessTimerWheel() only moves on when a timer is due.  If
+			nothing is due up to now, as when the wheel is empty, move it on
+			to now, so it never falls a whole range of the tick count behind
+			and a timer started after a long idle time is not inserted into
+			a slot that has already passed. */
+			xNextWheelTime = prvGetNextWheelTime( &xWheelWasEmpty );
+
+			if( ( xWheelWasEmpty != pdFALSE ) || ( ( TickType_t ) ( xNextWheelTime - xLastWheelTick ) > ( TickType_t ) ( xTimeNow - xLastWheelTick ) ) )
+			{
+				xLastWheelTick = xTimeNow;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			*pxTimerListsWereSwitched = pdFALSE;
+		}
 	}
+	#endif
 
 	xLastTime = xTimeNow;
 
@@ -684,7 +811,15 @@ BaseType_t xProcessTimerNow = pdFALSE;
 		}
 		else
 		{
-			vListInsert( pxOverflowTimerList, &( pxTimer->xTimerListItem ) );
+			#if( configUSE_TIMER_WHEEL == 0 )
+			{
+				vListInsert( pxOverflowTimerList, &( pxTimer->xTimerListItem ) );
+			}
+			#else
+			{
+				prvInsertTimerInWheel( pxTimer );
+			}
+			#endif
 		}
 	}
 	else
@@ -698,7 +833,15 @@ BaseType_t xProcessTimerNow = pdFALSE;
 		}
 		else
 		{
-			vListInsert( pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+			#if( configUSE_TIMER_WHEEL == 0 )
+			{
+				vListInsert( pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+			}
+			#else
+			{
+				prvInsertTimerInWheel( pxTimer );
+			}
+			#endif
 		}
 	}
 
@@ -748,7 +891,7 @@ TickType_t xTimeNow;
 			if( listIS_CONTAINED_WITHIN( NULL, &( pxTimer->xTimerListItem ) ) == pdFALSE ) /*lint !e961. The cast is only redundant when NULL is passed into the macro. */
 			{
 				/* The timer is in a list, remove it. */
-				( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+				prvRemoveTimerFromActiveList( pxTimer );
 			}
 			else
 			{
@@ -854,63 +997,269 @@ TickType_t xTimeNow;
 }
 /*-----------------------------------------------------------*/
 
-static void prvSwitchTimerLists( void )
+static void prvRemoveTimerFromActiveList( Timer_t * const pxTimer )
 {
-TickType_t xNextExpireTime, xReloadTime;
-List_t *pxTemp;
-Timer_t *pxTimer;
-BaseType_t xResult;
+	#if( configUSE_TIMER_WHEEL == 0 )
+	{
+		( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+	}
+	#else
+	{
+	const List_t * const pxSlot = ( List_t * ) listLIST_ITEM_CONTAINER( &( pxTimer->xTimerListItem ) );
+	UBaseType_t uxSlot;
+
+		/* Mark the slot as not in use if it no longer references a timer. */
+		if( uxListRemove( &( pxTimer->xTimerListItem ) ) == ( UBaseType_t ) 0 )
+		{
+			uxSlot = ( UBaseType_t ) ( pxSlot - &( xTimerWheel[ 0 ][ 0 ] ) );
+			ulWheelSlotsInUse[ uxSlot / tmrWHEEL_SLOTS ] &= ~( ( uint32_t ) 1U << ( uxSlot % tmrWHEEL_SLOTS ) );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+#if( configUSE_TIMER_WHEEL == 0 )
 
-	/* The tick count has overflowed.  The timer lists must be switched.
-	If there are any timers still referenced from the current timer list
-	then they must have expired and should be processed before the lists
-	are switched. */
-	while( listLIST_IS_EMPTY( pxCurrentTimerList ) == pdFALSE )
+	static void prvSwitchTimerLists( void )
 	{
-		xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxCurrentTimerList );
+	TickType_t xNextExpireTime, xReloadTime;
+	List_t *pxTemp;
+	Timer_t *pxTimer;
+	BaseType_t xResult;
+
+		/* The tick count has overflowed.  The timer lists must be switched.
+		If there are any timers still referenced from the current timer list
+		then they must have expired and should be processed before the lists
+		are switched. */
+		while( listLIST_IS_EMPTY( pxCurrentTimerList ) == pdFALSE )
+		{
+			xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxCurrentTimerList );
 
-		/* Remove the timer from the list. */
-		pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTimerList ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
-		( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
-		traceTIMER_EXPIRED( pxTimer );
+			/* Remove the timer from the list. */
+			pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTimerList ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+			( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+			traceTIMER_EXPIRED( pxTimer );
+
+			/* Execute its callback, then send a command to restart the timer if
+			it is an auto-reload timer.  It cannot be restarted here as the lists
+			have not yet been switched. */
+			pxTimer->pxCallbackFunction( ( TimerHandle_t ) pxTimer );
+
+			if( ( pxTimer->ucStatus & tmrSTATUS_IS_AUTORELOAD ) != 0 )
+			{
+				/* Calculate the reload value, and if the reload value results in
+				the timer going into the same timer list then it has already expired
+				and the timer should be re-inserted into the current list so it is
+				processed again within this loop.  Otherwise a command should be sent
+				to restart the timer to ensure it is only inserted into a list after
+				the lists have been swapped. */
+				xReloadTime = ( xNextExpireTime + pxTimer->xTimerPeriodInTicks );
+				if( xReloadTime > xNextExpireTime )
+				{
+					listSET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ), xReloadTime );
+					listSET_LIST_ITEM_OWNER( &( pxTimer->xTimerListItem ), pxTimer );
+					vListInsert( pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+				}
+				else
+				{
+					xResult = xTimerGenericCommand( pxTimer, tmrCOMMAND_START_DONT_TRACE, xNextExpireTime, NULL, tmrNO_DELAY );
+					configASSERT( xResult );
+					( void ) xResult;
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
 
-		/* Execute its callback, then send a command to restart the timer if
-		it is an auto-reload timer.  It cannot be restarted here as the lists
-		have not yet been switched. */
-		pxTimer->pxCallbackFunction( ( TimerHandle_t ) pxTimer );
+		pxTemp = pxCurrentTimerList;
+		pxCurrentTimerList = pxOverflowTimerList;
+		pxOverflowTimerList = pxTemp;
+	}
+
+#endif /* configUSE_TIMER_WHEEL */
+/*-----------------------------------------------------------*/
 
-		if( ( pxTimer->ucStatus & tmrSTATUS_IS_AUTORELOAD ) != 0 )
+#if( configUSE_TIMER_WHEEL == 1 )
+
+	static void prvInsertTimerInWheel( Timer_t * const pxTimer )
+	{
+	const TickType_t xExpiryTime = listGET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ) );
+	const TickType_t xTicksToExpiry = ( TickType_t ) ( xExpiryTime - xLastWheelTick ) - ( TickType_t ) 1U;
+	UBaseType_t uxLevel = 0, uxSlot;
+
+		/* Find the lowest level a turn of which, counted from the next tick the
+		wheel processes, reaches the expiry time.  The slot is that of the
+		expiry time itself, so the timer is moved down a level exactly when
+		the tick count reaches the start of that slot. */
+		while( ( uxLevel < ( UBaseType_t ) ( tmrWHEEL_LEVELS - 1U ) ) && ( ( xTicksToExpiry >> ( tmrWHEEL_SLOT_BITS * ( uxLevel + 1U ) ) ) != ( TickType_t ) 0U ) )
+		{
+			uxLevel++;
+		}
+
+		uxSlot = ( UBaseType_t ) ( ( xExpiryTime >> ( tmrWHEEL_SLOT_BITS * uxLevel ) ) & tmrWHEEL_SLOT_MASK );
+
+		/* The timers in a slot are in no particular order. */
+		vListInsertEnd( &( xTimerWheel[ uxLevel ][ uxSlot ] ), &( pxTimer->xTimerListItem ) );
+		ulWheelSlotsInUse[ uxLevel ] |= ( uint32_t ) 1U << uxSlot;
+	}
+	/*-----------------------------------------------------------*/
+
+	static TickType_t prvGetNextWheelTime( BaseType_t * const pxWheelWasEmpty )
+	{
+	const TickType_t xNextTick = xLastWheelTick + ( TickType_t ) 1U;
+	TickType_t xTurn, xSlotTime, xTicksToSlot, xTicksToNext = 0;
+	UBaseType_t uxLevel, uxShift, uxFirst;
+	uint32_t ulInUse;
+
+		*pxWheelWasEmpty = pdTRUE;
+
+		for( uxLevel = 0; uxLevel < ( UBaseType_t ) tmrWHEEL_LEVELS; uxLevel++ )
 		{
-			/* Calculate the reload value, and if the reload value results in
-			the timer going into the same timer list then it has already expired
-			and the timer should be re-inserted into the current list so it is
-			processed again within this loop.  Otherwise a command should be sent
-			to restart the timer to ensure it is only inserted into a list after
-			the lists have been swapped. */
-			xReloadTime = ( xNextExpireTime + pxTimer->xTimerPeriodInTicks );
-			if( xReloadTime > xNextExpireTime )
+			if( ulWheelSlotsInUse[ uxLevel ] != 0U )
 			{
-				listSET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ), xReloadTime );
-				listSET_LIST_ITEM_OWNER( &( pxTimer->xTimerListItem ), pxTimer );
-				vListInsert( pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+				/* The turns of the level below, counted from the start of the
+				tick count, that begins on or after the next tick, and the
+				slot it falls in. */
+				uxShift = ( UBaseType_t ) ( tmrWHEEL_SLOT_BITS * uxLevel );
+				xTurn = xNextTick >> uxShift;
+
+				if( ( xNextTick & ( ( ( TickType_t ) 1U << uxShift ) - ( TickType_t ) 1U ) ) != ( TickType_t ) 0U )
+				{
+					xTurn++;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				uxFirst = ( UBaseType_t ) ( xTurn & tmrWHEEL_SLOT_MASK );
+
+				/* Rotate the bit map so the bit of that slot is bit 0, and the
+				lowest bit set is the next slot in use. */
+				ulInUse = ulWheelSlotsInUse[ uxLevel ];
+				ulInUse = ( ulInUse >> uxFirst ) | ( ulInUse << ( ( tmrWHEEL_SLOTS - uxFirst ) % tmrWHEEL_SLOTS ) );
+				xSlotTime = ( TickType_t ) ( xTurn + ( TickType_t ) prvLowestBit( ulInUse ) ) << uxShift;
+				xTicksToSlot = xSlotTime - xNextTick;
+
+				if( ( *pxWheelWasEmpty != pdFALSE ) || ( xTicksToSlot < xTicksToNext ) )
+				{
+					xTicksToNext = xTicksToSlot;
+					*pxWheelWasEmpty = pdFALSE;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
 			}
 			else
 			{
-				xResult = xTimerGenericCommand( pxTimer, tmrCOMMAND_START_DONT_TRACE, xNextExpireTime, NULL, tmrNO_DELAY );
-				configASSERT( xResult );
-				( void ) xResult;
+				mtCOVERAGE_TEST_MARKER();
 			}
 		}
-		else
+
+		return xNextTick + xTicksToNext;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvProcessTimerWheel( const TickType_t xTimeNow )
+	{
+	TickType_t xTick;
+	UBaseType_t uxLevel, uxShift, uxSlot;
+	BaseType_t xWheelWasEmpty;
+	List_t *pxSlot;
+
+		for( ;; )
 		{
-			mtCOVERAGE_TEST_MARKER();
+			/* Nothing happens on the ticks before the next tick the wheel has
+			something to do on, so it moves straight to that tick. */
+			xTick = prvGetNextWheelTime( &xWheelWasEmpty );
+
+			if( ( xWheelWasEmpty != pdFALSE ) || ( ( TickType_t ) ( xTick - xLastWheelTick ) > ( TickType_t ) ( xTimeNow - xLastWheelTick ) ) )
+			{
+				break;
+			}
+
+			xLastWheelTick = xTick - ( TickType_t ) 1U;
+
+			/* Where the tick starts a slot of a level above 0, move the timers
+			of that slot down, to a level the turn of which reaches their
+			expiry time from this tick. */
+			for( uxLevel = 1; uxLevel < ( UBaseType_t ) tmrWHEEL_LEVELS; uxLevel++ )
+			{
+				uxShift = ( UBaseType_t ) ( tmrWHEEL_SLOT_BITS * uxLevel );
+
+				if( ( xTick & ( ( ( TickType_t ) 1U << uxShift ) - ( TickType_t ) 1U ) ) != ( TickType_t ) 0U )
+				{
+					break;
+				}
+
+				uxSlot = ( UBaseType_t ) ( ( xTick >> uxShift ) & tmrWHEEL_SLOT_MASK );
+				pxSlot = &( xTimerWheel[ uxLevel ][ uxSlot ] );
+
+				while( listLIST_IS_EMPTY( pxSlot ) == pdFALSE )
+				{
+					Timer_t * const pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxSlot ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+
+					prvRemoveTimerFromActiveList( pxTimer );
+					prvInsertTimerInWheel( pxTimer );
+				}
+			}
+
+			/* Process all the timers that expire on the tick together.  An auto
+			reload timer is inserted again into a later slot. */
+			pxSlot = &( xTimerWheel[ 0 ][ xTick & tmrWHEEL_SLOT_MASK ] );
+
+			while( listLIST_IS_EMPTY( pxSlot ) == pdFALSE )
+			{
+				prvProcessExpiredTimer( xTick, xTimeNow );
+			}
+
+			xLastWheelTick = xTick;
 		}
+
+		/* No timer expires on the ticks up to now. */
+		xLastWheelTick = xTimeNow;
 	}
+	/*-----------------------------------------------------------*/
 
-	pxTemp = pxCurrentTimerList;
-	pxCurrentTimerList = pxOverflowTimerList;
-	pxOverflowTimerList = pxTemp;
-}
+	static UBaseType_t prvLowestBit( uint32_t ulValue )
+	{
+	UBaseType_t uxBit;
+
+		#if defined( __GNUC__ )
+		{
+			uxBit = ( UBaseType_t ) __builtin_ctz( ulValue );
+		}
+		#else
+		{
+		UBaseType_t uxShift;
+
+			/* A binary search, which takes the same five steps for any
+			value. */
+			uxBit = 0U;
+
+			for( uxShift = 16U; uxShift > 0U; uxShift >>= 1 )
+			{
+				if( ( ulValue & ( ( ( uint32_t ) 1U << uxShift ) - 1U ) ) == 0U )
+				{
+					ulValue >>= uxShift;
+					uxBit += uxShift;
+				}
+			}
+		}
+		#endif
+
+		return uxBit;
+	}
+
+#endif /* configUSE_TIMER_WHEEL */
 /*-----------------------------------------------------------*/
 
 static void prvCheckForValidListAndQueue( void )
@@ -922,10 +1271,31 @@ static void prvCheckForValidListAndQueue( void )
 	{
 		if( xTimerQueue == NULL )
 		{
-			vListInitialise( &xActiveTimerList1 );
-			vListInitialise( &xActiveTimerList2 );
-			pxCurrentTimerList = &xActiveTimerList1;
-			pxOverflowTimerList = &xActiveTimerList2;
+			#if( configUSE_TIMER_WHEEL == 0 )
+			{
+				vListInitialise( &xActiveTimerList1 );
+				vListInitialise( &xActiveTimerList2 );
+				pxCurrentTimerList = &xActiveTimerList1;
+				pxOverflowTimerList = &xActiveTimerList2;
+			}
+			#else
+			{
+			UBaseType_t uxLevel, uxSlot;
+
+				for( uxLevel = 0; uxLevel < ( UBaseType_t ) tmrWHEEL_LEVELS; uxLevel++ )
+				{
+					for( uxSlot = 0; uxSlot < ( UBaseType_t ) tmrWHEEL_SLOTS; uxSlot++ )
+					{
+						vListInitialise( &( xTimerWheel[ uxLevel ][ uxSlot ] ) );
+					}
+
+					ulWheelSlotsInUse[ uxLevel ] = 0U;
+				}
+
+				/* The tick before the first tick the wheel will process. */
+				xLastWheelTick = xTaskGetTickCount() - ( TickType_t ) 1U;
+			}
+			#endif
 
 			#if( configSUPPORT_STATIC_ALLOCATION == 1 )
 			{
@@ -282,3 +282,75 @@ BaseType_t CRYPTO_SignatureVerificationFinal( void * pvContext,
 
     return xResult;
 }
+
+/**
+ * @brief Copies the state of an in-progress hash to a byte array.
+ */
+BaseType_t CRYPTO_SignatureVerificationSave( void * pvContext,
+                                             uint8_t * pucState,
+                                             size_t xStateSize,
+                                             size_t * pxStateLength )
+{
+    BaseType_t xResult = pdFALSE;
+
+    if( pxStateLength != NULL )
+    {
+        *pxStateLength = sizeof( SignatureVerificationState_t );
+
+        if( pucState == NULL )
+        {
+            /* Only the length of the state was requested. */
+            xResult = pdTRUE;
+        }
+        else if( ( pvContext != NULL ) && ( xStateSize >= sizeof( SignatureVerificationState_t ) ) )
+        {
+            /* The hash contexts hold no pointers so the state is copied as is. */
+            memcpy( pucState, pvContext, sizeof( SignatureVerificationState_t ) );
+            xResult = pdTRUE;
+        }
+        else
+        {
+            /* No context or the buffer is too small for the state. */
+        }
+    }
+
+    return xResult;
+}
+
+/**
+ * @brief Creates signature verification context from a saved hash state.
+ */
+BaseType_t CRYPTO_SignatureVerificationRestore( void ** ppvContext,
+                                                const uint8_t * pucState,
+                                                size_t xStateLength )
+{
+    BaseType_t xResult = pdFALSE;
+    SignatureVerificationStatePtr_t pxCtx = NULL;
+    SignatureVerificationState_t xState;
+
+    if( ( ppvContext != NULL ) &&
+        ( pucState != NULL ) &&
+        ( xStateLength == sizeof( SignatureVerificationState_t ) ) )
+    {
+        memcpy( &xState, pucState, sizeof( xState ) );
+
+        /*
+         * Reject a state that was saved by a different build or was corrupted
+         */
+        if( ( ( cryptoASYMMETRIC_ALGORITHM_RSA == xState.xAsymmetricAlgorithm ) ||
+              ( cryptoASYMMETRIC_ALGORITHM_ECDSA == xState.xAsymmetricAlgorithm ) ) &&
+            ( ( cryptoHASH_ALGORITHM_SHA1 == xState.xHashAlgorithm ) ||
+              ( cryptoHASH_ALGORITHM_SHA256 == xState.xHashAlgorithm ) ) )
+        {
+            if( NULL != ( pxCtx = ( SignatureVerificationStatePtr_t ) pvPortMalloc(
+                              sizeof( *pxCtx ) ) ) ) /*lint !e9087 Allow casting void* to other types. */
+            {
+                memcpy( pxCtx, &xState, sizeof( *pxCtx ) );
+                *ppvContext = pxCtx;
+                xResult = pdTRUE;
+            }
+        }
+    }
+
+    return xResult;
+}
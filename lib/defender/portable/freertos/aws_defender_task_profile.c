@@ -0,0 +1,202 @@
+/*
+ * Amazon FreeRTOS Device Defender Agent V1.0.2
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "aws_defender_task_profile.h"
+
+static DefenderTaskProfile_t xTaskProfiles[ DEFENDER_MAX_TASK_PROFILES ];
+static int32_t lTaskProfileCount;
+static DefenderIsrProfile_t xIsrProfiles[ DEFENDER_MAX_ISR_PROFILES ];
+static int32_t lIsrProfileCount;
+
+int32_t TaskProfilesGet( DefenderTaskProfile_t const ** ppxProfiles )
+{
+    *ppxProfiles = xTaskProfiles;
+
+    return lTaskProfileCount;
+}
+
+int32_t IsrProfilesGet( DefenderIsrProfile_t const ** ppxProfiles )
+{
+    *ppxProfiles = xIsrProfiles;
+
+    return lIsrProfileCount;
+}
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+    /* The run time and switch count of each task and interrupt handler at the
+     * previous refresh, so a report covers only the period since.  Tasks are
+     * matched by their task number, which the kernel never reuses. */
+    typedef struct PreviousTaskProfile_s
+    {
+        UBaseType_t uxTaskNumber;
+        uint32_t ulRunTime;
+        uint32_t ulSwitchCount;
+    } PreviousTaskProfile_t;
+
+    static PreviousTaskProfile_t xPreviousTasks[ DEFENDER_MAX_TASK_PROFILES ];
+    static int32_t lPreviousTaskCount;
+    static uint32_t ulPreviousIsrRunTime[ configMAX_PROFILED_ISRS ];
+    static uint32_t ulPreviousIsrCount[ configMAX_PROFILED_ISRS ];
+    static uint32_t ulPreviousTotalRunTime;
+
+    static int32_t prvPermille( uint32_t ulPart,
+                                uint32_t ulTotal )
+    {
+        int32_t lPermille = 0;
+
+        if( 0 < ulTotal )
+        {
+            lPermille = ( int32_t ) ( ( ( uint64_t ) ulPart * 1000U ) / ulTotal );
+        }
+
+        return lPermille;
+    }
+
+    static void prvRefreshTasks( uint32_t ulPeriod )
+    {
+        UBaseType_t uxArraySize = uxTaskGetNumberOfTasks() + 2;
+        TaskStatus_t * pxStatus = pvPortMalloc( uxArraySize * sizeof( TaskStatus_t ) );
+        PreviousTaskProfile_t xCurrentTasks[ DEFENDER_MAX_TASK_PROFILES ];
+        int32_t lCount = 0;
+
+        if( NULL == pxStatus )
+        {
+            lTaskProfileCount = 0;
+
+            return;
+        }
+
+        uxArraySize = uxTaskGetSystemState( pxStatus, uxArraySize, NULL );
+
+        for( UBaseType_t uxI = 0; ( uxI < uxArraySize ) && ( lCount < DEFENDER_MAX_TASK_PROFILES ); ++uxI )
+        {
+            uint32_t ulPreviousRunTime = 0;
+            uint32_t ulPreviousSwitchCount = 0;
+
+            for( int32_t lJ = 0; lJ < lPreviousTaskCount; ++lJ )
+            {
+                if( xPreviousTasks[ lJ ].uxTaskNumber == pxStatus[ uxI ].xTaskNumber )
+                {
+                    ulPreviousRunTime = xPreviousTasks[ lJ ].ulRunTime;
+                    ulPreviousSwitchCount = xPreviousTasks[ lJ ].ulSwitchCount;
+                    break;
+                }
+            }
+
+            DefenderTaskProfile_t * pxProfile = &xTaskProfiles[ lCount ];
+            strncpy( pxProfile->cName, pxStatus[ uxI ].pcTaskName, DEFENDER_PROFILE_NAME_LENGTH - 1 );
+            pxProfile->cName[ DEFENDER_PROFILE_NAME_LENGTH - 1 ] = '\0';
+            pxProfile->lNumber = ( int32_t ) pxStatus[ uxI ].xTaskNumber;
+            pxProfile->lCpuPermille = prvPermille( pxStatus[ uxI ].ulRunTimeCounter - ulPreviousRunTime, ulPeriod );
+            pxProfile->lSwitches = ( int32_t ) ( pxStatus[ uxI ].ulSwitchCount - ulPreviousSwitchCount );
+            pxProfile->lMaxLatency = ( int32_t ) pxStatus[ uxI ].ulMaxWakeLatency;
+            pxProfile->lAvgLatency = ( int32_t ) pxStatus[ uxI ].ulAverageWakeLatency;
+            pxProfile->lStackFree = ( int32_t ) ( pxStatus[ uxI ].usStackHighWaterMark * sizeof( StackType_t ) );
+
+            xCurrentTasks[ lCount ].uxTaskNumber = pxStatus[ uxI ].xTaskNumber;
+            xCurrentTasks[ lCount ].ulRunTime = pxStatus[ uxI ].ulRunTimeCounter;
+            xCurrentTasks[ lCount ].ulSwitchCount = pxStatus[ uxI ].ulSwitchCount;
+            lCount++;
+        }
+
+        vPortFree( pxStatus );
+
+        memcpy( xPreviousTasks, xCurrentTasks, ( size_t ) lCount * sizeof( PreviousTaskProfile_t ) );
+        lPreviousTaskCount = lCount;
+        lTaskProfileCount = lCount;
+    }
+
+    static void prvRefreshIsrs( uint32_t ulPeriod )
+    {
+        ISRStatus_t xStatus[ configMAX_PROFILED_ISRS ];
+        UBaseType_t uxCount = uxTaskGetISRState( xStatus, configMAX_PROFILED_ISRS );
+        int32_t lCount = 0;
+
+        for( UBaseType_t uxI = 0; ( uxI < uxCount ) && ( lCount < DEFENDER_MAX_ISR_PROFILES ); ++uxI )
+        {
+            UBaseType_t uxISRNumber = xStatus[ uxI ].uxISRNumber;
+            DefenderIsrProfile_t * pxProfile = &xIsrProfiles[ lCount ];
+
+            if( NULL != xStatus[ uxI ].pcISRName )
+            {
+                strncpy( pxProfile->cName, xStatus[ uxI ].pcISRName, DEFENDER_PROFILE_NAME_LENGTH - 1 );
+                pxProfile->cName[ DEFENDER_PROFILE_NAME_LENGTH - 1 ] = '\0';
+            }
+            else
+            {
+                snprintf( pxProfile->cName, DEFENDER_PROFILE_NAME_LENGTH, "isr%u", ( unsigned ) uxISRNumber );
+            }
+
+            pxProfile->lNumber = ( int32_t ) uxISRNumber;
+            pxProfile->lCpuPermille = prvPermille( xStatus[ uxI ].ulRunTimeCounter - ulPreviousIsrRunTime[ uxISRNumber ], ulPeriod );
+            pxProfile->lCount = ( int32_t ) ( xStatus[ uxI ].ulCount - ulPreviousIsrCount[ uxISRNumber ] );
+            pxProfile->lMaxTime = ( int32_t ) xStatus[ uxI ].ulMaxRunTime;
+
+            ulPreviousIsrRunTime[ uxISRNumber ] = xStatus[ uxI ].ulRunTimeCounter;
+            ulPreviousIsrCount[ uxISRNumber ] = xStatus[ uxI ].ulCount;
+            lCount++;
+        }
+
+        lIsrProfileCount = lCount;
+    }
+
+    void TaskProfileRefresh( void )
+    {
+        uint32_t ulTotalRunTime;
+
+        #ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
+            portALT_GET_RUN_TIME_COUNTER_VALUE( ulTotalRunTime );
+        #else
+            ulTotalRunTime = portGET_RUN_TIME_COUNTER_VALUE();
+        #endif
+
+        uint32_t ulPeriod = ulTotalRunTime - ulPreviousTotalRunTime;
+        ulPreviousTotalRunTime = ulTotalRunTime;
+
+        prvRefreshTasks( ulPeriod );
+        prvRefreshIsrs( ulPeriod );
+
+        /* The latencies and longest handler runs are maxima since the last
+         * reset, so start the next period afresh. */
+        vTaskResetLatencyStats();
+    }
+
+#else /* if ( configUSE_TASK_PROFILING == 1 ) */
+
+    void TaskProfileRefresh( void )
+    {
+        /* Without configUSE_TASK_PROFILING the kernel keeps no profiles, so
+         * the report is empty. */
+        lTaskProfileCount = 0;
+        lIsrProfileCount = 0;
+    }
+
+#endif /* if ( configUSE_TASK_PROFILING == 1 ) */
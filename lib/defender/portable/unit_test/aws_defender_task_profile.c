@@ -0,0 +1,56 @@
+/*
+ * Amazon FreeRTOS Device Defender Agent V1.0.2
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+#include "aws_defender_task_profile.h"
+
+static DefenderTaskProfile_t const xTaskProfiles[] =
+{
+    { "IDLE", 1, 800, 12, 0, 0, 256 },
+    { "Defender", 2, 100, 3, 40, 25, 1024 },
+    { "Worker", 3, 60, 20, 8, 4, 512 },
+    { "Worker", 4, 40, 10, 16, 6, 512 },
+};
+
+static DefenderIsrProfile_t const xIsrProfiles[] =
+{
+    { "isr0", 0, 5, 100, 7 },
+};
+
+int32_t TaskProfilesGet( DefenderTaskProfile_t const ** ppxProfiles )
+{
+    *ppxProfiles = xTaskProfiles;
+
+    return ( int32_t ) ( sizeof( xTaskProfiles ) / sizeof( xTaskProfiles[ 0 ] ) );
+}
+
+int32_t IsrProfilesGet( DefenderIsrProfile_t const ** ppxProfiles )
+{
+    *ppxProfiles = xIsrProfiles;
+
+    return ( int32_t ) ( sizeof( xIsrProfiles ) / sizeof( xIsrProfiles[ 0 ] ) );
+}
+
+void TaskProfileRefresh( void )
+{
+}
@@ -0,0 +1,98 @@
+/*
+ * Amazon FreeRTOS Device Defender Agent V1.0.2
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+#include <stdio.h>
+
+#include "aws_defender_internals.h"
+
+/** Long enough for the decimal digits of any int32_t and the terminator */
+#define NUMBER_KEY_LENGTH    ( 12 )
+
+static struct DefenderMetric_s xDefenderTaskProfilesS =
+{
+    TaskProfileRefresh,
+    TaskProfileReportGet,
+};
+
+DefenderMetric_t xDefenderTaskProfiles = &xDefenderTaskProfilesS;
+
+CBORHandle_t TaskProfileReportGet( void )
+{
+    DefenderTaskProfile_t const * pxTasks = NULL;
+    DefenderIsrProfile_t const * pxIsrs = NULL;
+    int32_t lTaskCount = TaskProfilesGet( &pxTasks );
+    int32_t lIsrCount = IsrProfilesGet( &pxIsrs );
+
+    char cKey[ NUMBER_KEY_LENGTH ];
+
+    CBORHandle_t xTaskProfiles = CBOR_New( 0 );
+
+    for( int32_t lI = 0; lI < lTaskCount; ++lI )
+    {
+        CBORHandle_t xTask = CBOR_New( 0 );
+        CBOR_AppendKeyWithString( xTask, DEFENDER_NAME_TAG, pxTasks[ lI ].cName );
+        CBOR_AppendKeyWithInt(
+            xTask, DEFENDER_CPU_PERMILLE_TAG, pxTasks[ lI ].lCpuPermille );
+        CBOR_AppendKeyWithInt(
+            xTask, DEFENDER_SWITCHES_TAG, pxTasks[ lI ].lSwitches );
+        CBOR_AppendKeyWithInt(
+            xTask, DEFENDER_MAX_LATENCY_TAG, pxTasks[ lI ].lMaxLatency );
+        CBOR_AppendKeyWithInt(
+            xTask, DEFENDER_AVG_LATENCY_TAG, pxTasks[ lI ].lAvgLatency );
+        CBOR_AppendKeyWithInt(
+            xTask, DEFENDER_STACK_FREE_TAG, pxTasks[ lI ].lStackFree );
+
+        /* Task names need not be unique, so tasks are keyed by their number,
+         * which is, and carry their name inside. */
+        ( void ) snprintf( cKey, sizeof( cKey ), "%ld", ( long ) pxTasks[ lI ].lNumber );
+        CBOR_AppendKeyWithMap( xTaskProfiles, cKey, xTask );
+        CBOR_Delete( &xTask );
+    }
+
+    CBORHandle_t xIsrProfiles = CBOR_New( 0 );
+
+    for( int32_t lI = 0; lI < lIsrCount; ++lI )
+    {
+        CBORHandle_t xIsr = CBOR_New( 0 );
+        CBOR_AppendKeyWithString( xIsr, DEFENDER_NAME_TAG, pxIsrs[ lI ].cName );
+        CBOR_AppendKeyWithInt(
+            xIsr, DEFENDER_CPU_PERMILLE_TAG, pxIsrs[ lI ].lCpuPermille );
+        CBOR_AppendKeyWithInt( xIsr, DEFENDER_COUNT_TAG, pxIsrs[ lI ].lCount );
+        CBOR_AppendKeyWithInt(
+            xIsr, DEFENDER_MAX_TIME_TAG, pxIsrs[ lI ].lMaxTime );
+        ( void ) snprintf( cKey, sizeof( cKey ), "%ld", ( long ) pxIsrs[ lI ].lNumber );
+        CBOR_AppendKeyWithMap( xIsrProfiles, cKey, xIsr );
+        CBOR_Delete( &xIsr );
+    }
+
+    CBORHandle_t xTaskProfileReport = CBOR_New( 0 );
+    CBOR_AssignKeyWithMap(
+        xTaskProfileReport, DEFENDER_TASK_PROFILES_TAG, xTaskProfiles );
+    CBOR_Delete( &xTaskProfiles );
+    CBOR_AssignKeyWithMap(
+        xTaskProfileReport, DEFENDER_ISR_PROFILES_TAG, xIsrProfiles );
+    CBOR_Delete( &xIsrProfiles );
+
+    return xTaskProfileReport;
+}
@@ -210,6 +210,22 @@ extern "C" {
 	#define configUSE_TIMERS 0
 #endif
 
+#ifndef configUSE_TIMER_WHEEL
+	#define configUSE_TIMER_WHEEL 0
+#endif
+
+#ifndef configUSE_ATOMIC_BUILTINS
+	#define configUSE_ATOMIC_BUILTINS 0
+#endif
+
+#ifndef configRWLOCK_TRACKED_READERS
+	#define configRWLOCK_TRACKED_READERS 4
+#endif
+
+#if( configRWLOCK_TRACKED_READERS < 1 )
+	#error configRWLOCK_TRACKED_READERS must be at least 1.
+#endif
+
 #ifndef configUSE_COUNTING_SEMAPHORES
 	#define configUSE_COUNTING_SEMAPHORES 0
 #endif
@@ -292,6 +308,15 @@ extern "C" {
 	#define portPOINTER_SIZE_TYPE uint32_t
 #endif
 
+#ifndef configUSE_EVENT_TRACE
+	#define configUSE_EVENT_TRACE 0
+#endif
+
+#if ( configUSE_EVENT_TRACE == 1 )
+	/* Defines the trace macros of the events the built in recorder records. */
+	#include "event_trace.h"
+#endif
+
 /* Remove any unused trace macros. */
 #ifndef traceSTART
 	/* Used to perform any necessary initialisation - for example, open a file
@@ -786,6 +811,26 @@ extern "C" {
 	#define configUSE_TRACE_FACILITY 0
 #endif
 
+#ifndef configUSE_TASK_PROFILING
+	#define configUSE_TASK_PROFILING 0
+#endif
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+	#if ( configGENERATE_RUN_TIME_STATS != 1 )
+		#error If configUSE_TASK_PROFILING is set to 1 then configGENERATE_RUN_TIME_STATS must also be set to 1, as the profiles are measured with the run time counter.
+	#endif
+
+	#if ( configUSE_TRACE_FACILITY != 1 )
+		#error If configUSE_TASK_PROFILING is set to 1 then configUSE_TRACE_FACILITY must also be set to 1, as the task profiles are read with uxTaskGetSystemState().
+	#endif
+
+#endif /* configUSE_TASK_PROFILING */
+
+#ifndef configMAX_PROFILED_ISRS
+	#define configMAX_PROFILED_ISRS 8
+#endif
+
 #ifndef mtCOVERAGE_TEST_MARKER
 	#define mtCOVERAGE_TEST_MARKER()
 #endif
@@ -806,6 +851,32 @@ extern "C" {
 	#define configAPPLICATION_ALLOCATED_HEAP 0
 #endif
 
+#ifndef configUSE_HEAP_ACCOUNTING
+	#define configUSE_HEAP_ACCOUNTING 0
+#endif
+
+#ifndef configHEAP_ACCOUNTING_MAX_TASKS
+	#define configHEAP_ACCOUNTING_MAX_TASKS 16
+#endif
+
+#ifndef configHEAP_ACCOUNTING_MAX_CALL_SITES
+	#define configHEAP_ACCOUNTING_MAX_CALL_SITES 64
+#endif
+
+#ifndef configHEAP_ACCOUNTING_EVENT_COUNT
+	#define configHEAP_ACCOUNTING_EVENT_COUNT 256
+#endif
+
+#ifndef portHEAP_CALL_SITE
+	/* The address pvPortMalloc() returns to, which identifies the call site
+	for heap accounting. */
+	#if defined( __GNUC__ )
+		#define portHEAP_CALL_SITE() __builtin_return_address( 0 )
+	#else
+		#define portHEAP_CALL_SITE() NULL
+	#endif
+#endif
+
 #ifndef configUSE_TASK_NOTIFICATIONS
 	#define configUSE_TASK_NOTIFICATIONS 1
 #endif
@@ -1115,6 +1186,12 @@ typedef struct xSTATIC_TCB
 	#if ( configGENERATE_RUN_TIME_STATS == 1 )
 		uint32_t		ulDummy16;
 	#endif
+	#if ( configUSE_TASK_PROFILING == 1 )
+		uint64_t		ullDummy26;
+		uint32_t		ulDummy23[ 4 ];
+		UBaseType_t		uxDummy24;
+		uint8_t			ucDummy25;
+	#endif
 	#if ( configUSE_NEWLIB_REENTRANT == 1 )
 		struct	_reent	xDummy17;
 	#endif
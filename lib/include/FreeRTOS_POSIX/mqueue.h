@@ -74,6 +74,11 @@ int mq_getattr( mqd_t mqdes,
  *
  * @note Currently, only the following oflags are implemented: O_RDWR, O_CREAT,
  * O_EXCL, and O_NONBLOCK. Also, mode is ignored.
+ *
+ * @note A queue holds mq_maxmsg messages of mq_msgsize bytes. Each message
+ * takes only its own length, so more shorter messages fit. At most
+ * posixconfigMQ_MAX_QUEUES queues exist at one time; mq_open fails with
+ * ENOSPC once they do.
  */
 mqd_t mq_open( const char * name,
                int oflag,
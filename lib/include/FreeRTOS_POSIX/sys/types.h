@@ -114,6 +114,20 @@ typedef void                * pthread_barrierattr_t;
     typedef PthreadMutexAttrType_t  pthread_mutexattr_t;
 #endif
 
+/**
+ * @brief Used for reader-writer locks.
+ */
+#if !defined( posixconfigENABLE_PTHREAD_RWLOCK_T ) || ( posixconfigENABLE_PTHREAD_RWLOCK_T == 1 )
+    typedef PthreadRWLockType_t  pthread_rwlock_t;
+#endif
+
+/**
+ * @brief Used to identify a reader-writer lock attribute object.
+ */
+#if !defined( posixconfigENABLE_PTHREAD_RWLOCKATTR_T ) || ( posixconfigENABLE_PTHREAD_RWLOCKATTR_T == 1 )
+    typedef void            * pthread_rwlockattr_t;
+#endif
+
 /**
  * @brief Used to identify a thread.
  */
@@ -94,4 +94,39 @@ BaseType_t CRYPTO_SignatureVerificationFinal( void * pvContext,
                                               uint8_t * pucSignature,
                                               size_t xSignatureLength );
 
+/**
+ * @brief Saves the state of an in-progress hash computation so that it can be
+ * continued later, e.g. after a reset.
+ *
+ * The context remains valid and can still be updated after it is saved. The
+ * state is only meaningful to the same build of the software. Its length is
+ * the same for all contexts, so it can be queried with a NULL context.
+ *
+ * @param[in] pvContext Opaque context structure.
+ * @param[out] pucState Buffer to receive the state or NULL to query its length.
+ * @param[in] xStateSize Size in bytes of pucState.
+ * @param[out] pxStateLength Length in bytes of the state.
+ *
+ * @return pdTRUE if the state was saved or its length returned, pdFALSE if
+ * the buffer is too small.
+ */
+BaseType_t CRYPTO_SignatureVerificationSave( void * pvContext,
+                                             uint8_t * pucState,
+                                             size_t xStateSize,
+                                             size_t * pxStateLength );
+
+/**
+ * @brief Creates signature verification context from a state previously
+ * saved with CRYPTO_SignatureVerificationSave.
+ *
+ * @param[out] ppvContext Opaque context structure.
+ * @param[in] pucState Saved state.
+ * @param[in] xStateLength Length in bytes of the saved state.
+ *
+ * @return pdTRUE if the context was created, pdFALSE otherwise.
+ */
+BaseType_t CRYPTO_SignatureVerificationRestore( void ** ppvContext,
+                                                const uint8_t * pucState,
+                                                size_t xStateLength );
+
 #endif /* ifndef __AWS_CRYPTO__H__ */
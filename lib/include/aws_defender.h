@@ -85,11 +85,23 @@ typedef enum
 } DefenderReportStatus_t;
 
 /** Maximum number of reportable metrics */
-#define DEFENDER_MAX_METRICS_COUNT    ( 1 )
+#define DEFENDER_MAX_METRICS_COUNT    ( 2 )
 
 /** Provides a count of established tcp connections */
 extern DefenderMetric_t xDefenderTCPConnections;
 
+/**
+ * Provides the share of the CPU, switch count, wake latencies and stack high
+ * water mark of each task, and the share of the CPU, run count and longest run
+ * of each profiled interrupt handler, over the reporting period.
+ * @note On FreeRTOS, configUSE_TASK_PROFILING must be set to 1, and interrupt
+ * handlers are profiled with ulTaskProfileISREnter() and vTaskProfileISRExit().
+ * The task and interrupt handler profiles are not metrics the AWS IoT Device
+ * Defender service defines, so they are only for reports read by the device's
+ * own tooling, such as a rule that forwards them.
+ */
+extern DefenderMetric_t xDefenderTaskProfiles;
+
 /**
  * @param pxMetricsList List of the metrics to put in the report
  * @return DefenderErr_t
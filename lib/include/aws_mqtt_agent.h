@@ -115,7 +115,8 @@ typedef struct MQTTAgentCallbackParams
  * The user should take the ownership of the buffer containing the received message from the
  * broker by returning pdTRUE from the callback if the user wants to use the buffer after
  * the callback is over. The user should return the buffer whenever done by calling the
- * MQTT_AGENT_ReturnBuffer API.
+ * MQTT_AGENT_ReturnBuffer API. If xBuffer is NULL, the message was delivered in place, the
+ * return value is ignored and MQTT_AGENT_ClonePublishData must be used to keep the message.
  *
  * @see MQTTAgentCallbackParams_t.
  */
@@ -186,6 +187,40 @@ typedef struct MQTTAgentPublishParams
     uint32_t ulDataLength;    /**< Length of the data. */
 } MQTTAgentPublishParams_t;
 
+/**
+ * @brief Counters of the outbound writes of an MQTT client.
+ *
+ * Each flush writes the packets accumulated in the batch buffer (see
+ * mqttconfigTX_BATCH_BUFFER_SIZE) with one send call. ulPackets / ulFlushes
+ * is therefore the average number of packets per TLS record.
+ */
+typedef struct MQTTAgentTxStatistics
+{
+    uint32_t ulFlushes; /**< Number of send calls made. */
+    uint32_t ulPackets; /**< Number of MQTT packets written by those calls. */
+    uint32_t ulBytes;   /**< Number of bytes written by those calls. */
+} MQTTAgentTxStatistics_t;
+
+/**
+ * @brief Signature of the callback invoked when a publish issued with
+ * MQTT_AGENT_PublishAsync completes.
+ *
+ * The callback runs in the context of the MQTT task, or of the task calling
+ * MQTT_AGENT_Delete for the publishes that call completes, and therefore must
+ * not call any MQTT agent API and should return quickly.
+ *
+ * @param[in] pvCallbackContext The context supplied to MQTT_AGENT_PublishAsync.
+ * @param[in] pxPublishParams The publish parameters supplied to MQTT_AGENT_PublishAsync.
+ * The caller may free or reuse them, and the data they point to, once this callback
+ * has been invoked.
+ * @param[in] xResult eMQTTAgentSuccess if the PUBACK was received (or the message was
+ * sent in case of QoS0), eMQTTAgentTimeout if the PUBACK was not received within the
+ * timeout, eMQTTAgentFailure otherwise.
+ */
+typedef void ( * MQTTAgentPublishCompleteCallback_t )( void * pvCallbackContext,
+                                                       const MQTTAgentPublishParams_t * const pxPublishParams,
+                                                       MQTTAgentReturnCode_t xResult );
+
 /**
  * @brief MQTT library Init function.
  *
@@ -220,6 +255,9 @@ MQTTAgentReturnCode_t MQTT_AGENT_Create( MQTTAgentHandle_t * const pxMQTTHandle
  * call MQTT_AGENT_Disconnect API to make sure that the client is disconnected before
  * deleting it.
  *
+ * Asynchronous publishes which are still waiting to be re-sent after a lost connection are
+ * completed with eMQTTAgentFailure, and their completion callbacks run in the calling task.
+ *
  * @param[in] xMQTTHandle The opaque handle as returned from MQTT_AGENT_Create.
  *
  * @return eMQTTAgentSuccess if the client is successfully deleted, otherwise an
@@ -339,6 +377,72 @@ MQTTAgentReturnCode_t MQTT_AGENT_Publish( MQTTAgentHandle_t xMQTTHandle,
                                           const MQTTAgentPublishParams_t * const pxPublishParams,
                                           TickType_t xTimeoutTicks );
 
+/**
+ * @brief Publishes a message to a given topic without waiting for the PUBACK.
+ *
+ * The message is handed over to the MQTT task and this function returns as soon
+ * as the request is queued. The result is reported later through pxCompleteCallback.
+ * Up to mqttconfigMAX_INFLIGHT_PUBLISHES publishes per client may be outstanding; if
+ * the window is full, the calling task blocks for up to xTimeoutTicks for an earlier
+ * publish to complete.
+ *
+ * If the connection to the broker is lost while publishes are in-flight, they are
+ * re-sent once MQTT_AGENT_Connect succeeds again, provided their timeout has not
+ * expired. In-flight publishes are failed if MQTT_AGENT_Disconnect is called.
+ *
+ * @warning Unlike MQTT_AGENT_Publish, the data is not copied before this function
+ * returns. pxPublishParams and the topic and data it points to must remain valid
+ * until pxCompleteCallback is invoked.
+ *
+ * @param[in] xMQTTHandle The opaque handle as returned from MQTT_AGENT_Create.
+ * @param[in] pxPublishParams Publish parameters.
+ * @param[in] pxCompleteCallback Callback invoked when the publish completes. Can be NULL.
+ * @param[in] pvCallbackContext Passed as it is to pxCompleteCallback. Can be NULL.
+ * @param[in] xTimeoutTicks Maximum time in ticks to wait for space in the window and,
+ * once sent, for the PUBACK. Use pdMS_TO_TICKS macro to convert milliseconds to ticks.
+ *
+ * @return eMQTTAgentSuccess if the publish was queued, in which case pxCompleteCallback
+ * is guaranteed to be invoked exactly once. Otherwise an error code explaining the
+ * reason of the failure is returned and pxCompleteCallback is not invoked.
+ */
+MQTTAgentReturnCode_t MQTT_AGENT_PublishAsync( MQTTAgentHandle_t xMQTTHandle,
+                                               const MQTTAgentPublishParams_t * const pxPublishParams,
+                                               MQTTAgentPublishCompleteCallback_t pxCompleteCallback,
+                                               void * pvCallbackContext,
+                                               TickType_t xTimeoutTicks );
+
+/**
+ * @brief Retrieves the outbound write counters of an MQTT client.
+ *
+ * The counters are cumulative since MQTT_AGENT_Create.
+ *
+ * @param[in] xMQTTHandle The opaque handle as returned from MQTT_AGENT_Create.
+ * @param[out] pxTxStatistics The counters.
+ *
+ * @return eMQTTAgentSuccess.
+ */
+MQTTAgentReturnCode_t MQTT_AGENT_GetTxStatistics( MQTTAgentHandle_t xMQTTHandle,
+                                                  MQTTAgentTxStatistics_t * const pxTxStatistics );
+
+/**
+ * @brief Copies the publish message provided in the publish callback to a buffer.
+ *
+ * A publish message delivered in place (xBuffer in MQTTPublishData_t is NULL, see
+ * mqttconfigENABLE_ZERO_COPY_PUBLISH) is only valid until the callback returns. The
+ * user can call this API from the callback to copy it to a buffer which the user
+ * should return whenever done by calling the MQTT_AGENT_ReturnBuffer API.
+ *
+ * @param[in] xMQTTHandle The opaque handle as returned from MQTT_AGENT_Create.
+ * @param[in] pxPublishData The publish data provided in the callback.
+ * @param[out] pxClonedPublishData The copy of the publish data.
+ *
+ * @return eMQTTAgentSuccess if the copy succeeds, eMQTTAgentFailure if no large enough
+ * buffer is available.
+ */
+MQTTAgentReturnCode_t MQTT_AGENT_ClonePublishData( MQTTAgentHandle_t xMQTTHandle,
+                                                   const MQTTPublishData_t * const pxPublishData,
+                                                   MQTTPublishData_t * const pxClonedPublishData );
+
 /**
  * @brief Returns the buffer provided in the publish callback.
  *
@@ -256,7 +256,7 @@ typedef struct MQTTPublishData
     uint16_t usTopicLength;     /**< Length of the topic. */
     const void * pvData;        /**< The received message. */
     uint32_t ulDataLength;      /**< Length of the message. */
-    MQTTBufferHandle_t xBuffer; /**< The buffer containing the whole MQTT message. Both pcTopic and pvData are pointers to the locations in this buffer. */
+    MQTTBufferHandle_t xBuffer; /**< The buffer containing the whole MQTT message. Both pcTopic and pvData are pointers to the locations in this buffer. NULL if the message was delivered in place, see mqttconfigENABLE_ZERO_COPY_PUBLISH. */
 } MQTTPublishData_t;
 
 /**
@@ -317,7 +317,8 @@ typedef struct MQTTCallbackParams
  * The user should take the ownership of the buffer containing the received message from the
  * broker by returning eMQTTTrue from the callback if the user wants to use the buffer after
  * the callback is over. The user should return the buffer whenever done by calling the
- * MQTT_ReturnBuffer API.
+ * MQTT_ReturnBuffer API. If xBuffer is NULL, the message was delivered in place, the
+ * return value is ignored and MQTT_ClonePublishData must be used to keep the message.
  */
 typedef MQTTBool_t ( * MQTTEventCallback_t )( void * pvCallbackContext,
                                               const MQTTEventCallbackParams_t * const pxParams );
@@ -344,7 +345,8 @@ typedef MQTTBool_t ( * MQTTEventCallback_t )( void * pvCallbackContext,
  * The user should take the ownership of the buffer containing the received message from the
  * broker by returning eMQTTTrue from the callback if the user wants to use the buffer after
  * the callback is over. The user should return the buffer whenever done by calling the
- * MQTT_ReturnBuffer API.
+ * MQTT_ReturnBuffer API. If xBuffer is NULL, the message was delivered in place, the
+ * return value is ignored and MQTT_ClonePublishData must be used to keep the message.
  */
 #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
 
@@ -411,19 +413,30 @@ typedef uint8_t * ( * MQTTGetFreeBuffer_t )( uint32_t * pulBufferLength );
 typedef void ( * MQTTReturnBuffer_t )( uint8_t * pucBuffer );
 
 /**
- * @brief Represents a subscription entry in the subscription manager.
+ * @brief Represents one topic level in the subscription manager.
+ *
+ * Topic filters are stored as a tree of topic levels. Literal levels are
+ * found through a hash table keyed on the parent node and the name of the
+ * level while the '+' and '#' levels, if any, are referenced directly from
+ * the node. A subscription is stored on the node for the last level of its
+ * topic filter.
  */
 #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
 
-    typedef struct MQTTSubscription
+    typedef struct MQTTSubscriptionNode
     {
-        uint8_t ucTopicFilter[ mqttconfigSUBSCRIPTION_MANAGER_MAX_TOPIC_LENGTH ]; /**< The topic filter this subscription entry is for. */
-        uint16_t usTopicFilterLength;                                             /**< The length of the topic filter. */
-        void * pvPublishCallbackContext;                                          /**< The callback context supplied by the user while subscribing. */
-        MQTTPublishCallback_t pxPublishCallback;                                  /**< The callback associated with this subscription. */
-        MQTTBool_t xInUse;                                                        /**< Tracks whether the subscription entry is in-use. */
-        MQTTTopicFilterType_t xTopicFilterType;                                   /**< The type of the topic filter. */
-    } MQTTSubscription_t;
+        void * pvPublishCallbackContext;         /**< The callback context supplied by the user while subscribing. */
+        MQTTPublishCallback_t pxPublishCallback; /**< The callback associated with the subscription stored on this node. */
+        uint16_t usParent;                       /**< Index of the parent node. */
+        uint16_t usNextInBucket;                 /**< Index of the next literal node in the same hash bucket or the next free node. */
+        uint16_t usLiteralChildren;              /**< Number of literal children. */
+        uint16_t usSingleLevelChild;             /**< Index of the '+' child. */
+        uint16_t usMultiLevelChild;              /**< Index of the '#' child. */
+        uint16_t usLevelOffset;                  /**< Offset of the name of this topic level in the level arena. */
+        uint16_t usLevelLength;                  /**< Length of the name of this topic level. */
+        uint8_t ucLevelHash;                     /**< Low byte of the hash of the name of this topic level used to skip mismatching nodes quickly. */
+        uint8_t ucFlags;                         /**< Type of this topic level and whether a subscription is stored on it. */
+    } MQTTSubscriptionNode_t;
 
 #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
 
@@ -435,8 +448,12 @@ typedef void ( * MQTTReturnBuffer_t )( uint8_t * pucBuffer );
 
     typedef struct MQTTSubscriptionManager
     {
-        MQTTSubscription_t xSubscriptions[ mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ]; /**< User subscriptions. */
-        uint32_t ulInUseSubscriptions;                                                         /**< Number of subscription entries currently in use. */
+        MQTTSubscriptionNode_t xNodes[ mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES ];   /**< Topic level nodes. The first one is the root. */
+        uint8_t ucLevelArena[ mqttconfigSUBSCRIPTION_MANAGER_LEVEL_ARENA_SIZE ];     /**< Names of the literal topic levels. */
+        uint16_t usLiteralBuckets[ mqttconfigSUBSCRIPTION_MANAGER_LITERAL_BUCKETS ]; /**< Index of the first literal node of each hash bucket. */
+        uint16_t usLevelArenaUsed;                                                   /**< Number of bytes in use in the level arena. */
+        uint16_t usFreeNode;                                                         /**< Index of the first free node. */
+        uint32_t ulInUseSubscriptions;                                               /**< Number of subscriptions currently stored. */
     } MQTTSubscriptionManager_t;
 
 #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
@@ -488,6 +505,8 @@ typedef struct MQTTContext
     uint32_t ulNextPeriodicInvokeTicks;                         /**< The time interval in ticks after which MQTT_Periodic function must be called. */
     uint32_t ulKeepAliveActualIntervalTicks;                    /**< The time interval in ticks after which a keep alive message should be sent. */
     uint32_t ulPingRequestTimeoutTicks;                         /**< The time interval in ticks to wait for PINGRESP after sending PINGREQ. */
+    uint32_t ulKeepAliveMaxIdleTicks;                           /**< The maximum time interval in ticks between two transmitted packets when received data defers keep alive messages. 0 if received data does not defer them. */
+    uint64_t xLastTransmissionTimestamp;                        /**< The timestamp when the last packet was transmitted. */
     MQTTBool_t xWaitingForPingResp;                             /**< Whether a keep alive message has been sent and we are waiting for response from the broker. */
     #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
         MQTTSubscriptionManager_t xSubscriptionManager;         /**< The subscription manager used to keep track of user subscriptions and topic specific callbacks.*/
@@ -519,6 +538,7 @@ typedef struct MQTTConnectParams
     uint16_t usKeepAliveIntervalSeconds;     /**< The maximum time interval (in seconds) permitted to elapse between two control packets transmitted. */
     uint32_t ulKeepAliveActualIntervalTicks; /**< The time interval in ticks after which a keep alive message should be sent. Note that keep alive messages are sent only if nothing else is sent. */
     uint32_t ulPingRequestTimeoutTicks;      /**< The time interval in ticks to wait for PINGRESP after sending PINGREQ. */
+    uint32_t ulKeepAliveMaxIdleTicks;        /**< If not 0, data received from the broker restarts ulKeepAliveActualIntervalTicks, but a keep alive message is still sent if nothing has been sent for this many ticks. Must be less than usKeepAliveIntervalSeconds. Requires the get ticks function. */
     const uint8_t * pucClientId;             /**< Client Id identifies the client to the server. Must be unique per broker. */
     uint16_t usClientIdLength;               /**< The length of the client Id. */
     const uint8_t * pucUserName;             /**< The user name. */
@@ -702,6 +722,27 @@ MQTTReturnCode_t MQTT_ParseReceivedData( MQTTContext_t * pxMQTTContext,
                                          const uint8_t * pucReceivedData,
                                          size_t xReceivedDataLength );
 
+/**
+ * @brief Copies the publish message provided in the publish callback to a buffer.
+ *
+ * A publish message delivered in place (xBuffer in MQTTPublishData_t is NULL, see
+ * mqttconfigENABLE_ZERO_COPY_PUBLISH) is only valid until the callback returns. The
+ * user can call this API from the callback to copy the topic and payload to a buffer
+ * obtained from the buffer pool. The copy is owned by the user who should return it
+ * whenever done by calling the MQTT_ReturnBuffer API.
+ *
+ * @param[in] pxMQTTContext The initialized MQTT context.
+ * @param[in] pxPublishData The publish data provided in the callback.
+ * @param[out] pxClonedPublishData The copy of the publish data. Its xBuffer member is
+ * the buffer containing the copied topic and payload.
+ *
+ * @return eMQTTSuccess if the copy succeeds, eMQTTNoFreeBuffer if no large enough
+ * buffer is available.
+ */
+MQTTReturnCode_t MQTT_ClonePublishData( MQTTContext_t * pxMQTTContext,
+                                        const MQTTPublishData_t * const pxPublishData,
+                                        MQTTPublishData_t * const pxClonedPublishData );
+
 /**
  * @brief Returns the buffer provided in the publish callback.
  *
@@ -154,6 +154,10 @@ typedef uint32_t OTA_Err_t;
 #define kOTA_Err_UserAbort               0x28000000UL     /*!< User aborted the active OTA. */
 #define kOTA_Err_ResetNotSupported       0x29000000UL     /*!< We tried to reset the device but the device doesn't support it. */
 #define kOTA_Err_TopicTooLarge           0x2a000000UL     /*!< Attempt to build a topic string larger than the supplied buffer. */
+#define kOTA_Err_NoCheckpoint            0x2b000000UL     /*!< The PAL has no checkpoint of a partially received file. */
+#define kOTA_Err_CheckpointFailed        0x2c000000UL     /*!< The PAL failed to store the checkpoint of a partially received file. */
+#define kOTA_Err_FileNotSupported        0x2d000000UL     /*!< The file attributes call for a feature that is not enabled. */
+#define kOTA_Err_BaseImageMismatch       0x2e000000UL     /*!< The running image is not the base image of the delta file. */
 
 /**
  * @brief OTA Job callback events.
@@ -206,6 +210,15 @@ typedef enum
 } OTA_ImageState_t;
 
 
+/**
+ * @brief OTA file attributes.
+ *
+ * Bits of the optional "attr" field of a file in the OTA job document. The low
+ * byte is left for platform specific attributes.
+ */
+#define OTA_FILE_ATTR_COMPRESSED    0x00000100UL /*!< The file is streamed compressed. See otaconfigDECOMPRESS_WINDOW_BITS. */
+
+
 /**
  * @brief OTA File Context Information.
  *
@@ -233,7 +246,10 @@ typedef struct
     uint8_t * pucJobName;        /*!< The job name associated with this file from the job service. */
     uint8_t * pucStreamName;     /*!< The stream associated with this file from the OTA service. */
     Sig256_t * pxSignature;      /*!< Pointer to the file's signature structure. */
+    Sig256_t * pxBaseHash;       /*!< SHA-256 hash of the image a delta file applies to, or NULL if the file is not a delta file. */
     uint8_t * pucRxBlockBitmap;  /*!< Bitmap of blocks received (for de-duping and missing block request). */
+    void * pvSigVerifyContext;   /*!< Signature verification context the PAL may start to hash the file as it is received. */
+    uint32_t ulHashedBytes;      /*!< Number of bytes from the start of the file included in pvSigVerifyContext. */
     uint8_t * pucCertFilepath;   /*!< Pathname of the certificate file used to validate the receive file. */
     uint32_t ulUpdaterVersion;   /*!< Used by OTA self-test detection, the version of FW that did the update. */
     bool_t xIsInSelfTest;        /*!< True if the job is in self test mode. */
@@ -271,6 +287,20 @@ typedef struct
  */
 typedef void (* pxOTACompleteCallback_t)( OTA_JobEvent_t eEvent );
 
+
+/**
+ * @brief Download statistics of one block size.
+ *
+ * See OTA_GetBlockSizeStatistics().
+ */
+typedef struct
+{
+    uint32_t ulMessages; /*!< Number of stream messages received with blocks of this size. */
+    uint32_t ulBytes;    /*!< Number of file bytes in those messages, including duplicates. */
+    uint32_t ulRetries;  /*!< Number of times lost blocks were requested again while this size was requested. */
+    uint32_t ulTimeMs;   /*!< Time spent downloading while this size was requested, in milliseconds. */
+} OTA_BlockSizeStatistics_t;
+
 /*---------------------------------------------------------------------------*/
 /*								Public API									 */
 /*---------------------------------------------------------------------------*/
@@ -410,4 +440,43 @@ uint32_t OTA_GetPacketsProcessed( void );
  */
 uint32_t OTA_GetPacketsDropped( void );
 
+/**
+ * @brief Get the number of file bytes the OTA agent did not have to download
+ * again because it resumed a partially received file from a checkpoint.
+ *
+ * @note Calling OTA_AgentInit() will reset this statistic.
+ *
+ * @return The number of bytes that were already received when downloads were
+ * resumed. This is always 0 if otaconfigCHECKPOINT_INTERVAL_BLOCKS is 0.
+ */
+uint32_t OTA_GetResumedBytes( void );
+
+/**
+ * @brief Get the size of the blocks the OTA agent requests from the stream service.
+ *
+ * The block size changes while a file is downloaded, between OTA_FILE_BLOCK_SIZE and
+ * 2^otaconfigMAX_LOG2_FILE_BLOCK_SIZE bytes, depending on how many blocks are lost.
+ *
+ * @return The block size in bytes.
+ */
+uint32_t OTA_GetBlockSize( void );
+
+/**
+ * @brief Get the download statistics of a block size.
+ *
+ * Comparing the bytes received per second of each block size shows the effect of the
+ * block size on the download rate of the link.
+ *
+ * @note Calling OTA_AgentInit() will reset these statistics. The time of a block size
+ * is added when the agent changes to another size and when a download completes.
+ *
+ * @param[in] ulBlockSize The block size in bytes.
+ * @param[out] pxStats Receives the statistics.
+ *
+ * @return pdTRUE if the agent may request blocks of this size, otherwise pdFALSE and
+ * pxStats is not changed.
+ */
+BaseType_t OTA_GetBlockSizeStatistics( uint32_t ulBlockSize,
+                                       OTA_BlockSizeStatistics_t * pxStats );
+
 #endif /* ifndef _AWS_OTA_AGENT_H_ */
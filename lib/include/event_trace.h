@@ -0,0 +1,186 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * A recorder of kernel events into a ring of fixed size binary records, built
+ * into the kernel when configUSE_EVENT_TRACE is set to 1 in FreeRTOSConfig.h.
+ * FreeRTOS.h then includes this header, which defines the trace macros of the
+ * events below to record them, so it must not be used with another recorder.
+ *
+ * Each record is 16 bytes and is stamped with portEVENT_TRACE_TIMESTAMP(),
+ * ideally a free running cycle counter such as the DWT cycle counter of a
+ * Cortex-M.  The kernel writes the records with interrupts masked for only as
+ * long as it takes to fill one in, and a single reader, usually a low priority
+ * task, moves them out with xEventTraceRead() or xEventTraceDrain() without
+ * ever blocking the kernel.  When the ring is full new records are dropped,
+ * and their number is recorded once there is space again.
+ *
+ * tools/event_trace decodes the records on a host.
+ */
+
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h must appear in source files before include event_trace.h"
+#endif
+
+#if defined( __cplusplus )
+extern "C" {
+#endif
+
+#if( configUSE_TRACE_FACILITY != 1 )
+	#error configUSE_EVENT_TRACE needs the task numbers of the trace facility, so configUSE_TRACE_FACILITY must be set to 1.
+#endif
+
+#ifndef configEVENT_TRACE_RECORDS
+	#define configEVENT_TRACE_RECORDS 256
+#endif
+
+#if( ( configEVENT_TRACE_RECORDS < 4 ) || ( ( configEVENT_TRACE_RECORDS & ( configEVENT_TRACE_RECORDS - 1 ) ) != 0 ) )
+	#error configEVENT_TRACE_RECORDS must be a power of 2 of at least 4.
+#endif
+
+#ifndef portEVENT_TRACE_TIMESTAMP
+	#if( configGENERATE_RUN_TIME_STATS == 1 )
+		#define portEVENT_TRACE_TIMESTAMP() ( ( uint32_t ) portGET_RUN_TIME_COUNTER_VALUE() )
+	#else
+		#error configUSE_EVENT_TRACE needs a time stamp, so define portEVENT_TRACE_TIMESTAMP() to return a 32-bit counter, ideally of cycles.
+	#endif
+#endif
+
+#if defined( traceTASK_SWITCHED_IN ) || defined( traceQUEUE_SEND ) || defined( traceMALLOC )
+	#error configUSE_EVENT_TRACE defines the trace macros itself, so it cannot be used with another recorder.
+#endif
+
+/* The events that are recorded, in the ucEvent member of a record. */
+#define eventtraceTASK_CREATE			( ( uint8_t ) 1 )	/* usTask was created.  ulObject and ulValue hold the first 8 characters of its name. */
+#define eventtraceTASK_DELETE			( ( uint8_t ) 2 )	/* usTask was deleted. */
+#define eventtraceTASK_SWITCHED_IN		( ( uint8_t ) 3 )	/* usTask was selected to run.  ulValue is its priority. */
+#define eventtraceTASK_READY			( ( uint8_t ) 4 )	/* usTask was moved to the ready list. */
+#define eventtraceQUEUE_SEND			( ( uint8_t ) 5 )	/* An item was sent to queue ulObject, or a semaphore given, by the running task.  ulValue is the number of items in the queue before. */
+#define eventtraceQUEUE_SEND_FROM_ISR	( ( uint8_t ) 6 )	/* As eventtraceQUEUE_SEND, from an interrupt. */
+#define eventtraceQUEUE_RECEIVE			( ( uint8_t ) 7 )	/* An item was received from queue ulObject, or a semaphore taken, by the running task.  ulValue is the number of items in the queue before. */
+#define eventtraceQUEUE_RECEIVE_FROM_ISR	( ( uint8_t ) 8 )	/* As eventtraceQUEUE_RECEIVE, from an interrupt. */
+#define eventtraceMALLOC				( ( uint8_t ) 9 )	/* ulValue bytes, including the block header, were allocated at address ulObject, which is 0 if the allocation failed. */
+#define eventtraceFREE					( ( uint8_t ) 10 )	/* The block of ulValue bytes at address ulObject was freed. */
+#define eventtraceDROPPED				( ( uint8_t ) 11 )	/* ulValue records were dropped because the ring was full. */
+#define eventtraceSTART					( ( uint8_t ) 12 )	/* The first record of the ring, with a time stamp of 0.  ulObject is eventtraceBYTE_ORDER_MARK and ulValue is configEVENT_TRACE_RECORDS. */
+
+/* Recorded in the eventtraceSTART record, from which a decoder tells the byte
+order of the target. */
+#define eventtraceBYTE_ORDER_MARK		( ( uint32_t ) 0x01020304UL )
+
+/*
+ * A recorded event.  For the queue events ucInfo is the queue type, one of the
+ * queueQUEUE_TYPE_ values in queue.h, so semaphores and mutexes can be told
+ * from queues.  Objects are identified by the low 32 bits of their address.
+ * The records are in the byte order of the target, which the eventtraceSTART
+ * record at the start of the ring tells.
+ */
+typedef struct xEVENT_TRACE_RECORD
+{
+	uint32_t ulTimestamp;	/* The value of portEVENT_TRACE_TIMESTAMP() when the event was recorded. */
+	uint8_t ucEvent;		/* One of the eventtrace values above. */
+	uint8_t ucInfo;			/* The queue type for the queue events, otherwise 0. */
+	uint16_t usTask;		/* The task number, from the trace facility, of the task events, otherwise 0. */
+	uint32_t ulObject;		/* The object of the event, see above. */
+	uint32_t ulValue;		/* A value that depends on the event, see above. */
+} EventTraceRecord_t;
+
+/*
+ * Called by xEventTraceDrain() with the records that are ready, in at most two
+ * spans of the ring.  It returns the number of bytes written, which must be
+ * xLength unless it is a multiple of sizeof( EventTraceRecord_t ).  The records
+ * not written are passed again on the next call of xEventTraceDrain().
+ */
+typedef size_t ( *EventTraceWriter_t )( void *pvContext, const uint8_t *pucData, size_t xLength );
+
+/*
+ * Record an event.  Called by the trace macros below, from tasks and from
+ * interrupts, and can be called by the application to add events of its own,
+ * with ucEvent values above 127 so that future kernel events don't clash.
+ */
+void vEventTraceRecord( uint8_t ucEvent, uint8_t ucInfo, uint16_t usTask, uint32_t ulObject, uint32_t ulValue ) PRIVILEGED_FUNCTION;
+
+/*
+ * Record the creation of a task, with the first 8 characters of its name.
+ */
+void vEventTraceTaskCreate( uint16_t usTask, const char *pcName ) PRIVILEGED_FUNCTION;
+
+/*
+ * Move up to xMaxRecords of the oldest records into pxRecords, and return the
+ * number moved.  There must only be one reader, which calls either this
+ * function or xEventTraceDrain().
+ */
+size_t xEventTraceRead( EventTraceRecord_t *pxRecords, size_t xMaxRecords ) PRIVILEGED_FUNCTION;
+
+/*
+ * Pass the records that are ready to pxWriter in place, without copying them
+ * out of the ring, and remove those it writes.  Returns the number of records
+ * written.  The writer can send the records to a UART or a file, or on to a
+ * stream buffer:
+
+ size_t prvWriteToStreamBuffer( void *pvContext, const uint8_t *pucData, size_t xLength )
+ {
+ StreamBufferHandle_t xStreamBuffer = ( StreamBufferHandle_t ) pvContext;
+ size_t xSpace = xStreamBufferSpacesAvailable( xStreamBuffer );
+
+	// Only write whole records.
+	xSpace -= xSpace % sizeof( EventTraceRecord_t );
+	return xStreamBufferSend( xStreamBuffer, pucData, ( xLength < xSpace ) ? xLength : xSpace, 0 );
+ }
+
+ */
+size_t xEventTraceDrain( EventTraceWriter_t pxWriter, void *pvContext ) PRIVILEGED_FUNCTION;
+
+/*
+ * Return the number of records dropped since the recorder started because the
+ * ring was full.
+ */
+uint32_t ulEventTraceDropped( void ) PRIVILEGED_FUNCTION;
+
+/* The trace macros of the recorded events.  The task macros are expanded in
+tasks.c and the queue macros in queue.c, where the members they read are
+visible, and the heap macros in the heap implementations. */
+#define traceTASK_CREATE( pxNewTCB )						vEventTraceTaskCreate( ( uint16_t ) ( pxNewTCB )->uxTCBNumber, ( pxNewTCB )->pcTaskName )
+#define traceTASK_DELETE( pxTCB )							vEventTraceRecord( eventtraceTASK_DELETE, 0U, ( uint16_t ) ( pxTCB )->uxTCBNumber, 0UL, 0UL )
+#define traceTASK_SWITCHED_IN()								vEventTraceRecord( eventtraceTASK_SWITCHED_IN, 0U, ( uint16_t ) pxCurrentTCB->uxTCBNumber, 0UL, ( uint32_t ) pxCurrentTCB->uxPriority )
+#define traceMOVED_TASK_TO_READY_STATE( pxTCB )				vEventTraceRecord( eventtraceTASK_READY, 0U, ( uint16_t ) ( pxTCB )->uxTCBNumber, 0UL, 0UL )
+#define eventtraceQUEUE( ucEvent, pxQueue )					vEventTraceRecord( ( ucEvent ), ( pxQueue )->ucQueueType, 0U, ( uint32_t ) ( portPOINTER_SIZE_TYPE ) ( pxQueue ), ( uint32_t ) ( pxQueue )->uxMessagesWaiting )
+#define traceQUEUE_SEND( pxQueue )							eventtraceQUEUE( eventtraceQUEUE_SEND, pxQueue )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )					eventtraceQUEUE( eventtraceQUEUE_SEND_FROM_ISR, pxQueue )
+#define traceQUEUE_RECEIVE( pxQueue )						eventtraceQUEUE( eventtraceQUEUE_RECEIVE, pxQueue )
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )				eventtraceQUEUE( eventtraceQUEUE_RECEIVE_FROM_ISR, pxQueue )
+#define traceMALLOC( pvAddress, uiSize )					vEventTraceRecord( eventtraceMALLOC, 0U, 0U, ( uint32_t ) ( portPOINTER_SIZE_TYPE ) ( pvAddress ), ( uint32_t ) ( uiSize ) )
+#define traceFREE( pvAddress, uiSize )						vEventTraceRecord( eventtraceFREE, 0U, 0U, ( uint32_t ) ( portPOINTER_SIZE_TYPE ) ( pvAddress ), ( uint32_t ) ( uiSize ) )
+
+#if defined( __cplusplus )
+}
+#endif
+
+#endif /* EVENT_TRACE_H */
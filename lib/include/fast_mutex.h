@@ -0,0 +1,167 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * Fast mutexes and reader-writer locks.
+ *
+ * A fast mutex is taken and given with a single atomic operation on a state
+ * word while no other task wants it, and only calls into the kernel when
+ * tasks contend for it, in which case it blocks them on an event list of its
+ * own and applies priority inheritance just as the mutexes of semphr.h do.
+ * Unlike those it is not a queue, so it cannot be used with queue sets, can't
+ * be taken recursively, and must only be used from tasks.
+ *
+ * A reader-writer lock lets any number of tasks hold it for reading, or one
+ * task hold it for writing.  Taking it for reading takes two atomic operations
+ * while no writer holds or waits for it: one records the reader in a free slot
+ * of the lock, and one counts it in.  A writer takes the fast mutex inside the
+ * lock, so writers and the readers that arrive while a writer holds or waits
+ * for the lock queue on that mutex, and the priority of the writer is raised
+ * to that of the highest priority task waiting for it.  A writer that waits
+ * for the readers to give the lock raises the priority of the readers recorded
+ * in the slots to its own, and they drop back when they give it.  The lock has
+ * configRWLOCK_TRACKED_READERS slots, 4 by default, and the readers beyond
+ * that many at a time are counted in without a slot, so their priority is not
+ * raised.  Readers don't overtake a waiting writer, so a task that already
+ * holds the lock for reading must not take it for reading again while another
+ * task might wait to write.
+ *
+ * The state words are updated with GCC's __atomic builtins if
+ * configUSE_ATOMIC_BUILTINS is set to 1 in FreeRTOSConfig.h, or otherwise in
+ * short critical sections, which still avoids the queue machinery of the
+ * semphr.h mutexes.
+ *
+ * The structures are initialised at run time, so both must be initialised
+ * with vFastMutexInit() or vRWLockInit() before they are used.  The functions
+ * call into the kernel, so they are not available to the unprivileged tasks of
+ * the MPU ports.
+ */
+
+#ifndef FAST_MUTEX_H
+#define FAST_MUTEX_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h must appear in source files before include fast_mutex.h"
+#endif
+
+#include "task.h"
+
+#if defined( __cplusplus )
+extern "C" {
+#endif
+
+#if( configUSE_MUTEXES != 1 )
+	#error fast_mutex.h needs the priority inheritance of the mutexes, so configUSE_MUTEXES must be set to 1.
+#endif
+
+/*
+ * A fast mutex.  The members are private to fast_mutex.c.
+ */
+typedef struct xFAST_MUTEX
+{
+	volatile uint32_t ulState;		/* 0 when free, 1 when held, 2 when held and other tasks might wait for it. */
+	TaskHandle_t xOwner;			/* The task that holds the mutex, or NULL. */
+	List_t xTasksWaitingToTake;		/* The tasks blocked on the mutex, in priority order. */
+} FastMutex_t;
+
+/*
+ * A reader-writer lock.  The members are private to fast_mutex.c.
+ */
+typedef struct xRW_LOCK
+{
+	volatile uint32_t ulState;		/* The number of readers, and the top bit set while a writer holds or waits for the lock. */
+	FastMutex_t xWriterMutex;		/* Held by the writer, and briefly by the readers that arrive while a writer holds or waits. */
+	List_t xWriterWaitingForReaders;	/* The writer, once it holds xWriterMutex, waits here for the readers to give the lock. */
+	TaskHandle_t volatile xReaders[ configRWLOCK_TRACKED_READERS ];	/* Tasks that hold or are about to hold the lock for reading, or NULL. */
+} RWLock_t;
+
+/*
+ * Initialise a fast mutex, which is then free.
+ */
+void vFastMutexInit( FastMutex_t *pxMutex ) PRIVILEGED_FUNCTION;
+
+/*
+ * Take a fast mutex, waiting up to xTicksToWait ticks for it if another task
+ * holds it.  Returns pdPASS if the mutex was taken, or pdFAIL if the time ran
+ * out first.  Must not be called by the task that holds the mutex.
+ */
+BaseType_t xFastMutexTake( FastMutex_t *pxMutex, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/*
+ * Give a fast mutex held by the calling task.  Returns pdFAIL, and leaves the
+ * mutex as it is, if the calling task does not hold it.
+ */
+BaseType_t xFastMutexGive( FastMutex_t *pxMutex ) PRIVILEGED_FUNCTION;
+
+/*
+ * Return the task that holds a fast mutex, or NULL if it is free.
+ */
+TaskHandle_t xFastMutexGetOwner( const FastMutex_t *pxMutex ) PRIVILEGED_FUNCTION;
+
+/*
+ * Initialise a reader-writer lock, which is then free.
+ */
+void vRWLockInit( RWLock_t *pxLock ) PRIVILEGED_FUNCTION;
+
+/*
+ * Take a reader-writer lock for reading, waiting up to xTicksToWait ticks for a
+ * writer that holds or waits for it.  Returns pdPASS if the lock was taken, or
+ * pdFAIL if the time ran out first.
+ */
+BaseType_t xRWLockReadTake( RWLock_t *pxLock, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/*
+ * Give a reader-writer lock the calling task holds for reading.  Returns
+ * pdFAIL if no task holds the lock for reading.
+ */
+BaseType_t xRWLockReadGive( RWLock_t *pxLock ) PRIVILEGED_FUNCTION;
+
+/*
+ * Take a reader-writer lock for writing, waiting up to xTicksToWait ticks for
+ * the writer and then the readers that hold it.  Returns pdPASS if the lock
+ * was taken, or pdFAIL if the time ran out first.  Must not be called by a
+ * task that holds the lock.
+ */
+BaseType_t xRWLockWriteTake( RWLock_t *pxLock, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/*
+ * Give a reader-writer lock the calling task holds for writing.  Returns
+ * pdFAIL, and leaves the lock as it is, if the calling task does not hold it
+ * for writing.
+ */
+BaseType_t xRWLockWriteGive( RWLock_t *pxLock ) PRIVILEGED_FUNCTION;
+
+/*
+ * Return pdTRUE if the calling task holds a reader-writer lock for writing.
+ */
+BaseType_t xRWLockIsWriteOwner( const RWLock_t *pxLock ) PRIVILEGED_FUNCTION;
+
+#if defined( __cplusplus )
+}
+#endif
+
+#endif /* FAST_MUTEX_H */
@@ -595,6 +595,132 @@ BaseType_t xHigherPriorityTaskWoken = pdFALSE;  // Initialised to pdFALSE.
  */
 #define xMessageBufferReceiveFromISR( xMessageBuffer, pvRxData, xBufferLengthBytes, pxHigherPriorityTaskWoken ) xStreamBufferReceiveFromISR( ( StreamBufferHandle_t ) xMessageBuffer, pvRxData, xBufferLengthBytes, pxHigherPriorityTaskWoken )
 
+/**
+ * message_buffer.h
+ *
+<pre>
+size_t xMessageBufferReserve( MessageBufferHandle_t xMessageBuffer,
+                              size_t xDataLengthBytes,
+                              StreamBufferRegions_t * const pxRegions,
+                              TickType_t xTicksToWait );
+</pre>
+ *
+ * Reserves space for a message of up to xDataLengthBytes bytes in a message
+ * buffer, so the writer can build the message directly in the message
+ * buffer's storage area instead of in a buffer of its own that
+ * xMessageBufferSend() then copies from.  The message is not available to the
+ * reader until it is passed to xMessageBufferCommit().
+ *
+ * The space is described by *pxRegions as one region, or as two if it wraps
+ * back to the start of the storage area, in which case the message must be
+ * split between the two.  Space for the length of the message is reserved as
+ * well, and the length is written when the message is committed.
+ *
+ * The same single writer restrictions apply as to xMessageBufferSend(), and
+ * the writer must not send or reserve again until it has committed the
+ * message.  Use xMessageBufferReserveFromISR() to reserve from an interrupt
+ * service routine (ISR), which does not block.
+ *
+ * @param xMessageBuffer The handle of the message buffer.
+ *
+ * @param xDataLengthBytes The largest length of the message to be written.
+ *
+ * @param pxRegions Set to describe the reserved space.
+ *
+ * @param xTicksToWait The maximum amount of time the calling task should
+ * remain in the Blocked state to wait for enough space, as with
+ * xMessageBufferSend().
+ *
+ * @return xDataLengthBytes if the space was reserved, or 0 if there was not
+ * enough space before the block time expired.
+ *
+ * \defgroup xMessageBufferReserve xMessageBufferReserve
+ * \ingroup MessageBufferManagement
+ */
+#define xMessageBufferReserve( xMessageBuffer, xDataLengthBytes, pxRegions, xTicksToWait ) xStreamBufferReserve( ( StreamBufferHandle_t ) xMessageBuffer, xDataLengthBytes, pxRegions, xTicksToWait )
+#define xMessageBufferReserveFromISR( xMessageBuffer, xDataLengthBytes, pxRegions ) xStreamBufferReserveFromISR( ( StreamBufferHandle_t ) xMessageBuffer, xDataLengthBytes, pxRegions )
+
+/**
+ * message_buffer.h
+ *
+<pre>
+size_t xMessageBufferCommit( MessageBufferHandle_t xMessageBuffer, size_t xDataLengthBytes );
+</pre>
+ *
+ * Makes the message written to the space reserved by xMessageBufferReserve()
+ * available to the reader, as a message of xDataLengthBytes bytes, and
+ * unblocks a task waiting for a message as xMessageBufferSend() does.  The
+ * message can be shorter than the space reserved for it.  Committing 0 bytes
+ * abandons the reservation without writing a message.  Use
+ * xMessageBufferCommitFromISR() to commit from an interrupt service routine
+ * (ISR).
+ *
+ * @return xDataLengthBytes.
+ *
+ * \defgroup xMessageBufferCommit xMessageBufferCommit
+ * \ingroup MessageBufferManagement
+ */
+#define xMessageBufferCommit( xMessageBuffer, xDataLengthBytes ) xStreamBufferCommit( ( StreamBufferHandle_t ) xMessageBuffer, xDataLengthBytes )
+#define xMessageBufferCommitFromISR( xMessageBuffer, xDataLengthBytes, pxHigherPriorityTaskWoken ) xStreamBufferCommitFromISR( ( StreamBufferHandle_t ) xMessageBuffer, xDataLengthBytes, pxHigherPriorityTaskWoken )
+
+/**
+ * message_buffer.h
+ *
+<pre>
+size_t xMessageBufferPeek( MessageBufferHandle_t xMessageBuffer,
+                           StreamBufferRegions_t * const pxRegions,
+                           TickType_t xTicksToWait );
+</pre>
+ *
+ * Describes the next message in a message buffer without removing it, so the
+ * reader can parse the message where it is instead of copying it out with
+ * xMessageBufferReceive() first.  The message stays in the message buffer, and
+ * the regions stay valid, until it is removed with xMessageBufferConsume().
+ *
+ * The same single reader restrictions apply as to xMessageBufferReceive().
+ * Use xMessageBufferPeekFromISR() to peek from an interrupt service routine
+ * (ISR), which does not block.
+ *
+ * @param xMessageBuffer The handle of the message buffer.
+ *
+ * @param pxRegions Set to describe the message, as one region, or as two if it
+ * wraps back to the start of the storage area.
+ *
+ * @param xTicksToWait The maximum amount of time the calling task should
+ * remain in the Blocked state to wait for a message, as with
+ * xMessageBufferReceive().
+ *
+ * @return The length of the message, or 0 if the block time expired before a
+ * message was available.
+ *
+ * \defgroup xMessageBufferPeek xMessageBufferPeek
+ * \ingroup MessageBufferManagement
+ */
+#define xMessageBufferPeek( xMessageBuffer, pxRegions, xTicksToWait ) xStreamBufferPeek( ( StreamBufferHandle_t ) xMessageBuffer, pxRegions, xTicksToWait )
+#define xMessageBufferPeekFromISR( xMessageBuffer, pxRegions ) xStreamBufferPeekFromISR( ( StreamBufferHandle_t ) xMessageBuffer, pxRegions )
+
+/**
+ * message_buffer.h
+ *
+<pre>
+size_t xMessageBufferConsume( MessageBufferHandle_t xMessageBuffer, size_t xDataLengthBytes );
+</pre>
+ *
+ * Removes the message described by xMessageBufferPeek() from the message
+ * buffer, and unblocks a task waiting for space as xMessageBufferReceive()
+ * does.  A message is always removed whole, and xDataLengthBytes must be the
+ * length xMessageBufferPeek() returned.  Use xMessageBufferConsumeFromISR() to
+ * consume from an interrupt service routine (ISR).
+ *
+ * @return The length of the message removed, or 0 if the message buffer was
+ * empty.
+ *
+ * \defgroup xMessageBufferConsume xMessageBufferConsume
+ * \ingroup MessageBufferManagement
+ */
+#define xMessageBufferConsume( xMessageBuffer, xDataLengthBytes ) xStreamBufferConsume( ( StreamBufferHandle_t ) xMessageBuffer, xDataLengthBytes )
+#define xMessageBufferConsumeFromISR( xMessageBuffer, xDataLengthBytes, pxHigherPriorityTaskWoken ) xStreamBufferConsumeFromISR( ( StreamBufferHandle_t ) xMessageBuffer, xDataLengthBytes, pxHigherPriorityTaskWoken )
+
 /**
  * message_buffer.h
  *
@@ -30,10 +30,12 @@
 #include "aws_defender_report.h"
 #include "aws_defender_report_cpu.h"
 #include "aws_defender_report_header.h"
+#include "aws_defender_report_task_profile.h"
 #include "aws_defender_report_tcp_conn.h"
 #include "aws_defender_report_types.h"
 #include "aws_defender_report_uptime.h"
 #include "aws_defender_report_utils.h"
+#include "aws_defender_task_profile.h"
 #include "aws_defender_tcp_conn.h"
 #include "aws_defender_uptime.h"
 
@@ -0,0 +1,44 @@
+/*
+ * Amazon FreeRTOS Device Defender Agent V1.0.2
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+#ifndef AWS_DEFENDER_REPORT_TASK_PROFILE_H
+#define AWS_DEFENDER_REPORT_TASK_PROFILE_H
+
+#include "aws_cbor.h"
+#include "aws_defender_report_utils.h"
+
+#define DEFENDER_TASK_PROFILES_TAG    DEFENDER_SelectTag( "task_profiles", "tp" )
+#define DEFENDER_ISR_PROFILES_TAG     DEFENDER_SelectTag( "isr_profiles", "ip" )
+#define DEFENDER_NAME_TAG             DEFENDER_SelectTag( "name", "nm" )
+#define DEFENDER_CPU_PERMILLE_TAG     DEFENDER_SelectTag( "cpu_permille", "cp" )
+#define DEFENDER_SWITCHES_TAG         DEFENDER_SelectTag( "switches", "sw" )
+#define DEFENDER_MAX_LATENCY_TAG      DEFENDER_SelectTag( "max_latency", "ml" )
+#define DEFENDER_AVG_LATENCY_TAG      DEFENDER_SelectTag( "avg_latency", "al" )
+#define DEFENDER_STACK_FREE_TAG       DEFENDER_SelectTag( "stack_free", "sf" )
+#define DEFENDER_COUNT_TAG            DEFENDER_SelectTag( "count", "n" )
+#define DEFENDER_MAX_TIME_TAG         DEFENDER_SelectTag( "max_time", "mt" )
+
+CBORHandle_t TaskProfileReportGet( void );
+
+#endif /* end of include guard: AWS_DEFENDER_REPORT_TASK_PROFILE_H */
@@ -0,0 +1,87 @@
+/*
+ * Amazon FreeRTOS Device Defender Agent V1.0.2
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+#ifndef AWS_DEFENDER_TASK_PROFILE_H
+#define AWS_DEFENDER_TASK_PROFILE_H
+
+#include <stdint.h>
+
+/** Maximum number of tasks in a report */
+#define DEFENDER_MAX_TASK_PROFILES      ( 16 )
+
+/** Maximum number of interrupt handlers in a report */
+#define DEFENDER_MAX_ISR_PROFILES       ( 8 )
+
+/** Maximum length of the name of a task or interrupt handler, including the
+ * terminating zero */
+#define DEFENDER_PROFILE_NAME_LENGTH    ( 16 )
+
+/**
+ * @brief Profile of a task over the reporting period
+ *
+ * Times are in counts of the clock that measures them, and shares of the CPU
+ * in thousandths of the period.
+ */
+typedef struct DefenderTaskProfile_s
+{
+    char cName[ DEFENDER_PROFILE_NAME_LENGTH ];
+    int32_t lNumber;      /**< Task number, unique unlike the name */
+    int32_t lCpuPermille; /**< Share of the period the task ran for */
+    int32_t lSwitches;    /**< Number of times the task was switched in */
+    int32_t lMaxLatency;  /**< Longest time from being made ready to running */
+    int32_t lAvgLatency;  /**< Mean time from being made ready to running */
+    int32_t lStackFree;   /**< Least stack space the task ever had left */
+} DefenderTaskProfile_t;
+
+/**
+ * @brief Profile of an interrupt handler over the reporting period
+ */
+typedef struct DefenderIsrProfile_s
+{
+    char cName[ DEFENDER_PROFILE_NAME_LENGTH ];
+    int32_t lNumber;      /**< Number the handler was profiled under */
+    int32_t lCpuPermille; /**< Share of the period spent in the handler */
+    int32_t lCount;       /**< Number of times the handler ran */
+    int32_t lMaxTime;     /**< Longest single run of the handler */
+} DefenderIsrProfile_t;
+
+/**
+ * @brief Measures the profiles of the period since the previous refresh
+ */
+void TaskProfileRefresh( void );
+
+/**
+ * @param[out] ppxProfiles Set to the task profiles of the last refresh
+ * @return Number of task profiles
+ */
+int32_t TaskProfilesGet( DefenderTaskProfile_t const ** ppxProfiles );
+
+/**
+ * @param[out] ppxProfiles Set to the interrupt handler profiles of the last
+ * refresh
+ * @return Number of interrupt handler profiles
+ */
+int32_t IsrProfilesGet( DefenderIsrProfile_t const ** ppxProfiles );
+
+#endif /* end of include guard: AWS_DEFENDER_TASK_PROFILE_H */
@@ -73,6 +73,21 @@
     #define mqttconfigKEEP_ALIVE_ACTUAL_INTERVAL_TICKS    ( 5000 )
 #endif
 
+/**
+ * @brief The maximum interval in ticks during which received data can defer
+ * Keep Alive messages.
+ *
+ * Data received from the broker shows that the connection is alive, so it
+ * restarts the mqttconfigKEEP_ALIVE_ACTUAL_INTERVAL_TICKS interval. The broker
+ * however expects a control packet from the client at least every
+ * mqttconfigKEEP_ALIVE_INTERVAL_SECONDS, so a Keep Alive message is still sent
+ * if nothing has been sent for this long. Set to 0 to send Keep Alive messages
+ * based on sent data only.
+ */
+#ifndef mqttconfigKEEP_ALIVE_MAX_IDLE_TICKS
+    #define mqttconfigKEEP_ALIVE_MAX_IDLE_TICKS    ( ( ( uint32_t ) mqttconfigKEEP_ALIVE_INTERVAL_SECONDS * ( uint32_t ) configTICK_RATE_HZ / 4U ) * 3U )
+#endif
+
 /**
  * @brief The maximum interval in ticks to wait for PINGRESP.
  *
@@ -134,6 +149,19 @@
     #define mqttconfigMAX_PARALLEL_OPS    ( 5 )
 #endif
 
+/**
+ * @brief Maximum number of QoS1 publishes issued with MQTT_AGENT_PublishAsync
+ * that can be awaiting PUBACK per client at any one time.
+ *
+ * Callers of MQTT_AGENT_PublishAsync block once the window is full until an
+ * earlier publish completes. Each in-flight publish holds one buffer from the
+ * buffer pool until it is acknowledged, so this value should not exceed the
+ * number of buffers available to the MQTT client. Must be between 1 and 256.
+ */
+#ifndef mqttconfigMAX_INFLIGHT_PUBLISHES
+    #define mqttconfigMAX_INFLIGHT_PUBLISHES    ( 4 )
+#endif
+
 /**
  * @brief Time in milliseconds after which the TCP send operation should timeout.
  */
@@ -141,6 +169,30 @@
     #define mqttconfigTCP_SEND_TIMEOUT_MS    ( 2000 )
 #endif
 
+/**
+ * @brief Length of the buffer used to batch outbound packets.
+ *
+ * Packets sent by the MQTT task are appended to a per client buffer and written
+ * to the socket with one send call, so that a TLS connection sends one record
+ * instead of one per packet. Packets larger than the buffer are sent directly
+ * after the buffered ones.
+ */
+#ifndef mqttconfigTX_BATCH_BUFFER_SIZE
+    #define mqttconfigTX_BATCH_BUFFER_SIZE    ( 256 )
+#endif
+
+/**
+ * @brief The maximum time in ticks an outbound packet is held in the batch buffer.
+ *
+ * The batch buffer is flushed as soon as the MQTT task has no more commands to
+ * process. While commands keep arriving, it is flushed once the oldest buffered
+ * packet has waited for this long or the buffer is full. Set to 0 to flush at
+ * the end of every iteration of the MQTT task.
+ */
+#ifndef mqttconfigTX_FLUSH_DEADLINE_TICKS
+    #define mqttconfigTX_FLUSH_DEADLINE_TICKS    ( pdMS_TO_TICKS( 10 ) )
+#endif
+
 /**
  * @brief Length of the buffer used to receive data.
  */
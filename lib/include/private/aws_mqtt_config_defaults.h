@@ -68,11 +68,73 @@
  * to the maximum number of topics which the user is going to subscribe
  * simultaneously. The subscribe operation will fail is the user tries to
  * subscribe to more topics than the maximum specified here.
+ *
+ * Matching a received publish message against the stored subscriptions costs
+ * time proportional to the number of levels in the topic, not the number of
+ * stored subscriptions, so this may be set to several hundred provided that
+ * mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES and
+ * mqttconfigSUBSCRIPTION_MANAGER_LEVEL_ARENA_SIZE are sized to match.
  */
 #ifndef mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS
     #define mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS    ( 8 )
 #endif
 
+/**
+ * @brief Number of topic level nodes available to the subscription manager.
+ *
+ * Subscriptions are stored as a tree of topic levels so that subscriptions
+ * sharing a prefix (e.g. "$aws/things/<thing>/shadow/...") share the nodes
+ * for that prefix. Each distinct topic level in each stored topic filter
+ * needs one node, and one extra node is always used as the root. The
+ * subscribe operation fails if no node is left to store a new topic level.
+ */
+#ifndef mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES
+    #define mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES    ( ( mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS * 4 ) + 1 )
+#endif
+
+/**
+ * @brief Size in bytes of the memory used by the subscription manager to
+ * store the names of topic levels.
+ *
+ * Only the names of the topic levels which are not shared with another
+ * stored topic filter consume space here. Wild-card levels do not consume
+ * any space. The subscribe operation fails if there is not enough space left
+ * to store the name of a new topic level.
+ */
+#ifndef mqttconfigSUBSCRIPTION_MANAGER_LEVEL_ARENA_SIZE
+    #define mqttconfigSUBSCRIPTION_MANAGER_LEVEL_ARENA_SIZE    ( mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS * 64 )
+#endif
+
+/**
+ * @brief Number of hash buckets used by the subscription manager to find the
+ * literal topic levels below a node.
+ *
+ * Each bucket costs two bytes. Finding a topic level costs time proportional
+ * to the number of nodes sharing its bucket, so the default of one bucket per
+ * node keeps that close to one even when a single topic level has hundreds of
+ * literal children.
+ */
+#ifndef mqttconfigSUBSCRIPTION_MANAGER_LITERAL_BUCKETS
+    #define mqttconfigSUBSCRIPTION_MANAGER_LITERAL_BUCKETS    mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES
+#endif
+
+/**
+ * @brief Deliver received publish messages without copying them to a buffer.
+ *
+ * If mqttconfigENABLE_ZERO_COPY_PUBLISH is set to 1, a publish message which
+ * is entirely contained in the data supplied to one MQTT_ParseReceivedData
+ * call is parsed in place and the topic and payload supplied in the callback
+ * point directly into that data. Such a message is delivered with xBuffer in
+ * MQTTPublishData_t set to NULL: the topic and payload are only valid until
+ * the callback returns and the return value of the callback is ignored. A
+ * callback which needs the message afterwards must copy it, for example by
+ * calling MQTT_ClonePublishData. Publish messages spanning more than one call
+ * are still assembled in a buffer from the buffer pool.
+ */
+#ifndef mqttconfigENABLE_ZERO_COPY_PUBLISH
+    #define mqttconfigENABLE_ZERO_COPY_PUBLISH    ( 0 )
+#endif
+
 /**
  * @brief Define mqttconfigASSERT to enable asserts.
  *
@@ -0,0 +1,233 @@
+/*
+ * Amazon FreeRTOS OTA Agent V1.0.1
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+
+/**
+ * @file aws_ota_agent_config_defaults.h
+ * @brief OTA agent default config options.
+ *
+ * Ensures that the config options for the OTA agent are set to sensible
+ * default values if the user does not provide one.
+ */
+
+#ifndef _AWS_OTA_AGENT_CONFIG_DEFAULTS_H_
+#define _AWS_OTA_AGENT_CONFIG_DEFAULTS_H_
+
+/**
+ * @brief The number of blocks in one block range of the OTA file.
+ *
+ * The OTA file is downloaded as consecutive ranges of this many blocks. A range
+ * is requested as a whole and then re-requested until all of its blocks have
+ * been received.
+ */
+#ifndef otaconfigBLOCKS_PER_RANGE
+    #define otaconfigBLOCKS_PER_RANGE    8U
+#endif
+
+/**
+ * @brief The maximum number of block ranges requested from the OTA service at
+ * any one time.
+ *
+ * As soon as all blocks of a range have been received, the next range with
+ * missing blocks is requested so that this many ranges stay in flight. Set to 1
+ * to request one range at a time.
+ */
+#ifndef otaconfigMAX_OUTSTANDING_RANGES
+    #define otaconfigMAX_OUTSTANDING_RANGES    4U
+#endif
+
+/**
+ * @brief Milliseconds to wait for the next block of an outstanding range before
+ * requesting the missing blocks of that range again.
+ *
+ * The deadline of a range is restarted whenever one of its blocks is received,
+ * so it should cover the round trip to the OTA service plus the time to receive
+ * the blocks of all outstanding ranges. Blocks found missing because blocks of
+ * a later range or request have already arrived are requested again without
+ * waiting for the deadline.
+ */
+#ifndef otaconfigRANGE_REQUEST_WAIT_MS
+    #define otaconfigRANGE_REQUEST_WAIT_MS    1000U
+#endif
+
+/**
+ * @brief Log 2 of the largest block requested from the OTA service.
+ *
+ * The agent tracks the OTA file in blocks of 2^otaconfigLOG2_FILE_BLOCK_SIZE
+ * bytes but may request larger blocks of up to 2^otaconfigMAX_LOG2_FILE_BLOCK_SIZE
+ * bytes, so each stream message carries several consecutive file blocks. Larger
+ * blocks mean fewer messages, requests and CBOR headers per file. Each download
+ * starts with the block size the previous one ended with, which doubles every
+ * otaconfigBLOCK_SIZE_GROW_RANGES block ranges received without loss and halves
+ * whenever blocks are requested again because they were lost. A stream message
+ * of the largest block must fit in an MQTT receive buffer. No larger than
+ * otaconfigLOG2_FILE_BLOCK_SIZE + 9 and otaconfigBLOCKS_PER_RANGE file blocks.
+ * Defaults to otaconfigLOG2_FILE_BLOCK_SIZE, a fixed block size.
+ */
+#ifndef otaconfigMAX_LOG2_FILE_BLOCK_SIZE
+    #define otaconfigMAX_LOG2_FILE_BLOCK_SIZE    otaconfigLOG2_FILE_BLOCK_SIZE
+#endif
+
+/**
+ * @brief The number of block ranges received without loss after which the
+ * OTA agent doubles the block size it requests.
+ *
+ * Only used if otaconfigMAX_LOG2_FILE_BLOCK_SIZE is larger than
+ * otaconfigLOG2_FILE_BLOCK_SIZE.
+ */
+#ifndef otaconfigBLOCK_SIZE_GROW_RANGES
+    #define otaconfigBLOCK_SIZE_GROW_RANGES    4U
+#endif
+
+/**
+ * @brief The number of out of order blocks held to keep hashing the OTA file
+ * while it is received.
+ *
+ * If the PAL starts a signature verification context when the receive file is
+ * created, the agent hashes the blocks in file order as they arrive. Blocks that
+ * arrive ahead of a missing block are copied to a buffer of this many blocks,
+ * allocated on first use. If the buffer overflows, hashing stops and the PAL
+ * reads the rest of the file back when it is closed. A lost block holds up all
+ * blocks received until it is requested again, so the buffer should cover
+ * otaconfigMAX_OUTSTANDING_RANGES * otaconfigBLOCKS_PER_RANGE blocks where memory
+ * allows. Set to 0 to only hash blocks that arrive in order.
+ */
+#ifndef otaconfigHASH_REORDER_BLOCKS
+    #define otaconfigHASH_REORDER_BLOCKS    8U
+#endif
+
+/**
+ * @brief The number of received blocks after which the OTA agent stores a
+ * checkpoint of the file download.
+ *
+ * The checkpoint holds the block bitmap, the server file ID and the running
+ * hash of the file and is stored through prvPAL_SaveCheckpoint(). When the
+ * same job is processed again after a reset or a lost connection, the agent
+ * resumes the file with prvPAL_ResumeFileForRx() and only requests the blocks
+ * that are still missing. Blocks received after the last checkpoint are
+ * downloaded again. Set to 0 to disable checkpoints, in which case the PAL
+ * does not have to implement the checkpoint functions.
+ */
+#ifndef otaconfigCHECKPOINT_INTERVAL_BLOCKS
+    #define otaconfigCHECKPOINT_INTERVAL_BLOCKS    0U
+#endif
+
+/**
+ * @brief Log 2 of the largest window of compressed OTA files.
+ *
+ * A file with the OTA_FILE_ATTR_COMPRESSED bit set in the "attr" field of the
+ * job document is streamed compressed and decompressed by the agent before it
+ * is written with prvPAL_WriteBlock(). The agent allocates a window buffer of
+ * 2^otaconfigDECOMPRESS_WINDOW_BITS bytes for the file, so files compressed
+ * with a larger window are rejected. Compressed data has to be decompressed
+ * in order, so blocks that arrive ahead of a missing block are held in the
+ * otaconfigHASH_REORDER_BLOCKS buffer, and blocks that don't fit are requested
+ * again. Compressed files are not checkpointed. Set to 0 to reject compressed
+ * files, in which case aws_ota_decompress.c does not have to be built.
+ */
+#ifndef otaconfigDECOMPRESS_WINDOW_BITS
+    #define otaconfigDECOMPRESS_WINDOW_BITS    0U
+#endif
+
+/**
+ * @brief Size in bytes of the buffer used to apply delta OTA files.
+ *
+ * A file with a "basehash" field in the job document is a delta file that
+ * rebuilds the new image from the running image, whose SHA-256 hash is the
+ * base hash. The agent reads the running image with prvPAL_ReadBaseImage()
+ * into a buffer of this size, applies the delta file to it and writes the
+ * new image with prvPAL_WriteBlock(), so this is also the size of the writes.
+ * The running image is hashed when the delta file header arrives, and the file
+ * is rejected if it doesn't match. Like compressed files, delta files are
+ * applied in order and are not checkpointed. A delta file may also be
+ * compressed. Set to 0 to reject delta files, in which case the PAL does not
+ * have to implement prvPAL_ReadBaseImage() and aws_ota_delta.c does not have
+ * to be built.
+ */
+#ifndef otaconfigDELTA_BUFFER_SIZE
+    #define otaconfigDELTA_BUFFER_SIZE    0U
+#endif
+
+/**
+ * @brief Size in bytes of the pages of the OTA write-behind buffer.
+ *
+ * If not 0, the agent copies received blocks into otaconfigWRITE_BEHIND_PAGES
+ * buffers of this size, each holding one page of the file aligned to the page
+ * size, instead of writing each block with prvPAL_WriteBlock() as it arrives.
+ * A page is written once it is complete, or once all buffers are in use, by a
+ * separate task while the agent receives the next blocks. Set it to the flash
+ * page or sector size so that most writes program whole pages, in which case
+ * the file must start at a page boundary. The pages are written before a
+ * checkpoint is stored and before the file is closed, and dropped when the
+ * file is aborted. prvPAL_WriteBlock() is then called from the write-behind
+ * task, possibly while the agent calls prvPAL_ReadBaseImage(). Set to 0 to
+ * write each block as it arrives, in which case aws_ota_write_behind.c does
+ * not have to be built.
+ */
+#ifndef otaconfigWRITE_BEHIND_PAGE_SIZE
+    #define otaconfigWRITE_BEHIND_PAGE_SIZE    0U
+#endif
+
+/**
+ * @brief The number of page buffers of the OTA write-behind buffer.
+ *
+ * From 1 to 8, and at least 2 so that a page is written while the next one is
+ * received. Pages with a missing block are kept until the block is requested
+ * again, so enough pages to cover otaconfigMAX_OUTSTANDING_RANGES *
+ * otaconfigBLOCKS_PER_RANGE blocks avoid writing pages in parts. Only used if
+ * otaconfigWRITE_BEHIND_PAGE_SIZE is not 0.
+ */
+#ifndef otaconfigWRITE_BEHIND_PAGES
+    #define otaconfigWRITE_BEHIND_PAGES    2U
+#endif
+
+/**
+ * @brief Priority of the OTA write-behind task.
+ */
+#ifndef otaconfigWRITE_BEHIND_PRIORITY
+    #define otaconfigWRITE_BEHIND_PRIORITY    otaconfigAGENT_PRIORITY
+#endif
+
+/**
+ * @brief Stack size in words of the OTA write-behind task, which calls
+ * prvPAL_WriteBlock().
+ */
+#ifndef otaconfigWRITE_BEHIND_STACK_SIZE
+    #define otaconfigWRITE_BEHIND_STACK_SIZE    otaconfigSTACK_SIZE
+#endif
+
+/**
+ * @brief The number of JSON tokens of the largest job document.
+ *
+ * A job document is tokenized once into an array of this many tokens, which is
+ * allocated for the time it is parsed. Each key, value, object and array of the
+ * document is a token, including those of keys the agent doesn't use. A job
+ * document with more tokens is rejected.
+ */
+#ifndef otaconfigMAX_JSON_TOKENS
+    #define otaconfigMAX_JSON_TOKENS    64U
+#endif
+
+#endif /* _AWS_OTA_AGENT_CONFIG_DEFAULTS_H_ */
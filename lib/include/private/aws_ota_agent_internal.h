@@ -51,9 +51,11 @@ typedef enum
     eIngest_Result_BadData = -8,            /* The data block from the server was malformed. */
     eIngest_Result_WriteBlockFailed = -9,   /* The PAL layer failed to write the file block. */
     eIngest_Result_NullResultPointer = -10, /* The pointer to the close result pointer was null. */
+    eIngest_Result_DecodeFailed = -11,      /* The compressed or delta file data could not be decoded or the image could not be written. */
     eIngest_Result_Uninitialized = -127,    /* Software BUG: We forgot to set the result code. */
     eIngest_Result_Accepted_Continue = 0,   /* The block was accepted and we're expecting more. */
     eIngest_Result_Duplicate_Continue = 1,  /* The block was a duplicate but that's OK. Continue. */
+    eIngest_Result_Deferred_Continue = 2,   /* The block can't be used yet and will be requested again. Continue. */
 } IngestResult_t;
 
 /* Generic JSON document parser errors. */
@@ -98,9 +100,9 @@ typedef enum
  * locally when it is extracted from the JSON document. It also contains the
  * expected Jasmine type of the value field for validation.
  *
- * NOTE: The ulDestOffset field may be either an offset into the models context structure
+ * NOTE: The xDestOffset field may be either an offset into the models context structure
  *       or an absolute memory pointer, although it is usually an offset.
- *       If the value of ulDestOffset is less than the size of the context structure,
+ *       If the value of xDestOffset is less than the size of the context structure,
  *       which is fairly small, it will add the offset of the active context structure
  *       to attain the effective address (somewhere in RAM). Otherwise, it is interpreted
  *       as an absolute memory address and used as is (useful for singleton parameters).
@@ -113,7 +115,7 @@ typedef struct
     const bool_t bRequired; /* If true, this parameter must exist in the document. */
     union
     {
-        const uint32_t ulDestOffset;        /* Pointer or offset to where we'll store the value, if not ~0. */
+        const size_t xDestOffset;          /* Pointer or offset to where we'll store the value, if not ~0. */
         void * const pvDestOffset;          /* Pointer or offset to where we'll store the value, if not ~0. */
     };
     const ModelParamType_t xModelParamType; /* We extract the value, if found, based on this type. */
@@ -121,6 +123,11 @@ typedef struct
 } JSON_DocParam_t;
 
 
+/* The number of slots of the key index of a document model. Twice the number of
+ * parameters a model may have, so a key is usually found in the first slot it
+ * hashes to. Must be a power of 2. */
+#define OTA_DOC_MODEL_INDEX_SLOTS    64U
+
 /* The document model is currently limited to 32 parameters per the implementation,
  * although it may be easily expanded to more in the future by simply expanding
  * the parameter bitmap.
@@ -132,12 +139,13 @@ typedef struct
  */
 typedef struct
 {
-    uint32_t ulContextBase;            /* The base address of the destination OTA context structure. */
+    size_t xContextBase;               /* The base address of the destination OTA context structure. */
     uint32_t ulContextSize;            /* The size, in bytes, of the destination context structure. */
     const JSON_DocParam_t * pxBodyDef; /* Pointer to the document model body definition. */
     uint16_t usNumModelParams;         /* The number of entries in the document model (limited to 32). */
     uint32_t ulParamsReceivedBitmap;   /* Bitmap of the parameters received based on the model. */
     uint32_t ulParamsRequiredBitmap;   /* Bitmap of the parameters required from the model. */
+    uint8_t ucKeyIndex[ OTA_DOC_MODEL_INDEX_SLOTS ]; /* Hash table of the parameter keys, each slot holding a parameter index plus 1, or 0 if empty. */
 } JSON_DocModel_t;
 
 #endif /* ifndef _AWS_OTA_AGENT_INTERAL_H_ */
@@ -37,6 +37,30 @@ BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageB
                                                      uint8_t ** ppucPayload,
                                                      size_t * pxPayloadSize );
 
+/**
+ * @brief Decode a Get Stream response message from AWS IoT OTA without
+ * copying the block payload.
+ *
+ * Unlike OTA_CBOR_Decode_GetStreamResponseMessage(), no memory is allocated.
+ * *ppucPayload points to the payload inside pucMessageBuffer, so it is only
+ * valid for as long as the message buffer is, and it may not be aligned. The
+ * payload must be encoded as a definite length byte string.
+ *
+ * If pcClientToken is not NULL, the client token of the request that the block
+ * answers is copied to it as a zero terminated string of at most
+ * xClientTokenSize bytes, including the terminator. It is empty if the message
+ * has no client token or the token doesn't fit.
+ */
+BaseType_t OTA_CBOR_Decode_GetStreamResponseMessageInPlace( const uint8_t * pucMessageBuffer,
+                                                            size_t xMessageSize,
+                                                            int32_t * plFileId,
+                                                            int32_t * plBlockId,
+                                                            int32_t * plBlockSize,
+                                                            const uint8_t ** ppucPayload,
+                                                            size_t * pxPayloadSize,
+                                                            char * pcClientToken,
+                                                            size_t xClientTokenSize );
+
 /**
  * @brief Create an encoded Get Stream Request message for the AWS IoT OTA
  * service.
@@ -0,0 +1,139 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#ifndef __AWS_OTADECOMPRESS__H__
+#define __AWS_OTADECOMPRESS__H__
+
+#include <stdint.h>
+
+/**
+ * @brief Streaming decompressor for compressed OTA files.
+ *
+ * A compressed file starts with a header of OTA_DECOMPRESS_HEADER_SIZE bytes:
+ *
+ * - bytes 0 to 3: the magic "LZSS".
+ * - byte 4: log 2 of the window size W, between OTA_DECOMPRESS_MIN_WINDOW_BITS and
+ *   OTA_DECOMPRESS_MAX_WINDOW_BITS.
+ * - byte 5: log 2 of the maximum match length L, between 3 and W - 1.
+ * - bytes 6 and 7: reserved, must be zero.
+ * - bytes 8 to 11: the size of the decompressed image, little endian.
+ *
+ * The header is followed by an LZSS bit stream, most significant bit first. A 1 bit is
+ * followed by an 8 bit literal byte. A 0 bit is followed by a W bit back reference
+ * offset minus 1 and an L bit match length minus 1. The last byte is padded with zero
+ * bits. This is the stream produced by the heatshrink encoder with the same window and
+ * lookahead sizes, so it can be used instead of tools/ota_compress once the header is
+ * prepended.
+ *
+ * The decompressed image is produced in a window of 2^W bytes supplied by the caller,
+ * so the decompressor does not allocate memory. The window is passed to the output
+ * function each time it fills up and once the whole image has been produced.
+ */
+
+#define OTA_DECOMPRESS_HEADER_SIZE         12U /*!< Size of the header of a compressed file. */
+#define OTA_DECOMPRESS_MIN_WINDOW_BITS     4U  /*!< Smallest supported window. */
+#define OTA_DECOMPRESS_MAX_WINDOW_BITS     15U /*!< Largest supported window. */
+
+/**
+ * @brief Output function of the decompressor.
+ *
+ * Called with the next ulSize bytes of the decompressed image, starting at ulOffset.
+ * The data is only valid during the call. Returns the number of bytes written, or a
+ * negative value if the data could not be written.
+ */
+typedef int32_t (* OTA_DecompressOutput_t)( void * pvContext,
+                                            uint32_t ulOffset,
+                                            const uint8_t * pucData,
+                                            uint32_t ulSize );
+
+typedef enum
+{
+    eDecompress_Result_BadHeader = -1,   /* The header of the compressed file is invalid. */
+    eDecompress_Result_BadWindow = -2,   /* The window of the compressed file is larger than the window buffer. */
+    eDecompress_Result_WriteFailed = -3, /* The output function failed to write the decompressed data. */
+    eDecompress_Result_Incomplete = -4,  /* The compressed file ended before the whole image was produced. */
+    eDecompress_Result_Continue = 0,     /* The data was decompressed and more is expected. */
+    eDecompress_Result_Complete = 1,     /* The whole image has been produced. */
+} OTA_DecompressResult_t;
+
+/**
+ * @brief State of the decompressor. All fields are private to aws_ota_decompress.c.
+ */
+typedef struct
+{
+    uint8_t * pucWindow;                                  /* The window buffer supplied by the caller. */
+    uint32_t ulWindowBufferSize;                          /* Size of the window buffer in bytes. */
+    OTA_DecompressOutput_t xOutput;                       /* The output function. */
+    void * pvOutputContext;                               /* Context passed to the output function. */
+    uint32_t ulBytesIn;                                   /* Number of compressed bytes consumed, including the header. */
+    uint32_t ulBytesOut;                                  /* Number of decompressed bytes produced. */
+    uint32_t ulBytesWritten;                              /* Number of decompressed bytes passed to the output function. */
+    uint32_t ulImageSize;                                 /* Size of the decompressed image from the header. */
+    uint32_t ulWindowMask;                                /* Window size minus 1. */
+    uint32_t ulBitBuffer;                                 /* Bits read from the stream and not yet decoded. */
+    uint32_t ulOffset;                                    /* Offset of the back reference being decoded. */
+    uint8_t ucBitCount;                                   /* Number of valid bits in ulBitBuffer. */
+    uint8_t ucWindowBits;                                 /* Log 2 of the window size. */
+    uint8_t ucLengthBits;                                 /* Log 2 of the maximum match length. */
+    uint8_t ucState;                                      /* The part of the stream decoded next. */
+    uint8_t ucHeader[ OTA_DECOMPRESS_HEADER_SIZE ];       /* The header as it is received. */
+} OTA_Decompress_t;
+
+/**
+ * @brief Prepare the decompressor for a new compressed file.
+ *
+ * @param[in] pxCtx The decompressor state.
+ * @param[in] pucWindow Window buffer. Only files with a window no larger than it can be decompressed.
+ * @param[in] ulWindowBufferSize Size of the window buffer in bytes.
+ * @param[in] xOutput Function receiving the decompressed image.
+ * @param[in] pvOutputContext Context passed to xOutput.
+ */
+void OTA_Decompress_Init( OTA_Decompress_t * pxCtx,
+                          uint8_t * pucWindow,
+                          uint32_t ulWindowBufferSize,
+                          OTA_DecompressOutput_t xOutput,
+                          void * pvOutputContext );
+
+/**
+ * @brief Decompress the next ulSize bytes of the compressed file.
+ *
+ * The compressed file may be passed in pieces of any size. All of the data is consumed.
+ *
+ * @return eDecompress_Result_Continue if more data is expected, eDecompress_Result_Complete
+ * once the whole image was produced and written, or a negative OTA_DecompressResult_t on error.
+ * Data following the end of the image is ignored.
+ */
+OTA_DecompressResult_t OTA_Decompress_Update( OTA_Decompress_t * pxCtx,
+                                              const uint8_t * pucData,
+                                              uint32_t ulSize );
+
+/**
+ * @brief Check that the whole image was produced after the last of the compressed file was passed.
+ *
+ * @return eDecompress_Result_Complete or eDecompress_Result_Incomplete.
+ */
+OTA_DecompressResult_t OTA_Decompress_Finish( const OTA_Decompress_t * pxCtx );
+
+#endif /* ifndef __AWS_OTADECOMPRESS__H__ */
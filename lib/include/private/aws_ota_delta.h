@@ -0,0 +1,179 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#ifndef __AWS_OTADELTA__H__
+#define __AWS_OTADELTA__H__
+
+#include <stdint.h>
+
+/**
+ * @brief Streaming patch applier for delta OTA files.
+ *
+ * A delta file rebuilds a new image from the image the device is running (the base image). It
+ * starts with a header of OTA_DELTA_HEADER_SIZE bytes:
+ *
+ * - bytes 0 to 3: the magic "OTAD".
+ * - bytes 4 to 7: the size of the base image, little endian.
+ * - bytes 8 to 11: the size of the new image, little endian.
+ *
+ * The header is followed by operations that produce the new image in order. Each operation is
+ * an operation byte followed by its length in bytes as an unsigned LEB128 number:
+ *
+ * - OTA_DELTA_OP_COPY: copy length bytes of the base image.
+ * - OTA_DELTA_OP_ADD: like OTA_DELTA_OP_COPY, but each base byte is added modulo 256 to the
+ *   next of length difference bytes that follow the operation, as in bsdiff. Code that only
+ *   moved in the new image differs from the base image in the addresses it refers to, and
+ *   the differences are mostly zeros that compress well.
+ * - OTA_DELTA_OP_INSERT: the next length bytes are new data.
+ *
+ * OTA_DELTA_OP_COPY and OTA_DELTA_OP_ADD are followed by a seek, a zigzag encoded signed LEB128
+ * number added to the base image position before the bytes are read. The base image position
+ * starts at 0 and moves past the bytes read by each operation.
+ *
+ * The new image is produced in a buffer supplied by the caller, so the applier does not allocate
+ * memory. The buffer is passed to the output function each time it fills up and once the whole
+ * image has been produced, and base image bytes are read into it directly. Any buffer size works.
+ * Larger buffers mean fewer and larger reads and writes.
+ */
+
+#define OTA_DELTA_HEADER_SIZE    12U /*!< Size of the header of a delta file. */
+
+#define OTA_DELTA_OP_COPY        0U  /*!< Copy bytes of the base image. */
+#define OTA_DELTA_OP_ADD         1U  /*!< Add difference bytes to bytes of the base image. */
+#define OTA_DELTA_OP_INSERT      2U  /*!< Insert new bytes. */
+
+/**
+ * @brief Output function of the applier.
+ *
+ * Called with the next ulSize bytes of the new image, starting at ulOffset. The data is only valid
+ * during the call. Returns the number of bytes written, or a negative value if the data could not
+ * be written.
+ */
+typedef int32_t (* OTA_DeltaOutput_t)( void * pvContext,
+                                       uint32_t ulOffset,
+                                       const uint8_t * pucData,
+                                       uint32_t ulSize );
+
+/**
+ * @brief Base image read function of the applier.
+ *
+ * Copies ulSize bytes of the base image, starting at ulOffset, to pucData. The bytes read are
+ * always within the base image size from the header. Returns 0 on success.
+ */
+typedef int32_t (* OTA_DeltaReadBase_t)( void * pvContext,
+                                         uint32_t ulOffset,
+                                         uint8_t * pucData,
+                                         uint32_t ulSize );
+
+/**
+ * @brief Base image check function of the applier.
+ *
+ * Called once the header is received, before any base image byte is used, to check that the
+ * device is running the image the delta file was made for. The applier buffer is not in use
+ * during the call and may be used to read the base image. Returns 0 if the base image matches.
+ */
+typedef int32_t (* OTA_DeltaCheckBase_t)( void * pvContext,
+                                          uint32_t ulBaseSize,
+                                          uint8_t * pucBuffer,
+                                          uint32_t ulBufferSize );
+
+typedef enum
+{
+    eDelta_Result_BadHeader = -1,    /* The header of the delta file is invalid. */
+    eDelta_Result_BadPatch = -2,     /* An operation is invalid or is outside of the base or new image. */
+    eDelta_Result_BaseMismatch = -3, /* The device is not running the base image of the delta file. */
+    eDelta_Result_ReadFailed = -4,   /* The base image could not be read. */
+    eDelta_Result_WriteFailed = -5,  /* The output function failed to write the new image. */
+    eDelta_Result_Incomplete = -6,   /* The delta file ended before the whole image was produced. */
+    eDelta_Result_Continue = 0,      /* The data was applied and more is expected. */
+    eDelta_Result_Complete = 1,      /* The whole image has been produced. */
+} OTA_DeltaResult_t;
+
+/**
+ * @brief State of the applier. All fields are private to aws_ota_delta.c.
+ */
+typedef struct
+{
+    uint8_t * pucBuffer;                        /* The buffer supplied by the caller. */
+    uint32_t ulBufferSize;                      /* Size of the buffer in bytes. */
+    OTA_DeltaReadBase_t xReadBase;              /* The base image read function. */
+    OTA_DeltaCheckBase_t xCheckBase;            /* The base image check function. */
+    OTA_DeltaOutput_t xOutput;                  /* The output function. */
+    void * pvContext;                           /* Context passed to the functions above. */
+    uint32_t ulBytesIn;                         /* Number of delta file bytes consumed, including the header. */
+    uint32_t ulBytesOut;                        /* Number of new image bytes produced. */
+    uint32_t ulBytesWritten;                    /* Number of new image bytes passed to the output function. */
+    uint32_t ulBaseSize;                        /* Size of the base image from the header. */
+    uint32_t ulImageSize;                       /* Size of the new image from the header. */
+    uint32_t ulBasePosition;                    /* Offset of the next base image byte to read. */
+    uint32_t ulBaseLoaded;                      /* New image offset up to which base bytes are in the buffer. */
+    uint32_t ulRemaining;                       /* Bytes left to produce by the current operation. */
+    uint32_t ulNumber;                          /* The LEB128 number being decoded. */
+    uint8_t ucShift;                            /* Bit position of the next 7 bits of ulNumber. */
+    uint8_t ucOperation;                        /* The current operation. */
+    uint8_t ucState;                            /* The part of the delta file decoded next. */
+    uint8_t ucHeader[ OTA_DELTA_HEADER_SIZE ];  /* The header as it is received. */
+} OTA_Delta_t;
+
+/**
+ * @brief Prepare the applier for a new delta file.
+ *
+ * @param[in] pxCtx The applier state.
+ * @param[in] pucBuffer Buffer for the new image and base image reads.
+ * @param[in] ulBufferSize Size of the buffer in bytes. Must not be 0.
+ * @param[in] xReadBase Function reading the base image.
+ * @param[in] xCheckBase Function checking the base image, or NULL to use it unchecked.
+ * @param[in] xOutput Function receiving the new image.
+ * @param[in] pvContext Context passed to xReadBase, xCheckBase and xOutput.
+ */
+void OTA_Delta_Init( OTA_Delta_t * pxCtx,
+                     uint8_t * pucBuffer,
+                     uint32_t ulBufferSize,
+                     OTA_DeltaReadBase_t xReadBase,
+                     OTA_DeltaCheckBase_t xCheckBase,
+                     OTA_DeltaOutput_t xOutput,
+                     void * pvContext );
+
+/**
+ * @brief Apply the next ulSize bytes of the delta file.
+ *
+ * The delta file may be passed in pieces of any size. All of the data is consumed.
+ *
+ * @return eDelta_Result_Continue if more data is expected, eDelta_Result_Complete once the whole
+ * image was produced and written, or a negative OTA_DeltaResult_t on error. Data following the
+ * end of the image is ignored.
+ */
+OTA_DeltaResult_t OTA_Delta_Update( OTA_Delta_t * pxCtx,
+                                    const uint8_t * pucData,
+                                    uint32_t ulSize );
+
+/**
+ * @brief Check that the whole image was produced after the last of the delta file was passed.
+ *
+ * @return eDelta_Result_Complete or eDelta_Result_Incomplete.
+ */
+OTA_DeltaResult_t OTA_Delta_Finish( const OTA_Delta_t * pxCtx );
+
+#endif /* ifndef __AWS_OTADELTA__H__ */
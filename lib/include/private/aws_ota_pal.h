@@ -73,6 +73,17 @@ OTA_Err_t prvPAL_Abort( OTA_FileContext_t * const C );
  * The device file path is a required field in the OTA job document, so C->pucFilePath is
  * checked for NULL by the OTA agent before this function is called.
  *
+ * @note The PAL may start a signature verification context with CRYPTO_SignatureVerificationStart()
+ * and store it in C->pvSigVerifyContext. The OTA agent then includes the file data in it in file order
+ * as the blocks are received, so that the file does not have to be read back to be authenticated.
+ * C->pvSigVerifyContext is NULL on entry and is left NULL if the platform does not hash this way.
+ *
+ * @note If OTA_FILE_ATTR_COMPRESSED is set in C->ulFileAttributes, C->ulFileSize is the size of the
+ * compressed file that is streamed. The decompressed image written with prvPAL_WriteBlock() is
+ * larger, so the whole image partition or the largest image file must be made available. The same
+ * applies to a delta file, which has C->pxBaseHash set. The running image must not be modified
+ * here, since the new image is rebuilt from it with prvPAL_ReadBaseImage().
+ *
  * @param[in] C OTA file context information.
  *
  * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
@@ -98,6 +109,10 @@ OTA_Err_t prvPAL_CreateFileForRx( OTA_FileContext_t * const C );
  *
  * If the signature verification fails, file close should still be attempted.
  *
+ * If C->pvSigVerifyContext is not NULL, the first C->ulHashedBytes bytes of the file are already
+ * included in it and only the rest of the file has to be read back before finishing the verification.
+ * The PAL shall set C->pvSigVerifyContext to NULL once it has called CRYPTO_SignatureVerificationFinal().
+ *
  * @param[in] C OTA file context information.
  *
  * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
@@ -110,6 +125,95 @@ OTA_Err_t prvPAL_CreateFileForRx( OTA_FileContext_t * const C );
  */
 OTA_Err_t prvPAL_CloseFile( OTA_FileContext_t * const C );
 
+/**
+ * @brief Store the checkpoint of the partially received file in the specified OTA context.
+ *
+ * Only used if otaconfigCHECKPOINT_INTERVAL_BLOCKS is not 0. The checkpoint is an opaque record
+ * built by the OTA agent. It must be kept in non-volatile memory so that it survives a reset, and it
+ * replaces any checkpoint stored before. The blocks written with prvPAL_WriteBlock() so far must be
+ * in non-volatile memory before the checkpoint is stored, since the checkpoint marks them as received.
+ *
+ * If pucCheckpoint is NULL, the stored checkpoint is erased. This is done when the file is complete,
+ * the job fails or a different file is received.
+ *
+ * @note The input OTA_FileContext_t C is checked for NULL by the OTA agent before this
+ * function is called.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] pucCheckpoint The checkpoint to store or NULL to erase the stored checkpoint.
+ * @param[in] ulSize The size of the checkpoint in bytes.
+ *
+ * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
+ * error codes information in aws_ota_agent.h.
+ *
+ * kOTA_Err_None is returned when the checkpoint was stored or erased.
+ * kOTA_Err_CheckpointFailed is returned otherwise.
+ */
+OTA_Err_t prvPAL_SaveCheckpoint( OTA_FileContext_t * const C,
+                                 const uint8_t * pucCheckpoint,
+                                 uint32_t ulSize );
+
+/**
+ * @brief Open the partially received file for the specified OTA context and read its checkpoint.
+ *
+ * Only used if otaconfigCHECKPOINT_INTERVAL_BLOCKS is not 0. Opens the receive file like
+ * prvPAL_CreateFileForRx() but without erasing it, and copies the checkpoint last stored with
+ * prvPAL_SaveCheckpoint() to pucCheckpoint. The OTA agent checks that the checkpoint belongs to the
+ * job and file in C. If it does not, the agent erases the checkpoint, aborts the file and creates it
+ * again with prvPAL_CreateFileForRx(). The PAL must not return a checkpoint if the receive file no
+ * longer holds the data it was stored for, e.g. because prvPAL_Abort() erased the file.
+ *
+ * The PAL must not start a signature verification context here. The agent restores the one saved in
+ * the checkpoint to C->pvSigVerifyContext.
+ *
+ * @note The input OTA_FileContext_t C is checked for NULL by the OTA agent before this
+ * function is called.
+ *
+ * @param[in] C OTA file context information.
+ * @param[out] pucCheckpoint Buffer to receive the checkpoint.
+ * @param[in] ulBufferSize The size of pucCheckpoint in bytes.
+ * @param[out] pulSize The size of the checkpoint in bytes.
+ *
+ * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
+ * error codes information in aws_ota_agent.h.
+ *
+ * kOTA_Err_None is returned when the file was opened and the checkpoint read.
+ * kOTA_Err_NoCheckpoint is returned when there is no checkpoint, it does not fit in pucCheckpoint or
+ * the file could not be opened. The file is left closed in that case.
+ */
+OTA_Err_t prvPAL_ResumeFileForRx( OTA_FileContext_t * const C,
+                                  uint8_t * pucCheckpoint,
+                                  uint32_t ulBufferSize,
+                                  uint32_t * pulSize );
+
+/**
+ * @brief Read part of the running image to rebuild the new image from a delta file.
+ *
+ * Only used if otaconfigDELTA_BUFFER_SIZE is not 0. The running image is the base image of the delta
+ * file in the specified OTA context. The agent first reads it from offset 0 to the base image size
+ * given in the delta file to check its hash against C->pxBaseHash, then reads the parts the new image
+ * is made from while it writes the new image with prvPAL_WriteBlock(). Reads beyond the end of the
+ * running image partition or file shall fail.
+ *
+ * @note The input OTA_FileContext_t C is checked for NULL by the OTA agent before this
+ * function is called.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] ulOffset Byte offset to read from the beginning of the running image.
+ * @param[out] pucData Buffer receiving the data.
+ * @param[in] ulSize The number of bytes to read.
+ *
+ * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
+ * error codes information in aws_ota_agent.h.
+ *
+ * kOTA_Err_None is returned when all ulSize bytes were read.
+ * kOTA_Err_BaseImageMismatch is returned otherwise.
+ */
+OTA_Err_t prvPAL_ReadBaseImage( OTA_FileContext_t * const C,
+                                uint32_t ulOffset,
+                                uint8_t * pucData,
+                                uint32_t ulSize );
+
 /**
  * @brief Write a block of data to the specified file at the given offset.
  *
@@ -120,6 +224,8 @@ OTA_Err_t prvPAL_CloseFile( OTA_FileContext_t * const C );
  * pacData is checked for NULL by the OTA agent before this function is called.
  * ulBlockSize is validated for range by the OTA agent before this function is called.
  * ulBlockIndex is validated by the OTA agent before this function is called.
+ * pacData points into the received message buffer, so it may not be aligned and it
+ * is only valid until this function returns. The PAL must not modify the data.
  *
  * @param[in] C OTA file context information.
  * @param[in] ulOffset Byte offset to write to from the beginning of the file.
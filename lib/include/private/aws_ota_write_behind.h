@@ -0,0 +1,182 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#ifndef __AWS_OTAWRITEBEHIND__H__
+#define __AWS_OTAWRITEBEHIND__H__
+
+#include <stdint.h>
+
+/**
+ * @brief Write-behind buffer for OTA file writes.
+ *
+ * Writes at any offset are copied into page buffers that each hold one page of the file, aligned
+ * to the page size. A page is handed to the submit function once it is complete, so flash that is
+ * programmed in pages sees one aligned write per page instead of a read-modify-write for each
+ * write. The submit function passes the page to whatever programs it, usually another task, and
+ * the page buffer is not touched until the wait function returns it, so the next writes are
+ * buffered while the page is programmed.
+ *
+ * If a write needs a page buffer and none is free, the buffer waits for a page being programmed or,
+ * if none is, submits the oldest incomplete page with only the parts that were written. Pages are
+ * submitted in order, so a later write to the same part of the file is programmed after an earlier
+ * one. The page buffers are supplied by the caller, so the write-behind buffer does not allocate
+ * memory.
+ */
+
+#define OTA_WRITE_BEHIND_MAX_PAGES      8U           /*!< Largest number of page buffers. */
+#define OTA_WRITE_BEHIND_MAX_EXTENTS    8U           /*!< Most separate parts of a page written before it is submitted. */
+#define OTA_WRITE_BEHIND_NO_PAGE        0xffffffffUL /*!< File offset of a page buffer that is not in use. */
+
+/**
+ * @brief A page of the file held by the write-behind buffer.
+ *
+ * The written parts of the page are kept as extents, sorted and merged when they touch. A page is
+ * complete when a single extent covers all of it, or all of it up to the image size.
+ */
+typedef struct
+{
+    uint8_t * pucData;                                  /*!< The page buffer. */
+    uint32_t ulOffset;                                  /*!< File offset of the page or OTA_WRITE_BEHIND_NO_PAGE. */
+    uint32_t ulSequence;                                /*!< Order in which the pages were started. */
+    int32_t lResult;                                    /*!< Set by OTA_WriteBehind_Program(), 0 or negative. */
+    uint32_t ulExtents;                                 /*!< Number of written parts of the page. */
+    uint32_t ulExtentStart[ OTA_WRITE_BEHIND_MAX_EXTENTS ]; /*!< Page offset of each written part. */
+    uint32_t ulExtentEnd[ OTA_WRITE_BEHIND_MAX_EXTENTS ];   /*!< Page offset just past each written part. */
+    uint8_t ucState;                                    /*!< Whether the page is free, being written or submitted. */
+} OTA_WriteBehindPage_t;
+
+/**
+ * @brief Output function of the write-behind buffer, which programs the file.
+ *
+ * Called by OTA_WriteBehind_Program() with the next ulSize bytes of the file, starting at ulOffset.
+ * Returns the number of bytes written, or a negative value if the data could not be written.
+ */
+typedef int32_t (* OTA_WriteBehindOutput_t)( void * pvContext,
+                                             uint32_t ulOffset,
+                                             const uint8_t * pucData,
+                                             uint32_t ulSize );
+
+/**
+ * @brief Submit function of the write-behind buffer.
+ *
+ * Passes a page to be programmed with OTA_WriteBehind_Program(). Pages must be programmed in the
+ * order they are submitted. Must not block for long, since at most all page buffers are submitted.
+ */
+typedef void (* OTA_WriteBehindSubmit_t)( void * pvContext,
+                                          OTA_WriteBehindPage_t * pxPage );
+
+/**
+ * @brief Wait function of the write-behind buffer.
+ *
+ * Waits until the next submitted page has been programmed and returns it. Only called while at
+ * least one page is submitted.
+ */
+typedef OTA_WriteBehindPage_t * (* OTA_WriteBehindWait_t)( void * pvContext );
+
+/**
+ * @brief State of the write-behind buffer. All fields except the statistics are private to
+ * aws_ota_write_behind.c.
+ */
+typedef struct
+{
+    OTA_WriteBehindPage_t xPages[ OTA_WRITE_BEHIND_MAX_PAGES ]; /* The page buffers. */
+    uint32_t ulNumPages;                                        /* Number of page buffers. */
+    uint32_t ulPageSize;                                        /* Size of a page in bytes. */
+    uint32_t ulImageSize;                                       /* Size of the file, or 0 if not known. */
+    uint32_t ulSequence;                                        /* Sequence number of the next page started. */
+    uint32_t ulSubmitted;                                       /* Number of pages submitted and not yet returned. */
+    int32_t lError;                                             /* First error returned by a programmed page. */
+    OTA_WriteBehindSubmit_t xSubmit;                            /* The submit function. */
+    OTA_WriteBehindWait_t xWait;                                /* The wait function. */
+    void * pvContext;                                           /* Context passed to the functions above. */
+    uint32_t ulFullPages;                                       /* Statistics: complete pages submitted. */
+    uint32_t ulPartialPages;                                    /* Statistics: incomplete pages submitted. */
+    uint32_t ulWaits;                                           /* Statistics: writes that waited for a page to be programmed. */
+} OTA_WriteBehind_t;
+
+/**
+ * @brief Prepare the write-behind buffer for a new file.
+ *
+ * @param[in] pxCtx The write-behind buffer state.
+ * @param[in] pucBuffer Buffer of ulNumPages * ulPageSize bytes for the pages.
+ * @param[in] ulPageSize Size of a page in bytes. Must not be 0.
+ * @param[in] ulNumPages Number of page buffers, from 1 to OTA_WRITE_BEHIND_MAX_PAGES. Pages are
+ * only programmed while the next ones are written if there are at least 2.
+ * @param[in] ulImageSize Size of the file, so that the last page is complete without being full,
+ * or 0 if the size is not known. The last page is then submitted by OTA_WriteBehind_Flush().
+ * @param[in] xSubmit Function passing pages to be programmed.
+ * @param[in] xWait Function waiting for a programmed page.
+ * @param[in] pvContext Context passed to xSubmit and xWait.
+ */
+void OTA_WriteBehind_Init( OTA_WriteBehind_t * pxCtx,
+                           uint8_t * pucBuffer,
+                           uint32_t ulPageSize,
+                           uint32_t ulNumPages,
+                           uint32_t ulImageSize,
+                           OTA_WriteBehindSubmit_t xSubmit,
+                           OTA_WriteBehindWait_t xWait,
+                           void * pvContext );
+
+/**
+ * @brief Write ulSize bytes of the file at ulOffset.
+ *
+ * The data is copied, so it only has to be valid during the call.
+ *
+ * @return ulSize, or a negative value if a page could not be programmed. Once a page fails, all
+ * further writes fail.
+ */
+int32_t OTA_WriteBehind_Write( OTA_WriteBehind_t * pxCtx,
+                               uint32_t ulOffset,
+                               const uint8_t * pucData,
+                               uint32_t ulSize );
+
+/**
+ * @brief Submit all pages and wait until they are programmed.
+ *
+ * Must be called before anything reads the file back, such as the signature check at close.
+ *
+ * @return 0 if all pages written so far were programmed, otherwise a negative value.
+ */
+int32_t OTA_WriteBehind_Flush( OTA_WriteBehind_t * pxCtx );
+
+/**
+ * @brief Drop all pages that were not submitted and wait until the submitted ones are programmed.
+ *
+ * Used when the file is aborted. Afterwards no page is submitted or being programmed.
+ */
+void OTA_WriteBehind_Discard( OTA_WriteBehind_t * pxCtx );
+
+/**
+ * @brief Program the written parts of a submitted page with xOutput.
+ *
+ * Called by whatever programs the submitted pages. Stores the result in pxPage->lResult.
+ *
+ * @return 0 if all parts were written, otherwise a negative value.
+ */
+int32_t OTA_WriteBehind_Program( OTA_WriteBehindPage_t * pxPage,
+                                 OTA_WriteBehindOutput_t xOutput,
+                                 void * pvContext );
+
+#endif /* ifndef __AWS_OTAWRITEBEHIND__H__ */
@@ -78,6 +78,9 @@ only for ports that are using the MPU. */
 		#define vTaskList								MPU_vTaskList
 		#define vTaskGetRunTimeStats					MPU_vTaskGetRunTimeStats
 		#define xTaskGetIdleRunTimeCounter				MPU_xTaskGetIdleRunTimeCounter
+		#define vTaskSetISRName							MPU_vTaskSetISRName
+		#define uxTaskGetISRState						MPU_uxTaskGetISRState
+		#define vTaskResetLatencyStats					MPU_vTaskResetLatencyStats
 		#define xTaskGenericNotify						MPU_xTaskGenericNotify
 		#define xTaskNotifyWait							MPU_xTaskNotifyWait
 		#define ulTaskNotifyTake						MPU_ulTaskNotifyTake
@@ -90,7 +93,9 @@ only for ports that are using the MPU. */
 
 		/* Map standard queue.h API functions to the MPU equivalents. */
 		#define xQueueGenericSend						MPU_xQueueGenericSend
+		#define xQueueSendMultiple						MPU_xQueueSendMultiple
 		#define xQueueReceive							MPU_xQueueReceive
+		#define xQueueReceiveMultiple					MPU_xQueueReceiveMultiple
 		#define xQueuePeek								MPU_xQueuePeek
 		#define xQueueSemaphoreTake						MPU_xQueueSemaphoreTake
 		#define uxQueueMessagesWaiting					MPU_uxQueueMessagesWaiting
@@ -145,6 +150,10 @@ only for ports that are using the MPU. */
 		#define xStreamBufferSend						MPU_xStreamBufferSend
 		#define xStreamBufferReceive					MPU_xStreamBufferReceive
 		#define xStreamBufferNextMessageLengthBytes		MPU_xStreamBufferNextMessageLengthBytes
+		#define xStreamBufferReserve					MPU_xStreamBufferReserve
+		#define xStreamBufferCommit						MPU_xStreamBufferCommit
+		#define xStreamBufferPeek						MPU_xStreamBufferPeek
+		#define xStreamBufferConsume					MPU_xStreamBufferConsume
 		#define vStreamBufferDelete						MPU_vStreamBufferDelete
 		#define xStreamBufferIsFull						MPU_xStreamBufferIsFull
 		#define xStreamBufferIsEmpty					MPU_xStreamBufferIsEmpty
@@ -114,15 +114,27 @@ extern "C" {
 	#endif
 #endif
 
-/* Used by heap_5.c. */
+/* Used by heap_5.c and heap_6.c. */
 typedef struct HeapRegion
 {
 	uint8_t *pucStartAddress;
 	size_t xSizeInBytes;
 } HeapRegion_t;
 
+/* Used to pass information about the heap out of vPortGetHeapStats(). */
+typedef struct xHeapStats
+{
+	size_t xAvailableHeapSpaceInBytes;		/* The total heap size currently available - this is the sum of all the free blocks, not the largest block that can be allocated. */
+	size_t xSizeOfLargestFreeBlockInBytes;	/* The maximum size, in bytes, of all the free blocks within the heap at the time vPortGetHeapStats() is called. */
+	size_t xSizeOfSmallestFreeBlockInBytes; /* The minimum size, in bytes, of all the free blocks within the heap at the time vPortGetHeapStats() is called. */
+	size_t xNumberOfFreeBlocks;				/* The number of free memory blocks within the heap at the time vPortGetHeapStats() is called. */
+	size_t xMinimumEverFreeBytesRemaining;	/* The minimum amount of total free memory (sum of all free blocks) there has been in the heap since the system booted. */
+	size_t xNumberOfSuccessfulAllocations;	/* The number of calls to pvPortMalloc() that have returned a valid memory block. */
+	size_t xNumberOfSuccessfulFrees;		/* The number of calls to vPortFree() that has successfully freed a block of memory. */
+} HeapStats_t;
+
 /*
- * Used to define multiple heap regions for use by heap_5.c.  This function
+ * Used to define multiple heap regions for use by heap_5.c and heap_6.c.  This function
  * must be called before any calls to pvPortMalloc() - not creating a task,
  * queue, semaphore, mutex, software timer, event group, etc. will result in
  * pvPortMalloc being called.
@@ -144,6 +156,83 @@ void vPortInitialiseBlocks( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetMinimumEverFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * Fills pxHeapStats with the free space and the free blocks of the heap, from
+ * which its fragmentation can be seen.  The free blocks are searched, so this
+ * is not for use where timing matters.  Implemented by heap_4.c and heap_6.c.
+ */
+void vPortGetHeapStats( HeapStats_t *pxHeapStats ) PRIVILEGED_FUNCTION;
+
+#if( configUSE_HEAP_ACCOUNTING == 1 )
+
+	/* FreeRTOS.h has not defaulted it yet. */
+	#ifndef configMAX_TASK_NAME_LEN
+		#define configMAX_TASK_NAME_LEN 16
+	#endif
+
+	/* Used to pass the heap used by each task out of uxPortGetHeapTaskUsage().
+	Entry 0 holds the blocks allocated before the scheduler was started, and by
+	tasks that found the table full. */
+	typedef struct xHEAP_TASK_USAGE
+	{
+		void *pvTask;								/* The handle of the task, or NULL for entry 0 and for a task that has been deleted but whose blocks have not all been freed. */
+		char pcTaskName[ configMAX_TASK_NAME_LEN ];	/* The name of the task, which is kept after the task is deleted. */
+		size_t xLiveBytes;							/* The heap, including the block headers, currently allocated by the task. */
+		size_t xPeakBytes;							/* The most heap the task has had allocated at any one time. */
+	} HeapTaskUsage_t;
+
+	/* Used to pass the heap used by each call site out of
+	uxPortGetHeapCallSiteUsage().  Entry 0 holds the call sites that found the
+	table full. */
+	typedef struct xHEAP_CALL_SITE_USAGE
+	{
+		const void *pvCallSite;		/* The address pvPortMalloc() returned to, from portHEAP_CALL_SITE(). */
+		size_t xLiveBytes;			/* The heap, including the block headers, currently allocated from the call site. */
+		size_t xPeakBytes;			/* The most heap allocated from the call site at any one time. */
+		size_t xAllocations;		/* The number of blocks allocated from the call site. */
+	} HeapCallSiteUsage_t;
+
+	/* An allocation or a free, as read by uxPortReadHeapEvents(). */
+	#define portHEAP_EVENT_FREE		( ( uint32_t ) 0xffffffffUL )
+	typedef struct xHEAP_EVENT
+	{
+		uint32_t ulTime;			/* The tick count when the event was recorded. */
+		uint32_t ulAddress;			/* The low 32 bits of the address of the block, as returned by pvPortMalloc(). */
+		uint32_t ulSize;			/* The size passed to pvPortMalloc(), or portHEAP_EVENT_FREE for a free. */
+		uint16_t usTask;			/* The entry of the task that allocated the block in uxPortGetHeapTaskUsage(). */
+		uint16_t usCallSite;		/* The entry of the call site that allocated the block in uxPortGetHeapCallSiteUsage(). */
+	} HeapEvent_t;
+
+	/*
+	 * Copy the heap used by each task, and by each call site, into pxUsage, and
+	 * return the number of entries copied, at most uxArraySize.  The tables
+	 * have configHEAP_ACCOUNTING_MAX_TASKS and
+	 * configHEAP_ACCOUNTING_MAX_CALL_SITES entries.  Implemented by
+	 * heap_accounting.c, for heap_4.c and heap_6.c.
+	 */
+	UBaseType_t uxPortGetHeapTaskUsage( HeapTaskUsage_t *pxUsage, UBaseType_t uxArraySize ) PRIVILEGED_FUNCTION;
+	UBaseType_t uxPortGetHeapCallSiteUsage( HeapCallSiteUsage_t *pxUsage, UBaseType_t uxArraySize ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Move up to uxArraySize of the oldest recorded allocations and frees into
+	 * pxEvents, and return the number moved.  The events are recorded into a
+	 * buffer of configHEAP_ACCOUNTING_EVENT_COUNT events, which has to be read
+	 * often enough not to fill up; the events that found it full are dropped,
+	 * and their number since the last call is returned in *pulDropped.
+	 */
+	UBaseType_t uxPortReadHeapEvents( HeapEvent_t *pxEvents, UBaseType_t uxArraySize, uint32_t *pulDropped ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Called by the heap, with the scheduler suspended, when it has allocated
+	 * or is about to free a block.  xBlockSize includes the block header.  The
+	 * value returned by ulPortHeapAccountMalloc() is kept in the block header
+	 * and passed back to vPortHeapAccountFree().
+	 */
+	uint32_t ulPortHeapAccountMalloc( const void *pvAddress, size_t xRequestedSize, size_t xBlockSize, const void *pvCallSite ) PRIVILEGED_FUNCTION;
+	void vPortHeapAccountFree( const void *pvAddress, size_t xBlockSize, uint32_t ulHeapTag ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_HEAP_ACCOUNTING */
+
 /*
  * Setup the hardware ready for the scheduler to take control.  This generally
  * sets up a tick interrupt and sets timers for the correct tick frequency.
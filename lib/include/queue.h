@@ -1384,6 +1384,199 @@ BaseType_t xQueueGiveFromISR( QueueHandle_t xQueue, BaseType_t * const pxHigherP
  */
 BaseType_t xQueueReceiveFromISR( QueueHandle_t xQueue, void * const pvBuffer, BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
 
+/**
+ * queue. h
+ * <pre>
+ BaseType_t xQueueSendMultiple(
+								  QueueHandle_t xQueue,
+								  const void * const pvItems,
+								  const UBaseType_t uxItemCount,
+								  TickType_t xTicksToWait
+							  );
+ * </pre>
+ *
+ * Post up to uxItemCount items to the back of a queue in one operation.  The
+ * items are copied into the queue together, and the tasks waiting to receive
+ * them are unblocked together, so sending n items costs one critical section
+ * and at most one context switch rather than n of each.
+ *
+ * As many of the items as there is space for are sent.  The calling task only
+ * blocks if the queue is full, so fewer than uxItemCount items may be sent
+ * even when xTicksToWait is not zero.  The items that were not sent are the
+ * last ones in pvItems.
+ *
+ * Items are posted in order, so they are received in the same order as if
+ * they had been posted one at a time with xQueueSendToBack().  If the queue is
+ * a member of a queue set, the queue set receives the handle of the queue
+ * once for each item.  This function must not be used on a semaphore.
+ *
+ * @param xQueue The handle to the queue on which the items are to be posted.
+ *
+ * @param pvItems A pointer to the items that are to be placed on the queue,
+ * one after the other.  The size of each item is the item size defined when
+ * the queue was created.
+ *
+ * @param uxItemCount The number of items in pvItems.
+ *
+ * @param xTicksToWait The maximum amount of time the task should block
+ * waiting for space to become available on the queue, should it be full.  The
+ * call will return immediately if this is set to 0.
+ *
+ * @return The number of items that were posted, or 0 if the queue stayed full
+ * until the block time expired.
+ *
+ * Example usage:
+   <pre>
+ #define SAMPLE_COUNT 16
+
+ void vAFunction( QueueHandle_t xQueue )
+ {
+ uint16_t usSamples[ SAMPLE_COUNT ];
+ UBaseType_t uxSent = 0;
+
+	// Fill usSamples with SAMPLE_COUNT samples, then post them to a queue
+	// created with an item size of sizeof( uint16_t ).
+	while( uxSent < SAMPLE_COUNT )
+	{
+		uxSent += xQueueSendMultiple( xQueue, &( usSamples[ uxSent ] ), SAMPLE_COUNT - uxSent, portMAX_DELAY );
+	}
+ }
+ </pre>
+ * \defgroup xQueueSendMultiple xQueueSendMultiple
+ * \ingroup QueueManagement
+ */
+BaseType_t xQueueSendMultiple( QueueHandle_t xQueue, const void * const pvItems, const UBaseType_t uxItemCount, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * queue. h
+ * <pre>
+ BaseType_t xQueueSendMultipleFromISR(
+										 QueueHandle_t xQueue,
+										 const void * const pvItems,
+										 const UBaseType_t uxItemCount,
+										 BaseType_t *pxHigherPriorityTaskWoken
+									 );
+ * </pre>
+ *
+ * A version of xQueueSendMultiple() that can be used in an interrupt service
+ * routine.  It posts as many of the items as there is space for and never
+ * blocks.  If the queue is a member of a queue set and a task has it locked
+ * when the interrupt occurs, at most 127 items are posted until the task
+ * unlocks it, as the queue set is told about each of them then.
+ *
+ * @param xQueue The handle to the queue on which the items are to be posted.
+ *
+ * @param pvItems A pointer to the items that are to be placed on the queue.
+ *
+ * @param uxItemCount The number of items in pvItems.
+ *
+ * @param pxHigherPriorityTaskWoken xQueueSendMultipleFromISR() will set
+ * *pxHigherPriorityTaskWoken to pdTRUE if sending the items caused a task to
+ * unblock, and the unblocked task has a priority higher than the currently
+ * running task.  If xQueueSendMultipleFromISR() sets this value to pdTRUE
+ * then a context switch should be requested before the interrupt is exited.
+ *
+ * @return The number of items that were posted, or 0 if the queue was full.
+ *
+ * \defgroup xQueueSendMultipleFromISR xQueueSendMultipleFromISR
+ * \ingroup QueueManagement
+ */
+BaseType_t xQueueSendMultipleFromISR( QueueHandle_t xQueue, const void * const pvItems, const UBaseType_t uxItemCount, BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
+
+/**
+ * queue. h
+ * <pre>
+ BaseType_t xQueueReceiveMultiple(
+									 QueueHandle_t xQueue,
+									 void * const pvBuffer,
+									 const UBaseType_t uxMaxItems,
+									 TickType_t xTicksToWait
+								 );
+ * </pre>
+ *
+ * Receive up to uxMaxItems items from the front of a queue in one operation.
+ * The items are copied out of the queue together, and the tasks waiting for
+ * the space are unblocked together.
+ *
+ * The calling task receives the items that are in the queue, up to
+ * uxMaxItems, and only blocks if the queue is empty.  It does not wait for
+ * the queue to hold uxMaxItems items.  This function must not be used on a
+ * semaphore.
+ *
+ * @param xQueue The handle to the queue from which the items are to be
+ * received.
+ *
+ * @param pvBuffer Pointer to the buffer into which the received items will be
+ * copied, one after the other.  It must have room for uxMaxItems items.
+ *
+ * @param uxMaxItems The largest number of items to receive.
+ *
+ * @param xTicksToWait The maximum amount of time the task should block
+ * waiting for an item to receive should the queue be empty at the time of the
+ * call.  The call will return immediately if this is set to 0.
+ *
+ * @return The number of items that were received, or 0 if the queue stayed
+ * empty until the block time expired.
+ *
+ * Example usage:
+   <pre>
+ #define MAX_SAMPLES 16
+
+ void vATask( void *pvParameters )
+ {
+ QueueHandle_t xQueue = ( QueueHandle_t ) pvParameters;
+ uint16_t usSamples[ MAX_SAMPLES ];
+ BaseType_t xReceived;
+
+	for( ;; )
+	{
+		// Wait for at least one sample, and take all that are waiting.
+		xReceived = xQueueReceiveMultiple( xQueue, usSamples, MAX_SAMPLES, portMAX_DELAY );
+		vProcessSamples( usSamples, xReceived );
+	}
+ }
+ </pre>
+ * \defgroup xQueueReceiveMultiple xQueueReceiveMultiple
+ * \ingroup QueueManagement
+ */
+BaseType_t xQueueReceiveMultiple( QueueHandle_t xQueue, void * const pvBuffer, const UBaseType_t uxMaxItems, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * queue. h
+ * <pre>
+ BaseType_t xQueueReceiveMultipleFromISR(
+											QueueHandle_t xQueue,
+											void * const pvBuffer,
+											const UBaseType_t uxMaxItems,
+											BaseType_t *pxHigherPriorityTaskWoken
+										);
+ * </pre>
+ *
+ * A version of xQueueReceiveMultiple() that can be used in an interrupt
+ * service routine.  It receives the items that are in the queue, up to
+ * uxMaxItems, and never blocks.
+ *
+ * @param xQueue The handle to the queue from which the items are to be
+ * received.
+ *
+ * @param pvBuffer Pointer to the buffer into which the received items will be
+ * copied.  It must have room for uxMaxItems items.
+ *
+ * @param uxMaxItems The largest number of items to receive.
+ *
+ * @param pxHigherPriorityTaskWoken xQueueReceiveMultipleFromISR() will set
+ * *pxHigherPriorityTaskWoken to pdTRUE if receiving the items caused a task to
+ * unblock, and the unblocked task has a priority higher than the currently
+ * running task.
+ *
+ * @return The number of items that were received, or 0 if the queue was
+ * empty.
+ *
+ * \defgroup xQueueReceiveMultipleFromISR xQueueReceiveMultipleFromISR
+ * \ingroup QueueManagement
+ */
+BaseType_t xQueueReceiveMultipleFromISR( QueueHandle_t xQueue, void * const pvBuffer, const UBaseType_t uxMaxItems, BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
+
 /*
  * Utilities to query queues that are safe to use from an ISR.  These utilities
  * should be used only from witin an ISR, or within a critical section.
@@ -64,6 +64,18 @@ extern "C" {
 struct StreamBufferDef_t;
 typedef struct StreamBufferDef_t * StreamBufferHandle_t;
 
+/**
+ * Used by xStreamBufferReserve() and xStreamBufferPeek() to describe bytes
+ * inside the stream buffer's own storage area.  The bytes start at
+ * pucData[ 0 ] and, if they wrap back to the start of the storage area,
+ * continue at pucData[ 1 ].  An unused region has a length of 0.
+ */
+typedef struct xSTREAM_BUFFER_REGIONS
+{
+	uint8_t *pucData[ 2 ];
+	size_t xLength[ 2 ];
+} StreamBufferRegions_t;
+
 
 /**
  * message_buffer.h
@@ -586,6 +598,259 @@ size_t xStreamBufferReceiveFromISR( StreamBufferHandle_t xStreamBuffer,
 									size_t xBufferLengthBytes,
 									BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
 
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferReserve( StreamBufferHandle_t xStreamBuffer,
+                             size_t xDataLengthBytes,
+                             StreamBufferRegions_t * const pxRegions,
+                             TickType_t xTicksToWait );
+</pre>
+ *
+ * Reserves free space in a stream buffer, so the writer can write the data
+ * directly into the stream buffer's storage area instead of into a buffer of
+ * its own that xStreamBufferSend() then copies from.  The reserved bytes are
+ * not available to the reader until they are passed to xStreamBufferCommit().
+ *
+ * The reserved space is described by *pxRegions as one region, or as two if
+ * it wraps back to the start of the storage area, in which case the data must
+ * be split between the two.
+ *
+ * Like xStreamBufferSend(), xStreamBufferReserve() is a writing API function,
+ * so the same single writer restrictions apply, and the writer must not send
+ * to or reserve space in the stream buffer again until it has committed the
+ * reservation.  Use xStreamBufferReserveFromISR() to reserve space from an
+ * interrupt service routine (ISR).
+ *
+ * @param xStreamBuffer The handle of the stream buffer in which space is
+ * being reserved.
+ *
+ * @param xDataLengthBytes The number of bytes wanted.
+ *
+ * @param pxRegions Set to describe the reserved bytes.
+ *
+ * @param xTicksToWait The maximum amount of time the calling task should
+ * remain in the Blocked state to wait for xDataLengthBytes bytes to be free,
+ * as with xStreamBufferSend().
+ *
+ * @return The number of bytes reserved.  If the block time expires first,
+ * as many bytes as are free are reserved, which may be 0.
+ *
+ * Example use:
+<pre>
+void vAFunction( StreamBufferHandle_t xStreamBuffer )
+{
+StreamBufferRegions_t xRegions;
+size_t xReserved;
+
+    // Reserve up to 64 bytes, waiting up to 100ms for them to be free.
+    xReserved = xStreamBufferReserve( xStreamBuffer, 64, &xRegions, pdMS_TO_TICKS( 100 ) );
+
+    // Write the data straight into the stream buffer, for example by
+    // receiving it from a peripheral, then make it available to the reader.
+    vReceiveBytes( xRegions.pucData[ 0 ], xRegions.xLength[ 0 ] );
+    vReceiveBytes( xRegions.pucData[ 1 ], xRegions.xLength[ 1 ] );
+    xStreamBufferCommit( xStreamBuffer, xReserved );
+}
+</pre>
+ * \defgroup xStreamBufferReserve xStreamBufferReserve
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferReserve( StreamBufferHandle_t xStreamBuffer,
+							 size_t xDataLengthBytes,
+							 StreamBufferRegions_t * const pxRegions,
+							 TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferReserveFromISR( StreamBufferHandle_t xStreamBuffer,
+                                    size_t xDataLengthBytes,
+                                    StreamBufferRegions_t * const pxRegions );
+</pre>
+ *
+ * A version of xStreamBufferReserve() that can be called from an interrupt
+ * service routine (ISR).  It does not block, so it reserves as many of the
+ * xDataLengthBytes bytes as are free.  Use xStreamBufferCommitFromISR() to
+ * commit them.
+ *
+ * \defgroup xStreamBufferReserveFromISR xStreamBufferReserveFromISR
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferReserveFromISR( StreamBufferHandle_t xStreamBuffer,
+									size_t xDataLengthBytes,
+									StreamBufferRegions_t * const pxRegions ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferCommit( StreamBufferHandle_t xStreamBuffer, size_t xDataLengthBytes );
+</pre>
+ *
+ * Makes the first xDataLengthBytes bytes of the space reserved by
+ * xStreamBufferReserve() available to the reader, and unblocks a task waiting
+ * for data as xStreamBufferSend() does.  xDataLengthBytes can be less than
+ * the number of bytes reserved, and the rest of the reservation is then
+ * abandoned.  Committing 0 bytes abandons the reservation.
+ *
+ * Use xStreamBufferCommitFromISR() to commit from an interrupt service routine
+ * (ISR).
+ *
+ * @param xStreamBuffer The handle of the stream buffer in which space was
+ * reserved.
+ *
+ * @param xDataLengthBytes The number of bytes written to the reserved space.
+ *
+ * @return xDataLengthBytes.
+ *
+ * \defgroup xStreamBufferCommit xStreamBufferCommit
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferCommit( StreamBufferHandle_t xStreamBuffer,
+							size_t xDataLengthBytes ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferCommitFromISR( StreamBufferHandle_t xStreamBuffer,
+                                   size_t xDataLengthBytes,
+                                   BaseType_t * const pxHigherPriorityTaskWoken );
+</pre>
+ *
+ * A version of xStreamBufferCommit() that can be called from an interrupt
+ * service routine (ISR).  pxHigherPriorityTaskWoken is used as it is by
+ * xStreamBufferSendFromISR().
+ *
+ * \defgroup xStreamBufferCommitFromISR xStreamBufferCommitFromISR
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferCommitFromISR( StreamBufferHandle_t xStreamBuffer,
+								   size_t xDataLengthBytes,
+								   BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferPeek( StreamBufferHandle_t xStreamBuffer,
+                          StreamBufferRegions_t * const pxRegions,
+                          TickType_t xTicksToWait );
+</pre>
+ *
+ * Describes the data in a stream buffer without removing it, so the reader
+ * can parse the data where it is instead of copying it out with
+ * xStreamBufferReceive() first.  The data stays in the stream buffer, and the
+ * regions stay valid, until the reader passes the number of bytes it is done
+ * with to xStreamBufferConsume().
+ *
+ * Like xStreamBufferReceive(), xStreamBufferPeek() is a reading API function,
+ * so the same single reader restrictions apply.  Use
+ * xStreamBufferPeekFromISR() to peek from an interrupt service routine (ISR).
+ *
+ * @param xStreamBuffer The handle of the stream buffer being read.
+ *
+ * @param pxRegions Set to describe all the data in the stream buffer, as one
+ * region, or as two if the data wraps back to the start of the storage area.
+ *
+ * @param xTicksToWait The maximum amount of time the calling task should
+ * remain in the Blocked state to wait for data, as with
+ * xStreamBufferReceive().
+ *
+ * @return The number of bytes described, which is 0 if the block time
+ * expired before any data was available.
+ *
+ * Example use:
+<pre>
+void vAFunction( StreamBufferHandle_t xStreamBuffer )
+{
+StreamBufferRegions_t xRegions;
+size_t xParsed;
+
+    ( void ) xStreamBufferPeek( xStreamBuffer, &xRegions, portMAX_DELAY );
+
+    // Parse as much of the data as possible where it is, then remove the
+    // bytes that were parsed from the stream buffer.
+    xParsed = xParseBytes( &xRegions );
+    xStreamBufferConsume( xStreamBuffer, xParsed );
+}
+</pre>
+ * \defgroup xStreamBufferPeek xStreamBufferPeek
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferPeek( StreamBufferHandle_t xStreamBuffer,
+						  StreamBufferRegions_t * const pxRegions,
+						  TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferPeekFromISR( StreamBufferHandle_t xStreamBuffer,
+                                 StreamBufferRegions_t * const pxRegions );
+</pre>
+ *
+ * A version of xStreamBufferPeek() that can be called from an interrupt
+ * service routine (ISR).  It does not block.  Use
+ * xStreamBufferConsumeFromISR() to remove the data.
+ *
+ * \defgroup xStreamBufferPeekFromISR xStreamBufferPeekFromISR
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferPeekFromISR( StreamBufferHandle_t xStreamBuffer,
+								 StreamBufferRegions_t * const pxRegions ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferConsume( StreamBufferHandle_t xStreamBuffer, size_t xDataLengthBytes );
+</pre>
+ *
+ * Removes the first xDataLengthBytes bytes of the data described by
+ * xStreamBufferPeek() from the stream buffer, and unblocks a task waiting for
+ * space as xStreamBufferReceive() does.  The regions must not be used after
+ * this.
+ *
+ * Use xStreamBufferConsumeFromISR() to consume from an interrupt service
+ * routine (ISR).
+ *
+ * @param xStreamBuffer The handle of the stream buffer being read.
+ *
+ * @param xDataLengthBytes The number of bytes to remove.
+ *
+ * @return The number of bytes removed, which is less than xDataLengthBytes
+ * only if the stream buffer held fewer bytes.
+ *
+ * \defgroup xStreamBufferConsume xStreamBufferConsume
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferConsume( StreamBufferHandle_t xStreamBuffer,
+							 size_t xDataLengthBytes ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferConsumeFromISR( StreamBufferHandle_t xStreamBuffer,
+                                    size_t xDataLengthBytes,
+                                    BaseType_t * const pxHigherPriorityTaskWoken );
+</pre>
+ *
+ * A version of xStreamBufferConsume() that can be called from an interrupt
+ * service routine (ISR).  pxHigherPriorityTaskWoken is used as it is by
+ * xStreamBufferReceiveFromISR().
+ *
+ * \defgroup xStreamBufferConsumeFromISR xStreamBufferConsumeFromISR
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferConsumeFromISR( StreamBufferHandle_t xStreamBuffer,
+									size_t xDataLengthBytes,
+									BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
+
 /**
  * stream_buffer.h
  *
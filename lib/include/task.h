@@ -145,8 +145,24 @@ typedef struct xTASK_STATUS
 	uint32_t ulRunTimeCounter;		/* The total run time allocated to the task so far, as defined by the run time stats clock.  See http://www.freertos.org/rtos-run-time-stats.html.  Only valid when configGENERATE_RUN_TIME_STATS is defined as 1 in FreeRTOSConfig.h. */
 	StackType_t *pxStackBase;		/* Points to the lowest address of the task's stack area. */
 	configSTACK_DEPTH_TYPE usStackHighWaterMark;	/* The minimum amount of stack space that has remained for the task since the task was created.  The closer this value is to zero the closer the task has come to overflowing its stack. */
+	uint32_t ulSwitchCount;			/* The number of times the task has been switched in.  Only valid when configUSE_TASK_PROFILING is defined as 1 in FreeRTOSConfig.h, as are the members that follow. */
+	uint32_t ulWakeCount;			/* The number of times the task was made ready and then switched in since the wake latencies were last reset by vTaskResetLatencyStats(). */
+	uint32_t ulMaxWakeLatency;		/* The longest time from the task being made ready until it was switched in since the wake latencies were last reset, in units of the run time stats clock. */
+	uint32_t ulAverageWakeLatency;	/* The mean time from the task being made ready until it was switched in since the wake latencies were last reset, in units of the run time stats clock. */
 } TaskStatus_t;
 
+/* Used with the uxTaskGetISRState() function to return the time spent in each
+interrupt handler that is profiled with ulTaskProfileISREnter() and
+vTaskProfileISRExit(). */
+typedef struct xISR_STATUS
+{
+	UBaseType_t uxISRNumber;		/* The number the handler passes to vTaskProfileISRExit(). */
+	const char *pcISRName;			/* The name set with vTaskSetISRName(), or NULL. */ /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	uint32_t ulCount;				/* The number of times the handler has run. */
+	uint32_t ulRunTimeCounter;		/* The total time spent in the handler so far, in units of the run time stats clock. */
+	uint32_t ulMaxRunTime;			/* The longest time a single run of the handler took since the latencies were last reset by vTaskResetLatencyStats(). */
+} ISRStatus_t;
+
 /* Possible return values for eTaskConfirmSleepModeStatus(). */
 typedef enum
 {
@@ -1766,6 +1782,111 @@ void vTaskGetRunTimeStats( char *pcWriteBuffer ) PRIVILEGED_FUNCTION; /*lint !e9
 */
 TickType_t xTaskGetIdleRunTimeCounter( void ) PRIVILEGED_FUNCTION;
 
+/**
+ * task. h
+ * <PRE>uint32_t ulTaskProfileISREnter( void );</PRE>
+ * <PRE>void vTaskProfileISRExit( UBaseType_t uxISRNumber, uint32_t ulEnterTime );</PRE>
+ *
+ * configUSE_TASK_PROFILING must be defined as 1 for these functions to be
+ * available.  configUSE_TASK_PROFILING requires configGENERATE_RUN_TIME_STATS
+ * and configUSE_TRACE_FACILITY to be defined as 1 too.
+ *
+ * With configUSE_TASK_PROFILING set to 1 the kernel counts the number of times
+ * each task is switched in, and measures the wake latency of each task, which
+ * is the time from the task being moved to the Ready state, for example when
+ * the event it was blocked on occurs, until it is switched in.
+ * uxTaskGetSystemState() returns both in the TaskStatus_t structure of each
+ * task, along with its run time and stack high water mark.  Only a few reads
+ * and writes of the TCB are added to each context switch and each time a task
+ * is made ready, so the profiles can be left enabled in production code.
+ *
+ * The kernel cannot see interrupt handlers, so a handler whose time is to be
+ * measured calls ulTaskProfileISREnter() when it starts and passes the value
+ * returned to vTaskProfileISRExit() when it ends.  uxISRNumber is chosen by
+ * the application, must be less than configMAX_PROFILED_ISRS, and must only be
+ * used by one handler, as the statistics of each number are updated without
+ * masking interrupts.  The time measured for a handler includes the time of
+ * any handlers that interrupt it, and is also included in the run time of the
+ * task that was interrupted.
+ *
+ * Example usage:
+   <pre>
+	void vUARTHandler( void )
+	{
+	uint32_t ulEnterTime = ulTaskProfileISREnter();
+
+		// Handle the interrupt here.
+
+		vTaskProfileISRExit( UART_ISR_NUMBER, ulEnterTime );
+	}
+   </pre>
+ * \defgroup vTaskProfileISRExit vTaskProfileISRExit
+ * \ingroup TaskUtils
+ */
+uint32_t ulTaskProfileISREnter( void ) PRIVILEGED_FUNCTION;
+void vTaskProfileISRExit( UBaseType_t uxISRNumber, uint32_t ulEnterTime ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * <PRE>void vTaskSetISRName( UBaseType_t uxISRNumber, const char *pcISRName );</PRE>
+ *
+ * configUSE_TASK_PROFILING must be defined as 1 for this function to be
+ * available.
+ *
+ * Sets the name uxTaskGetISRState() returns for the interrupt handler that
+ * profiles itself with uxISRNumber.  The name is not copied, so must remain
+ * valid.
+ *
+ * \defgroup vTaskSetISRName vTaskSetISRName
+ * \ingroup TaskUtils
+ */
+void vTaskSetISRName( UBaseType_t uxISRNumber, const char *pcISRName ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+
+/**
+ * task. h
+ * <PRE>UBaseType_t uxTaskGetISRState( ISRStatus_t * const pxISRStatusArray, const UBaseType_t uxArraySize );</PRE>
+ *
+ * configUSE_TASK_PROFILING must be defined as 1 for this function to be
+ * available.
+ *
+ * Populates an ISRStatus_t structure for each interrupt handler that has run
+ * or has been named with vTaskSetISRName().
+ *
+ * @param pxISRStatusArray A pointer to an array of ISRStatus_t structures.
+ * The array must hold at least one structure for each handler that might be
+ * reported, and never needs more than configMAX_PROFILED_ISRS.
+ *
+ * @param uxArraySize The size of the array pointed to by the pxISRStatusArray
+ * parameter.
+ *
+ * @return The number of ISRStatus_t structures that were populated.
+ *
+ * \defgroup uxTaskGetISRState uxTaskGetISRState
+ * \ingroup TaskUtils
+ */
+UBaseType_t uxTaskGetISRState( ISRStatus_t * const pxISRStatusArray, const UBaseType_t uxArraySize ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * <PRE>void vTaskResetLatencyStats( void );</PRE>
+ *
+ * configUSE_TASK_PROFILING must be defined as 1 for this function to be
+ * available.
+ *
+ * Starts a new measurement period for the wake latencies of all the tasks and
+ * the longest run of each interrupt handler, so those cover only the time since
+ * the call.  An application that reports the profiles periodically calls it
+ * after each report.  The switch counts and the run times are never reset, so
+ * the difference between two reports gives their values over the period.  The
+ * latencies of each task are only cleared when it next wakes, and are read as
+ * 0 until then, so the call takes the same short time however many tasks
+ * exist.
+ *
+ * \defgroup vTaskResetLatencyStats vTaskResetLatencyStats
+ * \ingroup TaskUtils
+ */
+void vTaskResetLatencyStats( void ) PRIVILEGED_FUNCTION;
+
 /**
  * task. h
  * <PRE>BaseType_t xTaskNotify( TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction );</PRE>
@@ -2405,6 +2526,14 @@ eSleepModeStatus eTaskConfirmSleepModeStatus( void ) PRIVILEGED_FUNCTION;
  */
 TaskHandle_t pvTaskIncrementMutexHeldCount( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * For internal use only.  Decrement the mutex held count of the running task
+ * when it gives a mutex no other task waits for, and return pdTRUE.  Returns
+ * pdFALSE, and leaves the count as it is, if giving the mutex must also
+ * disinherit the task's priority, which xTaskPriorityDisinherit() then does.
+ */
+BaseType_t xTaskDecrementMutexHeldCount( void ) PRIVILEGED_FUNCTION;
+
 /*
  * For internal use only.  Same as vTaskSetTimeOutState(), but without a critial
  * section.
@@ -58,7 +58,11 @@
  * post to the queue if the queue is empty, so there is no need to leave space for
  * that.
  */
-#define mqttCOMMAND_QUEUE_LENGTH    ( ( UBaseType_t ) ( mqttconfigMAX_BROKERS * mqttconfigMAX_PARALLEL_OPS ) )
+#define mqttCOMMAND_QUEUE_LENGTH    ( ( UBaseType_t ) ( mqttconfigMAX_BROKERS * ( mqttconfigMAX_PARALLEL_OPS + mqttconfigMAX_INFLIGHT_PUBLISHES ) ) )
+
+#if ( ( mqttconfigMAX_INFLIGHT_PUBLISHES < 1 ) || ( mqttconfigMAX_INFLIGHT_PUBLISHES > 256 ) )
+    #error "mqttconfigMAX_INFLIGHT_PUBLISHES must be between 1 and 256."
+#endif
 
 /**
  * @defgroup MessageIdentifer Macros related to message identifier.
@@ -75,7 +79,7 @@
  */
 /** @{ */
 #define mqttMESSAGE_IDENTIFIER_MIN     ( 0x00010000UL )
-#define mqttMESSAGE_IDENTIFIER_MAX     ( 0xFFFF0000UL )
+#define mqttMESSAGE_IDENTIFIER_MAX     ( 0x80000000UL )
 #define mqttMESSAGE_IDENTIFIER_MASK    ( 0xFFFF0000UL )
 
 /**
@@ -86,6 +90,37 @@
 #define mqttMESSAGE_IDENTIFIER_EXTRACT( x )    ( x >> 16 )
 /** @} */
 
+/**
+ * @defgroup AsyncPacketIdentifier Macros related to packet identifiers of asynchronous publishes.
+ *
+ * Message identifiers of blocking operations never exceed mqttMESSAGE_IDENTIFIER_MAX
+ * and so never set the top bit of the 16-bit packet identifier. Publishes issued with
+ * MQTT_AGENT_PublishAsync use that bit to mark their packet identifiers, and carry the
+ * index of their in-flight slot in the low 8 bits so that the slot can be found
+ * directly when the PUBACK or timeout arrives. Bits 8 to 14 hold a generation count
+ * which changes every time a slot is (re)used so that a late PUBACK for a previous
+ * transmission is not mistaken for the current one.
+ */
+/** @{ */
+#define mqttASYNC_PACKET_IDENTIFIER_FLAG                 ( ( uint16_t ) 0x8000U )
+#define mqttASYNC_PACKET_IDENTIFIER_GENERATION_MASK      ( ( uint16_t ) 0x007FU )
+#define mqttASYNC_PACKET_IDENTIFIER_GENERATION_SHIFT     ( 8U )
+#define mqttASYNC_PACKET_IDENTIFIER_SLOT_MASK            ( ( uint16_t ) 0x00FFU )
+
+/**
+ * @brief Builds the packet identifier for the given in-flight slot and generation.
+ */
+#define mqttASYNC_PACKET_IDENTIFIER( uxSlot, ucGeneration )                                                                  \
+    ( ( uint16_t ) ( mqttASYNC_PACKET_IDENTIFIER_FLAG |                                                                      \
+                     ( ( ( uint16_t ) ( ucGeneration ) & mqttASYNC_PACKET_IDENTIFIER_GENERATION_MASK ) << mqttASYNC_PACKET_IDENTIFIER_GENERATION_SHIFT ) | \
+                     ( ( uint16_t ) ( uxSlot ) & mqttASYNC_PACKET_IDENTIFIER_SLOT_MASK ) ) )
+
+/**
+ * @brief Extracts the in-flight slot index from an asynchronous publish packet identifier.
+ */
+#define mqttASYNC_PACKET_IDENTIFIER_SLOT( usPacketIdentifier )    ( ( UBaseType_t ) ( ( usPacketIdentifier ) & mqttASYNC_PACKET_IDENTIFIER_SLOT_MASK ) )
+/** @} */
+
 /**
  * @defgroup Notification Macros related to notification code and status.
  *
@@ -137,7 +172,8 @@ typedef enum
     eMQTTDisconnectRequest,  /**< Disconnect the connection to an MQTT broker. */
     eMQTTSubscribeRequest,   /**< Initiate a subscribe to a topic.  _TODO_ Currently limited to one topic per subscribe message. */
     eMQTTUnsubscribeRequest, /**< Initiate unsubscribe from a topic.  _TODO_ Currently limited to one topic per unsubscribe message. */
-    eMQTTPublishRequest      /**< Initiate a publish to a topic.  _TODO_ Currently limited to one topic per publish message. */
+    eMQTTPublishRequest,     /**< Initiate a publish to a topic.  _TODO_ Currently limited to one topic per publish message. */
+    eMQTTPublishAsyncRequest /**< Initiate a publish to a topic without blocking the requesting task until the PUBACK. */
 } MQTTAction_t;
 
 /**
@@ -186,11 +222,13 @@ typedef struct MQTTNotificationData
  */
 typedef struct MQTTEventData
 {
-    UBaseType_t uxBrokerNumber;               /**< The broker this command is for, indexed from 0. */
-    MQTTAction_t xEventType;                  /**< The operation to initiate. */
-    MQTTNotificationData_t xNotificationData; /**< Information used to notify the task that initiated the operation when the operation is complete. */
-    TimeOut_t xEventCreationTimestamp;        /**< Timestamp when this event was created. */
-    TickType_t xTicksToWait;                  /**< Time in tick counts after which the operation should fail. */
+    UBaseType_t uxBrokerNumber;                                   /**< The broker this command is for, indexed from 0. */
+    MQTTAction_t xEventType;                                      /**< The operation to initiate. */
+    MQTTNotificationData_t xNotificationData;                     /**< Information used to notify the task that initiated the operation when the operation is complete. */
+    TimeOut_t xEventCreationTimestamp;                            /**< Timestamp when this event was created. */
+    TickType_t xTicksToWait;                                      /**< Time in tick counts after which the operation should fail. */
+    MQTTAgentPublishCompleteCallback_t pxPublishCompleteCallback; /**< Completion callback. Only relevant for eMQTTPublishAsyncRequest. */
+    void * pvPublishCompleteContext;                              /**< Completion callback context. Only relevant for eMQTTPublishAsyncRequest. */
     /* Only one of the following is relevant based on the value of xEventType. */
     union
     {
@@ -201,6 +239,23 @@ typedef struct MQTTEventData
     } u;
 } MQTTEventData_t;
 
+/**
+ * @brief State of a publish issued with MQTT_AGENT_PublishAsync that has not
+ * completed yet.
+ *
+ * Only accessed from the MQTT task.
+ */
+typedef struct MQTTInflightPublish
+{
+    const MQTTAgentPublishParams_t * pxPublishParams;      /**< The user's publish parameters. NULL if the slot is free. */
+    MQTTAgentPublishCompleteCallback_t pxCompleteCallback; /**< Invoked when the publish completes. */
+    void * pvCompleteContext;                              /**< Passed as it is to pxCompleteCallback. */
+    TimeOut_t xTimeOut;                                    /**< Timestamp when the publish was requested. */
+    TickType_t xTicksToWait;                               /**< Time in ticks after which the publish should fail. */
+    uint16_t usPacketIdentifier;                           /**< Packet identifier of the last transmission. */
+    BaseType_t xAwaitingRetransmit;                        /**< pdTRUE if the connection was lost before the PUBACK was received. */
+} MQTTInflightPublish_t;
+
 /**
  * @brief Contains the state of a connection to MQTT broker.
  *
@@ -210,14 +265,29 @@ typedef struct MQTTEventData
  */
 typedef struct MQTTBrokerConnection
 {
-    Socket_t xSocket;                                                   /**< TCP socket connected to the broker. */
-    MQTTContext_t xMQTTContext;                                         /**< MQTT Core library context. */
-    MQTTNotificationData_t xWaitingTasks[ mqttconfigMAX_PARALLEL_OPS ]; /**< Notification data to notify tasks which have sent commands to MQTT command queue and are waiting for results. */
-    void * pvUserData;                                                  /**< User data to be supplied back in the callback as it is. */
-    MQTTAgentCallback_t pxCallback;                                     /**< The callback to notify user of various events including the Publish messages received from the broker. */
-    UBaseType_t uxFlags;                                                /**< Various properties of the connection - secured etc. */
-    BaseType_t xConnectionInUse;                                        /**< Tracks whether or not the connection is in use. It is accessed from application tasks (prvGetFreeConnection and prvReturnConnection) and hence should be accessed in critical section. */
-    uint8_t ucRxBuffer[ mqttconfigRX_BUFFER_SIZE ];                     /**< Buffers incoming messages. */
+    Socket_t xSocket;                                                             /**< TCP socket connected to the broker. */
+    MQTTContext_t xMQTTContext;                                                   /**< MQTT Core library context. */
+    MQTTNotificationData_t xWaitingTasks[ mqttconfigMAX_PARALLEL_OPS ];           /**< Notification data to notify tasks which have sent commands to MQTT command queue and are waiting for results. */
+    void * pvUserData;                                                            /**< User data to be supplied back in the callback as it is. */
+    MQTTAgentCallback_t pxCallback;                                               /**< The callback to notify user of various events including the Publish messages received from the broker. */
+    UBaseType_t uxFlags;                                                          /**< Various properties of the connection - secured etc. */
+    BaseType_t xConnectionInUse;                                                  /**< Tracks whether or not the connection is in use. It is accessed from application tasks (prvGetFreeConnection and prvReturnConnection) and hence should be accessed in critical section. */
+    uint8_t ucRxBuffer[ mqttconfigRX_BUFFER_SIZE ];                               /**< Buffers incoming messages. */
+    uint8_t ucTxBuffer[ mqttconfigTX_BATCH_BUFFER_SIZE ];                         /**< Batches outgoing messages so that they are written with one send call. */
+    uint32_t ulTxBufferedBytes;                                                   /**< Number of valid bytes in ucTxBuffer. */
+    uint32_t ulTxBufferedPackets;                                                 /**< Number of MQTT packets in ucTxBuffer. */
+    TickType_t xTxBatchStartTicks;                                                /**< Tick count when the first packet in ucTxBuffer was buffered. */
+    MQTTAgentTxStatistics_t xTxStatistics;                                        /**< Outbound write counters. Updated in critical section as they are read from application tasks. */
+    uint64_t xNextServiceTicks;                                                   /**< Tick count at which prvManageConnections must next service this connection. */
+    UBaseType_t uxServiceHeapIndex;                                               /**< Position of this connection in uxServiceHeap. */
+    BaseType_t xWakeupPending;                                                    /**< Set when an eMQTTServiceSocket event for this connection is in the command queue. */
+    MQTTInflightPublish_t xInflightPublishes[ mqttconfigMAX_INFLIGHT_PUBLISHES ]; /**< Publishes issued with MQTT_AGENT_PublishAsync which have not completed yet. */
+    uint8_t ucFreeInflightSlots[ mqttconfigMAX_INFLIGHT_PUBLISHES ];              /**< Stack of the indexes of the free entries in xInflightPublishes. */
+    UBaseType_t uxFreeInflightSlotCount;                                          /**< Number of valid entries in ucFreeInflightSlots. */
+    uint8_t ucInflightGeneration;                                                 /**< Generation count used to build asynchronous publish packet identifiers. */
+    BaseType_t xRetransmitPending;                                                /**< Set when the connection is re-established and in-flight publishes need to be re-sent. */
+    SemaphoreHandle_t xInflightWindow;                                            /**< Counts the free entries in the in-flight window. Taken by the application task, given by the MQTT task. */
+    StaticSemaphore_t xInflightWindowBuffer;                                      /**< Storage for xInflightWindow. */
 } MQTTBrokerConnection_t;
 /*-----------------------------------------------------------*/
 
@@ -252,6 +322,16 @@ static const uint16_t usUserNameLength = ( uint16_t ) ( sizeof( cUserName ) - 1U
  */
 static MQTTBrokerConnection_t xMQTTConnections[ mqttconfigMAX_BROKERS ];
 
+/**
+ * @brief Broker numbers of all the connections ordered by xNextServiceTicks,
+ * as a binary min-heap.
+ *
+ * prvManageConnections only services the connections whose time has come,
+ * instead of polling all of them on every iteration of the MQTT task. Only
+ * accessed from the MQTT task.
+ */
+static UBaseType_t uxServiceHeap[ mqttconfigMAX_BROKERS ];
+
 /**
  * @brief Handle of the command queue used to pass commands from application
  * tasks to the MQTT task.
@@ -274,6 +354,8 @@ static uint32_t ulQueueMessageIdentifier = 0;
  * @brief The callback registered with the core MQTT library to transmit bytes over wire.
  *
  * The MQTT core library calls this function whenever it needs to transmit any bytes.
+ * Packets are appended to the Tx buffer of the connection, which is flushed by
+ * prvManageConnections, and only packets too large for it are written directly.
  * @param[in] pvSendContext The send context is broker number in our case.
  *
  * @param[in] pucData The data to transmit.
@@ -286,6 +368,36 @@ static uint32_t prvMQTTSendCallback( void * pvSendContext,
                                      const uint8_t * const pucData,
                                      uint32_t ulDataLength );
 
+/**
+ * @brief Writes the given bytes to the socket of the given connection.
+ *
+ * Retries until all the bytes are written, mqttconfigTCP_SEND_TIMEOUT_MS elapses
+ * or an error other than SOCKETS_EWOULDBLOCK occurs.
+ *
+ * @param[in] pxConnection The connection to write to.
+ * @param[in] pucData The data to write.
+ * @param[in] ulDataLength Length of the data.
+ * @param[in] ulPackets Number of MQTT packets in the data, for the write counters.
+ *
+ * @return The number of actually written bytes.
+ */
+static uint32_t prvSendToSocket( MQTTBrokerConnection_t * const pxConnection,
+                                 const uint8_t * const pucData,
+                                 uint32_t ulDataLength,
+                                 uint32_t ulPackets );
+
+/**
+ * @brief Writes the packets batched in the Tx buffer of the given connection
+ * to its socket.
+ *
+ * The Tx buffer is empty when this function returns, even if the write failed.
+ *
+ * @param[in] pxConnection The connection whose Tx buffer to flush.
+ *
+ * @return pdPASS if all the buffered bytes were written, pdFAIL otherwise.
+ */
+static BaseType_t prvFlushTxBuffer( MQTTBrokerConnection_t * const pxConnection );
+
 /**
  * @brief The callback registered with the core MQTT library to receive various MQTT events.
  *
@@ -396,8 +508,9 @@ static void prvGracefulSocketClose( MQTTBrokerConnection_t * const pxConnection
 /**
  * @brief The callback registered with the socket to get notified of the available data to read on the socket.
  *
- * This function just posts a eMQTTServiceSocket request to the MQTT command queue to
- * unblock the MQTT task in order to ensure that the available data is read and processed.
+ * This function just posts a eMQTTServiceSocket request for the connection to the MQTT
+ * command queue to unblock the MQTT task in order to ensure that the available data is
+ * read and processed. At most one such request per connection is in the queue.
  *
  * @param[in] pxSocket The socket on which the data is available for reading.
  */
@@ -507,13 +620,40 @@ static void prvNotifyRequestingTask( MQTTNotificationData_t * const pxNotificati
                                      UBaseType_t uxStatus );
 
 /**
- * @brief Called on each iteration of the MQTT task to service connected sockets.
+ * @brief Sets the time at which the given connection must next be serviced and
+ * restores the order of uxServiceHeap.
+ *
+ * @param[in] uxBrokerNumber The connection to schedule.
+ * @param[in] xServiceTicks The tick count at which to service it, 0 to service it
+ * on the next invocation of prvManageConnections.
+ */
+static void prvScheduleConnection( UBaseType_t uxBrokerNumber,
+                                   uint64_t xServiceTicks );
+
+/**
+ * @brief Services one connection.
+ *
+ * Reads the available data and passes it to the MQTT Core library, invokes
+ * MQTT_Periodic for timeout and keep alive processing and flushes the batched
+ * outbound packets.
  *
- * For all the connected sockets, it reads the available data and passes it to the
- * MQTT Core library. It also invokes the MQTT_Periodic function of the core library
- * to ensure regular timeout and keep alive processing.
+ * @param[in] pxConnection The connection to service.
+ * @param[in] xTickCount The current tick count.
  *
- * @return Time in ticks when the next invocation of MQTT_Periodic is required.
+ * @return The tick count at which the connection must next be serviced.
+ */
+static uint64_t prvServiceConnection( MQTTBrokerConnection_t * const pxConnection,
+                                      uint64_t xTickCount );
+
+/**
+ * @brief Called on each iteration of the MQTT task to service the connections
+ * which need it.
+ *
+ * A connection needs servicing when a command for it has been processed, when
+ * its socket has been woken up, when data was read from it on the previous
+ * invocation, or when a packet timeout, keep alive or socket poll is due.
+ *
+ * @return Time in ticks until the next connection needs servicing.
  */
 static TickType_t prvManageConnections( void );
 
@@ -586,6 +726,89 @@ static void prvInitiateMQTTUnSubscribe( MQTTEventData_t * const pxEventData );
  */
 static void prvInitiateMQTTPublish( MQTTEventData_t * const pxEventData );
 
+/**
+ * @brief Initiates an asynchronous MQTT Publish operation.
+ *
+ * Pops a free slot from the in-flight window, stores the publish in it and
+ * transmits it. The requesting task is not notified; instead the completion
+ * callback is invoked when the PUBACK is received, the publish times out or
+ * fails. In case of QoS0 the publish completes as soon as it is sent.
+ *
+ * @param[in] pxEventData The event data as posted by application task to the command queue.
+ */
+static void prvInitiateMQTTPublishAsync( MQTTEventData_t * const pxEventData );
+
+/**
+ * @brief Assigns a new packet identifier to an in-flight publish and transmits it.
+ *
+ * @param[in] pxConnection The connection on which to publish.
+ * @param[in] pxInflightPublish The in-flight publish to transmit.
+ *
+ * @return pdPASS if the publish was sent, pdFAIL otherwise.
+ */
+static BaseType_t prvSendInflightPublish( MQTTBrokerConnection_t * const pxConnection,
+                                          MQTTInflightPublish_t * const pxInflightPublish );
+
+/**
+ * @brief Finds the in-flight publish matching the given packet identifier.
+ *
+ * The slot index is encoded in the packet identifier, so no search is needed.
+ *
+ * @param[in] pxConnection The connection on which the ACK or timeout was received.
+ * @param[in] usPacketIdentifier The packet identifier of an asynchronous publish.
+ *
+ * @return The matching in-flight publish or NULL if there is none.
+ */
+static MQTTInflightPublish_t * prvRetrieveInflightPublish( MQTTBrokerConnection_t * const pxConnection,
+                                                           uint16_t usPacketIdentifier );
+
+/**
+ * @brief Returns an in-flight publish slot to the window and invokes the
+ * completion callback.
+ *
+ * @param[in] pxConnection The connection the publish belongs to.
+ * @param[in] pxInflightPublish The in-flight publish which completed.
+ * @param[in] xResult The result reported in the completion callback.
+ */
+static void prvCompleteInflightPublish( MQTTBrokerConnection_t * const pxConnection,
+                                        MQTTInflightPublish_t * const pxInflightPublish,
+                                        MQTTAgentReturnCode_t xResult );
+
+/**
+ * @brief Invokes the completion callback of an asynchronous publish and gives
+ * back its token to the in-flight window.
+ *
+ * @param[in] pxConnection The connection the publish belongs to.
+ * @param[in] pxCompleteCallback The completion callback. Can be NULL.
+ * @param[in] pvCompleteContext The completion callback context.
+ * @param[in] pxPublishParams The user's publish parameters.
+ * @param[in] xResult The result reported in the completion callback.
+ */
+static void prvInvokePublishCompleteCallback( MQTTBrokerConnection_t * const pxConnection,
+                                              MQTTAgentPublishCompleteCallback_t pxCompleteCallback,
+                                              void * pvCompleteContext,
+                                              const MQTTAgentPublishParams_t * const pxPublishParams,
+                                              MQTTAgentReturnCode_t xResult );
+
+/**
+ * @brief Re-sends the in-flight publishes which were interrupted by a lost connection.
+ *
+ * Called once the connection is re-established. Publishes whose timeout expired
+ * in the meantime are completed with eMQTTAgentTimeout instead.
+ *
+ * @param[in] pxConnection The re-established connection.
+ */
+static void prvRetransmitInflightPublishes( MQTTBrokerConnection_t * const pxConnection );
+
+/**
+ * @brief Completes all the in-flight publishes of a connection with the given result.
+ *
+ * @param[in] pxConnection The connection whose in-flight publishes are to be completed.
+ * @param[in] xResult The result reported in the completion callbacks.
+ */
+static void prvFailInflightPublishes( MQTTBrokerConnection_t * const pxConnection,
+                                      MQTTAgentReturnCode_t xResult );
+
 /*
  * @brief Posts the event to the command queue and waits for the notification from the MQTT task.
  *
@@ -619,26 +842,19 @@ static MQTTAgentReturnCode_t prvSendCommandToMQTTTask( MQTTEventData_t * pxEvent
 static void prvMQTTTask( void * pvParameters );
 /*-----------------------------------------------------------*/
 
-static uint32_t prvMQTTSendCallback( void * pvSendContext,
-                                     const uint8_t * const pucData,
-                                     uint32_t ulDataLength )
+static uint32_t prvSendToSocket( MQTTBrokerConnection_t * const pxConnection,
+                                 const uint8_t * const pucData,
+                                 uint32_t ulDataLength,
+                                 uint32_t ulPackets )
 {
-    MQTTBrokerConnection_t * pxConnection;
-    UBaseType_t uxBrokerNumber = ( UBaseType_t ) pvSendContext; /*lint !e923 The cast is ok as we passed the index of the client before. */
     int32_t lSendRetVal;
     uint32_t ulBytesSent = 0;
     TimeOut_t xTimestamp;
     TickType_t xTicksToWait = pdMS_TO_TICKS( mqttconfigTCP_SEND_TIMEOUT_MS );
 
-    /* Broker number must be valid. */
-    configASSERT( uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS );
-
     /* Record the timestamp when this function was called. */
     vTaskSetTimeOutState( &( xTimestamp ) );
 
-    /* Get the actual connection to the broker. */
-    pxConnection = &( xMQTTConnections[ uxBrokerNumber ] );
-
     /* Keep re-trying until timeout or any error
      * other than SOCKETS_EWOULDBLOCK occurs. */
     while( ulBytesSent < ulDataLength )
@@ -674,6 +890,89 @@ static uint32_t prvMQTTSendCallback( void * pvSendContext,
         }
     }
 
+    /* Update the write counters. */
+    taskENTER_CRITICAL();
+    pxConnection->xTxStatistics.ulFlushes++;
+    pxConnection->xTxStatistics.ulPackets += ulPackets;
+    pxConnection->xTxStatistics.ulBytes += ulBytesSent;
+    taskEXIT_CRITICAL();
+
+    return ulBytesSent;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvFlushTxBuffer( MQTTBrokerConnection_t * const pxConnection )
+{
+    BaseType_t xStatus = pdPASS;
+
+    if( pxConnection->ulTxBufferedBytes > 0U )
+    {
+        if( prvSendToSocket( pxConnection,
+                             pxConnection->ucTxBuffer,
+                             pxConnection->ulTxBufferedBytes,
+                             pxConnection->ulTxBufferedPackets ) != pxConnection->ulTxBufferedBytes )
+        {
+            mqttconfigDEBUG_LOG( ( "Failed to flush %u batched bytes.\r\n", pxConnection->ulTxBufferedBytes ) );
+            xStatus = pdFAIL;
+        }
+
+        /* Whatever was not written cannot be written later either
+         * because the packets would then be corrupted. */
+        pxConnection->ulTxBufferedBytes = 0;
+        pxConnection->ulTxBufferedPackets = 0;
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvMQTTSendCallback( void * pvSendContext,
+                                     const uint8_t * const pucData,
+                                     uint32_t ulDataLength )
+{
+    MQTTBrokerConnection_t * pxConnection;
+    UBaseType_t uxBrokerNumber = ( UBaseType_t ) pvSendContext; /*lint !e923 The cast is ok as we passed the index of the client before. */
+    uint32_t ulBytesSent = 0;
+    BaseType_t xStatus = pdPASS;
+
+    /* Broker number must be valid. */
+    configASSERT( uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS );
+
+    /* Get the actual connection to the broker. */
+    pxConnection = &( xMQTTConnections[ uxBrokerNumber ] );
+
+    /* Preserve the order of the packets - if this one does not fit in
+     * the space left, write the buffered ones first. */
+    if( ( pxConnection->ulTxBufferedBytes + ulDataLength ) > ( uint32_t ) mqttconfigTX_BATCH_BUFFER_SIZE )
+    {
+        xStatus = prvFlushTxBuffer( pxConnection );
+    }
+
+    if( xStatus == pdPASS )
+    {
+        if( ulDataLength <= ( uint32_t ) mqttconfigTX_BATCH_BUFFER_SIZE )
+        {
+            /* Start the flush deadline with the first buffered packet. */
+            if( pxConnection->ulTxBufferedBytes == 0U )
+            {
+                pxConnection->xTxBatchStartTicks = xTaskGetTickCount();
+            }
+
+            memcpy( &( pxConnection->ucTxBuffer[ pxConnection->ulTxBufferedBytes ] ), pucData, ( size_t ) ulDataLength );
+            pxConnection->ulTxBufferedBytes += ulDataLength;
+            pxConnection->ulTxBufferedPackets++;
+
+            /* The packet is considered sent - a failure to write it later
+             * is handled by prvManageConnections. */
+            ulBytesSent = ulDataLength;
+        }
+        else
+        {
+            /* Too large to batch, write it directly. */
+            ulBytesSent = prvSendToSocket( pxConnection, pucData, ulDataLength, 1U );
+        }
+    }
+
     return ulBytesSent;
 }
 /*-----------------------------------------------------------*/
@@ -772,6 +1071,7 @@ static BaseType_t prvGetFreeConnection( void )
         {
             /* ...mark the connection "in use" and stop. */
             xMQTTConnections[ x ].xConnectionInUse = pdTRUE;
+            memset( &( xMQTTConnections[ x ].xTxStatistics ), 0x00, sizeof( MQTTAgentTxStatistics_t ) );
             break;
         }
     }
@@ -1012,6 +1312,10 @@ static void prvGracefulSocketClose( MQTTBrokerConnection_t * const pxConnection
 
     mqttconfigDEBUG_LOG( ( "About to close socket.\r\n" ) );
 
+    /* Write any batched packets, such as DISCONNECT, before the shutdown.
+     * The connection is being closed anyway, so a failure is ignored. */
+    ( void ) prvFlushTxBuffer( pxConnection );
+
     /* Initialize xTimeOut.  This records the time at which this function was
      * entered. */
     vTaskSetTimeOutState( &xTimeOut );
@@ -1051,27 +1355,54 @@ static void prvMQTTClientSocketWakeupCallback( Socket_t pxSocket )
 {
     const TickType_t xTicksToWait = pdMS_TO_TICKS( 20 );
     MQTTEventData_t xEventData;
-
-    /* Just to avoid compiler warnings.  The socket is not used but the function
-     * prototype cannot be changed because this is a callback function. */
-    ( void ) pxSocket;
+    UBaseType_t uxBrokerNumber;
+    BaseType_t xPostEvent = pdFALSE;
 
     /* Should not be possible to get here without the task having been
      * created! */
     configASSERT( xMQTTTaskHandle );
 
-    /* A socket used by the MQTT task may need attention.  Send an event
-     * to the MQTT task to make sure the task is not blocked on xCommandQueue.
-     * There is only any need to do this if there are no messages already in the
-     * queue, as if there are, the task won't block anyway. */
-    if( uxQueueMessagesWaiting( xCommandQueue ) == ( UBaseType_t ) 0 )
+    /* Find the connection the socket belongs to. */
+    for( uxBrokerNumber = 0; uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS; uxBrokerNumber++ )
     {
-        /* The eMQTTServiceSocket event is not handled directly, it is only used
-         * to unblock the MQTT task, so only the xEventType needs to be set. */
-        memset( &xEventData, 0x00, sizeof( MQTTEventData_t ) );
-        xEventData.xEventType = eMQTTServiceSocket;
-        mqttconfigDEBUG_LOG( ( "Socket sending wakeup to MQTT task.\r\n" ) );
-        ( void ) xQueueSendToBack( xCommandQueue, &xEventData, xTicksToWait );
+        if( xMQTTConnections[ uxBrokerNumber ].xSocket == pxSocket )
+        {
+            break;
+        }
+    }
+
+    if( uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS )
+    {
+        /* A socket used by the MQTT task may need attention.  Send an event
+         * to the MQTT task so that it services the connection. There is only
+         * any need to do this if there is no such event already in the queue
+         * for this connection. */
+        taskENTER_CRITICAL();
+
+        if( xMQTTConnections[ uxBrokerNumber ].xWakeupPending == pdFALSE )
+        {
+            xMQTTConnections[ uxBrokerNumber ].xWakeupPending = pdTRUE;
+            xPostEvent = pdTRUE;
+        }
+
+        taskEXIT_CRITICAL();
+
+        if( xPostEvent == pdTRUE )
+        {
+            /* The eMQTTServiceSocket event is only used to schedule the
+             * connection, so only the xEventType and uxBrokerNumber need
+             * to be set. */
+            memset( &xEventData, 0x00, sizeof( MQTTEventData_t ) );
+            xEventData.xEventType = eMQTTServiceSocket;
+            xEventData.uxBrokerNumber = uxBrokerNumber;
+            mqttconfigDEBUG_LOG( ( "Socket sending wakeup to MQTT task.\r\n" ) );
+
+            if( xQueueSendToBack( xCommandQueue, &xEventData, xTicksToWait ) != pdPASS )
+            {
+                /* The data will be read when the connection is next serviced. */
+                xMQTTConnections[ uxBrokerNumber ].xWakeupPending = pdFALSE;
+            }
+        }
     }
 }
 /*-----------------------------------------------------------*/
@@ -1091,6 +1422,11 @@ static void prvProcessReceivedCONNACK( MQTTBrokerConnection_t * const pxConnecti
         {
             mqttconfigDEBUG_LOG( ( "MQTT Connect was accepted. Connection established.\r\n" ) );
             prvNotifyRequestingTask( pxNotificationData, eMQTTCONNACKConnectionAccepted, pdPASS );
+
+            /* Re-send the asynchronous publishes interrupted by a previous
+             * disconnect. This is deferred to prvManageConnections as the
+             * core library is still processing the CONNACK. */
+            pxConnection->xRetransmitPending = pdTRUE;
         }
         else
         {
@@ -1155,16 +1491,30 @@ static void prvProcessReceivedPUBACK( MQTTBrokerConnection_t * const pxConnectio
                                       const MQTTEventCallbackParams_t * const pxParams )
 {
     MQTTNotificationData_t * pxNotificationData;
+    MQTTInflightPublish_t * pxInflightPublish;
 
-    /* Retrieve the notification data for the task which initiated the Publish operation.*/
-    pxNotificationData = prvRetrieveNotificationData( pxConnection, pxParams->u.xMQTTPubACKData.usPacketIdentifier );
+    if( ( pxParams->u.xMQTTPubACKData.usPacketIdentifier & mqttASYNC_PACKET_IDENTIFIER_FLAG ) != ( uint16_t ) 0 )
+    {
+        /* The PUBACK is for a publish issued with MQTT_AGENT_PublishAsync. */
+        pxInflightPublish = prvRetrieveInflightPublish( pxConnection, pxParams->u.xMQTTPubACKData.usPacketIdentifier );
 
-    /* If there is no task waiting for it, ignore it. */
-    if( pxNotificationData != NULL )
+        if( pxInflightPublish != NULL )
+        {
+            prvCompleteInflightPublish( pxConnection, pxInflightPublish, eMQTTAgentSuccess );
+        }
+    }
+    else
     {
-        /* Otherwise inform the task. */
-        mqttconfigDEBUG_LOG( ( "MQTT Publish was successful.\r\n" ) );
-        prvNotifyRequestingTask( pxNotificationData, eMQTTPUBACKReceived, pdPASS );
+        /* Retrieve the notification data for the task which initiated the Publish operation.*/
+        pxNotificationData = prvRetrieveNotificationData( pxConnection, pxParams->u.xMQTTPubACKData.usPacketIdentifier );
+
+        /* If there is no task waiting for it, ignore it. */
+        if( pxNotificationData != NULL )
+        {
+            /* Otherwise inform the task. */
+            mqttconfigDEBUG_LOG( ( "MQTT Publish was successful.\r\n" ) );
+            prvNotifyRequestingTask( pxNotificationData, eMQTTPUBACKReceived, pdPASS );
+        }
     }
 }
 /*-----------------------------------------------------------*/
@@ -1196,16 +1546,31 @@ static void prvProcessReceivedTimeout( MQTTBrokerConnection_t * const pxConnecti
                                        const MQTTEventCallbackParams_t * const pxParams )
 {
     MQTTNotificationData_t * pxNotificationData;
+    MQTTInflightPublish_t * pxInflightPublish;
 
-    /* Try to see if there is a task waiting for the operation which just timed out. */
-    pxNotificationData = prvRetrieveNotificationData( pxConnection, pxParams->u.xTimeoutData.usPacketIdentifier );
+    if( ( pxParams->u.xTimeoutData.usPacketIdentifier & mqttASYNC_PACKET_IDENTIFIER_FLAG ) != ( uint16_t ) 0 )
+    {
+        /* An asynchronous publish did not get its PUBACK in time. */
+        pxInflightPublish = prvRetrieveInflightPublish( pxConnection, pxParams->u.xTimeoutData.usPacketIdentifier );
 
-    /* If there is no task waiting, just ignore. Otherwise
-     * inform the task about the timeout. */
-    if( pxNotificationData != NULL )
+        if( pxInflightPublish != NULL )
+        {
+            mqttconfigDEBUG_LOG( ( "MQTT asynchronous publish timed out.\r\n" ) );
+            prvCompleteInflightPublish( pxConnection, pxInflightPublish, eMQTTAgentTimeout );
+        }
+    }
+    else
     {
-        mqttconfigDEBUG_LOG( ( "MQTT Timeout.\r\n" ) );
-        prvNotifyRequestingTask( pxNotificationData, eMQTTOperationTimedOut, pdFAIL );
+        /* Try to see if there is a task waiting for the operation which just timed out. */
+        pxNotificationData = prvRetrieveNotificationData( pxConnection, pxParams->u.xTimeoutData.usPacketIdentifier );
+
+        /* If there is no task waiting, just ignore. Otherwise
+         * inform the task about the timeout. */
+        if( pxNotificationData != NULL )
+        {
+            mqttconfigDEBUG_LOG( ( "MQTT Timeout.\r\n" ) );
+            prvNotifyRequestingTask( pxNotificationData, eMQTTOperationTimedOut, pdFAIL );
+        }
     }
 }
 /*-----------------------------------------------------------*/
@@ -1250,6 +1615,21 @@ static void prvProcessReceivedDisconnect( MQTTBrokerConnection_t * const pxConne
                                      pdFAIL );
         }
     }
+
+    /* The core library has dropped the Tx buffers of the asynchronous
+     * publishes still waiting for PUBACK. Keep them in the window so that
+     * they are re-sent once the connection is re-established. Publishes
+     * are failed instead if the user requested the disconnect (see
+     * prvInitiateMQTTDisconnect). */
+    for( x = 0; x < ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES; x++ )
+    {
+        if( pxConnection->xInflightPublishes[ x ].pxPublishParams != NULL )
+        {
+            pxConnection->xInflightPublishes[ x ].xAwaitingRetransmit = pdTRUE;
+        }
+    }
+
+    pxConnection->xRetransmitPending = pdFALSE;
 }
 /*-----------------------------------------------------------*/
 
@@ -1277,91 +1657,211 @@ static void prvNotifyRequestingTask( MQTTNotificationData_t * const pxNotificati
 }
 /*-----------------------------------------------------------*/
 
-static TickType_t prvManageConnections( void )
+static void prvScheduleConnection( UBaseType_t uxBrokerNumber,
+                                   uint64_t xServiceTicks )
 {
-    UBaseType_t uxBrokerNumber;
-    MQTTBrokerConnection_t * pxConnection;
-    BaseType_t xAnyConnectedClient = pdFALSE;
-    int32_t lBytesReceived;
-    TickType_t xNextMQTTPeriodicInvokeTicks, xNextTimeoutTicks = portMAX_DELAY;
-    uint64_t xTickCount = 0;
+    configASSERT( uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS );
 
-    /* For each broker the MQTT task might be connected to. */
-    for( uxBrokerNumber = 0; uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS; uxBrokerNumber++ )
-    {
-        pxConnection = &( xMQTTConnections[ uxBrokerNumber ] );
+    xMQTTConnections[ uxBrokerNumber ].xNextServiceTicks = xServiceTicks;
 
-        /* Process only the connected clients. */
-        if( pxConnection->xSocket != SOCKETS_INVALID_SOCKET )
+    #if ( mqttconfigMAX_BROKERS > 1 )
         {
-            /* Read data from the socket. */
-            lBytesReceived = SOCKETS_Recv( pxConnection->xSocket, pxConnection->ucRxBuffer, mqttconfigRX_BUFFER_SIZE, 0 );
+            UBaseType_t uxIndex, uxParent, uxChild;
 
-            /* If data was read, pass it to the MQTT Core library. */
-            if( lBytesReceived > 0 )
+            uxIndex = xMQTTConnections[ uxBrokerNumber ].uxServiceHeapIndex;
+
+            /* Move the connection up while it is due before its parent... */
+            while( uxIndex > ( UBaseType_t ) 0 )
             {
-                ( void ) MQTT_ParseReceivedData( &( pxConnection->xMQTTContext ), pxConnection->ucRxBuffer, ( size_t ) lBytesReceived );
-
-                /* Some data was received on this socket and we do not
-                 * know if there is more data available. Therefore we
-                 * set xNextTimeoutTicks to zero which ensures that we
-                 * do not block on the command queue and try to read
-                 * again from this socket on the next invocation of
-                 * prvManageConnections. This way we ensure that we keep
-                 * processing commands received on the command queue
-                 * between calls to SOCKETS_Recv. As a result, a socket
-                 * receiving lots of data continuously does not starve
-                 * the command processing. */
-                xNextTimeoutTicks = 0;
+                uxParent = ( uxIndex - ( UBaseType_t ) 1 ) / ( UBaseType_t ) 2;
+
+                if( xMQTTConnections[ uxServiceHeap[ uxParent ] ].xNextServiceTicks <= xServiceTicks )
+                {
+                    break;
+                }
+
+                uxServiceHeap[ uxIndex ] = uxServiceHeap[ uxParent ];
+                xMQTTConnections[ uxServiceHeap[ uxIndex ] ].uxServiceHeapIndex = uxIndex;
+                uxIndex = uxParent;
             }
-            else if( lBytesReceived < 0 )
+
+            /* ...or down while a child is due before it. */
+            for( ; ; )
             {
-                /* A negative return value from SOCKETS_Recv indicates error.
-                 * Since the socket is marked non-blocking, read can potentially
-                 * return SOCKETS_EWOULDBLOCK in which case we will re-try to
-                 * read on the next execution of this function. In case of any
-                 * other error, we disconnect. */
-                if( lBytesReceived != SOCKETS_EWOULDBLOCK )
+                uxChild = ( uxIndex * ( UBaseType_t ) 2 ) + ( UBaseType_t ) 1;
+
+                if( uxChild >= ( UBaseType_t ) mqttconfigMAX_BROKERS )
                 {
-                    /* Disconnect from the broker. Note that the socket close
-                     * and cleanup will happen in the disconnect callback
-                     * ( prvProcessReceivedDisconnect function ) from the core
-                     * MQTT library. */
-                    ( void ) MQTT_Disconnect( &( pxConnection->xMQTTContext ) );
+                    break;
                 }
+
+                if( ( ( uxChild + ( UBaseType_t ) 1 ) < ( UBaseType_t ) mqttconfigMAX_BROKERS ) &&
+                    ( xMQTTConnections[ uxServiceHeap[ uxChild + ( UBaseType_t ) 1 ] ].xNextServiceTicks < xMQTTConnections[ uxServiceHeap[ uxChild ] ].xNextServiceTicks ) )
+                {
+                    uxChild++;
+                }
+
+                if( xServiceTicks <= xMQTTConnections[ uxServiceHeap[ uxChild ] ].xNextServiceTicks )
+                {
+                    break;
+                }
+
+                uxServiceHeap[ uxIndex ] = uxServiceHeap[ uxChild ];
+                xMQTTConnections[ uxServiceHeap[ uxIndex ] ].uxServiceHeapIndex = uxIndex;
+                uxIndex = uxChild;
             }
-            else
+
+            uxServiceHeap[ uxIndex ] = uxBrokerNumber;
+            xMQTTConnections[ uxBrokerNumber ].uxServiceHeapIndex = uxIndex;
+        }
+    #else /* if ( mqttconfigMAX_BROKERS > 1 ) */
+        {
+            /* A heap of one connection is always in order.  Sifting it anyway
+             * makes some compilers warn about indexing past the end of
+             * uxServiceHeap, as they cannot tell that uxServiceHeapIndex is
+             * always 0. */
+            configASSERT( uxServiceHeap[ 0 ] == uxBrokerNumber );
+        }
+    #endif /* if ( mqttconfigMAX_BROKERS > 1 ) */
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvServiceConnection( MQTTBrokerConnection_t * const pxConnection,
+                                      uint64_t xTickCount )
+{
+    int32_t lBytesReceived;
+    uint64_t xNextServiceTicks;
+
+    /* Process only the connected clients. */
+    if( pxConnection->xSocket != SOCKETS_INVALID_SOCKET )
+    {
+        /* Read data from the socket. */
+        lBytesReceived = SOCKETS_Recv( pxConnection->xSocket, pxConnection->ucRxBuffer, mqttconfigRX_BUFFER_SIZE, 0 );
+
+        /* If data was read, pass it to the MQTT Core library. */
+        if( lBytesReceived > 0 )
+        {
+            ( void ) MQTT_ParseReceivedData( &( pxConnection->xMQTTContext ), pxConnection->ucRxBuffer, ( size_t ) lBytesReceived );
+
+            /* Re-send the asynchronous publishes if the received data
+             * completed a re-connection. */
+            if( pxConnection->xRetransmitPending == pdTRUE )
             {
-                /* If no data was received on this socket, we continue
-                 * to call MQTT_Periodic and calculate xNextTimeoutTicks
-                 * accordingly. */
+                pxConnection->xRetransmitPending = pdFALSE;
+                prvRetransmitInflightPublishes( pxConnection );
             }
         }
+        else if( lBytesReceived < 0 )
+        {
+            /* A negative return value from SOCKETS_Recv indicates error.
+             * Since the socket is marked non-blocking, read can potentially
+             * return SOCKETS_EWOULDBLOCK in which case we will re-try to
+             * read on the next service of this connection. In case of any
+             * other error, we disconnect. */
+            if( lBytesReceived != SOCKETS_EWOULDBLOCK )
+            {
+                /* Disconnect from the broker. Note that the socket close
+                 * and cleanup will happen in the disconnect callback
+                 * ( prvProcessReceivedDisconnect function ) from the core
+                 * MQTT library. */
+                ( void ) MQTT_Disconnect( &( pxConnection->xMQTTContext ) );
+            }
+        }
+        else
+        {
+            /* No data was received on this socket. */
+        }
+    }
+    else
+    {
+        lBytesReceived = 0;
+    }
 
-        /* Is the client connected? */
-        if( ( xAnyConnectedClient == pdFALSE ) && ( pxConnection->xSocket != SOCKETS_INVALID_SOCKET ) )
+    /* Invoke MQTT_Periodic, which returns when it must be invoked next. */
+    xNextServiceTicks = xTickCount + ( uint64_t ) MQTT_Periodic( &( pxConnection->xMQTTContext ), xTickCount );
+
+    /* Write the batched packets once there are no more commands which
+     * could add to them, or once the oldest has waited long enough. */
+    if( ( pxConnection->ulTxBufferedBytes > 0U ) &&
+        ( ( uxQueueMessagesWaiting( xCommandQueue ) == ( UBaseType_t ) 0 ) ||
+          ( ( xTaskGetTickCount() - pxConnection->xTxBatchStartTicks ) >= ( TickType_t ) mqttconfigTX_FLUSH_DEADLINE_TICKS ) ) )
+    {
+        if( prvFlushTxBuffer( pxConnection ) == pdFAIL )
         {
-            xAnyConnectedClient = pdTRUE;
+            /* The packets the core library considers sent are lost,
+             * disconnect as in the case of a receive error. */
+            ( void ) MQTT_Disconnect( &( pxConnection->xMQTTContext ) );
         }
+    }
 
-        /* Get the current tick count. */
-        prvMQTTGetTicks( &xTickCount );
+    if( ( lBytesReceived > 0 ) || ( pxConnection->ulTxBufferedBytes > 0U ) )
+    {
+        /* Some data was received on this socket and we do not know if
+         * there is more data available, or batched packets are waiting
+         * for the command queue to drain. Service the connection again
+         * on the next invocation of prvManageConnections. The MQTT task
+         * does not block in between, but processes the commands received
+         * on the command queue. As a result, a socket receiving lots of
+         * data continuously does not starve the command processing. */
+        xNextServiceTicks = 0;
+    }
+    else if( pxConnection->xSocket != SOCKETS_INVALID_SOCKET )
+    {
+        /* The socket must be polled at least every
+         * mqttconfigMQTT_TASK_MAX_BLOCK_TICKS on platforms which
+         * cannot wake up the MQTT task when data is received. */
+        xNextServiceTicks = configMIN( xNextServiceTicks, xTickCount + ( uint64_t ) mqttconfigMQTT_TASK_MAX_BLOCK_TICKS );
+    }
+    else
+    {
+        /* Only packet timeouts of a connection being set up, if any. */
+    }
+
+    return xNextServiceTicks;
+}
+/*-----------------------------------------------------------*/
+
+static TickType_t prvManageConnections( void )
+{
+    UBaseType_t uxDueBrokers[ mqttconfigMAX_BROKERS ] = { 0 };
+    UBaseType_t x, uxDueCount = 0;
+    TickType_t xNextTimeoutTicks;
+    uint64_t xTickCount = 0;
 
-        /* Invoke MQTT_Periodic. */
-        xNextMQTTPeriodicInvokeTicks = ( TickType_t ) MQTT_Periodic( &( pxConnection->xMQTTContext ), xTickCount );
+    /* Get the current tick count. */
+    prvMQTTGetTicks( &xTickCount );
 
-        /* Update the next timeout value. */
-        xNextTimeoutTicks = configMIN( xNextTimeoutTicks, xNextMQTTPeriodicInvokeTicks );
+    /* Take the connections which are due out of the way first so that
+     * each is serviced at most once, even if it is due again straight
+     * away. */
+    while( ( uxDueCount < ( UBaseType_t ) mqttconfigMAX_BROKERS ) &&
+           ( xMQTTConnections[ uxServiceHeap[ 0 ] ].xNextServiceTicks <= xTickCount ) )
+    {
+        uxDueBrokers[ uxDueCount ] = uxServiceHeap[ 0 ];
+        prvScheduleConnection( uxServiceHeap[ 0 ], UINT64_MAX );
+        uxDueCount++;
     }
 
-    /* The MQTT task must not block for more than mqttconfigMQTT_TASK_MAX_BLOCK_TICKS
-     * ticks if any client is connected. */
-    if( xAnyConnectedClient == pdTRUE )
+    for( x = 0; x < uxDueCount; x++ )
     {
-        xNextTimeoutTicks = configMIN( xNextTimeoutTicks, ( TickType_t ) mqttconfigMQTT_TASK_MAX_BLOCK_TICKS );
+        prvScheduleConnection( uxDueBrokers[ x ],
+                               prvServiceConnection( &( xMQTTConnections[ uxDueBrokers[ x ] ] ), xTickCount ) );
     }
 
     /* The return value indicates when the MQTT task should wake up next. */
+    if( xMQTTConnections[ uxServiceHeap[ 0 ] ].xNextServiceTicks <= xTickCount )
+    {
+        xNextTimeoutTicks = 0;
+    }
+    else if( ( xMQTTConnections[ uxServiceHeap[ 0 ] ].xNextServiceTicks - xTickCount ) < ( uint64_t ) portMAX_DELAY )
+    {
+        xNextTimeoutTicks = ( TickType_t ) ( xMQTTConnections[ uxServiceHeap[ 0 ] ].xNextServiceTicks - xTickCount );
+    }
+    else
+    {
+        xNextTimeoutTicks = portMAX_DELAY;
+    }
+
     return xNextTimeoutTicks;
 }
 /*-----------------------------------------------------------*/
@@ -1414,6 +1914,7 @@ static void prvInitiateMQTTConnect( MQTTEventData_t * const pxEventData )
             xConnectParams.usKeepAliveIntervalSeconds = mqttconfigKEEP_ALIVE_INTERVAL_SECONDS;
             xConnectParams.ulKeepAliveActualIntervalTicks = mqttconfigKEEP_ALIVE_ACTUAL_INTERVAL_TICKS;
             xConnectParams.ulPingRequestTimeoutTicks = mqttconfigKEEP_ALIVE_TIMEOUT_TICKS;
+            xConnectParams.ulKeepAliveMaxIdleTicks = mqttconfigKEEP_ALIVE_MAX_IDLE_TICKS;
             xConnectParams.usPacketIdentifier = ( uint16_t ) ( mqttMESSAGE_IDENTIFIER_EXTRACT( pxEventData->xNotificationData.ulMessageIdentifier ) );
             xConnectParams.ulTimeoutTicks = pxEventData->xTicksToWait;
 
@@ -1460,6 +1961,11 @@ static void prvInitiateMQTTDisconnect( MQTTEventData_t * const pxEventData )
      * the socket is closed when we receive disconnect event from
      * the MQTT core library in the registered callback (see
      * prvProcessReceivedDisconnect). */
+
+    /* The user is ending the session, so the asynchronous publishes
+     * still in-flight will never be acknowledged. */
+    prvFailInflightPublishes( pxConnection, eMQTTAgentFailure );
+
     if( MQTT_Disconnect( &( pxConnection->xMQTTContext ) ) == eMQTTSuccess )
     {
         prvNotifyRequestingTask( &( pxEventData->xNotificationData ), eMQTTDISCONNSent, pdPASS );
@@ -1642,6 +2148,183 @@ static void prvInitiateMQTTPublish( MQTTEventData_t * const pxEventData )
 }
 /*-----------------------------------------------------------*/
 
+static void prvInitiateMQTTPublishAsync( MQTTEventData_t * const pxEventData )
+{
+    MQTTInflightPublish_t * pxInflightPublish;
+    MQTTBrokerConnection_t * pxConnection = &( xMQTTConnections[ pxEventData->uxBrokerNumber ] );
+
+    /* The requesting task took a token from the in-flight window before
+     * posting this event, so there must be a free slot. */
+    configASSERT( pxConnection->uxFreeInflightSlotCount > ( UBaseType_t ) 0 );
+
+    /* Pop a free slot. */
+    pxConnection->uxFreeInflightSlotCount--;
+    pxInflightPublish = &( pxConnection->xInflightPublishes[ pxConnection->ucFreeInflightSlots[ pxConnection->uxFreeInflightSlotCount ] ] );
+
+    /* Store the publish. Note that the xEventCreationTimestamp and xTicksToWait
+     * have been updated by prvMQTTTask to account for the time spent in the
+     * command queue. */
+    pxInflightPublish->pxPublishParams = pxEventData->u.pxPublishParams;
+    pxInflightPublish->pxCompleteCallback = pxEventData->pxPublishCompleteCallback;
+    pxInflightPublish->pvCompleteContext = pxEventData->pvPublishCompleteContext;
+    pxInflightPublish->xTimeOut = pxEventData->xEventCreationTimestamp;
+    pxInflightPublish->xTicksToWait = pxEventData->xTicksToWait;
+
+    if( prvSendInflightPublish( pxConnection, pxInflightPublish ) == pdFAIL )
+    {
+        prvCompleteInflightPublish( pxConnection, pxInflightPublish, eMQTTAgentFailure );
+    }
+    else if( pxEventData->u.pxPublishParams->xQoS == eMQTTQoS0 )
+    {
+        /* No PUBACK is expected in case of QoS0. */
+        prvCompleteInflightPublish( pxConnection, pxInflightPublish, eMQTTAgentSuccess );
+    }
+    else
+    {
+        /* The publish completes when the PUBACK is received or the
+         * core library reports a timeout. */
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSendInflightPublish( MQTTBrokerConnection_t * const pxConnection,
+                                          MQTTInflightPublish_t * const pxInflightPublish )
+{
+    BaseType_t xStatus = pdFAIL;
+    MQTTPublishParams_t xPublishParams;
+    const UBaseType_t uxSlot = ( UBaseType_t ) ( pxInflightPublish - pxConnection->xInflightPublishes );
+
+    /* Every transmission gets a new packet identifier so that a late PUBACK
+     * for an earlier transmission from the same slot is ignored. */
+    pxConnection->ucInflightGeneration++;
+    pxInflightPublish->usPacketIdentifier = mqttASYNC_PACKET_IDENTIFIER( uxSlot, pxConnection->ucInflightGeneration );
+    pxInflightPublish->xAwaitingRetransmit = pdFALSE;
+
+    /* Setup publish parameters and call the Core library publish function. */
+    xPublishParams.pucTopic = pxInflightPublish->pxPublishParams->pucTopic;
+    xPublishParams.usTopicLength = pxInflightPublish->pxPublishParams->usTopicLength;
+    xPublishParams.xQos = pxInflightPublish->pxPublishParams->xQoS;
+    xPublishParams.pvData = pxInflightPublish->pxPublishParams->pvData;
+    xPublishParams.ulDataLength = pxInflightPublish->pxPublishParams->ulDataLength;
+    xPublishParams.usPacketIdentifier = pxInflightPublish->usPacketIdentifier;
+    xPublishParams.ulTimeoutTicks = pxInflightPublish->xTicksToWait;
+
+    if( MQTT_Publish( &( pxConnection->xMQTTContext ), &( xPublishParams ) ) == eMQTTSuccess )
+    {
+        xStatus = pdPASS;
+    }
+    else
+    {
+        mqttconfigDEBUG_LOG( ( "MQTT_Publish failed for asynchronous publish!\r\n" ) );
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+static MQTTInflightPublish_t * prvRetrieveInflightPublish( MQTTBrokerConnection_t * const pxConnection,
+                                                           uint16_t usPacketIdentifier )
+{
+    MQTTInflightPublish_t * pxInflightPublish = NULL;
+    const UBaseType_t uxSlot = mqttASYNC_PACKET_IDENTIFIER_SLOT( usPacketIdentifier );
+
+    /* The slot must be in use and its last transmission must have used
+     * this packet identifier. */
+    if( ( uxSlot < ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES ) &&
+        ( pxConnection->xInflightPublishes[ uxSlot ].pxPublishParams != NULL ) &&
+        ( pxConnection->xInflightPublishes[ uxSlot ].usPacketIdentifier == usPacketIdentifier ) )
+    {
+        pxInflightPublish = &( pxConnection->xInflightPublishes[ uxSlot ] );
+    }
+
+    return pxInflightPublish;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCompleteInflightPublish( MQTTBrokerConnection_t * const pxConnection,
+                                        MQTTInflightPublish_t * const pxInflightPublish,
+                                        MQTTAgentReturnCode_t xResult )
+{
+    const MQTTAgentPublishParams_t * pxPublishParams = pxInflightPublish->pxPublishParams;
+
+    /* Free the slot and push it back on the free slot stack. */
+    pxInflightPublish->pxPublishParams = NULL;
+    pxInflightPublish->xAwaitingRetransmit = pdFALSE;
+    configASSERT( pxConnection->uxFreeInflightSlotCount < ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES );
+    pxConnection->ucFreeInflightSlots[ pxConnection->uxFreeInflightSlotCount ] = ( uint8_t ) ( pxInflightPublish - pxConnection->xInflightPublishes );
+    pxConnection->uxFreeInflightSlotCount++;
+
+    prvInvokePublishCompleteCallback( pxConnection,
+                                      pxInflightPublish->pxCompleteCallback,
+                                      pxInflightPublish->pvCompleteContext,
+                                      pxPublishParams,
+                                      xResult );
+}
+/*-----------------------------------------------------------*/
+
+static void prvInvokePublishCompleteCallback( MQTTBrokerConnection_t * const pxConnection,
+                                              MQTTAgentPublishCompleteCallback_t pxCompleteCallback,
+                                              void * pvCompleteContext,
+                                              const MQTTAgentPublishParams_t * const pxPublishParams,
+                                              MQTTAgentReturnCode_t xResult )
+{
+    if( pxCompleteCallback != NULL )
+    {
+        pxCompleteCallback( pvCompleteContext, pxPublishParams, xResult );
+    }
+
+    /* Unblock a task waiting for space in the window, if any. */
+    ( void ) xSemaphoreGive( pxConnection->xInflightWindow );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRetransmitInflightPublishes( MQTTBrokerConnection_t * const pxConnection )
+{
+    UBaseType_t x;
+    MQTTInflightPublish_t * pxInflightPublish;
+
+    /* The window holds at most mqttconfigMAX_INFLIGHT_PUBLISHES publishes,
+     * so re-sending all of them cannot exceed it. */
+    for( x = 0; x < ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES; x++ )
+    {
+        pxInflightPublish = &( pxConnection->xInflightPublishes[ x ] );
+
+        if( ( pxInflightPublish->pxPublishParams != NULL ) && ( pxInflightPublish->xAwaitingRetransmit == pdTRUE ) )
+        {
+            /* Only the time left of the original timeout is used for
+             * the retransmission. */
+            if( xTaskCheckForTimeOut( &( pxInflightPublish->xTimeOut ), &( pxInflightPublish->xTicksToWait ) ) == pdTRUE )
+            {
+                prvCompleteInflightPublish( pxConnection, pxInflightPublish, eMQTTAgentTimeout );
+            }
+            else if( prvSendInflightPublish( pxConnection, pxInflightPublish ) == pdFAIL )
+            {
+                prvCompleteInflightPublish( pxConnection, pxInflightPublish, eMQTTAgentFailure );
+            }
+            else
+            {
+                mqttconfigDEBUG_LOG( ( "Re-sent asynchronous publish after reconnect.\r\n" ) );
+            }
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvFailInflightPublishes( MQTTBrokerConnection_t * const pxConnection,
+                                      MQTTAgentReturnCode_t xResult )
+{
+    UBaseType_t x;
+
+    for( x = 0; x < ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES; x++ )
+    {
+        if( pxConnection->xInflightPublishes[ x ].pxPublishParams != NULL )
+        {
+            prvCompleteInflightPublish( pxConnection, &( pxConnection->xInflightPublishes[ x ] ), xResult );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
 static MQTTAgentReturnCode_t prvSendCommandToMQTTTask( MQTTEventData_t * pxEventData )
 {
     BaseType_t xReturn;
@@ -1779,6 +2462,13 @@ static void prvMQTTTask( void * pvParameters )
              * performed before messages are sent to the command queue anyway. */
             configASSERT( xMQTTCommand.uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS );
 
+            /* A new wakeup can be posted from now on, as the data it signals
+             * is read when the connection is serviced below. */
+            if( xMQTTCommand.xEventType == eMQTTServiceSocket )
+            {
+                xMQTTConnections[ xMQTTCommand.uxBrokerNumber ].xWakeupPending = pdFALSE;
+            }
+
             /* Check if the timeout for the event has been reached.
              * It means that the MQTT task picked up this command for
              * processing too late and there is no point in proceeding.
@@ -1791,6 +2481,17 @@ static void prvMQTTTask( void * pvParameters )
                  * be NULL and therefore prvNotifyRequestingTask returns
                  * without doing anything. */
                 prvNotifyRequestingTask( &( xMQTTCommand.xNotificationData ), eMQTTOperationTimedOut, pdFAIL );
+
+                /* Asynchronous publishes have no task to notify. Report the
+                 * timeout in the completion callback instead. */
+                if( xMQTTCommand.xEventType == eMQTTPublishAsyncRequest )
+                {
+                    prvInvokePublishCompleteCallback( &( xMQTTConnections[ xMQTTCommand.uxBrokerNumber ] ),
+                                                      xMQTTCommand.pxPublishCompleteCallback,
+                                                      xMQTTCommand.pvPublishCompleteContext,
+                                                      xMQTTCommand.u.pxPublishParams,
+                                                      eMQTTAgentTimeout );
+                }
             }
             else
             {
@@ -1820,16 +2521,25 @@ static void prvMQTTTask( void * pvParameters )
                         prvInitiateMQTTPublish( &( xMQTTCommand ) );
                         break;
 
+                    case eMQTTPublishAsyncRequest:
+                        prvInitiateMQTTPublishAsync( &( xMQTTCommand ) );
+                        break;
+
                     default:
                         /* Anything else is illegal. */
                         mqttconfigDEBUG_LOG( ( "Unknown request received on command queue.\r\n" ) );
                         break;
                 }
             }
+
+            /* Whatever the command, the connection it is for needs servicing
+             * as its timeouts may have changed or it may have data to send. */
+            prvScheduleConnection( xMQTTCommand.uxBrokerNumber, 0 );
         }
 
-        /* Process active connections each time the queue unblocks.  It might
-         * be that the queue read timed out because a connection needs service. */
+        /* Service the connections which need it each time the queue unblocks.
+         * It might be that the queue read timed out because a connection needs
+         * service. */
         xNextTimeoutTicks = prvManageConnections();
     }
 }
@@ -1896,6 +2606,25 @@ BaseType_t MQTT_AGENT_Init( void )
                 xMQTTConnections[ x ].xWaitingTasks[ y ].xTaskToNotify = NULL;
                 xMQTTConnections[ x ].xWaitingTasks[ y ].ulMessageIdentifier = 0;
             }
+
+            /* Initialize the in-flight window - all slots are free. */
+            for( y = 0; y < ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES; y++ )
+            {
+                xMQTTConnections[ x ].xInflightPublishes[ y ].pxPublishParams = NULL;
+                xMQTTConnections[ x ].ucFreeInflightSlots[ y ] = ( uint8_t ) y;
+            }
+
+            xMQTTConnections[ x ].uxFreeInflightSlotCount = ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES;
+            xMQTTConnections[ x ].xInflightWindow = xSemaphoreCreateCountingStatic( ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES,
+                                                                                     ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES,
+                                                                                     &( xMQTTConnections[ x ].xInflightWindowBuffer ) );
+            configASSERT( xMQTTConnections[ x ].xInflightWindow );
+
+            /* Nothing to service until a command is received for this connection.
+             * All the entries being equal, the identity order is a valid heap. */
+            xMQTTConnections[ x ].xNextServiceTicks = UINT64_MAX;
+            xMQTTConnections[ x ].uxServiceHeapIndex = x;
+            uxServiceHeap[ x ] = x;
         }
 
         /* ulQueueMessageIdentifier uses the top 16-bits of a 32-bit value, so
@@ -1949,6 +2678,23 @@ MQTTAgentReturnCode_t MQTT_AGENT_Create( MQTTAgentHandle_t * const pxMQTTHandle
 MQTTAgentReturnCode_t MQTT_AGENT_Delete( MQTTAgentHandle_t xMQTTHandle )
 {
     const UBaseType_t uxBrokerNumber = ( UBaseType_t ) mqttDECODE_BROKER_NUMBER( xMQTTHandle ); /*lint !e923 Opaque pointer. */
+    MQTTBrokerConnection_t * const pxConnection = &( xMQTTConnections[ uxBrokerNumber ] );
+
+    configASSERT( uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS );
+
+    /* The client is disconnected, so the MQTT task no longer uses its in-flight
+     * window. Publishes interrupted by a lost connection are still waiting to be
+     * re-sent though. Complete them, which frees their slots and gives their
+     * tokens back, so that the next user of the connection starts with an empty
+     * window and never re-sends a publish of this one. */
+    prvFailInflightPublishes( pxConnection, eMQTTAgentFailure );
+    pxConnection->xRetransmitPending = pdFALSE;
+
+    /* Make sure the window is full again even if a token was not given back. */
+    while( uxSemaphoreGetCount( pxConnection->xInflightWindow ) < ( UBaseType_t ) mqttconfigMAX_INFLIGHT_PUBLISHES )
+    {
+        ( void ) xSemaphoreGive( pxConnection->xInflightWindow );
+    }
 
     /* Return the connection to the free connection pool. */
     prvReturnConnection( uxBrokerNumber );
@@ -2066,6 +2812,123 @@ MQTTAgentReturnCode_t MQTT_AGENT_Publish( MQTTAgentHandle_t xMQTTHandle,
 }
 /*-----------------------------------------------------------*/
 
+MQTTAgentReturnCode_t MQTT_AGENT_PublishAsync( MQTTAgentHandle_t xMQTTHandle,
+                                               const MQTTAgentPublishParams_t * const pxPublishParams,
+                                               MQTTAgentPublishCompleteCallback_t pxCompleteCallback,
+                                               void * pvCallbackContext,
+                                               TickType_t xTimeoutTicks )
+{
+    MQTTEventData_t xEventData;
+    MQTTAgentReturnCode_t xReturnCode = eMQTTAgentFailure;
+    MQTTBrokerConnection_t * pxConnection;
+    TimeOut_t xTimeOut;
+    const UBaseType_t uxBrokerNumber = ( UBaseType_t ) mqttDECODE_BROKER_NUMBER( xMQTTHandle ); /*lint !e923 Opaque pointer. */
+
+    /* Should not try to send commands until after the MQTT task has been
+     * initialized, in which case the command queue will have been created. */
+    configASSERT( xCommandQueue );
+    configASSERT( uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS );
+
+    pxConnection = &( xMQTTConnections[ uxBrokerNumber ] );
+
+    /* The MQTT task would wait for itself if the window is full. */
+    if( xTaskGetCurrentTaskHandle() != xMQTTTaskHandle )
+    {
+        vTaskSetTimeOutState( &( xTimeOut ) );
+
+        /* Wait for space in the in-flight window. The token is given back
+         * by the MQTT task when the publish completes. */
+        if( xSemaphoreTake( pxConnection->xInflightWindow, xTimeoutTicks ) == pdTRUE )
+        {
+            /* The time spent waiting for the window counts against the timeout. */
+            if( xTaskCheckForTimeOut( &( xTimeOut ), &( xTimeoutTicks ) ) == pdFALSE )
+            {
+                /* Setup the event to be sent to the command queue. There is no
+                 * task to notify, so the notification data is left zeroed. */
+                memset( &( xEventData ), 0x00, sizeof( MQTTEventData_t ) );
+                xEventData.uxBrokerNumber = uxBrokerNumber;
+                xEventData.xEventType = eMQTTPublishAsyncRequest;
+                xEventData.xTicksToWait = xTimeoutTicks;
+                xEventData.pxPublishCompleteCallback = pxCompleteCallback;
+                xEventData.pvPublishCompleteContext = pvCallbackContext;
+                xEventData.u.pxPublishParams = pxPublishParams;
+                vTaskSetTimeOutState( &( xEventData.xEventCreationTimestamp ) );
+
+                if( xQueueSendToBack( xCommandQueue, &xEventData, xTimeoutTicks ) != pdFALSE )
+                {
+                    xReturnCode = eMQTTAgentSuccess;
+                }
+                else
+                {
+                    mqttconfigDEBUG_LOG( ( "Attempt to write to the MQTT command queue failed.\r\n" ) );
+                    xReturnCode = eMQTTAgentTimeout;
+                }
+            }
+            else
+            {
+                xReturnCode = eMQTTAgentTimeout;
+            }
+
+            /* Return the token if the publish was not handed over to the
+             * MQTT task. */
+            if( xReturnCode != eMQTTAgentSuccess )
+            {
+                ( void ) xSemaphoreGive( pxConnection->xInflightWindow );
+            }
+        }
+        else
+        {
+            mqttconfigDEBUG_LOG( ( "Timed out waiting for space in the in-flight publish window.\r\n" ) );
+            xReturnCode = eMQTTAgentTimeout;
+        }
+    }
+    else
+    {
+        mqttconfigDEBUG_LOG( ( "MQTT Agent API called from MQTT task ( possibly from callback ) !!.\r\n" ) );
+        xReturnCode = eMQTTAgentAPICalledFromCallback;
+    }
+
+    return xReturnCode;
+}
+/*-----------------------------------------------------------*/
+
+MQTTAgentReturnCode_t MQTT_AGENT_GetTxStatistics( MQTTAgentHandle_t xMQTTHandle,
+                                                  MQTTAgentTxStatistics_t * const pxTxStatistics )
+{
+    const UBaseType_t uxBrokerNumber = ( UBaseType_t ) mqttDECODE_BROKER_NUMBER( xMQTTHandle ); /*lint !e923 Opaque pointer. */
+
+    configASSERT( uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS );
+    configASSERT( pxTxStatistics != NULL );
+
+    /* The counters are updated by the MQTT task. */
+    taskENTER_CRITICAL();
+    *pxTxStatistics = xMQTTConnections[ uxBrokerNumber ].xTxStatistics;
+    taskEXIT_CRITICAL();
+
+    return eMQTTAgentSuccess;
+}
+/*-----------------------------------------------------------*/
+
+MQTTAgentReturnCode_t MQTT_AGENT_ClonePublishData( MQTTAgentHandle_t xMQTTHandle,
+                                                   const MQTTPublishData_t * const pxPublishData,
+                                                   MQTTPublishData_t * const pxClonedPublishData )
+{
+    MQTTAgentReturnCode_t xReturnCode = eMQTTAgentFailure;
+    const UBaseType_t uxBrokerNumber = ( UBaseType_t ) mqttDECODE_BROKER_NUMBER( xMQTTHandle ); /*lint !e923 Opaque pointer. */
+
+    configASSERT( uxBrokerNumber < ( UBaseType_t ) mqttconfigMAX_BROKERS );
+
+    /* The copy is made using the buffer pool interface of the MQTT context
+     * which is the thread safe central buffer pool. */
+    if( MQTT_ClonePublishData( &( xMQTTConnections[ uxBrokerNumber ].xMQTTContext ), pxPublishData, pxClonedPublishData ) == eMQTTSuccess )
+    {
+        xReturnCode = eMQTTAgentSuccess;
+    }
+
+    return xReturnCode;
+}
+/*-----------------------------------------------------------*/
+
 MQTTAgentReturnCode_t MQTT_AGENT_ReturnBuffer( MQTTAgentHandle_t xMQTTHandle,
                                                MQTTBufferHandle_t xBufferHandle )
 {
@@ -265,6 +265,45 @@
 #define mqttPUBACK_PACKET_ID_LSB_OFFSET    3
 /** @} */
 
+/**
+ * @defgroup SubscriptionNode Constants used for the nodes of the subscription manager.
+ */
+/** @{ */
+#define mqttSUBSCRIPTION_NODE_NONE            ( ( uint16_t ) 0xFFFF ) /**< Node index representing the absence of a node. */
+#define mqttSUBSCRIPTION_NODE_ROOT            ( ( uint16_t ) 0 )      /**< The root node does not represent any topic level. */
+#define mqttSUBSCRIPTION_NODE_LITERAL         ( ( uint8_t ) 0x01 )    /**< The node represents a topic level without wild-card. */
+#define mqttSUBSCRIPTION_NODE_SINGLE_LEVEL    ( ( uint8_t ) 0x02 )    /**< The node represents the '+' topic level. */
+#define mqttSUBSCRIPTION_NODE_MULTI_LEVEL     ( ( uint8_t ) 0x04 )    /**< The node represents the '#' topic level. */
+#define mqttSUBSCRIPTION_NODE_TYPE_MASK       ( ( uint8_t ) 0x07 )    /**< Bits of ucFlags holding the type of the node. */
+#define mqttSUBSCRIPTION_NODE_SUBSCRIBED      ( ( uint8_t ) 0x08 )    /**< A subscription is stored on the node. */
+/** @} */
+
+/**
+ * @brief Fails the build if the given constant expression is false.
+ *
+ * Unlike a preprocessor check, this also works when the configuration is
+ * written with casts or sizeof.
+ *
+ * @param[in] xCondition The condition which must hold.
+ * @param[in] xName The name of the type declared for the check.
+ */
+#define mqttSTATIC_ASSERT( xCondition, xName )    typedef char xName[ ( xCondition ) ? 1 : -1 ]
+
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    /* Node indices are stored in uint16_t and 0xFFFF means no node. */
+    mqttSTATIC_ASSERT( ( mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES >= 1 ) &&
+                       ( mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES < 0xFFFF ), MQTTMaxNodesFitNodeIndex_t );
+
+    /* Level arena offsets and the used size are stored in uint16_t. */
+    mqttSTATIC_ASSERT( mqttconfigSUBSCRIPTION_MANAGER_LEVEL_ARENA_SIZE <= 0xFFFF, MQTTLevelArenaFitsOffset_t );
+
+    /* Bucket indices are calculated as uint16_t. */
+    mqttSTATIC_ASSERT( ( mqttconfigSUBSCRIPTION_MANAGER_LITERAL_BUCKETS >= 1 ) &&
+                       ( mqttconfigSUBSCRIPTION_MANAGER_LITERAL_BUCKETS <= 0xFFFF ), MQTTLiteralBucketsFitIndex_t );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
 /**
  * @brief Extracts retain bit from the control byte of the PUBLISH message
  * received from the broker.
@@ -476,9 +515,9 @@ static MQTTBool_t prvIsTimeElapsed( uint64_t * pxRecordedTickCount,
 /**
  * @brief Transmits the data using the user supplied callback.
  *
- * It also updates the xLastSentMessageTimestamp and ulNextPeriodicInvokeTicks
- * in the MQTT context in case of a successful transmit to ensure that
- * keep alive messages are sent when needed.
+ * It also updates the xLastSentMessageTimestamp, xLastTransmissionTimestamp and
+ * ulNextPeriodicInvokeTicks in the MQTT context in case of a successful transmit
+ * to ensure that keep alive messages are sent when needed.
  *
  * @param[in] pxMQTTContext The MQTT context.
  * @param[in] pucData The data to transmit.
@@ -490,6 +529,18 @@ static MQTTReturnCode_t prvSendData( MQTTContext_t * pxMQTTContext,
                                      const uint8_t * const pucData,
                                      uint32_t ulDataLength );
 
+/**
+ * @brief Restarts the keep alive interval because data was received from the broker.
+ *
+ * Received data shows that the connection is alive, so there is no need to probe
+ * it with a PINGREQ. The keep alive message is still sent once nothing has been
+ * transmitted for ulKeepAliveMaxIdleTicks, so that the broker does not close the
+ * connection.
+ *
+ * @param[in] pxMQTTContext The MQTT context.
+ */
+static void prvDeferKeepAlive( MQTTContext_t * pxMQTTContext );
+
 /**
  * @brief Decodes and processes the received MQTT message containing only fixed header.
  *
@@ -585,9 +636,44 @@ static void prvProcessReceivedPINGRESP( MQTTContext_t * pxMQTTContext );
  * free the buffer whenever done or supply it back for re-use by calling
  * MQTT_GiveBuffer.
  *
+ * If xBuffer is NULL, the message is parsed in place from the received data
+ * and the user cannot take the ownership.
+ *
  * @param[in] pxMQTTContext The MQTT context for which the message was received.
+ * @param[in] pucPacket The complete received message.
+ * @param[in] ucRemainingLengthFieldBytes The number of bytes the "Remaining
+ * Length" field spans.
+ * @param[in] ulTotalMessageLength The total length of the message.
+ * @param[in] xBuffer The buffer containing the message, NULL if the message is
+ * parsed in place.
  */
-static void prvProcessReceivedPublish( MQTTContext_t * pxMQTTContext );
+static void prvProcessReceivedPublish( MQTTContext_t * pxMQTTContext,
+                                       const uint8_t * const pucPacket,
+                                       uint8_t ucRemainingLengthFieldBytes,
+                                       uint32_t ulTotalMessageLength,
+                                       MQTTBufferHandle_t xBuffer );
+
+/**
+ * @brief Checks whether the received data starts with a complete Publish
+ * message which can be parsed in place.
+ *
+ * @param[in] pucReceivedData The received data starting at a packet boundary.
+ * @param[in] xReceivedDataLength The number of received bytes.
+ * @param[out] pucRemainingLengthFieldBytes The number of bytes the "Remaining
+ * Length" field spans.
+ * @param[out] pulTotalMessageLength The total length of the message.
+ *
+ * @return eMQTTTrue if the received data contains a complete Publish message,
+ * eMQTTFalse otherwise.
+ */
+#if ( mqttconfigENABLE_ZERO_COPY_PUBLISH == 1 )
+
+    static MQTTBool_t prvIsCompletePublish( const uint8_t * const pucReceivedData,
+                                            size_t xReceivedDataLength,
+                                            uint8_t * const pucRemainingLengthFieldBytes,
+                                            uint32_t * const pulTotalMessageLength );
+
+#endif /* mqttconfigENABLE_ZERO_COPY_PUBLISH */
 
 /**
  * @brief Invokes the user supplied callback.
@@ -688,11 +774,14 @@ static uint8_t prvDecodeRemainingLength( const uint8_t * const pucEncodedRemaini
 /**
  * @brief Store the subscription in the subscription manager.
  *
- * This function can fail to store the subscription if all the entries in the
- * subscription manager are in use or the topic name is longer than the maximum
- * length as specified by the mqttconfigSUBSCRIPTION_MANAGER_MAX_TOPIC_LENGTH
- * macro or if the topic represents an invalid topic filter. eMQTTFalse is returned
- * to indicate the failure.
+ * If a subscription for the same topic filter is already stored, its callback
+ * and callback context are replaced. This function can fail to store the
+ * subscription if mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS subscriptions
+ * are already stored, there is no node or level arena space left to store the
+ * topic levels, the topic name is longer than the maximum length as specified
+ * by the mqttconfigSUBSCRIPTION_MANAGER_MAX_TOPIC_LENGTH macro or if the topic
+ * represents an invalid topic filter. eMQTTFalse is returned to indicate the
+ * failure.
  *
  * @param[in] pxMQTTContext The MQTT context for which to store the subscription.
  * @param[in] pucTopic The topic this subscription entry is for.
@@ -717,9 +806,9 @@ static uint8_t prvDecodeRemainingLength( const uint8_t * const pucEncodedRemaini
  * @brief Removes the subscription entry from the subscription manager corresponding
  * to the provided topic.
  *
- * Iterates over all the entries in the subscription manager and tries to find
- * the one with the matching topic. If it finds one, removes it by marking it
- * free.
+ * Walks the subscription tree along the levels of the given topic. If a
+ * subscription is stored on the node reached, removes it and frees the nodes
+ * which are no longer part of any stored topic filter.
  *
  * @param[in] pxMQTTContext The MQTT context for which to remove the subscription.
  * @param[in] pucTopic The topic for which the subscription entry is to be removed.
@@ -764,6 +853,10 @@ static uint8_t prvDecodeRemainingLength( const uint8_t * const pucEncodedRemaini
  * - Then it tries to find entries containing topic filters with wild-cards
  *   which match the topic on which the publish message is received.
  *
+ * Both steps walk the subscription tree one topic level at a time and so the
+ * cost depends on the number of levels in the topic and not on the number of
+ * stored subscriptions.
+ *
  * @param[in] pxMQTTContext The MQTT context for which to invoke the subscription callbacks.
  * @param[in] pxPublishData The publish data containing the topic and the received message.
  * @param[out] pxSubscriptionCallbackInvoked Set to eMQTTTrue if any callback was invoked,
@@ -809,33 +902,162 @@ static uint8_t prvDecodeRemainingLength( const uint8_t * const pucEncodedRemaini
 #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
 
 /**
- * @brief Checks whether the given topic matches the given topic
- * filter.
+ * @brief Initializes the subscription manager so that no subscription is
+ * stored.
+ *
+ * @param[in] pxSubscriptionManager The subscription manager to initialize.
+ */
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static void prvInitSubscriptionManager( MQTTSubscriptionManager_t * pxSubscriptionManager );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
+/**
+ * @brief Calculates the hash of the name of a topic level.
  *
- * @warning It assumes that the given topic filter is valid i.e.
- * calling prvIsValidTopicFilter with the given topic will not
- * return eMQTTTopicFilterTypeInvalid.
+ * @param[in] pucLevel The name of the topic level.
+ * @param[in] usLevelLength The length of the name of the topic level.
  *
- * Some corner cases as documented by the MQTT protocol spec are:
- * - Filter of type "sport/#" also matches the singular "sport"
- *   since # includes the parent level.
- * - Filter of type "sport/+" also matches the "sport/" but not
- *   "sport".
+ * @return The hash of the name of the topic level.
+ */
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint32_t prvHashTopicLevel( const uint8_t * const pucLevel,
+                                       uint16_t usLevelLength );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
+/**
+ * @brief Calculates the hash bucket of a literal topic level.
  *
- * @param[in] pucTopic The given topic to match.
- * @param[in] usTopicLength The length of the given topic.
- * @param[in] pucTopicFilter The given topic filter with which to match
- * the given topic.
- * @param[in] usTopicFilterLength The length of the given topic filter.
+ * @param[in] usParent The index of the parent node of the topic level.
+ * @param[in] ulLevelHash The hash of the name of the topic level.
+ *
+ * @return The index of the bucket in usLiteralBuckets.
+ */
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint16_t prvLiteralBucket( uint16_t usParent,
+                                      uint32_t ulLevelHash );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
+/**
+ * @brief Finds the end of the topic level which starts at the given index.
+ *
+ * @param[in] pucTopic The topic or topic filter.
+ * @param[in] usTopicLength The length of the topic or topic filter.
+ * @param[in] ulLevelStart The index of the first character of the topic level.
+ *
+ * @return The index of the '/' terminating the topic level or the length of
+ * the topic if it is the last topic level.
+ */
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint32_t prvFindTopicLevelEnd( const uint8_t * const pucTopic,
+                                          uint16_t usTopicLength,
+                                          uint32_t ulLevelStart );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
+/**
+ * @brief Finds the child of the given node representing the given topic level
+ * without wild-card.
+ *
+ * @param[in] pxSubscriptionManager The subscription manager to search.
+ * @param[in] usParent The index of the node whose children are searched.
+ * @param[in] pucLevel The name of the topic level.
+ * @param[in] usLevelLength The length of the name of the topic level.
+ *
+ * @return The index of the child node if found, mqttSUBSCRIPTION_NODE_NONE otherwise.
+ */
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint16_t prvFindLiteralChild( const MQTTSubscriptionManager_t * const pxSubscriptionManager,
+                                         uint16_t usParent,
+                                         const uint8_t * const pucLevel,
+                                         uint16_t usLevelLength );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
+/**
+ * @brief Allocates a node from the free nodes and links it to the given parent.
+ *
+ * The name of a topic level without wild-card is copied to the level arena.
+ *
+ * @param[in] pxSubscriptionManager The subscription manager to allocate the node from.
+ * @param[in] usParent The index of the parent node.
+ * @param[in] ucNodeType The type of the topic level represented by the node.
+ * @param[in] pucLevel The name of the topic level.
+ * @param[in] usLevelLength The length of the name of the topic level.
+ *
+ * @return The index of the allocated node, mqttSUBSCRIPTION_NODE_NONE if no
+ * node or level arena space is left.
+ */
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint16_t prvAllocateSubscriptionNode( MQTTSubscriptionManager_t * pxSubscriptionManager,
+                                                 uint16_t usParent,
+                                                 uint8_t ucNodeType,
+                                                 const uint8_t * const pucLevel,
+                                                 uint16_t usLevelLength );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
+/**
+ * @brief Frees the nodes from the given node up towards the root which do not
+ * store a subscription and do not have any child.
+ *
+ * The level arena is compacted so that the names of the remaining topic levels
+ * stay contiguous.
+ *
+ * @param[in] pxSubscriptionManager The subscription manager to free the nodes in.
+ * @param[in] usNode The index of the node to start from.
+ */
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static void prvPruneSubscriptionNodes( MQTTSubscriptionManager_t * pxSubscriptionManager,
+                                           uint16_t usNode );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
+/**
+ * @brief Finds the node for the last level of the given topic filter.
+ *
+ * @param[in] pxSubscriptionManager The subscription manager to search.
+ * @param[in] pucTopicFilter The topic filter.
+ * @param[in] usTopicFilterLength The length of the topic filter.
+ * @param[in] xCreate If eMQTTTrue, the missing nodes are created.
+ *
+ * @return The index of the node if found or created, mqttSUBSCRIPTION_NODE_NONE
+ * otherwise.
+ */
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint16_t prvFindSubscriptionNode( MQTTSubscriptionManager_t * pxSubscriptionManager,
+                                             const uint8_t * const pucTopicFilter,
+                                             uint16_t usTopicFilterLength,
+                                             MQTTBool_t xCreate );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
+/**
+ * @brief Invokes the callback of the subscription stored on the given node,
+ * if any.
+ *
+ * @param[in] pxNode The node.
+ * @param[in] pxPublishData The publish data containing the topic and the received message.
+ * @param[out] pxSubscriptionCallbackInvoked Set to eMQTTTrue if the callback was invoked,
+ * otherwise left unchanged.
  *
- * @return eMQTTTrue if the topic matches the filter, eMQTTFalse otherwise.
+ * @return eMQTTTrue if the user took the ownership of the MQTT buffer, eMQTTFalse otherwise.
  */
 #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
 
-    static MQTTBool_t prvDoesTopicMatchTopicFilter( const uint8_t * const pucTopic,
-                                                    uint16_t usTopicLength,
-                                                    const uint8_t * const pucTopicFilter,
-                                                    uint16_t usTopicFilterLength );
+    static MQTTBool_t prvInvokeSubscriptionNodeCallback( const MQTTSubscriptionNode_t * const pxNode,
+                                                         const MQTTPublishData_t * pxPublishData,
+                                                         MQTTBool_t * pxSubscriptionCallbackInvoked );
 
 #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
 /*-----------------------------------------------------------*/
@@ -1006,10 +1228,6 @@ static void prvResetMQTTContext( MQTTContext_t * pxMQTTContext )
     Link_t * pxLink, * pxTempLink;
     MQTTBufferHandle_t xBufferHandle;
 
-    #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
-        uint32_t x;
-    #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
-
     /* Set connection state to not connected. */
     pxMQTTContext->xConnectionState = eMQTTNotConnected;
 
@@ -1028,15 +1246,9 @@ static void prvResetMQTTContext( MQTTContext_t * pxMQTTContext )
 
     #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
 
-        /* Mark all the subscription entires in the subscription
-         * manager as free. */
-        for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
-        {
-            pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xInUse = eMQTTFalse;
-        }
-
-        /* Set the number of in-use subscription entries to zero. */
-        pxMQTTContext->xSubscriptionManager.ulInUseSubscriptions = 0;
+        /* Remove all the subscriptions from the subscription
+         * manager. */
+        prvInitSubscriptionManager( &( pxMQTTContext->xSubscriptionManager ) );
     #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
 }
 /*-----------------------------------------------------------*/
@@ -1114,6 +1326,7 @@ static MQTTReturnCode_t prvSendData( MQTTContext_t * pxMQTTContext,
          * sending any message essentially delays when the next keep
          * alive should be sent. */
         pxMQTTContext->xLastSentMessageTimestamp = prvGetCurrentTickCount( pxMQTTContext );
+        pxMQTTContext->xLastTransmissionTimestamp = pxMQTTContext->xLastSentMessageTimestamp;
         pxMQTTContext->ulNextPeriodicInvokeTicks = pxMQTTContext->ulKeepAliveActualIntervalTicks;
     }
 
@@ -1121,6 +1334,33 @@ static MQTTReturnCode_t prvSendData( MQTTContext_t * pxMQTTContext,
 }
 /*-----------------------------------------------------------*/
 
+static void prvDeferKeepAlive( MQTTContext_t * pxMQTTContext )
+{
+    uint64_t xCurrentTickCount;
+    uint32_t ulIdleTicks;
+
+    /* Keep alive messages are only deferred while connected and not
+     * waiting for PINGRESP, and only if the user enabled it. */
+    if( ( pxMQTTContext->xConnectionState == eMQTTConnected ) &&
+        ( pxMQTTContext->xWaitingForPingResp == eMQTTFalse ) &&
+        ( pxMQTTContext->ulKeepAliveMaxIdleTicks != ( uint32_t ) 0 ) &&
+        ( pxMQTTContext->pxGetTicksFxn != NULL ) )
+    {
+        xCurrentTickCount = prvGetCurrentTickCount( pxMQTTContext );
+        ulIdleTicks = ( uint32_t ) ( xCurrentTickCount - pxMQTTContext->xLastTransmissionTimestamp );
+
+        if( ulIdleTicks < pxMQTTContext->ulKeepAliveMaxIdleTicks )
+        {
+            /* Restart the keep alive interval from now, but do not
+             * go beyond the maximum idle time. */
+            pxMQTTContext->xLastSentMessageTimestamp = xCurrentTickCount;
+            pxMQTTContext->ulNextPeriodicInvokeTicks = mqttMIN( pxMQTTContext->ulKeepAliveActualIntervalTicks,
+                                                                pxMQTTContext->ulKeepAliveMaxIdleTicks - ulIdleTicks );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
 static void prvProcessReceivedFixedHeaderOnlyMQTTPacket( MQTTContext_t * pxMQTTContext )
 {
     MQTTEventCallbackParams_t xEventCallbackParams;
@@ -1151,7 +1391,11 @@ static void prvProcessReceivedMQTTPacket( MQTTContext_t * pxMQTTContext )
     /* Is this a publish message from broker? */
     if( ( mqttbufferGET_DATA( pxMQTTContext->xRxBuffer )[ mqttFIXED_HEADER_CONTROL_BYTE_OFFSET ] & mqttTOP_NIBBLE_MASK ) == mqttCONTROL_PUBLISH )
     {
-        prvProcessReceivedPublish( pxMQTTContext );
+        prvProcessReceivedPublish( pxMQTTContext,
+                                   mqttbufferGET_DATA( pxMQTTContext->xRxBuffer ),
+                                   pxMQTTContext->xRxMessageState.ucRemaingingLengthFieldBytes,
+                                   pxMQTTContext->xRxMessageState.ulTotalMessageLength,
+                                   pxMQTTContext->xRxBuffer );
     }
     /* Is this a CONNACK? */
     else if( mqttbufferGET_DATA( pxMQTTContext->xRxBuffer )[ mqttFIXED_HEADER_CONTROL_BYTE_OFFSET ] == ( uint8_t ) ( mqttCONTROL_CONNACK | mqttFLAGS_CONNACK ) )
@@ -1669,11 +1913,17 @@ static void prvProcessReceivedPINGRESP( MQTTContext_t * pxMQTTContext )
 }
 /*-----------------------------------------------------------*/
 
-static void prvProcessReceivedPublish( MQTTContext_t * pxMQTTContext )
+static void prvProcessReceivedPublish( MQTTContext_t * pxMQTTContext,
+                                       const uint8_t * const pucPacket,
+                                       uint8_t ucRemainingLengthFieldBytes,
+                                       uint32_t ulTotalMessageLength,
+                                       MQTTBufferHandle_t xBuffer )
 {
     MQTTEventCallbackParams_t xEventCallbackParams;
-    uint8_t ucPacketIdentiferLength; /* Length in bytes taken by the packet identifier field in the received publish packet. */
+    MQTTBool_t xMalformedPacket = eMQTTTrue;
+    uint8_t ucPacketIdentiferLength = 0; /* Length in bytes taken by the packet identifier field in the received publish packet. */
     uint8_t ucQos;
+    uint32_t ulTopicOffset, ulDataOffset = 0;
     static uint8_t ucPUBACKPacket[] =
     {
         mqttCONTROL_PUBACK | mqttFLAGS_PUBACK, /* Fixed header control packet type. */
@@ -1687,10 +1937,14 @@ static void prvProcessReceivedPublish( MQTTContext_t * pxMQTTContext )
     xEventCallbackParams.xEventType = eMQTTPublish;
 
     /*_TODO_ Do we want to expose DUP and RETAIN? */
-    ucQos = mqttPUBLISH_QoS_BITS( mqttbufferGET_DATA( pxMQTTContext->xRxBuffer )[ mqttFIXED_HEADER_CONTROL_BYTE_OFFSET ] );
+    ucQos = mqttPUBLISH_QoS_BITS( pucPacket[ mqttFIXED_HEADER_CONTROL_BYTE_OFFSET ] );
+
+    /* The topic string is preceded by its two byte length. */
+    ulTopicOffset = mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_STRING_OFFSET, ucRemainingLengthFieldBytes );
 
     /* QoS2 is not supported. */
-    if( ( ucQos == ( uint8_t ) 0 /* QoS0. */ ) || ( ucQos == ( uint8_t ) 1 /* QoS1. */ ) )
+    if( ( ( ucQos == ( uint8_t ) 0 /* QoS0. */ ) || ( ucQos == ( uint8_t ) 1 /* QoS1. */ ) ) &&
+        ( ulTopicOffset <= ulTotalMessageLength ) )
     {
         xEventCallbackParams.u.xPublishData.xQos = ( ucQos == ( uint8_t ) 0 ) ? eMQTTQoS0 : eMQTTQoS1;
 
@@ -1704,32 +1958,33 @@ static void prvProcessReceivedPublish( MQTTContext_t * pxMQTTContext )
         }
 
         /* Extract Topic Length. */
-        xEventCallbackParams.u.xPublishData.usTopicLength = ( uint16_t ) mqttbufferGET_DATA( pxMQTTContext->xRxBuffer )[ mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_LENGTH_MSB,
-                                                                                                                                            pxMQTTContext->xRxMessageState.ucRemaingingLengthFieldBytes ) ];
+        xEventCallbackParams.u.xPublishData.usTopicLength = ( uint16_t ) pucPacket[ mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_LENGTH_MSB, ucRemainingLengthFieldBytes ) ];
         xEventCallbackParams.u.xPublishData.usTopicLength <<= mqttBITS_PER_BYTE;
-        xEventCallbackParams.u.xPublishData.usTopicLength |= ( uint16_t ) mqttbufferGET_DATA( pxMQTTContext->xRxBuffer )[ mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_LENGTH_LSB,
-                                                                                                                                             pxMQTTContext->xRxMessageState.ucRemaingingLengthFieldBytes ) ];
+        xEventCallbackParams.u.xPublishData.usTopicLength |= ( uint16_t ) pucPacket[ mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_LENGTH_LSB, ucRemainingLengthFieldBytes ) ];
 
+        /* Topic string is followed by packet identifier which is
+         * followed by actual data. Note that QoS0 publishes do not
+         * have packet identifier. Both must fit in the message. */
+        ulDataOffset = ulTopicOffset + ( uint32_t ) xEventCallbackParams.u.xPublishData.usTopicLength + ( uint32_t ) ucPacketIdentiferLength;
+
+        if( ulDataOffset <= ulTotalMessageLength )
+        {
+            xMalformedPacket = eMQTTFalse;
+        }
+    }
+
+    if( xMalformedPacket == eMQTTFalse )
+    {
         /* Extract Topic. */
-        xEventCallbackParams.u.xPublishData.pucTopic = &( mqttbufferGET_DATA( pxMQTTContext->xRxBuffer )[ mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_STRING_OFFSET,
-                                                                                                                             pxMQTTContext->xRxMessageState.ucRemaingingLengthFieldBytes ) ] );
+        xEventCallbackParams.u.xPublishData.pucTopic = &( pucPacket[ ulTopicOffset ] );
 
         /* Extract Published Data. */
-        xEventCallbackParams.u.xPublishData.pvData = ( void * ) &( mqttbufferGET_DATA( pxMQTTContext->xRxBuffer )[ mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_STRING_OFFSET,
-                                                                                                                                      pxMQTTContext->xRxMessageState.ucRemaingingLengthFieldBytes ) +
-                                                                                                                   xEventCallbackParams.u.xPublishData.usTopicLength +
-                                                                                                                   ucPacketIdentiferLength ] ); /*lint !e9087 Publish data is provided as void* to the user. */
-
-        /* Topic string is followed by packet identifier which is
-         * followed by actual data. NOte that QoS0 publishes do not
-         * have packet identifier. */
-        xEventCallbackParams.u.xPublishData.ulDataLength = pxMQTTContext->xRxMessageState.ulTotalMessageLength - ( mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_STRING_OFFSET,
-                                                                                                                                      pxMQTTContext->xRxMessageState.ucRemaingingLengthFieldBytes ) +
-                                                                                                                   xEventCallbackParams.u.xPublishData.usTopicLength +
-                                                                                                                   ucPacketIdentiferLength );
+        xEventCallbackParams.u.xPublishData.pvData = ( const void * ) &( pucPacket[ ulDataOffset ] ); /*lint !e9087 Publish data is provided as void* to the user. */
+        xEventCallbackParams.u.xPublishData.ulDataLength = ulTotalMessageLength - ulDataOffset;
 
-        /* Pass the handle of the buffer containing the whole MQTT message. */
-        xEventCallbackParams.u.xPublishData.xBuffer = pxMQTTContext->xRxBuffer;
+        /* Pass the handle of the buffer containing the whole MQTT message,
+         * which is NULL if the message is parsed in place. */
+        xEventCallbackParams.u.xPublishData.xBuffer = xBuffer;
 
         /* If this is a QoS1 publish, send the PUBACK before invoking the
          * callback. */
@@ -1737,13 +1992,8 @@ static void prvProcessReceivedPublish( MQTTContext_t * pxMQTTContext )
         {
             /* Extract the packet identifier from the publish message
              * to set the same in PUBACK message. */
-            ucPUBACKPacket[ mqttPUBACK_PACKET_ID_MSB_OFFSET ] = mqttbufferGET_DATA( pxMQTTContext->xRxBuffer )[ mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_STRING_OFFSET,
-                                                                                                                                   pxMQTTContext->xRxMessageState.ucRemaingingLengthFieldBytes ) +
-                                                                                                                xEventCallbackParams.u.xPublishData.usTopicLength ];
-            ucPUBACKPacket[ mqttPUBACK_PACKET_ID_LSB_OFFSET ] = mqttbufferGET_DATA( pxMQTTContext->xRxBuffer )[ mqttADJUST_OFFSET( mqttPUBLISH_TOPIC_STRING_OFFSET,
-                                                                                                                                   pxMQTTContext->xRxMessageState.ucRemaingingLengthFieldBytes ) +
-                                                                                                                xEventCallbackParams.u.xPublishData.usTopicLength +
-                                                                                                                ( uint16_t ) 1 /* Packet ID LSB follows MSB. */ ];
+            ucPUBACKPacket[ mqttPUBACK_PACKET_ID_MSB_OFFSET ] = pucPacket[ ulDataOffset - ( uint32_t ) 2 ];
+            ucPUBACKPacket[ mqttPUBACK_PACKET_ID_LSB_OFFSET ] = pucPacket[ ulDataOffset - ( uint32_t ) 1 ]; /* Packet ID LSB follows MSB. */
 
             /* Send a PUBACK to the broker confirming the receipt
              * of the publish message. If we fail to send the PUBACK,
@@ -1752,16 +2002,26 @@ static void prvProcessReceivedPublish( MQTTContext_t * pxMQTTContext )
         }
 
         /* If the user chooses not to take the ownership of the buffer,
-         * return it back to the free buffer pool. */
+         * return it back to the free buffer pool. A message parsed in
+         * place cannot be owned by the user. */
         if( prvInvokeCallback( pxMQTTContext, &xEventCallbackParams ) == eMQTTFalse )
         {
-            prvReturnBuffer( pxMQTTContext, pxMQTTContext->xRxBuffer );
+            prvReturnBuffer( pxMQTTContext, xBuffer );
+        }
+        else if( xBuffer == NULL )
+        {
+            mqttconfigDEBUG_LOG( ( "WARN: Ownership of a publish message parsed in place cannot be taken. Use MQTT_ClonePublishData.\r\n" ) );
+        }
+        else
+        {
+            /* The user owns the buffer now. */
         }
     }
     else
     {
-        /* A publish packet with QoS2 is considered malformed and
-         * we disconnect. */
+        /* A publish packet with QoS2 or with a topic which does
+         * not fit in the packet is considered malformed and we
+         * disconnect. */
         prvResetMQTTContext( pxMQTTContext );
 
         /* Inform user about the malformed packet received. */
@@ -1772,6 +2032,49 @@ static void prvProcessReceivedPublish( MQTTContext_t * pxMQTTContext )
 }
 /*-----------------------------------------------------------*/
 
+#if ( mqttconfigENABLE_ZERO_COPY_PUBLISH == 1 )
+
+    static MQTTBool_t prvIsCompletePublish( const uint8_t * const pucReceivedData,
+                                            size_t xReceivedDataLength,
+                                            uint8_t * const pucRemainingLengthFieldBytes,
+                                            uint32_t * const pulTotalMessageLength )
+    {
+        MQTTBool_t xCompletePublish = eMQTTFalse;
+        uint32_t x, ulRemainingLength = 0;
+
+        if( ( xReceivedDataLength > ( size_t ) mqttFIXED_HEADER_REMAINING_LENGTH_OFFSET ) &&
+            ( ( pucReceivedData[ mqttFIXED_HEADER_CONTROL_BYTE_OFFSET ] & mqttTOP_NIBBLE_MASK ) == mqttCONTROL_PUBLISH ) )
+        {
+            /* Find the last byte of the "Remaining Length" field. It must
+             * be in the received data to decode the field in place. */
+            for( x = ( uint32_t ) mqttFIXED_HEADER_REMAINING_LENGTH_OFFSET; ( x < ( uint32_t ) mqttFIXED_HEADER_MAX_SIZE ) && ( ( size_t ) x < xReceivedDataLength ); x++ )
+            {
+                if( ( pucReceivedData[ x ] & mqttREMAINING_LENGTH_CONTINUATION_BITMASK ) == ( uint8_t ) 0 )
+                {
+                    *pucRemainingLengthFieldBytes = prvDecodeRemainingLength( &( pucReceivedData[ mqttFIXED_HEADER_REMAINING_LENGTH_OFFSET ] ),
+                                                                              &( ulRemainingLength ) );
+
+                    /* "Remaining Length" does not include the length
+                     * of fixed header. */
+                    *pulTotalMessageLength = ulRemainingLength + x + ( uint32_t ) 1;
+
+                    /* Is the whole message in the received data? */
+                    if( ( size_t ) *pulTotalMessageLength <= xReceivedDataLength )
+                    {
+                        xCompletePublish = eMQTTTrue;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        return xCompletePublish;
+    }
+
+#endif /* mqttconfigENABLE_ZERO_COPY_PUBLISH */
+/*-----------------------------------------------------------*/
+
 static MQTTBool_t prvInvokeCallback( MQTTContext_t * pxMQTTContext,
                                      MQTTEventCallbackParams_t * pxEventCallbackParams )
 {
@@ -1986,71 +2289,71 @@ static uint8_t prvDecodeRemainingLength( const uint8_t * const pucEncodedRemaini
                                             void * pvPublishCallbackContext,
                                             MQTTPublishCallback_t pxPublishCallback )
     {
-        uint32_t x;
+        MQTTSubscriptionManager_t * pxSubscriptionManager = &( pxMQTTContext->xSubscriptionManager );
+        MQTTSubscriptionNode_t * pxNode;
         MQTTBool_t xSubscriptionStored = eMQTTFalse;
-        MQTTTopicFilterType_t xTopicFilterType;
+        uint16_t usNode;
 
-        /* Is there a free entry in the subscription manager? */
-        if( pxMQTTContext->xSubscriptionManager.ulInUseSubscriptions < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS )
+        /* Check that the topic name is not too long. */
+        if( usTopicLength <= ( uint16_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_TOPIC_LENGTH )
         {
-            /* Check that the topic name is not too long. */
-            if( usTopicLength <= ( uint16_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_TOPIC_LENGTH )
+            /* Ensure that the topic is not invalid. */
+            if( prvGetTopicFilterType( pucTopic, usTopicLength ) != eMQTTTopicFilterTypeInvalid )
             {
-                /* Ensure that the topic is not invalid. */
-                xTopicFilterType = prvGetTopicFilterType( pucTopic, usTopicLength );
+                /* Find the node for the last level of the topic
+                 * filter, creating the missing ones. */
+                usNode = prvFindSubscriptionNode( pxSubscriptionManager, pucTopic, usTopicLength, eMQTTTrue );
 
-                if( xTopicFilterType != eMQTTTopicFilterTypeInvalid )
+                if( usNode != mqttSUBSCRIPTION_NODE_NONE )
                 {
-                    /* Ensure that subscription manager does not contain
-                     * an entry for the topic filter already. */
-                    prvRemoveSubscription( pxMQTTContext, pucTopic, usTopicLength );
+                    pxNode = &( pxSubscriptionManager->xNodes[ usNode ] );
 
-                    /* Find a free entry in the subscription manager. */
-                    for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
+                    /* A subscription already stored for the same topic
+                     * filter is replaced and so does not need a new
+                     * entry. */
+                    if( ( pxNode->ucFlags & mqttSUBSCRIPTION_NODE_SUBSCRIBED ) != ( uint8_t ) 0 )
                     {
-                        if( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xInUse == eMQTTFalse )
-                        {
-                            /* Found a free entry. Mark it as used and
-                             * store the subscription. */
-                            pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xInUse = eMQTTTrue;
-
-                            /* Store the subscription. */
-                            memcpy( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].ucTopicFilter,
-                                    pucTopic,
-                                    usTopicLength );
-                            pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].usTopicFilterLength = usTopicLength;
-                            pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].pvPublishCallbackContext = pvPublishCallbackContext;
-                            pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].pxPublishCallback = pxPublishCallback;
-                            pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xTopicFilterType = xTopicFilterType;
-
-                            /* Increase the in-use subscription entries count. */
-                            pxMQTTContext->xSubscriptionManager.ulInUseSubscriptions += ( uint32_t ) 1;
-
-                            /* Inform the user that the subscription was stored
-                             * successfully. */
-                            xSubscriptionStored = eMQTTTrue;
-
-                            /* Done. */
-                            break;
-                        }
+                        xSubscriptionStored = eMQTTTrue;
+                    }
+                    else if( pxSubscriptionManager->ulInUseSubscriptions < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS )
+                    {
+                        /* Mark the node as storing a subscription and
+                         * increase the in-use subscription entries count. */
+                        pxNode->ucFlags |= mqttSUBSCRIPTION_NODE_SUBSCRIBED;
+                        pxSubscriptionManager->ulInUseSubscriptions += ( uint32_t ) 1;
+                        xSubscriptionStored = eMQTTTrue;
+                    }
+                    else
+                    {
+                        /* Subscription Manager full. Free the nodes which
+                         * may just have been created. */
+                        prvPruneSubscriptionNodes( pxSubscriptionManager, usNode );
+                        mqttconfigDEBUG_LOG( ( "WARN: Subscription Manager full! No space left to store new subscriptions.\r\n" ) );
+                    }
+
+                    if( xSubscriptionStored == eMQTTTrue )
+                    {
+                        /* Store the subscription. */
+                        pxNode->pvPublishCallbackContext = pvPublishCallbackContext;
+                        pxNode->pxPublishCallback = pxPublishCallback;
                     }
                 }
                 else
                 {
-                    /* The provided topic filter is invalid. */
-                    mqttconfigDEBUG_LOG( ( "WARN: The topic filter is invalid.\r\n" ) );
+                    /* No node or level arena space left. */
+                    mqttconfigDEBUG_LOG( ( "WARN: Subscription Manager full! Consider increasing mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES or mqttconfigSUBSCRIPTION_MANAGER_LEVEL_ARENA_SIZE.\r\n" ) );
                 }
             }
             else
             {
-                /* Topic too long. */
-                mqttconfigDEBUG_LOG( ( "WARN: Topic is too long and cannot be stored in the subscription manager. Consider increasing mqttconfigSUBSCRIPTION_MANAGER_MAX_TOPIC_LENGTH.\r\n" ) );
+                /* The provided topic filter is invalid. */
+                mqttconfigDEBUG_LOG( ( "WARN: The topic filter is invalid.\r\n" ) );
             }
         }
         else
         {
-            /* Subscription Manager full. */
-            mqttconfigDEBUG_LOG( ( "WARN: Subscription Manager full! No space left to store new subscriptions.\r\n" ) );
+            /* Topic too long. */
+            mqttconfigDEBUG_LOG( ( "WARN: Topic is too long and cannot be stored in the subscription manager. Consider increasing mqttconfigSUBSCRIPTION_MANAGER_MAX_TOPIC_LENGTH.\r\n" ) );
         }
 
         return xSubscriptionStored;
@@ -2065,28 +2368,32 @@ static uint8_t prvDecodeRemainingLength( const uint8_t * const pucEncodedRemaini
                                        const uint8_t * const pucTopic,
                                        uint16_t usTopicLength )
     {
-        uint32_t x;
+        MQTTSubscriptionManager_t * pxSubscriptionManager = &( pxMQTTContext->xSubscriptionManager );
+        MQTTSubscriptionNode_t * pxNode;
+        uint16_t usNode;
 
-        /* Iterate over all the subscription entries in
-         * the subscription manager and try to find the
-         * matching one. */
-        for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
-        {
-            if( ( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xInUse == eMQTTTrue ) &&
-                ( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].usTopicFilterLength == usTopicLength ) )
-            {
-                if( memcmp( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].ucTopicFilter, pucTopic, usTopicLength ) == 0 )
-                {
-                    /* Found a matching subscription, mark it as free. */
-                    pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xInUse = eMQTTFalse;
+        /* Find the node for the last level of the topic
+         * filter without creating any node. */
+        usNode = prvFindSubscriptionNode( pxSubscriptionManager, pucTopic, usTopicLength, eMQTTFalse );
 
-                    /* Reduce the count of in-use subscription entries
-                     * in the subscription manager. */
-                    pxMQTTContext->xSubscriptionManager.ulInUseSubscriptions -= ( uint32_t ) 1;
+        if( usNode != mqttSUBSCRIPTION_NODE_NONE )
+        {
+            pxNode = &( pxSubscriptionManager->xNodes[ usNode ] );
 
-                    /* Done. */
-                    break;
-                }
+            if( ( pxNode->ucFlags & mqttSUBSCRIPTION_NODE_SUBSCRIBED ) != ( uint8_t ) 0 )
+            {
+                /* Found a matching subscription, remove it. */
+                pxNode->ucFlags &= ( uint8_t ) ~mqttSUBSCRIPTION_NODE_SUBSCRIBED;
+                pxNode->pvPublishCallbackContext = NULL;
+                pxNode->pxPublishCallback = NULL;
+
+                /* Reduce the count of in-use subscription entries
+                 * in the subscription manager. */
+                pxSubscriptionManager->ulInUseSubscriptions -= ( uint32_t ) 1;
+
+                /* Free the nodes which are no longer part of any
+                 * stored topic filter. */
+                prvPruneSubscriptionNodes( pxSubscriptionManager, usNode );
             }
         }
     }
@@ -2135,89 +2442,142 @@ static uint8_t prvDecodeRemainingLength( const uint8_t * const pucEncodedRemaini
                                                       const MQTTPublishData_t * pxPublishData,
                                                       MQTTBool_t * pxSubscriptionCallbackInvoked )
     {
+        const MQTTSubscriptionManager_t * pxSubscriptionManager = &( pxMQTTContext->xSubscriptionManager );
+        const MQTTSubscriptionNode_t * pxNodes = pxSubscriptionManager->xNodes;
+        const uint8_t * pucTopic = pxPublishData->pucTopic;
+        uint16_t usTopicLength = pxPublishData->usTopicLength;
         MQTTBool_t xBufferOwnershipTaken = eMQTTFalse;
-        MQTTSubscription_t * pxSubscription;
-        uint32_t x;
+        uint32_t ulLevelStart, ulLevelEnd, ulSingleLevelWildCards;
+        uint16_t usNode, usNextNode;
 
         /* Set the output parameter to eMQTTFalse. It will
          * be set to eMQTTTrue if any callback is invoked. */
         *pxSubscriptionCallbackInvoked = eMQTTFalse;
 
-        /* Iterate over the subscription entries containing topic filters
-         * without any wild-cards and invoke the registered callbacks. */
-        for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
+        /* Follow the topic levels without wild-card to find
+         * the topic filter exactly matching the topic. */
+        usNode = mqttSUBSCRIPTION_NODE_ROOT;
+        ulLevelStart = 0;
+
+        while( ( usNode != mqttSUBSCRIPTION_NODE_NONE ) && ( ulLevelStart <= ( uint32_t ) usTopicLength ) )
         {
-            if( ( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xInUse == eMQTTTrue ) &&
-                ( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xTopicFilterType == eMQTTTopicFilterTypeSimple ) &&
-                ( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].usTopicFilterLength == pxPublishData->usTopicLength ) )
-            {
-                if( memcmp( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].ucTopicFilter, pxPublishData->pucTopic, pxPublishData->usTopicLength ) == 0 )
-                {
-                    /* Found a matching subscription. */
-                    pxSubscription = &( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ] );
+            ulLevelEnd = prvFindTopicLevelEnd( pucTopic, usTopicLength, ulLevelStart );
+            usNode = prvFindLiteralChild( pxSubscriptionManager,
+                                          usNode,
+                                          &( pucTopic[ ulLevelStart ] ),
+                                          ( uint16_t ) ( ulLevelEnd - ulLevelStart ) );
+            ulLevelStart = ulLevelEnd + ( uint32_t ) 1;
+        }
 
-                    /* If a callback is registered with the subscription,
-                     * invoke it. */
-                    if( pxSubscription->pxPublishCallback != NULL )
-                    {
-                        /* Note that a callback was invoked. */
-                        *pxSubscriptionCallbackInvoked = eMQTTTrue;
-
-                        /* Invoke callback. */
-                        xBufferOwnershipTaken = pxSubscription->pxPublishCallback( pxSubscription->pvPublishCallbackContext, pxPublishData );
-
-                        /* If the user takes the buffer ownership, do
-                         * not invoke any other callbacks. */
-                        if( xBufferOwnershipTaken == eMQTTTrue )
-                        {
-                            break;
-                        }
-                    }
-                }
-            }
+        if( usNode != mqttSUBSCRIPTION_NODE_NONE )
+        {
+            xBufferOwnershipTaken = prvInvokeSubscriptionNodeCallback( &( pxNodes[ usNode ] ),
+                                                                       pxPublishData,
+                                                                       pxSubscriptionCallbackInvoked );
         }
 
         /* If the user has not taken the buffer ownership yet (which can
          * happen if there is no exact matching entry in the subscription
          * manager or the user does not take the ownership in the callback),
-         * iterate over the subscription entries containing topic filters
-         * with wild-cards and invoke the registered callbacks for the ones
-         * which match the topic. */
-        if( xBufferOwnershipTaken == eMQTTFalse )
+         * visit every path of the tree which matches the topic and invoke
+         * the callbacks of the topic filters with wild-cards. The visit is
+         * depth first and uses the parent links to backtrack so that it
+         * does not need any stack. ulLevelStart is the start of the topic
+         * level to match against the children of usNode and is beyond the
+         * end of the topic once all the topic levels are matched. */
+        usNode = mqttSUBSCRIPTION_NODE_ROOT;
+        ulLevelStart = 0;
+        ulLevelEnd = 0;
+        ulSingleLevelWildCards = 0;
+
+        while( xBufferOwnershipTaken == eMQTTFalse )
         {
-            for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
+            /* '#' matches all the remaining topic levels, including
+             * none as it includes the parent level. */
+            if( pxNodes[ usNode ].usMultiLevelChild != mqttSUBSCRIPTION_NODE_NONE )
             {
-                if( ( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xInUse == eMQTTTrue ) &&
-                    ( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xTopicFilterType == eMQTTTopicFilterTypeWildCard ) )
+                xBufferOwnershipTaken = prvInvokeSubscriptionNodeCallback( &( pxNodes[ pxNodes[ usNode ].usMultiLevelChild ] ),
+                                                                           pxPublishData,
+                                                                           pxSubscriptionCallbackInvoked );
+
+                if( xBufferOwnershipTaken == eMQTTTrue )
                 {
-                    if( prvDoesTopicMatchTopicFilter( pxPublishData->pucTopic,
-                                                      pxPublishData->usTopicLength,
-                                                      pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].ucTopicFilter,
-                                                      pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].usTopicFilterLength ) == eMQTTTrue )
-                    {
-                        /* Found a matching subscription. */
-                        pxSubscription = &( pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ] );
-
-                        /* If a callback is registered with the subscription,
-                         * invoke it. */
-                        if( pxSubscription->pxPublishCallback != NULL )
-                        {
-                            /* Note that a callback was invoked. */
-                            *pxSubscriptionCallbackInvoked = eMQTTTrue;
-
-                            /* Invoke callback. */
-                            xBufferOwnershipTaken = pxSubscription->pxPublishCallback( pxSubscription->pvPublishCallbackContext, pxPublishData );
-
-                            /* If the user takes the buffer ownership, do
-                             * not invoke any other callbacks. */
-                            if( xBufferOwnershipTaken == eMQTTTrue )
-                            {
-                                break;
-                            }
-                        }
-                    }
+                    break;
+                }
+            }
+
+            if( ulLevelStart > ( uint32_t ) usTopicLength )
+            {
+                /* All the topic levels are matched. The topic filter
+                 * without wild-cards was handled above. */
+                if( ulSingleLevelWildCards > ( uint32_t ) 0 )
+                {
+                    xBufferOwnershipTaken = prvInvokeSubscriptionNodeCallback( &( pxNodes[ usNode ] ),
+                                                                               pxPublishData,
+                                                                               pxSubscriptionCallbackInvoked );
+                }
+
+                usNextNode = mqttSUBSCRIPTION_NODE_NONE;
+            }
+            else
+            {
+                /* Try the topic level without wild-card first and then
+                 * the '+' wild-card. */
+                ulLevelEnd = prvFindTopicLevelEnd( pucTopic, usTopicLength, ulLevelStart );
+                usNextNode = prvFindLiteralChild( pxSubscriptionManager,
+                                                  usNode,
+                                                  &( pucTopic[ ulLevelStart ] ),
+                                                  ( uint16_t ) ( ulLevelEnd - ulLevelStart ) );
+
+                if( usNextNode == mqttSUBSCRIPTION_NODE_NONE )
+                {
+                    usNextNode = pxNodes[ usNode ].usSingleLevelChild;
                 }
             }
+
+            /* Backtrack until a node with an untried alternative
+             * is found. */
+            while( ( xBufferOwnershipTaken == eMQTTFalse ) &&
+                   ( usNextNode == mqttSUBSCRIPTION_NODE_NONE ) &&
+                   ( usNode != mqttSUBSCRIPTION_NODE_ROOT ) )
+            {
+                /* Find the topic level matched by usNode. */
+                ulLevelEnd = ulLevelStart - ( uint32_t ) 1;
+                ulLevelStart = ulLevelEnd;
+
+                while( ( ulLevelStart > ( uint32_t ) 0 ) && ( pucTopic[ ulLevelStart - ( uint32_t ) 1 ] != ( uint8_t ) '/' ) )
+                {
+                    ulLevelStart--;
+                }
+
+                /* Only the '+' wild-card remains to be tried after a
+                 * topic level without wild-card. */
+                if( ( pxNodes[ usNode ].ucFlags & mqttSUBSCRIPTION_NODE_TYPE_MASK ) == mqttSUBSCRIPTION_NODE_SINGLE_LEVEL )
+                {
+                    ulSingleLevelWildCards--;
+                }
+                else
+                {
+                    usNextNode = pxNodes[ pxNodes[ usNode ].usParent ].usSingleLevelChild;
+                }
+
+                usNode = pxNodes[ usNode ].usParent;
+            }
+
+            if( usNextNode == mqttSUBSCRIPTION_NODE_NONE )
+            {
+                /* Every matching path is visited. */
+                break;
+            }
+
+            /* Move to the next topic level. */
+            if( ( pxNodes[ usNextNode ].ucFlags & mqttSUBSCRIPTION_NODE_TYPE_MASK ) == mqttSUBSCRIPTION_NODE_SINGLE_LEVEL )
+            {
+                ulSingleLevelWildCards++;
+            }
+
+            usNode = usNextNode;
+            ulLevelStart = ulLevelEnd + ( uint32_t ) 1;
         }
 
         /* Return whether or not the user has taken the
@@ -2322,99 +2682,384 @@ static uint8_t prvDecodeRemainingLength( const uint8_t * const pucEncodedRemaini
 
 #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
 
-    static MQTTBool_t prvDoesTopicMatchTopicFilter( const uint8_t * const pucTopic,
-                                                    uint16_t usTopicLength,
-                                                    const uint8_t * const pucTopicFilter,
-                                                    uint16_t usTopicFilterLength )
+    static void prvInitSubscriptionManager( MQTTSubscriptionManager_t * pxSubscriptionManager )
+    {
+        MQTTSubscriptionNode_t * pxNode;
+        uint32_t x;
+
+        /* Chain all the nodes into the free list. The root node is
+         * reinitialized below. */
+        for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES; x++ )
+        {
+            pxNode = &( pxSubscriptionManager->xNodes[ x ] );
+
+            pxNode->pvPublishCallbackContext = NULL;
+            pxNode->pxPublishCallback = NULL;
+            pxNode->usParent = mqttSUBSCRIPTION_NODE_NONE;
+            pxNode->usNextInBucket = ( uint16_t ) ( x + ( uint32_t ) 1 );
+            pxNode->usLiteralChildren = 0;
+            pxNode->usSingleLevelChild = mqttSUBSCRIPTION_NODE_NONE;
+            pxNode->usMultiLevelChild = mqttSUBSCRIPTION_NODE_NONE;
+            pxNode->usLevelOffset = 0;
+            pxNode->usLevelLength = 0;
+            pxNode->ucLevelHash = 0;
+            pxNode->ucFlags = 0;
+        }
+
+        pxSubscriptionManager->xNodes[ mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES - 1 ].usNextInBucket = mqttSUBSCRIPTION_NODE_NONE;
+
+        /* The root node is always in use. */
+        pxSubscriptionManager->xNodes[ mqttSUBSCRIPTION_NODE_ROOT ].usNextInBucket = mqttSUBSCRIPTION_NODE_NONE;
+        pxSubscriptionManager->xNodes[ mqttSUBSCRIPTION_NODE_ROOT ].ucFlags = mqttSUBSCRIPTION_NODE_LITERAL;
+
+        #if ( mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES > 1 )
+            pxSubscriptionManager->usFreeNode = ( uint16_t ) 1;
+        #else
+            pxSubscriptionManager->usFreeNode = mqttSUBSCRIPTION_NODE_NONE;
+        #endif
+
+        for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_LITERAL_BUCKETS; x++ )
+        {
+            pxSubscriptionManager->usLiteralBuckets[ x ] = mqttSUBSCRIPTION_NODE_NONE;
+        }
+
+        pxSubscriptionManager->usLevelArenaUsed = 0;
+        pxSubscriptionManager->ulInUseSubscriptions = 0;
+    }
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+/*-----------------------------------------------------------*/
+
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint32_t prvHashTopicLevel( const uint8_t * const pucLevel,
+                                       uint16_t usLevelLength )
+    {
+        uint32_t ulHash = ( uint32_t ) usLevelLength;
+        uint16_t x;
+
+        for( x = 0; x < usLevelLength; x++ )
+        {
+            ulHash = ( ulHash * ( uint32_t ) 31 ) + ( uint32_t ) pucLevel[ x ];
+        }
+
+        return ulHash;
+    }
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+/*-----------------------------------------------------------*/
+
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint16_t prvLiteralBucket( uint16_t usParent,
+                                      uint32_t ulLevelHash )
+    {
+        /* Mix in the parent so that the same name below different
+         * parents, e.g. "shadow" below each thing, lands in different
+         * buckets. */
+        return ( uint16_t ) ( ( ulLevelHash + ( ( uint32_t ) usParent * ( uint32_t ) 0x9E3779B1UL ) ) %
+                              ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_LITERAL_BUCKETS );
+    }
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+/*-----------------------------------------------------------*/
+
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint32_t prvFindTopicLevelEnd( const uint8_t * const pucTopic,
+                                          uint16_t usTopicLength,
+                                          uint32_t ulLevelStart )
+    {
+        uint32_t ulLevelEnd = ulLevelStart;
+
+        while( ( ulLevelEnd < ( uint32_t ) usTopicLength ) && ( pucTopic[ ulLevelEnd ] != ( uint8_t ) '/' ) )
+        {
+            ulLevelEnd++;
+        }
+
+        return ulLevelEnd;
+    }
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+/*-----------------------------------------------------------*/
+
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint16_t prvFindLiteralChild( const MQTTSubscriptionManager_t * const pxSubscriptionManager,
+                                         uint16_t usParent,
+                                         const uint8_t * const pucLevel,
+                                         uint16_t usLevelLength )
     {
-        MQTTBool_t xTopicMatchesTopicFilter = eMQTTFalse;
-        uint16_t usTopicIndex = 0, usTopicFilterIndex = 0;
+        const MQTTSubscriptionNode_t * pxChild;
+        uint16_t usChild;
+        uint32_t ulLevelHash = prvHashTopicLevel( pucLevel, usLevelLength );
+
+        /* The bucket also holds literal levels of other parents. Only
+         * the nodes with the same parent, hash and length need a full
+         * comparison. */
+        for( usChild = pxSubscriptionManager->usLiteralBuckets[ prvLiteralBucket( usParent, ulLevelHash ) ];
+             usChild != mqttSUBSCRIPTION_NODE_NONE;
+             usChild = pxChild->usNextInBucket )
+        {
+            pxChild = &( pxSubscriptionManager->xNodes[ usChild ] );
+
+            if( ( pxChild->usParent == usParent ) &&
+                ( pxChild->ucLevelHash == ( uint8_t ) ulLevelHash ) &&
+                ( pxChild->usLevelLength == usLevelLength ) &&
+                ( memcmp( &( pxSubscriptionManager->ucLevelArena[ pxChild->usLevelOffset ] ), pucLevel, usLevelLength ) == 0 ) )
+            {
+                break;
+            }
+        }
 
-        while( ( usTopicIndex < usTopicLength ) && ( usTopicFilterIndex < usTopicFilterLength ) )
+        return usChild;
+    }
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+/*-----------------------------------------------------------*/
+
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint16_t prvAllocateSubscriptionNode( MQTTSubscriptionManager_t * pxSubscriptionManager,
+                                                 uint16_t usParent,
+                                                 uint8_t ucNodeType,
+                                                 const uint8_t * const pucLevel,
+                                                 uint16_t usLevelLength )
+    {
+        MQTTSubscriptionNode_t * pxParent = &( pxSubscriptionManager->xNodes[ usParent ] );
+        MQTTSubscriptionNode_t * pxNode;
+        uint16_t usNode = pxSubscriptionManager->usFreeNode, usBucket;
+        uint32_t ulLevelHash;
+
+        /* Names of wild-card levels are not stored. */
+        if( ucNodeType != mqttSUBSCRIPTION_NODE_LITERAL )
+        {
+            usLevelLength = 0;
+        }
+
+        if( ( usNode != mqttSUBSCRIPTION_NODE_NONE ) &&
+            ( ( ( uint32_t ) pxSubscriptionManager->usLevelArenaUsed + ( uint32_t ) usLevelLength ) <= ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_LEVEL_ARENA_SIZE ) )
         {
-            /* Does the character in the topic string matches the
-             * corresponding one in the topic filter string? */
-            if( pucTopic[ usTopicIndex ] == pucTopicFilter[ usTopicFilterIndex ] )
+            pxNode = &( pxSubscriptionManager->xNodes[ usNode ] );
+            pxSubscriptionManager->usFreeNode = pxNode->usNextInBucket;
+
+            /* Copy the name of the topic level to the end of
+             * the level arena. */
+            pxNode->usLevelOffset = pxSubscriptionManager->usLevelArenaUsed;
+            pxNode->usLevelLength = usLevelLength;
+            ulLevelHash = prvHashTopicLevel( pucLevel, usLevelLength );
+            pxNode->ucLevelHash = ( uint8_t ) ulLevelHash;
+            memcpy( &( pxSubscriptionManager->ucLevelArena[ pxNode->usLevelOffset ] ), pucLevel, usLevelLength );
+            pxSubscriptionManager->usLevelArenaUsed += usLevelLength;
+
+            pxNode->pvPublishCallbackContext = NULL;
+            pxNode->pxPublishCallback = NULL;
+            pxNode->usParent = usParent;
+            pxNode->usNextInBucket = mqttSUBSCRIPTION_NODE_NONE;
+            pxNode->usLiteralChildren = 0;
+            pxNode->usSingleLevelChild = mqttSUBSCRIPTION_NODE_NONE;
+            pxNode->usMultiLevelChild = mqttSUBSCRIPTION_NODE_NONE;
+            pxNode->ucFlags = ucNodeType;
+
+            /* Link the node to its parent. */
+            if( ucNodeType == mqttSUBSCRIPTION_NODE_SINGLE_LEVEL )
             {
-                /* Handle special corner cases as documented by
-                 * the MQTT protocol spec. */
-
-                /* Filter of type "sport/#" also matches the singular
-                 * "sport" since # includes the parent level. */
-                if( ( usTopicIndex == usTopicLength - ( uint16_t ) 1 ) &&
-                    ( usTopicFilterIndex == usTopicFilterLength - ( uint16_t ) 3 ) &&
-                    ( pucTopicFilter[ usTopicFilterIndex + ( uint16_t ) 1 ] == ( uint8_t ) '/' ) &&
-                    ( pucTopicFilter[ usTopicFilterIndex + ( uint16_t ) 2 ] == ( uint8_t ) '#' ) )
-                {
-                    xTopicMatchesTopicFilter = eMQTTTrue;
-                    break;
-                }
+                pxParent->usSingleLevelChild = usNode;
+            }
+            else if( ucNodeType == mqttSUBSCRIPTION_NODE_MULTI_LEVEL )
+            {
+                pxParent->usMultiLevelChild = usNode;
+            }
+            else
+            {
+                usBucket = prvLiteralBucket( usParent, ulLevelHash );
+                pxNode->usNextInBucket = pxSubscriptionManager->usLiteralBuckets[ usBucket ];
+                pxSubscriptionManager->usLiteralBuckets[ usBucket ] = usNode;
+                pxParent->usLiteralChildren++;
+            }
+        }
+        else
+        {
+            usNode = mqttSUBSCRIPTION_NODE_NONE;
+        }
+
+        return usNode;
+    }
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+/*-----------------------------------------------------------*/
 
-                /* Filter of type "sport/+" also matches the "sport/"
-                 * but not "sport". */
-                if( ( usTopicIndex == usTopicLength - ( uint16_t ) 1 ) &&
-                    ( usTopicFilterIndex == usTopicFilterLength - ( uint16_t ) 2 ) &&
-                    ( pucTopicFilter[ usTopicFilterIndex + ( uint16_t ) 1 ] == ( uint8_t ) '+' ) )
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static void prvPruneSubscriptionNodes( MQTTSubscriptionManager_t * pxSubscriptionManager,
+                                           uint16_t usNode )
+    {
+        MQTTSubscriptionNode_t * pxNode, * pxParent;
+        uint16_t usParent, usLevelOffset, usLevelLength, usBucket, * pusLink;
+        uint32_t x;
+
+        while( usNode != mqttSUBSCRIPTION_NODE_ROOT )
+        {
+            pxNode = &( pxSubscriptionManager->xNodes[ usNode ] );
+
+            /* Stop at the first node which is still needed. */
+            if( ( ( pxNode->ucFlags & mqttSUBSCRIPTION_NODE_SUBSCRIBED ) != ( uint8_t ) 0 ) ||
+                ( pxNode->usLiteralChildren != ( uint16_t ) 0 ) ||
+                ( pxNode->usSingleLevelChild != mqttSUBSCRIPTION_NODE_NONE ) ||
+                ( pxNode->usMultiLevelChild != mqttSUBSCRIPTION_NODE_NONE ) )
+            {
+                break;
+            }
+
+            usParent = pxNode->usParent;
+            pxParent = &( pxSubscriptionManager->xNodes[ usParent ] );
+
+            /* Unlink the node from its parent. */
+            if( pxParent->usSingleLevelChild == usNode )
+            {
+                pxParent->usSingleLevelChild = mqttSUBSCRIPTION_NODE_NONE;
+            }
+            else if( pxParent->usMultiLevelChild == usNode )
+            {
+                pxParent->usMultiLevelChild = mqttSUBSCRIPTION_NODE_NONE;
+            }
+            else
+            {
+                usBucket = prvLiteralBucket( usParent,
+                                             prvHashTopicLevel( &( pxSubscriptionManager->ucLevelArena[ pxNode->usLevelOffset ] ),
+                                                                pxNode->usLevelLength ) );
+                pusLink = &( pxSubscriptionManager->usLiteralBuckets[ usBucket ] );
+
+                while( *pusLink != usNode )
                 {
-                    xTopicMatchesTopicFilter = eMQTTTrue;
-                    break;
+                    pusLink = &( pxSubscriptionManager->xNodes[ *pusLink ].usNextInBucket );
                 }
+
+                *pusLink = pxNode->usNextInBucket;
+                pxParent->usLiteralChildren--;
             }
-            else
+
+            /* Remove the name of the topic level from the level arena
+             * and move down the names stored after it. */
+            usLevelOffset = pxNode->usLevelOffset;
+            usLevelLength = pxNode->usLevelLength;
+
+            if( usLevelLength > ( uint16_t ) 0 )
             {
-                if( pucTopicFilter[ usTopicFilterIndex ] == ( uint8_t ) '+' )
+                memmove( &( pxSubscriptionManager->ucLevelArena[ usLevelOffset ] ),
+                         &( pxSubscriptionManager->ucLevelArena[ usLevelOffset + usLevelLength ] ),
+                         ( size_t ) ( pxSubscriptionManager->usLevelArenaUsed - ( usLevelOffset + usLevelLength ) ) );
+                pxSubscriptionManager->usLevelArenaUsed -= usLevelLength;
+
+                for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_NODES; x++ )
                 {
-                    /* Consume the current topic level which is until
-                     * we encounter '/' in the topic string or the end
-                     * of the topic string. */
-                    while( usTopicIndex < usTopicLength && pucTopic[ usTopicIndex ] != ( uint8_t ) '/' )
+                    if( ( pxSubscriptionManager->xNodes[ x ].ucFlags != ( uint8_t ) 0 ) &&
+                        ( pxSubscriptionManager->xNodes[ x ].usLevelOffset > usLevelOffset ) )
                     {
-                        usTopicIndex++;
+                        pxSubscriptionManager->xNodes[ x ].usLevelOffset -= usLevelLength;
                     }
-
-                    /* Since we are already at the '/' character or at
-                     * the end in the topic string, increment the topic
-                     * filter index here and skip the index increments
-                     * at the end of the loop. */
-                    usTopicFilterIndex++;
-                    continue;
                 }
-                else if( pucTopicFilter[ usTopicFilterIndex ] == ( uint8_t ) '#' )
-                {
-                    /* Since it is assumed that the given topic filter
-                     * is a valid topic filter, this must be the last
-                     * character in it. The rest of the topic string
-                     * matches this multi-level wild-card and hence this
-                     * is a match. */
-                    xTopicMatchesTopicFilter = eMQTTTrue;
-                    break;
-                }
-                else
+            }
+
+            /* Return the node to the free list. */
+            pxNode->ucFlags = 0;
+            pxNode->usParent = mqttSUBSCRIPTION_NODE_NONE;
+            pxNode->usNextInBucket = pxSubscriptionManager->usFreeNode;
+            pxSubscriptionManager->usFreeNode = usNode;
+
+            usNode = usParent;
+        }
+    }
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+/*-----------------------------------------------------------*/
+
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static uint16_t prvFindSubscriptionNode( MQTTSubscriptionManager_t * pxSubscriptionManager,
+                                             const uint8_t * const pucTopicFilter,
+                                             uint16_t usTopicFilterLength,
+                                             MQTTBool_t xCreate )
+    {
+        uint16_t usNode = mqttSUBSCRIPTION_NODE_ROOT, usChild, usLevelLength;
+        uint32_t ulLevelStart = 0, ulLevelEnd;
+        uint8_t ucNodeType;
+
+        /* Walk the tree one topic level of the topic filter at a time. */
+        while( ulLevelStart <= ( uint32_t ) usTopicFilterLength )
+        {
+            ulLevelEnd = prvFindTopicLevelEnd( pucTopicFilter, usTopicFilterLength, ulLevelStart );
+            usLevelLength = ( uint16_t ) ( ulLevelEnd - ulLevelStart );
+
+            if( ( usLevelLength == ( uint16_t ) 1 ) && ( pucTopicFilter[ ulLevelStart ] == ( uint8_t ) '+' ) )
+            {
+                ucNodeType = mqttSUBSCRIPTION_NODE_SINGLE_LEVEL;
+                usChild = pxSubscriptionManager->xNodes[ usNode ].usSingleLevelChild;
+            }
+            else if( ( usLevelLength == ( uint16_t ) 1 ) && ( pucTopicFilter[ ulLevelStart ] == ( uint8_t ) '#' ) )
+            {
+                ucNodeType = mqttSUBSCRIPTION_NODE_MULTI_LEVEL;
+                usChild = pxSubscriptionManager->xNodes[ usNode ].usMultiLevelChild;
+            }
+            else
+            {
+                ucNodeType = mqttSUBSCRIPTION_NODE_LITERAL;
+                usChild = prvFindLiteralChild( pxSubscriptionManager, usNode, &( pucTopicFilter[ ulLevelStart ] ), usLevelLength );
+            }
+
+            if( ( usChild == mqttSUBSCRIPTION_NODE_NONE ) && ( xCreate == eMQTTTrue ) )
+            {
+                usChild = prvAllocateSubscriptionNode( pxSubscriptionManager,
+                                                       usNode,
+                                                       ucNodeType,
+                                                       &( pucTopicFilter[ ulLevelStart ] ),
+                                                       usLevelLength );
+
+                if( usChild == mqttSUBSCRIPTION_NODE_NONE )
                 {
-                    /* Any character mismatch other than '+' or
-                     * '#' means the topic does not match the
-                     * given filter. */
-                    break;
+                    /* Free the nodes created for the previous
+                     * topic levels. */
+                    prvPruneSubscriptionNodes( pxSubscriptionManager, usNode );
                 }
             }
 
-            /* Increment indexes. */
-            usTopicIndex++;
-            usTopicFilterIndex++;
+            if( usChild == mqttSUBSCRIPTION_NODE_NONE )
+            {
+                usNode = mqttSUBSCRIPTION_NODE_NONE;
+                break;
+            }
+
+            usNode = usChild;
+            ulLevelStart = ulLevelEnd + ( uint32_t ) 1;
         }
 
-        /* If the topic is not matched yet and both topic
-         * and topic filter strings are consumed, it's a match
-         * else we would have broken the loop in between.*/
-        if( ( xTopicMatchesTopicFilter == eMQTTFalse ) &&
-            ( ( usTopicIndex > ( uint16_t ) 0 ) && ( usTopicIndex >= usTopicLength ) ) &&
-            ( ( usTopicFilterIndex > ( uint16_t ) 0 ) && ( usTopicFilterIndex >= usTopicFilterLength ) ) )
+        return usNode;
+    }
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+/*-----------------------------------------------------------*/
+
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    static MQTTBool_t prvInvokeSubscriptionNodeCallback( const MQTTSubscriptionNode_t * const pxNode,
+                                                         const MQTTPublishData_t * pxPublishData,
+                                                         MQTTBool_t * pxSubscriptionCallbackInvoked )
+    {
+        MQTTBool_t xBufferOwnershipTaken = eMQTTFalse;
+
+        /* If a subscription with a callback is stored on
+         * the node, invoke it. */
+        if( ( ( pxNode->ucFlags & mqttSUBSCRIPTION_NODE_SUBSCRIBED ) != ( uint8_t ) 0 ) &&
+            ( pxNode->pxPublishCallback != NULL ) )
         {
-            xTopicMatchesTopicFilter = eMQTTTrue;
+            /* Note that a callback was invoked. */
+            *pxSubscriptionCallbackInvoked = eMQTTTrue;
+
+            /* Invoke callback. */
+            xBufferOwnershipTaken = pxNode->pxPublishCallback( pxNode->pvPublishCallbackContext, pxPublishData );
         }
 
-        /* Return the result. */
-        return xTopicMatchesTopicFilter;
+        return xBufferOwnershipTaken;
     }
 
 #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
@@ -2423,10 +3068,6 @@ static uint8_t prvDecodeRemainingLength( const uint8_t * const pucEncodedRemaini
 MQTTReturnCode_t MQTT_Init( MQTTContext_t * pxMQTTContext,
                             const MQTTInitParams_t * const pxInitParams )
 {
-    #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
-        uint32_t x;
-    #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
-
     /* These are checked here once and are later used without
      * NULL checks. */
     mqttconfigASSERT( pxMQTTContext != NULL );
@@ -2460,15 +3101,9 @@ MQTTReturnCode_t MQTT_Init( MQTTContext_t * pxMQTTContext,
 
     #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
 
-        /* Mark all the subscription entires in the subscription
-         * manager as free. */
-        for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
-        {
-            pxMQTTContext->xSubscriptionManager.xSubscriptions[ x ].xInUse = eMQTTFalse;
-        }
-
-        /* Set the number of in-use subscription entries to zero. */
-        pxMQTTContext->xSubscriptionManager.ulInUseSubscriptions = 0;
+        /* Remove all the subscriptions from the subscription
+         * manager. */
+        prvInitSubscriptionManager( &( pxMQTTContext->xSubscriptionManager ) );
     #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
 
     return eMQTTSuccess;
@@ -2518,6 +3153,7 @@ MQTTReturnCode_t MQTT_Connect( MQTTContext_t * pxMQTTContext,
         /* Store keep alive actual interval and timeout. */
         pxMQTTContext->ulKeepAliveActualIntervalTicks = pxConnectParams->ulKeepAliveActualIntervalTicks;
         pxMQTTContext->ulPingRequestTimeoutTicks = pxConnectParams->ulPingRequestTimeoutTicks;
+        pxMQTTContext->ulKeepAliveMaxIdleTicks = pxConnectParams->ulKeepAliveMaxIdleTicks;
 
         /* Client ID and username length. */
         usClientIdLength = mqttSTRLEN( pxConnectParams->usClientIdLength );
@@ -3101,6 +3737,9 @@ MQTTReturnCode_t MQTT_ParseReceivedData( MQTTContext_t * pxMQTTContext,
     MQTTReturnCode_t xReturnCode = eMQTTSuccess;
     MQTTEventCallbackParams_t xEventCallbackParams;
     size_t xProcessedBytes = 0, xExpectedBytes, xUnprocessedBytes;
+    MQTTBool_t xPublishInPlace = eMQTTFalse;
+    uint8_t ucRemainingLengthFieldBytes = 0;
+    uint32_t ulTotalMessageLength = 0;
 
     /* These are checked here once and are later used without
      * NULL checks. */
@@ -3125,7 +3764,37 @@ MQTTReturnCode_t MQTT_ParseReceivedData( MQTTContext_t * pxMQTTContext,
             break;
         }
 
-        if( pxMQTTContext->xRxMessageState.xRxNextByte == eMQTTRxNextBytePacketType )
+        #if ( mqttconfigENABLE_ZERO_COPY_PUBLISH == 1 )
+            {
+                /* A publish message which is completely contained in the
+                 * received data is parsed in place instead of being copied
+                 * to a buffer from the free buffer pool. */
+                if( pxMQTTContext->xRxMessageState.xRxNextByte == eMQTTRxNextBytePacketType )
+                {
+                    xPublishInPlace = prvIsCompletePublish( &( pucReceivedData[ xProcessedBytes ] ),
+                                                            xReceivedDataLength - xProcessedBytes,
+                                                            &( ucRemainingLengthFieldBytes ),
+                                                            &( ulTotalMessageLength ) );
+                }
+            }
+        #endif /* mqttconfigENABLE_ZERO_COPY_PUBLISH */
+
+        if( xPublishInPlace == eMQTTTrue )
+        {
+            mqttconfigDEBUG_LOG( ( "Received publish of %d bytes, parsing in place.\r\n", ulTotalMessageLength ) );
+
+            prvProcessReceivedPublish( pxMQTTContext,
+                                       &( pucReceivedData[ xProcessedBytes ] ),
+                                       ucRemainingLengthFieldBytes,
+                                       ulTotalMessageLength,
+                                       NULL );
+
+            /* The whole message has been consumed, the Rx state is still
+             * waiting for the start of the next message. */
+            xProcessedBytes += ( size_t ) ulTotalMessageLength;
+            xPublishInPlace = eMQTTFalse;
+        }
+        else if( pxMQTTContext->xRxMessageState.xRxNextByte == eMQTTRxNextBytePacketType )
         {
             /* Looking for the start of a new MQTT message, which always begins with
              * one byte containing packet type and related flags. */
@@ -3279,6 +3948,54 @@ MQTTReturnCode_t MQTT_ParseReceivedData( MQTTContext_t * pxMQTTContext,
         }
     }
 
+    /* Any data received from the broker restarts the keep alive interval. */
+    if( xProcessedBytes > ( size_t ) 0 )
+    {
+        prvDeferKeepAlive( pxMQTTContext );
+    }
+
+    return xReturnCode;
+}
+/*-----------------------------------------------------------*/
+
+MQTTReturnCode_t MQTT_ClonePublishData( MQTTContext_t * pxMQTTContext,
+                                        const MQTTPublishData_t * const pxPublishData,
+                                        MQTTPublishData_t * const pxClonedPublishData )
+{
+    MQTTReturnCode_t xReturnCode = eMQTTSuccess;
+    MQTTBufferHandle_t xBuffer;
+    uint8_t * pucData;
+
+    /* These are checked here once and are later used without
+     * NULL checks. */
+    mqttconfigASSERT( pxMQTTContext != NULL );
+    mqttconfigASSERT( pxMQTTContext->xBufferPoolInterface.pxGetBufferFxn != NULL );
+    mqttconfigASSERT( pxMQTTContext->xBufferPoolInterface.pxReturnBufferFxn != NULL );
+    mqttconfigASSERT( pxPublishData != NULL );
+    mqttconfigASSERT( pxClonedPublishData != NULL );
+
+    /* Get a buffer large enough to hold the topic followed by the payload. */
+    xBuffer = prvGetFreeBuffer( pxMQTTContext, ( uint32_t ) pxPublishData->usTopicLength + pxPublishData->ulDataLength );
+
+    if( xBuffer != NULL )
+    {
+        pucData = mqttbufferGET_DATA( xBuffer );
+
+        memcpy( pucData, pxPublishData->pucTopic, ( size_t ) pxPublishData->usTopicLength );
+        memcpy( &( pucData[ pxPublishData->usTopicLength ] ), pxPublishData->pvData, ( size_t ) pxPublishData->ulDataLength );
+        mqttbufferGET_DATA_LENGTH( xBuffer ) = ( uint32_t ) pxPublishData->usTopicLength + pxPublishData->ulDataLength;
+
+        /* Point the copy to the buffer. */
+        *pxClonedPublishData = *pxPublishData;
+        pxClonedPublishData->pucTopic = pucData;
+        pxClonedPublishData->pvData = ( const void * ) &( pucData[ pxPublishData->usTopicLength ] ); /*lint !e9087 Publish data is provided as void* to the user. */
+        pxClonedPublishData->xBuffer = xBuffer;
+    }
+    else
+    {
+        xReturnCode = eMQTTNoFreeBuffer;
+    }
+
     return xReturnCode;
 }
 /*-----------------------------------------------------------*/
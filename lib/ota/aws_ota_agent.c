@@ -32,11 +32,16 @@
 /* OTA agent includes. */
 #include "aws_ota_pal.h"
 #include "aws_ota_agent.h" /*lint !e537 intentional include of all interfaces used by this file. */
+#include "aws_crypto.h"
 #include "event_groups.h"
 #include "aws_clientcredential.h"
 #include "aws_ota_cbor.h"
+#include "aws_ota_decompress.h"
+#include "aws_ota_delta.h"
+#include "aws_ota_write_behind.h"
 #include "aws_application_version.h"
 #include "aws_ota_agent_config.h"
+#include "aws_ota_agent_config_defaults.h"
 
 /* Internal header file for shared definitions. */
 #include "aws_ota_agent_internal.h"
@@ -54,14 +59,15 @@
 /* JSON job document parser includes. */
 #include "jsmn.h" /*lint !e537 All headers have multiple inclusion prevention. */
 #include "mbedtls/base64.h"
+#include "mbedtls/sha256.h"
 
 /* Returns the byte offset of the element 'e' in the typedef structure 't'.
  * Setting an arbitrarily large base of 0x10000 and masking off that base allows
  * us to do the same thing as a zero offset without the lint warnings of using a
  * null pointer. No structure is anywhere near 64K in size.
  * */
-/*lint -emacro((923,9078),OFFSET_OF) Intentionally cast pointer to uint32_t because we are using it as an offset. */
-#define OFFSET_OF( t, e )    ( ( uint32_t ) ( &( ( t * ) 0x10000UL )->e ) & 0xffffUL )
+/*lint -emacro((923,9078),OFFSET_OF) Intentionally cast pointer to an integer because we are using it as an offset. */
+#define OFFSET_OF( t, e )    ( ( uint32_t ) ( ( size_t ) ( &( ( t * ) 0x10000UL )->e ) & 0xffffUL ) )
 
 /* General constants. */
 #define OTA_MAX_JSON_STR_LEN               256U             /* Limit our JSON string compares to something small to avoid going into the weeds. */
@@ -79,13 +85,50 @@
 #define OTA_EVT_MASK_SHUTDOWN              0x00000002UL /* Event flag to request OTA shutdown. */
 #define OTA_EVT_MASK_REQ_TIMEOUT           0x00000004UL /* Event flag indicating the request timer has timed out. */
 #define OTA_EVT_MASK_USER_ABORT            0x00000008UL /* Event flag to indicate user initiated OTA abort. */
-#define OTA_EVT_MASK_ALL_EVENTS            ( OTA_EVT_MASK_MSG_READY | OTA_EVT_MASK_SHUTDOWN | OTA_EVT_MASK_REQ_TIMEOUT | OTA_EVT_MASK_USER_ABORT )
+#define OTA_EVT_MASK_REQ_RANGES            0x00000010UL /* Event flag to request block ranges without waiting for the request timer. */
+#define OTA_EVT_MASK_MSG_RETURNED          0x00000020UL /* Event flag to return a message lent by the MQTT task. Not an event of the OTA task. */
+#define OTA_EVT_MASK_ALL_EVENTS            ( OTA_EVT_MASK_MSG_READY | OTA_EVT_MASK_SHUTDOWN | OTA_EVT_MASK_REQ_TIMEOUT | OTA_EVT_MASK_USER_ABORT | OTA_EVT_MASK_REQ_RANGES )
 
 /* Stream GET message constants. */
 
 #define OTA_CLIENT_TOKEN             "rdy"              /* Arbitrary client token sent in the stream "GET" message. */
 #define OTA_MAX_BLOCK_BITMAP_SIZE    128U               /* Max allowed number of bytes to track all blocks of an OTA file. Adjust block size if more range is needed. */
 #define OTA_REQUEST_MSG_MAX_SIZE     ( 3U * OTA_MAX_BLOCK_BITMAP_SIZE )
+#define OTA_NO_RANGE                 0xffffffffUL       /* First block of a range slot that is not in use. */
+
+/* Stream block size constants. A stream block is the block requested from the stream service. It holds
+ * 2^shift consecutive file blocks, where the block shift is encoded in the client token of the request. */
+
+#define OTA_MAX_BLOCK_SHIFT          ( otaconfigMAX_LOG2_FILE_BLOCK_SIZE - otaconfigLOG2_FILE_BLOCK_SIZE )
+#define OTA_NUM_BLOCK_SIZES          ( OTA_MAX_BLOCK_SHIFT + 1U )
+#define OTA_CLIENT_TOKEN_SIZE        ( sizeof( OTA_CLIENT_TOKEN ) + 1U ) /* The client token, a block shift digit and the terminator. */
+#define OTA_NO_BLOCK_SHIFT           0xffffffffUL       /* Block shift of a client token that isn't one of the agent's. */
+
+#if ( otaconfigMAX_LOG2_FILE_BLOCK_SIZE < otaconfigLOG2_FILE_BLOCK_SIZE ) || ( otaconfigMAX_LOG2_FILE_BLOCK_SIZE > ( otaconfigLOG2_FILE_BLOCK_SIZE + 9U ) )
+    #error "otaconfigMAX_LOG2_FILE_BLOCK_SIZE must be between otaconfigLOG2_FILE_BLOCK_SIZE and otaconfigLOG2_FILE_BLOCK_SIZE + 9."
+#endif
+
+/* File hash reorder buffer constants. */
+
+#define OTA_NO_BLOCK                 0xffffffffUL       /* Block index of a reorder buffer slot that is not in use. */
+#define OTA_HASH_REORDER_SLOTS       ( ( otaconfigHASH_REORDER_BLOCKS > 0U ) ? otaconfigHASH_REORDER_BLOCKS : 1U )
+
+/* Decoded image constants. */
+
+#define OTA_MAX_PAL_WRITE_SIZE       0x4000UL           /* Largest write passed to prvPAL_WriteBlock(), which returns the size written as an int16_t. */
+#define OTA_BASE_HASH_SIZE           32U                /* Size of the SHA-256 hash of the base image of a delta file. */
+
+/* Write-behind buffer constants. */
+
+#if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U ) && ( ( otaconfigWRITE_BEHIND_PAGES < 1U ) || ( otaconfigWRITE_BEHIND_PAGES > OTA_WRITE_BEHIND_MAX_PAGES ) )
+    #error "otaconfigWRITE_BEHIND_PAGES must be between 1 and OTA_WRITE_BEHIND_MAX_PAGES."
+#endif
+
+/* Download checkpoint constants. */
+
+#define OTA_CHECKPOINT_MAGIC         0x4f544143UL       /* Identifies a download checkpoint record ("OTAC"). */
+#define OTA_FNV_OFFSET_BASIS         2166136261UL       /* FNV-1a hash initial value. */
+#define OTA_FNV_PRIME                16777619UL         /* FNV-1a hash multiplier. */
 
 /* Agent to Job Service status message constants. */
 
@@ -94,7 +137,6 @@
 
 /* Job document parser constants. */
 
-#define OTA_MAX_JSON_TOKENS    64U                      /* Number of JSON tokens supported in a single parser call. */
 #define OTA_MAX_TOPIC_LEN      256U                     /* Max length of a dynamically generated topic string (usually on the stack). */
 
 /* When subscribing to MQTT topics with a callback handler, we use the callback
@@ -124,7 +166,7 @@ typedef struct
  * size, attributes, etc. The following value specifies the number of parameters
  * that are included in the job document model although some may be optional. */
 
-#define OTA_NUM_JOB_PARAMS         ( 16 ) /* Number of parameters in the job document. */
+#define OTA_NUM_JOB_PARAMS         ( 17 ) /* Number of parameters in the job document. */
 /* We need the following string to match in a couple places in the code so use a #define. */
 #define OTA_JSON_UPDATED_BY_KEY    "updatedBy"
 
@@ -143,6 +185,7 @@ static const char cOTA_JSON_FileSizeKey[] = "filesize";
 static const char cOTA_JSON_FileIDKey[] = "fileid";
 static const char cOTA_JSON_FileAttributeKey[] = "attr";
 static const char cOTA_JSON_FileCertNameKey[] = "certfile";
+static const char cOTA_JSON_FileBaseHashKey[] = "basehash";
 
 enum
 {
@@ -195,7 +238,11 @@ static const char * pcOTA_JobStatus_Strings[ eNumJobStatusMappings ] =
 #define OTA_DOC_MODEL_MAX_PARAMS    32U                    /* The parameter list is backed by a 32 bit longword bitmap by design. */
 #define OTA_JOB_PARAM_REQUIRED      ( ( bool_t ) pdTRUE )  /* Used to denote a required document model parameter. */
 #define OTA_JOB_PARAM_OPTIONAL      ( ( bool_t ) pdFALSE ) /* Used to denote an optional document model parameter. */
-#define OTA_DONT_STORE_PARAM        0xffffffffUL           /* If ulDestOffset in the model is 0xffffffff, do not store the value. */
+#define OTA_DONT_STORE_PARAM        0xffffffffUL           /* If xDestOffset in the model is 0xffffffff, do not store the value. */
+
+#if ( OTA_DOC_MODEL_INDEX_SLOTS <= OTA_DOC_MODEL_MAX_PARAMS )
+    #error "The key index of a document model must have more slots than the model has parameters."
+#endif
 
 /* This union allows us to access document model parameter addresses as their
  * actual type without casting every time we access a parameter. */
@@ -205,7 +252,7 @@ typedef union MultiParmPtr
     char ** ppcPtr;
     const char ** ppcConstPtr;
     uint32_t * pulPtr;
-    uint32_t ulVal;
+    size_t xVal;
     bool_t * pxBoolPtr;
     Sig256_t ** ppxSig256Ptr;
     void ** ppvPtr;
@@ -316,6 +363,19 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
                                           uint32_t ulMsgSize,
                                           OTA_Err_t * pxCloseResult );
 
+/* Close the OTA file and check its signature once the last block was ingested. */
+
+static IngestResult_t prvCloseReceivedFile( OTA_FileContext_t * C,
+                                            IngestResult_t eIngestResult,
+                                            OTA_Err_t * pxCloseResult );
+
+/* Write or decode one file block of a received stream block and mark it as received. */
+
+static IngestResult_t prvIngestFileBlock( OTA_FileContext_t * C,
+                                          uint32_t ulBlockIndex,
+                                          const uint8_t * pucData,
+                                          uint32_t ulBlockSize );
+
 /* Called when the OTA agent receives an OTA version message. */
 
 static OTA_FileContext_t * prvProcessOTAJobMsg( const char * pcRawMsg,
@@ -345,6 +405,16 @@ static bool_t prvOTA_Close( OTA_FileContext_t * const C );
 static MQTTBool_t prvOTAPublishCallback( void * pvCallbackContext,
                                          const MQTTPublishData_t * const pxPublishData );
 
+/* Lend a stream message delivered in place to the OTA task and wait until it is ingested. */
+
+static BaseType_t prvLendStreamMsg( const MQTTPublishData_t * const pxPublishData );
+
+/* Ingest a stream message and act on the result, returning the file context or NULL if it was closed. */
+
+static OTA_FileContext_t * prvProcessOTAStreamMsg( OTA_FileContext_t * C,
+                                                   const MQTTPublishData_t * const pxPubData,
+                                                   BaseType_t xLent );
+
 /* Update the job status topic with our progress of the OTA transfer. */
 
 static void prvUpdateJobStatus( OTA_FileContext_t * C,
@@ -356,6 +426,133 @@ static void prvUpdateJobStatus( OTA_FileContext_t * C,
 
 static OTA_Err_t prvPublishGetStreamMessage( OTA_FileContext_t * C );
 
+/* Forget all outstanding block ranges and start requesting ranges from the beginning of the file. */
+
+static void prvResetRequestWindow( const OTA_FileContext_t * C );
+
+/* Account the time spent at the current block size and change to the block size of ulBlockShift. */
+
+static void prvSetBlockShift( uint32_t ulBlockShift );
+
+/* Count a loss of blocks at the current block size and halve the block size. */
+
+static void prvRecordBlockLoss( void );
+
+/* Get the block shift encoded in the client token of a stream response. */
+
+static uint32_t prvGetBlockShift( const char * pcClientToken );
+
+/* Check if any block from ulFirstBlock up to but not including ulEndBlock is still missing. */
+
+static bool_t prvRangeHasMissingBlocks( const OTA_FileContext_t * C,
+                                        uint32_t ulFirstBlock,
+                                        uint32_t ulEndBlock );
+
+/* Retire completed block ranges, flag expired ones and fill free slots with the next missing ranges. */
+
+static void prvFillRequestWindow( const OTA_FileContext_t * C );
+
+/* Set the bits of the missing blocks of all flagged ranges in the request bitmap. Returns the bitmap length. */
+
+static uint32_t prvBuildRequestBitmap( const OTA_FileContext_t * C,
+                                       uint8_t * pucBitmap,
+                                       uint32_t ulBitmapSize );
+
+/* Update the block ranges after a block was received. Returns pdTRUE if ranges should be requested now. */
+
+static bool_t prvUpdateRequestWindow( const OTA_FileContext_t * C,
+                                      uint32_t ulBlockIndex );
+
+/* Get the number of ticks until the deadline of the earliest outstanding block range. */
+
+static TickType_t prvGetRequestTimerTicks( void );
+
+/* Include a received block in the running file hash, holding it back if earlier blocks are missing. */
+
+static void prvHashDataBlock( OTA_FileContext_t * C,
+                              uint32_t ulBlockIndex,
+                              const uint8_t * pucData,
+                              uint32_t ulBlockSize );
+
+/* Stop hashing received blocks and free the reorder buffer. */
+
+static void prvStopFileHash( void );
+
+/* Copy a block received ahead of a missing one to the reorder buffer. */
+
+static bool_t prvHoldDataBlock( uint32_t ulBlockIndex,
+                                const uint8_t * pucData,
+                                uint32_t ulBlockSize );
+
+/* Remove a block from the reorder buffer, returning its data or NULL if it isn't held. */
+
+static const uint8_t * prvTakeHeldBlock( uint32_t ulBlockIndex );
+
+/* Tell whether the image is decoded from a compressed or delta file before it is written. */
+
+static bool_t prvIsFileDecoded( const OTA_FileContext_t * C );
+
+/* Allocate the decompressor window and delta file buffer if the file is compressed or a delta file. */
+
+static OTA_Err_t prvStartDecoding( OTA_FileContext_t * C );
+
+/* Decode a received block of a compressed or delta file, holding it back if earlier blocks are missing. */
+
+static IngestResult_t prvDecodeDataBlock( OTA_FileContext_t * C,
+                                          uint32_t ulBlockIndex,
+                                          const uint8_t * pucData,
+                                          uint32_t ulBlockSize );
+
+/* Check that a compressed or delta file was completely decoded. */
+
+static bool_t prvFinishDecoding( const OTA_FileContext_t * C );
+
+/* Free the decompressor window and delta file buffer. */
+
+static void prvStopDecoding( void );
+
+/* Write part of the file with prvPAL_WriteBlock(), in as many calls as needed. */
+
+static int32_t prvWriteFileData( void * pvContext,
+                                 uint32_t ulOffset,
+                                 const uint8_t * pucData,
+                                 uint32_t ulSize );
+
+/* Write part of the file through the write-behind buffer if it is enabled, otherwise directly. */
+
+static int32_t prvWriteFile( OTA_FileContext_t * C,
+                             uint32_t ulOffset,
+                             const uint8_t * pucData,
+                             uint32_t ulSize );
+
+/* Allocate the write-behind buffer and start the task that writes its pages. */
+
+static OTA_Err_t prvStartWriteBehind( OTA_FileContext_t * C );
+
+/* Write all pages of the write-behind buffer and wait until they are written. */
+
+static bool_t prvFlushWriteBehind( void );
+
+/* Write all pages of the write-behind buffer and free it once the last block was received. */
+
+static bool_t prvFinishWriteBehind( void );
+
+/* Drop the pages of the write-behind buffer, stop its task and free it. */
+
+static void prvStopWriteBehind( void );
+
+/* Store a checkpoint of the file download every otaconfigCHECKPOINT_INTERVAL_BLOCKS blocks. */
+
+static void prvCheckpointFile( OTA_FileContext_t * C );
+
+/* Erase the checkpoint of the file download once the file is complete or abandoned. */
+
+static void prvEraseCheckpoint( OTA_FileContext_t * C );
+
+/* Open a partially received file and restore the download state from its checkpoint. */
+
+static OTA_Err_t prvResumeFileForRx( OTA_FileContext_t * C );
+
 /* Internal function to set the image state including an optional reason code. */
 
 static OTA_Err_t prvSetImageStateWithReason( OTA_ImageState_t eState,
@@ -369,6 +566,12 @@ static void prvDefaultOTACompleteCallback( OTA_JobEvent_t eEvent );
 
 static void prvAgentShutdownCleanup( OTA_PubMsg_t * pxMsgMetaData );
 
+/* Compute the FNV-1a hash of a byte array, continuing from the hash value ulHash. */
+
+static uint32_t prvChecksum( uint32_t ulHash,
+                             const uint8_t * pucData,
+                             uint32_t ulSize );
+
 /* Search the document model for a key that matches the specified JSON key. */
 
 static DocParseErr_t prvSearchModelForTokenKey( JSON_DocModel_t * pxDocModel,
@@ -376,12 +579,12 @@ static DocParseErr_t prvSearchModelForTokenKey( JSON_DocModel_t * pxDocModel,
                                                 uint32_t ulStrLen,
                                                 uint16_t * pusMatchingIndexResult );
 
-/* Prepare the document model for use by sanity checking the initialization parameters
- * and detecting all required parameters. */
+/* Prepare the document model for use by sanity checking the initialization parameters,
+ * detecting all required parameters and indexing the parameter keys. */
 
 static DocParseErr_t prvInitDocModel( JSON_DocModel_t * pxDocModel,
                                       const JSON_DocParam_t * pxBodyDef,
-                                      uint32_t ulContextBaseAddr,
+                                      size_t xContextBaseAddr,
                                       uint32_t ulContextSize,
                                       uint16_t usNumJobParams );
 
@@ -402,8 +605,62 @@ typedef struct ota_agent_statistics
     uint32_t ulOTA_PacketsProcessed; /* Number of OTA packets processed by the OTA task. */
     uint32_t ulOTA_PacketsDropped;   /* Number of OTA packets dropped due to congestion. */
     uint32_t ulOTA_PublishFailures;  /* Number of MQTT publish failures. */
+    uint32_t ulOTA_ResumedBytes;     /* Number of file bytes not downloaded again because of a checkpoint. */
+    OTA_BlockSizeStatistics_t xBlockSizes[ OTA_NUM_BLOCK_SIZES ]; /* Download statistics of each block size, smallest first. */
 } OTA_AgentStatistics_t;
 
+/* A range of otaconfigBLOCKS_PER_RANGE consecutive blocks requested from the stream service. */
+
+typedef struct
+{
+    uint32_t ulFirstBlock;    /* First block of the range or OTA_NO_RANGE if the slot is not in use. */
+    uint32_t ulRequestNumber; /* The stream request that last asked for the blocks of this range. */
+    TickType_t xLastActivity; /* Tick count when the range was last requested or one of its blocks was received. */
+    bool_t xRequestNeeded;    /* pdTRUE if the missing blocks of the range must be requested. */
+    bool_t xGapRequested;     /* pdTRUE if the missing blocks were requested again because of a gap. */
+    bool_t xRequestedAgain;   /* pdTRUE if the range was requested more than once. */
+} OTA_BlockRange_t;
+
+/* The block ranges of the file being received that are outstanding with the stream service. */
+
+typedef struct
+{
+    OTA_BlockRange_t xRanges[ otaconfigMAX_OUTSTANDING_RANGES ]; /* The outstanding block ranges. */
+    uint32_t ulNextRangeBlock;                                  /* First block of the next range to request. */
+    uint32_t ulRequestNumber;                                   /* Number of stream requests published for the file. */
+    uint32_t ulBlocksRequested;                                 /* Number of stream blocks requested for the file. */
+    TickType_t xDownloadStartTicks;                             /* Tick count when the file download started. */
+    uint32_t ulBlockShift;                                      /* Block shift of the stream blocks requested now. Kept for the next file. */
+    uint32_t ulMaxBlockShift;                                   /* Largest block shift used for the file. */
+    uint32_t ulCleanRanges;                                     /* Ranges received without loss since the block shift last changed. */
+    TickType_t xBlockShiftTicks;                                /* Tick count when the block shift last changed. */
+} OTA_RequestWindow_t;
+
+/* Blocks received ahead of the running file hash or of the decompressor of a compressed file. */
+
+typedef struct
+{
+    bool_t xHashing;                                    /* pdTRUE while received blocks are included in the file hash. */
+    uint8_t * pucBlocks;                                /* Storage for the held back blocks, allocated on first use. */
+    uint32_t ulBlockIndex[ OTA_HASH_REORDER_SLOTS ];    /* The block held in each slot or OTA_NO_BLOCK if the slot is free. */
+} OTA_HashReorder_t;
+
+/* Header of a download checkpoint record. It is followed by the block bitmap of the file
+ * and the saved state of the signature verification context, if any. */
+
+typedef struct
+{
+    uint32_t ulMagic;           /* OTA_CHECKPOINT_MAGIC. */
+    uint32_t ulChecksum;        /* FNV-1a hash of the record following this field. */
+    uint32_t ulJobNameHash;     /* FNV-1a hash of the job name the file belongs to. */
+    uint32_t ulServerFileID;    /* The numeric ID of the file in the OTA job. */
+    uint32_t ulFileSize;        /* The size of the file in bytes. */
+    uint32_t ulAppVersion;      /* The firmware version that stored the checkpoint. */
+    uint32_t ulBlocksRemaining; /* How many blocks remained to be received. */
+    uint32_t ulHashedBytes;     /* Number of bytes from the start of the file included in the hash state. */
+    uint32_t ulHashStateLength; /* Length of the saved hash state or 0 if the file was not being hashed. */
+} OTA_CheckpointHeader_t;
+
 /* The OTA agent is a singleton today. The structure keeps it nice and organized. */
 
 typedef struct ota_agent_context
@@ -419,7 +676,21 @@ typedef struct ota_agent_context
     TimerHandle_t xSelfTestTimer;                           /* The self test response expected timer. */
     OTA_ImageState_t eImageState;                           /* The current OTA image state as set by the OTA agent. */
     QueueHandle_t xOTA_MsgQ;                                /* Used to pass MQTT messages to the OTA agent. */
+    const MQTTPublishData_t * pxLentPubData;                /* A stream message delivered in place that the MQTT task lends to the OTA task. */
+    BaseType_t xWaitingForEvents;                           /* The OTA task waits for events, so it can take a lent message before anything else. */
     OTA_AgentStatistics_t xStatistics;                      /* The OTA agent statistics block. */
+    OTA_RequestWindow_t xRequestWindow;                     /* Outstanding block ranges of the single OTA file. */
+    OTA_HashReorder_t xHashReorder;                         /* Blocks held back from the hash of the single OTA file. */
+    OTA_Decompress_t xDecompress;                           /* Decompressor of the single OTA file if it is compressed. */
+    OTA_Delta_t xDelta;                                     /* Applier of the single OTA file if it is a delta file. */
+    uint32_t ulDecodedBytes;                                /* Bytes of the compressed or delta file decoded so far. */
+    #if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+        OTA_WriteBehind_t xWriteBehind;                     /* Write-behind buffer of the single OTA file. */
+        uint8_t * pucWriteBehindPages;                      /* Page buffers of the write-behind buffer or NULL if it isn't started. */
+        TaskHandle_t xWriteBehindTask;                      /* Task writing the pages of the write-behind buffer. */
+        QueueHandle_t xWriteBehindQ;                        /* Pages passed to the write-behind task to be written. */
+        QueueHandle_t xWrittenQ;                            /* Pages returned by the write-behind task once written. */
+    #endif
 } OTA_AgentContext_t;
 
 
@@ -438,7 +709,21 @@ static OTA_AgentContext_t xOTA_Agent =
     .xSelfTestTimer                 = NULL,
     .eImageState                    = eOTA_ImageState_Unknown,
     .xOTA_MsgQ                      = NULL,
+    .pxLentPubData                  = NULL,
+    .xWaitingForEvents              = pdFALSE,
     .xStatistics                    = { 0 },
+    .xRequestWindow                 = { { { 0 } } },
+    .xHashReorder                   = { 0 },
+    .xDecompress                    = { 0 },
+    .xDelta                         = { 0 },
+    .ulDecodedBytes                 = 0,
+    #if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+        .xWriteBehind               = { { { 0 } } },
+        .pucWriteBehindPages        = NULL,
+        .xWriteBehindTask           = NULL,
+        .xWriteBehindQ              = NULL,
+        .xWrittenQ                  = NULL,
+    #endif
 };
 
 
@@ -538,6 +823,8 @@ OTA_State_t OTA_AgentInit( void * pvClient,
     xOTA_Agent.xStatistics.ulOTA_PacketsQueued = 0;
     xOTA_Agent.xStatistics.ulOTA_PacketsProcessed = 0;
     xOTA_Agent.xStatistics.ulOTA_PublishFailures = 0;
+    xOTA_Agent.xStatistics.ulOTA_ResumedBytes = 0;
+    memset( xOTA_Agent.xStatistics.xBlockSizes, 0, sizeof( xOTA_Agent.xStatistics.xBlockSizes ) );
 
     if( pucThingName != NULL )
     {
@@ -657,6 +944,37 @@ uint32_t OTA_GetPacketsReceived( void )
     return xOTA_Agent.xStatistics.ulOTA_PacketsReceived;
 }
 
+uint32_t OTA_GetResumedBytes( void )
+{
+    return xOTA_Agent.xStatistics.ulOTA_ResumedBytes;
+}
+
+uint32_t OTA_GetBlockSize( void )
+{
+    return OTA_FILE_BLOCK_SIZE << xOTA_Agent.xRequestWindow.ulBlockShift;
+}
+
+BaseType_t OTA_GetBlockSizeStatistics( uint32_t ulBlockSize,
+                                       OTA_BlockSizeStatistics_t * pxStats )
+{
+    uint32_t ulBlockShift;
+    BaseType_t xReturn = pdFALSE;
+
+    if( pxStats != NULL )
+    {
+        for( ulBlockShift = 0U; ulBlockShift < OTA_NUM_BLOCK_SIZES; ulBlockShift++ )
+        {
+            if( ulBlockSize == ( OTA_FILE_BLOCK_SIZE << ulBlockShift ) )
+            {
+                *pxStats = xOTA_Agent.xStatistics.xBlockSizes[ ulBlockShift ];
+                xReturn = pdTRUE;
+            }
+        }
+    }
+
+    return xReturn;
+}
+
 /* Request for the next available OTA job from the job service by publishing
  * a "get next job" message to the job service. */
 
@@ -1179,29 +1497,58 @@ static OTA_Err_t prvPublishGetStreamMessage( OTA_FileContext_t * C )
 
     uint32_t ulMsgSizeToPublish;
     size_t xMsgSizeFromStream;
-    uint32_t ulNumBlocks, ulBitmapLen, ulTopicLen;
+    uint32_t ulBitmapLen, ulTopicLen;
     MQTTAgentReturnCode_t eResult;
     OTA_Err_t xErr = kOTA_Err_None;
     char cMsg[ OTA_REQUEST_MSG_MAX_SIZE ];
     char cTopicBuffer[ OTA_MAX_TOPIC_LEN ];
+    char cClientToken[ OTA_CLIENT_TOKEN_SIZE ];
+    uint8_t ucRequestBitmap[ OTA_MAX_BLOCK_BITMAP_SIZE ];
+    uint32_t ulBlockShift;
 
     if( C != NULL )
     {
         if( C->ulRequestMomentum < OTA_MAX_STREAM_REQUEST_MOMENTUM )
         {
-            ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
-            ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
+            /* Only the missing blocks of the ranges that are new, expired or have a gap are
+             * requested. The bitmap starts at block 0 so the offset stays at 0. Filling the
+             * window may halve the block size, so the block shift is read afterwards. */
+            prvFillRequestWindow( C );
+            ulBitmapLen = prvBuildRequestBitmap( C, ucRequestBitmap, sizeof( ucRequestBitmap ) );
+            ulBlockShift = xOTA_Agent.xRequestWindow.ulBlockShift;
+
+            /* The block shift is carried in the client token, which the stream service returns in
+             * each response, so responses to requests made before a block size change are still
+             * split correctly. A block shift of 0 keeps the original token, any other is appended
+             * as a single digit, as OTA_MAX_BLOCK_SHIFT is at most 9. */
+            memcpy( cClientToken, OTA_CLIENT_TOKEN, sizeof( OTA_CLIENT_TOKEN ) );
+
+            if( ulBlockShift != 0U )
+            {
+                cClientToken[ sizeof( OTA_CLIENT_TOKEN ) - 1U ] = ( char ) ( '0' + ulBlockShift );
+                cClientToken[ sizeof( OTA_CLIENT_TOKEN ) ] = '\0';
+            }
 
-            if( pdTRUE == OTA_CBOR_Encode_GetStreamRequestMessage(
-                    ( uint8_t * ) cMsg,
-                    sizeof( cMsg ),
-                    &xMsgSizeFromStream,
-                    OTA_CLIENT_TOKEN,
-                    ( int32_t ) C->ulServerFileID,
-                    ( int32_t ) ( OTA_FILE_BLOCK_SIZE & 0x7fffffffUL ), /* Mask to keep lint happy. It's still a constant. */
-                    0,
-                    C->pucRxBlockBitmap,
-                    ulBitmapLen ) )
+            if( ulBitmapLen == 0U )
+            {
+                /* Nothing is due yet. Wait for the earliest range deadline. */
+                prvStartRequestTimer( C );
+            }
+            else if( ulBitmapLen > sizeof( ucRequestBitmap ) )
+            {
+                OTA_LOG_L1( "[%s] Request bitmap too large.\r\n", OTA_METHOD_NAME );
+                xErr = kOTA_Err_FailedToEncodeCBOR;
+            }
+            else if( pdTRUE == OTA_CBOR_Encode_GetStreamRequestMessage(
+                         ( uint8_t * ) cMsg,
+                         sizeof( cMsg ),
+                         &xMsgSizeFromStream,
+                         cClientToken,
+                         ( int32_t ) C->ulServerFileID,
+                         ( int32_t ) ( ( OTA_FILE_BLOCK_SIZE << ulBlockShift ) & 0x7fffffffUL ), /* Mask to keep lint happy. It's at most 2^9 file blocks. */
+                         0,
+                         ucRequestBitmap,
+                         ulBitmapLen ) )
             {
                 ulMsgSizeToPublish = ( uint32_t ) xMsgSizeFromStream;
 
@@ -1235,9 +1582,10 @@ static OTA_Err_t prvPublishGetStreamMessage( OTA_FileContext_t * C )
                     else
                     {
                         OTA_LOG_L1( "[%s] OK: %s\r\n", OTA_METHOD_NAME, cTopicBuffer );
-                        /* Restart the request timer to retry if we don't complete the update. */
-                        prvStartRequestTimer( C );
                     }
+
+                    /* Restart the request timer to retry the ranges if we don't receive them in time. */
+                    prvStartRequestTimer( C );
                 }
                 else
                 {
@@ -1268,1451 +1616,3309 @@ static OTA_Err_t prvPublishGetStreamMessage( OTA_FileContext_t * C )
 }
 
 
-/* This function is called whenever we receive a MQTT publish message on one of our OTA topics. */
+/* Forget all outstanding block ranges and start requesting ranges from the beginning of the file.
+ * The block size the last file ended with is kept since it reflects the quality of the link. The
+ * largest block size of the file must divide the block ranges so a stream block never spans two of
+ * them. A compressed or delta file can only use a block that fits in the reorder buffer, since
+ * its blocks are held there when they arrive ahead of a missing block. */
 
-static MQTTBool_t prvOTAPublishCallback( void * pvCallbackContext,
-                                         const MQTTPublishData_t * const pxPublishData )
+static void prvResetRequestWindow( const OTA_FileContext_t * C )
 {
-    DEFINE_OTA_METHOD_NAME_L2( "prvOTAPublishCallback" );
+    DEFINE_OTA_METHOD_NAME( "prvResetRequestWindow" );
 
-    MQTTBool_t xTakeOwnership = eMQTTFalse;
-    BaseType_t xReturn;
-    OTA_PubMsg_t xMsg;
+    uint32_t ulIndex;
+    uint32_t ulMaxBlockShift = OTA_MAX_BLOCK_SHIFT;
+    OTA_RequestWindow_t * pxWindow = &xOTA_Agent.xRequestWindow;
 
-    /* If we're running the OTA task, send publish messages to it for processing. */
-    if( xOTA_Agent.xOTA_EventFlags != NULL )
+    for( ulIndex = 0U; ulIndex < otaconfigMAX_OUTSTANDING_RANGES; ulIndex++ )
     {
-        xOTA_Agent.xStatistics.ulOTA_PacketsReceived++;
-        xMsg.lMsgType = ( int32_t ) pvCallbackContext; /*lint !e923 The context variable is actually the message type. */
-        xMsg.xPubData = *pxPublishData;
-        xReturn = xQueueSendToBack( xOTA_Agent.xOTA_MsgQ, &xMsg, ( TickType_t ) 0 );
+        pxWindow->xRanges[ ulIndex ].ulFirstBlock = OTA_NO_RANGE;
+        pxWindow->xRanges[ ulIndex ].xRequestNeeded = pdFALSE;
+        pxWindow->xRanges[ ulIndex ].xGapRequested = pdFALSE;
+        pxWindow->xRanges[ ulIndex ].xRequestedAgain = pdFALSE;
+    }
+
+    pxWindow->ulNextRangeBlock = 0U;
+    pxWindow->ulRequestNumber = 0U;
+    pxWindow->ulBlocksRequested = 0U;
+    pxWindow->xDownloadStartTicks = xTaskGetTickCount();
+
+    while( ( ulMaxBlockShift > 0U ) &&
+           ( ( ( otaconfigBLOCKS_PER_RANGE % ( 1UL << ulMaxBlockShift ) ) != 0U ) ||
+             ( ( prvIsFileDecoded( C ) == pdTRUE ) && ( ( 1UL << ulMaxBlockShift ) > OTA_HASH_REORDER_SLOTS ) ) ) )
+    {
+        ulMaxBlockShift--;
+    }
+
+    pxWindow->ulMaxBlockShift = ulMaxBlockShift;
+
+    if( pxWindow->ulBlockShift > ulMaxBlockShift )
+    {
+        pxWindow->ulBlockShift = ulMaxBlockShift;
+    }
+
+    pxWindow->ulCleanRanges = 0U;
+    pxWindow->xBlockShiftTicks = pxWindow->xDownloadStartTicks;
+
+    OTA_LOG_L1( "[%s] Requesting %u byte blocks, up to %u.\r\n", OTA_METHOD_NAME,
+                ( uint32_t ) ( OTA_FILE_BLOCK_SIZE << pxWindow->ulBlockShift ),
+                ( uint32_t ) ( OTA_FILE_BLOCK_SIZE << ulMaxBlockShift ) );
+}
+
+
+/* Account the time spent at the current block size and change to the block size of ulBlockShift.
+ * Also used to bring the time of the current block size up to date by passing the current shift. */
+
+static void prvSetBlockShift( uint32_t ulBlockShift )
+{
+    DEFINE_OTA_METHOD_NAME_L2( "prvSetBlockShift" );
+
+    OTA_RequestWindow_t * pxWindow = &xOTA_Agent.xRequestWindow;
+    TickType_t xNow = xTaskGetTickCount();
+
+    xOTA_Agent.xStatistics.xBlockSizes[ pxWindow->ulBlockShift ].ulTimeMs += ( uint32_t ) ( ( xNow - pxWindow->xBlockShiftTicks ) * portTICK_PERIOD_MS );
+    pxWindow->xBlockShiftTicks = xNow;
+    pxWindow->ulCleanRanges = 0U;
+
+    if( ulBlockShift != pxWindow->ulBlockShift )
+    {
+        OTA_LOG_L2( "[%s] Block size %u -> %u.\r\n", OTA_METHOD_NAME,
+                    ( uint32_t ) ( OTA_FILE_BLOCK_SIZE << pxWindow->ulBlockShift ),
+                    ( uint32_t ) ( OTA_FILE_BLOCK_SIZE << ulBlockShift ) );
+        pxWindow->ulBlockShift = ulBlockShift;
+    }
+}
+
+
+/* Count a loss of blocks at the current block size and halve the block size. A lost stream message
+ * costs all file blocks it carries, so the block size shrinks quickly while blocks get lost and only
+ * grows again after otaconfigBLOCK_SIZE_GROW_RANGES ranges have been received without loss. */
+
+static void prvRecordBlockLoss( void )
+{
+    OTA_RequestWindow_t * pxWindow = &xOTA_Agent.xRequestWindow;
+
+    xOTA_Agent.xStatistics.xBlockSizes[ pxWindow->ulBlockShift ].ulRetries++;
+
+    if( pxWindow->ulBlockShift > 0U )
+    {
+        prvSetBlockShift( pxWindow->ulBlockShift - 1U );
+    }
+    else
+    {
+        pxWindow->ulCleanRanges = 0U;
+    }
+}
+
+
+/* Get the block shift encoded in the client token of a stream response. The token is OTA_CLIENT_TOKEN
+ * followed by the block shift digit, or just OTA_CLIENT_TOKEN for a block shift of 0. Responses
+ * without a token are assumed to have the current block size. Returns OTA_NO_BLOCK_SHIFT for any
+ * other token. */
+
+static uint32_t prvGetBlockShift( const char * pcClientToken )
+{
+    uint32_t ulBlockShift = OTA_NO_BLOCK_SHIFT;
+    size_t xTokenLen = sizeof( OTA_CLIENT_TOKEN ) - 1U;
 
-        if( xReturn == pdPASS )
+    if( pcClientToken[ 0 ] == '\0' )
+    {
+        ulBlockShift = xOTA_Agent.xRequestWindow.ulBlockShift;
+    }
+    else if( strncmp( pcClientToken, OTA_CLIENT_TOKEN, xTokenLen ) == 0 )
+    {
+        if( pcClientToken[ xTokenLen ] == '\0' )
         {
-            xOTA_Agent.xStatistics.ulOTA_PacketsQueued++;
-            ( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_MSG_READY );
-            /* Take ownership of the MQTT buffer. */
-            xTakeOwnership = eMQTTTrue;
+            ulBlockShift = 0U;
+        }
+        else if( ( pcClientToken[ xTokenLen ] >= '1' ) && ( pcClientToken[ xTokenLen ] <= '9' ) && ( pcClientToken[ xTokenLen + 1U ] == '\0' ) )
+        {
+            ulBlockShift = ( uint32_t ) ( pcClientToken[ xTokenLen ] - '0' );
         }
         else
         {
-            xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
+            /* Not a token of this agent. */
         }
     }
     else
     {
-        /* This doesn't normally occur unless we're subscribed to an OTA topic when
-         * the OTA agent is not initialized. Just drop the message by not taking
-         * ownership since we don't know if we'll ever be able to process it. */
-        OTA_LOG_L2( "[%s] Warning: Received MQTT message but agent isn't ready.\r\n", OTA_METHOD_NAME );
-        xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
+        /* Not a token of this agent. */
     }
 
-    return xTakeOwnership;
+    return ulBlockShift;
 }
 
 
-/* NOTE: This implementation only supports 1 OTA context. Concurrent OTA is not supported. */
+/* Check if any block from ulFirstBlock up to but not including ulEndBlock is still missing.
+ * Bits of blocks not yet received are still in the erased (1) state. */
 
-static void prvOTAUpdateTask( void * pvUnused )
+static bool_t prvRangeHasMissingBlocks( const OTA_FileContext_t * C,
+                                        uint32_t ulFirstBlock,
+                                        uint32_t ulEndBlock )
 {
-    DEFINE_OTA_METHOD_NAME( "prvOTAUpdateTask" );
+    uint32_t ulBlock;
+    bool_t xMissing = pdFALSE;
 
-    EventBits_t xBits;
-    OTA_FileContext_t * pxC = NULL;
-    OTA_Err_t xErr;
+    if( C->pucRxBlockBitmap != NULL )
+    {
+        for( ulBlock = ulFirstBlock; ( ulBlock < ulEndBlock ) && ( xMissing == pdFALSE ); ulBlock++ )
+        {
+            if( ( C->pucRxBlockBitmap[ ulBlock >> LOG2_BITS_PER_BYTE ] & ( 1U << ( ulBlock % BITS_PER_BYTE ) ) ) != 0U )
+            {
+                xMissing = pdTRUE;
+            }
+        }
+    }
 
-    ( void ) pvUnused;
-    OTA_PubMsg_t xMsgMetaData;
+    return xMissing;
+}
 
-    /* Subscribe to the OTA job notification topic. */
-    if( prvSubscribeToJobNotificationTopics() == ( bool_t ) pdTRUE )
-    {
-        xOTA_Agent.xOTA_EventFlags = xEventGroupCreate();
 
-        if( xOTA_Agent.xOTA_EventFlags != NULL )
-        {
-            /* Check if the firmware image is in self test mode. If so, enable the self test timer. */
-            ( void ) OTA_CheckForSelfTest();
+/* Retire completed block ranges, flag expired ones and fill free slots with the next missing ranges.
+ * Ranges are aligned to otaconfigBLOCKS_PER_RANGE so a block always belongs to the same range. The
+ * search for new ranges wraps around to the start of the file so that ranges which were retired
+ * with blocks still missing (e.g. after a failed publish) are picked up again. */
 
-            /*Save the self-test mode in a flag. This flag is cleared when self-test is successful.*/
-            xInSelfTest = prvInSelftest();
+static void prvFillRequestWindow( const OTA_FileContext_t * C )
+{
+    uint32_t ulIndex, ulSlot, ulNumBlocks, ulFirstBlock, ulEndBlock, ulRangesChecked;
+    bool_t xInUse;
+    OTA_RequestWindow_t * pxWindow = &xOTA_Agent.xRequestWindow;
+    OTA_BlockRange_t * pxRange;
+    TickType_t xNow = xTaskGetTickCount();
 
-            /* Send a request to the job service for the latest available job. */
-            ( void ) OTA_CheckForUpdate();
+    ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
 
-            /* Put the OTA agent in the ready state. */
-            xOTA_Agent.eState = eOTA_AgentState_Ready;
+    for( ulSlot = 0U; ulSlot < otaconfigMAX_OUTSTANDING_RANGES; ulSlot++ )
+    {
+        pxRange = &pxWindow->xRanges[ ulSlot ];
 
-            for( ; ; )
-            {
-                xBits = xEventGroupWaitBits(
-                    xOTA_Agent.xOTA_EventFlags, /* The event group being tested. */
-                    OTA_EVT_MASK_ALL_EVENTS,    /* The bits within the event group to wait for. */
-                    pdTRUE,                     /* Bits should be cleared before returning. */
-                    pdFALSE,                    /* Any bit set will do. */
-                    ( TickType_t ) ~( 0U ) );   /* Wait forever. */
+        if( pxRange->ulFirstBlock != OTA_NO_RANGE )
+        {
+            ulEndBlock = pxRange->ulFirstBlock + otaconfigBLOCKS_PER_RANGE;
 
-                /* Check for the shutdown event. */
-                if( ( ( uint32_t ) xBits & OTA_EVT_MASK_SHUTDOWN ) != 0U )
+            if( prvRangeHasMissingBlocks( C, pxRange->ulFirstBlock, ( ulEndBlock < ulNumBlocks ) ? ulEndBlock : ulNumBlocks ) == pdFALSE )
+            {
+                pxRange->ulFirstBlock = OTA_NO_RANGE;
+            }
+            else if( ( xNow - pxRange->xLastActivity ) >= pdMS_TO_TICKS( otaconfigRANGE_REQUEST_WAIT_MS ) )
+            {
+                if( pxRange->xRequestNeeded == pdFALSE )
                 {
-                    OTA_LOG_L1( "[%s] Received shutdown event.\r\n", OTA_METHOD_NAME );
-                    break; /* Break, so we stop all OTA processing. */
+                    prvRecordBlockLoss();
                 }
 
-                /* Check for a user initiated abort. */
-                if( ( ( ( uint32_t ) xBits & OTA_EVT_MASK_USER_ABORT ) != 0U ) && ( pxC != NULL ) )
+                pxRange->xRequestNeeded = pdTRUE;
+                pxRange->xGapRequested = pdFALSE;
+            }
+            else
+            {
+                /* The range is still within its deadline. */
+            }
+        }
+    }
+
+    ulRangesChecked = 0U;
+
+    for( ulSlot = 0U; ( ulSlot < otaconfigMAX_OUTSTANDING_RANGES ) && ( ulRangesChecked < ulNumBlocks ); ulSlot++ )
+    {
+        pxRange = &pxWindow->xRanges[ ulSlot ];
+
+        while( ( pxRange->ulFirstBlock == OTA_NO_RANGE ) && ( ulRangesChecked < ulNumBlocks ) )
+        {
+            ulFirstBlock = pxWindow->ulNextRangeBlock;
+            ulEndBlock = ulFirstBlock + otaconfigBLOCKS_PER_RANGE;
+            ulRangesChecked += otaconfigBLOCKS_PER_RANGE;
+            pxWindow->ulNextRangeBlock = ( ulEndBlock < ulNumBlocks ) ? ulEndBlock : 0U;
+
+            xInUse = pdFALSE;
+
+            for( ulIndex = 0U; ulIndex < otaconfigMAX_OUTSTANDING_RANGES; ulIndex++ )
+            {
+                if( pxWindow->xRanges[ ulIndex ].ulFirstBlock == ulFirstBlock )
                 {
-                    OTA_LOG_L1( "[%s] Received user abort event.\r\n", OTA_METHOD_NAME );
-                    ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, kOTA_Err_UserAbort );
-                    ( void ) prvOTA_Close( pxC ); /* Ignore false result since we're setting the pointer to null on the next line. */
-                    pxC = NULL;
+                    xInUse = pdTRUE;
                 }
+            }
 
-                /* On OTA request timer timeout, publish the stream request if we have context. */
-                if( ( ( xBits & OTA_EVT_MASK_REQ_TIMEOUT ) != 0U ) && ( pxC != NULL ) )
-                {
-                    if( pxC->ulBlocksRemaining > 0U )
-                    {
-                        xErr = prvPublishGetStreamMessage( pxC );
-
-                        if( xErr != kOTA_Err_None )
-                        {                                 /* Abort the current OTA. */
-                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, xErr );
-                            ( void ) prvOTA_Close( pxC ); /* Ignore false result since we're setting the pointer to null on the next line. */
-                            pxC = NULL;
-                        }
-                    }
-                    else
-                    {
-                        /* If there are no blocks remaining, this may have been in flight when the
-                         * last block was received. Just ignore it since it will be cleaned up by
-                         * the agent as required. */
-                    }
-                }
-
-                /* Check if a MQTT message is ready for us to process. */
-                if( ( xBits & OTA_EVT_MASK_MSG_READY ) != 0U )
-                {
-                    xMsgMetaData.xPubData.xBuffer = NULL;
-
-                    if( ( xOTA_Agent.eState == eOTA_AgentState_Ready ) || ( xOTA_Agent.eState == eOTA_AgentState_Active ) )
-                    {
-                        while( xQueueReceive( xOTA_Agent.xOTA_MsgQ, &xMsgMetaData, 0 ) != pdFALSE )
-                        {
-                            /* Check for OTA update job messages. */
-                            if( xMsgMetaData.eMsgType == eOTA_PubMsgType_Job )
-                            {
-                                if( pxC != NULL )
-                                {
-                                    ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, kOTA_Err_UserAbort );
-                                    ( void ) prvOTA_Close( pxC ); /* Abort the existing OTA and ignore impossible false result by design. */
-                                }
-
-                                pxC = prvProcessOTAJobMsg( ( const char * ) xMsgMetaData.xPubData.pvData, /*lint !e9079 pointer to void is OK to cast to the real type. */
-                                                           xMsgMetaData.xPubData.ulDataLength );
+            if( ( xInUse == pdFALSE ) &&
+                ( prvRangeHasMissingBlocks( C, ulFirstBlock, ( ulEndBlock < ulNumBlocks ) ? ulEndBlock : ulNumBlocks ) == pdTRUE ) )
+            {
+                pxRange->ulFirstBlock = ulFirstBlock;
+                pxRange->ulRequestNumber = 0U;
+                pxRange->xRequestNeeded = pdTRUE;
+                pxRange->xGapRequested = pdFALSE;
+                pxRange->xRequestedAgain = pdFALSE;
+            }
+        }
+    }
+}
 
-                                /* A null context here could either mean we didn't receive a valid job or it could
-                                 * signify that we're in the self test phase (where the OTA file transfer is already
-                                 * completed and we've reset the device and are now running the new firmware). We
-                                 * will check the state to determine which case we're in. */
-                                if( pxC == NULL )
-                                {
-                                    /* If the OTA job is in the self_test state, alert the application layer. */
-                                    if( OTA_GetImageState() == eOTA_ImageState_Testing )
-                                    {
-                                        /* Check the platform's OTA update image state. It should also be in self test. */
-                                        if( OTA_CheckForSelfTest() == pdTRUE )
-                                        {
-                                            xOTA_Agent.xOTAJobCompleteCallback( eOTA_JobEvent_StartTest );
-                                        }
-                                        else
-                                        {
-                                            /* The job is in self test but the platform image state is not so it could be
-                                             * an attack on the platform image state. Reject the update (this should also
-                                             * cause the image to be erased), aborting the job and reset the device. */
-                                            OTA_LOG_L1( "[%s] Job in self test but platform state is not!\r\n", OTA_METHOD_NAME );
-                                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Rejected, kOTA_Err_ImageStateMismatch );
-                                            ( void ) prvResetDevice(); /* Ignore return code since there's nothing we can do if we can't force reset. */
-                                        }
-                                    }
-                                }
-                                else
-                                {
-                                    xOTA_Agent.eState = eOTA_AgentState_Active;
-                                }
-                            }
-                            /* It's not a job message, maybe it's a data stream message... */
-                            else if( xMsgMetaData.eMsgType == eOTA_PubMsgType_Stream )
-                            {
-                                /* Ingest data blocks if the platform is not in self-test. */
-                                if( ( pxC != NULL ) && ( xInSelfTest == false ) )
-                                {
-                                    OTA_Err_t xCloseResult;
-                                    IngestResult_t xResult = prvIngestDataBlock( pxC,
-                                                                                 ( const char * ) xMsgMetaData.xPubData.pvData, /*lint !e9079 pointer to void is OK to cast to the real type. */
-                                                                                 xMsgMetaData.xPubData.ulDataLength,
-                                                                                 &xCloseResult );
 
-                                    if( xResult < eIngest_Result_Accepted_Continue )
-                                    {
-                                        /* Negative result codes mean we should stop the OTA process
-                                         * because we are either done or in an unrecoverable error state.
-                                         * We don't want to hang on to the resources. */
+/* Set the bits of the missing blocks of all flagged ranges in the request bitmap and mark the ranges
+ * as requested. The bitmap has a bit per stream block of the current block size, which is set if any
+ * file block in it is missing. Returns the number of bitmap bytes up to the last requested block or
+ * 0 if there is nothing to request. */
 
-                                        if( xResult == eIngest_Result_FileComplete )
-                                        {
-                                            /* File receive is complete and authenticated. Update the job status with the self_test ready identifier. */
-                                            prvUpdateJobStatus( pxC, eJobStatus_InProgress, ( int32_t ) eJobReason_SigCheckPassed, ( int32_t ) NULL );
-                                        }
-                                        else
-                                        {
-                                            OTA_LOG_L1( "[%s] Aborting due to IngestResult_t error %d\r\n", OTA_METHOD_NAME, ( int32_t ) xResult );
-                                            /* Call the platform specific code to reject the image. */
-                                            xErr = prvPAL_SetPlatformImageState( eOTA_ImageState_Rejected );
+static uint32_t prvBuildRequestBitmap( const OTA_FileContext_t * C,
+                                       uint8_t * pucBitmap,
+                                       uint32_t ulBitmapSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvBuildRequestBitmap" );
 
-                                            if( xErr != kOTA_Err_None )
-                                            {
-                                                OTA_LOG_L2( "[%s] Error trying to set platform image state (0x%08x)\r\n", OTA_METHOD_NAME, ( int32_t ) xErr );
-                                            }
-                                            else
-                                            {
-                                                /* Nothing special to do on success. */
-                                            }
+    uint32_t ulSlot, ulBlock, ulEndBlock, ulNumBlocks, ulByte, ulStreamBlock, ulStreamEndBlock;
+    uint32_t ulBitmapLen = 0U;
+    OTA_RequestWindow_t * pxWindow = &xOTA_Agent.xRequestWindow;
+    uint32_t ulBlocksPerStreamBlock = 1UL << pxWindow->ulBlockShift;
+    OTA_BlockRange_t * pxRange;
+    TickType_t xNow = xTaskGetTickCount();
 
-                                            prvUpdateJobStatus( pxC, eJobStatus_FailedWithVal, ( int32_t ) xCloseResult, ( int32_t ) xResult );
-                                        }
+    ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+    memset( pucBitmap, 0, ulBitmapSize );
+    pxWindow->ulRequestNumber++;
 
-                                        /* Release all remaining resources of the OTA file. */
-                                        ( void ) prvOTA_Close( pxC ); /* Ignore false result since we're setting the pointer to null on the next line. */
-                                        pxC = NULL;
+    for( ulSlot = 0U; ulSlot < otaconfigMAX_OUTSTANDING_RANGES; ulSlot++ )
+    {
+        pxRange = &pxWindow->xRanges[ ulSlot ];
 
-                                        /* Let main application know of our result. */
-                                        xOTA_Agent.xOTAJobCompleteCallback( ( xResult == eIngest_Result_FileComplete ) ? eOTA_JobEvent_Activate : eOTA_JobEvent_Fail );
+        if( ( pxRange->ulFirstBlock != OTA_NO_RANGE ) && ( pxRange->xRequestNeeded == pdTRUE ) )
+        {
+            ulEndBlock = pxRange->ulFirstBlock + otaconfigBLOCKS_PER_RANGE;
 
-                                        /* Free any remaining string memory holding the job name since this job is done. */
-                                        if( xOTA_Agent.pucOTA_Singleton_ActiveJobName != NULL )
-                                        {
-                                            vPortFree( xOTA_Agent.pucOTA_Singleton_ActiveJobName );
-                                            xOTA_Agent.pucOTA_Singleton_ActiveJobName = NULL;
-                                        }
-                                    }
-                                    else
-                                    {
-                                        /* We're actively receiving a file so update the job status as needed. */
-                                        /* First reset the momentum counter since we received a good block. */
-                                        pxC->ulRequestMomentum = 0;
-                                        prvUpdateJobStatus( pxC, eJobStatus_InProgress, ( int32_t ) eJobReason_Receiving, ( int32_t ) NULL );
-                                    }
-                                }
-                            }
-                            else
-                            {
-                                /* Ignore unknown message types. */
-                                OTA_LOG_L2( "[%s] Ignoring unknown message type %d.\r\n", OTA_METHOD_NAME, xMsgMetaData.lMsgType );
-                            }
+            if( ulEndBlock > ulNumBlocks )
+            {
+                ulEndBlock = ulNumBlocks;
+            }
 
-                            if( xMsgMetaData.xPubData.xBuffer != NULL )
-                            {
-                                xOTA_Agent.xStatistics.ulOTA_PacketsProcessed++;
+            for( ulBlock = pxRange->ulFirstBlock; ulBlock < ulEndBlock; ulBlock += ulBlocksPerStreamBlock )
+            {
+                ulStreamBlock = ulBlock >> pxWindow->ulBlockShift;
+                ulStreamEndBlock = ulBlock + ulBlocksPerStreamBlock;
+                ulByte = ulStreamBlock >> LOG2_BITS_PER_BYTE;
 
-                                /* Return the MQTT buffer since we're done with it (even if we ignored the message). */
-                                if( ( MQTT_AGENT_ReturnBuffer( xOTA_Agent.pvPubSubClient, xMsgMetaData.xPubData.xBuffer ) ) == eMQTTAgentSuccess )
-                                {
-                                    OTA_LOG_L2( "[%s] Returned buffer to MQTT client.\r\n", OTA_METHOD_NAME );
-                                }
-                                else
-                                {
-                                    OTA_LOG_L1( "[%s] MQTT_AGENT_ReturnBuffer() failed.\r\n", OTA_METHOD_NAME );
-                                    break;
-                                }
-                            }
-                            else
-                            {
-                                /* Safety ignore messages not associated with an MQTT buffer. */
-                            }
-                        }
-                    }
+                if( ulByte >= ulBitmapSize )
+                {
+                    /* The file has more blocks than a request can carry. Report a length
+                     * larger than the bitmap so the caller fails instead of skipping blocks. */
+                    OTA_LOG_L1( "[%s] Block %u is beyond the request bitmap.\r\n", OTA_METHOD_NAME, ulStreamBlock );
+                    ulBitmapLen = ulBitmapSize + 1U;
+                    break;
                 }
 
-                if( pxC == NULL )
+                if( prvRangeHasMissingBlocks( C, ulBlock, ( ulStreamEndBlock < ulEndBlock ) ? ulStreamEndBlock : ulEndBlock ) == pdTRUE )
                 {
-                    /* Any event that releases the context structure tells us we're not active anymore. */
-                    xOTA_Agent.eState = eOTA_AgentState_Ready;
+                    pucBitmap[ ulByte ] |= ( uint8_t ) ( 1U << ( ulStreamBlock % BITS_PER_BYTE ) );
+                    pxWindow->ulBlocksRequested++;
+
+                    if( ( ulByte + 1U ) > ulBitmapLen )
+                    {
+                        ulBitmapLen = ulByte + 1U;
+                    }
                 }
             }
 
-            /* If we're here, we're shutting down the OTA agent. Free up all resources and quit. */
-            prvAgentShutdownCleanup( &xMsgMetaData );
-            vEventGroupDelete( xOTA_Agent.xOTA_EventFlags );
+            pxRange->xRequestedAgain = ( pxRange->ulRequestNumber != 0U ) ? pdTRUE : pdFALSE;
+            pxRange->ulRequestNumber = pxWindow->ulRequestNumber;
+            pxRange->xLastActivity = xNow;
+            pxRange->xRequestNeeded = pdFALSE;
         }
     }
 
-    /* Clear the entire agent context. This includes the OTA agent state. */
-    memset( &xOTA_Agent, 0, sizeof( xOTA_Agent ) );
-
-    /* Reset the image and agent states. Possibly redundant but safer.
-     * Finally, self destruct. */
-    xOTA_Agent.eImageState = eOTA_ImageState_Unknown;
-    xOTA_Agent.eState = eOTA_AgentState_NotReady;
-    vTaskDelete( NULL );
+    return ulBitmapLen;
 }
 
 
-/* If we're in self test mode, start the self test timer. The latest job should
- * also be in the self test state. We must complete the self test and either
- * accept or reject the image before the timer expires or we shall reset the
- * device to initiate a roll back of the MCU firmware bundle. This will catch
- * issues like improper credentials or a device that is connected to a non-
- * production stage of the job service resulting in a different job queue being
- * used.
- */
-static BaseType_t OTA_CheckForSelfTest( void )
+/* Update the block ranges after a new block was received. The stream service answers requests in
+ * order and sends the blocks of a request in ascending order, so a block of a range implies that all
+ * blocks of ranges asked for by earlier requests and the lower blocks of ranges asked for by the same
+ * request have been sent. Those still missing were lost and are requested again now instead of after
+ * the range deadline. Only blocks of ranges requested once are used for this, since a block of a range
+ * requested again may answer either request. A range is only requested again for a gap once until its
+ * deadline expires, since blocks of the earlier request may still arrive after the new request is
+ * published. Returns pdTRUE if the stream request should be published now. */
+
+static bool_t prvUpdateRequestWindow( const OTA_FileContext_t * C,
+                                      uint32_t ulBlockIndex )
 {
-    DEFINE_OTA_METHOD_NAME( "OTA_CheckForSelfTest" );
-    static const char cTimerName[] = "OTA_SelfTest";
-    BaseType_t xTimerStarted = pdFALSE;
-    static StaticTimer_t xTimerBuffer;
+    DEFINE_OTA_METHOD_NAME_L2( "prvUpdateRequestWindow" );
 
-    if( prvPAL_GetPlatformImageState() == eOTA_PAL_ImageState_PendingCommit )
-    {
-        if( xOTA_Agent.xSelfTestTimer == NULL )
-        {
-            xOTA_Agent.xSelfTestTimer = xTimerCreateStatic( cTimerName,
-                                                            pdMS_TO_TICKS( otaconfigSELF_TEST_RESPONSE_WAIT_MS ),
-                                                            pdFALSE, NULL, prvSelfTestTimer_Callback,
-                                                            &xTimerBuffer );
+    uint32_t ulSlot, ulEndBlock, ulNumBlocks;
+    bool_t xRequestNow = pdFALSE;
+    OTA_RequestWindow_t * pxWindow = &xOTA_Agent.xRequestWindow;
+    OTA_BlockRange_t * pxBlockRange = NULL;
+    OTA_BlockRange_t * pxRange;
 
-            if( xOTA_Agent.xSelfTestTimer != NULL )
-            {
-                xTimerStarted = xTimerStart( xOTA_Agent.xSelfTestTimer, portMAX_DELAY );
-            }
-            else
-            {
-                /* Static timers are guaranteed to be created unless we pass in a NULL buffer. */
-            }
-        }
-        else
-        {
-            xTimerStarted = xTimerReset( xOTA_Agent.xSelfTestTimer, portMAX_DELAY );
-        }
+    for( ulSlot = 0U; ulSlot < otaconfigMAX_OUTSTANDING_RANGES; ulSlot++ )
+    {
+        pxRange = &pxWindow->xRanges[ ulSlot ];
 
-        /* Common check for whether the timer was started or not. It should be impossible to not start. */
-        if( xTimerStarted == pdTRUE )
-        {
-            OTA_LOG_L1( "[%s] Starting %s timer.\r\n", OTA_METHOD_NAME, cTimerName );
-        }
-        else
+        if( ( pxRange->ulFirstBlock != OTA_NO_RANGE ) &&
+            ( ulBlockIndex >= pxRange->ulFirstBlock ) &&
+            ( ulBlockIndex < ( pxRange->ulFirstBlock + otaconfigBLOCKS_PER_RANGE ) ) )
         {
-            OTA_LOG_L1( "[%s] ERROR: failed to reset/start %s timer.\r\n", OTA_METHOD_NAME, cTimerName );
+            pxBlockRange = pxRange;
         }
     }
 
-    return xTimerStarted;
-}
+    if( ( pxBlockRange != NULL ) && ( C->ulBlocksRemaining > 0U ) )
+    {
+        ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+        pxBlockRange->xLastActivity = xTaskGetTickCount();
+
+        for( ulSlot = 0U; ( ulSlot < otaconfigMAX_OUTSTANDING_RANGES ) && ( pxBlockRange->xRequestedAgain == pdFALSE ); ulSlot++ )
+        {
+            pxRange = &pxWindow->xRanges[ ulSlot ];
 
+            if( ( pxRange->ulFirstBlock != OTA_NO_RANGE ) && ( pxRange->xGapRequested == pdFALSE ) )
+            {
+                ulEndBlock = pxRange->ulFirstBlock + otaconfigBLOCKS_PER_RANGE;
 
-/* When the self test response timer expires, reset the device since we're likely broken. */
+                if( ulEndBlock > ulNumBlocks )
+                {
+                    ulEndBlock = ulNumBlocks;
+                }
 
-static void prvSelfTestTimer_Callback( TimerHandle_t T )
-{
-    DEFINE_OTA_METHOD_NAME( "prvSelfTestTimer_Callback" );
-    ( void ) T;
+                /* Only the blocks below this one have been sent if the range was asked for by the same request. */
+                if( ( pxRange->ulRequestNumber == pxBlockRange->ulRequestNumber ) && ( ulEndBlock > ulBlockIndex ) )
+                {
+                    ulEndBlock = ulBlockIndex;
+                }
 
-    OTA_LOG_L1( "[%s] Self test failed to complete within %ums\r\n", OTA_METHOD_NAME, otaconfigSELF_TEST_RESPONSE_WAIT_MS );
-    ( void ) prvPAL_ResetDevice();
-}
+                if( ( ( int32_t ) ( pxBlockRange->ulRequestNumber - pxRange->ulRequestNumber ) >= 0 ) &&
+                    ( prvRangeHasMissingBlocks( C, pxRange->ulFirstBlock, ulEndBlock ) == pdTRUE ) )
+                {
+                    OTA_LOG_L2( "[%s] Gap before block %u, requesting range %u again.\r\n", OTA_METHOD_NAME, ulBlockIndex, pxRange->ulFirstBlock );
+                    prvRecordBlockLoss();
+                    pxRange->xRequestNeeded = pdTRUE;
+                    pxRange->xGapRequested = pdTRUE;
+                    xRequestNow = pdTRUE;
+                }
+            }
+        }
 
+        /* Once all blocks of the range are in, request the next range to keep the window full. A range
+         * that didn't have to be requested again counts towards doubling the block size. */
+        ulEndBlock = pxBlockRange->ulFirstBlock + otaconfigBLOCKS_PER_RANGE;
 
-/* Stop the OTA self test timer if it is running. */
+        if( prvRangeHasMissingBlocks( C, pxBlockRange->ulFirstBlock, ( ulEndBlock < ulNumBlocks ) ? ulEndBlock : ulNumBlocks ) == pdFALSE )
+        {
+            if( pxBlockRange->xRequestedAgain == pdFALSE )
+            {
+                pxWindow->ulCleanRanges++;
 
-static void prvStopSelfTestTimer( void )
-{
-    DEFINE_OTA_METHOD_NAME( "prvStopSelfTestTimer" );
+                if( ( pxWindow->ulCleanRanges >= otaconfigBLOCK_SIZE_GROW_RANGES ) && ( pxWindow->ulBlockShift < pxWindow->ulMaxBlockShift ) )
+                {
+                    prvSetBlockShift( pxWindow->ulBlockShift + 1U );
+                }
+            }
 
-    if( xOTA_Agent.xSelfTestTimer != NULL )
-    {
-        ( void ) xTimerStop( xOTA_Agent.xSelfTestTimer, portMAX_DELAY );
-        OTA_LOG_L1( "[%s] Stopping the self test timer.\r\n", OTA_METHOD_NAME );
+            pxBlockRange->ulFirstBlock = OTA_NO_RANGE;
+            xRequestNow = pdTRUE;
+        }
     }
+
+    return xRequestNow;
 }
 
 
-/* When the OTA request timer expires, signal the OTA task to request the file. */
+/* Get the number of ticks until the deadline of the earliest outstanding block range. Without
+ * outstanding ranges, the timer falls back to the idle file request interval. */
 
-static void prvRequestTimer_Callback( TimerHandle_t T )
+static TickType_t prvGetRequestTimerTicks( void )
 {
-    ( void ) T;
+    uint32_t ulSlot;
+    TickType_t xElapsed;
+    TickType_t xTicks = pdMS_TO_TICKS( otaconfigFILE_REQUEST_WAIT_MS );
+    TickType_t xNow = xTaskGetTickCount();
+    OTA_RequestWindow_t * pxWindow = &xOTA_Agent.xRequestWindow;
 
-    if( xOTA_Agent.xOTA_EventFlags != NULL )
+    for( ulSlot = 0U; ulSlot < otaconfigMAX_OUTSTANDING_RANGES; ulSlot++ )
     {
-        ( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_REQ_TIMEOUT );
+        if( pxWindow->xRanges[ ulSlot ].ulFirstBlock != OTA_NO_RANGE )
+        {
+            xElapsed = xNow - pxWindow->xRanges[ ulSlot ].xLastActivity;
+
+            if( xElapsed >= pdMS_TO_TICKS( otaconfigRANGE_REQUEST_WAIT_MS ) )
+            {
+                xTicks = 0U;
+            }
+            else if( ( pdMS_TO_TICKS( otaconfigRANGE_REQUEST_WAIT_MS ) - xElapsed ) < xTicks )
+            {
+                xTicks = pdMS_TO_TICKS( otaconfigRANGE_REQUEST_WAIT_MS ) - xElapsed;
+            }
+            else
+            {
+                /* A range with an earlier deadline was already found. */
+            }
+        }
     }
+
+    /* Timer periods must be greater than zero. */
+    return ( xTicks > 0U ) ? xTicks : ( TickType_t ) 1U;
 }
 
 
-/* Create and start or reset the OTA request timer to kick off the process if needed.
- * Do not output an important log message on reset since this gets called every time a file
- * block is received. Use log level 2 at most.
- */
-static void prvStartRequestTimer( OTA_FileContext_t * C )
+/* This function is called whenever we receive a MQTT publish message on one of our OTA topics. */
+
+static MQTTBool_t prvOTAPublishCallback( void * pvCallbackContext,
+                                         const MQTTPublishData_t * const pxPublishData )
 {
-    DEFINE_OTA_METHOD_NAME( "prvStartRequestTimer" );
-    static const char cTimerName[] = "OTA_FileRequest";
+    DEFINE_OTA_METHOD_NAME_L2( "prvOTAPublishCallback" );
 
-    BaseType_t xTimerStarted = pdFALSE;
+    MQTTBool_t xTakeOwnership = eMQTTFalse;
+    BaseType_t xReturn;
+    OTA_PubMsg_t xMsg;
 
-    if( C->xRequestTimer == NULL )
+    /* If we're running the OTA task, send publish messages to it for processing. */
+    if( xOTA_Agent.xOTA_EventFlags != NULL )
     {
-        C->xRequestTimer = xTimerCreate( cTimerName,
-                                         pdMS_TO_TICKS( otaconfigFILE_REQUEST_WAIT_MS ),
-                                         pdFALSE,
-                                         ( void * ) C, /*lint !e9087 Using the file context as the timer ID does not cause undefined behavior. */
-                                         prvRequestTimer_Callback );
-
-        if( C->xRequestTimer != NULL )
+        xOTA_Agent.xStatistics.ulOTA_PacketsReceived++;
+        xMsg.lMsgType = ( int32_t ) pvCallbackContext; /*lint !e923 The context variable is actually the message type. */
+        xMsg.xPubData = *pxPublishData;
+        xReturn = pdPASS;
+
+        /* A message delivered in place by the MQTT library is only valid during this
+         * callback. A stream message is lent to the OTA task if it is waiting for events,
+         * which ingests it from the MQTT receive buffer before this callback returns.
+         * Otherwise the message must be copied to a buffer before it is queued. */
+        if( ( pxPublishData->xBuffer == NULL ) &&
+            ( xMsg.eMsgType == eOTA_PubMsgType_Stream ) &&
+            ( prvLendStreamMsg( pxPublishData ) == pdTRUE ) )
         {
-            xTimerStarted = xTimerStart( C->xRequestTimer, 0 );
+            /* The message was handed to the agent without a buffer to take. */
+            xOTA_Agent.xStatistics.ulOTA_PacketsQueued++;
         }
-    }
-    else
-    {
-        xTimerStarted = xTimerReset( C->xRequestTimer, portMAX_DELAY );
-    }
+        else
+        {
+            if( pxPublishData->xBuffer == NULL )
+            {
+                if( MQTT_AGENT_ClonePublishData( xOTA_Agent.pvPubSubClient, pxPublishData, &xMsg.xPubData ) != eMQTTAgentSuccess )
+                {
+                    xReturn = pdFAIL;
+                }
+            }
 
-    if( xTimerStarted == pdTRUE )
-    {
-        OTA_LOG_L2( "[%s] Starting %s timer.\r\n", OTA_METHOD_NAME, cTimerName );
+            if( xReturn == pdPASS )
+            {
+                xReturn = xQueueSendToBack( xOTA_Agent.xOTA_MsgQ, &xMsg, ( TickType_t ) 0 );
+
+                /* Return the copy if it could not be queued. */
+                if( ( xReturn != pdPASS ) && ( pxPublishData->xBuffer == NULL ) )
+                {
+                    ( void ) MQTT_AGENT_ReturnBuffer( xOTA_Agent.pvPubSubClient, xMsg.xPubData.xBuffer );
+                }
+            }
+
+            if( xReturn == pdPASS )
+            {
+                xOTA_Agent.xStatistics.ulOTA_PacketsQueued++;
+                ( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_MSG_READY );
+                /* Take ownership of the MQTT buffer. */
+                xTakeOwnership = eMQTTTrue;
+            }
+            else
+            {
+                xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
+            }
+        }
     }
     else
     {
-        OTA_LOG_L1( "[%s] ERROR: failed to reset/start %s timer.\r\n", OTA_METHOD_NAME, cTimerName );
+        /* This doesn't normally occur unless we're subscribed to an OTA topic when
+         * the OTA agent is not initialized. Just drop the message by not taking
+         * ownership since we don't know if we'll ever be able to process it. */
+        OTA_LOG_L2( "[%s] Warning: Received MQTT message but agent isn't ready.\r\n", OTA_METHOD_NAME );
+        xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
     }
-}
-
-
-/* Stop the firmware request timer if it is running. */
-
-static void prvStopRequestTimer( OTA_FileContext_t * C )
-{
-    DEFINE_OTA_METHOD_NAME( "prvStopRequestTimer" );
 
-    if( C->xRequestTimer != NULL )
-    {
-        ( void ) xTimerStop( C->xRequestTimer, 0 );
-        OTA_LOG_L1( "[%s] Stopping file request timer.\r\n", OTA_METHOD_NAME );
-    }
+    return xTakeOwnership;
 }
 
 
-/* Close an existing OTA context and free its resources. */
+/* Lend a stream message delivered in place by the MQTT library to the OTA task, so it is ingested
+ * from the MQTT receive buffer without a copy. This is only done while the OTA task waits for
+ * events. It then takes the message before it handles any event and returns it as soon as the
+ * payload is written, before it closes the file or makes any MQTT call, so the MQTT task neither
+ * waits for the PAL nor for an OTA task that is waiting for the MQTT task. Returns pdFALSE if the
+ * OTA task is busy and the message must be queued instead. */
 
-static bool_t prvOTA_Close( OTA_FileContext_t * const C )
+static BaseType_t prvLendStreamMsg( const MQTTPublishData_t * const pxPublishData )
 {
-    DEFINE_OTA_METHOD_NAME( "prvOTA_Close" );
-
-    bool_t xResult = pdFALSE;
-
-    OTA_LOG_L1( "[%s] Context->0x%08x\r\n", OTA_METHOD_NAME, C );
+    BaseType_t xLent = pdFALSE;
 
-    if( C != NULL )
+    taskENTER_CRITICAL();
     {
-        /* Stop and delete any existing transfer request timer. */
-        if( C->xRequestTimer != NULL )
-        {
-            ( void ) xTimerStop( C->xRequestTimer, 0 );
-            ( void ) xTimerDelete( C->xRequestTimer, 0 );
-            C->xRequestTimer = NULL;
-        }
-
-        if( C->pucStreamName != NULL )
-        {
-            ( void ) prvUnSubscribeFromDataStream( C ); /* Unsubscribe from the data stream if needed. */
-            vPortFree( C->pucStreamName );              /* Free any previously allocated stream name memory. */
-            C->pucStreamName = NULL;
-        }
-
-        if( C->pucJobName != NULL )
-        {
-            vPortFree( C->pucJobName ); /* Free the job name memory. */
-            C->pucJobName = NULL;
-        }
-
-        if( C->pucRxBlockBitmap != NULL )
-        {
-            vPortFree( C->pucRxBlockBitmap ); /* Free the previously allocated block bitmap. */
-            C->pucRxBlockBitmap = NULL;
-        }
-
-        if( C->pxSignature != NULL )
-        {
-            vPortFree( C->pxSignature ); /* Free the image signature memory. */
-            C->pxSignature = NULL;
-        }
-
-        if( C->pucFilePath != NULL )
+        if( xOTA_Agent.xWaitingForEvents == pdTRUE )
         {
-            vPortFree( C->pucFilePath ); /* Free the file path name string memory. */
-            C->pucFilePath = NULL;
-        }
-
-        if( C->pucCertFilepath != NULL )
-        {
-            vPortFree( C->pucCertFilepath ); /* Free the certificate path name string memory. */
-            C->pucCertFilepath = NULL;
+            xOTA_Agent.pxLentPubData = pxPublishData;
+            xLent = pdTRUE;
         }
+    }
+    taskEXIT_CRITICAL();
 
-        /* Abort any active file access and release the file resource, if needed. */
-        ( void ) prvPAL_Abort( C );
-        memset( C, 0, sizeof( OTA_FileContext_t ) ); /* Clear the entire structure now that it is free. */
-        xResult = pdTRUE;
+    if( xLent == pdTRUE )
+    {
+        ( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_MSG_READY );
+        ( void ) xEventGroupWaitBits( xOTA_Agent.xOTA_EventFlags,
+                                      OTA_EVT_MASK_MSG_RETURNED,
+                                      pdTRUE,                   /* Clear the bit for the next message. */
+                                      pdFALSE,
+                                      ( TickType_t ) ~( 0U ) ); /* The OTA task returns it without waiting for anything. */
     }
 
-    return xResult;
+    return xLent;
 }
 
 
-/* Find an available OTA transfer context structure. */
+/* Ingest a stream message if there is an OTA file to receive and act on the result: publish the
+ * job status, and close the file once it is complete or failed. A message lent by the MQTT task is
+ * returned as soon as its payload is written, before the file is closed, since the MQTT task waits
+ * for it. Returns the file context, or NULL if it was closed. */
 
-static OTA_FileContext_t * prvGetFreeContext( void )
+static OTA_FileContext_t * prvProcessOTAStreamMsg( OTA_FileContext_t * C,
+                                                   const MQTTPublishData_t * const pxPubData,
+                                                   BaseType_t xLent )
 {
-    uint32_t ulIndex = 0U;
-    OTA_FileContext_t * pxC = NULL;
+    DEFINE_OTA_METHOD_NAME( "prvProcessOTAStreamMsg" );
 
-    while( ( ulIndex < OTA_MAX_FILES ) && ( xOTA_Agent.xOTA_Files[ ulIndex ].pucFilePath != NULL ) )
-    {
-        ulIndex++;
-    }
+    OTA_Err_t xErr;
+    OTA_Err_t xCloseResult = kOTA_Err_None;
+    IngestResult_t xResult = eIngest_Result_Uninitialized;
 
-    if( ulIndex != OTA_MAX_FILES )
+    /* Ingest data blocks if the platform is not in self-test. */
+    if( ( C != NULL ) && ( xInSelfTest == false ) )
     {
-        memset( &xOTA_Agent.xOTA_Files[ ulIndex ], 0, sizeof( OTA_FileContext_t ) );
-        pxC = &xOTA_Agent.xOTA_Files[ ulIndex ];
+        xResult = prvIngestDataBlock( C,
+                                      ( const char * ) pxPubData->pvData, /*lint !e9079 pointer to void is OK to cast to the real type. */
+                                      pxPubData->ulDataLength,
+                                      &xCloseResult );
     }
-    else
+
+    if( xLent == pdTRUE )
     {
-        /* Not able to support this request so we'll return NULL. */
+        ( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_MSG_RETURNED );
     }
 
-    return pxC;
-}
+    if( ( C != NULL ) && ( xInSelfTest == false ) )
+    {
+        /* The file is closed and its signature checked after the message is returned, so the MQTT
+         * task doesn't wait for the PAL. */
+        xResult = prvCloseReceivedFile( C, xResult, &xCloseResult );
 
+        if( xResult < eIngest_Result_Accepted_Continue )
+        {
+            /* Negative result codes mean we should stop the OTA process
+             * because we are either done or in an unrecoverable error state.
+             * We don't want to hang on to the resources. */
 
-bool_t JSON_IsCStringEqual( const char * pcJSONString,
-                            uint32_t ulLen,
-                            const char * pcCString )
-{
-    bool_t xResult;
+            if( xResult == eIngest_Result_FileComplete )
+            {
+                /* File receive is complete and authenticated. Update the job status with the self_test ready identifier. */
+                prvUpdateJobStatus( C, eJobStatus_InProgress, ( int32_t ) eJobReason_SigCheckPassed, ( int32_t ) NULL );
+            }
+            else
+            {
+                OTA_LOG_L1( "[%s] Aborting due to IngestResult_t error %d\r\n", OTA_METHOD_NAME, ( int32_t ) xResult );
+                prvEraseCheckpoint( C );
 
-    if( ( ulLen <= OTA_MAX_JSON_STR_LEN ) &&
-        ( strncmp( pcJSONString, pcCString, ulLen ) == 0 ) && /*lint !e9007 I see no side effect. Possibly a lint bug. */
-        ( pcCString[ ulLen ] == '\0' ) )
-    {
-        xResult = pdTRUE;
-    }
-    else
-    {
-        xResult = pdFALSE;
-    }
+                /* Call the platform specific code to reject the image. */
+                xErr = prvPAL_SetPlatformImageState( eOTA_ImageState_Rejected );
 
-    return xResult;
-}
+                if( xErr != kOTA_Err_None )
+                {
+                    OTA_LOG_L2( "[%s] Error trying to set platform image state (0x%08x)\r\n", OTA_METHOD_NAME, ( int32_t ) xErr );
+                }
+                else
+                {
+                    /* Nothing special to do on success. */
+                }
 
+                prvUpdateJobStatus( C, eJobStatus_FailedWithVal, ( int32_t ) xCloseResult, ( int32_t ) xResult );
+            }
 
-/* Search our document model for a key match with the given token. */
+            /* Release all remaining resources of the OTA file. */
+            ( void ) prvOTA_Close( C ); /* Ignore false result since we're setting the pointer to null on the next line. */
+            C = NULL;
 
-static DocParseErr_t prvSearchModelForTokenKey( JSON_DocModel_t * pxDocModel,
-                                                const char * pcJSONString,
-                                                uint32_t ulStrLen,
-                                                uint16_t * pusMatchingIndexResult )
-{
-    DocParseErr_t eErr = eDocParseErr_ParamKeyNotInModel;
-    uint16_t usParamIndex;
+            /* Let main application know of our result. */
+            xOTA_Agent.xOTAJobCompleteCallback( ( xResult == eIngest_Result_FileComplete ) ? eOTA_JobEvent_Activate : eOTA_JobEvent_Fail );
 
-    for( usParamIndex = 0; usParamIndex < pxDocModel->usNumModelParams; usParamIndex++ )
-    {
-        if( JSON_IsCStringEqual( pcJSONString, ulStrLen,
-                                 pxDocModel->pxBodyDef[ usParamIndex ].pcSrcKey ) == ( bool_t ) pdTRUE )
-        {
-            /* Per Security, don't allow multiple entries of the same parameter. */
-            if( ( pxDocModel->ulParamsReceivedBitmap & ( 1U << usParamIndex ) ) != 0U ) /*lint !e9032 usParamIndex will never be greater than kDocModel_MaxParams, which is the the size of the bitmap. */
-            {
-                eErr = eDocParseErr_DuplicatesNotAllowed;
-            }
-            else
+            /* Free any remaining string memory holding the job name since this job is done. */
+            if( xOTA_Agent.pucOTA_Singleton_ActiveJobName != NULL )
             {
-                /* Mark parameter as received in the bitmap. */
-                pxDocModel->ulParamsReceivedBitmap |= ( 1U << usParamIndex ); /*lint !e9032 usParamIndex will never be greater than kDocModel_MaxParams, which is the the size of the bitmap. */
-                *pusMatchingIndexResult = usParamIndex;                       /* Save result index for caller. */
-                eErr = eDocParseErr_None;                                     /* We found a matching key in the document model. */
+                vPortFree( xOTA_Agent.pucOTA_Singleton_ActiveJobName );
+                xOTA_Agent.pucOTA_Singleton_ActiveJobName = NULL;
             }
-
-            break; /* We found a key match so stop searching. */
+        }
+        else
+        {
+            /* We're actively receiving a file so update the job status as needed. */
+            /* First reset the momentum counter since we received a good block. */
+            C->ulRequestMomentum = 0;
+            prvUpdateJobStatus( C, eJobStatus_InProgress, ( int32_t ) eJobReason_Receiving, ( int32_t ) NULL );
         }
     }
 
-    return eErr;
+    return C;
 }
 
 
+/* NOTE: This implementation only supports 1 OTA context. Concurrent OTA is not supported. */
 
-/* Extract the desired fields from the JSON document based on the specified document model. */
-
-static DocParseErr_t prvParseJSONbyModel( const char * pcJSON,
-                                          uint32_t ulMsgLen,
-                                          JSON_DocModel_t * pxDocModel )
+static void prvOTAUpdateTask( void * pvUnused )
 {
-    DEFINE_OTA_METHOD_NAME( "prvParseJSONbyModel" );
-
-    const JSON_DocParam_t * pxModelParam;
-    jsmn_parser xParser;
-    jsmntok_t * pxTokens;
-    jsmntok_t * pxValTok;
-    uint32_t ulNumTokens, ulTokenLen;
-    MultiParmPtr_t xParamAddr; /*lint !e9018 We intentionally use this union to cast the parameter address to the proper type. */
-    uint32_t ulIndex;
-    uint16_t usModelParamIndex;
-    uint32_t ulScanIndex;
-    DocParseErr_t eErr = eDocParseErr_Unknown;
+    DEFINE_OTA_METHOD_NAME( "prvOTAUpdateTask" );
 
+    EventBits_t xBits;
+    OTA_FileContext_t * pxC = NULL;
+    const MQTTPublishData_t * pxLentPubData;
+    OTA_Err_t xErr;
 
-    /* Reset the Jasmine tokenizer. */
-    jsmn_init( &xParser );
+    ( void ) pvUnused;
+    OTA_PubMsg_t xMsgMetaData;
 
-    /* Validate some initial parameters. */
-    if( pxDocModel == NULL )
-    {
-        OTA_LOG_L1( "[%s] The pointer to the document model is NULL.\r\n", OTA_METHOD_NAME );
-        eErr = eDocParseErr_NullModelPointer;
-    }
-    else if( pxDocModel->pxBodyDef == NULL )
-    {
-        OTA_LOG_L1( "[%s] Document model 0x%08x body pointer is NULL.\r\n", OTA_METHOD_NAME, pxDocModel );
-        eErr = eDocParseErr_NullBodyPointer;
-    }
-    else if( pxDocModel->usNumModelParams > OTA_DOC_MODEL_MAX_PARAMS )
-    {
-        OTA_LOG_L1( "[%s] Model has too many parameters (%u).\r\n", OTA_METHOD_NAME, pxDocModel->usNumModelParams );
-        eErr = eDocParseErr_TooManyParams;
-    }
-    else if( pcJSON == NULL )
-    {
-        OTA_LOG_L1( "[%s] JSON document pointer is NULL!\r\n", OTA_METHOD_NAME );
-        eErr = eDocParseErr_NullDocPointer;
-    }
-    else
+    /* Subscribe to the OTA job notification topic. */
+    if( prvSubscribeToJobNotificationTopics() == ( bool_t ) pdTRUE )
     {
-        pxModelParam = pxDocModel->pxBodyDef;
-
-        /* Count the total number of tokens in our JSON document. */
-        ulNumTokens = ( uint32_t ) jsmn_parse( &xParser, pcJSON, ( size_t ) ulMsgLen, NULL, 1UL );
+        xOTA_Agent.xOTA_EventFlags = xEventGroupCreate();
 
-        if( ulNumTokens > 0U )
+        if( xOTA_Agent.xOTA_EventFlags != NULL )
         {
-            /* If the JSON document isn't too big for our token array... */
-            if( ulNumTokens <= OTA_MAX_JSON_TOKENS )
-            {
-                /* Allocate space for the document JSON tokens. */
-                void * pvTokenArray = pvPortMalloc( ulNumTokens * sizeof( jsmntok_t ) ); /* Allocate space on heap for temporary token array. */
-                pxTokens = ( jsmntok_t * ) pvTokenArray;                                 /*lint !e9079 !e9087 heap allocations return void* so we allow casting to a pointer to the actual type. */
-
-                if( pxTokens != NULL )
-                {
-                    /* Reset Jasmine again and tokenize the document for real. */
-                    jsmn_init( &xParser );
-                    ulIndex = ( uint32_t ) jsmn_parse( &xParser, pcJSON, ulMsgLen, pxTokens, ulNumTokens );
+            /* Check if the firmware image is in self test mode. If so, enable the self test timer. */
+            ( void ) OTA_CheckForSelfTest();
 
-                    if( ulIndex == ulNumTokens )
-                    {
-                        /* Start the parser in an error free state. */
-                        eErr = eDocParseErr_None;
+            /*Save the self-test mode in a flag. This flag is cleared when self-test is successful.*/
+            xInSelfTest = prvInSelftest();
 
-                        /* Examine each JSON token, searching for job parameters based on our document model. */
-                        for( ulIndex = 0U; ( eErr == eDocParseErr_None ) && ( ulIndex < ulNumTokens ); ulIndex++ )
-                        {
-                            /* All parameter keys are JSON strings. */
-                            if( pxTokens[ ulIndex ].type == JSMN_STRING )
-                            {
-                                /* Search the document model to see if it matches the current key. */
-                                ulTokenLen = ( uint32_t ) pxTokens[ ulIndex ].end - ( uint32_t ) pxTokens[ ulIndex ].start;
-                                eErr = prvSearchModelForTokenKey( pxDocModel, &pcJSON[ pxTokens[ ulIndex ].start ], ulTokenLen, &usModelParamIndex );
+            /* Send a request to the job service for the latest available job. */
+            ( void ) OTA_CheckForUpdate();
 
-                                /* If we didn't find a match in the model, skip over it and its descendants. */
-                                if( eErr == eDocParseErr_ParamKeyNotInModel )
-                                {
-                                    int32_t lRoot = ( int32_t ) ulIndex; /* Create temp root from the unrecognized tokens index. Use signed int since the parent index is signed. */
-                                    ulIndex++;                           /* Skip the active key since it's the one we don't recognize. */
+            /* Put the OTA agent in the ready state. */
+            xOTA_Agent.eState = eOTA_AgentState_Ready;
 
-                                    /* Skip tokens whose parents are equal to or deeper than the unrecognized temporary root token level. */
-                                    while( ( ulIndex < ulNumTokens ) && ( pxTokens[ ulIndex ].parent >= lRoot ) )
-                                    {
-                                        ulIndex++; /* Skip over all descendants of the unknown parent. */
-                                    }
+            for( ; ; )
+            {
+                xOTA_Agent.xWaitingForEvents = pdTRUE;
 
-                                    --ulIndex;                /* Adjust for outer for-loop increment. */
-                                    eErr = eDocParseErr_None; /* Unknown key structures are simply skipped so clear the error state to continue. */
-                                }
-                                else if( eErr == eDocParseErr_None )
-                                {
-                                    /* We found the parameter key in the document model. */
+                xBits = xEventGroupWaitBits(
+                    xOTA_Agent.xOTA_EventFlags, /* The event group being tested. */
+                    OTA_EVT_MASK_ALL_EVENTS,    /* The bits within the event group to wait for. */
+                    pdTRUE,                     /* Bits should be cleared before returning. */
+                    pdFALSE,                    /* Any bit set will do. */
+                    ( TickType_t ) ~( 0U ) );   /* Wait forever. */
 
-                                    /* Get the value field (i.e. the following token) for the parameter. */
-                                    pxValTok = &pxTokens[ ulIndex + 1UL ];
+                /* Take a stream message the MQTT task lent while we were waiting and ingest it
+                 * before any event is handled, since the MQTT task waits until it is returned. */
+                taskENTER_CRITICAL();
+                {
+                    xOTA_Agent.xWaitingForEvents = pdFALSE;
+                    pxLentPubData = xOTA_Agent.pxLentPubData;
+                    xOTA_Agent.pxLentPubData = NULL;
+                }
+                taskEXIT_CRITICAL();
 
-                                    /* Verify the field type is what we expect for this parameter. */
-                                    if( pxValTok->type != pxModelParam[ usModelParamIndex ].eJasmineType )
-                                    {
-                                        ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
-                                        OTA_LOG_L1( "[%s] parameter type mismatch [ %s : %.*s ] type %u, expected %u\r\n",
-                                                    OTA_METHOD_NAME, pxModelParam[ usModelParamIndex ].pcSrcKey, ulTokenLen,
-                                                    &pcJSON[ pxValTok->start ],
-                                                    pxValTok->type, pxModelParam[ usModelParamIndex ].eJasmineType );
-                                        eErr = eDocParseErr_FieldTypeMismatch;
-                                        /* break; */
-                                    }
-                                    else if( OTA_DONT_STORE_PARAM == pxModelParam[ usModelParamIndex ].ulDestOffset )
-                                    {
-                                        /* Nothing to do with this parameter since we're not storing it. */
-                                        continue;
-                                    }
-                                    else
-                                    {
-                                        /* Get destination offset to parameter storage location. */
+                if( pxLentPubData != NULL )
+                {
+                    pxC = prvProcessOTAStreamMsg( pxC, pxLentPubData, pdTRUE );
+                    xOTA_Agent.xStatistics.ulOTA_PacketsProcessed++;
+                }
 
-                                        /* If it's within the models context structure, add in the context instance base address. */
-                                        if( pxModelParam[ usModelParamIndex ].ulDestOffset < pxDocModel->ulContextSize )
-                                        {
-                                            xParamAddr.ulVal = pxDocModel->ulContextBase + pxModelParam[ usModelParamIndex ].ulDestOffset;
-                                        }
-                                        else
-                                        {
-                                            /* It's a raw pointer so keep it as is. */
-                                            xParamAddr.ulVal = pxModelParam[ usModelParamIndex ].ulDestOffset;
-                                        }
+                /* Check for the shutdown event. */
+                if( ( ( uint32_t ) xBits & OTA_EVT_MASK_SHUTDOWN ) != 0U )
+                {
+                    OTA_LOG_L1( "[%s] Received shutdown event.\r\n", OTA_METHOD_NAME );
+                    break; /* Break, so we stop all OTA processing. */
+                }
 
-                                        if( eModelParamType_StringCopy == pxModelParam[ usModelParamIndex ].xModelParamType )
-                                        {
-                                            /* Malloc memory for a copy of the value string plus a zero terminator. */
-                                            ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
-                                            void * pvStringCopy = pvPortMalloc( ulTokenLen + 1U );
+                /* Check for a user initiated abort. */
+                if( ( ( ( uint32_t ) xBits & OTA_EVT_MASK_USER_ABORT ) != 0U ) && ( pxC != NULL ) )
+                {
+                    OTA_LOG_L1( "[%s] Received user abort event.\r\n", OTA_METHOD_NAME );
+                    ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, kOTA_Err_UserAbort );
+                    prvEraseCheckpoint( pxC );
+                    ( void ) prvOTA_Close( pxC ); /* Ignore false result since we're setting the pointer to null on the next line. */
+                    pxC = NULL;
+                }
 
-                                            if( pvStringCopy != NULL )
-                                            {
-                                                *xParamAddr.ppvPtr = pvStringCopy;
-                                                char * pcStringCopy = *xParamAddr.ppcPtr;
-                                                /* Copy parameter string into newly allocated memory. */
-                                                memcpy( pcStringCopy, &pcJSON[ pxValTok->start ], ulTokenLen );
-                                                /* Zero terminate the new string. */
-                                                pcStringCopy[ ulTokenLen ] = '\0';
-                                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %s ]\r\n",
-                                                            OTA_METHOD_NAME,
-                                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
-                                                            pcStringCopy );
-                                            }
-                                            else
-                                            {
-                                                /* Stop processing on error. */
-                                                eErr = eDocParseErr_OutOfMemory;
-                                                /* break; */
-                                            }
-                                        }
-                                        else if( eModelParamType_StringInDoc == pxModelParam[ usModelParamIndex ].xModelParamType )
-                                        {
-                                            /* Copy pointer to source string instead of duplicating the string. */
-                                            const char * pcStringInDoc = &pcJSON[ pxValTok->start ];
+                /* On OTA request timer timeout or when block ranges are due, publish the stream request if we have context. */
+                if( ( ( xBits & ( OTA_EVT_MASK_REQ_TIMEOUT | OTA_EVT_MASK_REQ_RANGES ) ) != 0U ) && ( pxC != NULL ) )
+                {
+                    if( pxC->ulBlocksRemaining > 0U )
+                    {
+                        xErr = prvPublishGetStreamMessage( pxC );
 
-                                            if( pcStringInDoc != NULL ) /*lint !e774 This can result in NULL if offset rolls the address around. */
-                                            {
-                                                *xParamAddr.ppcConstPtr = pcStringInDoc;
-                                                ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
-                                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %.*s ]\r\n",
-                                                            OTA_METHOD_NAME,
-                                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
-                                                            ulTokenLen, pcStringInDoc );
-                                            }
-                                            else
-                                            {
-                                                /* This should never happen unless there's a bug or memory is corrupted. */
-                                                OTA_LOG_L1( "[%s] Error! JSON token produced a null pointer for parameter [ %s ]\r\n",
-                                                            OTA_METHOD_NAME,
-                                                            pxModelParam[ usModelParamIndex ].pcSrcKey );
-                                                eErr = eDocParseErr_InvalidToken;
-                                            }
-                                        }
-                                        else if( eModelParamType_UInt32 == pxModelParam[ usModelParamIndex ].xModelParamType )
-                                        {
-                                            char * pcEnd;
-                                            const char * pcStart = &pcJSON[ pxValTok->start ];
-                                            *xParamAddr.pulPtr = strtoul( pcStart, &pcEnd, 0 );
+                        if( xErr != kOTA_Err_None )
+                        {                                 /* Abort the current OTA. */
+                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, xErr );
+                            ( void ) prvOTA_Close( pxC ); /* Ignore false result since we're setting the pointer to null on the next line. */
+                            pxC = NULL;
+                        }
+                    }
+                    else
+                    {
+                        /* If there are no blocks remaining, this may have been in flight when the
+                         * last block was received. Just ignore it since it will be cleaned up by
+                         * the agent as required. */
+                    }
+                }
 
-                                            if( pcEnd == &pcJSON[ pxValTok->end ] )
-                                            {
-                                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %u ]\r\n",
-                                                            OTA_METHOD_NAME,
-                                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
-                                                            *xParamAddr.pulPtr );
-                                            }
-                                            else
-                                            {
-                                                eErr = eDocParseErr_InvalidNumChar;
-                                            }
-                                        }
-                                        else if( eModelParamType_SigBase64 == pxModelParam[ usModelParamIndex ].xModelParamType )
-                                        {
-                                            /* Allocate space for and decode the base64 signature. */
-                                            void * pvSignature = pvPortMalloc( sizeof( Sig256_t ) );
+                /* Check if a MQTT message is ready for us to process. */
+                if( ( xBits & OTA_EVT_MASK_MSG_READY ) != 0U )
+                {
+                    xMsgMetaData.xPubData.xBuffer = NULL;
 
-                                            if( pvSignature != NULL )
-                                            {
-                                                size_t xActualLen;
-                                                *xParamAddr.ppvPtr = pvSignature;
-                                                Sig256_t * pxSig256 = *xParamAddr.ppxSig256Ptr;
-                                                ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
+                    if( ( xOTA_Agent.eState == eOTA_AgentState_Ready ) || ( xOTA_Agent.eState == eOTA_AgentState_Active ) )
+                    {
+                        while( xQueueReceive( xOTA_Agent.xOTA_MsgQ, &xMsgMetaData, 0 ) != pdFALSE )
+                        {
+                            /* Check for OTA update job messages. */
+                            if( xMsgMetaData.eMsgType == eOTA_PubMsgType_Job )
+                            {
+                                if( pxC != NULL )
+                                {
+                                    ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, kOTA_Err_UserAbort );
+                                    ( void ) prvOTA_Close( pxC ); /* Abort the existing OTA and ignore impossible false result by design. */
+                                }
 
-                                                if( mbedtls_base64_decode( pxSig256->ucData, sizeof( pxSig256->ucData ), &xActualLen,
-                                                                           ( const uint8_t * ) &pcJSON[ pxValTok->start ], ulTokenLen ) != 0 )
-                                                {
-                                                    /* Stop processing on error. */
-                                                    OTA_LOG_L1( "[%s] mbedtls_base64_decode failed.\r\n", OTA_METHOD_NAME );
-                                                    eErr = eDocParseErr_Base64Decode;
-                                                    /* break; */
-                                                }
-                                                else
-                                                {
-                                                    pxSig256->usSize = ( uint16_t ) xActualLen;
-                                                    OTA_LOG_L1( "[%s] Extracted parameter [ %s: %.32s... ]\r\n",
-                                                                OTA_METHOD_NAME,
-                                                                pxModelParam[ usModelParamIndex ].pcSrcKey,
-                                                                &pcJSON[ pxValTok->start ] );
-                                                }
-                                            }
-                                            else
-                                            {
-                                                /* We failed to allocate needed memory. Everything will be freed below upon failure. */
-                                                eErr = eDocParseErr_OutOfMemory;
-                                            }
-                                        }
-                                        else if( eModelParamType_Ident == pxModelParam[ usModelParamIndex ].xModelParamType )
+                                pxC = prvProcessOTAJobMsg( ( const char * ) xMsgMetaData.xPubData.pvData, /*lint !e9079 pointer to void is OK to cast to the real type. */
+                                                           xMsgMetaData.xPubData.ulDataLength );
+
+                                /* A null context here could either mean we didn't receive a valid job or it could
+                                 * signify that we're in the self test phase (where the OTA file transfer is already
+                                 * completed and we've reset the device and are now running the new firmware). We
+                                 * will check the state to determine which case we're in. */
+                                if( pxC == NULL )
+                                {
+                                    /* If the OTA job is in the self_test state, alert the application layer. */
+                                    if( OTA_GetImageState() == eOTA_ImageState_Testing )
+                                    {
+                                        /* Check the platform's OTA update image state. It should also be in self test. */
+                                        if( OTA_CheckForSelfTest() == pdTRUE )
                                         {
-                                            OTA_LOG_L1( "[%s] Identified parameter [ %s ]\r\n",
-                                                        OTA_METHOD_NAME,
-                                                        pxModelParam[ usModelParamIndex ].pcSrcKey );
-                                            *xParamAddr.pxBoolPtr = pdTRUE;
+                                            xOTA_Agent.xOTAJobCompleteCallback( eOTA_JobEvent_StartTest );
                                         }
                                         else
                                         {
-                                            /* Ignore invalid document model type. */
+                                            /* The job is in self test but the platform image state is not so it could be
+                                             * an attack on the platform image state. Reject the update (this should also
+                                             * cause the image to be erased), aborting the job and reset the device. */
+                                            OTA_LOG_L1( "[%s] Job in self test but platform state is not!\r\n", OTA_METHOD_NAME );
+                                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Rejected, kOTA_Err_ImageStateMismatch );
+                                            ( void ) prvResetDevice(); /* Ignore return code since there's nothing we can do if we can't force reset. */
                                         }
                                     }
                                 }
                                 else
                                 {
-                                    /* Nothing special to do. The error will break us out of the loop. */
+                                    xOTA_Agent.eState = eOTA_AgentState_Active;
                                 }
                             }
+                            /* It's not a job message, maybe it's a data stream message... */
+                            else if( xMsgMetaData.eMsgType == eOTA_PubMsgType_Stream )
+                            {
+                                pxC = prvProcessOTAStreamMsg( pxC, &xMsgMetaData.xPubData, pdFALSE );
+                            }
                             else
                             {
-                                /* Ignore tokens that are not strings and move on to the next. */
+                                /* Ignore unknown message types. */
+                                OTA_LOG_L2( "[%s] Ignoring unknown message type %d.\r\n", OTA_METHOD_NAME, xMsgMetaData.lMsgType );
                             }
-                        }
 
-                        /* Free the token memory. */
-                        vPortFree( pxTokens ); /*lint !e850 ulIndex is intentionally modified within the loop to skip over unknown tags. */
+                            if( xMsgMetaData.xPubData.xBuffer != NULL )
+                            {
+                                xOTA_Agent.xStatistics.ulOTA_PacketsProcessed++;
 
-                        if( eErr == eDocParseErr_None )
-                        {
-                            uint32_t ulMissingParams = ( pxDocModel->ulParamsReceivedBitmap & pxDocModel->ulParamsRequiredBitmap )
-                                                       ^ pxDocModel->ulParamsRequiredBitmap;
-
-                            if( ulMissingParams != 0U )
-                            {
-                                /* The job document did not have all required document model parameters. */
-                                for( ulScanIndex = 0UL; ulScanIndex < pxDocModel->usNumModelParams; ulScanIndex++ )
+                                /* Return the MQTT buffer since we're done with it (even if we ignored the message). */
+                                if( ( MQTT_AGENT_ReturnBuffer( xOTA_Agent.pvPubSubClient, xMsgMetaData.xPubData.xBuffer ) ) == eMQTTAgentSuccess )
                                 {
-                                    if( ( ulMissingParams & ( 1UL << ulScanIndex ) ) != 0UL )
-                                    {
-                                        OTA_LOG_L1( "[%s] parameter not present: %s\r\n",
-                                                    OTA_METHOD_NAME,
-                                                    pxModelParam[ ulScanIndex ].pcSrcKey );
-                                    }
+                                    OTA_LOG_L2( "[%s] Returned buffer to MQTT client.\r\n", OTA_METHOD_NAME );
+                                }
+                                else
+                                {
+                                    OTA_LOG_L1( "[%s] MQTT_AGENT_ReturnBuffer() failed.\r\n", OTA_METHOD_NAME );
+                                    break;
                                 }
-
-                                eErr = eDocParseErr_MalformedDoc;
+                            }
+                            else
+                            {
+                                /* Safety ignore messages not associated with an MQTT buffer. */
                             }
                         }
-                        else
-                        {
-                            OTA_LOG_L1( "[%s] Error (%d) parsing JSON document.\r\n", OTA_METHOD_NAME, ( int32_t ) eErr );
-                        }
+                    }
+                }
+
+                if( pxC == NULL )
+                {
+                    /* Any event that releases the context structure tells us we're not active anymore. */
+                    xOTA_Agent.eState = eOTA_AgentState_Ready;
+                }
+            }
+
+            /* If we're here, we're shutting down the OTA agent. Free up all resources and quit. */
+            prvAgentShutdownCleanup( &xMsgMetaData );
+            vEventGroupDelete( xOTA_Agent.xOTA_EventFlags );
+        }
+    }
+
+    /* Clear the entire agent context. This includes the OTA agent state. */
+    memset( &xOTA_Agent, 0, sizeof( xOTA_Agent ) );
+
+    /* Reset the image and agent states. Possibly redundant but safer.
+     * Finally, self destruct. */
+    xOTA_Agent.eImageState = eOTA_ImageState_Unknown;
+    xOTA_Agent.eState = eOTA_AgentState_NotReady;
+    vTaskDelete( NULL );
+}
+
+
+/* If we're in self test mode, start the self test timer. The latest job should
+ * also be in the self test state. We must complete the self test and either
+ * accept or reject the image before the timer expires or we shall reset the
+ * device to initiate a roll back of the MCU firmware bundle. This will catch
+ * issues like improper credentials or a device that is connected to a non-
+ * production stage of the job service resulting in a different job queue being
+ * used.
+ */
+static BaseType_t OTA_CheckForSelfTest( void )
+{
+    DEFINE_OTA_METHOD_NAME( "OTA_CheckForSelfTest" );
+    static const char cTimerName[] = "OTA_SelfTest";
+    BaseType_t xTimerStarted = pdFALSE;
+    static StaticTimer_t xTimerBuffer;
+
+    if( prvPAL_GetPlatformImageState() == eOTA_PAL_ImageState_PendingCommit )
+    {
+        if( xOTA_Agent.xSelfTestTimer == NULL )
+        {
+            xOTA_Agent.xSelfTestTimer = xTimerCreateStatic( cTimerName,
+                                                            pdMS_TO_TICKS( otaconfigSELF_TEST_RESPONSE_WAIT_MS ),
+                                                            pdFALSE, NULL, prvSelfTestTimer_Callback,
+                                                            &xTimerBuffer );
+
+            if( xOTA_Agent.xSelfTestTimer != NULL )
+            {
+                xTimerStarted = xTimerStart( xOTA_Agent.xSelfTestTimer, portMAX_DELAY );
+            }
+            else
+            {
+                /* Static timers are guaranteed to be created unless we pass in a NULL buffer. */
+            }
+        }
+        else
+        {
+            xTimerStarted = xTimerReset( xOTA_Agent.xSelfTestTimer, portMAX_DELAY );
+        }
+
+        /* Common check for whether the timer was started or not. It should be impossible to not start. */
+        if( xTimerStarted == pdTRUE )
+        {
+            OTA_LOG_L1( "[%s] Starting %s timer.\r\n", OTA_METHOD_NAME, cTimerName );
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] ERROR: failed to reset/start %s timer.\r\n", OTA_METHOD_NAME, cTimerName );
+        }
+    }
+
+    return xTimerStarted;
+}
+
+
+/* When the self test response timer expires, reset the device since we're likely broken. */
+
+static void prvSelfTestTimer_Callback( TimerHandle_t T )
+{
+    DEFINE_OTA_METHOD_NAME( "prvSelfTestTimer_Callback" );
+    ( void ) T;
+
+    OTA_LOG_L1( "[%s] Self test failed to complete within %ums\r\n", OTA_METHOD_NAME, otaconfigSELF_TEST_RESPONSE_WAIT_MS );
+    ( void ) prvPAL_ResetDevice();
+}
+
+
+/* Stop the OTA self test timer if it is running. */
+
+static void prvStopSelfTestTimer( void )
+{
+    DEFINE_OTA_METHOD_NAME( "prvStopSelfTestTimer" );
+
+    if( xOTA_Agent.xSelfTestTimer != NULL )
+    {
+        ( void ) xTimerStop( xOTA_Agent.xSelfTestTimer, portMAX_DELAY );
+        OTA_LOG_L1( "[%s] Stopping the self test timer.\r\n", OTA_METHOD_NAME );
+    }
+}
+
+
+/* When the OTA request timer expires, signal the OTA task to request the file. */
+
+static void prvRequestTimer_Callback( TimerHandle_t T )
+{
+    ( void ) T;
+
+    if( xOTA_Agent.xOTA_EventFlags != NULL )
+    {
+        ( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_REQ_TIMEOUT );
+    }
+}
+
+
+/* Create and start or reset the OTA request timer to expire at the earliest block range deadline.
+ * Do not output an important log message on reset since this gets called every time a file
+ * block is received. Use log level 2 at most.
+ */
+static void prvStartRequestTimer( OTA_FileContext_t * C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvStartRequestTimer" );
+    static const char cTimerName[] = "OTA_FileRequest";
+
+    BaseType_t xTimerStarted = pdFALSE;
+
+    TickType_t xTimerTicks = prvGetRequestTimerTicks();
+
+    if( C->xRequestTimer == NULL )
+    {
+        C->xRequestTimer = xTimerCreate( cTimerName,
+                                         xTimerTicks,
+                                         pdFALSE,
+                                         ( void * ) C, /*lint !e9087 Using the file context as the timer ID does not cause undefined behavior. */
+                                         prvRequestTimer_Callback );
+
+        if( C->xRequestTimer != NULL )
+        {
+            xTimerStarted = xTimerStart( C->xRequestTimer, 0 );
+        }
+    }
+    else
+    {
+        /* Changing the period also restarts the timer from now. */
+        xTimerStarted = xTimerChangePeriod( C->xRequestTimer, xTimerTicks, portMAX_DELAY );
+    }
+
+    if( xTimerStarted == pdTRUE )
+    {
+        OTA_LOG_L2( "[%s] Starting %s timer.\r\n", OTA_METHOD_NAME, cTimerName );
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] ERROR: failed to reset/start %s timer.\r\n", OTA_METHOD_NAME, cTimerName );
+    }
+}
+
+
+/* Stop the firmware request timer if it is running. */
+
+static void prvStopRequestTimer( OTA_FileContext_t * C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvStopRequestTimer" );
+
+    if( C->xRequestTimer != NULL )
+    {
+        ( void ) xTimerStop( C->xRequestTimer, 0 );
+        OTA_LOG_L1( "[%s] Stopping file request timer.\r\n", OTA_METHOD_NAME );
+    }
+}
+
+
+/* Close an existing OTA context and free its resources. */
+
+static bool_t prvOTA_Close( OTA_FileContext_t * const C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvOTA_Close" );
+
+    bool_t xResult = pdFALSE;
+
+    OTA_LOG_L1( "[%s] Context->0x%08x\r\n", OTA_METHOD_NAME, C );
+
+    if( C != NULL )
+    {
+        /* Stop and delete any existing transfer request timer. */
+        if( C->xRequestTimer != NULL )
+        {
+            ( void ) xTimerStop( C->xRequestTimer, 0 );
+            ( void ) xTimerDelete( C->xRequestTimer, 0 );
+            C->xRequestTimer = NULL;
+        }
+
+        if( C->pucStreamName != NULL )
+        {
+            ( void ) prvUnSubscribeFromDataStream( C ); /* Unsubscribe from the data stream if needed. */
+            vPortFree( C->pucStreamName );              /* Free any previously allocated stream name memory. */
+            C->pucStreamName = NULL;
+        }
+
+        if( C->pucJobName != NULL )
+        {
+            vPortFree( C->pucJobName ); /* Free the job name memory. */
+            C->pucJobName = NULL;
+        }
+
+        if( C->pucRxBlockBitmap != NULL )
+        {
+            vPortFree( C->pucRxBlockBitmap ); /* Free the previously allocated block bitmap. */
+            C->pucRxBlockBitmap = NULL;
+        }
+
+        if( C->pxSignature != NULL )
+        {
+            vPortFree( C->pxSignature ); /* Free the image signature memory. */
+            C->pxSignature = NULL;
+        }
+
+        if( C->pxBaseHash != NULL )
+        {
+            vPortFree( C->pxBaseHash ); /* Free the base image hash memory. */
+            C->pxBaseHash = NULL;
+        }
+
+        if( C->pucFilePath != NULL )
+        {
+            vPortFree( C->pucFilePath ); /* Free the file path name string memory. */
+            C->pucFilePath = NULL;
+        }
+
+        if( C->pucCertFilepath != NULL )
+        {
+            vPortFree( C->pucCertFilepath ); /* Free the certificate path name string memory. */
+            C->pucCertFilepath = NULL;
+        }
+
+        /* Release the running file hash if the PAL did not finish it. */
+        prvStopFileHash();
+        prvStopDecoding();
+        prvStopWriteBehind(); /* Before the PAL aborts the file, since pages may still be written. */
+
+        if( C->pvSigVerifyContext != NULL )
+        {
+            ( void ) CRYPTO_SignatureVerificationFinal( C->pvSigVerifyContext, NULL, 0, NULL, 0 );
+            C->pvSigVerifyContext = NULL;
+        }
+
+        /* Abort any active file access and release the file resource, if needed. */
+        ( void ) prvPAL_Abort( C );
+        memset( C, 0, sizeof( OTA_FileContext_t ) ); /* Clear the entire structure now that it is free. */
+        xResult = pdTRUE;
+    }
+
+    return xResult;
+}
+
+
+/* Find an available OTA transfer context structure. */
+
+static OTA_FileContext_t * prvGetFreeContext( void )
+{
+    uint32_t ulIndex = 0U;
+    OTA_FileContext_t * pxC = NULL;
+
+    while( ( ulIndex < OTA_MAX_FILES ) && ( xOTA_Agent.xOTA_Files[ ulIndex ].pucFilePath != NULL ) )
+    {
+        ulIndex++;
+    }
+
+    if( ulIndex != OTA_MAX_FILES )
+    {
+        memset( &xOTA_Agent.xOTA_Files[ ulIndex ], 0, sizeof( OTA_FileContext_t ) );
+        pxC = &xOTA_Agent.xOTA_Files[ ulIndex ];
+    }
+    else
+    {
+        /* Not able to support this request so we'll return NULL. */
+    }
+
+    return pxC;
+}
+
+
+bool_t JSON_IsCStringEqual( const char * pcJSONString,
+                            uint32_t ulLen,
+                            const char * pcCString )
+{
+    bool_t xResult;
+
+    if( ( ulLen <= OTA_MAX_JSON_STR_LEN ) &&
+        ( strncmp( pcJSONString, pcCString, ulLen ) == 0 ) && /*lint !e9007 I see no side effect. Possibly a lint bug. */
+        ( pcCString[ ulLen ] == '\0' ) )
+    {
+        xResult = pdTRUE;
+    }
+    else
+    {
+        xResult = pdFALSE;
+    }
+
+    return xResult;
+}
+
+
+/* Search our document model for a key match with the given token. The key is hashed to its slot
+ * in the key index of the model, so only the keys that hash to the same slot are compared. */
+
+static DocParseErr_t prvSearchModelForTokenKey( JSON_DocModel_t * pxDocModel,
+                                                const char * pcJSONString,
+                                                uint32_t ulStrLen,
+                                                uint16_t * pusMatchingIndexResult )
+{
+    DocParseErr_t eErr = eDocParseErr_ParamKeyNotInModel;
+    uint16_t usParamIndex;
+    uint32_t ulSlot;
+
+    ulSlot = prvChecksum( OTA_FNV_OFFSET_BASIS, ( const uint8_t * ) pcJSONString, ulStrLen ) & ( OTA_DOC_MODEL_INDEX_SLOTS - 1U );
+
+    /* The index always has empty slots, so the search ends at the first one. */
+    while( pxDocModel->ucKeyIndex[ ulSlot ] != 0U )
+    {
+        usParamIndex = ( uint16_t ) pxDocModel->ucKeyIndex[ ulSlot ] - 1U;
+
+        if( JSON_IsCStringEqual( pcJSONString, ulStrLen,
+                                 pxDocModel->pxBodyDef[ usParamIndex ].pcSrcKey ) == ( bool_t ) pdTRUE )
+        {
+            /* Per Security, don't allow multiple entries of the same parameter. */
+            if( ( pxDocModel->ulParamsReceivedBitmap & ( 1U << usParamIndex ) ) != 0U ) /*lint !e9032 usParamIndex will never be greater than kDocModel_MaxParams, which is the the size of the bitmap. */
+            {
+                eErr = eDocParseErr_DuplicatesNotAllowed;
+            }
+            else
+            {
+                /* Mark parameter as received in the bitmap. */
+                pxDocModel->ulParamsReceivedBitmap |= ( 1U << usParamIndex ); /*lint !e9032 usParamIndex will never be greater than kDocModel_MaxParams, which is the the size of the bitmap. */
+                *pusMatchingIndexResult = usParamIndex;                       /* Save result index for caller. */
+                eErr = eDocParseErr_None;                                     /* We found a matching key in the document model. */
+            }
+
+            break; /* We found a key match so stop searching. */
+        }
+
+        ulSlot = ( ulSlot + 1U ) & ( OTA_DOC_MODEL_INDEX_SLOTS - 1U );
+    }
+
+    return eErr;
+}
+
+
+
+/* Extract the desired fields from the JSON document based on the specified document model. */
+
+static DocParseErr_t prvParseJSONbyModel( const char * pcJSON,
+                                          uint32_t ulMsgLen,
+                                          JSON_DocModel_t * pxDocModel )
+{
+    DEFINE_OTA_METHOD_NAME( "prvParseJSONbyModel" );
+
+    const JSON_DocParam_t * pxModelParam;
+    jsmn_parser xParser;
+    jsmntok_t * pxTokens;
+    jsmntok_t * pxValTok;
+    uint32_t ulNumTokens, ulTokenLen;
+    int32_t lNumTokens;
+    MultiParmPtr_t xParamAddr; /*lint !e9018 We intentionally use this union to cast the parameter address to the proper type. */
+    uint32_t ulIndex;
+    uint16_t usModelParamIndex;
+    uint32_t ulScanIndex;
+    DocParseErr_t eErr = eDocParseErr_Unknown;
+
+
+    /* Reset the Jasmine tokenizer. */
+    jsmn_init( &xParser );
+
+    /* Validate some initial parameters. */
+    if( pxDocModel == NULL )
+    {
+        OTA_LOG_L1( "[%s] The pointer to the document model is NULL.\r\n", OTA_METHOD_NAME );
+        eErr = eDocParseErr_NullModelPointer;
+    }
+    else if( pxDocModel->pxBodyDef == NULL )
+    {
+        OTA_LOG_L1( "[%s] Document model 0x%08x body pointer is NULL.\r\n", OTA_METHOD_NAME, pxDocModel );
+        eErr = eDocParseErr_NullBodyPointer;
+    }
+    else if( pxDocModel->usNumModelParams > OTA_DOC_MODEL_MAX_PARAMS )
+    {
+        OTA_LOG_L1( "[%s] Model has too many parameters (%u).\r\n", OTA_METHOD_NAME, pxDocModel->usNumModelParams );
+        eErr = eDocParseErr_TooManyParams;
+    }
+    else if( pcJSON == NULL )
+    {
+        OTA_LOG_L1( "[%s] JSON document pointer is NULL!\r\n", OTA_METHOD_NAME );
+        eErr = eDocParseErr_NullDocPointer;
+    }
+    else
+    {
+        pxModelParam = pxDocModel->pxBodyDef;
+
+        /* Allocate space for as many JSON tokens as we support. */
+        void * pvTokenArray = pvPortMalloc( otaconfigMAX_JSON_TOKENS * sizeof( jsmntok_t ) ); /* Allocate space on heap for temporary token array. */
+        pxTokens = ( jsmntok_t * ) pvTokenArray;                                               /*lint !e9079 !e9087 heap allocations return void* so we allow casting to a pointer to the actual type. */
+
+        if( pxTokens != NULL )
+        {
+            /* Tokenize the document once, into as many tokens as there is room for. */
+            lNumTokens = jsmn_parse( &xParser, pcJSON, ( size_t ) ulMsgLen, pxTokens, otaconfigMAX_JSON_TOKENS );
+
+            /* If the JSON document isn't too big for our token array... */
+            if( lNumTokens != ( int32_t ) JSMN_ERROR_NOMEM )
+            {
+                if( lNumTokens > 0 )
+                {
+                    ulNumTokens = ( uint32_t ) lNumTokens;
+
+                    /* The parameter keys are those of the document object and of the objects in it. */
+                    if( pxTokens[ 0 ].type == JSMN_OBJECT )
+                    {
+                        /* Start the parser in an error free state. */
+                        eErr = eDocParseErr_None;
+
+                        /* Examine each JSON token, searching for job parameters based on our document model. */
+                        for( ulIndex = 0U; ( eErr == eDocParseErr_None ) && ( ulIndex < ulNumTokens ); ulIndex++ )
+                        {
+                            /* All parameter keys are JSON strings whose parent is an object. String values
+                             * and array elements are never keys, so they are not searched for. */
+                            if( ( pxTokens[ ulIndex ].type == JSMN_STRING ) &&
+                                ( pxTokens[ ulIndex ].parent >= 0 ) &&
+                                ( pxTokens[ pxTokens[ ulIndex ].parent ].type == JSMN_OBJECT ) )
+                            {
+                                /* Search the document model to see if it matches the current key. */
+                                ulTokenLen = ( uint32_t ) pxTokens[ ulIndex ].end - ( uint32_t ) pxTokens[ ulIndex ].start;
+                                eErr = prvSearchModelForTokenKey( pxDocModel, &pcJSON[ pxTokens[ ulIndex ].start ], ulTokenLen, &usModelParamIndex );
+
+                                /* If we didn't find a match in the model, skip over it and its descendants. */
+                                if( eErr == eDocParseErr_ParamKeyNotInModel )
+                                {
+                                    int32_t lRoot = ( int32_t ) ulIndex; /* Create temp root from the unrecognized tokens index. Use signed int since the parent index is signed. */
+                                    ulIndex++;                           /* Skip the active key since it's the one we don't recognize. */
+
+                                    /* Skip tokens whose parents are equal to or deeper than the unrecognized temporary root token level. */
+                                    while( ( ulIndex < ulNumTokens ) && ( pxTokens[ ulIndex ].parent >= lRoot ) )
+                                    {
+                                        ulIndex++; /* Skip over all descendants of the unknown parent. */
+                                    }
+
+                                    --ulIndex;                /* Adjust for outer for-loop increment. */
+                                    eErr = eDocParseErr_None; /* Unknown key structures are simply skipped so clear the error state to continue. */
+                                }
+                                else if( eErr == eDocParseErr_None )
+                                {
+                                    /* We found the parameter key in the document model. */
+
+                                    /* Get the value field (i.e. the following token) for the parameter. */
+                                    pxValTok = &pxTokens[ ulIndex + 1UL ];
+
+                                    /* Verify the field type is what we expect for this parameter. */
+                                    if( pxValTok->type != pxModelParam[ usModelParamIndex ].eJasmineType )
+                                    {
+                                        ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
+                                        OTA_LOG_L1( "[%s] parameter type mismatch [ %s : %.*s ] type %u, expected %u\r\n",
+                                                    OTA_METHOD_NAME, pxModelParam[ usModelParamIndex ].pcSrcKey, ulTokenLen,
+                                                    &pcJSON[ pxValTok->start ],
+                                                    pxValTok->type, pxModelParam[ usModelParamIndex ].eJasmineType );
+                                        eErr = eDocParseErr_FieldTypeMismatch;
+                                        /* break; */
+                                    }
+                                    else if( OTA_DONT_STORE_PARAM == pxModelParam[ usModelParamIndex ].xDestOffset )
+                                    {
+                                        /* Nothing to do with this parameter since we're not storing it. */
+                                        continue;
+                                    }
+                                    else
+                                    {
+                                        /* Get destination offset to parameter storage location. */
+
+                                        /* If it's within the models context structure, add in the context instance base address. */
+                                        if( pxModelParam[ usModelParamIndex ].xDestOffset < pxDocModel->ulContextSize )
+                                        {
+                                            xParamAddr.xVal = pxDocModel->xContextBase + pxModelParam[ usModelParamIndex ].xDestOffset;
+                                        }
+                                        else
+                                        {
+                                            /* It's a raw pointer so keep it as is. */
+                                            xParamAddr.xVal = pxModelParam[ usModelParamIndex ].xDestOffset;
+                                        }
+
+                                        if( eModelParamType_StringCopy == pxModelParam[ usModelParamIndex ].xModelParamType )
+                                        {
+                                            /* Malloc memory for a copy of the value string plus a zero terminator. */
+                                            ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
+                                            void * pvStringCopy = pvPortMalloc( ulTokenLen + 1U );
+
+                                            if( pvStringCopy != NULL )
+                                            {
+                                                *xParamAddr.ppvPtr = pvStringCopy;
+                                                char * pcStringCopy = *xParamAddr.ppcPtr;
+                                                /* Copy parameter string into newly allocated memory. */
+                                                memcpy( pcStringCopy, &pcJSON[ pxValTok->start ], ulTokenLen );
+                                                /* Zero terminate the new string. */
+                                                pcStringCopy[ ulTokenLen ] = '\0';
+                                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %s ]\r\n",
+                                                            OTA_METHOD_NAME,
+                                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
+                                                            pcStringCopy );
+                                            }
+                                            else
+                                            {
+                                                /* Stop processing on error. */
+                                                eErr = eDocParseErr_OutOfMemory;
+                                                /* break; */
+                                            }
+                                        }
+                                        else if( eModelParamType_StringInDoc == pxModelParam[ usModelParamIndex ].xModelParamType )
+                                        {
+                                            /* Copy pointer to source string instead of duplicating the string. */
+                                            const char * pcStringInDoc = &pcJSON[ pxValTok->start ];
+
+                                            if( pcStringInDoc != NULL ) /*lint !e774 This can result in NULL if offset rolls the address around. */
+                                            {
+                                                *xParamAddr.ppcConstPtr = pcStringInDoc;
+                                                ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
+                                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %.*s ]\r\n",
+                                                            OTA_METHOD_NAME,
+                                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
+                                                            ulTokenLen, pcStringInDoc );
+                                            }
+                                            else
+                                            {
+                                                /* This should never happen unless there's a bug or memory is corrupted. */
+                                                OTA_LOG_L1( "[%s] Error! JSON token produced a null pointer for parameter [ %s ]\r\n",
+                                                            OTA_METHOD_NAME,
+                                                            pxModelParam[ usModelParamIndex ].pcSrcKey );
+                                                eErr = eDocParseErr_InvalidToken;
+                                            }
+                                        }
+                                        else if( eModelParamType_UInt32 == pxModelParam[ usModelParamIndex ].xModelParamType )
+                                        {
+                                            char * pcEnd;
+                                            const char * pcStart = &pcJSON[ pxValTok->start ];
+                                            *xParamAddr.pulPtr = strtoul( pcStart, &pcEnd, 0 );
+
+                                            if( pcEnd == &pcJSON[ pxValTok->end ] )
+                                            {
+                                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %u ]\r\n",
+                                                            OTA_METHOD_NAME,
+                                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
+                                                            *xParamAddr.pulPtr );
+                                            }
+                                            else
+                                            {
+                                                eErr = eDocParseErr_InvalidNumChar;
+                                            }
+                                        }
+                                        else if( eModelParamType_SigBase64 == pxModelParam[ usModelParamIndex ].xModelParamType )
+                                        {
+                                            /* Allocate space for and decode the base64 signature. */
+                                            void * pvSignature = pvPortMalloc( sizeof( Sig256_t ) );
+
+                                            if( pvSignature != NULL )
+                                            {
+                                                size_t xActualLen;
+                                                *xParamAddr.ppvPtr = pvSignature;
+                                                Sig256_t * pxSig256 = *xParamAddr.ppxSig256Ptr;
+                                                ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
+
+                                                if( mbedtls_base64_decode( pxSig256->ucData, sizeof( pxSig256->ucData ), &xActualLen,
+                                                                           ( const uint8_t * ) &pcJSON[ pxValTok->start ], ulTokenLen ) != 0 )
+                                                {
+                                                    /* Stop processing on error. */
+                                                    OTA_LOG_L1( "[%s] mbedtls_base64_decode failed.\r\n", OTA_METHOD_NAME );
+                                                    eErr = eDocParseErr_Base64Decode;
+                                                    /* break; */
+                                                }
+                                                else
+                                                {
+                                                    pxSig256->usSize = ( uint16_t ) xActualLen;
+                                                    OTA_LOG_L1( "[%s] Extracted parameter [ %s: %.32s... ]\r\n",
+                                                                OTA_METHOD_NAME,
+                                                                pxModelParam[ usModelParamIndex ].pcSrcKey,
+                                                                &pcJSON[ pxValTok->start ] );
+                                                }
+                                            }
+                                            else
+                                            {
+                                                /* We failed to allocate needed memory. Everything will be freed below upon failure. */
+                                                eErr = eDocParseErr_OutOfMemory;
+                                            }
+                                        }
+                                        else if( eModelParamType_Ident == pxModelParam[ usModelParamIndex ].xModelParamType )
+                                        {
+                                            OTA_LOG_L1( "[%s] Identified parameter [ %s ]\r\n",
+                                                        OTA_METHOD_NAME,
+                                                        pxModelParam[ usModelParamIndex ].pcSrcKey );
+                                            *xParamAddr.pxBoolPtr = pdTRUE;
+                                        }
+                                        else
+                                        {
+                                            /* Ignore invalid document model type. */
+                                        }
+                                    }
+                                }
+                                else
+                                {
+                                    /* Nothing special to do. The error will break us out of the loop. */
+                                }
+                            }
+                            else
+                            {
+                                /* Ignore tokens that are not keys and move on to the next. */
+                            }
+                        }
+
+                        if( eErr == eDocParseErr_None )
+                        {
+                            uint32_t ulMissingParams = ( pxDocModel->ulParamsReceivedBitmap & pxDocModel->ulParamsRequiredBitmap )
+                                                       ^ pxDocModel->ulParamsRequiredBitmap;
+
+                            if( ulMissingParams != 0U )
+                            {
+                                /* The job document did not have all required document model parameters. */
+                                for( ulScanIndex = 0UL; ulScanIndex < pxDocModel->usNumModelParams; ulScanIndex++ )
+                                {
+                                    if( ( ulMissingParams & ( 1UL << ulScanIndex ) ) != 0UL )
+                                    {
+                                        OTA_LOG_L1( "[%s] parameter not present: %s\r\n",
+                                                    OTA_METHOD_NAME,
+                                                    pxModelParam[ ulScanIndex ].pcSrcKey );
+                                    }
+                                }
+
+                                eErr = eDocParseErr_MalformedDoc;
+                            }
+                        }
+                        else
+                        {
+                            OTA_LOG_L1( "[%s] Error (%d) parsing JSON document.\r\n", OTA_METHOD_NAME, ( int32_t ) eErr );
+                        }
+                    }
+                    else
+                    {
+                        OTA_LOG_L1( "[%s] JSON document is not an object.\r\n", OTA_METHOD_NAME );
+                        eErr = eDocParseErr_MalformedDoc;
+                    }
+                }
+                else
+                {
+                    OTA_LOG_L1( "[%s] Invalid JSON document. No tokens parsed. \r\n", OTA_METHOD_NAME );
+                    eErr = eDocParseErr_NoTokens;
+                }
+            }
+            else
+            {
+                OTA_LOG_L1( "[%s] Document has too many keys.\r\n", OTA_METHOD_NAME );
+                eErr = eDocParseErr_TooManyTokens;
+            }
+
+            /* Free the token memory. */
+            vPortFree( pxTokens ); /*lint !e850 ulIndex is intentionally modified within the loop to skip over unknown tags. */
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] No memory for JSON tokens.\r\n", OTA_METHOD_NAME );
+            eErr = eDocParseErr_OutOfMemory;
+        }
+    }
+
+    configASSERT( eErr != eDocParseErr_Unknown );
+    return eErr;
+}
+
+
+/* Prepare the document model for use by sanity checking the initialization parameters,
+ * detecting all required parameters and indexing the parameter keys. */
+
+static DocParseErr_t prvInitDocModel( JSON_DocModel_t * pxDocModel,
+                                      const JSON_DocParam_t * pxBodyDef,
+                                      size_t xContextBaseAddr,
+                                      uint32_t ulContextSize,
+                                      uint16_t usNumJobParams )
+{
+    DEFINE_OTA_METHOD_NAME( "prvInitDocModel" );
+
+    DocParseErr_t eErr = eDocParseErr_Unknown;
+    uint32_t ulScanIndex;
+    uint32_t ulSlot;
+
+    /* Sanity check the model pointers and parameter count. Exclude the context base address and size since
+     * it is technically possible to create a model that writes entirely into absolute memory locations.
+     */
+    if( pxDocModel == NULL )
+    {
+        OTA_LOG_L1( "[%s] The pointer to the document model is NULL.\r\n", OTA_METHOD_NAME );
+        eErr = eDocParseErr_NullModelPointer;
+    }
+    else if( pxBodyDef == NULL )
+    {
+        OTA_LOG_L1( "[%s] Document model 0x%08x body pointer is NULL.\r\n", OTA_METHOD_NAME, pxDocModel );
+        eErr = eDocParseErr_NullBodyPointer;
+    }
+    else if( usNumJobParams > OTA_DOC_MODEL_MAX_PARAMS )
+    {
+        OTA_LOG_L1( "[%s] Model has too many parameters (%u).\r\n", OTA_METHOD_NAME, pxDocModel->usNumModelParams );
+        eErr = eDocParseErr_TooManyParams;
+    }
+    else
+    {
+        pxDocModel->xContextBase = xContextBaseAddr;
+        pxDocModel->ulContextSize = ulContextSize;
+        pxDocModel->pxBodyDef = pxBodyDef;
+        pxDocModel->usNumModelParams = usNumJobParams;
+        pxDocModel->ulParamsReceivedBitmap = 0;
+        pxDocModel->ulParamsRequiredBitmap = 0;
+        memset( pxDocModel->ucKeyIndex, 0, sizeof( pxDocModel->ucKeyIndex ) );
+
+        /* Scan the model and detect all required parameters (i.e. not optional). */
+        for( ulScanIndex = 0; ulScanIndex < pxDocModel->usNumModelParams; ulScanIndex++ )
+        {
+            if( pxDocModel->pxBodyDef[ ulScanIndex ].bRequired == ( bool_t ) pdTRUE )
+            {
+                /* Add parameter to the required bitmap. */
+                pxDocModel->ulParamsRequiredBitmap |= ( 1UL << ulScanIndex );
+            }
+
+            /* Add the parameter key to the key index, in the next free slot from the one it hashes to. */
+            ulSlot = prvChecksum( OTA_FNV_OFFSET_BASIS,
+                                  ( const uint8_t * ) pxDocModel->pxBodyDef[ ulScanIndex ].pcSrcKey,
+                                  ( uint32_t ) strlen( pxDocModel->pxBodyDef[ ulScanIndex ].pcSrcKey ) ) & ( OTA_DOC_MODEL_INDEX_SLOTS - 1U );
+
+            while( pxDocModel->ucKeyIndex[ ulSlot ] != 0U )
+            {
+                ulSlot = ( ulSlot + 1U ) & ( OTA_DOC_MODEL_INDEX_SLOTS - 1U );
+            }
+
+            pxDocModel->ucKeyIndex[ ulSlot ] = ( uint8_t ) ( ulScanIndex + 1U );
+        }
+
+        eErr = eDocParseErr_None;
+    }
+
+    return eErr;
+}
+
+
+/* Parse the OTA job document and validate. Return the populated
+ * OTA context if valid otherwise return NULL.
+ */
+
+static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
+                                           uint32_t ulMsgLen )
+{
+    DEFINE_OTA_METHOD_NAME( "prvParseJobDoc" );
+
+    /* This is the OTA job document model describing the parameters, their types, destination and how to extract. */
+    /*lint -e{708} We intentionally do some things lint warns about but produce the proper model. */
+    /* Namely union initialization and pointers converted to values. */
+    static const JSON_DocParam_t xOTA_JobDocModelParamStructure[ OTA_NUM_JOB_PARAMS ] =
+    {
+        { cOTA_JSON_ClientTokenKey,   OTA_JOB_PARAM_OPTIONAL, { ( size_t ) &xOTA_Agent.pucClientTokenFromJob }, eModelParamType_StringInDoc, JSMN_STRING    }, /*lint !e9078 !e923 Get address of token as value. */
+        { cOTA_JSON_ExecutionKey,     OTA_JOB_PARAM_REQUIRED, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Object,      JSMN_OBJECT    },
+        { cOTA_JSON_JobIDKey,         OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pucJobName )     }, eModelParamType_StringCopy,  JSMN_STRING    },
+        { cOTA_JSON_StatusDetailsKey, OTA_JOB_PARAM_OPTIONAL, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Object,      JSMN_OBJECT    },
+        { cOTA_JSON_SelfTestKey,      OTA_JOB_PARAM_OPTIONAL, { OFFSET_OF( OTA_FileContext_t, xIsInSelfTest )  }, eModelParamType_Ident,       JSMN_STRING    },
+        { cOTA_JSON_UpdatedByKey,     OTA_JOB_PARAM_OPTIONAL, { OFFSET_OF( OTA_FileContext_t, ulUpdaterVersion )}, eModelParamType_UInt32,      JSMN_STRING    },
+        { cOTA_JSON_JobDocKey,        OTA_JOB_PARAM_REQUIRED, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Object,      JSMN_OBJECT    },
+        { cOTA_JSON_OTAUnitKey,       OTA_JOB_PARAM_REQUIRED, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Object,      JSMN_OBJECT    },
+        { cOTA_JSON_StreamNameKey,    OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pucStreamName )  }, eModelParamType_StringCopy,  JSMN_STRING    },
+        { cOTA_JSON_FileGroupKey,     OTA_JOB_PARAM_REQUIRED, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Array,       JSMN_ARRAY     },
+        { cOTA_JSON_FilePathKey,      OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pucFilePath )    }, eModelParamType_StringCopy,  JSMN_STRING    },
+        { cOTA_JSON_FileSizeKey,      OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, ulFileSize )     }, eModelParamType_UInt32,      JSMN_PRIMITIVE },
+        { cOTA_JSON_FileIDKey,        OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, ulServerFileID ) }, eModelParamType_UInt32,      JSMN_PRIMITIVE },
+        { cOTA_JSON_FileCertNameKey,  OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pucCertFilepath )}, eModelParamType_StringCopy,  JSMN_STRING    },
+        { cOTA_JSON_FileSignatureKey, OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pxSignature )    }, eModelParamType_SigBase64,   JSMN_STRING    },
+        { cOTA_JSON_FileAttributeKey, OTA_JOB_PARAM_OPTIONAL, { OFFSET_OF( OTA_FileContext_t, ulFileAttributes )}, eModelParamType_UInt32,      JSMN_PRIMITIVE },
+        { cOTA_JSON_FileBaseHashKey,  OTA_JOB_PARAM_OPTIONAL, { OFFSET_OF( OTA_FileContext_t, pxBaseHash )     }, eModelParamType_SigBase64,   JSMN_STRING    },
+    };
+
+    OTA_JobParseErr_t eErr = eOTA_JobParseErr_Unknown;
+    OTA_FileContext_t * pxC;
+    OTA_FileContext_t * pxFinalFile;
+
+    pxFinalFile = NULL;
+    pxC = prvGetFreeContext();
+
+    if( pxC == NULL )
+    {
+        OTA_LOG_L1( "[%s] Error! No job context available.\r\n", OTA_METHOD_NAME );
+        eErr = eOTA_JobParseErr_NoContextAvailable;
+    }
+    else
+    {
+        JSON_DocModel_t xOTA_JobDocModel;
+
+        if( prvInitDocModel( &xOTA_JobDocModel,
+                             xOTA_JobDocModelParamStructure,
+                             ( size_t ) pxC, /*lint !e9078 !e923 Intentionally casting context pointer to a value for prvInitDocModel. */
+                             sizeof( OTA_FileContext_t ),
+                             OTA_NUM_JOB_PARAMS ) != eDocParseErr_None )
+        {
+            eErr = eOTA_JobParseErr_BadModelInitParams;
+        }
+        else if( prvParseJSONbyModel( pcJSON, ulMsgLen, &xOTA_JobDocModel ) == eDocParseErr_None )
+        {
+            /* Validate the job document parameters. */
+            eErr = eOTA_JobParseErr_None;
+
+            if( pxC->ulFileSize == 0U )
+            {
+                OTA_LOG_L1( "[%s] Zero file size is not allowed!\r\n", OTA_METHOD_NAME );
+                eErr = eOTA_JobParseErr_ZeroFileSize;
+            }
+            /* If there's an active job, verify that it's the same as what's being reported now. */
+            /* We already checked for missing parameters so we SHOULD have a job name in the context. */
+            else if( xOTA_Agent.pucOTA_Singleton_ActiveJobName != NULL )
+            {
+                if( pxC->pucJobName != NULL )
+                {
+                    /* C->pucJobName is guaranteed to be zero terminated. */
+                    if( strcmp( ( char * ) xOTA_Agent.pucOTA_Singleton_ActiveJobName, ( char * ) pxC->pucJobName ) != 0 )
+                    {
+                        OTA_LOG_L1( "[%s] Busy with existing job. Ignoring.\r\n", OTA_METHOD_NAME );
+                        eErr = eOTA_JobParseErr_BusyWithExistingJob;
+                    }
+                    else
+                    {
+                        /* The same job is being reported so free the duplicate job name from the context. */
+                        OTA_LOG_L1( "[%s] Superfluous report of current job.\r\n", OTA_METHOD_NAME );
+                        vPortFree( pxC->pucJobName );
+                        pxC->pucJobName = NULL;
+                        eErr = eOTA_JobParseErr_BusyWithSameJob;
+                    }
+                }
+                else
+                {
+                    OTA_LOG_L1( "[%s] Null job reported while busy. Ignoring.\r\n", OTA_METHOD_NAME );
+                    eErr = eOTA_JobParseErr_NullJob;
+                }
+            }
+            else
+            {
+                /* Assume control of the job name from the context. */
+                xOTA_Agent.pucOTA_Singleton_ActiveJobName = pxC->pucJobName;
+                pxC->pucJobName = NULL;
+            }
+
+            if( eErr == eOTA_JobParseErr_None )
+            {
+                /* If the job is in self test mode, don't start an
+                 * OTA update but instead do the following:
+                 *
+                 * If the firmware that performed the update was older
+                 * than the currently running firmware, set the image
+                 * state to "Testing." This is the success path.
+                 *
+                 * If it's the same or newer, reject the job since
+                 * either the firmware wasn't accepted during self
+                 * test or an incorrect image was sent by the OTA
+                 * operator.
+                 */
+                if( pxC->xIsInSelfTest == ( bool_t ) pdTRUE )
+                {
+                    OTA_LOG_L1( "[%s] In self test mode.\r\n", OTA_METHOD_NAME );
+
+                    if( pxC->ulUpdaterVersion < xAppFirmwareVersion.u.ulVersion32 )
+                    {
+                        /* The running firmware version is newer than the firmware that performed
+                         * the update so this means we're ready to start the self test phase.
+                         *
+                         * Set image state accordingly and update job status with self test identifier.
+                         */
+                        ( void ) prvSetImageStateWithReason( eOTA_ImageState_Testing, ( uint32_t ) NULL );
+                    }
+                    else
+                    {
+                        if( pxC->ulUpdaterVersion > xAppFirmwareVersion.u.ulVersion32 )
+                        {
+                            /* The running firmware is older than the firmware that performed the update so reject the job. */
+                            OTA_LOG_L1( "[%s] Rejecting image because version is older than previous.\r\n", OTA_METHOD_NAME );
+                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Rejected, kOTA_Err_DowngradeNotAllowed );
+                        }
+                        else /* Version reported is the same as the running version. */
+                        {
+                            if( ( xOTA_Agent.pucClientTokenFromJob == NULL ) ||
+                                ( strtoul( ( const char * ) xOTA_Agent.pucClientTokenFromJob, NULL, 0 ) == 0U ) ) /*lint !e9007 We don't provide a modifiable variable to strtoul. */
+                            {
+                                /* The version is the same so either we're not actually the new firmware or
+                                 * someone messed up and sent firmware with the same version. In either case,
+                                 * this is a failure of the OTA update so reject the job. */
+                                OTA_LOG_L1( "[%s] Failing job. We rebooted and the version is still the same.\r\n", OTA_METHOD_NAME );
+                                ( void ) prvSetImageStateWithReason( eOTA_ImageState_Rejected, kOTA_Err_SameFirmwareVersion );
+                            }
+                            else
+                            {
+                                OTA_LOG_L1( "[%s] Ignoring job. Device must be rebooted first.\r\n", OTA_METHOD_NAME );
+                            }
+                        }
+
+                        /* All reject cases must reset the device. */
+                        ( void ) prvResetDevice(); /* Ignore return code since there's nothing we can do if we can't force reset. */
+                    }
+                }
+                else
+                {
+                    /* Everything looks OK. Set final context structure to start OTA. */
+                    OTA_LOG_L1( "[%s] Job was accepted. Attempting to start transfer.\r\n", OTA_METHOD_NAME );
+                    pxFinalFile = pxC;
+                }
+            }
+            else
+            {
+                OTA_LOG_L1( "[%s] Error %d parsing job document.\r\n", OTA_METHOD_NAME, eErr );
+            }
+        }
+        else
+        {
+            /* No need to print an error message. The JSON parser should have already. */
+            eErr = eOTA_JobParseErr_NonConformingJobDoc;
+        }
+    }
+
+    configASSERT( eErr != eOTA_JobParseErr_Unknown );
+
+    if( eErr != eOTA_JobParseErr_None )
+    {
+        if( pxC == NULL )
+        {
+            OTA_LOG_L1( "[%s] Error! No job context available.\r\n", OTA_METHOD_NAME );
+        }
+        else
+        {
+            /* If job parsing failed AND there's a job ID, update the job state to FAILED with
+             * a reason code.  Without a job ID, we can't update the status in the job service. */
+            if( pxC->pucJobName != NULL )
+            {
+                OTA_LOG_L1( "[%s] Rejecting job due to OTA_JobParseErr_t %d\r\n", OTA_METHOD_NAME, eErr );
+                /* Assume control of the job name from the context. */
+                xOTA_Agent.pucOTA_Singleton_ActiveJobName = pxC->pucJobName;
+                pxC->pucJobName = NULL;
+                prvUpdateJobStatus( NULL, eJobStatus_FailedWithVal, ( int32_t ) kOTA_Err_JobParserError, ( int32_t ) eErr );
+                /* We don't need the job name memory anymore since we're done with this job. */
+                vPortFree( xOTA_Agent.pucOTA_Singleton_ActiveJobName );
+                xOTA_Agent.pucOTA_Singleton_ActiveJobName = NULL;
+            }
+            else
+            {
+                OTA_LOG_L1( "[%s] Ignoring job without ID.\r\n", OTA_METHOD_NAME );
+            }
+        }
+    }
+
+    /* If we failed, free the reserved file context (C) to make it available again. */
+    if( pxFinalFile == NULL )
+    {
+        ( void ) prvOTA_Close( pxC ); /* Ignore impossible false result by design */
+    }
+
+    /* Return pointer to populated file context or NULL if it failed. */
+    return pxFinalFile;
+}
+
+
+/* prvProcessOTAJobMsg
+ *
+ * We received an OTA update job message from the job notification service.
+ * Process the message and prepare for receiving the file as needed.
+ */
+
+static OTA_FileContext_t * prvProcessOTAJobMsg( const char * pcRawMsg,
+                                                uint32_t ulMsgLen )
+{
+    uint32_t ulIndex;
+    uint32_t ulNumBlocks;             /* How many data pages are in the expected update image. */
+    uint32_t ulBitmapLen;             /* Length of the file block bitmap in bytes. */
+    OTA_FileContext_t * pxUpdateFile; /* Pointer to an OTA update context. */
+    OTA_Err_t xErr = kOTA_Err_Uninitialized;
+
+    /* Populate an OTA update context from the OTA job document. */
+
+    pxUpdateFile = prvParseJobDoc( pcRawMsg, ulMsgLen );
+
+    if( ( pxUpdateFile != NULL ) && ( prvInSelftest() == false ) )
+    {
+        if( pxUpdateFile->pucRxBlockBitmap != NULL )
+        {
+            vPortFree( pxUpdateFile->pucRxBlockBitmap ); /* Free any previously allocated bitmap. */
+            pxUpdateFile->pucRxBlockBitmap = NULL;
+        }
+
+        /* Calculate how many bytes we need in our bitmap for tracking received blocks.
+         * The below calculation requires power of 2 page sizes. */
+
+        ulNumBlocks = ( pxUpdateFile->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+        ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
+        pxUpdateFile->pucRxBlockBitmap = ( uint8_t * ) pvPortMalloc( ulBitmapLen ); /*lint !e9079 FreeRTOS malloc port returns void*. */
+
+        if( pxUpdateFile->pucRxBlockBitmap != NULL )
+        {
+            if( ( BaseType_t ) ( prvSubscribeToDataStream( pxUpdateFile ) ) == pdTRUE )
+            {
+                /* Set all bits in the bitmap to the erased state (we use 1 for erased just like flash memory). */
+                memset( pxUpdateFile->pucRxBlockBitmap, ( int ) OTA_ERASED_BLOCKS_VAL, ulBitmapLen );
+
+                /* Mark as used any pages in the bitmap that are out of range, based on the file size.
+                 * This keeps us from requesting those pages during retry processing or if using a windowed
+                 * block request. It also avoids erroneously accepting an out of range data block should it
+                 * get past any safety checks.
+                 * Files aren't always a multiple of 8 pages (8 bits/pages per byte) so some bits of the
+                 * last byte may be out of range and those are the bits we want to clear. */
+
+                uint8_t ucBit = 1U << ( BITS_PER_BYTE - 1U );
+                uint32_t ulNumOutOfRange = ( ulBitmapLen * BITS_PER_BYTE ) - ulNumBlocks;
+
+                for( ulIndex = 0U; ulIndex < ulNumOutOfRange; ulIndex++ )
+                {
+                    pxUpdateFile->pucRxBlockBitmap[ ulBitmapLen - 1U ] &= ~ucBit;
+                    ucBit >>= 1U;
+                }
+
+                pxUpdateFile->ulBlocksRemaining = ulNumBlocks; /* Initialize our blocks remaining counter. */
+                prvResetRequestWindow( pxUpdateFile );
+                prvStartRequestTimer( pxUpdateFile );
+
+                /* Request the first block ranges right away instead of waiting for the timer. */
+                ( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_REQ_RANGES );
+
+                /* Resume the OTA file from its checkpoint or create/open it on the file system. The state of
+                 * the decoders is not checkpointed, so a compressed or delta file is always received anew. */
+                if( prvIsFileDecoded( pxUpdateFile ) == pdFALSE )
+                {
+                    xErr = prvResumeFileForRx( pxUpdateFile );
+                }
+                else
+                {
+                    xErr = kOTA_Err_NoCheckpoint;
+                }
+
+                if( xErr != kOTA_Err_None )
+                {
+                    prvEraseCheckpoint( pxUpdateFile ); /* Drop any checkpoint of a different file. */
+                    xErr = prvPAL_CreateFileForRx( pxUpdateFile );
+                }
+
+                /* Hash the blocks as they arrive if there is a signature verification context. A resumed
+                 * file can only be hashed further if the next block to hash is still missing. Otherwise
+                 * it was held back when the checkpoint was stored and the PAL reads it back at close.
+                 * The image of a compressed or delta file is hashed as it is decoded instead. */
+                prvStopFileHash();
+
+                if( xErr == kOTA_Err_None )
+                {
+                    xErr = prvStartDecoding( pxUpdateFile );
+                }
+
+                if( xErr == kOTA_Err_None )
+                {
+                    xErr = prvStartWriteBehind( pxUpdateFile );
+                }
+
+                if( ( pxUpdateFile->pvSigVerifyContext != NULL ) &&
+                    ( prvIsFileDecoded( pxUpdateFile ) == pdFALSE ) &&
+                    ( prvRangeHasMissingBlocks( pxUpdateFile,
+                                                pxUpdateFile->ulHashedBytes >> otaconfigLOG2_FILE_BLOCK_SIZE,
+                                                ( pxUpdateFile->ulHashedBytes >> otaconfigLOG2_FILE_BLOCK_SIZE ) + 1U ) == pdTRUE ) )
+                {
+                    xOTA_Agent.xHashReorder.xHashing = pdTRUE;
+                }
+
+                if( xErr != kOTA_Err_None )
+                {
+                    ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, xErr );
+                    ( void ) prvOTA_Close( pxUpdateFile ); /* Ignore false result since we're setting the pointer to null on the next line. */
+                    pxUpdateFile = NULL;
+                }
+            }
+            else
+            {
+                /* Can't receive the image without a subscription. */
+                ( void ) prvOTA_Close( pxUpdateFile ); /* Ignore false result since we're setting the pointer to null on the next line. */
+                pxUpdateFile = NULL;
+            }
+        }
+        else
+        {
+            /* Can't receive the image without enough memory. */
+            ( void ) prvOTA_Close( pxUpdateFile ); /* Ignore false result since we're setting the pointer to null on the next line. */
+            pxUpdateFile = NULL;
+        }
+    }
+
+    return pxUpdateFile; /* Return the OTA file context. */
+}
+
+
+
+/* prvIngestDataBlock
+ *
+ * A block of file data was received by the application via some configured communication protocol.
+ * If it looks like it is in range, write it to persistent storage. Once the last block we're expecting
+ * is written, and the message is no longer needed, prvCloseReceivedFile() closes the file and
+ * performs the final signature check on it. If the close and signature check are OK, it lets the
+ * caller know so it can be used by the system. Firmware updates generally reboot the system and
+ * perform a self test phase. If the close or signature check fails, the file transfer is aborted and
+ * the result and any available details are returned to the caller.
+ *
+ * The stream block may hold several file blocks, as given by the block shift in its client token.
+ * Each of them is ingested on its own, so the bitmap, hash and checkpoint stay in file blocks.
+ */
+static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
+                                          const char * pcRawMsg,
+                                          uint32_t ulMsgSize,
+                                          OTA_Err_t * pxCloseResult )
+{
+    DEFINE_OTA_METHOD_NAME( "prvIngestDataBlock" );
+
+    IngestResult_t eIngestResult = eIngest_Result_Uninitialized;
+    IngestResult_t eBlockResult;
+    int32_t lFileId = 0;
+    uint32_t ulBlockSize = 0;
+    uint32_t ulBlockIndex = 0;
+    uint32_t ulBlockShift, ulOffset, ulFileBlock;
+    uint32_t ulStreamBlockSize = 0U;
+    uint32_t ulLastBlock = 0U;
+    const uint8_t * pucPayload = NULL;
+    size_t xPayloadSize = 0;
+    char cClientToken[ OTA_CLIENT_TOKEN_SIZE ];
+
+    if( C != NULL )
+    {
+        if( pxCloseResult != NULL )
+        {
+            *pxCloseResult = kOTA_Err_GenericIngestError; /* Default to a generic ingest function error until we prove success. */
+
+            /* If we have a block bitmap available then process the message. */
+            if( C->pucRxBlockBitmap && ( C->ulBlocksRemaining > 0U ) )
+            {
+                /* Decode the CBOR content. */
+                if( pdFALSE == OTA_CBOR_Decode_GetStreamResponseMessageInPlace(
+                        ( const uint8_t * ) pcRawMsg,
+                        ulMsgSize,
+                        &lFileId,
+                        ( int32_t * ) &ulBlockIndex, /*lint !e9087 CBOR requires pointer to int and our block index's never exceed 31 bits. */
+                        ( int32_t * ) &ulBlockSize,  /*lint !e9087 CBOR requires pointer to int and our block sizes never exceed 31 bits. */
+                        &pucPayload,                 /* This payload points into the message buffer, so it's written without a copy. */
+                        ( size_t * ) &xPayloadSize,
+                        cClientToken,
+                        sizeof( cClientToken ) ) )
+                {
+                    eIngestResult = eIngest_Result_BadData;
+                }
+                else if( xPayloadSize != ( size_t ) ulBlockSize )
+                {
+                    /* The block size field must match the payload since that many bytes are written from it. */
+                    OTA_LOG_L1( "[%s] Error! Block %u size %u doesn't match payload size %u\r\n", OTA_METHOD_NAME, ulBlockIndex, ulBlockSize, ( uint32_t ) xPayloadSize );
+                    eIngestResult = eIngest_Result_BadData;
+                }
+                else
+                {
+                    /* Validate the block index and size in units of the stream block size of the response. */
+                    /* If it is NOT the last block, it MUST be equal to a full block size. */
+                    /* If it IS the last block, it MUST be equal to the expected remainder. */
+                    /* If the block ID or block shift is out of range, that's an error so abort. */
+                    ulBlockShift = prvGetBlockShift( cClientToken );
+
+                    if( ulBlockShift <= OTA_MAX_BLOCK_SHIFT )
+                    {
+                        ulStreamBlockSize = OTA_FILE_BLOCK_SIZE << ulBlockShift;
+                        ulLastBlock = ( ( C->ulFileSize + ( ulStreamBlockSize - 1U ) ) >> ( otaconfigLOG2_FILE_BLOCK_SIZE + ulBlockShift ) ) - 1U;
+                    }
+
+                    if( ( ulBlockShift <= OTA_MAX_BLOCK_SHIFT ) &&
+                        ( ( ( ulBlockIndex < ulLastBlock ) && ( ulBlockSize == ulStreamBlockSize ) ) ||
+                          ( ( ulBlockIndex == ulLastBlock ) && ( ulBlockSize == ( C->ulFileSize - ( ulLastBlock * ulStreamBlockSize ) ) ) ) ) )
+                    {
+                        OTA_LOG_L1( "[%s] Received file block %u, size %u\r\n", OTA_METHOD_NAME, ulBlockIndex, ulBlockSize );
+
+                        xOTA_Agent.xStatistics.xBlockSizes[ ulBlockShift ].ulMessages++;
+                        xOTA_Agent.xStatistics.xBlockSizes[ ulBlockShift ].ulBytes += ulBlockSize;
+
+                        /* The results of the file blocks combine to the lowest one, so an error stops the loop
+                         * and the stream block is accepted if any of its file blocks is. */
+                        eIngestResult = eIngest_Result_Deferred_Continue;
+                        ulFileBlock = ulBlockIndex << ulBlockShift;
+
+                        for( ulOffset = 0U; ( ulOffset < ulBlockSize ) && ( eIngestResult >= eIngest_Result_Accepted_Continue ); ulOffset += OTA_FILE_BLOCK_SIZE )
+                        {
+                            eBlockResult = prvIngestFileBlock( C,
+                                                               ulFileBlock,
+                                                               &pucPayload[ ulOffset ],
+                                                               ( ( ulBlockSize - ulOffset ) < OTA_FILE_BLOCK_SIZE ) ? ( ulBlockSize - ulOffset ) : OTA_FILE_BLOCK_SIZE );
+                            ulFileBlock++;
+
+                            if( eBlockResult < eIngestResult )
+                            {
+                                eIngestResult = eBlockResult;
+                            }
+                        }
+
+                        if( eIngestResult >= eIngest_Result_Accepted_Continue )
+                        {
+                            *pxCloseResult = kOTA_Err_None; /* This is a success path. */
+                        }
+
+                        if( eIngestResult == eIngest_Result_Accepted_Continue )
+                        {
+                            /* Request missing and next block ranges without waiting for the deadline if needed. */
+                            if( prvUpdateRequestWindow( C, ulBlockIndex << ulBlockShift ) == pdTRUE )
+                            {
+                                ( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_REQ_RANGES );
+                            }
+
+                            /* Move the request timer to the earliest range deadline. */
+                            prvStartRequestTimer( C );
+
+                            if( C->ulBlocksRemaining > 0U )
+                            {
+                                OTA_LOG_L1( "[%s] Remaining: %u\r\n", OTA_METHOD_NAME, C->ulBlocksRemaining );
+                            }
+                        }
+                    }
+                    else
+                    {
+                        OTA_LOG_L1( "[%s] Error! Block %u out of expected range! Size %u\r\n", OTA_METHOD_NAME, ulBlockIndex, ulBlockSize );
+                        eIngestResult = eIngest_Result_BlockOutOfRange;
+                    }
+                }
+            }
+            else
+            {
+                eIngestResult = eIngest_Result_UnexpectedBlock;
+            }
+        }
+        else
+        {
+            eIngestResult = eIngest_Result_NullResultPointer;
+        }
+    }
+    else
+    {
+        eIngestResult = eIngest_Result_NullContext;
+    }
+
+    return eIngestResult;
+}
+
+
+/* Close the OTA file once its last block was ingested: finish the hash, the decoding and the
+ * write-behind buffer, and let the PAL close the file and check its signature. Returns the result
+ * of the ingest, or of the close if the file was complete. This takes long enough that it is kept
+ * out of prvIngestDataBlock(), so a message lent by the MQTT task can be returned before it. */
+
+static IngestResult_t prvCloseReceivedFile( OTA_FileContext_t * C,
+                                            IngestResult_t eIngestResult,
+                                            OTA_Err_t * pxCloseResult )
+{
+    DEFINE_OTA_METHOD_NAME( "prvCloseReceivedFile" );
+
+    uint32_t ulBlockShift;
+
+    if( ( eIngestResult == eIngest_Result_Accepted_Continue ) && ( C->ulBlocksRemaining == 0U ) )
+    {
+        TickType_t xDownloadTicks = xTaskGetTickCount() - xOTA_Agent.xRequestWindow.xDownloadStartTicks;
+
+        OTA_LOG_L1( "[%s] Received final expected block of file.\r\n", OTA_METHOD_NAME );
+        OTA_LOG_L1( "[%s] %u bytes in %u ms (%u bytes/s), %u blocks requested in %u requests.\r\n",
+                    OTA_METHOD_NAME,
+                    C->ulFileSize,
+                    xDownloadTicks * portTICK_PERIOD_MS,
+                    ( uint32_t ) ( ( ( uint64_t ) C->ulFileSize * configTICK_RATE_HZ ) / ( ( xDownloadTicks > 0U ) ? xDownloadTicks : 1U ) ),
+                    xOTA_Agent.xRequestWindow.ulBlocksRequested,
+                    xOTA_Agent.xRequestWindow.ulRequestNumber );
+
+        /* Bring the time of the current block size up to date for the statistics. */
+        prvSetBlockShift( xOTA_Agent.xRequestWindow.ulBlockShift );
+
+        for( ulBlockShift = 0U; ulBlockShift < OTA_NUM_BLOCK_SIZES; ulBlockShift++ )
+        {
+            if( xOTA_Agent.xStatistics.xBlockSizes[ ulBlockShift ].ulMessages > 0U )
+            {
+                OTA_LOG_L1( "[%s] %u byte blocks: %u messages, %u bytes, %u retries, %u ms.\r\n",
+                            OTA_METHOD_NAME,
+                            ( uint32_t ) ( OTA_FILE_BLOCK_SIZE << ulBlockShift ),
+                            xOTA_Agent.xStatistics.xBlockSizes[ ulBlockShift ].ulMessages,
+                            xOTA_Agent.xStatistics.xBlockSizes[ ulBlockShift ].ulBytes,
+                            xOTA_Agent.xStatistics.xBlockSizes[ ulBlockShift ].ulRetries,
+                            xOTA_Agent.xStatistics.xBlockSizes[ ulBlockShift ].ulTimeMs );
+            }
+        }
+
+        if( C->pvSigVerifyContext != NULL )
+        {
+            OTA_LOG_L1( "[%s] %u of %u bytes hashed while receiving.\r\n", OTA_METHOD_NAME, C->ulHashedBytes, C->ulFileSize );
+        }
+
+        prvStopFileHash();
+        prvEraseCheckpoint( C );          /* The download can't be resumed once the file is closed. */
+        prvStopRequestTimer( C );         /* Don't request any more since we're done. */
+        vPortFree( C->pucRxBlockBitmap ); /* Free the bitmap now that we're done with the download. */
+        C->pucRxBlockBitmap = NULL;
+
+        if( prvFinishDecoding( C ) == pdFALSE )
+        {
+            eIngestResult = eIngest_Result_DecodeFailed; /* The file is aborted when the context is closed. */
+        }
+        else if( prvFinishWriteBehind() == pdFALSE )
+        {
+            eIngestResult = eIngest_Result_WriteBlockFailed; /* The file is aborted when the context is closed. */
+        }
+        else if( C->pucFile != NULL )
+        {
+            *pxCloseResult = prvPAL_CloseFile( C );
+
+            if( *pxCloseResult == kOTA_Err_None )
+            {
+                OTA_LOG_L1( "[%s] File receive complete and signature is valid.\r\n", OTA_METHOD_NAME );
+                eIngestResult = eIngest_Result_FileComplete;
+            }
+            else
+            {
+                uint32_t ulCloseResult = ( uint32_t ) *pxCloseResult;
+                OTA_LOG_L1( "[%s] Error (%u:0x%06x) closing OTA file.\r\n",
+                            OTA_METHOD_NAME,
+                            ulCloseResult >> kOTA_MainErrShiftDownBits,
+                            ulCloseResult & ( uint32_t ) kOTA_PAL_ErrMask );
+
+                if( ( ulCloseResult & kOTA_Main_ErrMask ) == kOTA_Err_SignatureCheckFailed )
+                {
+                    eIngestResult = eIngest_Result_SigCheckFail;
+                }
+                else
+                {
+                    eIngestResult = eIngest_Result_FileCloseFail;
+                }
+            }
+
+            C->pucFile = NULL; /* File is now closed so clear the file handle in the context. */
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] Error: File handle is NULL after last block received.\r\n", OTA_METHOD_NAME );
+            eIngestResult = eIngest_Result_BadFileHandle;
+        }
+    }
+
+    return eIngestResult;
+}
+
+
+/* Write or decode one file block of a received stream block. If it was accepted, mark it as received,
+ * include it in the running file hash and store a checkpoint if one is due. */
+
+static IngestResult_t prvIngestFileBlock( OTA_FileContext_t * C,
+                                          uint32_t ulBlockIndex,
+                                          const uint8_t * pucData,
+                                          uint32_t ulBlockSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvIngestFileBlock" );
+
+    IngestResult_t eIngestResult;
+
+    /* Create bit mask for use in our bitmap. */
+    uint8_t ucBitMask = 1U << ( ulBlockIndex % BITS_PER_BYTE ); /*lint !e9031 The composite expression will never be greater than BITS_PER_BYTE(8). */
+    /* Calculate byte offset into bitmap. */
+    uint32_t ulByte = ulBlockIndex >> LOG2_BITS_PER_BYTE;
+
+    if( ( C->pucRxBlockBitmap[ ulByte ] & ucBitMask ) == 0U ) /* If we've already received this block... */
+    {
+        OTA_LOG_L1( "[%s] block %u is a DUPLICATE. %u blocks remaining.\r\n", OTA_METHOD_NAME,
+                    ulBlockIndex,
+                    C->ulBlocksRemaining );
+        eIngestResult = eIngest_Result_Duplicate_Continue;
+    }
+    else if( C->pucFile == NULL )
+    {
+        OTA_LOG_L1( "[%s] Error: Unable to write block, file handle is NULL.\r\n", OTA_METHOD_NAME );
+        eIngestResult = eIngest_Result_BadFileHandle;
+    }
+    else /* Otherwise, process it normally... */
+    {
+        if( prvIsFileDecoded( C ) == pdTRUE )
+        {
+            /* The decoders write the decoded image to the file. A deferred block is not marked as
+             * received, so it is requested again. */
+            eIngestResult = prvDecodeDataBlock( C, ulBlockIndex, pucData, ulBlockSize );
+        }
+        else
+        {
+            int32_t lBytesWritten = prvWriteFile( C, ( ulBlockIndex * OTA_FILE_BLOCK_SIZE ), pucData, ulBlockSize );
+
+            if( lBytesWritten < 0 )
+            {
+                OTA_LOG_L1( "[%s] Error (%d) writing file block\r\n", OTA_METHOD_NAME, lBytesWritten );
+                eIngestResult = eIngest_Result_WriteBlockFailed;
+            }
+            else
+            {
+                eIngestResult = eIngest_Result_Accepted_Continue;
+            }
+        }
+
+        if( eIngestResult == eIngest_Result_Accepted_Continue )
+        {
+            C->pucRxBlockBitmap[ ulByte ] &= ~ucBitMask; /* Mark this block as received in our bitmap. */
+            C->ulBlocksRemaining--;
+            prvHashDataBlock( C, ulBlockIndex, pucData, ulBlockSize );
+            prvCheckpointFile( C );
+        }
+    }
+
+    return eIngestResult;
+}
+
+
+/* Include a received block in the running file hash. The hash must see the file in order, so a block
+ * that arrives ahead of a missing one is copied to the reorder buffer until the missing block arrives.
+ * If the buffer is full, hashing stops and the PAL reads the file back from C->ulHashedBytes at close. */
+
+static void prvHashDataBlock( OTA_FileContext_t * C,
+                              uint32_t ulBlockIndex,
+                              const uint8_t * pucData,
+                              uint32_t ulBlockSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvHashDataBlock" );
+
+    uint32_t ulNextBlock, ulLastBlock;
+    const uint8_t * pucHeld;
+
+    if( ( C->pvSigVerifyContext != NULL ) && ( xOTA_Agent.xHashReorder.xHashing == pdTRUE ) )
+    {
+        ulNextBlock = C->ulHashedBytes >> otaconfigLOG2_FILE_BLOCK_SIZE;
+
+        if( ulBlockIndex == ulNextBlock )
+        {
+            CRYPTO_SignatureVerificationUpdate( C->pvSigVerifyContext, pucData, ( size_t ) ulBlockSize );
+            C->ulHashedBytes += ulBlockSize;
+
+            /* Hash any held back blocks that now follow on. Only the last block of the file can be short. */
+            ulLastBlock = ( ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE ) - 1U;
+            ulNextBlock++;
+
+            for( pucHeld = prvTakeHeldBlock( ulNextBlock ); pucHeld != NULL; pucHeld = prvTakeHeldBlock( ulNextBlock ) )
+            {
+                ulBlockSize = ( ulNextBlock == ulLastBlock ) ? ( C->ulFileSize - ( ulLastBlock * OTA_FILE_BLOCK_SIZE ) ) : OTA_FILE_BLOCK_SIZE;
+                CRYPTO_SignatureVerificationUpdate( C->pvSigVerifyContext, pucHeld, ( size_t ) ulBlockSize );
+                C->ulHashedBytes += ulBlockSize;
+                ulNextBlock++;
+            }
+        }
+        else if( prvHoldDataBlock( ulBlockIndex, pucData, ulBlockSize ) == pdFALSE )
+        {
+            OTA_LOG_L1( "[%s] Block %u can't be held back. The file will be read back from offset %u.\r\n",
+                        OTA_METHOD_NAME,
+                        ulBlockIndex,
+                        C->ulHashedBytes );
+            prvStopFileHash();
+        }
+        else
+        {
+            /* The block is hashed once the missing blocks before it arrive. */
+        }
+    }
+}
+
+
+/* Stop hashing received blocks and free the reorder buffer. The signature verification context
+ * stays with the file context, covering the blocks hashed so far. */
+
+static void prvStopFileHash( void )
+{
+    uint32_t ulSlot;
+    OTA_HashReorder_t * pxReorder = &xOTA_Agent.xHashReorder;
+
+    pxReorder->xHashing = pdFALSE;
+
+    if( pxReorder->pucBlocks != NULL )
+    {
+        vPortFree( pxReorder->pucBlocks );
+        pxReorder->pucBlocks = NULL;
+    }
+
+    for( ulSlot = 0U; ulSlot < OTA_HASH_REORDER_SLOTS; ulSlot++ )
+    {
+        pxReorder->ulBlockIndex[ ulSlot ] = OTA_NO_BLOCK;
+    }
+}
+
+
+/* Copy a block received ahead of a missing one to a free slot of the reorder buffer, allocating the
+ * buffer on first use. Returns pdFALSE if the buffer is full or can't be allocated. */
+
+static bool_t prvHoldDataBlock( uint32_t ulBlockIndex,
+                                const uint8_t * pucData,
+                                uint32_t ulBlockSize )
+{
+    uint32_t ulSlot;
+    uint32_t ulFreeSlot = OTA_NO_BLOCK;
+    bool_t xHeld = pdFALSE;
+    OTA_HashReorder_t * pxReorder = &xOTA_Agent.xHashReorder;
+
+    for( ulSlot = 0U; ulSlot < otaconfigHASH_REORDER_BLOCKS; ulSlot++ )
+    {
+        if( pxReorder->ulBlockIndex[ ulSlot ] == OTA_NO_BLOCK )
+        {
+            ulFreeSlot = ulSlot;
+        }
+    }
+
+    if( ( ulFreeSlot != OTA_NO_BLOCK ) && ( pxReorder->pucBlocks == NULL ) )
+    {
+        pxReorder->pucBlocks = ( uint8_t * ) pvPortMalloc( otaconfigHASH_REORDER_BLOCKS * OTA_FILE_BLOCK_SIZE ); /*lint !e9079 FreeRTOS malloc port returns void*. */
+    }
+
+    if( ( ulFreeSlot != OTA_NO_BLOCK ) && ( pxReorder->pucBlocks != NULL ) )
+    {
+        memcpy( &pxReorder->pucBlocks[ ulFreeSlot * OTA_FILE_BLOCK_SIZE ], pucData, ulBlockSize );
+        pxReorder->ulBlockIndex[ ulFreeSlot ] = ulBlockIndex;
+        xHeld = pdTRUE;
+    }
+
+    return xHeld;
+}
+
+
+/* Remove a block from the reorder buffer. The returned data stays valid until the next block is held. */
+
+static const uint8_t * prvTakeHeldBlock( uint32_t ulBlockIndex )
+{
+    uint32_t ulSlot;
+    const uint8_t * pucData = NULL;
+    OTA_HashReorder_t * pxReorder = &xOTA_Agent.xHashReorder;
+
+    for( ulSlot = 0U; ( ulSlot < otaconfigHASH_REORDER_BLOCKS ) && ( pucData == NULL ); ulSlot++ )
+    {
+        if( pxReorder->ulBlockIndex[ ulSlot ] == ulBlockIndex )
+        {
+            pxReorder->ulBlockIndex[ ulSlot ] = OTA_NO_BLOCK;
+            pucData = &pxReorder->pucBlocks[ ulSlot * OTA_FILE_BLOCK_SIZE ];
+        }
+    }
+
+    return pucData;
+}
+
+
+/* Tell whether the image is decoded from the received file before it is written, which is the case for
+ * compressed and delta files. Such files are received in order and are not checkpointed. */
+
+static bool_t prvIsFileDecoded( const OTA_FileContext_t * C )
+{
+    return ( ( ( C->ulFileAttributes & OTA_FILE_ATTR_COMPRESSED ) != 0U ) || ( C->pxBaseHash != NULL ) ) ? pdTRUE : pdFALSE;
+}
+
+
+/* Write part of the image decoded from a compressed or delta file and include it in the running file
+ * hash. The image is decoded in order, so all of it is hashed. */
+
+#if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) )
+    static int32_t prvWriteImageData( void * pvContext,
+                                      uint32_t ulOffset,
+                                      const uint8_t * pucData,
+                                      uint32_t ulSize )
+    {
+        DEFINE_OTA_METHOD_NAME( "prvWriteImageData" );
+
+        OTA_FileContext_t * C = ( OTA_FileContext_t * ) pvContext; /*lint !e9079 The context is the file being decoded. */
+        int32_t lBytesWritten = prvWriteFile( C, ulOffset, pucData, ulSize );
+
+        if( lBytesWritten < 0 )
+        {
+            OTA_LOG_L1( "[%s] Error writing %u bytes at offset %u\r\n", OTA_METHOD_NAME, ulSize, ulOffset );
+        }
+        else if( C->pvSigVerifyContext != NULL )
+        {
+            CRYPTO_SignatureVerificationUpdate( C->pvSigVerifyContext, pucData, ( size_t ) ulSize );
+            C->ulHashedBytes += ulSize;
+        }
+        else
+        {
+            /* The PAL checks the signature of the file at close. */
+        }
+
+        return lBytesWritten;
+    }
+#endif /* if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) ) */
+
+
+/* Apply the decompressed data of a compressed delta file. */
+
+#if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) && ( otaconfigDELTA_BUFFER_SIZE > 0U ) )
+    static int32_t prvPatchDecompressedData( void * pvContext,
+                                             uint32_t ulOffset,
+                                             const uint8_t * pucData,
+                                             uint32_t ulSize )
+    {
+        DEFINE_OTA_METHOD_NAME( "prvPatchDecompressedData" );
+
+        OTA_DeltaResult_t eResult = OTA_Delta_Update( &xOTA_Agent.xDelta, pucData, ulSize );
+
+        ( void ) pvContext;
+
+        if( eResult < eDelta_Result_Continue )
+        {
+            OTA_LOG_L1( "[%s] Error (%d) applying the delta file at offset %u.\r\n", OTA_METHOD_NAME, ( int32_t ) eResult, ulOffset );
+        }
+
+        return ( eResult < eDelta_Result_Continue ) ? -1 : ( int32_t ) ulSize;
+    }
+#endif /* if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) && ( otaconfigDELTA_BUFFER_SIZE > 0U ) ) */
+
+
+/* Read part of the running image for the delta file applier. */
+
+#if ( otaconfigDELTA_BUFFER_SIZE > 0U )
+    static int32_t prvReadBaseImage( void * pvContext,
+                                     uint32_t ulOffset,
+                                     uint8_t * pucData,
+                                     uint32_t ulSize )
+    {
+        OTA_FileContext_t * C = ( OTA_FileContext_t * ) pvContext; /*lint !e9079 The context is the file being decoded. */
+
+        return ( prvPAL_ReadBaseImage( C, ulOffset, pucData, ulSize ) == kOTA_Err_None ) ? 0 : -1;
+    }
+#endif /* otaconfigDELTA_BUFFER_SIZE */
+
+
+/* Check that the running image is the base image of the delta file by comparing its SHA-256 hash with the
+ * base hash from the job document. The whole running image is read once, when the delta file header
+ * arrives and before any of it is used. */
+
+#if ( otaconfigDELTA_BUFFER_SIZE > 0U )
+    static int32_t prvCheckBaseImage( void * pvContext,
+                                      uint32_t ulBaseSize,
+                                      uint8_t * pucBuffer,
+                                      uint32_t ulBufferSize )
+    {
+        DEFINE_OTA_METHOD_NAME( "prvCheckBaseImage" );
+
+        OTA_FileContext_t * C = ( OTA_FileContext_t * ) pvContext; /*lint !e9079 The context is the file being decoded. */
+        mbedtls_sha256_context xSHA256Context;
+        uint8_t ucHash[ OTA_BASE_HASH_SIZE ];
+        uint32_t ulOffset = 0U;
+        uint32_t ulSize;
+        int32_t lResult = 0;
+
+        mbedtls_sha256_init( &xSHA256Context );
+        ( void ) mbedtls_sha256_starts_ret( &xSHA256Context, 0 );
+
+        while( ( lResult == 0 ) && ( ulOffset < ulBaseSize ) )
+        {
+            ulSize = ( ( ulBaseSize - ulOffset ) < ulBufferSize ) ? ( ulBaseSize - ulOffset ) : ulBufferSize;
+            lResult = prvReadBaseImage( C, ulOffset, pucBuffer, ulSize );
+
+            if( lResult == 0 )
+            {
+                ( void ) mbedtls_sha256_update_ret( &xSHA256Context, pucBuffer, ulSize );
+                ulOffset += ulSize;
+            }
+        }
+
+        ( void ) mbedtls_sha256_finish_ret( &xSHA256Context, ucHash );
+        mbedtls_sha256_free( &xSHA256Context );
+
+        if( lResult != 0 )
+        {
+            OTA_LOG_L1( "[%s] Error reading the running image at offset %u.\r\n", OTA_METHOD_NAME, ulOffset );
+        }
+        else if( memcmp( ucHash, C->pxBaseHash->ucData, OTA_BASE_HASH_SIZE ) != 0 )
+        {
+            OTA_LOG_L1( "[%s] Error: The running image is not the base image of the delta file.\r\n", OTA_METHOD_NAME );
+            lResult = -1;
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] The running image is the %u byte base image of the delta file.\r\n", OTA_METHOD_NAME, ulBaseSize );
+        }
+
+        return lResult;
+    }
+#endif /* otaconfigDELTA_BUFFER_SIZE */
+
+
+/* Allocate the delta file buffer and the decompressor window as needed by the file. Compressed and delta
+ * files are rejected if decompression or delta files are not enabled. */
+
+static OTA_Err_t prvStartDecoding( OTA_FileContext_t * C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvStartDecoding" );
+
+    OTA_Err_t xErr = kOTA_Err_None;
+
+    prvStopDecoding();
+
+    if( C->pxBaseHash != NULL )
+    {
+        #if ( otaconfigDELTA_BUFFER_SIZE > 0U )
+            {
+                uint8_t * pucBuffer = NULL;
+
+                if( C->pxBaseHash->usSize != OTA_BASE_HASH_SIZE )
+                {
+                    OTA_LOG_L1( "[%s] Error: The base hash must be a SHA-256 hash.\r\n", OTA_METHOD_NAME );
+                    xErr = kOTA_Err_BaseImageMismatch;
+                }
+                else
+                {
+                    pucBuffer = ( uint8_t * ) pvPortMalloc( otaconfigDELTA_BUFFER_SIZE ); /*lint !e9079 FreeRTOS malloc port returns void*. */
+
+                    if( pucBuffer != NULL )
+                    {
+                        OTA_Delta_Init( &xOTA_Agent.xDelta,
+                                        pucBuffer,
+                                        otaconfigDELTA_BUFFER_SIZE,
+                                        prvReadBaseImage,
+                                        prvCheckBaseImage,
+                                        prvWriteImageData,
+                                        C );
+                        OTA_LOG_L1( "[%s] Receiving a delta file.\r\n", OTA_METHOD_NAME );
+                    }
+                    else
+                    {
+                        OTA_LOG_L1( "[%s] Error: No memory for the delta file buffer.\r\n", OTA_METHOD_NAME );
+                        xErr = kOTA_Err_OutOfMemory;
+                    }
+                }
+            }
+        #else /* if ( otaconfigDELTA_BUFFER_SIZE > 0U ) */
+            {
+                OTA_LOG_L1( "[%s] Error: Delta files are not supported.\r\n", OTA_METHOD_NAME );
+                xErr = kOTA_Err_FileNotSupported;
+            }
+        #endif /* otaconfigDELTA_BUFFER_SIZE */
+    }
+
+    if( ( xErr == kOTA_Err_None ) && ( ( C->ulFileAttributes & OTA_FILE_ATTR_COMPRESSED ) != 0U ) )
+    {
+        #if ( otaconfigDECOMPRESS_WINDOW_BITS > 0U )
+            {
+                uint8_t * pucWindow = ( uint8_t * ) pvPortMalloc( 1UL << otaconfigDECOMPRESS_WINDOW_BITS ); /*lint !e9079 FreeRTOS malloc port returns void*. */
+                OTA_DecompressOutput_t xOutput = prvWriteImageData;
+
+                #if ( otaconfigDELTA_BUFFER_SIZE > 0U )
+                    if( C->pxBaseHash != NULL )
+                    {
+                        xOutput = prvPatchDecompressedData; /* The decompressed data is the delta file. */
+                    }
+                #endif
+
+                if( pucWindow != NULL )
+                {
+                    OTA_Decompress_Init( &xOTA_Agent.xDecompress,
+                                         pucWindow,
+                                         1UL << otaconfigDECOMPRESS_WINDOW_BITS,
+                                         xOutput,
+                                         C );
+                    OTA_LOG_L1( "[%s] Receiving a compressed file.\r\n", OTA_METHOD_NAME );
+                }
+                else
+                {
+                    OTA_LOG_L1( "[%s] Error: No memory for the decompressor window.\r\n", OTA_METHOD_NAME );
+                    xErr = kOTA_Err_OutOfMemory;
+                }
+            }
+        #else /* if ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) */
+            {
+                OTA_LOG_L1( "[%s] Error: Compressed files are not supported.\r\n", OTA_METHOD_NAME );
+                xErr = kOTA_Err_FileNotSupported;
+            }
+        #endif /* otaconfigDECOMPRESS_WINDOW_BITS */
+    }
+
+    return xErr;
+}
+
+
+/* Pass the next data of a compressed or delta file to the decompressor or, for a delta file that is not
+ * compressed, to the delta file applier. */
+
+#if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) )
+    static bool_t prvDecodeData( const OTA_FileContext_t * C,
+                                 const uint8_t * pucData,
+                                 uint32_t ulSize )
+    {
+        DEFINE_OTA_METHOD_NAME( "prvDecodeData" );
+
+        int32_t lResult = -1;
+
+        if( ( C->ulFileAttributes & OTA_FILE_ATTR_COMPRESSED ) != 0U )
+        {
+            #if ( otaconfigDECOMPRESS_WINDOW_BITS > 0U )
+                lResult = ( int32_t ) OTA_Decompress_Update( &xOTA_Agent.xDecompress, pucData, ulSize );
+            #endif
+        }
+        else
+        {
+            #if ( otaconfigDELTA_BUFFER_SIZE > 0U )
+                lResult = ( int32_t ) OTA_Delta_Update( &xOTA_Agent.xDelta, pucData, ulSize );
+            #endif
+        }
+
+        if( lResult < 0 )
+        {
+            OTA_LOG_L1( "[%s] Error (%d) decoding the file at offset %u.\r\n", OTA_METHOD_NAME, lResult, xOTA_Agent.ulDecodedBytes );
+        }
+
+        xOTA_Agent.ulDecodedBytes += ulSize;
+
+        return ( lResult < 0 ) ? pdFALSE : pdTRUE;
+    }
+#endif /* if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) ) */
+
+
+/* Decode a received block of a compressed or delta file. The file must be decoded in order, so a block
+ * that arrives ahead of a missing one is copied to the reorder buffer until the missing block arrives.
+ * If the buffer is full, the block is deferred and requested again with the missing blocks. */
+
+static IngestResult_t prvDecodeDataBlock( OTA_FileContext_t * C,
+                                          uint32_t ulBlockIndex,
+                                          const uint8_t * pucData,
+                                          uint32_t ulBlockSize )
+{
+    IngestResult_t eIngestResult = eIngest_Result_DecodeFailed;
+
+    #if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) )
+        {
+            DEFINE_OTA_METHOD_NAME_L2( "prvDecodeDataBlock" );
+
+            uint32_t ulNextBlock = xOTA_Agent.ulDecodedBytes >> otaconfigLOG2_FILE_BLOCK_SIZE;
+            uint32_t ulLastBlock;
+            const uint8_t * pucHeld;
+            bool_t xDecoded;
+
+            if( ulBlockIndex == ulNextBlock )
+            {
+                xDecoded = prvDecodeData( C, pucData, ulBlockSize );
+
+                /* Decode any held back blocks that now follow on. Only the last block of the file can be short. */
+                ulLastBlock = ( ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE ) - 1U;
+                ulNextBlock++;
+
+                for( pucHeld = prvTakeHeldBlock( ulNextBlock );
+                     ( pucHeld != NULL ) && ( xDecoded == pdTRUE );
+                     pucHeld = prvTakeHeldBlock( ulNextBlock ) )
+                {
+                    ulBlockSize = ( ulNextBlock == ulLastBlock ) ? ( C->ulFileSize - ( ulLastBlock * OTA_FILE_BLOCK_SIZE ) ) : OTA_FILE_BLOCK_SIZE;
+                    xDecoded = prvDecodeData( C, pucHeld, ulBlockSize );
+                    ulNextBlock++;
+                }
+
+                if( xDecoded == pdTRUE )
+                {
+                    eIngestResult = eIngest_Result_Accepted_Continue;
+                }
+            }
+            else if( prvHoldDataBlock( ulBlockIndex, pucData, ulBlockSize ) == pdTRUE )
+            {
+                eIngestResult = eIngest_Result_Accepted_Continue; /* It is decoded once the missing blocks before it arrive. */
+            }
+            else
+            {
+                OTA_LOG_L2( "[%s] Block %u can't be held back until block %u arrives.\r\n", OTA_METHOD_NAME, ulBlockIndex, ulNextBlock );
+                eIngestResult = eIngest_Result_Deferred_Continue;
+            }
+        }
+    #else /* if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) ) */
+        ( void ) C;
+        ( void ) ulBlockIndex;
+        ( void ) pucData;
+        ( void ) ulBlockSize;
+    #endif /* if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) ) */
+
+    return eIngestResult;
+}
+
+
+/* Check that a compressed or delta file was completely decoded and written once its last block was
+ * received, and free the decoder buffers. Files that are not decoded always pass. */
+
+static bool_t prvFinishDecoding( const OTA_FileContext_t * C )
+{
+    bool_t xResult = pdTRUE;
+
+    #if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) )
+        {
+            DEFINE_OTA_METHOD_NAME( "prvFinishDecoding" );
+
+            #if ( otaconfigDECOMPRESS_WINDOW_BITS > 0U )
+                if( ( C->ulFileAttributes & OTA_FILE_ATTR_COMPRESSED ) != 0U )
+                {
+                    if( OTA_Decompress_Finish( &xOTA_Agent.xDecompress ) == eDecompress_Result_Complete )
+                    {
+                        OTA_LOG_L1( "[%s] %u bytes decompressed to %u bytes.\r\n",
+                                    OTA_METHOD_NAME,
+                                    C->ulFileSize,
+                                    xOTA_Agent.xDecompress.ulBytesOut );
                     }
                     else
                     {
-                        OTA_LOG_L1( "[%s] jsmn_parse didn't match token count when parsing.\r\n", OTA_METHOD_NAME );
-                        eErr = eDocParseErr_JasmineCountMismatch;
+                        OTA_LOG_L1( "[%s] Error: The compressed file ended after %u decompressed bytes.\r\n",
+                                    OTA_METHOD_NAME,
+                                    xOTA_Agent.xDecompress.ulBytesOut );
+                        xResult = pdFALSE;
                     }
                 }
-                else
+            #endif /* otaconfigDECOMPRESS_WINDOW_BITS */
+
+            #if ( otaconfigDELTA_BUFFER_SIZE > 0U )
+                if( ( xResult == pdTRUE ) && ( C->pxBaseHash != NULL ) )
                 {
-                    OTA_LOG_L1( "[%s] No memory for JSON tokens.\r\n", OTA_METHOD_NAME );
-                    eErr = eDocParseErr_OutOfMemory;
+                    if( OTA_Delta_Finish( &xOTA_Agent.xDelta ) == eDelta_Result_Complete )
+                    {
+                        OTA_LOG_L1( "[%s] %u byte delta file applied to the running image, %u byte image written.\r\n",
+                                    OTA_METHOD_NAME,
+                                    xOTA_Agent.xDelta.ulBytesIn,
+                                    xOTA_Agent.xDelta.ulBytesOut );
+                    }
+                    else
+                    {
+                        OTA_LOG_L1( "[%s] Error: The delta file ended after %u bytes of the image.\r\n",
+                                    OTA_METHOD_NAME,
+                                    xOTA_Agent.xDelta.ulBytesOut );
+                        xResult = pdFALSE;
+                    }
                 }
-            }
-            else
-            {
-                OTA_LOG_L1( "[%s] Document has too many keys.\r\n", OTA_METHOD_NAME );
-                eErr = eDocParseErr_TooManyTokens;
-            }
+            #endif /* otaconfigDELTA_BUFFER_SIZE */
         }
-        else
-        {
-            OTA_LOG_L1( "[%s] Invalid JSON document. No tokens parsed. \r\n", OTA_METHOD_NAME );
-            eErr = eDocParseErr_NoTokens;
-        }
-    }
+    #else /* if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) ) */
+        ( void ) C;
+    #endif /* if ( ( otaconfigDECOMPRESS_WINDOW_BITS > 0U ) || ( otaconfigDELTA_BUFFER_SIZE > 0U ) ) */
 
-    configASSERT( eErr != eDocParseErr_Unknown );
-    return eErr;
+    prvStopDecoding();
+
+    return xResult;
 }
 
 
-/* Prepare the document model for use by sanity checking the initialization parameters
- * and detecting all required parameters. */
+/* Free the decompressor window and the delta file buffer. */
 
-static DocParseErr_t prvInitDocModel( JSON_DocModel_t * pxDocModel,
-                                      const JSON_DocParam_t * pxBodyDef,
-                                      uint32_t ulContextBaseAddr,
-                                      uint32_t ulContextSize,
-                                      uint16_t usNumJobParams )
+static void prvStopDecoding( void )
 {
-    DEFINE_OTA_METHOD_NAME( "prvInitDocModel" );
-
-    DocParseErr_t eErr = eDocParseErr_Unknown;
-    uint32_t ulScanIndex;
-
-    /* Sanity check the model pointers and parameter count. Exclude the context base address and size since
-     * it is technically possible to create a model that writes entirely into absolute memory locations.
-     */
-    if( pxDocModel == NULL )
-    {
-        OTA_LOG_L1( "[%s] The pointer to the document model is NULL.\r\n", OTA_METHOD_NAME );
-        eErr = eDocParseErr_NullModelPointer;
-    }
-    else if( pxBodyDef == NULL )
+    if( xOTA_Agent.xDecompress.pucWindow != NULL )
     {
-        OTA_LOG_L1( "[%s] Document model 0x%08x body pointer is NULL.\r\n", OTA_METHOD_NAME, pxDocModel );
-        eErr = eDocParseErr_NullBodyPointer;
+        vPortFree( xOTA_Agent.xDecompress.pucWindow );
     }
-    else if( usNumJobParams > OTA_DOC_MODEL_MAX_PARAMS )
+
+    if( xOTA_Agent.xDelta.pucBuffer != NULL )
     {
-        OTA_LOG_L1( "[%s] Model has too many parameters (%u).\r\n", OTA_METHOD_NAME, pxDocModel->usNumModelParams );
-        eErr = eDocParseErr_TooManyParams;
+        vPortFree( xOTA_Agent.xDelta.pucBuffer );
     }
-    else
+
+    memset( &xOTA_Agent.xDecompress, 0, sizeof( xOTA_Agent.xDecompress ) );
+    memset( &xOTA_Agent.xDelta, 0, sizeof( xOTA_Agent.xDelta ) );
+    xOTA_Agent.ulDecodedBytes = 0U;
+}
+
+
+/* Write part of the file with prvPAL_WriteBlock(). The PAL returns the number of bytes written as an
+ * int16_t, so larger pieces are written in several calls. Returns ulSize or -1 if the PAL failed. This
+ * is also the output of the write-behind buffer, called from the write-behind task. */
+
+static int32_t prvWriteFileData( void * pvContext,
+                                 uint32_t ulOffset,
+                                 const uint8_t * pucData,
+                                 uint32_t ulSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvWriteFileData" );
+
+    OTA_FileContext_t * C = ( OTA_FileContext_t * ) pvContext; /*lint !e9079 The context is the file being written. */
+    int32_t lBytesWritten = 0;
+    int32_t lResult = 0;
+    uint32_t ulChunk;
+
+    while( ( lBytesWritten >= 0 ) && ( ( uint32_t ) lBytesWritten < ulSize ) )
     {
-        pxDocModel->ulContextBase = ulContextBaseAddr;
-        pxDocModel->ulContextSize = ulContextSize;
-        pxDocModel->pxBodyDef = pxBodyDef;
-        pxDocModel->usNumModelParams = usNumJobParams;
-        pxDocModel->ulParamsReceivedBitmap = 0;
-        pxDocModel->ulParamsRequiredBitmap = 0;
+        ulChunk = ulSize - ( uint32_t ) lBytesWritten;
 
-        /* Scan the model and detect all required parameters (i.e. not optional). */
-        for( ulScanIndex = 0; ulScanIndex < pxDocModel->usNumModelParams; ulScanIndex++ )
+        if( ulChunk > OTA_MAX_PAL_WRITE_SIZE )
         {
-            if( pxDocModel->pxBodyDef[ ulScanIndex ].bRequired == ( bool_t ) pdTRUE )
-            {
-                /* Add parameter to the required bitmap. */
-                pxDocModel->ulParamsRequiredBitmap |= ( 1UL << ulScanIndex );
-            }
+            ulChunk = OTA_MAX_PAL_WRITE_SIZE;
         }
 
-        eErr = eDocParseErr_None;
+        lResult = prvPAL_WriteBlock( C,
+                                     ulOffset + ( uint32_t ) lBytesWritten,
+                                     ( uint8_t * ) &pucData[ lBytesWritten ], /*lint !e9005 The PAL doesn't modify the data. */
+                                     ulChunk );
+        lBytesWritten = ( lResult == ( int32_t ) ulChunk ) ? ( lBytesWritten + lResult ) : -1;
     }
 
-    return eErr;
+    if( lBytesWritten < 0 )
+    {
+        OTA_LOG_L1( "[%s] Error (%d) writing %u bytes at offset %u\r\n", OTA_METHOD_NAME, lResult, ulSize, ulOffset );
+    }
+
+    return lBytesWritten;
 }
 
 
-/* Parse the OTA job document and validate. Return the populated
- * OTA context if valid otherwise return NULL.
- */
+/* Write part of the file. With the write-behind buffer the data is copied to its page buffers and written
+ * by the write-behind task, and a failure shows up as a failure of a later write or of the flush. */
 
-static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
-                                           uint32_t ulMsgLen )
+static int32_t prvWriteFile( OTA_FileContext_t * C,
+                             uint32_t ulOffset,
+                             const uint8_t * pucData,
+                             uint32_t ulSize )
 {
-    DEFINE_OTA_METHOD_NAME( "prvParseJobDoc" );
+    int32_t lResult;
 
-    /* This is the OTA job document model describing the parameters, their types, destination and how to extract. */
-    /*lint -e{708} We intentionally do some things lint warns about but produce the proper model. */
-    /* Namely union initialization and pointers converted to values. */
-    static const JSON_DocParam_t xOTA_JobDocModelParamStructure[ OTA_NUM_JOB_PARAMS ] =
+    #if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+        if( xOTA_Agent.pucWriteBehindPages != NULL )
+        {
+            lResult = OTA_WriteBehind_Write( &xOTA_Agent.xWriteBehind, ulOffset, pucData, ulSize );
+        }
+        else
+        {
+            lResult = prvWriteFileData( C, ulOffset, pucData, ulSize );
+        }
+    #else
+        lResult = prvWriteFileData( C, ulOffset, pucData, ulSize );
+    #endif
+
+    return lResult;
+}
+
+
+#if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+
+/* The write-behind task. Writes each page passed by the agent and passes it back, in order. The task
+ * is deleted by the agent while it waits for the next page. */
+
+    static void prvWriteBehindTask( void * pvParameters )
     {
-        { cOTA_JSON_ClientTokenKey,   OTA_JOB_PARAM_OPTIONAL, { ( uint32_t ) &xOTA_Agent.pucClientTokenFromJob }, eModelParamType_StringInDoc, JSMN_STRING    }, /*lint !e9078 !e923 Get address of token as value. */
-        { cOTA_JSON_ExecutionKey,     OTA_JOB_PARAM_REQUIRED, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Object,      JSMN_OBJECT    },
-        { cOTA_JSON_JobIDKey,         OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pucJobName )     }, eModelParamType_StringCopy,  JSMN_STRING    },
-        { cOTA_JSON_StatusDetailsKey, OTA_JOB_PARAM_OPTIONAL, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Object,      JSMN_OBJECT    },
-        { cOTA_JSON_SelfTestKey,      OTA_JOB_PARAM_OPTIONAL, { OFFSET_OF( OTA_FileContext_t, xIsInSelfTest )  }, eModelParamType_Ident,       JSMN_STRING    },
-        { cOTA_JSON_UpdatedByKey,     OTA_JOB_PARAM_OPTIONAL, { OFFSET_OF( OTA_FileContext_t, ulUpdaterVersion )}, eModelParamType_UInt32,      JSMN_STRING    },
-        { cOTA_JSON_JobDocKey,        OTA_JOB_PARAM_REQUIRED, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Object,      JSMN_OBJECT    },
-        { cOTA_JSON_OTAUnitKey,       OTA_JOB_PARAM_REQUIRED, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Object,      JSMN_OBJECT    },
-        { cOTA_JSON_StreamNameKey,    OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pucStreamName )  }, eModelParamType_StringCopy,  JSMN_STRING    },
-        { cOTA_JSON_FileGroupKey,     OTA_JOB_PARAM_REQUIRED, { OTA_DONT_STORE_PARAM                           }, eModelParamType_Array,       JSMN_ARRAY     },
-        { cOTA_JSON_FilePathKey,      OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pucFilePath )    }, eModelParamType_StringCopy,  JSMN_STRING    },
-        { cOTA_JSON_FileSizeKey,      OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, ulFileSize )     }, eModelParamType_UInt32,      JSMN_PRIMITIVE },
-        { cOTA_JSON_FileIDKey,        OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, ulServerFileID ) }, eModelParamType_UInt32,      JSMN_PRIMITIVE },
-        { cOTA_JSON_FileCertNameKey,  OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pucCertFilepath )}, eModelParamType_StringCopy,  JSMN_STRING    },
-        { cOTA_JSON_FileSignatureKey, OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pxSignature )    }, eModelParamType_SigBase64,   JSMN_STRING    },
-        { cOTA_JSON_FileAttributeKey, OTA_JOB_PARAM_OPTIONAL, { OFFSET_OF( OTA_FileContext_t, ulFileAttributes )}, eModelParamType_UInt32,      JSMN_PRIMITIVE },
-    };
+        OTA_FileContext_t * C = ( OTA_FileContext_t * ) pvParameters; /*lint !e9079 The parameter is the file being written. */
+        OTA_WriteBehindPage_t * pxPage;
 
-    OTA_JobParseErr_t eErr = eOTA_JobParseErr_Unknown;
-    OTA_FileContext_t * pxC;
-    OTA_FileContext_t * pxFinalFile;
+        for( ; ; )
+        {
+            if( xQueueReceive( xOTA_Agent.xWriteBehindQ, &pxPage, portMAX_DELAY ) == pdTRUE )
+            {
+                ( void ) OTA_WriteBehind_Program( pxPage, prvWriteFileData, C );
+                ( void ) xQueueSendToBack( xOTA_Agent.xWrittenQ, &pxPage, portMAX_DELAY );
+            }
+        }
+    }
 
-    pxFinalFile = NULL;
-    pxC = prvGetFreeContext();
 
-    if( pxC == NULL )
+/* Submit function of the write-behind buffer. The queue holds all pages, so this never blocks. */
+
+    static void prvSubmitWriteBehindPage( void * pvContext,
+                                          OTA_WriteBehindPage_t * pxPage )
     {
-        OTA_LOG_L1( "[%s] Error! No job context available.\r\n", OTA_METHOD_NAME );
-        eErr = eOTA_JobParseErr_NoContextAvailable;
+        ( void ) pvContext;
+        ( void ) xQueueSendToBack( xOTA_Agent.xWriteBehindQ, &pxPage, portMAX_DELAY );
     }
-    else
+
+
+/* Wait function of the write-behind buffer. */
+
+    static OTA_WriteBehindPage_t * prvWaitWriteBehindPage( void * pvContext )
     {
-        JSON_DocModel_t xOTA_JobDocModel;
+        OTA_WriteBehindPage_t * pxPage = NULL;
 
-        if( prvInitDocModel( &xOTA_JobDocModel,
-                             xOTA_JobDocModelParamStructure,
-                             ( uint32_t ) pxC, /*lint !e9078 !e923 Intentionally casting context pointer to a value for prvInitDocModel. */
-                             sizeof( OTA_FileContext_t ),
-                             OTA_NUM_JOB_PARAMS ) != eDocParseErr_None )
+        ( void ) pvContext;
+
+        while( xQueueReceive( xOTA_Agent.xWrittenQ, &pxPage, portMAX_DELAY ) != pdTRUE )
         {
-            eErr = eOTA_JobParseErr_BadModelInitParams;
+            /* Keep waiting if portMAX_DELAY is not an indefinite wait. */
         }
-        else if( prvParseJSONbyModel( pcJSON, ulMsgLen, &xOTA_JobDocModel ) == eDocParseErr_None )
-        {
-            /* Validate the job document parameters. */
-            eErr = eOTA_JobParseErr_None;
 
-            if( pxC->ulFileSize == 0U )
-            {
-                OTA_LOG_L1( "[%s] Zero file size is not allowed!\r\n", OTA_METHOD_NAME );
-                eErr = eOTA_JobParseErr_ZeroFileSize;
-            }
-            /* If there's an active job, verify that it's the same as what's being reported now. */
-            /* We already checked for missing parameters so we SHOULD have a job name in the context. */
-            else if( xOTA_Agent.pucOTA_Singleton_ActiveJobName != NULL )
+        return pxPage;
+    }
+#endif /* otaconfigWRITE_BEHIND_PAGE_SIZE */
+
+
+/* Allocate the write-behind buffer for a new file and start the task that writes its pages. The size of
+ * a decoded image is not known, so its last page is only written when the buffer is flushed. */
+
+static OTA_Err_t prvStartWriteBehind( OTA_FileContext_t * C )
+{
+    OTA_Err_t xErr = kOTA_Err_None;
+
+    prvStopWriteBehind();
+
+    #if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+        {
+            DEFINE_OTA_METHOD_NAME( "prvStartWriteBehind" );
+
+            xOTA_Agent.pucWriteBehindPages = ( uint8_t * ) pvPortMalloc( otaconfigWRITE_BEHIND_PAGE_SIZE * otaconfigWRITE_BEHIND_PAGES ); /*lint !e9079 FreeRTOS malloc port returns void*. */
+            xOTA_Agent.xWriteBehindQ = xQueueCreate( otaconfigWRITE_BEHIND_PAGES, sizeof( OTA_WriteBehindPage_t * ) );
+            xOTA_Agent.xWrittenQ = xQueueCreate( otaconfigWRITE_BEHIND_PAGES, sizeof( OTA_WriteBehindPage_t * ) );
+
+            if( ( xOTA_Agent.pucWriteBehindPages == NULL ) ||
+                ( xOTA_Agent.xWriteBehindQ == NULL ) ||
+                ( xOTA_Agent.xWrittenQ == NULL ) ||
+                ( xTaskCreate( prvWriteBehindTask,
+                               "OTA Write",
+                               otaconfigWRITE_BEHIND_STACK_SIZE,
+                               C,
+                               otaconfigWRITE_BEHIND_PRIORITY,
+                               &xOTA_Agent.xWriteBehindTask ) != pdPASS ) )
             {
-                if( pxC->pucJobName != NULL )
-                {
-                    /* C->pucJobName is guaranteed to be zero terminated. */
-                    if( strcmp( ( char * ) xOTA_Agent.pucOTA_Singleton_ActiveJobName, ( char * ) pxC->pucJobName ) != 0 )
-                    {
-                        OTA_LOG_L1( "[%s] Busy with existing job. Ignoring.\r\n", OTA_METHOD_NAME );
-                        eErr = eOTA_JobParseErr_BusyWithExistingJob;
-                    }
-                    else
-                    {
-                        /* The same job is being reported so free the duplicate job name from the context. */
-                        OTA_LOG_L1( "[%s] Superfluous report of current job.\r\n", OTA_METHOD_NAME );
-                        vPortFree( pxC->pucJobName );
-                        pxC->pucJobName = NULL;
-                        eErr = eOTA_JobParseErr_BusyWithSameJob;
-                    }
-                }
-                else
-                {
-                    OTA_LOG_L1( "[%s] Null job reported while busy. Ignoring.\r\n", OTA_METHOD_NAME );
-                    eErr = eOTA_JobParseErr_NullJob;
-                }
+                OTA_LOG_L1( "[%s] Error: No memory for the write-behind buffer.\r\n", OTA_METHOD_NAME );
+                xOTA_Agent.xWriteBehindTask = NULL;
+                prvStopWriteBehind();
+                xErr = kOTA_Err_OutOfMemory;
             }
             else
             {
-                /* Assume control of the job name from the context. */
-                xOTA_Agent.pucOTA_Singleton_ActiveJobName = pxC->pucJobName;
-                pxC->pucJobName = NULL;
+                OTA_WriteBehind_Init( &xOTA_Agent.xWriteBehind,
+                                      xOTA_Agent.pucWriteBehindPages,
+                                      otaconfigWRITE_BEHIND_PAGE_SIZE,
+                                      otaconfigWRITE_BEHIND_PAGES,
+                                      ( prvIsFileDecoded( C ) == pdFALSE ) ? C->ulFileSize : 0U,
+                                      prvSubmitWriteBehindPage,
+                                      prvWaitWriteBehindPage,
+                                      NULL );
             }
+        }
+    #else /* if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U ) */
+        ( void ) C;
+    #endif /* otaconfigWRITE_BEHIND_PAGE_SIZE */
 
-            if( eErr == eOTA_JobParseErr_None )
-            {
-                /* If the job is in self test mode, don't start an
-                 * OTA update but instead do the following:
-                 *
-                 * If the firmware that performed the update was older
-                 * than the currently running firmware, set the image
-                 * state to "Testing." This is the success path.
-                 *
-                 * If it's the same or newer, reject the job since
-                 * either the firmware wasn't accepted during self
-                 * test or an incorrect image was sent by the OTA
-                 * operator.
-                 */
-                if( pxC->xIsInSelfTest == ( bool_t ) pdTRUE )
-                {
-                    OTA_LOG_L1( "[%s] In self test mode.\r\n", OTA_METHOD_NAME );
+    return xErr;
+}
 
-                    if( pxC->ulUpdaterVersion < xAppFirmwareVersion.u.ulVersion32 )
-                    {
-                        /* The running firmware version is newer than the firmware that performed
-                         * the update so this means we're ready to start the self test phase.
-                         *
-                         * Set image state accordingly and update job status with self test identifier.
-                         */
-                        ( void ) prvSetImageStateWithReason( eOTA_ImageState_Testing, ( uint32_t ) NULL );
-                    }
-                    else
-                    {
-                        if( pxC->ulUpdaterVersion > xAppFirmwareVersion.u.ulVersion32 )
-                        {
-                            /* The running firmware is older than the firmware that performed the update so reject the job. */
-                            OTA_LOG_L1( "[%s] Rejecting image because version is older than previous.\r\n", OTA_METHOD_NAME );
-                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Rejected, kOTA_Err_DowngradeNotAllowed );
-                        }
-                        else /* Version reported is the same as the running version. */
-                        {
-                            if( ( xOTA_Agent.pucClientTokenFromJob == NULL ) ||
-                                ( strtoul( ( const char * ) xOTA_Agent.pucClientTokenFromJob, NULL, 0 ) == 0U ) ) /*lint !e9007 We don't provide a modifiable variable to strtoul. */
-                            {
-                                /* The version is the same so either we're not actually the new firmware or
-                                 * someone messed up and sent firmware with the same version. In either case,
-                                 * this is a failure of the OTA update so reject the job. */
-                                OTA_LOG_L1( "[%s] Failing job. We rebooted and the version is still the same.\r\n", OTA_METHOD_NAME );
-                                ( void ) prvSetImageStateWithReason( eOTA_ImageState_Rejected, kOTA_Err_SameFirmwareVersion );
-                            }
-                            else
-                            {
-                                OTA_LOG_L1( "[%s] Ignoring job. Device must be rebooted first.\r\n", OTA_METHOD_NAME );
-                            }
-                        }
 
-                        /* All reject cases must reset the device. */
-                        ( void ) prvResetDevice(); /* Ignore return code since there's nothing we can do if we can't force reset. */
-                    }
-                }
-                else
+/* Write all pages of the write-behind buffer and wait until they are written, so that the file can be
+ * read back or resumed. Returns pdFALSE if any page written so far failed. */
+
+static bool_t prvFlushWriteBehind( void )
+{
+    bool_t xResult = pdTRUE;
+
+    #if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+        if( ( xOTA_Agent.pucWriteBehindPages != NULL ) &&
+            ( OTA_WriteBehind_Flush( &xOTA_Agent.xWriteBehind ) < 0 ) )
+        {
+            xResult = pdFALSE;
+        }
+    #endif
+
+    return xResult;
+}
+
+
+/* Write all pages of the write-behind buffer once the last block was received and free it before the
+ * PAL closes the file. */
+
+static bool_t prvFinishWriteBehind( void )
+{
+    bool_t xResult = prvFlushWriteBehind();
+
+    #if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+        {
+            DEFINE_OTA_METHOD_NAME( "prvFinishWriteBehind" );
+
+            if( xOTA_Agent.pucWriteBehindPages != NULL )
+            {
+                OTA_LOG_L1( "[%s] %u full and %u partial pages written, %u waits for a page buffer.\r\n",
+                            OTA_METHOD_NAME,
+                            xOTA_Agent.xWriteBehind.ulFullPages,
+                            xOTA_Agent.xWriteBehind.ulPartialPages,
+                            xOTA_Agent.xWriteBehind.ulWaits );
+
+                if( xResult == pdFALSE )
                 {
-                    /* Everything looks OK. Set final context structure to start OTA. */
-                    OTA_LOG_L1( "[%s] Job was accepted. Attempting to start transfer.\r\n", OTA_METHOD_NAME );
-                    pxFinalFile = pxC;
+                    OTA_LOG_L1( "[%s] Error (%d) writing the file.\r\n", OTA_METHOD_NAME, xOTA_Agent.xWriteBehind.lError );
                 }
             }
-            else
-            {
-                OTA_LOG_L1( "[%s] Error %d parsing job document.\r\n", OTA_METHOD_NAME, eErr );
-            }
         }
-        else
-        {
-            /* No need to print an error message. The JSON parser should have already. */
-            eErr = eOTA_JobParseErr_NonConformingJobDoc;
-        }
-    }
+    #endif /* otaconfigWRITE_BEHIND_PAGE_SIZE */
 
-    configASSERT( eErr != eOTA_JobParseErr_Unknown );
+    prvStopWriteBehind();
 
-    if( eErr != eOTA_JobParseErr_None )
-    {
-        if( pxC == NULL )
+    return xResult;
+}
+
+
+/* Drop the pages of the write-behind buffer that were not written and wait for the page being written,
+ * then delete the write-behind task, which is left waiting for the next page, and free the buffer. */
+
+static void prvStopWriteBehind( void )
+{
+    #if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+        if( xOTA_Agent.xWriteBehindTask != NULL )
         {
-            OTA_LOG_L1( "[%s] Error! No job context available.\r\n", OTA_METHOD_NAME );
+            OTA_WriteBehind_Discard( &xOTA_Agent.xWriteBehind );
+            vTaskDelete( xOTA_Agent.xWriteBehindTask );
+            xOTA_Agent.xWriteBehindTask = NULL;
         }
-        else
+
+        if( xOTA_Agent.xWriteBehindQ != NULL )
         {
-            /* If job parsing failed AND there's a job ID, update the job state to FAILED with
-             * a reason code.  Without a job ID, we can't update the status in the job service. */
-            if( pxC->pucJobName != NULL )
-            {
-                OTA_LOG_L1( "[%s] Rejecting job due to OTA_JobParseErr_t %d\r\n", OTA_METHOD_NAME, eErr );
-                /* Assume control of the job name from the context. */
-                xOTA_Agent.pucOTA_Singleton_ActiveJobName = pxC->pucJobName;
-                pxC->pucJobName = NULL;
-                prvUpdateJobStatus( NULL, eJobStatus_FailedWithVal, ( int32_t ) kOTA_Err_JobParserError, ( int32_t ) eErr );
-                /* We don't need the job name memory anymore since we're done with this job. */
-                vPortFree( xOTA_Agent.pucOTA_Singleton_ActiveJobName );
-                xOTA_Agent.pucOTA_Singleton_ActiveJobName = NULL;
-            }
-            else
-            {
-                OTA_LOG_L1( "[%s] Ignoring job without ID.\r\n", OTA_METHOD_NAME );
-            }
+            vQueueDelete( xOTA_Agent.xWriteBehindQ );
+            xOTA_Agent.xWriteBehindQ = NULL;
         }
-    }
 
-    /* If we failed, free the reserved file context (C) to make it available again. */
-    if( pxFinalFile == NULL )
-    {
-        ( void ) prvOTA_Close( pxC ); /* Ignore impossible false result by design */
-    }
+        if( xOTA_Agent.xWrittenQ != NULL )
+        {
+            vQueueDelete( xOTA_Agent.xWrittenQ );
+            xOTA_Agent.xWrittenQ = NULL;
+        }
 
-    /* Return pointer to populated file context or NULL if it failed. */
-    return pxFinalFile;
+        if( xOTA_Agent.pucWriteBehindPages != NULL )
+        {
+            vPortFree( xOTA_Agent.pucWriteBehindPages );
+            xOTA_Agent.pucWriteBehindPages = NULL;
+        }
+    #endif /* otaconfigWRITE_BEHIND_PAGE_SIZE */
 }
 
 
-/* prvProcessOTAJobMsg
- *
- * We received an OTA update job message from the job notification service.
- * Process the message and prepare for receiving the file as needed.
- */
+/* Compute the FNV-1a hash of a byte array, continuing from the hash value ulHash. */
 
-static OTA_FileContext_t * prvProcessOTAJobMsg( const char * pcRawMsg,
-                                                uint32_t ulMsgLen )
+static uint32_t prvChecksum( uint32_t ulHash,
+                             const uint8_t * pucData,
+                             uint32_t ulSize )
 {
     uint32_t ulIndex;
-    uint32_t ulNumBlocks;             /* How many data pages are in the expected update image. */
-    uint32_t ulBitmapLen;             /* Length of the file block bitmap in bytes. */
-    OTA_FileContext_t * pxUpdateFile; /* Pointer to an OTA update context. */
-    OTA_Err_t xErr = kOTA_Err_Uninitialized;
 
-    /* Populate an OTA update context from the OTA job document. */
+    for( ulIndex = 0U; ulIndex < ulSize; ulIndex++ )
+    {
+        ulHash = ( ulHash ^ pucData[ ulIndex ] ) * OTA_FNV_PRIME;
+    }
 
-    pxUpdateFile = prvParseJobDoc( pcRawMsg, ulMsgLen );
+    return ulHash;
+}
 
-    if( ( pxUpdateFile != NULL ) && ( prvInSelftest() == false ) )
-    {
-        if( pxUpdateFile->pucRxBlockBitmap != NULL )
+
+/* Store a checkpoint of the file download every otaconfigCHECKPOINT_INTERVAL_BLOCKS received blocks.
+ * The checkpoint holds the block bitmap and the state of the running file hash so that a download of
+ * the same job can be resumed after a reset. Blocks held back from the hash are not part of the hash
+ * state, so they are read back by the PAL at close if the download is resumed. A failure to store the
+ * checkpoint only means that more blocks are downloaded again, so the download carries on. Pages of the
+ * write-behind buffer are written before the checkpoint, and a failure to write them fails the next
+ * block written. */
+
+static void prvCheckpointFile( OTA_FileContext_t * C )
+{
+    #if ( otaconfigCHECKPOINT_INTERVAL_BLOCKS > 0U )
         {
-            vPortFree( pxUpdateFile->pucRxBlockBitmap ); /* Free any previously allocated bitmap. */
-            pxUpdateFile->pucRxBlockBitmap = NULL;
-        }
+            DEFINE_OTA_METHOD_NAME( "prvCheckpointFile" );
 
-        /* Calculate how many bytes we need in our bitmap for tracking received blocks.
-         * The below calculation requires power of 2 page sizes. */
+            uint32_t ulNumBlocks, ulBitmapLen, ulSize;
+            size_t xStateLength = 0;
+            uint8_t * pucCheckpoint;
+            OTA_CheckpointHeader_t xHeader;
+            OTA_Err_t xErr;
 
-        ulNumBlocks = ( pxUpdateFile->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
-        ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
-        pxUpdateFile->pucRxBlockBitmap = ( uint8_t * ) pvPortMalloc( ulBitmapLen ); /*lint !e9079 FreeRTOS malloc port returns void*. */
+            ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
 
-        if( pxUpdateFile->pucRxBlockBitmap != NULL )
-        {
-            if( ( BaseType_t ) ( prvSubscribeToDataStream( pxUpdateFile ) ) == pdTRUE )
+            if( ( C->pucRxBlockBitmap != NULL ) &&
+                ( C->ulBlocksRemaining > 0U ) &&
+                ( prvIsFileDecoded( C ) == pdFALSE ) &&
+                ( ( ( ulNumBlocks - C->ulBlocksRemaining ) % otaconfigCHECKPOINT_INTERVAL_BLOCKS ) == 0U ) &&
+                ( prvFlushWriteBehind() == pdTRUE ) ) /* The blocks marked as received must be written first. */
             {
-                /* Set all bits in the bitmap to the erased state (we use 1 for erased just like flash memory). */
-                memset( pxUpdateFile->pucRxBlockBitmap, ( int ) OTA_ERASED_BLOCKS_VAL, ulBitmapLen );
+                ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
 
-                /* Mark as used any pages in the bitmap that are out of range, based on the file size.
-                 * This keeps us from requesting those pages during retry processing or if using a windowed
-                 * block request. It also avoids erroneously accepting an out of range data block should it
-                 * get past any safety checks.
-                 * Files aren't always a multiple of 8 pages (8 bits/pages per byte) so some bits of the
-                 * last byte may be out of range and those are the bits we want to clear. */
+                if( C->pvSigVerifyContext != NULL )
+                {
+                    ( void ) CRYPTO_SignatureVerificationSave( C->pvSigVerifyContext, NULL, 0, &xStateLength );
+                }
 
-                uint8_t ucBit = 1U << ( BITS_PER_BYTE - 1U );
-                uint32_t ulNumOutOfRange = ( ulBitmapLen * BITS_PER_BYTE ) - ulNumBlocks;
+                ulSize = sizeof( xHeader ) + ulBitmapLen + ( uint32_t ) xStateLength;
+                pucCheckpoint = ( uint8_t * ) pvPortMalloc( ulSize ); /*lint !e9079 FreeRTOS malloc port returns void*. */
 
-                for( ulIndex = 0U; ulIndex < ulNumOutOfRange; ulIndex++ )
+                if( pucCheckpoint != NULL )
                 {
-                    pxUpdateFile->pucRxBlockBitmap[ ulBitmapLen - 1U ] &= ~ucBit;
-                    ucBit >>= 1U;
-                }
+                    if( ( xStateLength > 0U ) &&
+                        ( CRYPTO_SignatureVerificationSave( C->pvSigVerifyContext,
+                                                            &pucCheckpoint[ sizeof( xHeader ) + ulBitmapLen ],
+                                                            xStateLength,
+                                                            &xStateLength ) == pdFALSE ) )
+                    {
+                        ulSize -= ( uint32_t ) xStateLength; /* Store the checkpoint without the hash state. */
+                        xStateLength = 0;
+                    }
 
-                pxUpdateFile->ulBlocksRemaining = ulNumBlocks; /* Initialize our blocks remaining counter. */
-                prvStartRequestTimer( pxUpdateFile );
+                    xHeader.ulMagic = OTA_CHECKPOINT_MAGIC;
+                    xHeader.ulJobNameHash = OTA_FNV_OFFSET_BASIS;
+
+                    if( xOTA_Agent.pucOTA_Singleton_ActiveJobName != NULL )
+                    {
+                        xHeader.ulJobNameHash = prvChecksum( OTA_FNV_OFFSET_BASIS,
+                                                             xOTA_Agent.pucOTA_Singleton_ActiveJobName,
+                                                             ( uint32_t ) strlen( ( const char * ) xOTA_Agent.pucOTA_Singleton_ActiveJobName ) );
+                    }
 
-                /* Create/Open the OTA file on the file system. */
-                xErr = prvPAL_CreateFileForRx( pxUpdateFile );
+                    xHeader.ulServerFileID = C->ulServerFileID;
+                    xHeader.ulFileSize = C->ulFileSize;
+                    xHeader.ulAppVersion = xAppFirmwareVersion.u.ulVersion32;
+                    xHeader.ulBlocksRemaining = C->ulBlocksRemaining;
+                    xHeader.ulHashedBytes = ( xStateLength > 0U ) ? C->ulHashedBytes : 0U;
+                    xHeader.ulHashStateLength = ( uint32_t ) xStateLength;
+                    memcpy( pucCheckpoint, &xHeader, sizeof( xHeader ) );
+                    memcpy( &pucCheckpoint[ sizeof( xHeader ) ], C->pucRxBlockBitmap, ulBitmapLen );
 
-                if( xErr != kOTA_Err_None )
+                    /* The checksum covers everything after the checksum field. */
+                    xHeader.ulChecksum = prvChecksum( OTA_FNV_OFFSET_BASIS,
+                                                      &pucCheckpoint[ OFFSET_OF( OTA_CheckpointHeader_t, ulJobNameHash ) ],
+                                                      ulSize - OFFSET_OF( OTA_CheckpointHeader_t, ulJobNameHash ) );
+                    memcpy( pucCheckpoint, &xHeader, sizeof( xHeader ) );
+
+                    xErr = prvPAL_SaveCheckpoint( C, pucCheckpoint, ulSize );
+
+                    if( xErr == kOTA_Err_None )
+                    {
+                        OTA_LOG_L1( "[%s] Checkpoint stored with %u blocks remaining.\r\n", OTA_METHOD_NAME, C->ulBlocksRemaining );
+                    }
+                    else
+                    {
+                        OTA_LOG_L1( "[%s] Error (0x%08x) storing checkpoint.\r\n", OTA_METHOD_NAME, xErr );
+                    }
+
+                    vPortFree( pucCheckpoint );
+                }
+                else
                 {
-                    ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, xErr );
-                    ( void ) prvOTA_Close( pxUpdateFile ); /* Ignore false result since we're setting the pointer to null on the next line. */
-                    pxUpdateFile = NULL;
+                    OTA_LOG_L1( "[%s] Error: No memory for checkpoint.\r\n", OTA_METHOD_NAME );
                 }
             }
-            else
-            {
-                /* Can't receive the image without a subscription. */
-                ( void ) prvOTA_Close( pxUpdateFile ); /* Ignore false result since we're setting the pointer to null on the next line. */
-                pxUpdateFile = NULL;
-            }
         }
-        else
+    #else /* if ( otaconfigCHECKPOINT_INTERVAL_BLOCKS > 0U ) */
+        ( void ) C;
+    #endif /* otaconfigCHECKPOINT_INTERVAL_BLOCKS */
+}
+
+
+/* Erase the checkpoint of the file download. This is done when the file is complete or the job
+ * fails or is aborted, since the download of the job will not be resumed after that. */
+
+static void prvEraseCheckpoint( OTA_FileContext_t * C )
+{
+    #if ( otaconfigCHECKPOINT_INTERVAL_BLOCKS > 0U )
         {
-            /* Can't receive the image without enough memory. */
-            ( void ) prvOTA_Close( pxUpdateFile ); /* Ignore false result since we're setting the pointer to null on the next line. */
-            pxUpdateFile = NULL;
-        }
-    }
+            DEFINE_OTA_METHOD_NAME( "prvEraseCheckpoint" );
 
-    return pxUpdateFile; /* Return the OTA file context. */
+            OTA_Err_t xErr = prvPAL_SaveCheckpoint( C, NULL, 0U );
+
+            if( xErr != kOTA_Err_None )
+            {
+                OTA_LOG_L1( "[%s] Error (0x%08x) erasing checkpoint.\r\n", OTA_METHOD_NAME, xErr );
+            }
+        }
+    #else
+        ( void ) C;
+    #endif /* otaconfigCHECKPOINT_INTERVAL_BLOCKS */
 }
 
 
+/* Open a partially received file with the PAL and restore the block bitmap, blocks remaining counter
+ * and running file hash from its checkpoint. The checkpoint must belong to the active job and to the
+ * same file and firmware version, and the number of missing blocks in its bitmap must match the
+ * blocks remaining counter. If it doesn't, the file is closed again and kOTA_Err_NoCheckpoint is
+ * returned so that the caller creates the file instead. The block bitmap must already be allocated. */
 
-/* prvIngestDataBlock
- *
- * A block of file data was received by the application via some configured communication protocol.
- * If it looks like it is in range, write it to persistent storage. If it's the last block we're
- * expecting, close the file and perform the final signature check on it. If the close and signature
- * check are OK, let the caller know so it can be used by the system. Firmware updates generally
- * reboot the system and perform a self test phase. If the close or signature check fails, abort
- * the file transfer and return the result and any available details to the caller.
- */
-static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
-                                          const char * pcRawMsg,
-                                          uint32_t ulMsgSize,
-                                          OTA_Err_t * pxCloseResult )
+static OTA_Err_t prvResumeFileForRx( OTA_FileContext_t * C )
 {
-    DEFINE_OTA_METHOD_NAME( "prvIngestDataBlock" );
-
-    IngestResult_t eIngestResult = eIngest_Result_Uninitialized;
-    int32_t lFileId = 0;
-    uint32_t ulBlockSize = 0;
-    uint32_t ulBlockIndex = 0;
-    uint8_t * pucPayload = NULL;
-    size_t xPayloadSize = 0;
+    OTA_Err_t xErr = kOTA_Err_NoCheckpoint;
 
-    if( C != NULL )
-    {
-        if( pxCloseResult != NULL )
+    #if ( otaconfigCHECKPOINT_INTERVAL_BLOCKS > 0U )
         {
-            *pxCloseResult = kOTA_Err_GenericIngestError; /* Default to a generic ingest function error until we prove success. */
+            DEFINE_OTA_METHOD_NAME( "prvResumeFileForRx" );
 
-            /* If we have a block bitmap available then process the message. */
-            if( C->pucRxBlockBitmap && ( C->ulBlocksRemaining > 0U ) )
+            uint32_t ulNumBlocks, ulBitmapLen, ulBufferSize, ulBlock, ulMissing, ulResumedBytes;
+            uint32_t ulSize = 0U;
+            size_t xMaxStateLength = 0;
+            uint8_t * pucCheckpoint;
+            const uint8_t * pucBitmap;
+            OTA_CheckpointHeader_t xHeader;
+            bool_t xValid = pdFALSE;
+
+            ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+            ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
+            ( void ) CRYPTO_SignatureVerificationSave( NULL, NULL, 0, &xMaxStateLength );
+            ulBufferSize = sizeof( xHeader ) + ulBitmapLen + ( uint32_t ) xMaxStateLength;
+            pucCheckpoint = ( uint8_t * ) pvPortMalloc( ulBufferSize ); /*lint !e9079 FreeRTOS malloc port returns void*. */
+
+            if( ( pucCheckpoint != NULL ) && ( C->pucRxBlockBitmap != NULL ) )
             {
-                /* Reset or start the firmware request timer. */
-                prvStartRequestTimer( C );
+                xErr = prvPAL_ResumeFileForRx( C, pucCheckpoint, ulBufferSize, &ulSize );
 
-                /* Decode the CBOR content. */
-                if( pdFALSE == OTA_CBOR_Decode_GetStreamResponseMessage(
-                        ( const uint8_t * ) pcRawMsg,
-                        ulMsgSize,
-                        &lFileId,
-                        ( int32_t * ) &ulBlockIndex, /*lint !e9087 CBOR requires pointer to int and our block index's never exceed 31 bits. */
-                        ( int32_t * ) &ulBlockSize,  /*lint !e9087 CBOR requires pointer to int and our block sizes never exceed 31 bits. */
-                        &pucPayload,                 /* This payload gets malloc'd by OTA_CBOR_Decode_GetStreamResponseMessage(). We must free it. */
-                        ( size_t * ) &xPayloadSize ) )
-                {
-                    eIngestResult = eIngest_Result_BadData;
-                }
-                else
+                if( ( xErr == kOTA_Err_None ) && ( ulSize >= sizeof( xHeader ) ) && ( ulSize <= ulBufferSize ) )
                 {
-                    /* Validate the block index and size. */
-                    /* If it is NOT the last block, it MUST be equal to a full block size. */
-                    /* If it IS the last block, it MUST be equal to the expected remainder. */
-                    /* If the block ID is out of range, that's an error so abort. */
-                    uint32_t ulLastBlock = ( ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE ) - 1U;
-
-                    if( ( ( ( uint32_t ) ulBlockIndex < ulLastBlock ) && ( ulBlockSize == OTA_FILE_BLOCK_SIZE ) ) ||
-                        ( ( ( uint32_t ) ulBlockIndex == ulLastBlock ) && ( ( uint32_t ) ulBlockSize == ( C->ulFileSize - ( ulLastBlock * OTA_FILE_BLOCK_SIZE ) ) ) ) )
+                    memcpy( &xHeader, pucCheckpoint, sizeof( xHeader ) );
+                    pucBitmap = &pucCheckpoint[ sizeof( xHeader ) ];
+
+                    if( ( xHeader.ulMagic == OTA_CHECKPOINT_MAGIC ) &&
+                        ( xHeader.ulChecksum == prvChecksum( OTA_FNV_OFFSET_BASIS,
+                                                             &pucCheckpoint[ OFFSET_OF( OTA_CheckpointHeader_t, ulJobNameHash ) ],
+                                                             ulSize - OFFSET_OF( OTA_CheckpointHeader_t, ulJobNameHash ) ) ) &&
+                        ( xOTA_Agent.pucOTA_Singleton_ActiveJobName != NULL ) &&
+                        ( xHeader.ulJobNameHash == prvChecksum( OTA_FNV_OFFSET_BASIS,
+                                                                xOTA_Agent.pucOTA_Singleton_ActiveJobName,
+                                                                ( uint32_t ) strlen( ( const char * ) xOTA_Agent.pucOTA_Singleton_ActiveJobName ) ) ) &&
+                        ( xHeader.ulServerFileID == C->ulServerFileID ) &&
+                        ( xHeader.ulFileSize == C->ulFileSize ) &&
+                        ( xHeader.ulAppVersion == xAppFirmwareVersion.u.ulVersion32 ) &&
+                        ( xHeader.ulBlocksRemaining > 0U ) &&
+                        ( xHeader.ulBlocksRemaining <= ulNumBlocks ) &&
+                        ( xHeader.ulHashedBytes <= C->ulFileSize ) &&
+                        ( ulSize == ( sizeof( xHeader ) + ulBitmapLen + xHeader.ulHashStateLength ) ) )
                     {
-                        OTA_LOG_L1( "[%s] Received file block %u, size %u\r\n", OTA_METHOD_NAME, ulBlockIndex, ulBlockSize );
-
-                        /* Create bit mask for use in our bitmap. */
-                        uint8_t ucBitMask = 1U << ( ulBlockIndex % BITS_PER_BYTE ); /*lint !e9031 The composite expression will never be greater than BITS_PER_BYTE(8). */
-                        /* Calculate byte offset into bitmap. */
-                        uint32_t ulByte = ulBlockIndex >> LOG2_BITS_PER_BYTE;
+                        /* Count the missing blocks to make sure the bitmap and counter agree. */
+                        ulMissing = 0U;
 
-                        if( ( C->pucRxBlockBitmap[ ulByte ] & ucBitMask ) == 0U ) /* If we've already received this block... */
-                        {
-                            OTA_LOG_L1( "[%s] block %u is a DUPLICATE. %u blocks remaining.\r\n", OTA_METHOD_NAME,
-                                        ulBlockIndex,
-                                        C->ulBlocksRemaining );
-                            eIngestResult = eIngest_Result_Duplicate_Continue;
-                            *pxCloseResult = kOTA_Err_None; /* This is a success path. */
-                        }
-                        else /* Otherwise, process it normally... */
+                        for( ulBlock = 0U; ulBlock < ( ulBitmapLen * BITS_PER_BYTE ); ulBlock++ )
                         {
-                            if( C->pucFile != NULL )
-                            {
-                                int32_t lBytesWritten = prvPAL_WriteBlock( C, ( ulBlockIndex * OTA_FILE_BLOCK_SIZE ), pucPayload, ( uint32_t ) ulBlockSize );
-
-                                if( lBytesWritten < 0 )
-                                {
-                                    OTA_LOG_L1( "[%s] Error (%d) writing file block\r\n", OTA_METHOD_NAME, lBytesWritten );
-                                    eIngestResult = eIngest_Result_WriteBlockFailed;
-                                }
-                                else
-                                {
-                                    C->pucRxBlockBitmap[ ulByte ] &= ~ucBitMask; /* Mark this block as received in our bitmap. */
-                                    C->ulBlocksRemaining--;
-                                    eIngestResult = eIngest_Result_Accepted_Continue;
-                                    *pxCloseResult = kOTA_Err_None; /* This is a success path. */
-                                }
-                            }
-                            else
+                            if( ( pucBitmap[ ulBlock >> LOG2_BITS_PER_BYTE ] & ( 1U << ( ulBlock % BITS_PER_BYTE ) ) ) != 0U )
                             {
-                                OTA_LOG_L1( "[%s] Error: Unable to write block, file handle is NULL.\r\n", OTA_METHOD_NAME );
-                                eIngestResult = eIngest_Result_BadFileHandle;
+                                ulMissing++;
                             }
+                        }
 
-                            if( C->ulBlocksRemaining == 0U )
-                            {
-                                OTA_LOG_L1( "[%s] Received final expected block of file.\r\n", OTA_METHOD_NAME );
-                                prvStopRequestTimer( C );         /* Don't request any more since we're done. */
-                                vPortFree( C->pucRxBlockBitmap ); /* Free the bitmap now that we're done with the download. */
-                                C->pucRxBlockBitmap = NULL;
-
-                                if( C->pucFile != NULL )
-                                {
-                                    *pxCloseResult = prvPAL_CloseFile( C );
+                        xValid = ( ulMissing == xHeader.ulBlocksRemaining ) ? pdTRUE : pdFALSE;
+                    }
 
-                                    if( *pxCloseResult == kOTA_Err_None )
-                                    {
-                                        OTA_LOG_L1( "[%s] File receive complete and signature is valid.\r\n", OTA_METHOD_NAME );
-                                        eIngestResult = eIngest_Result_FileComplete;
-                                    }
-                                    else
-                                    {
-                                        uint32_t ulCloseResult = ( uint32_t ) *pxCloseResult;
-                                        OTA_LOG_L1( "[%s] Error (%u:0x%06x) closing OTA file.\r\n",
-                                                    OTA_METHOD_NAME,
-                                                    ulCloseResult >> kOTA_MainErrShiftDownBits,
-                                                    ulCloseResult & ( uint32_t ) kOTA_PAL_ErrMask );
+                    if( xValid == pdTRUE )
+                    {
+                        memcpy( C->pucRxBlockBitmap, pucBitmap, ulBitmapLen );
+                        C->ulBlocksRemaining = xHeader.ulBlocksRemaining;
+                        C->ulHashedBytes = 0U;
+
+                        /* Without the hash state, the PAL reads the whole file back at close. */
+                        if( ( xHeader.ulHashStateLength > 0U ) &&
+                            ( CRYPTO_SignatureVerificationRestore( &C->pvSigVerifyContext,
+                                                                  &pucBitmap[ ulBitmapLen ],
+                                                                  ( size_t ) xHeader.ulHashStateLength ) == pdTRUE ) )
+                        {
+                            C->ulHashedBytes = xHeader.ulHashedBytes;
+                        }
 
-                                        if( ( ulCloseResult & kOTA_Main_ErrMask ) == kOTA_Err_SignatureCheckFailed )
-                                        {
-                                            eIngestResult = eIngest_Result_SigCheckFail;
-                                        }
-                                        else
-                                        {
-                                            eIngestResult = eIngest_Result_FileCloseFail;
-                                        }
-                                    }
+                        /* Only the last block of the file can be short. */
+                        ulResumedBytes = ( ulNumBlocks - C->ulBlocksRemaining ) * OTA_FILE_BLOCK_SIZE;
 
-                                    C->pucFile = NULL; /* File is now closed so clear the file handle in the context. */
-                                }
-                                else
-                                {
-                                    OTA_LOG_L1( "[%s] Error: File handle is NULL after last block received.\r\n", OTA_METHOD_NAME );
-                                    eIngestResult = eIngest_Result_BadFileHandle;
-                                }
-                            }
-                            else
-                            {
-                                OTA_LOG_L1( "[%s] Remaining: %u\r\n", OTA_METHOD_NAME, C->ulBlocksRemaining );
-                            }
+                        if( prvRangeHasMissingBlocks( C, ulNumBlocks - 1U, ulNumBlocks ) == pdFALSE )
+                        {
+                            ulResumedBytes -= ( ulNumBlocks * OTA_FILE_BLOCK_SIZE ) - C->ulFileSize;
                         }
+
+                        xOTA_Agent.xStatistics.ulOTA_ResumedBytes += ulResumedBytes;
+                        OTA_LOG_L1( "[%s] Resumed file with %u blocks remaining, %u bytes not downloaded again.\r\n",
+                                    OTA_METHOD_NAME,
+                                    C->ulBlocksRemaining,
+                                    ulResumedBytes );
                     }
                     else
                     {
-                        OTA_LOG_L1( "[%s] Error! Block %u out of expected range! Size %u\r\n", OTA_METHOD_NAME, ulBlockIndex, ulBlockSize );
-                        eIngestResult = eIngest_Result_BlockOutOfRange;
+                        OTA_LOG_L1( "[%s] Checkpoint does not match the job. Creating the file.\r\n", OTA_METHOD_NAME );
+                        ( void ) prvPAL_Abort( C );
+                        xErr = kOTA_Err_NoCheckpoint;
                     }
                 }
+                else if( xErr == kOTA_Err_None )
+                {
+                    ( void ) prvPAL_Abort( C ); /* The checkpoint is too short or too long to be valid. */
+                    xErr = kOTA_Err_NoCheckpoint;
+                }
+                else
+                {
+                    /* There is no checkpoint to resume from. */
+                }
             }
-            else
+
+            if( pucCheckpoint != NULL )
             {
-                eIngestResult = eIngest_Result_UnexpectedBlock;
+                vPortFree( pucCheckpoint );
             }
         }
-        else
-        {
-            eIngestResult = eIngest_Result_NullResultPointer;
-        }
-    }
-    else
-    {
-        eIngestResult = eIngest_Result_NullContext;
-    }
-
-    if( NULL != pucPayload )
-    {
-        vPortFree( pucPayload );
-    }
+    #else /* if ( otaconfigCHECKPOINT_INTERVAL_BLOCKS > 0U ) */
+        ( void ) C;
+    #endif /* otaconfigCHECKPOINT_INTERVAL_BLOCKS */
 
-    return eIngestResult;
+    return xErr;
 }
 
 
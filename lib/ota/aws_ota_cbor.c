@@ -49,25 +49,33 @@ typedef struct OTAMessageDecodeContext
 } OTAMessageDecodeContext_t, * OTAMessageDecodeContextPtr_t;
 
 /**
- * @brief Decode a Get Stream response message from AWS IoT OTA.
+ * @brief Decode the header fields of a Get Stream response message from AWS
+ * IoT OTA and find the block payload.
+ *
+ * The payload value refers to the parser, so the parser must remain in scope
+ * for as long as the payload value is used. The client token is only decoded
+ * if pcClientToken is not NULL. It is empty if the message has none or if it
+ * doesn't fit in the buffer.
  */
-BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageBuffer,
-                                                     size_t xMessageSize,
-                                                     int32_t * plFileId,
-                                                     int32_t * plBlockId,
-                                                     int32_t * plBlockSize,
-                                                     uint8_t ** ppucPayload,
-                                                     size_t * pxPayloadSize )
+static CborError prvDecodeGetStreamResponseHeader( const uint8_t * pucMessageBuffer,
+                                                   size_t xMessageSize,
+                                                   int32_t * plFileId,
+                                                   int32_t * plBlockId,
+                                                   int32_t * plBlockSize,
+                                                   char * pcClientToken,
+                                                   size_t xClientTokenSize,
+                                                   CborParser * pxCborParser,
+                                                   CborValue * pxPayloadValue )
 {
     CborError xCborResult = CborNoError;
-    CborParser xCborParser;
     CborValue xCborValue, xCborMap;
+    size_t xTokenSize;
 
     /* Initialize the parser. */
     xCborResult = cbor_parser_init( pucMessageBuffer,
                                     xMessageSize,
                                     0,
-                                    &xCborParser,
+                                    pxCborParser,
                                     &xCborMap );
 
     /* Get the outer element and confirm that it's a "map," i.e., a set of
@@ -80,6 +88,29 @@ BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageB
         }
     }
 
+    /* Find the client token of the request the block answers. */
+    if( ( CborNoError == xCborResult ) && ( NULL != pcClientToken ) )
+    {
+        pcClientToken[ 0 ] = '\0';
+        xCborResult = cbor_value_map_find_value( &xCborMap,
+                                                 OTA_CBOR_CLIENTTOKEN_KEY,
+                                                 &xCborValue );
+
+        if( ( CborNoError == xCborResult ) &&
+            ( CborTextStringType == cbor_value_get_type( &xCborValue ) ) )
+        {
+            xTokenSize = xClientTokenSize;
+
+            if( CborNoError != cbor_value_copy_text_string( &xCborValue,
+                                                            pcClientToken,
+                                                            &xTokenSize,
+                                                            NULL ) )
+            {
+                pcClientToken[ 0 ] = '\0';
+            }
+        }
+    }
+
     /* Find the file ID. */
     if( CborNoError == xCborResult )
     {
@@ -151,17 +182,45 @@ BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageB
     {
         xCborResult = cbor_value_map_find_value( &xCborMap,
                                                  OTA_CBOR_BLOCKPAYLOAD_KEY,
-                                                 &xCborValue );
+                                                 pxPayloadValue );
     }
 
     if( CborNoError == xCborResult )
     {
-        if( CborByteStringType != cbor_value_get_type( &xCborValue ) )
+        if( CborByteStringType != cbor_value_get_type( pxPayloadValue ) )
         {
             xCborResult = CborErrorIllegalType;
         }
     }
 
+    return xCborResult;
+}
+
+/**
+ * @brief Decode a Get Stream response message from AWS IoT OTA.
+ */
+BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageBuffer,
+                                                     size_t xMessageSize,
+                                                     int32_t * plFileId,
+                                                     int32_t * plBlockId,
+                                                     int32_t * plBlockSize,
+                                                     uint8_t ** ppucPayload,
+                                                     size_t * pxPayloadSize )
+{
+    CborError xCborResult = CborNoError;
+    CborParser xCborParser;
+    CborValue xCborValue;
+
+    xCborResult = prvDecodeGetStreamResponseHeader( pucMessageBuffer,
+                                                    xMessageSize,
+                                                    plFileId,
+                                                    plBlockId,
+                                                    plBlockSize,
+                                                    NULL,
+                                                    0,
+                                                    &xCborParser,
+                                                    &xCborValue );
+
     if( CborNoError == xCborResult )
     {
         xCborResult = cbor_value_calculate_string_length( &xCborValue,
@@ -189,6 +248,57 @@ BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageB
     return CborNoError == xCborResult;
 }
 
+/**
+ * @brief Decode a Get Stream response message from AWS IoT OTA without
+ * copying the block payload.
+ */
+BaseType_t OTA_CBOR_Decode_GetStreamResponseMessageInPlace( const uint8_t * pucMessageBuffer,
+                                                            size_t xMessageSize,
+                                                            int32_t * plFileId,
+                                                            int32_t * plBlockId,
+                                                            int32_t * plBlockSize,
+                                                            const uint8_t ** ppucPayload,
+                                                            size_t * pxPayloadSize,
+                                                            char * pcClientToken,
+                                                            size_t xClientTokenSize )
+{
+    CborError xCborResult = CborNoError;
+    CborParser xCborParser;
+    CborValue xCborValue;
+
+    xCborResult = prvDecodeGetStreamResponseHeader( pucMessageBuffer,
+                                                    xMessageSize,
+                                                    plFileId,
+                                                    plBlockId,
+                                                    plBlockSize,
+                                                    pcClientToken,
+                                                    xClientTokenSize,
+                                                    &xCborParser,
+                                                    &xCborValue );
+
+    /* Only a payload sent as one definite length string is contiguous in
+     * the message buffer. */
+    if( CborNoError == xCborResult )
+    {
+        xCborResult = cbor_value_get_string_length( &xCborValue,
+                                                    pxPayloadSize );
+    }
+
+    /* Skip over the payload. This also checks that all of it is inside the
+     * message buffer. The payload then ends where the next value starts. */
+    if( CborNoError == xCborResult )
+    {
+        xCborResult = cbor_value_advance( &xCborValue );
+    }
+
+    if( CborNoError == xCborResult )
+    {
+        *ppucPayload = cbor_value_get_next_byte( &xCborValue ) - *pxPayloadSize;
+    }
+
+    return CborNoError == xCborResult;
+}
+
 
 
 /**
@@ -0,0 +1,273 @@
+/*
+ * Amazon FreeRTOS OTA Agent V1.0.1
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_ota_decompress.c
+ * @brief Streaming LZSS decompressor for compressed Over-the-Air update files.
+ */
+
+#include <string.h>
+#include "aws_ota_decompress.h"
+
+/* The parts of the stream, in the order they are decoded. */
+
+#define DECOMPRESS_STATE_HEADER     0U /* Receiving the file header. */
+#define DECOMPRESS_STATE_TAG        1U /* Next is the bit telling a literal from a back reference. */
+#define DECOMPRESS_STATE_LITERAL    2U /* Next is a literal byte. */
+#define DECOMPRESS_STATE_OFFSET     3U /* Next is the offset of a back reference. */
+#define DECOMPRESS_STATE_LENGTH     4U /* Next is the length of a back reference. */
+#define DECOMPRESS_STATE_DONE       5U /* The whole image has been produced. */
+
+#define DECOMPRESS_MIN_LENGTH_BITS  3U /* Smallest supported log 2 of the maximum match length. */
+
+static const uint8_t ucDecompressMagic[ 4 ] = { ( uint8_t ) 'L', ( uint8_t ) 'Z', ( uint8_t ) 'S', ( uint8_t ) 'S' };
+
+
+/* Pass the part of the window not yet written to the output function. The window is written
+ * each time it wraps, so the unwritten part never wraps. */
+
+static OTA_DecompressResult_t prvWriteWindow( OTA_Decompress_t * pxCtx )
+{
+    OTA_DecompressResult_t eResult = eDecompress_Result_Continue;
+    uint32_t ulSize = pxCtx->ulBytesOut - pxCtx->ulBytesWritten;
+
+    if( ulSize > 0U )
+    {
+        if( pxCtx->xOutput( pxCtx->pvOutputContext,
+                            pxCtx->ulBytesWritten,
+                            &pxCtx->pucWindow[ pxCtx->ulBytesWritten & pxCtx->ulWindowMask ],
+                            ulSize ) < 0 )
+        {
+            eResult = eDecompress_Result_WriteFailed;
+        }
+        else
+        {
+            pxCtx->ulBytesWritten = pxCtx->ulBytesOut;
+        }
+    }
+
+    return eResult;
+}
+
+
+/* Append a byte to the decompressed image, writing the window out when it is full or the image
+ * is complete. */
+
+static OTA_DecompressResult_t prvPutByte( OTA_Decompress_t * pxCtx,
+                                          uint8_t ucByte )
+{
+    OTA_DecompressResult_t eResult = eDecompress_Result_Continue;
+
+    pxCtx->pucWindow[ pxCtx->ulBytesOut & pxCtx->ulWindowMask ] = ucByte;
+    pxCtx->ulBytesOut++;
+
+    if( pxCtx->ulBytesOut == pxCtx->ulImageSize )
+    {
+        eResult = prvWriteWindow( pxCtx );
+        pxCtx->ucState = DECOMPRESS_STATE_DONE;
+    }
+    else if( ( pxCtx->ulBytesOut & pxCtx->ulWindowMask ) == 0U )
+    {
+        eResult = prvWriteWindow( pxCtx );
+    }
+    else
+    {
+        /* Keep collecting the image in the window. */
+    }
+
+    return eResult;
+}
+
+
+/* Check the completed header and prepare to decode the bit stream. */
+
+static OTA_DecompressResult_t prvParseHeader( OTA_Decompress_t * pxCtx )
+{
+    OTA_DecompressResult_t eResult = eDecompress_Result_Continue;
+    const uint8_t * pucHeader = pxCtx->ucHeader;
+
+    pxCtx->ucWindowBits = pucHeader[ 4 ];
+    pxCtx->ucLengthBits = pucHeader[ 5 ];
+    pxCtx->ulImageSize = ( uint32_t ) pucHeader[ 8 ] |
+                         ( ( uint32_t ) pucHeader[ 9 ] << 8 ) |
+                         ( ( uint32_t ) pucHeader[ 10 ] << 16 ) |
+                         ( ( uint32_t ) pucHeader[ 11 ] << 24 );
+
+    if( ( memcmp( pucHeader, ucDecompressMagic, sizeof( ucDecompressMagic ) ) != 0 ) ||
+        ( pxCtx->ucWindowBits < OTA_DECOMPRESS_MIN_WINDOW_BITS ) ||
+        ( pxCtx->ucWindowBits > OTA_DECOMPRESS_MAX_WINDOW_BITS ) ||
+        ( pxCtx->ucLengthBits < DECOMPRESS_MIN_LENGTH_BITS ) ||
+        ( pxCtx->ucLengthBits >= pxCtx->ucWindowBits ) ||
+        ( pucHeader[ 6 ] != 0U ) ||
+        ( pucHeader[ 7 ] != 0U ) )
+    {
+        eResult = eDecompress_Result_BadHeader;
+    }
+    else if( ( 1UL << pxCtx->ucWindowBits ) > pxCtx->ulWindowBufferSize )
+    {
+        eResult = eDecompress_Result_BadWindow;
+    }
+    else
+    {
+        /* Back references before the start of the image read zeros. */
+        pxCtx->ulWindowMask = ( 1UL << pxCtx->ucWindowBits ) - 1UL;
+        memset( pxCtx->pucWindow, 0, pxCtx->ulWindowMask + 1UL );
+        pxCtx->ucState = ( pxCtx->ulImageSize > 0U ) ? DECOMPRESS_STATE_TAG : DECOMPRESS_STATE_DONE;
+    }
+
+    return eResult;
+}
+
+
+void OTA_Decompress_Init( OTA_Decompress_t * pxCtx,
+                          uint8_t * pucWindow,
+                          uint32_t ulWindowBufferSize,
+                          OTA_DecompressOutput_t xOutput,
+                          void * pvOutputContext )
+{
+    memset( pxCtx, 0, sizeof( OTA_Decompress_t ) );
+    pxCtx->pucWindow = pucWindow;
+    pxCtx->ulWindowBufferSize = ( pucWindow != NULL ) ? ulWindowBufferSize : 0U;
+    pxCtx->xOutput = xOutput;
+    pxCtx->pvOutputContext = pvOutputContext;
+    pxCtx->ucState = DECOMPRESS_STATE_HEADER;
+}
+
+
+OTA_DecompressResult_t OTA_Decompress_Update( OTA_Decompress_t * pxCtx,
+                                              const uint8_t * pucData,
+                                              uint32_t ulSize )
+{
+    OTA_DecompressResult_t eResult = eDecompress_Result_Continue;
+    uint32_t ulIndex = 0U;
+    uint32_t ulHeaderBytes = 0U;
+    uint32_t ulBitBuffer = pxCtx->ulBitBuffer;
+    uint32_t ulBitCount = pxCtx->ucBitCount;
+    uint32_t ulNeeded, ulValue, ulLength;
+
+    /* Collect the header, which may arrive in pieces. */
+    while( ( pxCtx->ucState == DECOMPRESS_STATE_HEADER ) && ( ulIndex < ulSize ) && ( eResult == eDecompress_Result_Continue ) )
+    {
+        pxCtx->ucHeader[ pxCtx->ulBytesIn + ulHeaderBytes ] = pucData[ ulIndex ];
+        ulHeaderBytes++;
+        ulIndex++;
+
+        if( ( pxCtx->ulBytesIn + ulHeaderBytes ) == OTA_DECOMPRESS_HEADER_SIZE )
+        {
+            eResult = prvParseHeader( pxCtx );
+        }
+    }
+
+    /* Decode the bit stream. Each field is decoded once the bit buffer holds all of its bits, so a
+     * field split across two calls is decoded when the rest of it arrives. Fields are at most
+     * OTA_DECOMPRESS_MAX_WINDOW_BITS long, so the bit buffer never holds more than 22 bits. */
+    while( ( eResult == eDecompress_Result_Continue ) &&
+           ( pxCtx->ucState != DECOMPRESS_STATE_HEADER ) &&
+           ( pxCtx->ucState != DECOMPRESS_STATE_DONE ) )
+    {
+        switch( pxCtx->ucState )
+        {
+            case DECOMPRESS_STATE_TAG:
+                ulNeeded = 1U;
+                break;
+
+            case DECOMPRESS_STATE_LITERAL:
+                ulNeeded = 8U;
+                break;
+
+            case DECOMPRESS_STATE_OFFSET:
+                ulNeeded = pxCtx->ucWindowBits;
+                break;
+
+            default: /* DECOMPRESS_STATE_LENGTH */
+                ulNeeded = pxCtx->ucLengthBits;
+                break;
+        }
+
+        while( ( ulBitCount < ulNeeded ) && ( ulIndex < ulSize ) )
+        {
+            ulBitBuffer = ( ulBitBuffer << 8 ) | pucData[ ulIndex ];
+            ulBitCount += 8U;
+            ulIndex++;
+        }
+
+        if( ulBitCount < ulNeeded )
+        {
+            break; /* Wait for more data. */
+        }
+
+        ulBitCount -= ulNeeded;
+        ulValue = ( ulBitBuffer >> ulBitCount ) & ( ( 1UL << ulNeeded ) - 1UL );
+
+        switch( pxCtx->ucState )
+        {
+            case DECOMPRESS_STATE_TAG:
+                pxCtx->ucState = ( ulValue != 0U ) ? DECOMPRESS_STATE_LITERAL : DECOMPRESS_STATE_OFFSET;
+                break;
+
+            case DECOMPRESS_STATE_LITERAL:
+                pxCtx->ucState = DECOMPRESS_STATE_TAG;
+                eResult = prvPutByte( pxCtx, ( uint8_t ) ulValue );
+                break;
+
+            case DECOMPRESS_STATE_OFFSET:
+                pxCtx->ulOffset = ulValue + 1U;
+                pxCtx->ucState = DECOMPRESS_STATE_LENGTH;
+                break;
+
+            default: /* DECOMPRESS_STATE_LENGTH */
+                pxCtx->ucState = DECOMPRESS_STATE_TAG;
+
+                /* Copy the match from the window. It may overlap the bytes it produces. */
+                for( ulLength = ulValue + 1U;
+                     ( ulLength > 0U ) && ( eResult == eDecompress_Result_Continue ) && ( pxCtx->ucState != DECOMPRESS_STATE_DONE );
+                     ulLength-- )
+                {
+                    eResult = prvPutByte( pxCtx, pxCtx->pucWindow[ ( pxCtx->ulBytesOut - pxCtx->ulOffset ) & pxCtx->ulWindowMask ] );
+                }
+
+                break;
+        }
+    }
+
+    pxCtx->ulBitBuffer = ulBitBuffer;
+    pxCtx->ucBitCount = ( uint8_t ) ulBitCount;
+
+    pxCtx->ulBytesIn += ulSize; /* Any data after the end of the image is consumed too. */
+
+    if( ( eResult == eDecompress_Result_Continue ) && ( pxCtx->ucState == DECOMPRESS_STATE_DONE ) )
+    {
+        eResult = eDecompress_Result_Complete;
+    }
+
+    return eResult;
+}
+
+
+OTA_DecompressResult_t OTA_Decompress_Finish( const OTA_Decompress_t * pxCtx )
+{
+    return ( ( pxCtx->ucState == DECOMPRESS_STATE_DONE ) && ( pxCtx->ulBytesWritten == pxCtx->ulImageSize ) ) ?
+           eDecompress_Result_Complete : eDecompress_Result_Incomplete;
+}
@@ -0,0 +1,375 @@
+/*
+ * Amazon FreeRTOS OTA Agent V1.0.1
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_ota_delta.c
+ * @brief Streaming patch applier for delta Over-the-Air update files.
+ */
+
+#include <string.h>
+#include "aws_ota_delta.h"
+
+/* The parts of the delta file, in the order they are decoded. */
+
+#define DELTA_STATE_HEADER    0U /* Receiving the file header. */
+#define DELTA_STATE_OP        1U /* Next is an operation byte. */
+#define DELTA_STATE_LENGTH    2U /* Next is the length of the operation. */
+#define DELTA_STATE_SEEK      3U /* Next is the base image seek of a copy or add operation. */
+#define DELTA_STATE_DATA      4U /* Next are the bytes of an add or insert operation. */
+#define DELTA_STATE_DONE      5U /* The whole image has been produced. */
+
+#define DELTA_MAX_SHIFT       28U /* Bit position of the last 7 bits of a 32 bit LEB128 number. */
+
+static const uint8_t ucDeltaMagic[ 4 ] = { ( uint8_t ) 'O', ( uint8_t ) 'T', ( uint8_t ) 'A', ( uint8_t ) 'D' };
+
+
+/* Account for ulSize new bytes placed in the buffer, writing the buffer out when it is full or the
+ * image is complete. The buffer always holds the new image from ulBytesWritten on. */
+
+static OTA_DeltaResult_t prvProduce( OTA_Delta_t * pxCtx,
+                                     uint32_t ulSize )
+{
+    OTA_DeltaResult_t eResult = eDelta_Result_Continue;
+    uint32_t ulBuffered;
+
+    pxCtx->ulBytesOut += ulSize;
+    pxCtx->ulRemaining -= ulSize;
+    ulBuffered = pxCtx->ulBytesOut - pxCtx->ulBytesWritten;
+
+    if( ( ulBuffered == pxCtx->ulBufferSize ) || ( pxCtx->ulBytesOut == pxCtx->ulImageSize ) )
+    {
+        if( pxCtx->xOutput( pxCtx->pvContext, pxCtx->ulBytesWritten, pxCtx->pucBuffer, ulBuffered ) < 0 )
+        {
+            eResult = eDelta_Result_WriteFailed;
+        }
+        else
+        {
+            pxCtx->ulBytesWritten = pxCtx->ulBytesOut;
+        }
+    }
+
+    if( pxCtx->ulBytesOut == pxCtx->ulImageSize )
+    {
+        pxCtx->ucState = DELTA_STATE_DONE;
+    }
+    else if( pxCtx->ulRemaining == 0U )
+    {
+        pxCtx->ucState = DELTA_STATE_OP;
+    }
+    else
+    {
+        /* The operation goes on. */
+    }
+
+    return eResult;
+}
+
+
+/* Read the next base image bytes of the current operation into the free part of the buffer. At most
+ * ulLimit bytes are read so that an add operation doesn't read ahead of its difference bytes. */
+
+static OTA_DeltaResult_t prvReadBase( OTA_Delta_t * pxCtx,
+                                      uint32_t ulLimit,
+                                      uint32_t * pulRead )
+{
+    OTA_DeltaResult_t eResult = eDelta_Result_Continue;
+    uint32_t ulBuffered = pxCtx->ulBytesOut - pxCtx->ulBytesWritten;
+    uint32_t ulSize = pxCtx->ulBufferSize - ulBuffered;
+
+    if( ulSize > ulLimit )
+    {
+        ulSize = ulLimit;
+    }
+
+    if( pxCtx->xReadBase( pxCtx->pvContext, pxCtx->ulBasePosition, &pxCtx->pucBuffer[ ulBuffered ], ulSize ) != 0 )
+    {
+        eResult = eDelta_Result_ReadFailed;
+    }
+    else
+    {
+        pxCtx->ulBasePosition += ulSize;
+        pxCtx->ulBaseLoaded = pxCtx->ulBytesOut + ulSize;
+        *pulRead = ulSize;
+    }
+
+    return eResult;
+}
+
+
+/* Check the completed header and the base image. */
+
+static OTA_DeltaResult_t prvParseHeader( OTA_Delta_t * pxCtx )
+{
+    OTA_DeltaResult_t eResult = eDelta_Result_Continue;
+    const uint8_t * pucHeader = pxCtx->ucHeader;
+
+    pxCtx->ulBaseSize = ( uint32_t ) pucHeader[ 4 ] |
+                        ( ( uint32_t ) pucHeader[ 5 ] << 8 ) |
+                        ( ( uint32_t ) pucHeader[ 6 ] << 16 ) |
+                        ( ( uint32_t ) pucHeader[ 7 ] << 24 );
+    pxCtx->ulImageSize = ( uint32_t ) pucHeader[ 8 ] |
+                         ( ( uint32_t ) pucHeader[ 9 ] << 8 ) |
+                         ( ( uint32_t ) pucHeader[ 10 ] << 16 ) |
+                         ( ( uint32_t ) pucHeader[ 11 ] << 24 );
+
+    if( memcmp( pucHeader, ucDeltaMagic, sizeof( ucDeltaMagic ) ) != 0 )
+    {
+        eResult = eDelta_Result_BadHeader;
+    }
+    else if( ( pxCtx->xCheckBase != NULL ) &&
+             ( pxCtx->xCheckBase( pxCtx->pvContext, pxCtx->ulBaseSize, pxCtx->pucBuffer, pxCtx->ulBufferSize ) != 0 ) )
+    {
+        eResult = eDelta_Result_BaseMismatch;
+    }
+    else
+    {
+        pxCtx->ucState = ( pxCtx->ulImageSize > 0U ) ? DELTA_STATE_OP : DELTA_STATE_DONE;
+    }
+
+    return eResult;
+}
+
+
+/* Start the operation once its length, and seek if it has one, are decoded. A copy operation needs no
+ * more data from the delta file, so it is applied right away. */
+
+static OTA_DeltaResult_t prvStartOperation( OTA_Delta_t * pxCtx )
+{
+    OTA_DeltaResult_t eResult = eDelta_Result_Continue;
+    uint32_t ulRead = 0U;
+
+    if( ( pxCtx->ucOperation != OTA_DELTA_OP_INSERT ) &&
+        ( ( pxCtx->ulBasePosition > pxCtx->ulBaseSize ) ||
+          ( pxCtx->ulRemaining > ( pxCtx->ulBaseSize - pxCtx->ulBasePosition ) ) ) )
+    {
+        eResult = eDelta_Result_BadPatch;
+    }
+    else if( pxCtx->ucOperation == OTA_DELTA_OP_COPY )
+    {
+        while( ( eResult == eDelta_Result_Continue ) && ( pxCtx->ucState == DELTA_STATE_DATA ) )
+        {
+            eResult = prvReadBase( pxCtx, pxCtx->ulRemaining, &ulRead );
+
+            if( eResult == eDelta_Result_Continue )
+            {
+                eResult = prvProduce( pxCtx, ulRead );
+            }
+        }
+    }
+    else
+    {
+        /* The bytes of the operation follow. */
+        pxCtx->ulBaseLoaded = pxCtx->ulBytesOut;
+    }
+
+    return eResult;
+}
+
+
+/* Apply the bytes of an add or insert operation. Returns the number of bytes used. */
+
+static uint32_t prvApplyData( OTA_Delta_t * pxCtx,
+                              const uint8_t * pucData,
+                              uint32_t ulSize,
+                              OTA_DeltaResult_t * peResult )
+{
+    OTA_DeltaResult_t eResult = eDelta_Result_Continue;
+    uint32_t ulUsed = 0U;
+    uint32_t ulRead = 0U;
+    uint32_t ulCount, ulIndex;
+    uint8_t * pucOut;
+
+    while( ( eResult == eDelta_Result_Continue ) && ( pxCtx->ucState == DELTA_STATE_DATA ) && ( ulUsed < ulSize ) )
+    {
+        pucOut = &pxCtx->pucBuffer[ pxCtx->ulBytesOut - pxCtx->ulBytesWritten ];
+        ulCount = ulSize - ulUsed;
+
+        if( pxCtx->ucOperation == OTA_DELTA_OP_ADD )
+        {
+            if( pxCtx->ulBaseLoaded == pxCtx->ulBytesOut )
+            {
+                eResult = prvReadBase( pxCtx, pxCtx->ulRemaining, &ulRead );
+            }
+
+            if( ulCount > ( pxCtx->ulBaseLoaded - pxCtx->ulBytesOut ) )
+            {
+                ulCount = pxCtx->ulBaseLoaded - pxCtx->ulBytesOut;
+            }
+
+            for( ulIndex = 0U; ulIndex < ulCount; ulIndex++ )
+            {
+                pucOut[ ulIndex ] = ( uint8_t ) ( pucOut[ ulIndex ] + pucData[ ulUsed + ulIndex ] );
+            }
+        }
+        else
+        {
+            if( ulCount > pxCtx->ulRemaining )
+            {
+                ulCount = pxCtx->ulRemaining;
+            }
+
+            if( ulCount > ( pxCtx->ulBufferSize - ( pxCtx->ulBytesOut - pxCtx->ulBytesWritten ) ) )
+            {
+                ulCount = pxCtx->ulBufferSize - ( pxCtx->ulBytesOut - pxCtx->ulBytesWritten );
+            }
+
+            memcpy( pucOut, &pucData[ ulUsed ], ulCount );
+        }
+
+        if( eResult == eDelta_Result_Continue )
+        {
+            ulUsed += ulCount;
+            eResult = prvProduce( pxCtx, ulCount );
+        }
+    }
+
+    *peResult = eResult;
+
+    return ulUsed;
+}
+
+
+void OTA_Delta_Init( OTA_Delta_t * pxCtx,
+                     uint8_t * pucBuffer,
+                     uint32_t ulBufferSize,
+                     OTA_DeltaReadBase_t xReadBase,
+                     OTA_DeltaCheckBase_t xCheckBase,
+                     OTA_DeltaOutput_t xOutput,
+                     void * pvContext )
+{
+    memset( pxCtx, 0, sizeof( OTA_Delta_t ) );
+    pxCtx->pucBuffer = pucBuffer;
+    pxCtx->ulBufferSize = ulBufferSize;
+    pxCtx->xReadBase = xReadBase;
+    pxCtx->xCheckBase = xCheckBase;
+    pxCtx->xOutput = xOutput;
+    pxCtx->pvContext = pvContext;
+    pxCtx->ucState = DELTA_STATE_HEADER;
+}
+
+
+OTA_DeltaResult_t OTA_Delta_Update( OTA_Delta_t * pxCtx,
+                                    const uint8_t * pucData,
+                                    uint32_t ulSize )
+{
+    OTA_DeltaResult_t eResult = eDelta_Result_Continue;
+    uint32_t ulIndex = 0U;
+    uint8_t ucByte;
+
+    while( ( eResult == eDelta_Result_Continue ) && ( pxCtx->ucState != DELTA_STATE_DONE ) && ( ulIndex < ulSize ) )
+    {
+        if( pxCtx->ucState == DELTA_STATE_DATA )
+        {
+            ulIndex += prvApplyData( pxCtx, &pucData[ ulIndex ], ulSize - ulIndex, &eResult );
+        }
+        else if( pxCtx->ucState == DELTA_STATE_HEADER )
+        {
+            /* The header is the start of the file, so it may arrive in pieces but nothing precedes it. */
+            pxCtx->ucHeader[ pxCtx->ulBytesIn + ulIndex ] = pucData[ ulIndex ];
+            ulIndex++;
+
+            if( ( pxCtx->ulBytesIn + ulIndex ) == OTA_DELTA_HEADER_SIZE )
+            {
+                eResult = prvParseHeader( pxCtx );
+            }
+        }
+        else if( pxCtx->ucState == DELTA_STATE_OP )
+        {
+            pxCtx->ucOperation = pucData[ ulIndex ];
+            ulIndex++;
+            pxCtx->ulNumber = 0U;
+            pxCtx->ucShift = 0U;
+            pxCtx->ucState = DELTA_STATE_LENGTH;
+
+            if( pxCtx->ucOperation > OTA_DELTA_OP_INSERT )
+            {
+                eResult = eDelta_Result_BadPatch;
+            }
+        }
+        else /* DELTA_STATE_LENGTH or DELTA_STATE_SEEK */
+        {
+            ucByte = pucData[ ulIndex ];
+            ulIndex++;
+
+            if( ( pxCtx->ucShift == DELTA_MAX_SHIFT ) && ( ucByte > 0x0fU ) )
+            {
+                eResult = eDelta_Result_BadPatch; /* The number doesn't fit in 32 bits. */
+            }
+            else
+            {
+                pxCtx->ulNumber |= ( uint32_t ) ( ucByte & 0x7fU ) << pxCtx->ucShift;
+                pxCtx->ucShift += 7U;
+            }
+
+            if( ( eResult != eDelta_Result_Continue ) || ( ( ucByte & 0x80U ) != 0U ) )
+            {
+                /* Keep decoding the number. */
+            }
+            else if( pxCtx->ucState == DELTA_STATE_LENGTH )
+            {
+                pxCtx->ulRemaining = pxCtx->ulNumber;
+                pxCtx->ulNumber = 0U;
+                pxCtx->ucShift = 0U;
+
+                if( ( pxCtx->ulRemaining == 0U ) || ( pxCtx->ulRemaining > ( pxCtx->ulImageSize - pxCtx->ulBytesOut ) ) )
+                {
+                    eResult = eDelta_Result_BadPatch;
+                }
+                else if( pxCtx->ucOperation == OTA_DELTA_OP_INSERT )
+                {
+                    pxCtx->ucState = DELTA_STATE_DATA;
+                    eResult = prvStartOperation( pxCtx );
+                }
+                else
+                {
+                    pxCtx->ucState = DELTA_STATE_SEEK;
+                }
+            }
+            else
+            {
+                /* Undo the zigzag encoding of the seek. An out of range seek wraps around and fails the range check. */
+                pxCtx->ulBasePosition += ( pxCtx->ulNumber >> 1 ) ^ ( 0U - ( pxCtx->ulNumber & 1U ) );
+                pxCtx->ucState = DELTA_STATE_DATA;
+                eResult = prvStartOperation( pxCtx );
+            }
+        }
+    }
+
+    pxCtx->ulBytesIn += ulSize; /* Any data after the end of the image is consumed too. */
+
+    if( ( eResult == eDelta_Result_Continue ) && ( pxCtx->ucState == DELTA_STATE_DONE ) )
+    {
+        eResult = eDelta_Result_Complete;
+    }
+
+    return eResult;
+}
+
+
+OTA_DeltaResult_t OTA_Delta_Finish( const OTA_Delta_t * pxCtx )
+{
+    return ( ( pxCtx->ucState == DELTA_STATE_DONE ) && ( pxCtx->ulBytesWritten == pxCtx->ulImageSize ) ) ?
+           eDelta_Result_Complete : eDelta_Result_Incomplete;
+}
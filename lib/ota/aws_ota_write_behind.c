@@ -0,0 +1,398 @@
+/*
+ * Amazon FreeRTOS OTA Agent V1.0.1
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_ota_write_behind.c
+ * @brief Write-behind buffer for Over-the-Air update file writes.
+ */
+
+#include <string.h>
+#include "aws_ota_write_behind.h"
+
+/* States of a page buffer. */
+
+#define PAGE_STATE_FREE         0U /* The buffer is not in use. */
+#define PAGE_STATE_WRITING      1U /* The page is being written and is owned by the write-behind buffer. */
+#define PAGE_STATE_SUBMITTED    2U /* The page was submitted and is owned by the programmer until it is returned. */
+
+
+/* Wait for the next programmed page and free its buffer. The first error is kept for all further
+ * writes, since the file is incomplete once a page fails. */
+
+static void prvWaitForPage( OTA_WriteBehind_t * pxCtx )
+{
+    OTA_WriteBehindPage_t * pxPage = pxCtx->xWait( pxCtx->pvContext );
+
+    pxCtx->ulSubmitted--;
+
+    if( pxPage != NULL )
+    {
+        if( ( pxPage->lResult < 0 ) && ( pxCtx->lError == 0 ) )
+        {
+            pxCtx->lError = pxPage->lResult;
+        }
+
+        pxPage->ulOffset = OTA_WRITE_BEHIND_NO_PAGE;
+        pxPage->ucState = PAGE_STATE_FREE;
+    }
+}
+
+
+/* Hand a page to the programmer. */
+
+static void prvSubmitPage( OTA_WriteBehind_t * pxCtx,
+                           OTA_WriteBehindPage_t * pxPage )
+{
+    if( ( pxPage->ulExtents == 1U ) &&
+        ( pxPage->ulExtentStart[ 0 ] == 0U ) &&
+        ( pxPage->ulExtentEnd[ 0 ] == pxCtx->ulPageSize ) )
+    {
+        pxCtx->ulFullPages++;
+    }
+    else
+    {
+        pxCtx->ulPartialPages++;
+    }
+
+    pxPage->lResult = 0;
+    pxPage->ucState = PAGE_STATE_SUBMITTED;
+    pxCtx->ulSubmitted++;
+    pxCtx->xSubmit( pxCtx->pvContext, pxPage );
+}
+
+
+/* Get a free page buffer for the page at ulOffset. Waiting for a page being programmed is preferred
+ * over submitting an incomplete page, which costs a read-modify-write of the flash page. Returns NULL
+ * if a page failed to program. */
+
+static OTA_WriteBehindPage_t * prvStartPage( OTA_WriteBehind_t * pxCtx,
+                                             uint32_t ulOffset )
+{
+    OTA_WriteBehindPage_t * pxPage = NULL;
+    OTA_WriteBehindPage_t * pxOldest;
+    uint32_t ulIndex;
+
+    while( ( pxPage == NULL ) && ( pxCtx->lError == 0 ) )
+    {
+        pxOldest = NULL;
+
+        for( ulIndex = 0U; ulIndex < pxCtx->ulNumPages; ulIndex++ )
+        {
+            if( pxCtx->xPages[ ulIndex ].ucState == PAGE_STATE_FREE )
+            {
+                pxPage = &pxCtx->xPages[ ulIndex ];
+            }
+            else if( ( pxCtx->xPages[ ulIndex ].ucState == PAGE_STATE_WRITING ) &&
+                     ( ( pxOldest == NULL ) || ( ( int32_t ) ( pxCtx->xPages[ ulIndex ].ulSequence - pxOldest->ulSequence ) < 0 ) ) )
+            {
+                pxOldest = &pxCtx->xPages[ ulIndex ];
+            }
+            else
+            {
+                /* The page is being programmed or is younger. */
+            }
+        }
+
+        if( pxPage == NULL )
+        {
+            if( pxCtx->ulSubmitted > 0U )
+            {
+                pxCtx->ulWaits++;
+                prvWaitForPage( pxCtx );
+            }
+            else
+            {
+                prvSubmitPage( pxCtx, pxOldest );
+            }
+        }
+    }
+
+    if( pxPage != NULL )
+    {
+        pxPage->ulOffset = ulOffset;
+        pxPage->ulSequence = pxCtx->ulSequence;
+        pxPage->ulExtents = 0U;
+        pxPage->ucState = PAGE_STATE_WRITING;
+        pxCtx->ulSequence++;
+    }
+
+    return pxPage;
+}
+
+
+/* Add the written part [ulStart, ulEnd) of a page to its sorted extents, merging the extents it touches.
+ * Returns 0 if the page already has OTA_WRITE_BEHIND_MAX_EXTENTS extents that the part doesn't touch. */
+
+static uint32_t prvAddExtent( OTA_WriteBehindPage_t * pxPage,
+                              uint32_t ulStart,
+                              uint32_t ulEnd )
+{
+    uint32_t ulFirst = 0U;
+    uint32_t ulLast, ulMerged, ulIndex;
+    uint32_t ulAdded = 1U;
+
+    /* Find the extents from ulFirst up to but not including ulLast that touch the new part. */
+    while( ( ulFirst < pxPage->ulExtents ) && ( pxPage->ulExtentEnd[ ulFirst ] < ulStart ) )
+    {
+        ulFirst++;
+    }
+
+    ulLast = ulFirst;
+
+    while( ( ulLast < pxPage->ulExtents ) && ( pxPage->ulExtentStart[ ulLast ] <= ulEnd ) )
+    {
+        ulLast++;
+    }
+
+    ulMerged = ulLast - ulFirst;
+
+    if( ulMerged > 0U )
+    {
+        /* Replace the touched extents with one covering all of them and the new part. */
+        if( pxPage->ulExtentStart[ ulFirst ] < ulStart )
+        {
+            ulStart = pxPage->ulExtentStart[ ulFirst ];
+        }
+
+        if( pxPage->ulExtentEnd[ ulLast - 1U ] > ulEnd )
+        {
+            ulEnd = pxPage->ulExtentEnd[ ulLast - 1U ];
+        }
+
+        for( ulIndex = ulLast; ulIndex < pxPage->ulExtents; ulIndex++ )
+        {
+            pxPage->ulExtentStart[ ulIndex - ulMerged + 1U ] = pxPage->ulExtentStart[ ulIndex ];
+            pxPage->ulExtentEnd[ ulIndex - ulMerged + 1U ] = pxPage->ulExtentEnd[ ulIndex ];
+        }
+
+        pxPage->ulExtents -= ulMerged - 1U;
+    }
+    else if( pxPage->ulExtents < OTA_WRITE_BEHIND_MAX_EXTENTS )
+    {
+        /* Make room for a new extent. */
+        for( ulIndex = pxPage->ulExtents; ulIndex > ulFirst; ulIndex-- )
+        {
+            pxPage->ulExtentStart[ ulIndex ] = pxPage->ulExtentStart[ ulIndex - 1U ];
+            pxPage->ulExtentEnd[ ulIndex ] = pxPage->ulExtentEnd[ ulIndex - 1U ];
+        }
+
+        pxPage->ulExtents++;
+    }
+    else
+    {
+        ulAdded = 0U;
+    }
+
+    if( ulAdded != 0U )
+    {
+        pxPage->ulExtentStart[ ulFirst ] = ulStart;
+        pxPage->ulExtentEnd[ ulFirst ] = ulEnd;
+    }
+
+    return ulAdded;
+}
+
+
+void OTA_WriteBehind_Init( OTA_WriteBehind_t * pxCtx,
+                           uint8_t * pucBuffer,
+                           uint32_t ulPageSize,
+                           uint32_t ulNumPages,
+                           uint32_t ulImageSize,
+                           OTA_WriteBehindSubmit_t xSubmit,
+                           OTA_WriteBehindWait_t xWait,
+                           void * pvContext )
+{
+    uint32_t ulIndex;
+
+    memset( pxCtx, 0, sizeof( OTA_WriteBehind_t ) );
+
+    if( ulNumPages > OTA_WRITE_BEHIND_MAX_PAGES )
+    {
+        ulNumPages = OTA_WRITE_BEHIND_MAX_PAGES;
+    }
+
+    for( ulIndex = 0U; ulIndex < ulNumPages; ulIndex++ )
+    {
+        pxCtx->xPages[ ulIndex ].pucData = &pucBuffer[ ulIndex * ulPageSize ];
+        pxCtx->xPages[ ulIndex ].ulOffset = OTA_WRITE_BEHIND_NO_PAGE;
+        pxCtx->xPages[ ulIndex ].ucState = PAGE_STATE_FREE;
+    }
+
+    pxCtx->ulNumPages = ulNumPages;
+    pxCtx->ulPageSize = ulPageSize;
+    pxCtx->ulImageSize = ulImageSize;
+    pxCtx->xSubmit = xSubmit;
+    pxCtx->xWait = xWait;
+    pxCtx->pvContext = pvContext;
+}
+
+
+int32_t OTA_WriteBehind_Write( OTA_WriteBehind_t * pxCtx,
+                               uint32_t ulOffset,
+                               const uint8_t * pucData,
+                               uint32_t ulSize )
+{
+    OTA_WriteBehindPage_t * pxPage;
+    uint32_t ulDone = 0U;
+    uint32_t ulPageOffset, ulStart, ulLength, ulComplete, ulIndex;
+
+    while( ( ulDone < ulSize ) && ( pxCtx->lError == 0 ) )
+    {
+        ulPageOffset = ( ulOffset + ulDone ) - ( ( ulOffset + ulDone ) % pxCtx->ulPageSize );
+        ulStart = ( ulOffset + ulDone ) - ulPageOffset;
+        ulLength = pxCtx->ulPageSize - ulStart;
+
+        if( ulLength > ( ulSize - ulDone ) )
+        {
+            ulLength = ulSize - ulDone;
+        }
+
+        pxPage = NULL;
+
+        for( ulIndex = 0U; ulIndex < pxCtx->ulNumPages; ulIndex++ )
+        {
+            if( ( pxCtx->xPages[ ulIndex ].ucState == PAGE_STATE_WRITING ) && ( pxCtx->xPages[ ulIndex ].ulOffset == ulPageOffset ) )
+            {
+                pxPage = &pxCtx->xPages[ ulIndex ];
+            }
+        }
+
+        /* A page written in too many separate parts is submitted as it is and started again. */
+        if( ( pxPage != NULL ) && ( prvAddExtent( pxPage, ulStart, ulStart + ulLength ) == 0U ) )
+        {
+            prvSubmitPage( pxCtx, pxPage );
+            pxPage = NULL;
+        }
+
+        if( pxPage == NULL )
+        {
+            pxPage = prvStartPage( pxCtx, ulPageOffset );
+
+            if( pxPage != NULL )
+            {
+                ( void ) prvAddExtent( pxPage, ulStart, ulStart + ulLength );
+            }
+        }
+
+        if( pxPage != NULL )
+        {
+            memcpy( &pxPage->pucData[ ulStart ], &pucData[ ulDone ], ulLength );
+            ulDone += ulLength;
+
+            /* Submit the page as soon as all of it, or all of it up to the end of the file, is written. */
+            ulComplete = pxCtx->ulPageSize;
+
+            if( ( pxCtx->ulImageSize > ulPageOffset ) && ( ( pxCtx->ulImageSize - ulPageOffset ) < ulComplete ) )
+            {
+                ulComplete = pxCtx->ulImageSize - ulPageOffset;
+            }
+
+            if( ( pxPage->ulExtents == 1U ) && ( pxPage->ulExtentStart[ 0 ] == 0U ) && ( pxPage->ulExtentEnd[ 0 ] >= ulComplete ) )
+            {
+                prvSubmitPage( pxCtx, pxPage );
+            }
+        }
+    }
+
+    return ( pxCtx->lError == 0 ) ? ( int32_t ) ulSize : pxCtx->lError;
+}
+
+
+int32_t OTA_WriteBehind_Flush( OTA_WriteBehind_t * pxCtx )
+{
+    OTA_WriteBehindPage_t * pxOldest;
+    uint32_t ulIndex;
+
+    /* Submit the pages in the order they were started. */
+    do
+    {
+        pxOldest = NULL;
+
+        for( ulIndex = 0U; ulIndex < pxCtx->ulNumPages; ulIndex++ )
+        {
+            if( ( pxCtx->xPages[ ulIndex ].ucState == PAGE_STATE_WRITING ) &&
+                ( ( pxOldest == NULL ) || ( ( int32_t ) ( pxCtx->xPages[ ulIndex ].ulSequence - pxOldest->ulSequence ) < 0 ) ) )
+            {
+                pxOldest = &pxCtx->xPages[ ulIndex ];
+            }
+        }
+
+        if( pxOldest != NULL )
+        {
+            prvSubmitPage( pxCtx, pxOldest );
+        }
+    } while( pxOldest != NULL );
+
+    while( pxCtx->ulSubmitted > 0U )
+    {
+        prvWaitForPage( pxCtx );
+    }
+
+    return pxCtx->lError;
+}
+
+
+void OTA_WriteBehind_Discard( OTA_WriteBehind_t * pxCtx )
+{
+    uint32_t ulIndex;
+
+    while( pxCtx->ulSubmitted > 0U )
+    {
+        prvWaitForPage( pxCtx );
+    }
+
+    for( ulIndex = 0U; ulIndex < pxCtx->ulNumPages; ulIndex++ )
+    {
+        pxCtx->xPages[ ulIndex ].ulOffset = OTA_WRITE_BEHIND_NO_PAGE;
+        pxCtx->xPages[ ulIndex ].ucState = PAGE_STATE_FREE;
+    }
+}
+
+
+int32_t OTA_WriteBehind_Program( OTA_WriteBehindPage_t * pxPage,
+                                 OTA_WriteBehindOutput_t xOutput,
+                                 void * pvContext )
+{
+    uint32_t ulIndex;
+    uint32_t ulLength;
+    int32_t lResult = 0;
+
+    for( ulIndex = 0U; ( ulIndex < pxPage->ulExtents ) && ( lResult == 0 ); ulIndex++ )
+    {
+        ulLength = pxPage->ulExtentEnd[ ulIndex ] - pxPage->ulExtentStart[ ulIndex ];
+
+        if( xOutput( pvContext,
+                     pxPage->ulOffset + pxPage->ulExtentStart[ ulIndex ],
+                     &pxPage->pucData[ pxPage->ulExtentStart[ ulIndex ] ],
+                     ulLength ) != ( int32_t ) ulLength )
+        {
+            lResult = -1;
+        }
+    }
+
+    pxPage->lResult = lResult;
+
+    return lResult;
+}
@@ -0,0 +1,818 @@
+/*
+ * Amazon FreeRTOS OTA PAL for POSIX V1.0.0
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/* OTA PAL implementation for POSIX hosts such as Linux.
+ *
+ * The receive file is a regular file at the path given in the job document. It is written with
+ * pwrite(), which doesn't move a shared file position, so blocks may be written by the OTA
+ * write-behind task while the agent reads the base image or the file itself. The running image,
+ * the image state and the checkpoint are files as well, in the current working directory or next
+ * to the receive file. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "FreeRTOS.h"
+#include "aws_crypto.h"
+#include "aws_ota_pal.h"
+#include "aws_ota_agent_internal.h"
+
+/* Specify the OTA signature algorithm we support on this platform. */
+const char cOTA_JSON_FileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-sha256-ecdsa";
+
+static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C );
+static uint8_t * prvPAL_ReadAndAssumeCertificate( const uint8_t * const pucCertName,
+                                                  uint32_t * const ulSignerCertSize );
+static char * prvPAL_GetCheckpointPath( const OTA_FileContext_t * const C,
+                                        const char * pcSuffix );
+static OTA_Err_t prvPAL_OpenFile( OTA_FileContext_t * const C,
+                                  int lFlags );
+static int32_t prvPAL_CloseFileHandle( OTA_FileContext_t * const C );
+
+/*-----------------------------------------------------------*/
+
+/* The receive file descriptor is kept in lFileHandle. The agent tests pucFile, which shares
+ * its storage, for an open file, so descriptor 0 is never used for the receive file. */
+
+static inline BaseType_t prvContextValidate( OTA_FileContext_t * C )
+{
+    return( ( C != NULL ) &&
+            ( C->pucFile != NULL ) );
+}
+
+/* Used to set the high bit of POSIX error codes for a negative return value. */
+#define OTA_PAL_INT16_NEGATIVE_MASK    ( 1 << 15 )
+
+/* Size of buffer used in file operations on this platform. */
+#define OTA_PAL_POSIX_BUF_SIZE         ( ( size_t ) 4096UL )
+
+/* The download checkpoint is stored next to the receive file with this suffix. It is written
+ * to a file with the second suffix first and renamed, so a checkpoint is never partly written. */
+#define OTA_PAL_CHECKPOINT_SUFFIX      ".resume"
+#define OTA_PAL_CHECKPOINT_TMP_SUFFIX  ".resume.tmp"
+
+/* Delta files are applied to the image in this file, which stands in for the running image. */
+#define OTA_PAL_BASE_IMAGE_FILE        "BaseImage.bin"
+
+/* The state of the OTA image is stored in this file. */
+#define OTA_PAL_IMAGE_STATE_FILE       "PlatformImageState.txt"
+
+/* Open the receive file with the given flags and keep its descriptor in the context. */
+
+static OTA_Err_t prvPAL_OpenFile( OTA_FileContext_t * const C,
+                                  int lFlags )
+{
+    OTA_Err_t eResult = kOTA_Err_None;
+    int lFd;
+    int lOldFd = -1;
+
+    lFd = open( ( const char * ) C->pucFilePath, lFlags, 0644 );
+
+    /* Keep descriptor 0 free to tell an open file from a closed one. */
+    if( lFd == 0 )
+    {
+        lOldFd = lFd;
+        lFd = fcntl( lOldFd, F_DUPFD, 1 );
+        ( void ) close( lOldFd );
+    }
+
+    if( lFd < 0 )
+    {
+        eResult = ( kOTA_Err_RxFileCreateFailed | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                                   * Errno is being used in accordance with host API documentation.
+                                                                                   * Bitmasking is being used to preserve host API error with library status code. */
+    }
+    else
+    {
+        C->pucFile = NULL; /* Clear all of the handle storage before the descriptor is stored. */
+        C->lFileHandle = ( int32_t ) lFd;
+    }
+
+    return eResult;
+}
+
+/* Close the receive file and clear its descriptor. Returns the result of close(). */
+
+static int32_t prvPAL_CloseFileHandle( OTA_FileContext_t * const C )
+{
+    int32_t lResult = ( int32_t ) close( ( int ) C->lFileHandle );
+
+    C->pucFile = NULL;
+
+    return lResult;
+}
+
+/* Attempt to create a new receive file for the file chunks as they come in. */
+
+OTA_Err_t prvPAL_CreateFileForRx( OTA_FileContext_t * const C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_CreateFileForRx" );
+
+    OTA_Err_t eResult = kOTA_Err_Uninitialized; /* For MISRA mandatory. */
+
+    if( ( C != NULL ) && ( C->pucFilePath != NULL ) )
+    {
+        eResult = prvPAL_OpenFile( C, O_RDWR | O_CREAT | O_TRUNC );
+
+        if( eResult == kOTA_Err_None )
+        {
+            OTA_LOG_L1( "[%s] Receive file created.\r\n", OTA_METHOD_NAME );
+
+            /* Let the agent hash the file as it is received so it is not read back at close. */
+            if( pdFALSE == CRYPTO_SignatureVerificationStart( &C->pvSigVerifyContext, cryptoASYMMETRIC_ALGORITHM_ECDSA, cryptoHASH_ALGORITHM_SHA256 ) )
+            {
+                C->pvSigVerifyContext = NULL;
+                OTA_LOG_L1( "[%s] File will be hashed at close.\r\n", OTA_METHOD_NAME );
+            }
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] ERROR - Failed to create %s.\r\n", OTA_METHOD_NAME, ( const char * ) C->pucFilePath );
+        }
+    }
+    else
+    {
+        eResult = kOTA_Err_RxFileCreateFailed;
+        OTA_LOG_L1( "[%s] ERROR - Invalid context provided.\r\n", OTA_METHOD_NAME );
+    }
+
+    return eResult;
+}
+
+
+/* Abort receiving the specified OTA update by closing the file. */
+
+OTA_Err_t prvPAL_Abort( OTA_FileContext_t * const C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_Abort" );
+
+    OTA_Err_t eResult = kOTA_Err_Uninitialized;
+
+    if( NULL != C )
+    {
+        /* Release the signature verification context started for the file, if any. */
+        if( NULL != C->pvSigVerifyContext )
+        {
+            ( void ) CRYPTO_SignatureVerificationFinal( C->pvSigVerifyContext, NULL, 0, NULL, 0 );
+            C->pvSigVerifyContext = NULL;
+        }
+
+        /* Close the OTA update file if it's open. The partial file is kept so that a checkpoint
+         * stored for it can still be resumed. */
+        if( NULL != C->pucFile )
+        {
+            if( 0 == prvPAL_CloseFileHandle( C ) )
+            {
+                OTA_LOG_L1( "[%s] OK\r\n", OTA_METHOD_NAME );
+                eResult = kOTA_Err_None;
+            }
+            else
+            {
+                OTA_LOG_L1( "[%s] ERROR - Closing file failed.\r\n", OTA_METHOD_NAME );
+                eResult = ( kOTA_Err_FileAbort | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                                  * Errno is being used in accordance with host API documentation.
+                                                                                  * Bitmasking is being used to preserve host API error with library status code. */
+            }
+        }
+        else
+        {
+            /* Nothing to do. No open file associated with this context. */
+            eResult = kOTA_Err_None;
+        }
+    }
+    else /* Context was not valid. */
+    {
+        OTA_LOG_L1( "[%s] ERROR - Invalid context.\r\n", OTA_METHOD_NAME );
+        eResult = kOTA_Err_FileAbort;
+    }
+
+    return eResult;
+}
+
+/* Write a block of data to the specified file. pwrite() may write less than asked for, so it is
+ * called until the whole block is written. */
+
+int16_t prvPAL_WriteBlock( OTA_FileContext_t * const C,
+                           uint32_t ulOffset,
+                           uint8_t * const pacData,
+                           uint32_t ulBlockSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_WriteBlock" );
+
+    int32_t lResult = 0;
+    ssize_t xWritten;
+    uint32_t ulDone = 0U;
+
+    if( prvContextValidate( C ) == pdTRUE )
+    {
+        while( ( lResult >= 0 ) && ( ulDone < ulBlockSize ) )
+        {
+            xWritten = pwrite( ( int ) C->lFileHandle, &pacData[ ulDone ], ( size_t ) ( ulBlockSize - ulDone ), ( off_t ) ( ulOffset + ulDone ) );
+
+            if( xWritten > 0 )
+            {
+                ulDone += ( uint32_t ) xWritten;
+            }
+            else if( ( xWritten < 0 ) && ( errno == EINTR ) )
+            {
+                /* Interrupted before anything was written, so try again. */
+            }
+            else
+            {
+                OTA_LOG_L1( "[%s] ERROR - pwrite failed\r\n", OTA_METHOD_NAME );
+                /* Mask to return a negative value. */
+                lResult = OTA_PAL_INT16_NEGATIVE_MASK | errno; /*lint !e40 !e9027
+                                                                * Errno is being used in accordance with host API documentation.
+                                                                * Bitmasking is being used to preserve host API error with library status code. */
+            }
+        }
+
+        if( lResult >= 0 )
+        {
+            lResult = ( int32_t ) ulDone;
+        }
+    }
+    else /* Invalid context or file descriptor provided. */
+    {
+        OTA_LOG_L1( "[%s] ERROR - Invalid context.\r\n", OTA_METHOD_NAME );
+        lResult = -1;
+    }
+
+    return ( int16_t ) lResult;
+}
+
+/* Close the specified file. This shall authenticate the file if it is marked as secure. The file
+ * is synced to storage first, so that an image that passes is on the disk when it is activated. */
+
+OTA_Err_t prvPAL_CloseFile( OTA_FileContext_t * const C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_CloseFile" );
+
+    OTA_Err_t eResult = kOTA_Err_None;
+
+    if( prvContextValidate( C ) == pdTRUE )
+    {
+        if( C->pxSignature != NULL )
+        {
+            /* Verify the file signature, close the file and return the signature verification result. */
+            eResult = prvPAL_CheckFileSignature( C );
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] ERROR - NULL OTA Signature structure.\r\n", OTA_METHOD_NAME );
+            eResult = kOTA_Err_SignatureCheckFailed;
+        }
+
+        /* Sync and close the file. */
+        if( ( fsync( ( int ) C->lFileHandle ) != 0 ) && ( eResult == kOTA_Err_None ) )
+        {
+            OTA_LOG_L1( "[%s] ERROR - Failed to sync OTA update file.\r\n", OTA_METHOD_NAME );
+            eResult = ( kOTA_Err_FileClose | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                              * Errno is being used in accordance with host API documentation.
+                                                                              * Bitmasking is being used to preserve host API error with library status code. */
+        }
+
+        if( prvPAL_CloseFileHandle( C ) != 0 )
+        {
+            OTA_LOG_L1( "[%s] ERROR - Failed to close OTA update file.\r\n", OTA_METHOD_NAME );
+            eResult = ( kOTA_Err_FileClose | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                              * Errno is being used in accordance with host API documentation.
+                                                                              * Bitmasking is being used to preserve host API error with library status code. */
+        }
+
+        if( eResult == kOTA_Err_None )
+        {
+            OTA_LOG_L1( "[%s] %s signature verification passed.\r\n", OTA_METHOD_NAME, cOTA_JSON_FileSignatureKey );
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] ERROR - Failed to pass %s signature verification: %d.\r\n", OTA_METHOD_NAME,
+                        cOTA_JSON_FileSignatureKey, eResult );
+
+            /* If we fail to verify the file signature that means the image is not valid. We need to set the image state to aborted. */
+            ( void ) prvPAL_SetPlatformImageState( eOTA_ImageState_Aborted );
+        }
+    }
+    else /* Invalid OTA Context. */
+    {
+        OTA_LOG_L1( "[%s] ERROR - Invalid context.\r\n", OTA_METHOD_NAME );
+        eResult = kOTA_Err_FileClose;
+    }
+
+    return eResult;
+}
+
+
+/* Store the download checkpoint in a file next to the receive file, or erase it. */
+
+OTA_Err_t prvPAL_SaveCheckpoint( OTA_FileContext_t * const C,
+                                 const uint8_t * pucCheckpoint,
+                                 uint32_t ulSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_SaveCheckpoint" );
+
+    OTA_Err_t eResult = kOTA_Err_CheckpointFailed;
+    char * pcPath = prvPAL_GetCheckpointPath( C, OTA_PAL_CHECKPOINT_SUFFIX );
+    char * pcTmpPath = prvPAL_GetCheckpointPath( C, OTA_PAL_CHECKPOINT_TMP_SUFFIX );
+    int lFd;
+
+    if( ( pcPath != NULL ) && ( pcTmpPath != NULL ) )
+    {
+        if( pucCheckpoint == NULL )
+        {
+            /* Erase the checkpoint. It's fine if there is none. */
+            ( void ) unlink( pcPath );
+            eResult = kOTA_Err_None;
+        }
+        /* The received blocks must be on the disk before the checkpoint marks them as received. */
+        else if( ( C->pucFile != NULL ) && ( fdatasync( ( int ) C->lFileHandle ) != 0 ) )
+        {
+            OTA_LOG_L1( "[%s] ERROR - Failed to sync the receive file.\r\n", OTA_METHOD_NAME );
+            eResult = ( kOTA_Err_CheckpointFailed | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                                   * Errno is being used in accordance with host API documentation.
+                                                                                   * Bitmasking is being used to preserve host API error with library status code. */
+        }
+        else
+        {
+            lFd = open( pcTmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+            if( lFd >= 0 )
+            {
+                if( ( write( lFd, pucCheckpoint, ( size_t ) ulSize ) == ( ssize_t ) ulSize ) &&
+                    ( fdatasync( lFd ) == 0 ) )
+                {
+                    eResult = kOTA_Err_None;
+                }
+
+                if( ( close( lFd ) != 0 ) || ( ( eResult == kOTA_Err_None ) && ( rename( pcTmpPath, pcPath ) != 0 ) ) )
+                {
+                    eResult = kOTA_Err_CheckpointFailed;
+                }
+            }
+
+            if( eResult != kOTA_Err_None )
+            {
+                OTA_LOG_L1( "[%s] ERROR - Failed to write checkpoint file %s.\r\n", OTA_METHOD_NAME, pcPath );
+                eResult = ( kOTA_Err_CheckpointFailed | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                                       * Errno is being used in accordance with host API documentation.
+                                                                                       * Bitmasking is being used to preserve host API error with library status code. */
+                ( void ) unlink( pcTmpPath );
+            }
+        }
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] ERROR - Invalid context provided.\r\n", OTA_METHOD_NAME );
+    }
+
+    vPortFree( pcPath );
+    vPortFree( pcTmpPath );
+
+    return eResult;
+}
+
+
+/* Read the download checkpoint and open the receive file for writing without truncating it. */
+
+OTA_Err_t prvPAL_ResumeFileForRx( OTA_FileContext_t * const C,
+                                  uint8_t * pucCheckpoint,
+                                  uint32_t ulBufferSize,
+                                  uint32_t * pulSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_ResumeFileForRx" );
+
+    OTA_Err_t eResult = kOTA_Err_NoCheckpoint;
+    char * pcPath = prvPAL_GetCheckpointPath( C, OTA_PAL_CHECKPOINT_SUFFIX );
+    FILE * pxCheckpointFile;
+    size_t xBytesRead;
+
+    if( pcPath != NULL )
+    {
+        pxCheckpointFile = fopen( pcPath, "rb" ); /*lint !e586
+                                                   * C standard library call is being used for portability. */
+
+        if( pxCheckpointFile != NULL )
+        {
+            xBytesRead = fread( pucCheckpoint, 1, ulBufferSize, pxCheckpointFile ); /*lint !e586
+                                                                                     * C standard library call is being used for portability. */
+
+            /* A checkpoint that doesn't fit in the buffer can't be used. */
+            if( ( xBytesRead > 0U ) && ( xBytesRead < ( size_t ) ulBufferSize ) && ( feof( pxCheckpointFile ) != 0 ) &&
+                ( prvPAL_OpenFile( C, O_RDWR ) == kOTA_Err_None ) )
+            {
+                *pulSize = ( uint32_t ) xBytesRead;
+                eResult = kOTA_Err_None;
+                OTA_LOG_L1( "[%s] Receive file opened to resume.\r\n", OTA_METHOD_NAME );
+            }
+
+            ( void ) fclose( pxCheckpointFile ); /*lint !e586
+                                                  * C standard library call is being used for portability. */
+        }
+
+        vPortFree( pcPath );
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] ERROR - Invalid context provided.\r\n", OTA_METHOD_NAME );
+    }
+
+    return eResult;
+}
+
+
+/* Read part of the running image for a delta file. The running image is simulated by the
+ * OTA_PAL_BASE_IMAGE_FILE file in the current working directory. */
+
+OTA_Err_t prvPAL_ReadBaseImage( OTA_FileContext_t * const C,
+                                uint32_t ulOffset,
+                                uint8_t * pucData,
+                                uint32_t ulSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_ReadBaseImage" );
+
+    OTA_Err_t eResult = kOTA_Err_BaseImageMismatch;
+    int lFd;
+
+    ( void ) C;
+
+    lFd = open( OTA_PAL_BASE_IMAGE_FILE, O_RDONLY );
+
+    if( lFd >= 0 )
+    {
+        if( pread( lFd, pucData, ( size_t ) ulSize, ( off_t ) ulOffset ) == ( ssize_t ) ulSize )
+        {
+            eResult = kOTA_Err_None;
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] ERROR - Unable to read %u bytes at offset %u.\r\n", OTA_METHOD_NAME, ulSize, ulOffset );
+        }
+
+        ( void ) close( lFd );
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] ERROR - Unable to open the base image file.\r\n", OTA_METHOD_NAME );
+    }
+
+    return eResult;
+}
+
+
+/* Build the path name of a checkpoint file of the receive file. The allocated memory becomes
+ * the property of the caller who is responsible for freeing it. */
+
+static char * prvPAL_GetCheckpointPath( const OTA_FileContext_t * const C,
+                                        const char * pcSuffix )
+{
+    char * pcPath = NULL;
+    size_t xLength, xSuffixLength;
+
+    if( ( C != NULL ) && ( C->pucFilePath != NULL ) )
+    {
+        xLength = strlen( ( const char * ) C->pucFilePath );
+        xSuffixLength = strlen( pcSuffix ) + 1U;
+        pcPath = pvPortMalloc( xLength + xSuffixLength ); /*lint !e9079 Allow conversion. */
+
+        if( pcPath != NULL )
+        {
+            memcpy( pcPath, C->pucFilePath, xLength );
+            memcpy( &pcPath[ xLength ], pcSuffix, xSuffixLength );
+        }
+    }
+
+    return pcPath;
+}
+
+
+/* Verify the signature of the specified file. */
+
+static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_CheckFileSignature" );
+
+    OTA_Err_t eResult = kOTA_Err_None;
+    ssize_t xBytesRead;
+    uint32_t ulOffset;
+    uint32_t ulSignerCertSize;
+    uint8_t * pucBuf, * pucSignerCert;
+
+    if( prvContextValidate( C ) == pdTRUE )
+    {
+        /* Verify an ECDSA-SHA256 signature. If the agent hashed the file while receiving it, only the part it
+         * could not hash in order is read back. The context is kept in the OTA context until it is finished
+         * so the agent frees it if verification stops early. */
+        if( C->pvSigVerifyContext == NULL )
+        {
+            C->ulHashedBytes = 0;
+
+            if( pdFALSE == CRYPTO_SignatureVerificationStart( &C->pvSigVerifyContext, cryptoASYMMETRIC_ALGORITHM_ECDSA, cryptoHASH_ALGORITHM_SHA256 ) )
+            {
+                C->pvSigVerifyContext = NULL;
+            }
+        }
+
+        if( C->pvSigVerifyContext == NULL )
+        {
+            eResult = kOTA_Err_SignatureCheckFailed;
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] Started %s signature verification, file: %s, %u bytes already hashed\r\n", OTA_METHOD_NAME,
+                        cOTA_JSON_FileSignatureKey, ( const char * ) C->pucCertFilepath, C->ulHashedBytes );
+            pucSignerCert = prvPAL_ReadAndAssumeCertificate( ( const uint8_t * const ) C->pucCertFilepath, &ulSignerCertSize );
+
+            if( pucSignerCert != NULL )
+            {
+                pucBuf = pvPortMalloc( OTA_PAL_POSIX_BUF_SIZE ); /*lint !e9079 Allow conversion. */
+
+                if( pucBuf != NULL )
+                {
+                    /* Read the file from the first byte that is not hashed yet. */
+                    ulOffset = C->ulHashedBytes;
+
+                    do
+                    {
+                        xBytesRead = pread( ( int ) C->lFileHandle, pucBuf, OTA_PAL_POSIX_BUF_SIZE, ( off_t ) ulOffset );
+
+                        if( xBytesRead > 0 )
+                        {
+                            CRYPTO_SignatureVerificationUpdate( C->pvSigVerifyContext, pucBuf, ( size_t ) xBytesRead );
+                            ulOffset += ( uint32_t ) xBytesRead;
+                        }
+                    } while( ( xBytesRead > 0 ) || ( ( xBytesRead < 0 ) && ( errno == EINTR ) ) );
+
+                    if( ( xBytesRead < 0 ) ||
+                        ( pdFALSE == CRYPTO_SignatureVerificationFinal( C->pvSigVerifyContext,
+                                                                        ( char * ) pucSignerCert,
+                                                                        ( size_t ) ulSignerCertSize,
+                                                                        C->pxSignature->ucData,
+                                                                        C->pxSignature->usSize ) ) ) /*lint !e732 !e9034 Allow comparison in this context. */
+                    {
+                        eResult = kOTA_Err_SignatureCheckFailed;
+                    }
+
+                    /* The context has been freed by CRYPTO_SignatureVerificationFinal(), or is freed by the
+                     * agent if the file could not be read. */
+                    if( xBytesRead >= 0 )
+                    {
+                        C->pvSigVerifyContext = NULL;
+                    }
+
+                    /* Free the temporary file page buffer. */
+                    vPortFree( pucBuf );
+                }
+                else
+                {
+                    OTA_LOG_L1( "[%s] ERROR - Failed to allocate buffer memory.\r\n", OTA_METHOD_NAME );
+                    eResult = kOTA_Err_OutOfMemory;
+                }
+
+                /* Free the signer certificate that we now own after prvReadAndAssumeCertificate(). */
+                vPortFree( pucSignerCert );
+            }
+            else
+            {
+                eResult = kOTA_Err_BadSignerCert;
+            }
+        }
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] ERROR - Invalid OTA file context.\r\n", OTA_METHOD_NAME );
+        /* Invalid OTA context or file descriptor. */
+        eResult = kOTA_Err_NullFilePtr;
+    }
+
+    return eResult;
+}
+
+
+/* Read the specified signer certificate from the filesystem into a local buffer. The allocated
+ * memory becomes the property of the caller who is responsible for freeing it.
+ */
+
+static uint8_t * prvPAL_ReadAndAssumeCertificate( const uint8_t * const pucCertName,
+                                                  uint32_t * const ulSignerCertSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_ReadAndAssumeCertificate" );
+
+    FILE * pxFile;
+    uint8_t * pucSignerCert = NULL;
+    long lSize = -1L;
+
+    pxFile = fopen( ( const char * ) pucCertName, "rb" ); /*lint !e586
+                                                           * C standard library call is being used for portability. */
+
+    if( pxFile != NULL )
+    {
+        if( fseek( pxFile, 0, SEEK_END ) == 0 ) /*lint !e586
+                                                 * C standard library call is being used for portability. */
+        {
+            lSize = ftell( pxFile );            /*lint !e586 Allow call in this context. */
+        }
+
+        if( ( lSize >= 0L ) && ( fseek( pxFile, 0, SEEK_SET ) == 0 ) ) /*lint !e586
+                                                                        * C standard library call is being used for portability. */
+        {
+            /* Allocate memory for the signer certificate plus a terminating zero so we can load and return it to the caller. */
+            pucSignerCert = pvPortMalloc( ( size_t ) lSize + 1U ); /*lint !e9079 Allow conversion. */
+
+            if( pucSignerCert == NULL )
+            {
+                OTA_LOG_L1( "[%s] ERROR - Failed to allocate memory for signer cert contents.\r\n", OTA_METHOD_NAME );
+            }
+            else if( fread( pucSignerCert, 1, ( size_t ) lSize, pxFile ) == ( size_t ) lSize ) /*lint !e586
+                                                                                               * C standard library call is being used for portability. */
+            {
+                /* The crypto code requires the terminating zero to be part of the length so add 1 to the size. */
+                *ulSignerCertSize = ( uint32_t ) lSize + 1U;
+                pucSignerCert[ lSize ] = 0;
+            }
+            else
+            {
+                /* There was a problem reading the certificate file so free the memory and abort. */
+                vPortFree( pucSignerCert );
+                pucSignerCert = NULL;
+            }
+        }
+
+        ( void ) fclose( pxFile ); /*lint !e586
+                                    * C standard library call is being used for portability. */
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] ERROR - Failed to open signer certificate file.\r\n", OTA_METHOD_NAME );
+    }
+
+    return pucSignerCert;
+}
+
+/*-----------------------------------------------------------*/
+
+OTA_Err_t prvPAL_ResetDevice( void )
+{
+    /* Return no error. The POSIX implementation does not reset the device. */
+    return kOTA_Err_None;
+}
+
+/*-----------------------------------------------------------*/
+
+OTA_Err_t prvPAL_ActivateNewImage( void )
+{
+    /* Return no error. The POSIX implementation simply does nothing on activate.
+     * To run the new firmware image, run the downloaded file. */
+    return kOTA_Err_None;
+}
+
+
+/*
+ * Set the final state of the last transferred (final) OTA file (or bundle).
+ * The state of the OTA image is stored in OTA_PAL_IMAGE_STATE_FILE.
+ */
+
+OTA_Err_t prvPAL_SetPlatformImageState( OTA_ImageState_t eState )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_SetPlatformImageState" );
+
+    OTA_Err_t eResult = kOTA_Err_None;
+    FILE * pstPlatformImageState;
+
+    if( ( eState != eOTA_ImageState_Unknown ) && ( eState <= eOTA_LastImageState ) )
+    {
+        pstPlatformImageState = fopen( OTA_PAL_IMAGE_STATE_FILE, "w+b" ); /*lint !e586
+                                                                           * C standard library call is being used for portability. */
+
+        if( pstPlatformImageState != NULL )
+        {
+            /* Write the image state to the image state file. */
+            if( 1 != fwrite( &eState, sizeof( OTA_ImageState_t ), 1, pstPlatformImageState ) ) /*lint !e586 !e9029
+                                                                                                * C standard library call is being used for portability. */
+            {
+                OTA_LOG_L1( "[%s] ERROR - Unable to write to image state file.\r\n", OTA_METHOD_NAME );
+                eResult = ( kOTA_Err_BadImageState | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                                      * Errno is being used in accordance with host API documentation.
+                                                                                      * Bitmasking is being used to preserve host API error with library status code. */
+            }
+
+            /* Close the image state file. */
+            if( 0 != fclose( pstPlatformImageState ) ) /*lint !e586 Allow call in this context. */
+            {
+                OTA_LOG_L1( "[%s] ERROR - Unable to close image state file.\r\n", OTA_METHOD_NAME );
+                eResult = ( kOTA_Err_BadImageState | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                                      * Errno is being used in accordance with host API documentation.
+                                                                                      * Bitmasking is being used to preserve host API error with library status code. */
+            }
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] ERROR - Unable to open image state file.\r\n", OTA_METHOD_NAME );
+            eResult = ( kOTA_Err_BadImageState | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                                  * Errno is being used in accordance with host API documentation.
+                                                                                  * Bitmasking is being used to preserve host API error with library status code. */
+        }
+    }
+    else /* Image state invalid. */
+    {
+        OTA_LOG_L1( "[%s] ERROR - Invalid image state provided.\r\n", OTA_METHOD_NAME );
+        eResult = kOTA_Err_BadImageState;
+    }
+
+    return eResult;
+}
+
+/* Get the state of the currently running image.
+ *
+ * This is simulated by looking for and reading the state from the
+ * OTA_PAL_IMAGE_STATE_FILE file in the current working directory.
+ *
+ * We read this at OTA_Init time so we can tell if the MCU image is in self
+ * test mode. If it is, we expect a successful connection to the OTA services
+ * within a reasonable amount of time. If we don't satisfy that requirement,
+ * we assume there is something wrong with the firmware and reset the device,
+ * causing it to rollback to the previous code. On POSIX hosts, this is not
+ * fully simulated as there is no device to reset.
+ */
+OTA_PAL_ImageState_t prvPAL_GetPlatformImageState( void )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_GetPlatformImageState" );
+
+    FILE * pstPlatformImageState;
+    OTA_ImageState_t eSavedAgentState = eOTA_ImageState_Unknown;
+    OTA_PAL_ImageState_t ePalState = eOTA_PAL_ImageState_Unknown;
+
+    pstPlatformImageState = fopen( OTA_PAL_IMAGE_STATE_FILE, "rb" ); /*lint !e586
+                                                                      * C standard library call is being used for portability. */
+
+    if( pstPlatformImageState != NULL )
+    {
+        if( 1 != fread( &eSavedAgentState, sizeof( OTA_ImageState_t ), 1, pstPlatformImageState ) ) /*lint !e586 !e9029
+                                                                                                     * C standard library call is being used for portability. */
+        {
+            /* If an error occured reading the file, mark the state as invalid. */
+            OTA_LOG_L1( "[%s] ERROR - Unable to read image state file.\r\n", OTA_METHOD_NAME );
+            ePalState = eOTA_PAL_ImageState_Invalid;
+        }
+        else
+        {
+            switch( eSavedAgentState )
+            {
+                case eOTA_ImageState_Testing:
+                    ePalState = eOTA_PAL_ImageState_PendingCommit;
+                    break;
+
+                case eOTA_ImageState_Accepted:
+                    ePalState = eOTA_PAL_ImageState_Valid;
+                    break;
+
+                case eOTA_ImageState_Rejected:
+                case eOTA_ImageState_Aborted:
+                default:
+                    ePalState = eOTA_PAL_ImageState_Invalid;
+                    break;
+            }
+        }
+
+        ( void ) fclose( pstPlatformImageState ); /*lint !e586
+                                                   * C standard library call is being used for portability. */
+    }
+    else
+    {
+        /* If no image state file exists, assume a factory image. */
+        ePalState = eOTA_PAL_ImageState_Valid; /*lint !e64 Allow assignment. */
+    }
+
+    return ePalState;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Provide access to private members for testing. */
+#ifdef AMAZON_FREERTOS_ENABLE_UNIT_TESTS
+    #include "aws_ota_pal_test_access_define.h"
+#endif
@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "FreeRTOS.h"
 #include "aws_crypto.h"
 #include "aws_ota_pal.h"
@@ -38,6 +39,7 @@ const char cOTA_JSON_FileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-
 static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C );
 static uint8_t * prvPAL_ReadAndAssumeCertificate( const uint8_t * const pucCertName,
                                                   uint32_t * const ulSignerCertSize );
+static char * prvPAL_GetCheckpointPath( const OTA_FileContext_t * const C );
 
 /*-----------------------------------------------------------*/
 
@@ -53,6 +55,12 @@ static inline BaseType_t prvContextValidate( OTA_FileContext_t * C )
 /* Size of buffer used in file operations on this platform (Windows). */
 #define OTA_PAL_WIN_BUF_SIZE ( ( size_t ) 4096UL )
 
+/* The download checkpoint is stored next to the receive file with this suffix. */
+#define OTA_PAL_CHECKPOINT_SUFFIX    ".resume"
+
+/* Delta files are applied to the image in this file, which stands in for the running image. */
+#define OTA_PAL_BASE_IMAGE_FILE      "BaseImage.bin"
+
 /* Attempt to create a new receive file for the file chunks as they come in. */
 
 OTA_Err_t prvPAL_CreateFileForRx( OTA_FileContext_t * const C )
@@ -72,6 +80,13 @@ OTA_Err_t prvPAL_CreateFileForRx( OTA_FileContext_t * const C )
             {
                 eResult = kOTA_Err_None;
                 OTA_LOG_L1( "[%s] Receive file created.\r\n", OTA_METHOD_NAME );
+
+                /* Let the agent hash the file as it is received so it is not read back at close. */
+                if( pdFALSE == CRYPTO_SignatureVerificationStart( &C->pvSigVerifyContext, cryptoASYMMETRIC_ALGORITHM_ECDSA, cryptoHASH_ALGORITHM_SHA256 ) )
+                {
+                    C->pvSigVerifyContext = NULL;
+                    OTA_LOG_L1( "[%s] File will be hashed at close.\r\n", OTA_METHOD_NAME );
+                }
             }
             else
             {
@@ -110,6 +125,13 @@ OTA_Err_t prvPAL_Abort( OTA_FileContext_t * const C )
 
     if( NULL != C )
     {
+        /* Release the signature verification context started for the file, if any. */
+        if( NULL != C->pvSigVerifyContext )
+        {
+            ( void ) CRYPTO_SignatureVerificationFinal( C->pvSigVerifyContext, NULL, 0, NULL, 0 );
+            C->pvSigVerifyContext = NULL;
+        }
+
         /* Close the OTA update file if it's open. */
         if( NULL != C->pxFile )
         {
@@ -252,6 +274,198 @@ OTA_Err_t prvPAL_CloseFile( OTA_FileContext_t * const C )
 }
 
 
+/* Store the download checkpoint in a file next to the receive file, or erase it. */
+
+OTA_Err_t prvPAL_SaveCheckpoint( OTA_FileContext_t * const C,
+                                 const uint8_t * pucCheckpoint,
+                                 uint32_t ulSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_SaveCheckpoint" );
+
+    OTA_Err_t eResult = kOTA_Err_CheckpointFailed;
+    char * pcPath = prvPAL_GetCheckpointPath( C );
+    FILE * pxCheckpointFile;
+
+    if( pcPath != NULL )
+    {
+        if( pucCheckpoint == NULL )
+        {
+            /* Erase the checkpoint. It's fine if there is none. */
+            ( void ) remove( pcPath ); /*lint !e586
+                                        * C standard library call is being used for portability. */
+            eResult = kOTA_Err_None;
+        }
+        /* The received blocks must be in the file before the checkpoint marks them as received. */
+        else if( ( C->pxFile != NULL ) && ( fflush( C->pxFile ) != 0 ) ) /*lint !e586
+                                                                          * C standard library call is being used for portability. */
+        {
+            OTA_LOG_L1( "[%s] ERROR - Failed to flush the receive file.\r\n", OTA_METHOD_NAME );
+            eResult = ( kOTA_Err_CheckpointFailed | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                                   * Errno is being used in accordance with host API documentation.
+                                                                                   * Bitmasking is being used to preserve host API error with library status code. */
+        }
+        else
+        {
+            pxCheckpointFile = fopen( pcPath, "wb" ); /*lint !e586
+                                                       * C standard library call is being used for portability. */
+
+            if( pxCheckpointFile != NULL )
+            {
+                if( fwrite( pucCheckpoint, 1, ulSize, pxCheckpointFile ) == ( size_t ) ulSize ) /*lint !e586
+                                                                                                 * C standard library call is being used for portability. */
+                {
+                    eResult = kOTA_Err_None;
+                }
+
+                if( fclose( pxCheckpointFile ) != 0 ) /*lint !e586
+                                                       * C standard library call is being used for portability. */
+                {
+                    eResult = kOTA_Err_CheckpointFailed;
+                }
+            }
+
+            if( eResult != kOTA_Err_None )
+            {
+                OTA_LOG_L1( "[%s] ERROR - Failed to write checkpoint file %s.\r\n", OTA_METHOD_NAME, pcPath );
+                eResult = ( kOTA_Err_CheckpointFailed | ( errno & kOTA_PAL_ErrMask ) ); /*lint !e40 !e737 !e9027 !e9029
+                                                                                       * Errno is being used in accordance with host API documentation.
+                                                                                       * Bitmasking is being used to preserve host API error with library status code. */
+            }
+        }
+
+        vPortFree( pcPath );
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] ERROR - Invalid context provided.\r\n", OTA_METHOD_NAME );
+    }
+
+    return eResult;
+}
+
+
+/* Read the download checkpoint and open the receive file for writing without truncating it. */
+
+OTA_Err_t prvPAL_ResumeFileForRx( OTA_FileContext_t * const C,
+                                  uint8_t * pucCheckpoint,
+                                  uint32_t ulBufferSize,
+                                  uint32_t * pulSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_ResumeFileForRx" );
+
+    OTA_Err_t eResult = kOTA_Err_NoCheckpoint;
+    char * pcPath = prvPAL_GetCheckpointPath( C );
+    FILE * pxCheckpointFile;
+    size_t xBytesRead;
+
+    if( pcPath != NULL )
+    {
+        pxCheckpointFile = fopen( pcPath, "rb" ); /*lint !e586
+                                                   * C standard library call is being used for portability. */
+
+        if( pxCheckpointFile != NULL )
+        {
+            xBytesRead = fread( pucCheckpoint, 1, ulBufferSize, pxCheckpointFile ); /*lint !e586
+                                                                                     * C standard library call is being used for portability. */
+
+            /* A checkpoint that doesn't fit in the buffer can't be used. */
+            if( ( xBytesRead > 0U ) && ( xBytesRead < ( size_t ) ulBufferSize ) && ( feof( pxCheckpointFile ) != 0 ) )
+            {
+                C->pxFile = fopen( ( const char * ) C->pucFilePath, "r+b" ); /*lint !e586
+                                                                              * C standard library call is being used for portability. */
+
+                if( C->pxFile != NULL )
+                {
+                    *pulSize = ( uint32_t ) xBytesRead;
+                    eResult = kOTA_Err_None;
+                    OTA_LOG_L1( "[%s] Receive file opened to resume.\r\n", OTA_METHOD_NAME );
+                }
+            }
+
+            ( void ) fclose( pxCheckpointFile ); /*lint !e586
+                                                  * C standard library call is being used for portability. */
+        }
+
+        vPortFree( pcPath );
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] ERROR - Invalid context provided.\r\n", OTA_METHOD_NAME );
+    }
+
+    return eResult; /*lint !e480 !e481 Exiting function without calling fclose.
+                     * Context file handle state is managed by this API. */
+}
+
+
+/* Read part of the running image for a delta file. On Windows, the running image is simulated
+ * by the OTA_PAL_BASE_IMAGE_FILE file in the current working directory. */
+
+OTA_Err_t prvPAL_ReadBaseImage( OTA_FileContext_t * const C,
+                                uint32_t ulOffset,
+                                uint8_t * pucData,
+                                uint32_t ulSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_ReadBaseImage" );
+
+    OTA_Err_t eResult = kOTA_Err_BaseImageMismatch;
+    FILE * pxBaseImageFile;
+
+    ( void ) C;
+
+    pxBaseImageFile = fopen( OTA_PAL_BASE_IMAGE_FILE, "rb" ); /*lint !e586
+                                                               * C standard library call is being used for portability. */
+
+    if( pxBaseImageFile != NULL )
+    {
+        if( ( fseek( pxBaseImageFile, ( long ) ulOffset, SEEK_SET ) == 0 ) &&                 /*lint !e586
+                                                                                               * C standard library call is being used for portability. */
+            ( fread( pucData, 1, ( size_t ) ulSize, pxBaseImageFile ) == ( size_t ) ulSize ) ) /*lint !e586
+                                                                                               * C standard library call is being used for portability. */
+        {
+            eResult = kOTA_Err_None;
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] ERROR - Unable to read %u bytes at offset %u.\r\n", OTA_METHOD_NAME, ulSize, ulOffset );
+        }
+
+        ( void ) fclose( pxBaseImageFile ); /*lint !e586
+                                             * C standard library call is being used for portability. */
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] ERROR - Unable to open the base image file.\r\n", OTA_METHOD_NAME );
+    }
+
+    return eResult;
+}
+
+
+/* Build the path name of the checkpoint file of the receive file. The allocated memory becomes
+ * the property of the caller who is responsible for freeing it. */
+
+static char * prvPAL_GetCheckpointPath( const OTA_FileContext_t * const C )
+{
+    char * pcPath = NULL;
+    size_t xLength;
+
+    if( ( C != NULL ) && ( C->pucFilePath != NULL ) )
+    {
+        xLength = strlen( ( const char * ) C->pucFilePath );
+        pcPath = pvPortMalloc( xLength + sizeof( OTA_PAL_CHECKPOINT_SUFFIX ) ); /*lint !e9079 Allow conversion. */
+
+        if( pcPath != NULL )
+        {
+            memcpy( pcPath, C->pucFilePath, xLength );
+            memcpy( &pcPath[ xLength ], OTA_PAL_CHECKPOINT_SUFFIX, sizeof( OTA_PAL_CHECKPOINT_SUFFIX ) );
+        }
+    }
+
+    return pcPath;
+}
+
+
 /* Verify the signature of the specified file. */
 
 static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C )
@@ -262,19 +476,30 @@ static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C )
     uint32_t ulBytesRead;
     uint32_t ulSignerCertSize;
     uint8_t * pucBuf, * pucSignerCert;
-    void * pvSigVerifyContext;
 
     if( prvContextValidate( C ) == pdTRUE )
     {
-        /* Verify an ECDSA-SHA256 signature. */
-        if( pdFALSE == CRYPTO_SignatureVerificationStart( &pvSigVerifyContext, cryptoASYMMETRIC_ALGORITHM_ECDSA, cryptoHASH_ALGORITHM_SHA256 ) )
+        /* Verify an ECDSA-SHA256 signature. If the agent hashed the file while receiving it, only the part it
+         * could not hash in order is read back. The context is kept in the OTA context until it is finished
+         * so the agent frees it if verification stops early. */
+        if( C->pvSigVerifyContext == NULL )
+        {
+            C->ulHashedBytes = 0;
+
+            if( pdFALSE == CRYPTO_SignatureVerificationStart( &C->pvSigVerifyContext, cryptoASYMMETRIC_ALGORITHM_ECDSA, cryptoHASH_ALGORITHM_SHA256 ) )
+            {
+                C->pvSigVerifyContext = NULL;
+            }
+        }
+
+        if( C->pvSigVerifyContext == NULL )
         {
             eResult = kOTA_Err_SignatureCheckFailed;
         }
         else
         {
-            OTA_LOG_L1( "[%s] Started %s signature verification, file: %s\r\n", OTA_METHOD_NAME,
-                        cOTA_JSON_FileSignatureKey, ( const char * ) C->pucCertFilepath );
+            OTA_LOG_L1( "[%s] Started %s signature verification, file: %s, %u bytes already hashed\r\n", OTA_METHOD_NAME,
+                        cOTA_JSON_FileSignatureKey, ( const char * ) C->pucCertFilepath, C->ulHashedBytes );
             pucSignerCert = prvPAL_ReadAndAssumeCertificate( ( const uint8_t * const ) C->pucCertFilepath, &ulSignerCertSize );
 
             if( pucSignerCert != NULL )
@@ -283,19 +508,19 @@ static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C )
 
                 if( pucBuf != NULL )
                 {
-                    /* Rewind the received file to the beginning. */
-                    if( fseek( C->pxFile, 0L, SEEK_SET ) == 0 ) /*lint !e586
-                                                                  * C standard library call is being used for portability. */
+                    /* Seek to the first byte of the received file that is not hashed yet. */
+                    if( fseek( C->pxFile, ( long ) C->ulHashedBytes, SEEK_SET ) == 0 ) /*lint !e586
+                                                                                     * C standard library call is being used for portability. */
                     {
                         do
                         {
                             ulBytesRead = fread( pucBuf, 1, OTA_PAL_WIN_BUF_SIZE, C->pxFile ); /*lint !e586
                                                                                                * C standard library call is being used for portability. */
                             /* Include the file chunk in the signature validation. Zero size is OK. */
-                            CRYPTO_SignatureVerificationUpdate( pvSigVerifyContext, pucBuf, ulBytesRead );
+                            CRYPTO_SignatureVerificationUpdate( C->pvSigVerifyContext, pucBuf, ulBytesRead );
                         } while( ulBytesRead > 0UL );
 
-                        if( pdFALSE == CRYPTO_SignatureVerificationFinal( pvSigVerifyContext,
+                        if( pdFALSE == CRYPTO_SignatureVerificationFinal( C->pvSigVerifyContext,
                                                                           ( char * ) pucSignerCert,
                                                                           ( size_t ) ulSignerCertSize,
                                                                           C->pxSignature->ucData,
@@ -303,7 +528,7 @@ static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C )
                         {
                             eResult = kOTA_Err_SignatureCheckFailed;
                         }
-						pvSigVerifyContext = NULL;	/* The context has been freed by CRYPTO_SignatureVerificationFinal(). */
+						C->pvSigVerifyContext = NULL;	/* The context has been freed by CRYPTO_SignatureVerificationFinal(). */
                     }
                     else
                     {
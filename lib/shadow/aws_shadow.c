@@ -726,6 +726,7 @@ static BaseType_t prvShadowMQTTCallback( void * pvUserData,
     BaseType_t xOperationMatched = pdFALSE;
     ShadowClient_t * pxShadowClient;
     const MQTTPublishData_t * pxPublishData;
+    MQTTPublishData_t xClonedPublishData;
     ShadowOperationName_t xOperationName;
     ShadowReturnCode_t xResult;
     const CallbackCatalogEntry_t * pxCallbackCatalogEntry;
@@ -741,137 +742,166 @@ static BaseType_t prvShadowMQTTCallback( void * pvUserData,
     {
         pxPublishData = ( &( pxCallbackParams->u.xPublishData ) );
 
-        /* If xOperationMutex is locked, the client is waiting on the acceptance
-         * or rejection of a publish. Publish results take priority over user notify
-         * callbacks. This also means that the client will not be notified of gets or
-         * deletes performed by itself in a user notify callback. However, the client
-         * will still be notified of updates performed by itself if it has registered
-         * a callback for /update/documents or update/delta. */
+        /* A message delivered in place by the MQTT library is only valid during
+         * this callback, but the buffer may be handed over to the user. Copy it
+         * to a buffer first, and drop it if no buffer is available. */
+        if( pxPublishData->xBuffer == NULL )
+        {
+            if( MQTT_AGENT_ClonePublishData( pxShadowClient->xMQTTClient,
+                                             pxPublishData,
+                                             &xClonedPublishData ) == eMQTTAgentSuccess )
+            {
+                pxPublishData = &xClonedPublishData;
+            }
+            else
+            {
+                Shadow_debug_printf( ( "[Shadow %d] Warning: no buffer to copy an MQTT"
+                                       " message, dropping it.\r\n", xShadowClientID ) );
+                pxPublishData = NULL;
+            }
+        }
 
-        if( xSemaphoreTake( pxShadowClient->xOperationDataMutex,
-                            portMAX_DELAY ) == pdPASS )
+        if( pxPublishData != NULL )
         {
-            if( pxShadowClient->pxOperationData != NULL )
+            /* If xOperationMutex is locked, the client is waiting on the acceptance
+             * or rejection of a publish. Publish results take priority over user notify
+             * callbacks. This also means that the client will not be notified of gets or
+             * deletes performed by itself in a user notify callback. However, the client
+             * will still be notified of updates performed by itself if it has registered
+             * a callback for /update/documents or update/delta. */
+
+            if( xSemaphoreTake( pxShadowClient->xOperationDataMutex,
+                                portMAX_DELAY ) == pdPASS )
             {
-                /* Verify Thing Name and operation by comparing the received topic with
-                 * the current operation's topic. */
+                if( pxShadowClient->pxOperationData != NULL )
+                {
+                    /* Verify Thing Name and operation by comparing the received topic with
+                     * the current operation's topic. */
 
-                xCompareLen = ( BaseType_t ) configMIN( ( BaseType_t ) strlen( ( const char * ) pxShadowClient->ucTopicBuffer ),
-                                                        ( BaseType_t ) pxPublishData->usTopicLength );
+                    xCompareLen = ( BaseType_t ) configMIN( ( BaseType_t ) strlen( ( const char * ) pxShadowClient->ucTopicBuffer ),
+                                                            ( BaseType_t ) pxPublishData->usTopicLength );
 
-                if( strncmp( ( const char * ) pxPublishData->pucTopic,
-                             ( const char * ) pxShadowClient->ucTopicBuffer,
-                             ( size_t ) xCompareLen ) == 0 )
-                {
-                    /* Parse the in-progress operation and result. */
-                    xOperationName = ( pxShadowClient->pxOperationData )->xOperationInProgress;
-                    xResult = prvParseShadowOperationStatus( pxPublishData->pucTopic,
-                                                             pxPublishData->usTopicLength );
-
-                    /* Both an operation and result were identified, and both match
-                     * the operation this Shadow Client is waiting on; call the
-                     * operation-specific callback. */
-                    if( ( xResult != eShadowUnknown ) && ( xOperationName != eShadowOperationOther ) )
+                    if( strncmp( ( const char * ) pxPublishData->pucTopic,
+                                 ( const char * ) pxShadowClient->ucTopicBuffer,
+                                 ( size_t ) xCompareLen ) == 0 )
                     {
-                        xOperationMatched = pdTRUE;
-
-                        switch( xOperationName )
+                        /* Parse the in-progress operation and result. */
+                        xOperationName = ( pxShadowClient->pxOperationData )->xOperationInProgress;
+                        xResult = prvParseShadowOperationStatus( pxPublishData->pucTopic,
+                                                                 pxPublishData->usTopicLength );
+
+                        /* Both an operation and result were identified, and both match
+                         * the operation this Shadow Client is waiting on; call the
+                         * operation-specific callback. */
+                        if( ( xResult != eShadowUnknown ) && ( xOperationName != eShadowOperationOther ) )
                         {
-                            case eShadowOperationUpdate:
-                                prvShadowUpdateCallback( xShadowClientID,
-                                                         xResult,
-                                                         ( pxShadowClient->pxOperationData )->pxOperationParams,
-                                                         ( const char * ) pxPublishData->pvData,
-                                                         pxPublishData->ulDataLength );
-                                break;
-
-                            case eShadowOperationGet:
-                                prvShadowGetCallback( xShadowClientID,
-                                                      xResult,
-                                                      ( pxShadowClient->pxOperationData )->pxOperationParams,
-                                                      ( const char * ) pxPublishData->pvData,
-                                                      pxPublishData->ulDataLength,
-                                                      pxPublishData->xBuffer );
-
-                                /* Only take an MQTT buffer if the Get operation succeeded. */
-                                if( xResult == eShadowSuccess )
-                                {
-                                    xReturn = pdTRUE;
-                                }
-
-                                break;
-
-                            case eShadowOperationDelete:
-                                prvShadowDeleteCallback( xShadowClientID,
-                                                         xResult,
-                                                         ( const char * ) pxPublishData->pvData,
-                                                         pxPublishData->ulDataLength );
-                                break;
-
-                            default:
-                                /* Should not fall here. */
-                                break;
+                            xOperationMatched = pdTRUE;
+
+                            switch( xOperationName )
+                            {
+                                case eShadowOperationUpdate:
+                                    prvShadowUpdateCallback( xShadowClientID,
+                                                             xResult,
+                                                             ( pxShadowClient->pxOperationData )->pxOperationParams,
+                                                             ( const char * ) pxPublishData->pvData,
+                                                             pxPublishData->ulDataLength );
+                                    break;
+
+                                case eShadowOperationGet:
+                                    prvShadowGetCallback( xShadowClientID,
+                                                          xResult,
+                                                          ( pxShadowClient->pxOperationData )->pxOperationParams,
+                                                          ( const char * ) pxPublishData->pvData,
+                                                          pxPublishData->ulDataLength,
+                                                          pxPublishData->xBuffer );
+
+                                    /* Only take an MQTT buffer if the Get operation succeeded. */
+                                    if( xResult == eShadowSuccess )
+                                    {
+                                        xReturn = pdTRUE;
+                                    }
+
+                                    break;
+
+                                case eShadowOperationDelete:
+                                    prvShadowDeleteCallback( xShadowClientID,
+                                                             xResult,
+                                                             ( const char * ) pxPublishData->pvData,
+                                                             pxPublishData->ulDataLength );
+                                    break;
+
+                                default:
+                                    /* Should not fall here. */
+                                    break;
+                            }
                         }
                     }
                 }
-            }
 
-            configASSERT( xSemaphoreGive( pxShadowClient->xOperationDataMutex ) == pdPASS );
-        }
-
-        /* If the received topic doesn't match the current operation, it's
-         * still possible for it to match a registered callback. */
-        if( xOperationMatched == pdFALSE )
-        {
-            pxCallbackCatalogEntry = prvMatchCallbackTopic( pxShadowClient,
-                                                            pxPublishData->pucTopic, pxPublishData->usTopicLength,
-                                                            &xOperationName );
+                configASSERT( xSemaphoreGive( pxShadowClient->xOperationDataMutex ) == pdPASS );
+            }
 
-            if( pxCallbackCatalogEntry != NULL )
+            /* If the received topic doesn't match the current operation, it's
+             * still possible for it to match a registered callback. */
+            if( xOperationMatched == pdFALSE )
             {
-                switch( xOperationName )
+                pxCallbackCatalogEntry = prvMatchCallbackTopic( pxShadowClient,
+                                                                pxPublishData->pucTopic, pxPublishData->usTopicLength,
+                                                                &xOperationName );
+
+                if( pxCallbackCatalogEntry != NULL )
                 {
-                    case eShadowOperationUpdateDocuments:
+                    switch( xOperationName )
+                    {
+                        case eShadowOperationUpdateDocuments:
 
-                        if( pxCallbackCatalogEntry->xCallbackInfo.xShadowUpdatedCallback != NULL )
-                        {
-                            xReturn = pxCallbackCatalogEntry->xCallbackInfo.xShadowUpdatedCallback( pvUserData,
-                                                                                                    pxCallbackCatalogEntry->xCallbackInfo.pcThingName,
-                                                                                                    ( const char * ) pxPublishData->pvData,
-                                                                                                    pxPublishData->ulDataLength,
-                                                                                                    pxPublishData->xBuffer );
-                        }
+                            if( pxCallbackCatalogEntry->xCallbackInfo.xShadowUpdatedCallback != NULL )
+                            {
+                                xReturn = pxCallbackCatalogEntry->xCallbackInfo.xShadowUpdatedCallback( pvUserData,
+                                                                                                        pxCallbackCatalogEntry->xCallbackInfo.pcThingName,
+                                                                                                        ( const char * ) pxPublishData->pvData,
+                                                                                                        pxPublishData->ulDataLength,
+                                                                                                        pxPublishData->xBuffer );
+                            }
 
-                        break;
+                            break;
 
-                    case eShadowOperationUpdateDelta:
+                        case eShadowOperationUpdateDelta:
 
-                        if( pxCallbackCatalogEntry->xCallbackInfo.xShadowDeltaCallback != NULL )
-                        {
-                            xReturn = pxCallbackCatalogEntry->xCallbackInfo.xShadowDeltaCallback( pvUserData,
-                                                                                                  pxCallbackCatalogEntry->xCallbackInfo.pcThingName,
-                                                                                                  ( const char * ) pxPublishData->pvData,
-                                                                                                  pxPublishData->ulDataLength,
-                                                                                                  pxPublishData->xBuffer );
-                        }
+                            if( pxCallbackCatalogEntry->xCallbackInfo.xShadowDeltaCallback != NULL )
+                            {
+                                xReturn = pxCallbackCatalogEntry->xCallbackInfo.xShadowDeltaCallback( pvUserData,
+                                                                                                      pxCallbackCatalogEntry->xCallbackInfo.pcThingName,
+                                                                                                      ( const char * ) pxPublishData->pvData,
+                                                                                                      pxPublishData->ulDataLength,
+                                                                                                      pxPublishData->xBuffer );
+                            }
 
-                        break;
+                            break;
 
-                    case eShadowOperationDeletedByAnother:
+                        case eShadowOperationDeletedByAnother:
 
-                        if( pxCallbackCatalogEntry->xCallbackInfo.xShadowDeletedCallback != NULL )
-                        {
-                            pxCallbackCatalogEntry->xCallbackInfo.xShadowDeletedCallback( pvUserData,
-                                                                                          pxCallbackCatalogEntry->xCallbackInfo.pcThingName );
-                        }
+                            if( pxCallbackCatalogEntry->xCallbackInfo.xShadowDeletedCallback != NULL )
+                            {
+                                pxCallbackCatalogEntry->xCallbackInfo.xShadowDeletedCallback( pvUserData,
+                                                                                              pxCallbackCatalogEntry->xCallbackInfo.pcThingName );
+                            }
 
-                        break;
+                            break;
 
-                    default:
-                        /* Should not fall here. */
-                        break;
+                        default:
+                            /* Should not fall here. */
+                            break;
+                    }
                 }
             }
+
+            /* Return the copy if it was not taken. */
+            if( ( xReturn == pdFALSE ) && ( pxPublishData == &xClonedPublishData ) )
+            {
+                ( void ) MQTT_AGENT_ReturnBuffer( pxShadowClient->xMQTTClient,
+                                                  xClonedPublishData.xBuffer );
+            }
         }
     }
     /* The Shadow Client assumes all subscriptions are lost on disconnect. */
@@ -25,6 +25,7 @@
 
 /* Standard includes. */
 #include <stdint.h>
+#include <string.h>
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
@@ -49,6 +50,7 @@ TEST_TEAR_DOWN( Full_CRYPTO )
 TEST_GROUP_RUNNER( Full_CRYPTO )
 {
     RUN_TEST_CASE( Full_CRYPTO, VerifySignatureTestVectors );
+    RUN_TEST_CASE( Full_CRYPTO, SaveRestoreHashState );
 }
 
 TEST( Full_CRYPTO, VerifySignatureTestVectors )
@@ -281,3 +283,67 @@ TEST( Full_CRYPTO, VerifySignatureTestVectors )
     TEST_ASSERT_FALSE( xResult );
     /** @}*/
 }
+
+TEST( Full_CRYPTO, SaveRestoreHashState )
+{
+    BaseType_t xResult = pdFALSE;
+    void * pvContext = NULL;
+    void * pvRestoredContext = NULL;
+    uint8_t * pucState = NULL;
+    uint8_t * pucRestoredState = NULL;
+    size_t xStateLength = 0;
+    size_t xRestoredStateLength = 0;
+    uint8_t ucData[ 100 ] = { 0 };
+
+    xResult = CRYPTO_SignatureVerificationStart(
+        &pvContext,
+        cryptoASYMMETRIC_ALGORITHM_ECDSA,
+        cryptoHASH_ALGORITHM_SHA256 );
+    TEST_ASSERT_TRUE( xResult );
+
+    /* Hash a length that leaves a partial block in the context. */
+    memset( ucData, 0xA5, sizeof( ucData ) );
+    CRYPTO_SignatureVerificationUpdate( pvContext, ucData, sizeof( ucData ) );
+
+    /* Query the state length, then save the state. */
+    xResult = CRYPTO_SignatureVerificationSave( pvContext, NULL, 0, &xStateLength );
+    TEST_ASSERT_TRUE( xResult );
+    TEST_ASSERT_GREATER_THAN( 0, xStateLength );
+
+    pucState = pvPortMalloc( xStateLength );
+    pucRestoredState = pvPortMalloc( xStateLength );
+    TEST_ASSERT_NOT_NULL( pucState );
+    TEST_ASSERT_NOT_NULL( pucRestoredState );
+
+    xResult = CRYPTO_SignatureVerificationSave( pvContext, pucState, xStateLength - 1, &xStateLength );
+    TEST_ASSERT_FALSE( xResult );
+    xResult = CRYPTO_SignatureVerificationSave( pvContext, pucState, xStateLength, &xStateLength );
+    TEST_ASSERT_TRUE( xResult );
+
+    /* A truncated or corrupted state is rejected. */
+    xResult = CRYPTO_SignatureVerificationRestore( &pvRestoredContext, pucState, xStateLength - 1 );
+    TEST_ASSERT_FALSE( xResult );
+    memcpy( pucRestoredState, pucState, xStateLength );
+    memset( pucRestoredState, 0xFF, sizeof( BaseType_t ) );
+    xResult = CRYPTO_SignatureVerificationRestore( &pvRestoredContext, pucRestoredState, xStateLength );
+    TEST_ASSERT_FALSE( xResult );
+
+    /* Continue both hashes with the same data and check that they stay in step. */
+    xResult = CRYPTO_SignatureVerificationRestore( &pvRestoredContext, pucState, xStateLength );
+    TEST_ASSERT_TRUE( xResult );
+    CRYPTO_SignatureVerificationUpdate( pvContext, ucData, sizeof( ucData ) );
+    CRYPTO_SignatureVerificationUpdate( pvRestoredContext, ucData, sizeof( ucData ) );
+
+    xResult = CRYPTO_SignatureVerificationSave( pvContext, pucState, xStateLength, &xStateLength );
+    TEST_ASSERT_TRUE( xResult );
+    xResult = CRYPTO_SignatureVerificationSave( pvRestoredContext, pucRestoredState, xStateLength, &xRestoredStateLength );
+    TEST_ASSERT_TRUE( xResult );
+    TEST_ASSERT_EQUAL( xStateLength, xRestoredStateLength );
+    TEST_ASSERT_EQUAL_MEMORY( pucState, pucRestoredState, xStateLength );
+
+    /* Free the contexts. */
+    ( void ) CRYPTO_SignatureVerificationFinal( pvContext, NULL, 0, NULL, 0 );
+    ( void ) CRYPTO_SignatureVerificationFinal( pvRestoredContext, NULL, 0, NULL, 0 );
+    vPortFree( pucState );
+    vPortFree( pucRestoredState );
+}
@@ -29,6 +29,7 @@
 #include "task.h"
 
 #include "aws_cbor.h"
+#include "aws_cbor_alloc.h"
 #include "aws_cbor_print.h"
 #include "aws_cbor_types.h"
 #include "aws_clientcredential.h"
@@ -63,6 +64,7 @@ TEST_GROUP_RUNNER( Full_DEFENDER )
     RUN_TEST_CASE( Full_DEFENDER, Start_should_return_success );
     RUN_TEST_CASE( Full_DEFENDER, Stop_should_return_success_when_started );
     RUN_TEST_CASE( Full_DEFENDER, Stop_should_return_err_when_not_started );
+    RUN_TEST_CASE( Full_DEFENDER, task_profile_report_matches_profiles );
 
     /* These tests check the connectivity and responses from the service */
     RUN_TEST_CASE( Full_DEFENDER, report_to_echo_server );
@@ -106,6 +108,85 @@ TEST( Full_DEFENDER, Stop_should_return_err_when_not_started )
 
 /*----------------------------------------------------------------------------*/
 
+static void prvAssertProfileName( CBORHandle_t xProfile,
+                                  char const * pcName );
+
+/* Builds the task profile report from the profiles of the port, which with
+ * the unit_test port are a fixed set with two tasks of the same name, and
+ * reads each task and interrupt handler back by its number. */
+TEST( Full_DEFENDER, task_profile_report_matches_profiles )
+{
+    DefenderTaskProfile_t const * pxTasks = NULL;
+    DefenderIsrProfile_t const * pxIsrs = NULL;
+    char cKey[ 12 ];
+
+    TaskProfileRefresh();
+    int32_t lTaskCount = TaskProfilesGet( &pxTasks );
+    int32_t lIsrCount = IsrProfilesGet( &pxIsrs );
+
+    CBORHandle_t xReport = TaskProfileReportGet();
+    TEST_ASSERT_NOT_NULL( xReport );
+    TEST_ASSERT_EQUAL( eCborErrNoError, CBOR_CheckError( xReport ) );
+
+    CBORHandle_t xTaskProfiles =
+        CBOR_FromKeyReadMap( xReport, DEFENDER_TASK_PROFILES_TAG );
+    CBORHandle_t xIsrProfiles =
+        CBOR_FromKeyReadMap( xReport, DEFENDER_ISR_PROFILES_TAG );
+    CBOR_Delete( &xReport );
+    TEST_ASSERT_NOT_NULL( xTaskProfiles );
+    TEST_ASSERT_NOT_NULL( xIsrProfiles );
+
+    for( int32_t lI = 0; lI < lTaskCount; ++lI )
+    {
+        ( void ) snprintf( cKey, sizeof( cKey ), "%ld", ( long ) pxTasks[ lI ].lNumber );
+        CBORHandle_t xTask = CBOR_FromKeyReadMap( xTaskProfiles, cKey );
+        TEST_ASSERT_NOT_NULL_MESSAGE( xTask, cKey );
+
+        prvAssertProfileName( xTask, pxTasks[ lI ].cName );
+        TEST_ASSERT_EQUAL( pxTasks[ lI ].lCpuPermille,
+                           CBOR_FromKeyReadInt( xTask, DEFENDER_CPU_PERMILLE_TAG ) );
+        TEST_ASSERT_EQUAL( pxTasks[ lI ].lSwitches,
+                           CBOR_FromKeyReadInt( xTask, DEFENDER_SWITCHES_TAG ) );
+        TEST_ASSERT_EQUAL( pxTasks[ lI ].lMaxLatency,
+                           CBOR_FromKeyReadInt( xTask, DEFENDER_MAX_LATENCY_TAG ) );
+        TEST_ASSERT_EQUAL( pxTasks[ lI ].lAvgLatency,
+                           CBOR_FromKeyReadInt( xTask, DEFENDER_AVG_LATENCY_TAG ) );
+        TEST_ASSERT_EQUAL( pxTasks[ lI ].lStackFree,
+                           CBOR_FromKeyReadInt( xTask, DEFENDER_STACK_FREE_TAG ) );
+        CBOR_Delete( &xTask );
+    }
+
+    for( int32_t lI = 0; lI < lIsrCount; ++lI )
+    {
+        ( void ) snprintf( cKey, sizeof( cKey ), "%ld", ( long ) pxIsrs[ lI ].lNumber );
+        CBORHandle_t xIsr = CBOR_FromKeyReadMap( xIsrProfiles, cKey );
+        TEST_ASSERT_NOT_NULL_MESSAGE( xIsr, cKey );
+
+        prvAssertProfileName( xIsr, pxIsrs[ lI ].cName );
+        TEST_ASSERT_EQUAL( pxIsrs[ lI ].lCpuPermille,
+                           CBOR_FromKeyReadInt( xIsr, DEFENDER_CPU_PERMILLE_TAG ) );
+        TEST_ASSERT_EQUAL( pxIsrs[ lI ].lCount,
+                           CBOR_FromKeyReadInt( xIsr, DEFENDER_COUNT_TAG ) );
+        TEST_ASSERT_EQUAL( pxIsrs[ lI ].lMaxTime,
+                           CBOR_FromKeyReadInt( xIsr, DEFENDER_MAX_TIME_TAG ) );
+        CBOR_Delete( &xIsr );
+    }
+
+    CBOR_Delete( &xTaskProfiles );
+    CBOR_Delete( &xIsrProfiles );
+}
+
+static void prvAssertProfileName( CBORHandle_t xProfile,
+                                  char const * pcName )
+{
+    char * pcReadName = CBOR_FromKeyReadString( xProfile, DEFENDER_NAME_TAG );
+
+    TEST_ASSERT_EQUAL_STRING( pcName, pcReadName );
+    pxCBOR_free( pcReadName );
+}
+
+/*----------------------------------------------------------------------------*/
+
 static bool xEchoTriggered;
 
 static CBORHandle_t prvCreateDummyReport( void );
@@ -0,0 +1,302 @@
+/*
+ * Amazon FreeRTOS Kernel Test V1.1.4
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_test_fast_mutex.c
+ * @brief Tests for the fast mutexes and reader-writer locks of fast_mutex.h.
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "fast_mutex.h"
+
+/* Test framework includes. */
+#include "unity_fixture.h"
+#include "unity.h"
+
+/*-----------------------------------------------------------*/
+
+/* The test task runs at this priority, so the other task can run above it. */
+#define fastmutexTEST_PRIORITY      ( configMAX_PRIORITIES - 3 )
+
+#define fastmutexTASK_STACK_SIZE    ( configMINIMAL_STACK_SIZE * 2 )
+
+/*-----------------------------------------------------------*/
+
+static UBaseType_t uxOriginalPriority;
+static FastMutex_t xMutex;
+static RWLock_t xLock;
+static TaskHandle_t xOtherTask;
+static TickType_t xOtherTicksToWait;
+static volatile BaseType_t xOtherResult;
+static volatile UBaseType_t uxOtherSteps;
+
+/*-----------------------------------------------------------*/
+
+/* The other task takes the mutex or lock, counts a step, waits to be notified,
+ * gives what it took, and counts another step. */
+static void prvMutexTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    xOtherResult = xFastMutexTake( &xMutex, xOtherTicksToWait );
+    uxOtherSteps++;
+    ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+    if( xOtherResult == pdPASS )
+    {
+        ( void ) xFastMutexGive( &xMutex );
+    }
+
+    uxOtherSteps++;
+    vTaskSuspend( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReaderTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    xOtherResult = xRWLockReadTake( &xLock, xOtherTicksToWait );
+    uxOtherSteps++;
+    ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+    if( xOtherResult == pdPASS )
+    {
+        ( void ) xRWLockReadGive( &xLock );
+    }
+
+    uxOtherSteps++;
+    vTaskSuspend( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvWriterTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    xOtherResult = xRWLockWriteTake( &xLock, xOtherTicksToWait );
+    uxOtherSteps++;
+    ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+    if( xOtherResult == pdPASS )
+    {
+        ( void ) xRWLockWriteGive( &xLock );
+    }
+
+    uxOtherSteps++;
+    vTaskSuspend( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Creates the other task above the priority of the test task, so it runs
+ * straight away, until it blocks. */
+static void prvCreateOtherTask( TaskFunction_t pxTask,
+                                TickType_t xTicksToWait )
+{
+    BaseType_t xResult;
+
+    xOtherTicksToWait = xTicksToWait;
+    xResult = xTaskCreate( pxTask,
+                           "FMOther",
+                           fastmutexTASK_STACK_SIZE,
+                           NULL,
+                           fastmutexTEST_PRIORITY + 1,
+                           &xOtherTask );
+    TEST_ASSERT_EQUAL( pdPASS, xResult );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP( Full_FAST_MUTEX );
+
+/*-----------------------------------------------------------*/
+
+TEST_SETUP( Full_FAST_MUTEX )
+{
+    uxOriginalPriority = uxTaskPriorityGet( NULL );
+    vTaskPrioritySet( NULL, fastmutexTEST_PRIORITY );
+    xOtherTask = NULL;
+    xOtherResult = pdFAIL;
+    uxOtherSteps = 0;
+
+    vFastMutexInit( &xMutex );
+    vRWLockInit( &xLock );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_TEAR_DOWN( Full_FAST_MUTEX )
+{
+    if( xOtherTask != NULL )
+    {
+        vTaskDelete( xOtherTask );
+    }
+
+    vTaskPrioritySet( NULL, uxOriginalPriority );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP_RUNNER( Full_FAST_MUTEX )
+{
+    RUN_TEST_CASE( Full_FAST_MUTEX, take_give );
+    RUN_TEST_CASE( Full_FAST_MUTEX, take_times_out );
+    RUN_TEST_CASE( Full_FAST_MUTEX, give_wakes_waiter );
+    RUN_TEST_CASE( Full_FAST_MUTEX, readers_share );
+    RUN_TEST_CASE( Full_FAST_MUTEX, writer_excludes_readers );
+    RUN_TEST_CASE( Full_FAST_MUTEX, writer_waits_for_readers );
+}
+
+/*-----------------------------------------------------------*/
+
+/* The mutex records its owner, and can only be given by it. */
+TEST( Full_FAST_MUTEX, take_give )
+{
+    TEST_ASSERT_NULL( xFastMutexGetOwner( &xMutex ) );
+    TEST_ASSERT_EQUAL( pdFAIL, xFastMutexGive( &xMutex ) );
+
+    TEST_ASSERT_EQUAL( pdPASS, xFastMutexTake( &xMutex, 0 ) );
+    TEST_ASSERT_EQUAL_PTR( xTaskGetCurrentTaskHandle(), xFastMutexGetOwner( &xMutex ) );
+
+    TEST_ASSERT_EQUAL( pdPASS, xFastMutexGive( &xMutex ) );
+    TEST_ASSERT_NULL( xFastMutexGetOwner( &xMutex ) );
+    TEST_ASSERT_EQUAL( pdFAIL, xFastMutexGive( &xMutex ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A mutex held by another task is not taken before the block time expires,
+ * and can be taken once that task gives it. */
+TEST( Full_FAST_MUTEX, take_times_out )
+{
+    prvCreateOtherTask( prvMutexTask, 0 );
+    TEST_ASSERT_EQUAL( pdPASS, xOtherResult );
+    TEST_ASSERT_EQUAL_PTR( xOtherTask, xFastMutexGetOwner( &xMutex ) );
+
+    TEST_ASSERT_EQUAL( pdFAIL, xFastMutexTake( &xMutex, 2 ) );
+    TEST_ASSERT_EQUAL( pdFAIL, xFastMutexGive( &xMutex ) );
+
+    ( void ) xTaskNotifyGive( xOtherTask );
+    TEST_ASSERT_EQUAL( 2, uxOtherSteps );
+    TEST_ASSERT_EQUAL( pdPASS, xFastMutexTake( &xMutex, 0 ) );
+    TEST_ASSERT_EQUAL( pdPASS, xFastMutexGive( &xMutex ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task waiting for the mutex raises the priority of its owner to its own
+ * until the owner gives the mutex, which then passes to the waiting task. */
+TEST( Full_FAST_MUTEX, give_wakes_waiter )
+{
+    TEST_ASSERT_EQUAL( pdPASS, xFastMutexTake( &xMutex, 0 ) );
+
+    prvCreateOtherTask( prvMutexTask, portMAX_DELAY );
+    TEST_ASSERT_EQUAL( 0, uxOtherSteps );
+    TEST_ASSERT_EQUAL( fastmutexTEST_PRIORITY + 1, uxTaskPriorityGet( NULL ) );
+
+    TEST_ASSERT_EQUAL( pdPASS, xFastMutexGive( &xMutex ) );
+    TEST_ASSERT_EQUAL( fastmutexTEST_PRIORITY, uxTaskPriorityGet( NULL ) );
+    TEST_ASSERT_EQUAL( 1, uxOtherSteps );
+    TEST_ASSERT_EQUAL( pdPASS, xOtherResult );
+    TEST_ASSERT_EQUAL_PTR( xOtherTask, xFastMutexGetOwner( &xMutex ) );
+
+    ( void ) xTaskNotifyGive( xOtherTask );
+    TEST_ASSERT_EQUAL( 2, uxOtherSteps );
+    TEST_ASSERT_NULL( xFastMutexGetOwner( &xMutex ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Any number of tasks can hold the lock for reading at once. */
+TEST( Full_FAST_MUTEX, readers_share )
+{
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockReadTake( &xLock, 0 ) );
+
+    prvCreateOtherTask( prvReaderTask, 0 );
+    TEST_ASSERT_EQUAL( pdPASS, xOtherResult );
+    TEST_ASSERT_FALSE( xRWLockIsWriteOwner( &xLock ) );
+
+    ( void ) xTaskNotifyGive( xOtherTask );
+    TEST_ASSERT_EQUAL( 2, uxOtherSteps );
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockReadGive( &xLock ) );
+    TEST_ASSERT_EQUAL( pdFAIL, xRWLockReadGive( &xLock ) );
+
+    /* With no readers left it can be taken for writing. */
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockWriteTake( &xLock, 0 ) );
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockWriteGive( &xLock ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A reader waits for the writer that holds the lock, and gives up when the
+ * block time expires. */
+TEST( Full_FAST_MUTEX, writer_excludes_readers )
+{
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockWriteTake( &xLock, 0 ) );
+    TEST_ASSERT_TRUE( xRWLockIsWriteOwner( &xLock ) );
+
+    prvCreateOtherTask( prvReaderTask, 2 );
+    TEST_ASSERT_EQUAL( 0, uxOtherSteps );
+    vTaskDelay( 4 );
+    TEST_ASSERT_EQUAL( 1, uxOtherSteps );
+    TEST_ASSERT_EQUAL( pdFAIL, xOtherResult );
+
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockWriteGive( &xLock ) );
+    TEST_ASSERT_FALSE( xRWLockIsWriteOwner( &xLock ) );
+    TEST_ASSERT_EQUAL( pdFAIL, xRWLockWriteGive( &xLock ) );
+
+    ( void ) xTaskNotifyGive( xOtherTask );
+    TEST_ASSERT_EQUAL( 2, uxOtherSteps );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A writer waits for the reader that holds the lock, raising the reader's
+ * priority to its own until the reader gives the lock. */
+TEST( Full_FAST_MUTEX, writer_waits_for_readers )
+{
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockReadTake( &xLock, 0 ) );
+
+    prvCreateOtherTask( prvWriterTask, portMAX_DELAY );
+    TEST_ASSERT_EQUAL( 0, uxOtherSteps );
+    TEST_ASSERT_EQUAL( fastmutexTEST_PRIORITY + 1, uxTaskPriorityGet( NULL ) );
+
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockReadGive( &xLock ) );
+    TEST_ASSERT_EQUAL( fastmutexTEST_PRIORITY, uxTaskPriorityGet( NULL ) );
+    TEST_ASSERT_EQUAL( 1, uxOtherSteps );
+    TEST_ASSERT_EQUAL( pdPASS, xOtherResult );
+
+    /* The writer holds the lock until it is notified. */
+    TEST_ASSERT_EQUAL( pdFAIL, xRWLockReadTake( &xLock, 0 ) );
+    ( void ) xTaskNotifyGive( xOtherTask );
+    TEST_ASSERT_EQUAL( 2, uxOtherSteps );
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockReadTake( &xLock, 0 ) );
+    TEST_ASSERT_EQUAL( pdPASS, xRWLockReadGive( &xLock ) );
+}
@@ -0,0 +1,292 @@
+/*
+ * Amazon FreeRTOS Kernel Test V1.1.4
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_test_queue_multiple.c
+ * @brief Tests for sending and receiving several queue items at once.
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/* Test framework includes. */
+#include "unity_fixture.h"
+#include "unity.h"
+
+/*-----------------------------------------------------------*/
+
+/* Number of items the queue created by each test can hold. */
+#define multipleQUEUE_LENGTH        ( 8 )
+
+/* More items than the queue can hold. */
+#define multipleNUM_ITEMS           ( multipleQUEUE_LENGTH + 4 )
+
+/* The test task runs at this priority, so the other task can run above it. */
+#define multipleTEST_PRIORITY       ( configMAX_PRIORITIES - 2 )
+
+#define multipleTASK_STACK_SIZE     ( configMINIMAL_STACK_SIZE * 2 )
+
+/*-----------------------------------------------------------*/
+
+static UBaseType_t uxOriginalPriority;
+static QueueHandle_t xQueue;
+static TaskHandle_t xOtherTask;
+static uint32_t ulItems[ multipleNUM_ITEMS ];
+static uint32_t ulReceived[ multipleNUM_ITEMS ];
+static volatile BaseType_t xOtherResult;
+static volatile UBaseType_t uxOtherCalls;
+
+/*-----------------------------------------------------------*/
+
+/* Receives the items that are waiting once, after blocking for them. */
+static void prvReceivingTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    xOtherResult = xQueueReceiveMultiple( xQueue, ulReceived, multipleNUM_ITEMS, portMAX_DELAY );
+    uxOtherCalls++;
+    vTaskSuspend( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Sends four items once, after blocking for space. */
+static void prvSendingTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    xOtherResult = xQueueSendMultiple( xQueue, ulItems, 4, portMAX_DELAY );
+    uxOtherCalls++;
+    vTaskSuspend( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCreateOtherTask( TaskFunction_t pxTask )
+{
+    BaseType_t xResult;
+
+    xResult = xTaskCreate( pxTask,
+                           "QMOther",
+                           multipleTASK_STACK_SIZE,
+                           NULL,
+                           multipleTEST_PRIORITY + 1,
+                           &xOtherTask );
+    TEST_ASSERT_EQUAL( pdPASS, xResult );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP( Full_QUEUE_MULTIPLE );
+
+/*-----------------------------------------------------------*/
+
+TEST_SETUP( Full_QUEUE_MULTIPLE )
+{
+    uint32_t ul;
+
+    uxOriginalPriority = uxTaskPriorityGet( NULL );
+    vTaskPrioritySet( NULL, multipleTEST_PRIORITY );
+    xOtherTask = NULL;
+    xOtherResult = 0;
+    uxOtherCalls = 0;
+
+    for( ul = 0; ul < multipleNUM_ITEMS; ul++ )
+    {
+        ulItems[ ul ] = ul + 1;
+        ulReceived[ ul ] = 0;
+    }
+
+    xQueue = xQueueCreate( multipleQUEUE_LENGTH, sizeof( uint32_t ) );
+    TEST_ASSERT_NOT_NULL( xQueue );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_TEAR_DOWN( Full_QUEUE_MULTIPLE )
+{
+    if( xOtherTask != NULL )
+    {
+        vTaskDelete( xOtherTask );
+    }
+
+    vQueueDelete( xQueue );
+    vTaskPrioritySet( NULL, uxOriginalPriority );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP_RUNNER( Full_QUEUE_MULTIPLE )
+{
+    RUN_TEST_CASE( Full_QUEUE_MULTIPLE, send_receive_in_order );
+    RUN_TEST_CASE( Full_QUEUE_MULTIPLE, items_wrap );
+    RUN_TEST_CASE( Full_QUEUE_MULTIPLE, mixed_with_single_items );
+    RUN_TEST_CASE( Full_QUEUE_MULTIPLE, send_what_fits );
+    RUN_TEST_CASE( Full_QUEUE_MULTIPLE, receive_when_empty );
+    RUN_TEST_CASE( Full_QUEUE_MULTIPLE, send_wakes_receiver );
+    RUN_TEST_CASE( Full_QUEUE_MULTIPLE, receive_wakes_sender );
+    RUN_TEST_CASE( Full_QUEUE_MULTIPLE, queue_set_event_per_item );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Items sent together are received in order, and a receive takes the items
+ * that are waiting without waiting for more. */
+TEST( Full_QUEUE_MULTIPLE, send_receive_in_order )
+{
+    TEST_ASSERT_EQUAL( 5, xQueueSendMultiple( xQueue, ulItems, 5, 0 ) );
+    TEST_ASSERT_EQUAL( 5, uxQueueMessagesWaiting( xQueue ) );
+
+    TEST_ASSERT_EQUAL( 5, xQueueReceiveMultiple( xQueue, ulReceived, multipleQUEUE_LENGTH, portMAX_DELAY ) );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( ulItems, ulReceived, 5 );
+    TEST_ASSERT_EQUAL( 0, uxQueueMessagesWaiting( xQueue ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Items that run past the end of the queue's storage area are copied in two
+ * parts, in both directions. */
+TEST( Full_QUEUE_MULTIPLE, items_wrap )
+{
+    TEST_ASSERT_EQUAL( 5, xQueueSendMultiple( xQueue, ulItems, 5, 0 ) );
+    TEST_ASSERT_EQUAL( 5, xQueueReceiveMultiple( xQueue, ulReceived, 5, 0 ) );
+
+    TEST_ASSERT_EQUAL( multipleQUEUE_LENGTH, xQueueSendMultiple( xQueue, ulItems, multipleQUEUE_LENGTH, 0 ) );
+    TEST_ASSERT_EQUAL( multipleQUEUE_LENGTH, xQueueReceiveMultiple( xQueue, ulReceived, multipleNUM_ITEMS, 0 ) );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( ulItems, ulReceived, multipleQUEUE_LENGTH );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Items sent together and one at a time keep the order they were sent in. */
+TEST( Full_QUEUE_MULTIPLE, mixed_with_single_items )
+{
+    uint32_t ulItem;
+
+    TEST_ASSERT_EQUAL( pdPASS, xQueueSendToBack( xQueue, &( ulItems[ 0 ] ), 0 ) );
+    TEST_ASSERT_EQUAL( 3, xQueueSendMultiple( xQueue, &( ulItems[ 1 ] ), 3, 0 ) );
+    TEST_ASSERT_EQUAL( pdPASS, xQueueSendToBack( xQueue, &( ulItems[ 4 ] ), 0 ) );
+
+    TEST_ASSERT_EQUAL( pdPASS, xQueueReceive( xQueue, &ulItem, 0 ) );
+    TEST_ASSERT_EQUAL_UINT32( ulItems[ 0 ], ulItem );
+    TEST_ASSERT_EQUAL( 4, xQueueReceiveMultiple( xQueue, ulReceived, multipleNUM_ITEMS, 0 ) );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( &( ulItems[ 1 ] ), ulReceived, 4 );
+}
+
+/*-----------------------------------------------------------*/
+
+/* As many items as there is space for are sent, and none once the queue is
+ * full. */
+TEST( Full_QUEUE_MULTIPLE, send_what_fits )
+{
+    TEST_ASSERT_EQUAL( 3, xQueueSendMultiple( xQueue, ulItems, 3, 0 ) );
+    TEST_ASSERT_EQUAL( multipleQUEUE_LENGTH - 3, xQueueSendMultiple( xQueue, &( ulItems[ 3 ] ), multipleNUM_ITEMS - 3, 0 ) );
+    TEST_ASSERT_EQUAL( 0, uxQueueSpacesAvailable( xQueue ) );
+    TEST_ASSERT_EQUAL( 0, xQueueSendMultiple( xQueue, ulItems, 1, 1 ) );
+
+    TEST_ASSERT_EQUAL( multipleQUEUE_LENGTH, xQueueReceiveMultiple( xQueue, ulReceived, multipleNUM_ITEMS, 0 ) );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( ulItems, ulReceived, multipleQUEUE_LENGTH );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A receive from an empty queue returns nothing once the block time expires. */
+TEST( Full_QUEUE_MULTIPLE, receive_when_empty )
+{
+    TickType_t xStart = xTaskGetTickCount();
+
+    TEST_ASSERT_EQUAL( 0, xQueueReceiveMultiple( xQueue, ulReceived, multipleNUM_ITEMS, 0 ) );
+    TEST_ASSERT_EQUAL( 0, xQueueReceiveMultiple( xQueue, ulReceived, multipleNUM_ITEMS, 2 ) );
+    TEST_ASSERT_TRUE( ( xTaskGetTickCount() - xStart ) >= 2 );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task blocked receiving from an empty queue is woken by a batch and
+ * receives all of it at once. */
+TEST( Full_QUEUE_MULTIPLE, send_wakes_receiver )
+{
+    prvCreateOtherTask( prvReceivingTask );
+    TEST_ASSERT_EQUAL( 0, uxOtherCalls );
+
+    TEST_ASSERT_EQUAL( 3, xQueueSendMultiple( xQueue, ulItems, 3, 0 ) );
+    TEST_ASSERT_EQUAL( 1, uxOtherCalls );
+    TEST_ASSERT_EQUAL( 3, xOtherResult );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( ulItems, ulReceived, 3 );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task blocked sending to a full queue is woken when items are received,
+ * and sends as many of its items as then fit. */
+TEST( Full_QUEUE_MULTIPLE, receive_wakes_sender )
+{
+    TEST_ASSERT_EQUAL( multipleQUEUE_LENGTH, xQueueSendMultiple( xQueue, ulItems, multipleQUEUE_LENGTH, 0 ) );
+    prvCreateOtherTask( prvSendingTask );
+    TEST_ASSERT_EQUAL( 0, uxOtherCalls );
+
+    TEST_ASSERT_EQUAL( 2, xQueueReceiveMultiple( xQueue, ulReceived, 2, 0 ) );
+    TEST_ASSERT_EQUAL( 1, uxOtherCalls );
+    TEST_ASSERT_EQUAL( 2, xOtherResult );
+    TEST_ASSERT_EQUAL( 0, uxQueueSpacesAvailable( xQueue ) );
+
+    /* The sender's items come after the ones that were left. */
+    TEST_ASSERT_EQUAL( multipleQUEUE_LENGTH, xQueueReceiveMultiple( xQueue, ulReceived, multipleNUM_ITEMS, 0 ) );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( &( ulItems[ 2 ] ), ulReceived, multipleQUEUE_LENGTH - 2 );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( ulItems, &( ulReceived[ multipleQUEUE_LENGTH - 2 ] ), 2 );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A queue set is given the handle of its member once for each item sent. */
+TEST( Full_QUEUE_MULTIPLE, queue_set_event_per_item )
+{
+    #if ( configUSE_QUEUE_SETS == 1 )
+        QueueSetHandle_t xQueueSet;
+        UBaseType_t ux;
+
+        xQueueSet = xQueueCreateSet( multipleQUEUE_LENGTH );
+        TEST_ASSERT_NOT_NULL( xQueueSet );
+        TEST_ASSERT_EQUAL( pdPASS, xQueueAddToSet( xQueue, xQueueSet ) );
+
+        TEST_ASSERT_EQUAL( 3, xQueueSendMultiple( xQueue, ulItems, 3, 0 ) );
+
+        for( ux = 0; ux < 3; ux++ )
+        {
+            TEST_ASSERT_EQUAL_PTR( xQueue, xQueueSelectFromSet( xQueueSet, 0 ) );
+            TEST_ASSERT_EQUAL( pdPASS, xQueueReceive( xQueue, &( ulReceived[ ux ] ), 0 ) );
+        }
+
+        TEST_ASSERT_NULL( xQueueSelectFromSet( xQueueSet, 0 ) );
+        TEST_ASSERT_EQUAL_UINT32_ARRAY( ulItems, ulReceived, 3 );
+
+        TEST_ASSERT_EQUAL( pdPASS, xQueueRemoveFromSet( xQueue, xQueueSet ) );
+        vQueueDelete( xQueueSet );
+    #else
+        TEST_IGNORE_MESSAGE( "configUSE_QUEUE_SETS is not set to 1." );
+    #endif
+}
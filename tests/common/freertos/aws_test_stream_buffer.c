@@ -0,0 +1,379 @@
+/*
+ * Amazon FreeRTOS Kernel Test V1.1.4
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_test_stream_buffer.c
+ * @brief Tests for writing and reading stream and message buffers in place,
+ * with reserve and commit, and peek and consume.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stream_buffer.h"
+#include "message_buffer.h"
+
+/* Test framework includes. */
+#include "unity_fixture.h"
+#include "unity.h"
+
+/*-----------------------------------------------------------*/
+
+/* Size of the buffers created by the tests. */
+#define streamBUFFER_SIZE           ( ( size_t ) 32 )
+
+/* Length of the data written by most tests. */
+#define streamDATA_LENGTH           ( ( size_t ) 20 )
+
+/* Space taken by the length of each message in a message buffer. */
+#define streamMESSAGE_LENGTH_BYTES  ( sizeof( configMESSAGE_BUFFER_LENGTH_TYPE ) )
+
+/* The test task runs at this priority, so the reading task can run above it. */
+#define streamTEST_PRIORITY         ( configMAX_PRIORITIES - 2 )
+
+#define streamTASK_STACK_SIZE       ( configMINIMAL_STACK_SIZE * 2 )
+
+/*-----------------------------------------------------------*/
+
+static UBaseType_t uxOriginalPriority;
+static StreamBufferHandle_t xStreamBuffer;
+static MessageBufferHandle_t xMessageBuffer;
+static TaskHandle_t xReadingTask;
+static volatile size_t xBytesPeeked;
+static uint8_t ucData[ streamBUFFER_SIZE ];
+static uint8_t ucReceived[ streamBUFFER_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+/* Writes the first xLength bytes of ucData into the regions. */
+static void prvWriteRegions( const StreamBufferRegions_t * pxRegions,
+                             size_t xLength )
+{
+    size_t xFirst = configMIN( xLength, pxRegions->xLength[ 0 ] );
+
+    memcpy( pxRegions->pucData[ 0 ], ucData, xFirst );
+
+    if( xLength > xFirst )
+    {
+        TEST_ASSERT_TRUE( ( xLength - xFirst ) <= pxRegions->xLength[ 1 ] );
+        memcpy( pxRegions->pucData[ 1 ], &( ucData[ xFirst ] ), xLength - xFirst );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Checks the regions hold the bytes of ucData from xOffset on. */
+static void prvCheckRegions( const StreamBufferRegions_t * pxRegions,
+                             size_t xOffset )
+{
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( &( ucData[ xOffset ] ), pxRegions->pucData[ 0 ], pxRegions->xLength[ 0 ] );
+
+    if( pxRegions->xLength[ 1 ] > 0 )
+    {
+        TEST_ASSERT_EQUAL_UINT8_ARRAY( &( ucData[ xOffset + pxRegions->xLength[ 0 ] ] ),
+                                       pxRegions->pucData[ 1 ],
+                                       pxRegions->xLength[ 1 ] );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Moves the head and tail of the stream buffer on by xLength bytes, so the
+ * data written next wraps back to the start of the storage area. */
+static void prvAdvance( StreamBufferHandle_t xBuffer,
+                        size_t xLength )
+{
+    TEST_ASSERT_EQUAL( xLength, xStreamBufferSend( xBuffer, ucData, xLength, 0 ) );
+    TEST_ASSERT_EQUAL( xLength, xStreamBufferReceive( xBuffer, ucReceived, sizeof( ucReceived ), 0 ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReadingTask( void * pvParameters )
+{
+    StreamBufferRegions_t xRegions;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        xBytesPeeked = xStreamBufferPeek( xStreamBuffer, &xRegions, portMAX_DELAY );
+        ( void ) xStreamBufferConsume( xStreamBuffer, xBytesPeeked );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP( Full_STREAM_BUFFER );
+
+/*-----------------------------------------------------------*/
+
+TEST_SETUP( Full_STREAM_BUFFER )
+{
+    size_t x;
+
+    uxOriginalPriority = uxTaskPriorityGet( NULL );
+    vTaskPrioritySet( NULL, streamTEST_PRIORITY );
+    xReadingTask = NULL;
+    xBytesPeeked = 0;
+
+    for( x = 0; x < sizeof( ucData ); x++ )
+    {
+        ucData[ x ] = ( uint8_t ) ( x + 1 );
+    }
+
+    xStreamBuffer = xStreamBufferCreate( streamBUFFER_SIZE, 1 );
+    TEST_ASSERT_NOT_NULL( xStreamBuffer );
+    xMessageBuffer = xMessageBufferCreate( streamBUFFER_SIZE );
+    TEST_ASSERT_NOT_NULL( xMessageBuffer );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_TEAR_DOWN( Full_STREAM_BUFFER )
+{
+    if( xReadingTask != NULL )
+    {
+        vTaskDelete( xReadingTask );
+    }
+
+    vStreamBufferDelete( xStreamBuffer );
+    vMessageBufferDelete( xMessageBuffer );
+    vTaskPrioritySet( NULL, uxOriginalPriority );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP_RUNNER( Full_STREAM_BUFFER )
+{
+    RUN_TEST_CASE( Full_STREAM_BUFFER, reserve_commit );
+    RUN_TEST_CASE( Full_STREAM_BUFFER, reserve_wraps );
+    RUN_TEST_CASE( Full_STREAM_BUFFER, commit_part_of_reservation );
+    RUN_TEST_CASE( Full_STREAM_BUFFER, reserve_when_full );
+    RUN_TEST_CASE( Full_STREAM_BUFFER, peek_consume );
+    RUN_TEST_CASE( Full_STREAM_BUFFER, peek_wraps );
+    RUN_TEST_CASE( Full_STREAM_BUFFER, commit_wakes_reader );
+    RUN_TEST_CASE( Full_STREAM_BUFFER, message_reserve_commit );
+    RUN_TEST_CASE( Full_STREAM_BUFFER, message_reserve_all_or_nothing );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Bytes written into the reserved space are received once committed, and not
+ * before. */
+TEST( Full_STREAM_BUFFER, reserve_commit )
+{
+    StreamBufferRegions_t xRegions;
+
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xStreamBufferReserve( xStreamBuffer, streamDATA_LENGTH, &xRegions, 0 ) );
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xRegions.xLength[ 0 ] );
+    TEST_ASSERT_EQUAL( 0, xRegions.xLength[ 1 ] );
+    prvWriteRegions( &xRegions, streamDATA_LENGTH );
+    TEST_ASSERT_EQUAL( 0, xStreamBufferBytesAvailable( xStreamBuffer ) );
+
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xStreamBufferCommit( xStreamBuffer, streamDATA_LENGTH ) );
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xStreamBufferReceive( xStreamBuffer, ucReceived, sizeof( ucReceived ), 0 ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( ucData, ucReceived, streamDATA_LENGTH );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Space that runs past the end of the storage area is described as two
+ * regions, and the bytes written to both are received in order. */
+TEST( Full_STREAM_BUFFER, reserve_wraps )
+{
+    StreamBufferRegions_t xRegions;
+
+    prvAdvance( xStreamBuffer, streamDATA_LENGTH );
+
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xStreamBufferReserve( xStreamBuffer, streamDATA_LENGTH, &xRegions, 0 ) );
+    TEST_ASSERT_TRUE( xRegions.xLength[ 0 ] > 0 );
+    TEST_ASSERT_TRUE( xRegions.xLength[ 1 ] > 0 );
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xRegions.xLength[ 0 ] + xRegions.xLength[ 1 ] );
+    prvWriteRegions( &xRegions, streamDATA_LENGTH );
+
+    ( void ) xStreamBufferCommit( xStreamBuffer, streamDATA_LENGTH );
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xStreamBufferReceive( xStreamBuffer, ucReceived, sizeof( ucReceived ), 0 ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( ucData, ucReceived, streamDATA_LENGTH );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Only the bytes committed become available, the rest of the reservation is
+ * abandoned, and committing nothing leaves the buffer empty. */
+TEST( Full_STREAM_BUFFER, commit_part_of_reservation )
+{
+    StreamBufferRegions_t xRegions;
+
+    ( void ) xStreamBufferReserve( xStreamBuffer, streamDATA_LENGTH, &xRegions, 0 );
+    prvWriteRegions( &xRegions, 4 );
+    ( void ) xStreamBufferCommit( xStreamBuffer, 4 );
+    TEST_ASSERT_EQUAL( 4, xStreamBufferBytesAvailable( xStreamBuffer ) );
+
+    ( void ) xStreamBufferReserve( xStreamBuffer, streamDATA_LENGTH, &xRegions, 0 );
+    ( void ) xStreamBufferCommit( xStreamBuffer, 0 );
+    TEST_ASSERT_EQUAL( 4, xStreamBufferBytesAvailable( xStreamBuffer ) );
+
+    TEST_ASSERT_EQUAL( 4, xStreamBufferReceive( xStreamBuffer, ucReceived, sizeof( ucReceived ), 0 ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( ucData, ucReceived, 4 );
+    TEST_ASSERT_TRUE( xStreamBufferIsEmpty( xStreamBuffer ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A stream buffer reserves as many of the bytes as are free when the block
+ * time expires. */
+TEST( Full_STREAM_BUFFER, reserve_when_full )
+{
+    StreamBufferRegions_t xRegions;
+
+    TEST_ASSERT_EQUAL( streamBUFFER_SIZE - 4, xStreamBufferSend( xStreamBuffer, ucData, streamBUFFER_SIZE - 4, 0 ) );
+    TEST_ASSERT_EQUAL( 4, xStreamBufferReserve( xStreamBuffer, streamDATA_LENGTH, &xRegions, 1 ) );
+    TEST_ASSERT_EQUAL( 4, xRegions.xLength[ 0 ] + xRegions.xLength[ 1 ] );
+    ( void ) xStreamBufferCommit( xStreamBuffer, 4 );
+
+    TEST_ASSERT_TRUE( xStreamBufferIsFull( xStreamBuffer ) );
+    TEST_ASSERT_EQUAL( 0, xStreamBufferReserve( xStreamBuffer, streamDATA_LENGTH, &xRegions, 1 ) );
+    ( void ) xStreamBufferCommit( xStreamBuffer, 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Peeking describes the data without removing it, and consuming removes only
+ * the bytes given. */
+TEST( Full_STREAM_BUFFER, peek_consume )
+{
+    StreamBufferRegions_t xRegions;
+
+    TEST_ASSERT_EQUAL( 0, xStreamBufferPeek( xStreamBuffer, &xRegions, 0 ) );
+    ( void ) xStreamBufferSend( xStreamBuffer, ucData, streamDATA_LENGTH, 0 );
+
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xStreamBufferPeek( xStreamBuffer, &xRegions, 0 ) );
+    prvCheckRegions( &xRegions, 0 );
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xStreamBufferBytesAvailable( xStreamBuffer ) );
+
+    TEST_ASSERT_EQUAL( 4, xStreamBufferConsume( xStreamBuffer, 4 ) );
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH - 4, xStreamBufferPeek( xStreamBuffer, &xRegions, 0 ) );
+    prvCheckRegions( &xRegions, 4 );
+
+    /* No more is removed than the buffer holds. */
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH - 4, xStreamBufferConsume( xStreamBuffer, streamBUFFER_SIZE ) );
+    TEST_ASSERT_TRUE( xStreamBufferIsEmpty( xStreamBuffer ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Data that runs past the end of the storage area is peeked as two regions. */
+TEST( Full_STREAM_BUFFER, peek_wraps )
+{
+    StreamBufferRegions_t xRegions;
+
+    prvAdvance( xStreamBuffer, streamDATA_LENGTH );
+    ( void ) xStreamBufferSend( xStreamBuffer, ucData, streamDATA_LENGTH, 0 );
+
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xStreamBufferPeek( xStreamBuffer, &xRegions, 0 ) );
+    TEST_ASSERT_TRUE( xRegions.xLength[ 1 ] > 0 );
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xRegions.xLength[ 0 ] + xRegions.xLength[ 1 ] );
+    prvCheckRegions( &xRegions, 0 );
+
+    ( void ) xStreamBufferConsume( xStreamBuffer, streamDATA_LENGTH );
+    TEST_ASSERT_TRUE( xStreamBufferIsEmpty( xStreamBuffer ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task blocked in peek is woken by the commit, not by the reservation, and
+ * consuming the data frees the space again. */
+TEST( Full_STREAM_BUFFER, commit_wakes_reader )
+{
+    StreamBufferRegions_t xRegions;
+    BaseType_t xResult;
+
+    xResult = xTaskCreate( prvReadingTask,
+                           "SBRead",
+                           streamTASK_STACK_SIZE,
+                           NULL,
+                           streamTEST_PRIORITY + 1,
+                           &xReadingTask );
+    TEST_ASSERT_EQUAL( pdPASS, xResult );
+
+    ( void ) xStreamBufferReserve( xStreamBuffer, streamDATA_LENGTH, &xRegions, 0 );
+    prvWriteRegions( &xRegions, streamDATA_LENGTH );
+    TEST_ASSERT_EQUAL( 0, xBytesPeeked );
+
+    ( void ) xStreamBufferCommit( xStreamBuffer, streamDATA_LENGTH );
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xBytesPeeked );
+    TEST_ASSERT_TRUE( xStreamBufferIsEmpty( xStreamBuffer ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A message built in place is received with the length it was committed
+ * with, which can be shorter than the space reserved. */
+TEST( Full_STREAM_BUFFER, message_reserve_commit )
+{
+    StreamBufferRegions_t xRegions;
+
+    prvAdvance( xMessageBuffer, streamDATA_LENGTH );
+
+    TEST_ASSERT_EQUAL( streamDATA_LENGTH, xMessageBufferReserve( xMessageBuffer, streamDATA_LENGTH, &xRegions, 0 ) );
+    TEST_ASSERT_TRUE( ( xRegions.xLength[ 0 ] + xRegions.xLength[ 1 ] ) >= streamDATA_LENGTH );
+    prvWriteRegions( &xRegions, 10 );
+    TEST_ASSERT_TRUE( xMessageBufferIsEmpty( xMessageBuffer ) );
+    ( void ) xMessageBufferCommit( xMessageBuffer, 10 );
+
+    TEST_ASSERT_EQUAL( 10, xMessageBufferPeek( xMessageBuffer, &xRegions, 0 ) );
+    TEST_ASSERT_EQUAL( 10, xRegions.xLength[ 0 ] + xRegions.xLength[ 1 ] );
+    prvCheckRegions( &xRegions, 0 );
+    TEST_ASSERT_EQUAL( 10, xMessageBufferConsume( xMessageBuffer, 10 ) );
+    TEST_ASSERT_TRUE( xMessageBufferIsEmpty( xMessageBuffer ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A message buffer reserves space for the whole message and its length, or
+ * nothing. */
+TEST( Full_STREAM_BUFFER, message_reserve_all_or_nothing )
+{
+    StreamBufferRegions_t xRegions;
+    size_t xFree;
+
+    ( void ) xMessageBufferSend( xMessageBuffer, ucData, 4, 0 );
+    xFree = xMessageBufferSpaceAvailable( xMessageBuffer );
+
+    TEST_ASSERT_EQUAL( 0, xMessageBufferReserve( xMessageBuffer, xFree, &xRegions, 1 ) );
+    ( void ) xMessageBufferCommit( xMessageBuffer, 0 );
+
+    TEST_ASSERT_EQUAL( xFree - streamMESSAGE_LENGTH_BYTES,
+                       xMessageBufferReserve( xMessageBuffer, xFree - streamMESSAGE_LENGTH_BYTES, &xRegions, 0 ) );
+    ( void ) xMessageBufferCommit( xMessageBuffer, 0 );
+
+    /* The message sent first is still there, and nothing after it. */
+    TEST_ASSERT_EQUAL( 4, xMessageBufferReceive( xMessageBuffer, ucReceived, sizeof( ucReceived ), 0 ) );
+    TEST_ASSERT_TRUE( xMessageBufferIsEmpty( xMessageBuffer ) );
+}
@@ -0,0 +1,232 @@
+/*
+ * Amazon FreeRTOS Kernel Test V1.1.4
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_test_task_profile.c
+ * @brief Tests for the task profiles the kernel keeps with configUSE_TASK_PROFILING.
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Test framework includes. */
+#include "unity_fixture.h"
+#include "unity.h"
+
+/*-----------------------------------------------------------*/
+
+/* Number of times the waiting task is woken in each test. */
+#define profileNUM_WAKES            ( 10UL )
+
+/* Counts of the run time stats clock a woken task is kept from running. */
+#define profileHOLD_OFF_COUNTS      ( 100UL )
+
+/* The test task runs at this priority, so the waiting task can run both above
+ * and below it. */
+#define profileTEST_PRIORITY        ( configMAX_PRIORITIES - 2 )
+
+#define profileTASK_STACK_SIZE      ( configMINIMAL_STACK_SIZE * 2 )
+
+/*-----------------------------------------------------------*/
+
+static UBaseType_t uxOriginalPriority;
+static TaskHandle_t xWaitingTask;
+static volatile uint32_t ulWakes;
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP( Full_TASK_PROFILE );
+
+/*-----------------------------------------------------------*/
+
+TEST_SETUP( Full_TASK_PROFILE )
+{
+    uxOriginalPriority = uxTaskPriorityGet( NULL );
+    vTaskPrioritySet( NULL, profileTEST_PRIORITY );
+    xWaitingTask = NULL;
+    ulWakes = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_TEAR_DOWN( Full_TASK_PROFILE )
+{
+    if( xWaitingTask != NULL )
+    {
+        vTaskDelete( xWaitingTask );
+    }
+
+    vTaskPrioritySet( NULL, uxOriginalPriority );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP_RUNNER( Full_TASK_PROFILE )
+{
+    RUN_TEST_CASE( Full_TASK_PROFILE, switch_and_wake_counts );
+    RUN_TEST_CASE( Full_TASK_PROFILE, wake_latency );
+    RUN_TEST_CASE( Full_TASK_PROFILE, reset_clears_latencies );
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+    static void prvWaitingTask( void * pvParameters )
+    {
+        ( void ) pvParameters;
+
+        for( ; ; )
+        {
+            ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+            ulWakes++;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static uint32_t prvRunTimeCounterValue( void )
+    {
+        uint32_t ulRunTime;
+
+        #ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
+            portALT_GET_RUN_TIME_COUNTER_VALUE( ulRunTime );
+        #else
+            ulRunTime = portGET_RUN_TIME_COUNTER_VALUE();
+        #endif
+
+        return ulRunTime;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvCreateWaitingTask( UBaseType_t uxPriority )
+    {
+        BaseType_t xResult;
+
+        xResult = xTaskCreate( prvWaitingTask,
+                               "ProfWait",
+                               profileTASK_STACK_SIZE,
+                               NULL,
+                               uxPriority,
+                               &xWaitingTask );
+        TEST_ASSERT_EQUAL( pdPASS, xResult );
+
+        /* Let the task block on its notification. */
+        vTaskDelay( 2 );
+    }
+
+#endif /* configUSE_TASK_PROFILING == 1 */
+
+/*-----------------------------------------------------------*/
+
+/* A task of higher priority that is notified runs straight away, once for
+ * each notification. */
+TEST( Full_TASK_PROFILE, switch_and_wake_counts )
+{
+    #if ( configUSE_TASK_PROFILING == 1 )
+        TaskStatus_t xBefore, xAfter;
+        uint32_t ulI;
+
+        prvCreateWaitingTask( profileTEST_PRIORITY + 1 );
+        vTaskResetLatencyStats();
+        vTaskGetInfo( xWaitingTask, &xBefore, pdFALSE, eInvalid );
+
+        for( ulI = 0; ulI < profileNUM_WAKES; ulI++ )
+        {
+            ( void ) xTaskNotifyGive( xWaitingTask );
+        }
+
+        vTaskGetInfo( xWaitingTask, &xAfter, pdFALSE, eInvalid );
+
+        TEST_ASSERT_EQUAL_UINT32( profileNUM_WAKES, ulWakes );
+        TEST_ASSERT_EQUAL_UINT32( profileNUM_WAKES, xAfter.ulSwitchCount - xBefore.ulSwitchCount );
+        TEST_ASSERT_EQUAL_UINT32( profileNUM_WAKES, xAfter.ulWakeCount );
+        TEST_ASSERT_TRUE( xAfter.ulAverageWakeLatency <= xAfter.ulMaxWakeLatency );
+    #else
+        TEST_IGNORE_MESSAGE( "configUSE_TASK_PROFILING is not set to 1." );
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task of lower priority that is notified only runs when the test task
+ * blocks, so its latency includes the time the test task kept running. */
+TEST( Full_TASK_PROFILE, wake_latency )
+{
+    #if ( configUSE_TASK_PROFILING == 1 )
+        TaskStatus_t xStatus;
+        uint32_t ulStart;
+
+        prvCreateWaitingTask( profileTEST_PRIORITY - 1 );
+        vTaskResetLatencyStats();
+
+        /* The task is made ready before the hold off starts. */
+        ( void ) xTaskNotifyGive( xWaitingTask );
+        ulStart = prvRunTimeCounterValue();
+
+        while( ( prvRunTimeCounterValue() - ulStart ) < profileHOLD_OFF_COUNTS )
+        {
+        }
+
+        TEST_ASSERT_EQUAL_UINT32( 0, ulWakes );
+        vTaskDelay( 2 );
+        TEST_ASSERT_EQUAL_UINT32( 1, ulWakes );
+
+        vTaskGetInfo( xWaitingTask, &xStatus, pdFALSE, eInvalid );
+        TEST_ASSERT_EQUAL_UINT32( 1, xStatus.ulWakeCount );
+        TEST_ASSERT_TRUE( xStatus.ulMaxWakeLatency >= profileHOLD_OFF_COUNTS );
+        TEST_ASSERT_EQUAL_UINT32( xStatus.ulMaxWakeLatency, xStatus.ulAverageWakeLatency );
+    #else
+        TEST_IGNORE_MESSAGE( "configUSE_TASK_PROFILING is not set to 1." );
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+/* The latencies of a task are cleared by vTaskResetLatencyStats() even though
+ * the task does not run again, while its switch count is kept. */
+TEST( Full_TASK_PROFILE, reset_clears_latencies )
+{
+    #if ( configUSE_TASK_PROFILING == 1 )
+        TaskStatus_t xStatus;
+
+        prvCreateWaitingTask( profileTEST_PRIORITY + 1 );
+        ( void ) xTaskNotifyGive( xWaitingTask );
+
+        vTaskGetInfo( xWaitingTask, &xStatus, pdFALSE, eInvalid );
+        TEST_ASSERT_TRUE( xStatus.ulWakeCount > 0 );
+
+        vTaskResetLatencyStats();
+        vTaskGetInfo( xWaitingTask, &xStatus, pdFALSE, eInvalid );
+        TEST_ASSERT_EQUAL_UINT32( 0, xStatus.ulWakeCount );
+        TEST_ASSERT_EQUAL_UINT32( 0, xStatus.ulMaxWakeLatency );
+        TEST_ASSERT_EQUAL_UINT32( 0, xStatus.ulAverageWakeLatency );
+        TEST_ASSERT_EQUAL_UINT32( 2, xStatus.ulSwitchCount );
+    #else
+        TEST_IGNORE_MESSAGE( "configUSE_TASK_PROFILING is not set to 1." );
+    #endif
+}
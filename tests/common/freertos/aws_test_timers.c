@@ -0,0 +1,245 @@
+/*
+ * Amazon FreeRTOS Kernel Test V1.1.4
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_test_timers.c
+ * @brief Tests for when software timers expire, with either the timer lists or
+ * the timer wheel (configUSE_TIMER_WHEEL).
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+/* Test framework includes. */
+#include "unity_fixture.h"
+#include "unity.h"
+
+/*-----------------------------------------------------------*/
+
+/* Period of the shortest timer in each test. */
+#define timersPERIOD                ( ( TickType_t ) 10 )
+
+/* Number of timers started by the ordering test. */
+#define timersNUM_TIMERS            ( 3 )
+
+/* Number of expiries recorded for a single test. */
+#define timersMAX_EXPIRIES          ( 5 )
+
+/* Time the test task waits for an expiry before giving up. */
+#define timersWAIT_TICKS            ( timersPERIOD * ( TickType_t ) 10 )
+
+/*-----------------------------------------------------------*/
+
+static TaskHandle_t xTestTask;
+static TimerHandle_t xTimers[ timersNUM_TIMERS ];
+static volatile TickType_t xExpiryTicks[ timersMAX_EXPIRIES ];
+static volatile UBaseType_t uxExpiryIds[ timersMAX_EXPIRIES ];
+static volatile UBaseType_t uxExpiries;
+
+/*-----------------------------------------------------------*/
+
+static void prvTimerCallback( TimerHandle_t xTimer )
+{
+    if( uxExpiries < timersMAX_EXPIRIES )
+    {
+        xExpiryTicks[ uxExpiries ] = xTaskGetTickCount();
+        uxExpiryIds[ uxExpiries ] = ( UBaseType_t ) pvTimerGetTimerID( xTimer );
+    }
+
+    uxExpiries++;
+    ( void ) xTaskNotifyGive( xTestTask );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCreateTimer( UBaseType_t uxIndex,
+                            TickType_t xPeriod,
+                            UBaseType_t uxAutoReload )
+{
+    xTimers[ uxIndex ] = xTimerCreate( "TestTmr",
+                                       xPeriod,
+                                       uxAutoReload,
+                                       ( void * ) uxIndex,
+                                       prvTimerCallback );
+    TEST_ASSERT_NOT_NULL( xTimers[ uxIndex ] );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Waits for the callback to have run uxCount times in all. */
+static void prvWaitForExpiries( UBaseType_t uxCount )
+{
+    while( uxExpiries < uxCount )
+    {
+        TEST_ASSERT_NOT_EQUAL( 0, ulTaskNotifyTake( pdFALSE, timersWAIT_TICKS ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP( Full_TIMERS );
+
+/*-----------------------------------------------------------*/
+
+TEST_SETUP( Full_TIMERS )
+{
+    UBaseType_t ux;
+
+    xTestTask = xTaskGetCurrentTaskHandle();
+    uxExpiries = 0;
+
+    for( ux = 0; ux < timersNUM_TIMERS; ux++ )
+    {
+        xTimers[ ux ] = NULL;
+    }
+
+    /* Discard notifications left by an earlier test. */
+    ( void ) ulTaskNotifyTake( pdTRUE, 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_TEAR_DOWN( Full_TIMERS )
+{
+    UBaseType_t ux;
+
+    for( ux = 0; ux < timersNUM_TIMERS; ux++ )
+    {
+        if( xTimers[ ux ] != NULL )
+        {
+            ( void ) xTimerDelete( xTimers[ ux ], portMAX_DELAY );
+        }
+    }
+
+    /* Let the timer service task free the timers. */
+    vTaskDelay( 2 );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST_GROUP_RUNNER( Full_TIMERS )
+{
+    RUN_TEST_CASE( Full_TIMERS, one_shot_period );
+    RUN_TEST_CASE( Full_TIMERS, auto_reload_period );
+    RUN_TEST_CASE( Full_TIMERS, expiry_order );
+    RUN_TEST_CASE( Full_TIMERS, start_after_long_idle );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A one shot timer expires once, a period after the tick it was started on.
+ * The tick can move on between reading it here and starting the timer. */
+TEST( Full_TIMERS, one_shot_period )
+{
+    TickType_t xStart;
+
+    prvCreateTimer( 0, timersPERIOD, pdFALSE );
+
+    xStart = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL( pdPASS, xTimerStart( xTimers[ 0 ], portMAX_DELAY ) );
+    prvWaitForExpiries( 1 );
+
+    TEST_ASSERT_TRUE( ( TickType_t ) ( xExpiryTicks[ 0 ] - xStart ) >= timersPERIOD );
+    TEST_ASSERT_TRUE( ( TickType_t ) ( xExpiryTicks[ 0 ] - xStart ) <= timersPERIOD + 1 );
+
+    /* It does not expire again. */
+    vTaskDelay( timersPERIOD * 2 );
+    TEST_ASSERT_EQUAL( 1, uxExpiries );
+}
+
+/*-----------------------------------------------------------*/
+
+/* An auto reload timer expires exactly a period after its last expiry. */
+TEST( Full_TIMERS, auto_reload_period )
+{
+    UBaseType_t ux;
+
+    prvCreateTimer( 0, timersPERIOD, pdTRUE );
+
+    TEST_ASSERT_EQUAL( pdPASS, xTimerStart( xTimers[ 0 ], portMAX_DELAY ) );
+    prvWaitForExpiries( timersMAX_EXPIRIES );
+    TEST_ASSERT_EQUAL( pdPASS, xTimerStop( xTimers[ 0 ], portMAX_DELAY ) );
+
+    for( ux = 1; ux < timersMAX_EXPIRIES; ux++ )
+    {
+        TEST_ASSERT_EQUAL( timersPERIOD, ( TickType_t ) ( xExpiryTicks[ ux ] - xExpiryTicks[ ux - 1 ] ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Timers started together expire in the order of their periods, whatever
+ * the order they were started in. */
+TEST( Full_TIMERS, expiry_order )
+{
+    prvCreateTimer( 0, timersPERIOD * 3, pdFALSE );
+    prvCreateTimer( 1, timersPERIOD, pdFALSE );
+    prvCreateTimer( 2, timersPERIOD * 2, pdFALSE );
+
+    TEST_ASSERT_EQUAL( pdPASS, xTimerStart( xTimers[ 0 ], portMAX_DELAY ) );
+    TEST_ASSERT_EQUAL( pdPASS, xTimerStart( xTimers[ 1 ], portMAX_DELAY ) );
+    TEST_ASSERT_EQUAL( pdPASS, xTimerStart( xTimers[ 2 ], portMAX_DELAY ) );
+    prvWaitForExpiries( timersNUM_TIMERS );
+
+    TEST_ASSERT_EQUAL( 1, uxExpiryIds[ 0 ] );
+    TEST_ASSERT_EQUAL( 2, uxExpiryIds[ 1 ] );
+    TEST_ASSERT_EQUAL( 0, uxExpiryIds[ 2 ] );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A timer started after nothing has been due for longer than the range of the
+ * tick count still waits for its full period.  The timer wheel used to measure
+ * the expiry time from the tick it last processed, so once the idle time and
+ * the period added up to more than the range the new timer expired at once.
+ * Idling for the whole range is only practical with 16 bit ticks, where it
+ * takes a little over a minute at a 1 kHz tick. */
+TEST( Full_TIMERS, start_after_long_idle )
+{
+    #if ( configUSE_16_BIT_TICKS == 1 )
+        TickType_t xStart;
+
+        prvCreateTimer( 0, timersPERIOD, pdFALSE );
+        prvCreateTimer( 1, timersPERIOD * 2, pdFALSE );
+
+        /* Have the timer service task process one expiry, then leave it with
+         * no active timers. */
+        TEST_ASSERT_EQUAL( pdPASS, xTimerStart( xTimers[ 0 ], portMAX_DELAY ) );
+        prvWaitForExpiries( 1 );
+
+        vTaskDelay( portMAX_DELAY - timersPERIOD );
+
+        xStart = xTaskGetTickCount();
+        TEST_ASSERT_EQUAL( pdPASS, xTimerStart( xTimers[ 1 ], portMAX_DELAY ) );
+        prvWaitForExpiries( 2 );
+
+        TEST_ASSERT_TRUE( ( TickType_t ) ( xExpiryTicks[ 1 ] - xStart ) >= timersPERIOD * 2 );
+        TEST_ASSERT_TRUE( ( TickType_t ) ( xExpiryTicks[ 1 ] - xStart ) <= ( timersPERIOD * 2 ) + 1 );
+    #else
+        TEST_IGNORE_MESSAGE( "configUSE_16_BIT_TICKS is not set to 1." );
+    #endif
+}
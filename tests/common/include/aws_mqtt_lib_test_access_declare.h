@@ -50,6 +50,22 @@
 
 #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
 
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    MQTTBool_t Test_prvStoreSubscription( MQTTContext_t * pxMQTTContext,
+                                          const uint8_t * const pucTopicFilter,
+                                          uint16_t usTopicFilterLength );
+
+    void Test_prvRemoveSubscription( MQTTContext_t * pxMQTTContext,
+                                     const uint8_t * const pucTopicFilter,
+                                     uint16_t usTopicFilterLength );
+
+    MQTTBool_t Test_prvIsTopicSubscribed( MQTTContext_t * pxMQTTContext,
+                                          const uint8_t * const pucTopic,
+                                          uint16_t usTopicLength );
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+
 void Test_prvResetMQTTContext( MQTTContext_t * pxMQTTContext );
 
 #endif /* _AWS_MQTT_LIB_TEST_ACCESS_DEFINE_H_ */
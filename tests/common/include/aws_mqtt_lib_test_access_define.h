@@ -48,12 +48,73 @@
 
 #if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
 
+    static MQTTBool_t prvTestAccessPublishCallback( void * pvPublishCallbackContext,
+                                                    const MQTTPublishData_t * const pxPublishData )
+    {
+        ( void ) pvPublishCallbackContext;
+        ( void ) pxPublishData;
+
+        return eMQTTFalse;
+    }
+
     MQTTBool_t Test_prvDoesTopicMatchTopicFilter( const uint8_t * const pucTopic,
                                                   uint16_t usTopicLength,
                                                   const uint8_t * const pucTopicFilter,
                                                   uint16_t usTopicFilterLength )
     {
-        return prvDoesTopicMatchTopicFilter( pucTopic, usTopicLength, pucTopicFilter, usTopicFilterLength );
+        static MQTTContext_t xMatchContext;
+        MQTTPublishData_t xPublishData;
+        MQTTBool_t xSubscriptionCallbackInvoked = eMQTTFalse;
+
+        /* Match through the subscription tree used for the received
+         * publish messages with only the given topic filter stored. */
+        prvInitSubscriptionManager( &( xMatchContext.xSubscriptionManager ) );
+
+        if( prvStoreSubscription( &( xMatchContext ), pucTopicFilter, usTopicFilterLength, NULL, prvTestAccessPublishCallback ) == eMQTTTrue )
+        {
+            memset( &( xPublishData ), 0x00, sizeof( MQTTPublishData_t ) );
+            xPublishData.pucTopic = pucTopic;
+            xPublishData.usTopicLength = usTopicLength;
+
+            ( void ) prvInvokeSubscriptionCallbacks( &( xMatchContext ), &( xPublishData ), &( xSubscriptionCallbackInvoked ) );
+        }
+
+        return xSubscriptionCallbackInvoked;
+    }
+
+#endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
+/*-----------------------------------------------------------*/
+
+#if ( mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT == 1 )
+
+    MQTTBool_t Test_prvStoreSubscription( MQTTContext_t * pxMQTTContext,
+                                          const uint8_t * const pucTopicFilter,
+                                          uint16_t usTopicFilterLength )
+    {
+        return prvStoreSubscription( pxMQTTContext, pucTopicFilter, usTopicFilterLength, NULL, prvTestAccessPublishCallback );
+    }
+
+    void Test_prvRemoveSubscription( MQTTContext_t * pxMQTTContext,
+                                     const uint8_t * const pucTopicFilter,
+                                     uint16_t usTopicFilterLength )
+    {
+        prvRemoveSubscription( pxMQTTContext, pucTopicFilter, usTopicFilterLength );
+    }
+
+    MQTTBool_t Test_prvIsTopicSubscribed( MQTTContext_t * pxMQTTContext,
+                                          const uint8_t * const pucTopic,
+                                          uint16_t usTopicLength )
+    {
+        MQTTPublishData_t xPublishData;
+        MQTTBool_t xSubscriptionCallbackInvoked = eMQTTFalse;
+
+        memset( &( xPublishData ), 0x00, sizeof( MQTTPublishData_t ) );
+        xPublishData.pucTopic = pucTopic;
+        xPublishData.usTopicLength = usTopicLength;
+
+        ( void ) prvInvokeSubscriptionCallbacks( pxMQTTContext, &( xPublishData ), &( xSubscriptionCallbackInvoked ) );
+
+        return xSubscriptionCallbackInvoked;
     }
 
 #endif /* mqttconfigENABLE_SUBSCRIPTION_MANAGEMENT */
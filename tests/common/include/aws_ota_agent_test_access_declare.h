@@ -51,4 +51,10 @@ DocParseErr_t TEST_OTA_prvParseJSONbyModel( const char * pcJSON,
                                             uint32_t ulMsgLen,
                                             JSON_DocModel_t * pxDocModel );
 
+DocParseErr_t TEST_OTA_prvInitDocModel( JSON_DocModel_t * pxDocModel,
+                                        const JSON_DocParam_t * pxBodyDef,
+                                        size_t xContextBaseAddr,
+                                        uint32_t ulContextSize,
+                                        uint16_t usNumJobParams );
+
 #endif /* ifndef _AWS_OTA_AGENT_TEST_ACCESS_DECLARE_H_ */
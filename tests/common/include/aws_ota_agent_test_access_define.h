@@ -40,7 +40,7 @@ IngestResult_t TEST_OTA_prvIngestDataBlock( OTA_FileContext_t * C,
                                             u32 iMsgSize,
                                             OTA_Err_t * pxCloseResult )
 {
-    return prvIngestDataBlock( C, pacRawMsg, iMsgSize, pxCloseResult );
+    return prvCloseReceivedFile( C, prvIngestDataBlock( C, pacRawMsg, iMsgSize, pxCloseResult ), pxCloseResult );
 }
 
 
@@ -68,4 +68,15 @@ DocParseErr_t TEST_OTA_prvParseJSONbyModel( const char * pcJSON,
     return prvParseJSONbyModel( pcJSON, ulMsgLen, pxDocModel );
 }
 
+/*-----------------------------------------------------------*/
+
+DocParseErr_t TEST_OTA_prvInitDocModel( JSON_DocModel_t * pxDocModel,
+                                        const JSON_DocParam_t * pxBodyDef,
+                                        size_t xContextBaseAddr,
+                                        uint32_t ulContextSize,
+                                        uint16_t usNumJobParams )
+{
+    return prvInitDocModel( pxDocModel, pxBodyDef, xContextBaseAddr, ulContextSize, usNumJobParams );
+}
+
 #endif /* _AWS_OTA_AGENT_TEST_ACCESS_DEFINE_H_ */
@@ -36,6 +36,8 @@
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include "aws_mqtt_agent.h"
+#include "aws_mqtt_agent_config.h"
+#include "aws_mqtt_agent_config_defaults.h"
 #include "task.h"
 #include "queue.h"
 #include "event_groups.h"
@@ -122,6 +124,15 @@
 #define mqttagenttestMULTI_TASK_TEST_MAX_TOPIC_NAME_SIZE       ( 30 )
 
 
+/* Number of messages published with each API by the throughput test. */
+#ifndef mqttagenttestTHROUGHPUT_TEST_NUM_MESSAGES
+    #define mqttagenttestTHROUGHPUT_TEST_NUM_MESSAGES    ( 50 )
+#endif
+
+/* Topic name for throughput testing. */
+#define mqttagenttestTHROUGHPUT_TEST_TOPIC_NAME    ( ( const uint8_t * ) "freertos/tests/throughput" )
+
+
 /* Default connection parameters. */
 static const MQTTAgentConnectParams_t xDefaultConnectParameters =
 {
@@ -224,6 +235,26 @@ static MQTTBool_t prvMQTTCallback( void * pvUserData,
     return eMQTTFalse;
 }
 
+/**
+ * @brief Completion callback for asynchronous publishes.
+ */
+static void prvPublishCompleteCallback( void * pvCallbackContext,
+                                        const MQTTAgentPublishParams_t * const pxPublishParams,
+                                        MQTTAgentReturnCode_t xResult )
+{
+    MQTTtestAgentCbParam_t * pxMQTTtestAgentCbParam = ( MQTTtestAgentCbParam_t * ) pvCallbackContext;
+
+    ( void ) pxPublishParams;
+
+    if( xResult != eMQTTAgentSuccess )
+    {
+        pxMQTTtestAgentCbParam->xStatus = pdFAIL;
+    }
+
+    /* Give the semaphore to signal completion. */
+    xSemaphoreGive( pxMQTTtestAgentCbParam->xSemaphore );
+}
+
 /*-----------------------------------------------------------*/
 
 
@@ -371,6 +402,7 @@ TEST_GROUP_RUNNER( Full_MQTT_Agent )
 TEST_GROUP_RUNNER( Full_MQTT_Agent_Stress_Tests )
 {
     RUN_TEST_CASE( Full_MQTT_Agent_Stress_Tests, MQTT_Agent_MultiTaskTest );
+    RUN_TEST_CASE( Full_MQTT_Agent_Stress_Tests, MQTT_Agent_PublishAsyncThroughput );
 }
 TEST_GROUP_RUNNER( Full_MQTT_Agent_ALPN )
 {
@@ -449,6 +481,114 @@ TEST( Full_MQTT_Agent_ALPN, MQTT_Agent_SubscribePublishAlpn )
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Publish throughput test.
+ *
+ * Publishes the same number of QoS1 messages with the blocking MQTT_AGENT_Publish
+ * and with MQTT_AGENT_PublishAsync and prints the messages per second achieved by
+ * each. The blocking API is bound by one round trip per message, so its per message
+ * time is also printed as the round trip time of the connection. The asynchronous
+ * API keeps up to mqttconfigMAX_INFLIGHT_PUBLISHES messages in-flight.
+ */
+TEST( Full_MQTT_Agent_Stress_Tests, MQTT_Agent_PublishAsyncThroughput )
+{
+    MQTTAgentReturnCode_t xReturned;
+    MQTTAgentHandle_t xMQTTHandle = NULL;
+    BaseType_t xMQTTAgentCreated = pdFALSE, xMQTTAgentConnected = pdFALSE;
+    MQTTAgentConnectParams_t xConnectParameters;
+    MQTTAgentPublishParams_t xPublishParameters;
+    MQTTtestAgentCbParam_t xCbParam;
+    StaticSemaphore_t xSemaphoreBuffer;
+    TickType_t xStartTicks, xBlockingTicks, xAsyncTicks;
+    uint32_t ulIndex;
+
+    memcpy( &xConnectParameters, &xDefaultConnectParameters, sizeof( MQTTAgentConnectParams_t ) );
+    xConnectParameters.usClientIdLength = ( uint16_t ) strlen( ( char * ) xConnectParameters.pucClientId );
+
+    /* Counts the completed asynchronous publishes. */
+    xCbParam.xSemaphore = xSemaphoreCreateCountingStatic( mqttagenttestTHROUGHPUT_TEST_NUM_MESSAGES, 0, &xSemaphoreBuffer );
+    xCbParam.xStatus = pdPASS;
+    TEST_ASSERT_NOT_NULL( xCbParam.xSemaphore );
+
+    /* Setup the publish parameters. They must stay valid until all the
+     * asynchronous publishes have completed. */
+    memset( &( xPublishParameters ), 0x00, sizeof( xPublishParameters ) );
+    xPublishParameters.pucTopic = mqttagenttestTHROUGHPUT_TEST_TOPIC_NAME;
+    xPublishParameters.usTopicLength = ( uint16_t ) strlen( ( const char * ) mqttagenttestTHROUGHPUT_TEST_TOPIC_NAME );
+    xPublishParameters.pvData = mqttagenttestMESSAGE;
+    xPublishParameters.ulDataLength = ( uint32_t ) strlen( mqttagenttestMESSAGE );
+    xPublishParameters.xQoS = eMQTTQoS1;
+
+    if( TEST_PROTECT() )
+    {
+        xReturned = MQTT_AGENT_Create( &xMQTTHandle );
+        TEST_ASSERT_EQUAL_INT( eMQTTAgentSuccess, xReturned );
+        xMQTTAgentCreated = pdTRUE;
+
+        xReturned = MQTT_AGENT_Connect( xMQTTHandle, &xConnectParameters, mqttagenttestTIMEOUT );
+        TEST_ASSERT_EQUAL_INT( eMQTTAgentSuccess, xReturned );
+        xMQTTAgentConnected = pdTRUE;
+
+        /* One round trip per message. */
+        xStartTicks = xTaskGetTickCount();
+
+        for( ulIndex = 0; ulIndex < mqttagenttestTHROUGHPUT_TEST_NUM_MESSAGES; ulIndex++ )
+        {
+            xReturned = MQTT_AGENT_Publish( xMQTTHandle, &( xPublishParameters ), mqttagenttestTIMEOUT );
+            TEST_ASSERT_EQUAL_INT( eMQTTAgentSuccess, xReturned );
+        }
+
+        xBlockingTicks = xTaskGetTickCount() - xStartTicks;
+
+        /* Keep the window full. */
+        xStartTicks = xTaskGetTickCount();
+
+        for( ulIndex = 0; ulIndex < mqttagenttestTHROUGHPUT_TEST_NUM_MESSAGES; ulIndex++ )
+        {
+            xReturned = MQTT_AGENT_PublishAsync( xMQTTHandle,
+                                                 &( xPublishParameters ),
+                                                 prvPublishCompleteCallback,
+                                                 &( xCbParam ),
+                                                 mqttagenttestTIMEOUT );
+            TEST_ASSERT_EQUAL_INT( eMQTTAgentSuccess, xReturned );
+        }
+
+        for( ulIndex = 0; ulIndex < mqttagenttestTHROUGHPUT_TEST_NUM_MESSAGES; ulIndex++ )
+        {
+            if( xSemaphoreTake( xCbParam.xSemaphore, mqttagenttestTIMEOUT ) == pdFALSE )
+            {
+                TEST_FAIL_MESSAGE( "Timed out waiting for asynchronous publish completion." );
+            }
+        }
+
+        xAsyncTicks = xTaskGetTickCount() - xStartTicks;
+        TEST_ASSERT_EQUAL_INT( pdPASS, xCbParam.xStatus );
+
+        /* Avoid dividing by zero on very fast links. */
+        xBlockingTicks = configMAX( xBlockingTicks, ( TickType_t ) 1 );
+        xAsyncTicks = configMAX( xAsyncTicks, ( TickType_t ) 1 );
+
+        configPRINTF( ( "MQTT publish throughput: blocking %u msg/s (RTT %u ms), window of %u %u msg/s.\r\n",
+                        ( unsigned int ) ( ( mqttagenttestTHROUGHPUT_TEST_NUM_MESSAGES * configTICK_RATE_HZ ) / xBlockingTicks ),
+                        ( unsigned int ) ( ( xBlockingTicks * portTICK_PERIOD_MS ) / mqttagenttestTHROUGHPUT_TEST_NUM_MESSAGES ),
+                        ( unsigned int ) mqttconfigMAX_INFLIGHT_PUBLISHES,
+                        ( unsigned int ) ( ( mqttagenttestTHROUGHPUT_TEST_NUM_MESSAGES * configTICK_RATE_HZ ) / xAsyncTicks ) ) );
+    }
+
+    if( xMQTTAgentConnected == pdTRUE )
+    {
+        ( void ) MQTT_AGENT_Disconnect( xMQTTHandle, mqttagenttestTIMEOUT );
+    }
+
+    if( xMQTTAgentCreated == pdTRUE )
+    {
+        ( void ) MQTT_AGENT_Delete( xMQTTHandle );
+    }
+
+    vSemaphoreDelete( xCbParam.xSemaphore );
+}
+/*-----------------------------------------------------------*/
+
 /**
  * @brief multitask test for MQTT
  *
@@ -29,6 +29,7 @@
  */
 
 /* Standard includes. */
+#include <stdio.h>
 #include <string.h>
 
 /* Unity framework includes. */
@@ -103,6 +104,16 @@ static MQTTContext_t xMQTTContext;
  * @brief Callback counter used by all the tests.
  */
 static CallbackCounter_t xCallbackCounter;
+
+/**
+ * @brief Number of times the send callback is invoked.
+ */
+static uint32_t ulSendCount;
+
+/**
+ * @brief Tick count returned by prvGetTicksCallback.
+ */
+static uint64_t xTestTickCount;
 /*-----------------------------------------------------------*/
 
 /**
@@ -158,6 +169,13 @@ static uint32_t prvSendFailedCallback( void * pvSendContext,
                                        const uint8_t * const pucData,
                                        uint32_t ulDataLength );
 
+/**
+ * @brief The get ticks callback for the tests which need the time to advance.
+ *
+ * @param[out] pxCurrentTickCount Set to xTestTickCount.
+ */
+static void prvGetTicksCallback( uint64_t * pxCurrentTickCount );
+
 /**
  * @brief Initializes the global callback counter object.
  */
@@ -232,11 +250,19 @@ static uint32_t prvSendCallback( void * pvSendContext,
     /* Ensure that the correct context was supplied by the library. */
     TEST_ASSERT_EQUAL( pvSendContext, testmqttlibSEND_CONTEXT );
 
+    ulSendCount++;
+
     /* Mimic that everything was sent successfully. */
     return ulDataLength;
 }
 /*-----------------------------------------------------------*/
 
+static void prvGetTicksCallback( uint64_t * pxCurrentTickCount )
+{
+    *pxCurrentTickCount = xTestTickCount;
+}
+/*-----------------------------------------------------------*/
+
 static uint32_t prvSendFailedCallback( void * pvSendContext,
                                        const uint8_t * const pucData,
                                        uint32_t ulDataLength )
@@ -294,6 +320,7 @@ static MQTTReturnCode_t prvSendMQTTConnect( void )
     xConnectParams.usKeepAliveIntervalSeconds = mqttconfigKEEP_ALIVE_INTERVAL_SECONDS;
     xConnectParams.ulKeepAliveActualIntervalTicks = mqttconfigKEEP_ALIVE_ACTUAL_INTERVAL_TICKS;
     xConnectParams.ulPingRequestTimeoutTicks = mqttconfigKEEP_ALIVE_TIMEOUT_TICKS;
+    xConnectParams.ulKeepAliveMaxIdleTicks = 0;
     xConnectParams.ulTimeoutTicks = testmqttlibOPERATION_TIMEOUT_TICKS;
 
     /* Send MQTT Connect. */
@@ -365,6 +392,7 @@ TEST_GROUP_RUNNER( Full_MQTT )
 
     RUN_TEST_CASE( Full_MQTT, AFQP_prvDoesTopicMatchTopicFilter_MatchCases );
     RUN_TEST_CASE( Full_MQTT, AFQP_prvDoesTopicMatchTopicFilter_NotMatchCases );
+    RUN_TEST_CASE( Full_MQTT, AFQP_SubscriptionManager_ManyLiteralLevels );
 
     /* MQTT_Init tests. */
     RUN_TEST_CASE( Full_MQTT, AFQP_MQTT_Init_HappyCase );
@@ -381,6 +409,9 @@ TEST_GROUP_RUNNER( Full_MQTT )
     RUN_TEST_CASE( Full_MQTT, AFQP_MQTT_Connect_SecondConnectWhileAlreadyConnected );
     RUN_TEST_CASE( Full_MQTT, AFQP_MQTT_Connect_SecondConnectWhileWaitingForConnACK );
     RUN_TEST_CASE( Full_MQTT, AFQP_MQTT_Connect_NetworkSendFailed );
+
+    /* MQTT_Periodic tests. */
+    RUN_TEST_CASE( Full_MQTT, AFQP_MQTT_Periodic_KeepAliveDeferredByReceivedData );
 }
 /*-----------------------------------------------------------*/
 
@@ -609,6 +640,20 @@ TEST( Full_MQTT, AFQP_prvDoesTopicMatchTopicFilter_MatchCases )
                                                                   ( const uint8_t * ) "aws/+/shadow/#",
                                                                   ( uint16_t ) strlen( "aws/+/shadow/#" ) );
     TEST_ASSERT_EQUAL( eMQTTTrue, xTopicMatchesTopicFilter );
+
+    /* '#' following '+' also includes the parent level. */
+    xTopicMatchesTopicFilter = Test_prvDoesTopicMatchTopicFilter( ( const uint8_t * ) "aws/iot",
+                                                                  ( uint16_t ) strlen( "aws/iot" ),
+                                                                  ( const uint8_t * ) "aws/+/#",
+                                                                  ( uint16_t ) strlen( "aws/+/#" ) );
+    TEST_ASSERT_EQUAL( eMQTTTrue, xTopicMatchesTopicFilter );
+
+    /* '#' following '+' matches an empty last level. */
+    xTopicMatchesTopicFilter = Test_prvDoesTopicMatchTopicFilter( ( const uint8_t * ) "aws/",
+                                                                  ( uint16_t ) strlen( "aws/" ),
+                                                                  ( const uint8_t * ) "+/#",
+                                                                  ( uint16_t ) strlen( "+/#" ) );
+    TEST_ASSERT_EQUAL( eMQTTTrue, xTopicMatchesTopicFilter );
 }
 /*-----------------------------------------------------------*/
 
@@ -698,6 +743,64 @@ TEST( Full_MQTT, AFQP_prvDoesTopicMatchTopicFilter_NotMatchCases )
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Stores topic filters whose literal levels share a parent or share a
+ * name, then removes some of them and stores new ones.
+ */
+TEST( Full_MQTT, AFQP_SubscriptionManager_ManyLiteralLevels )
+{
+    char cTopic[ 32 ];
+    uint32_t x;
+
+    /* "things/thing<x>/update" for every x. The "thing<x>" levels share a
+     * parent while the "update" levels share a name. */
+    for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
+    {
+        ( void ) snprintf( cTopic, sizeof( cTopic ), "things/thing%u/update", ( unsigned int ) x );
+        TEST_ASSERT_EQUAL( eMQTTTrue, Test_prvStoreSubscription( &( xMQTTContext ), ( const uint8_t * ) cTopic, ( uint16_t ) strlen( cTopic ) ) );
+    }
+
+    for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
+    {
+        ( void ) snprintf( cTopic, sizeof( cTopic ), "things/thing%u/update", ( unsigned int ) x );
+        TEST_ASSERT_EQUAL( eMQTTTrue, Test_prvIsTopicSubscribed( &( xMQTTContext ), ( const uint8_t * ) cTopic, ( uint16_t ) strlen( cTopic ) ) );
+
+        ( void ) snprintf( cTopic, sizeof( cTopic ), "things/thing%u", ( unsigned int ) x );
+        TEST_ASSERT_EQUAL( eMQTTFalse, Test_prvIsTopicSubscribed( &( xMQTTContext ), ( const uint8_t * ) cTopic, ( uint16_t ) strlen( cTopic ) ) );
+    }
+
+    ( void ) snprintf( cTopic, sizeof( cTopic ), "things/thing%u/update", ( unsigned int ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS );
+    TEST_ASSERT_EQUAL( eMQTTFalse, Test_prvIsTopicSubscribed( &( xMQTTContext ), ( const uint8_t * ) cTopic, ( uint16_t ) strlen( cTopic ) ) );
+
+    /* Remove every other one. */
+    for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x += 2 )
+    {
+        ( void ) snprintf( cTopic, sizeof( cTopic ), "things/thing%u/update", ( unsigned int ) x );
+        Test_prvRemoveSubscription( &( xMQTTContext ), ( const uint8_t * ) cTopic, ( uint16_t ) strlen( cTopic ) );
+    }
+
+    for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
+    {
+        ( void ) snprintf( cTopic, sizeof( cTopic ), "things/thing%u/update", ( unsigned int ) x );
+        TEST_ASSERT_EQUAL( ( ( x % 2 ) == 0 ) ? eMQTTFalse : eMQTTTrue,
+                           Test_prvIsTopicSubscribed( &( xMQTTContext ), ( const uint8_t * ) cTopic, ( uint16_t ) strlen( cTopic ) ) );
+    }
+
+    /* Use the freed entries for new topic filters. */
+    for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x += 2 )
+    {
+        ( void ) snprintf( cTopic, sizeof( cTopic ), "things/device%u/update", ( unsigned int ) x );
+        TEST_ASSERT_EQUAL( eMQTTTrue, Test_prvStoreSubscription( &( xMQTTContext ), ( const uint8_t * ) cTopic, ( uint16_t ) strlen( cTopic ) ) );
+    }
+
+    for( x = 0; x < ( uint32_t ) mqttconfigSUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; x++ )
+    {
+        ( void ) snprintf( cTopic, sizeof( cTopic ), "things/%s%u/update", ( ( x % 2 ) == 0 ) ? "device" : "thing", ( unsigned int ) x );
+        TEST_ASSERT_EQUAL( eMQTTTrue, Test_prvIsTopicSubscribed( &( xMQTTContext ), ( const uint8_t * ) cTopic, ( uint16_t ) strlen( cTopic ) ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
 /**
  * @brief MQTT context initialization happy case.
  */
@@ -1075,3 +1178,49 @@ TEST( Full_MQTT, AFQP_MQTT_Connect_NetworkSendFailed )
     TEST_ASSERT_EQUAL( 0, xCallbackCounter.ulUnidentified );
 }
 /*-----------------------------------------------------------*/
+
+/**
+ * @brief MQTT periodic - Received data defers the keep alive message up to
+ * the maximum idle time.
+ */
+TEST( Full_MQTT, AFQP_MQTT_Periodic_KeepAliveDeferredByReceivedData )
+{
+    uint32_t x, ulInterval, ulSendCountBeforeIdle;
+    static const uint8_t ucPingRespMessage[] =
+    {
+        0xD0, /* Fixed header control packet type - PINGRESP. */
+        0     /* Fixed header remaining length - always 0 for PINGRESP. */
+    };
+
+    /* Let the time advance. Zero would mean no get ticks function. */
+    xTestTickCount = 1;
+    xMQTTContext.pxGetTicksFxn = prvGetTicksCallback;
+
+    /* Connect. */
+    TEST_ASSERT_EQUAL( eMQTTSuccess, prvSendMQTTConnect() );
+    TEST_ASSERT_EQUAL( eMQTTSuccess, prvReceiveMQTTConnACK() );
+    TEST_ASSERT_EQUAL( eMQTTConnected, xMQTTContext.xConnectionState );
+
+    ulInterval = xMQTTContext.ulKeepAliveActualIntervalTicks;
+    xMQTTContext.ulKeepAliveMaxIdleTicks = ulInterval * 3U;
+    ulSendCountBeforeIdle = ulSendCount;
+
+    /* Receive something just before each keep alive interval ends. Nothing
+     * must be sent until nothing has been sent for the maximum idle time. */
+    for( x = 0; ( uint64_t ) ( x * ( ulInterval - 1U ) ) < ( uint64_t ) ( ulInterval * 3U ); x++ )
+    {
+        TEST_ASSERT_EQUAL( ulSendCountBeforeIdle, ulSendCount );
+
+        xTestTickCount += ulInterval - 1U;
+        TEST_ASSERT_EQUAL( eMQTTSuccess, MQTT_ParseReceivedData( &( xMQTTContext ), ucPingRespMessage, sizeof( ucPingRespMessage ) ) );
+        ( void ) MQTT_Periodic( &( xMQTTContext ), xTestTickCount );
+    }
+
+    /* The keep alive message must have been sent once. */
+    TEST_ASSERT_EQUAL( ulSendCountBeforeIdle + 1U, ulSendCount );
+    TEST_ASSERT_EQUAL( eMQTTTrue, xMQTTContext.xWaitingForPingResp );
+
+    /* No other callback must have been invoked. */
+    TEST_ASSERT_EQUAL( 0, xCallbackCounter.ulUnidentified );
+}
+/*-----------------------------------------------------------*/
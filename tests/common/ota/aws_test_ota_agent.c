@@ -37,6 +37,10 @@
 #include "aws_ota_agent.h"
 #include "aws_clientcredential.h"
 #include "aws_ota_agent_internal.h"
+#include "aws_ota_agent_config_defaults.h"
+#include "aws_ota_decompress.h"
+#include "aws_ota_delta.h"
+#include "aws_ota_write_behind.h"
 
 /* MQTT includes. */
 #include "aws_mqtt_agent.h"
@@ -176,6 +180,16 @@ TEST_GROUP_RUNNER( Full_OTA_AGENT )
     RUN_TEST_CASE( Full_OTA_AGENT, OTA_SetImageState_InvalidParams );
     RUN_TEST_CASE( Full_OTA_AGENT, prvParseJobDocFromJSONandPrvOTA_Close );
     RUN_TEST_CASE( Full_OTA_AGENT, prvParseJSONbyModel_Errors );
+    RUN_TEST_CASE( Full_OTA_AGENT, prvParseJSONbyModel_KeyIndex );
+    #if ( otaconfigDECOMPRESS_WINDOW_BITS > 0U )
+        RUN_TEST_CASE( Full_OTA_AGENT, OTA_Decompress_InPieces );
+    #endif
+    #if ( otaconfigDELTA_BUFFER_SIZE > 0U )
+        RUN_TEST_CASE( Full_OTA_AGENT, OTA_Delta_InPieces );
+    #endif
+    #if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+        RUN_TEST_CASE( Full_OTA_AGENT, OTA_WriteBehind_Coalesce );
+    #endif
 }
 
 TEST( Full_OTA_AGENT, OTA_SetImageState_InvalidParams )
@@ -373,3 +387,374 @@ TEST( Full_OTA_AGENT, prvParseJSONbyModel_Errors )
     /* Shut down the OTA Agent. */
     ( void ) OTA_AgentShutdown( pdMS_TO_TICKS( otatestSHUTDOWN_WAIT ) );
 }
+
+TEST( Full_OTA_AGENT, prvParseJSONbyModel_KeyIndex )
+{
+    static const JSON_DocParam_t xDocParams[] =
+    {
+        { "execution", ( bool_t ) pdTRUE,  { 0xffffffffUL }, eModelParamType_Object,      JSMN_OBJECT },
+        { "jobId",     ( bool_t ) pdTRUE,  { 0xffffffffUL }, eModelParamType_StringInDoc, JSMN_STRING },
+        { "attr",      ( bool_t ) pdFALSE, { 0xffffffffUL }, eModelParamType_UInt32,      JSMN_PRIMITIVE },
+    };
+    JSON_DocModel_t xDocModel;
+
+    /* Every key is found through the key index, and values and array elements that look like keys are ignored. */
+    TEST_ASSERT_EQUAL( eDocParseErr_None,
+                       TEST_OTA_prvInitDocModel( &xDocModel, xDocParams, 0U, 0U, ( uint16_t ) ( sizeof( xDocParams ) / sizeof( xDocParams[ 0 ] ) ) ) );
+    TEST_ASSERT_EQUAL( eDocParseErr_None,
+                       TEST_OTA_prvParseJSONbyModel( "{\"execution\":{\"status\":\"jobId\",\"list\":[\"attr\"],\"jobId\":\"7\",\"attr\":3}}",
+                                                     sizeof( "{\"execution\":{\"status\":\"jobId\",\"list\":[\"attr\"],\"jobId\":\"7\",\"attr\":3}}" ),
+                                                     &xDocModel ) );
+    TEST_ASSERT_EQUAL_UINT32( 0x7U, xDocModel.ulParamsReceivedBitmap );
+
+    /* A missing required key is still reported when all keys are indexed. */
+    TEST_ASSERT_EQUAL( eDocParseErr_None,
+                       TEST_OTA_prvInitDocModel( &xDocModel, xDocParams, 0U, 0U, ( uint16_t ) ( sizeof( xDocParams ) / sizeof( xDocParams[ 0 ] ) ) ) );
+    TEST_ASSERT_EQUAL( eDocParseErr_MalformedDoc,
+                       TEST_OTA_prvParseJSONbyModel( "{\"execution\":{\"attr\":3}}",
+                                                     sizeof( "{\"execution\":{\"attr\":3}}" ),
+                                                     &xDocModel ) );
+
+    /* The keys of a document that is not an object are not searched for. */
+    TEST_ASSERT_EQUAL( eDocParseErr_None,
+                       TEST_OTA_prvInitDocModel( &xDocModel, xDocParams, 0U, 0U, ( uint16_t ) ( sizeof( xDocParams ) / sizeof( xDocParams[ 0 ] ) ) ) );
+    TEST_ASSERT_EQUAL( eDocParseErr_MalformedDoc,
+                       TEST_OTA_prvParseJSONbyModel( "[{\"execution\":{\"jobId\":\"7\"}}]",
+                                                     sizeof( "[{\"execution\":{\"jobId\":\"7\"}}]" ),
+                                                     &xDocModel ) );
+    TEST_ASSERT_EQUAL_UINT32( 0x0U, xDocModel.ulParamsReceivedBitmap );
+}
+
+#if ( otaconfigDECOMPRESS_WINDOW_BITS > 0U )
+
+/**
+ * @brief Image and its compressed file, with a 32 byte window and matches of up to 16 bytes.
+ * The stream holds the literals "abc", a back reference of 9 bytes at offset 3 and the literal "X".
+ */
+    #define otatestDECOMPRESSED_IMAGE    "abcabcabcabcX"
+    static const uint8_t ucOtatestCOMPRESSED_IMAGE[] =
+    {
+        'L',  'Z',  'S',  'S',  5,    4,    0,    0,    13,   0,    0,    0,
+        0xb0, 0xd8, 0xac, 0x61, 0x45, 0x60
+    };
+
+/**
+ * @brief Collects the output of the decompressor.
+ */
+    static uint8_t ucDecompressedImage[ sizeof( otatestDECOMPRESSED_IMAGE ) ];
+
+    static int32_t prvCollectDecompressedData( void * pvContext,
+                                               uint32_t ulOffset,
+                                               const uint8_t * pucData,
+                                               uint32_t ulSize )
+    {
+        ( void ) pvContext;
+
+        if( ( ulOffset + ulSize ) > sizeof( ucDecompressedImage ) )
+        {
+            return -1;
+        }
+
+        memcpy( &ucDecompressedImage[ ulOffset ], pucData, ulSize );
+
+        return ( int32_t ) ulSize;
+    }
+
+    TEST( Full_OTA_AGENT, OTA_Decompress_InPieces )
+    {
+        OTA_Decompress_t xDecompress;
+        uint8_t ucWindow[ 32 ];
+        uint8_t ucBadHeader[ sizeof( ucOtatestCOMPRESSED_IMAGE ) ];
+        uint32_t ulIndex;
+
+        /* The whole file at once. */
+        memset( ucDecompressedImage, 0, sizeof( ucDecompressedImage ) );
+        OTA_Decompress_Init( &xDecompress, ucWindow, sizeof( ucWindow ), prvCollectDecompressedData, NULL );
+        TEST_ASSERT_EQUAL_INT( eDecompress_Result_Complete,
+                               OTA_Decompress_Update( &xDecompress, ucOtatestCOMPRESSED_IMAGE, sizeof( ucOtatestCOMPRESSED_IMAGE ) ) );
+        TEST_ASSERT_EQUAL_INT( eDecompress_Result_Complete, OTA_Decompress_Finish( &xDecompress ) );
+        TEST_ASSERT_EQUAL_MEMORY( otatestDECOMPRESSED_IMAGE, ucDecompressedImage, sizeof( otatestDECOMPRESSED_IMAGE ) - 1 );
+
+        /* One byte at a time, so the header and every field are split. */
+        memset( ucDecompressedImage, 0, sizeof( ucDecompressedImage ) );
+        OTA_Decompress_Init( &xDecompress, ucWindow, sizeof( ucWindow ), prvCollectDecompressedData, NULL );
+
+        for( ulIndex = 0; ulIndex < ( sizeof( ucOtatestCOMPRESSED_IMAGE ) - 1 ); ulIndex++ )
+        {
+            TEST_ASSERT_EQUAL_INT( eDecompress_Result_Continue,
+                                   OTA_Decompress_Update( &xDecompress, &ucOtatestCOMPRESSED_IMAGE[ ulIndex ], 1 ) );
+        }
+
+        /* The last literal is incomplete until the last byte. */
+        TEST_ASSERT_EQUAL_INT( eDecompress_Result_Incomplete, OTA_Decompress_Finish( &xDecompress ) );
+        TEST_ASSERT_EQUAL_INT( eDecompress_Result_Complete,
+                               OTA_Decompress_Update( &xDecompress, &ucOtatestCOMPRESSED_IMAGE[ ulIndex ], 1 ) );
+        TEST_ASSERT_EQUAL_INT( eDecompress_Result_Complete, OTA_Decompress_Finish( &xDecompress ) );
+        TEST_ASSERT_EQUAL_MEMORY( otatestDECOMPRESSED_IMAGE, ucDecompressedImage, sizeof( otatestDECOMPRESSED_IMAGE ) - 1 );
+
+        /* A window larger than the window buffer is rejected. */
+        OTA_Decompress_Init( &xDecompress, ucWindow, sizeof( ucWindow ) / 2U, prvCollectDecompressedData, NULL );
+        TEST_ASSERT_EQUAL_INT( eDecompress_Result_BadWindow,
+                               OTA_Decompress_Update( &xDecompress, ucOtatestCOMPRESSED_IMAGE, sizeof( ucOtatestCOMPRESSED_IMAGE ) ) );
+
+        /* So is a bad magic. */
+        memcpy( ucBadHeader, ucOtatestCOMPRESSED_IMAGE, sizeof( ucBadHeader ) );
+        ucBadHeader[ 0 ] = 'X';
+        OTA_Decompress_Init( &xDecompress, ucWindow, sizeof( ucWindow ), prvCollectDecompressedData, NULL );
+        TEST_ASSERT_EQUAL_INT( eDecompress_Result_BadHeader,
+                               OTA_Decompress_Update( &xDecompress, ucBadHeader, sizeof( ucBadHeader ) ) );
+    }
+
+#endif /* otaconfigDECOMPRESS_WINDOW_BITS */
+
+#if ( otaconfigDELTA_BUFFER_SIZE > 0U )
+
+/**
+ * @brief Base image, new image and the delta file between them. The delta file copies "89AB" after
+ * seeking 8 bytes forward, inserts "xyz" and adds 1 to each byte of "012" after seeking 12 bytes back.
+ */
+    #define otatestDELTA_BASE_IMAGE    "0123456789ABCDEF"
+    #define otatestDELTA_NEW_IMAGE     "89ABxyz123"
+    static const uint8_t ucOtatestDELTA_FILE[] =
+    {
+        'O', 'T', 'A', 'D', 16,  0,   0,   0,   10,  0,   0,   0,
+        0,   4,   16,
+        2,   3,   'x', 'y', 'z',
+        1,   3,   23,  1,   1,   1
+    };
+
+/**
+ * @brief Collects the output of the delta file applier and tells it whether the base image matches.
+ */
+    static uint8_t ucDeltaImage[ sizeof( otatestDELTA_NEW_IMAGE ) ];
+    static int32_t lDeltaBaseCheck;
+
+    static int32_t prvReadDeltaBase( void * pvContext,
+                                     uint32_t ulOffset,
+                                     uint8_t * pucData,
+                                     uint32_t ulSize )
+    {
+        ( void ) pvContext;
+
+        if( ( ulOffset + ulSize ) > ( sizeof( otatestDELTA_BASE_IMAGE ) - 1 ) )
+        {
+            return -1;
+        }
+
+        memcpy( pucData, &otatestDELTA_BASE_IMAGE[ ulOffset ], ulSize );
+
+        return 0;
+    }
+
+    static int32_t prvCheckDeltaBase( void * pvContext,
+                                      uint32_t ulBaseSize,
+                                      uint8_t * pucBuffer,
+                                      uint32_t ulBufferSize )
+    {
+        ( void ) pvContext;
+        ( void ) pucBuffer;
+        ( void ) ulBufferSize;
+
+        return ( ulBaseSize == ( sizeof( otatestDELTA_BASE_IMAGE ) - 1 ) ) ? lDeltaBaseCheck : -1;
+    }
+
+    static int32_t prvCollectDeltaImage( void * pvContext,
+                                         uint32_t ulOffset,
+                                         const uint8_t * pucData,
+                                         uint32_t ulSize )
+    {
+        ( void ) pvContext;
+
+        if( ( ulOffset + ulSize ) > sizeof( ucDeltaImage ) )
+        {
+            return -1;
+        }
+
+        memcpy( &ucDeltaImage[ ulOffset ], pucData, ulSize );
+
+        return ( int32_t ) ulSize;
+    }
+
+    TEST( Full_OTA_AGENT, OTA_Delta_InPieces )
+    {
+        OTA_Delta_t xDelta;
+        uint8_t ucBuffer[ 4 ];
+        uint8_t ucBadFile[ sizeof( ucOtatestDELTA_FILE ) ];
+        uint32_t ulIndex;
+
+        lDeltaBaseCheck = 0;
+
+        /* The whole file at once, with a buffer smaller than the operations. */
+        memset( ucDeltaImage, 0, sizeof( ucDeltaImage ) );
+        OTA_Delta_Init( &xDelta, ucBuffer, sizeof( ucBuffer ), prvReadDeltaBase, prvCheckDeltaBase, prvCollectDeltaImage, NULL );
+        TEST_ASSERT_EQUAL_INT( eDelta_Result_Complete,
+                               OTA_Delta_Update( &xDelta, ucOtatestDELTA_FILE, sizeof( ucOtatestDELTA_FILE ) ) );
+        TEST_ASSERT_EQUAL_INT( eDelta_Result_Complete, OTA_Delta_Finish( &xDelta ) );
+        TEST_ASSERT_EQUAL_MEMORY( otatestDELTA_NEW_IMAGE, ucDeltaImage, sizeof( otatestDELTA_NEW_IMAGE ) - 1 );
+
+        /* One byte at a time, so the header and every number are split. */
+        memset( ucDeltaImage, 0, sizeof( ucDeltaImage ) );
+        OTA_Delta_Init( &xDelta, ucBuffer, sizeof( ucBuffer ), prvReadDeltaBase, prvCheckDeltaBase, prvCollectDeltaImage, NULL );
+
+        for( ulIndex = 0; ulIndex < ( sizeof( ucOtatestDELTA_FILE ) - 1 ); ulIndex++ )
+        {
+            TEST_ASSERT_EQUAL_INT( eDelta_Result_Continue,
+                                   OTA_Delta_Update( &xDelta, &ucOtatestDELTA_FILE[ ulIndex ], 1 ) );
+        }
+
+        /* The last difference byte is missing until the last byte. */
+        TEST_ASSERT_EQUAL_INT( eDelta_Result_Incomplete, OTA_Delta_Finish( &xDelta ) );
+        TEST_ASSERT_EQUAL_INT( eDelta_Result_Complete,
+                               OTA_Delta_Update( &xDelta, &ucOtatestDELTA_FILE[ ulIndex ], 1 ) );
+        TEST_ASSERT_EQUAL_INT( eDelta_Result_Complete, OTA_Delta_Finish( &xDelta ) );
+        TEST_ASSERT_EQUAL_MEMORY( otatestDELTA_NEW_IMAGE, ucDeltaImage, sizeof( otatestDELTA_NEW_IMAGE ) - 1 );
+
+        /* A different running image is rejected before it is used. */
+        lDeltaBaseCheck = -1;
+        OTA_Delta_Init( &xDelta, ucBuffer, sizeof( ucBuffer ), prvReadDeltaBase, prvCheckDeltaBase, prvCollectDeltaImage, NULL );
+        TEST_ASSERT_EQUAL_INT( eDelta_Result_BaseMismatch,
+                               OTA_Delta_Update( &xDelta, ucOtatestDELTA_FILE, sizeof( ucOtatestDELTA_FILE ) ) );
+        lDeltaBaseCheck = 0;
+
+        /* So is a seek beyond the end of the base image. */
+        memcpy( ucBadFile, ucOtatestDELTA_FILE, sizeof( ucBadFile ) );
+        ucBadFile[ 14 ] = 40;
+        OTA_Delta_Init( &xDelta, ucBuffer, sizeof( ucBuffer ), prvReadDeltaBase, prvCheckDeltaBase, prvCollectDeltaImage, NULL );
+        TEST_ASSERT_EQUAL_INT( eDelta_Result_BadPatch,
+                               OTA_Delta_Update( &xDelta, ucBadFile, sizeof( ucBadFile ) ) );
+
+        /* And a bad magic. */
+        memcpy( ucBadFile, ucOtatestDELTA_FILE, sizeof( ucBadFile ) );
+        ucBadFile[ 3 ] = 'X';
+        OTA_Delta_Init( &xDelta, ucBuffer, sizeof( ucBuffer ), prvReadDeltaBase, prvCheckDeltaBase, prvCollectDeltaImage, NULL );
+        TEST_ASSERT_EQUAL_INT( eDelta_Result_BadHeader,
+                               OTA_Delta_Update( &xDelta, ucBadFile, sizeof( ucBadFile ) ) );
+    }
+
+#endif /* otaconfigDELTA_BUFFER_SIZE */
+
+#if ( otaconfigWRITE_BEHIND_PAGE_SIZE > 0U )
+
+/**
+ * @brief Programs the pages of the write-behind buffer as soon as they are submitted and keeps them
+ * in order until they are waited for. Counts the writes of the programmed file.
+ */
+    #define otatestWRITE_BEHIND_IMAGE    "0123456789"
+    static uint8_t ucWriteBehindFile[ 32 ];
+    static uint32_t ulWriteBehindWrites;
+    static int32_t lWriteBehindResult;
+    static OTA_WriteBehindPage_t * pxWriteBehindFIFO[ OTA_WRITE_BEHIND_MAX_PAGES ];
+    static uint32_t ulWriteBehindHead;
+    static uint32_t ulWriteBehindCount;
+
+    static int32_t prvWriteBehindOutput( void * pvContext,
+                                         uint32_t ulOffset,
+                                         const uint8_t * pucData,
+                                         uint32_t ulSize )
+    {
+        ( void ) pvContext;
+
+        if( ( lWriteBehindResult < 0 ) || ( ( ulOffset + ulSize ) > sizeof( ucWriteBehindFile ) ) )
+        {
+            return -1;
+        }
+
+        memcpy( &ucWriteBehindFile[ ulOffset ], pucData, ulSize );
+        ulWriteBehindWrites++;
+
+        return ( int32_t ) ulSize;
+    }
+
+    static void prvWriteBehindSubmit( void * pvContext,
+                                      OTA_WriteBehindPage_t * pxPage )
+    {
+        ( void ) OTA_WriteBehind_Program( pxPage, prvWriteBehindOutput, pvContext );
+        pxWriteBehindFIFO[ ( ulWriteBehindHead + ulWriteBehindCount ) % OTA_WRITE_BEHIND_MAX_PAGES ] = pxPage;
+        ulWriteBehindCount++;
+    }
+
+    static OTA_WriteBehindPage_t * prvWriteBehindWait( void * pvContext )
+    {
+        OTA_WriteBehindPage_t * pxPage = pxWriteBehindFIFO[ ulWriteBehindHead ];
+
+        ( void ) pvContext;
+        TEST_ASSERT_TRUE( ulWriteBehindCount > 0 );
+        ulWriteBehindHead = ( ulWriteBehindHead + 1 ) % OTA_WRITE_BEHIND_MAX_PAGES;
+        ulWriteBehindCount--;
+
+        return pxPage;
+    }
+
+    static void prvWriteBehindReset( void )
+    {
+        memset( ucWriteBehindFile, '-', sizeof( ucWriteBehindFile ) );
+        ulWriteBehindWrites = 0;
+        lWriteBehindResult = 0;
+        ulWriteBehindHead = 0;
+        ulWriteBehindCount = 0;
+    }
+
+    TEST( Full_OTA_AGENT, OTA_WriteBehind_Coalesce )
+    {
+        OTA_WriteBehind_t xWriteBehind;
+        uint8_t ucPages[ 2 * 32 ];
+        uint32_t ulIndex;
+
+        /* Pages written out of order are each programmed once, as soon as they are complete. The last
+         * page is complete at the end of the image. */
+        prvWriteBehindReset();
+        OTA_WriteBehind_Init( &xWriteBehind, ucPages, 4, 2, 10, prvWriteBehindSubmit, prvWriteBehindWait, NULL );
+        TEST_ASSERT_EQUAL_INT32( 2, OTA_WriteBehind_Write( &xWriteBehind, 6, ( const uint8_t * ) "67", 2 ) );
+        TEST_ASSERT_EQUAL_INT32( 1, OTA_WriteBehind_Write( &xWriteBehind, 3, ( const uint8_t * ) "3", 1 ) );
+        TEST_ASSERT_EQUAL_UINT32( 0, ulWriteBehindWrites );
+        TEST_ASSERT_EQUAL_INT32( 2, OTA_WriteBehind_Write( &xWriteBehind, 4, ( const uint8_t * ) "45", 2 ) );
+        TEST_ASSERT_EQUAL_UINT32( 1, ulWriteBehindWrites );
+        TEST_ASSERT_EQUAL_INT32( 2, OTA_WriteBehind_Write( &xWriteBehind, 8, ( const uint8_t * ) "89", 2 ) );
+        TEST_ASSERT_EQUAL_UINT32( 2, ulWriteBehindWrites );
+        TEST_ASSERT_EQUAL_INT32( 3, OTA_WriteBehind_Write( &xWriteBehind, 0, ( const uint8_t * ) "012", 3 ) );
+        TEST_ASSERT_EQUAL_UINT32( 3, ulWriteBehindWrites );
+        TEST_ASSERT_EQUAL_INT32( 0, OTA_WriteBehind_Flush( &xWriteBehind ) );
+        TEST_ASSERT_EQUAL_UINT32( 3, ulWriteBehindWrites );
+        TEST_ASSERT_EQUAL_MEMORY( otatestWRITE_BEHIND_IMAGE, ucWriteBehindFile, 10 );
+        TEST_ASSERT_EQUAL_UINT32( 0, ulWriteBehindCount );
+
+        /* Without a free page buffer the oldest page is programmed with the parts that were written,
+         * and the rest of the pages are programmed by the flush. */
+        prvWriteBehindReset();
+        OTA_WriteBehind_Init( &xWriteBehind, ucPages, 4, 2, 0, prvWriteBehindSubmit, prvWriteBehindWait, NULL );
+        TEST_ASSERT_EQUAL_INT32( 2, OTA_WriteBehind_Write( &xWriteBehind, 0, ( const uint8_t * ) "01", 2 ) );
+        TEST_ASSERT_EQUAL_INT32( 2, OTA_WriteBehind_Write( &xWriteBehind, 4, ( const uint8_t * ) "45", 2 ) );
+        TEST_ASSERT_EQUAL_INT32( 2, OTA_WriteBehind_Write( &xWriteBehind, 8, ( const uint8_t * ) "89", 2 ) );
+        TEST_ASSERT_EQUAL_UINT32( 1, ulWriteBehindWrites );
+        TEST_ASSERT_EQUAL_MEMORY( "01--------", ucWriteBehindFile, 10 );
+        TEST_ASSERT_EQUAL_INT32( 0, OTA_WriteBehind_Flush( &xWriteBehind ) );
+        TEST_ASSERT_EQUAL_MEMORY( "01--45--89", ucWriteBehindFile, 10 );
+        TEST_ASSERT_EQUAL_UINT32( 3, xWriteBehind.ulPartialPages );
+        TEST_ASSERT_EQUAL_UINT32( 0, xWriteBehind.ulFullPages );
+
+        /* A page written in more separate parts than it can track is programmed and started again. */
+        prvWriteBehindReset();
+        OTA_WriteBehind_Init( &xWriteBehind, ucPages, 32, 2, 0, prvWriteBehindSubmit, prvWriteBehindWait, NULL );
+
+        for( ulIndex = 0; ulIndex <= OTA_WRITE_BEHIND_MAX_EXTENTS; ulIndex++ )
+        {
+            TEST_ASSERT_EQUAL_INT32( 1, OTA_WriteBehind_Write( &xWriteBehind, ulIndex * 2, ( const uint8_t * ) "x", 1 ) );
+        }
+
+        TEST_ASSERT_EQUAL_UINT32( OTA_WRITE_BEHIND_MAX_EXTENTS, ulWriteBehindWrites );
+        TEST_ASSERT_EQUAL_INT32( 0, OTA_WriteBehind_Flush( &xWriteBehind ) );
+        TEST_ASSERT_EQUAL_UINT32( OTA_WRITE_BEHIND_MAX_EXTENTS + 1, ulWriteBehindWrites );
+        TEST_ASSERT_EQUAL_MEMORY( "x-x-x-x-x-x-x-x-x-", ucWriteBehindFile, 18 );
+
+        /* A page that fails to program fails the flush and all later writes. */
+        prvWriteBehindReset();
+        OTA_WriteBehind_Init( &xWriteBehind, ucPages, 4, 2, 0, prvWriteBehindSubmit, prvWriteBehindWait, NULL );
+        lWriteBehindResult = -1;
+        TEST_ASSERT_EQUAL_INT32( 4, OTA_WriteBehind_Write( &xWriteBehind, 0, ( const uint8_t * ) "0123", 4 ) );
+        TEST_ASSERT_TRUE( OTA_WriteBehind_Flush( &xWriteBehind ) < 0 );
+        lWriteBehindResult = 0;
+        TEST_ASSERT_TRUE( OTA_WriteBehind_Write( &xWriteBehind, 4, ( const uint8_t * ) "4567", 4 ) < 0 );
+        TEST_ASSERT_EQUAL_UINT32( 0, ulWriteBehindWrites );
+    }
+
+#endif /* otaconfigWRITE_BEHIND_PAGE_SIZE */
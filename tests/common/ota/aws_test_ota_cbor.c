@@ -39,6 +39,7 @@
 #include "aws_ota_cbor.h"
 #include "aws_ota_cbor_internal.h"
 #include "aws_ota_agent_test_access_declare.h"
+#include "aws_ota_agent_config_defaults.h"
 #include "cbor.h"
 
 /* Unity framework includes. */
@@ -221,6 +222,9 @@ TEST_GROUP_RUNNER( Full_OTA_CBOR )
 {
     RUN_TEST_CASE( Full_OTA_CBOR, CborOtaApi );
     RUN_TEST_CASE( Full_OTA_CBOR, CborOtaAgentIngest );
+    #if ( otaconfigMAX_LOG2_FILE_BLOCK_SIZE > otaconfigLOG2_FILE_BLOCK_SIZE )
+        RUN_TEST_CASE( Full_OTA_CBOR, CborOtaAgentIngestMultiBlock );
+    #endif
     RUN_TEST_CASE( Full_OTA_CBOR, CborOtaServerFiles );
 }
 
@@ -229,6 +233,8 @@ TEST_GROUP_RUNNER( Full_OTA_CBOR )
 #define CBOR_TEST_BITMAP_VALUE                            0xAAAAAAAA
 #define CBOR_TEST_GETSTREAMRESPONSE_MESSAGE_ITEM_COUNT    4
 #define CBOR_TEST_CLIENTTOKEN_VALUE                       "ThisIsAClientToken"
+#define CBOR_TEST_CLIENTTOKEN_BUFFER_SIZE                 32
+#define CBOR_TEST_MULTIBLOCK_CLIENTTOKEN_VALUE            "rdy1" /* The agent's token for blocks of 2 file blocks. */
 #define CBOR_TEST_STREAMVERSION_VALUE                     2
 #define CBOR_TEST_STREAMDESCRIPTION_VALUE                 "ThisIsAStream"
 #define CBOR_TEST_FILEIDENTITY_VALUE                      2
@@ -386,6 +392,7 @@ BaseType_t prvCreateSampleDescribeStreamResponseMessage( uint8_t * pucMessageBuf
 
 BaseType_t prvCreateSampleGetStreamResponseMessage( uint8_t * pucMessageBuffer,
                                                     size_t xMessageBufferSize,
+                                                    const char * pcClientToken,
                                                     int lBlockIndex,
                                                     uint8_t * pucBlockPayload,
                                                     size_t xBlockPayloadSize,
@@ -403,7 +410,22 @@ BaseType_t prvCreateSampleGetStreamResponseMessage( uint8_t * pucMessageBuffer,
     xCborResult = cbor_encoder_create_map(
         &xCborEncoder,
         &xCborMapEncoder,
-        CBOR_TEST_GETSTREAMRESPONSE_MESSAGE_ITEM_COUNT );
+        CBOR_TEST_GETSTREAMRESPONSE_MESSAGE_ITEM_COUNT + ( ( NULL != pcClientToken ) ? 1 : 0 ) );
+
+    /* Encode the client token if the response should have one. */
+    if( ( CborNoError == xCborResult ) && ( NULL != pcClientToken ) )
+    {
+        xCborResult = cbor_encode_text_stringz(
+            &xCborMapEncoder,
+            OTA_CBOR_CLIENTTOKEN_KEY );
+
+        if( CborNoError == xCborResult )
+        {
+            xCborResult = cbor_encode_text_stringz(
+                &xCborMapEncoder,
+                pcClientToken );
+        }
+    }
 
     /* Encode the file identity. */
     if( CborNoError == xCborResult )
@@ -501,7 +523,9 @@ TEST( Full_OTA_CBOR, CborOtaApi )
     int lBlockIndex = 0;
     int lBlockSize = 0;
     uint8_t * pucPayload = NULL;
+    const uint8_t * pucInPlacePayload = NULL;
     size_t xPayloadSize = 0;
+    char cResponseClientToken[ CBOR_TEST_CLIENTTOKEN_BUFFER_SIZE ];
 
     /* Test OTA_CBOR_Encode_GetStreamRequestMessage( ). */
     xResult = OTA_CBOR_Encode_GetStreamRequestMessage(
@@ -527,6 +551,7 @@ TEST( Full_OTA_CBOR, CborOtaApi )
     xResult = prvCreateSampleGetStreamResponseMessage(
         ucCborWork,
         sizeof( ucCborWork ),
+        CBOR_TEST_CLIENTTOKEN_VALUE,
         CBOR_TEST_BLOCKIDENTITY_VALUE,
         ucBlockPayload,
         sizeof( ucBlockPayload ),
@@ -550,13 +575,52 @@ TEST( Full_OTA_CBOR, CborOtaApi )
         vPortFree( pucPayload );
         pucPayload = NULL;
     }
+
+    /* Test OTA_CBOR_Decode_GetStreamResponseMessageInPlace( ). The payload
+     * must be returned from inside the message buffer. */
+    xResult = OTA_CBOR_Decode_GetStreamResponseMessageInPlace(
+        ucCborWork,
+        xEncodedSize,
+        &lFileId,
+        &lBlockIndex,
+        &lBlockSize,
+        &pucInPlacePayload,
+        &xPayloadSize,
+        cResponseClientToken,
+        sizeof( cResponseClientToken ) );
+    TEST_ASSERT_TRUE( xResult );
+    TEST_ASSERT_EQUAL_STRING( CBOR_TEST_CLIENTTOKEN_VALUE, cResponseClientToken );
+    TEST_ASSERT_EQUAL( CBOR_TEST_FILEIDENTITY_VALUE, lFileId );
+    TEST_ASSERT_EQUAL( CBOR_TEST_BLOCKIDENTITY_VALUE, lBlockIndex );
+    TEST_ASSERT_EQUAL( sizeof( ucBlockPayload ), lBlockSize );
+    TEST_ASSERT_EQUAL( sizeof( ucBlockPayload ), xPayloadSize );
+    TEST_ASSERT_TRUE( pucInPlacePayload > ucCborWork );
+    TEST_ASSERT_TRUE( ( pucInPlacePayload + xPayloadSize ) <= ( ucCborWork + xEncodedSize ) );
+    TEST_ASSERT_EQUAL_MEMORY( ucBlockPayload, pucInPlacePayload, xPayloadSize );
+
+    /* A message cut short inside the payload is rejected. */
+    xResult = OTA_CBOR_Decode_GetStreamResponseMessageInPlace(
+        ucCborWork,
+        xEncodedSize - 1,
+        &lFileId,
+        &lBlockIndex,
+        &lBlockSize,
+        &pucInPlacePayload,
+        &xPayloadSize,
+        NULL,
+        0 );
+    TEST_ASSERT_FALSE( xResult );
 }
 
-TEST( Full_OTA_CBOR, CborOtaAgentIngest )
+/* Ingest payload.bin in stream blocks of xStreamBlockSize bytes, which the agent
+ * splits into file blocks according to the block shift in pcClientToken. */
+
+static void prvIngestSignedTestFile( const char * pcClientToken,
+                                     size_t xStreamBlockSize )
 {
     BaseType_t xResultBool = pdFALSE;
     IngestResult_t xResultIngest = 0;
-    uint8_t ucCborWork[ CBOR_TEST_MESSAGE_BUFFER_SIZE ];
+    static uint8_t ucCborWork[ ( 2 * OTA_FILE_BLOCK_SIZE ) + CBOR_TEST_MESSAGE_BUFFER_SIZE ];
     size_t xChunkSize = 0;
     size_t xEncodedSize = 0;
     OTA_FileContext_t xOTAFileContext = { 0 };
@@ -614,18 +678,19 @@ TEST( Full_OTA_CBOR, CborOtaAgentIngest )
 
     /* Process the signed file by chunks. */
     for( size_t xBlock = 0;
-         ( xBlock * OTA_FILE_BLOCK_SIZE ) < xOTAFileContext.ulFileSize;
+         ( xBlock * xStreamBlockSize ) < xOTAFileContext.ulFileSize;
          xBlock++ )
     {
         /* Create the encoded data block response. */
         xChunkSize = min(
-            OTA_FILE_BLOCK_SIZE,
-            xOTAFileContext.ulFileSize - ( xBlock * OTA_FILE_BLOCK_SIZE ) );
+            xStreamBlockSize,
+            xOTAFileContext.ulFileSize - ( xBlock * xStreamBlockSize ) );
         xResultBool = prvCreateSampleGetStreamResponseMessage(
             ucCborWork,
             sizeof( ucCborWork ),
+            pcClientToken,
             xBlock,
-            pucInFile + ( xBlock * OTA_FILE_BLOCK_SIZE ),
+            pucInFile + ( xBlock * xStreamBlockSize ),
             xChunkSize,
             &xEncodedSize );
         TEST_ASSERT_TRUE( xResultBool );
@@ -638,7 +703,7 @@ TEST( Full_OTA_CBOR, CborOtaAgentIngest )
             xEncodedSize,
             &xCloseResult );
 
-        if( ( xBlock * OTA_FILE_BLOCK_SIZE ) + xChunkSize == xOTAFileContext.ulFileSize )
+        if( ( xBlock * xStreamBlockSize ) + xChunkSize == xOTAFileContext.ulFileSize )
         {
             TEST_ASSERT_EQUAL_INT32( xResultIngest, eIngest_Result_FileComplete );
         }
@@ -665,6 +730,23 @@ TEST( Full_OTA_CBOR, CborOtaAgentIngest )
     }
 }
 
+TEST( Full_OTA_CBOR, CborOtaAgentIngest )
+{
+    prvIngestSignedTestFile( NULL, OTA_FILE_BLOCK_SIZE );
+}
+
+#if ( otaconfigMAX_LOG2_FILE_BLOCK_SIZE > otaconfigLOG2_FILE_BLOCK_SIZE )
+
+/**
+ * @brief Stream blocks of 2 file blocks, as the agent requests them once the link
+ * proves reliable, are written and hashed as their file blocks.
+ */
+    TEST( Full_OTA_CBOR, CborOtaAgentIngestMultiBlock )
+    {
+        prvIngestSignedTestFile( CBOR_TEST_MULTIBLOCK_CLIENTTOKEN_VALUE, 2 * OTA_FILE_BLOCK_SIZE );
+    }
+#endif /* otaconfigMAX_LOG2_FILE_BLOCK_SIZE */
+
 TEST( Full_OTA_CBOR, CborOtaServerFiles )
 {
     BaseType_t xResultBool = pdFALSE;
@@ -37,7 +37,9 @@
 #include "aws_ota_pal_test_access_declare.h"
 #include "aws_ota_pal.h"
 #include "aws_ota_agent.h"
+#include "aws_ota_agent_config_defaults.h"
 #include "aws_pkcs11.h"
+#include "aws_crypto.h"
 #include "aws_ota_codesigner_certificate.h"
 #include "aws_test_ota_config.h"
 
@@ -139,6 +141,7 @@ TEST_TEAR_DOWN( Full_OTA_PAL )
 TEST_GROUP_RUNNER( Full_OTA_PAL )
 {
     RUN_TEST_CASE( Full_OTA_PAL, prvPAL_CloseFile_ValidSignature );
+    RUN_TEST_CASE( Full_OTA_PAL, prvPAL_CloseFile_ValidSignatureHashedWhileReceiving );
     /* RUN_TEST_CASE( Full_OTA_PAL, prvPAL_CloseFile_NullParameters ); */ /* Not supported yet. */
     RUN_TEST_CASE( Full_OTA_PAL, prvPAL_CloseFile_InvalidSignatureBlockWritten );
     RUN_TEST_CASE( Full_OTA_PAL, prvPAL_CloseFile_InvalidSignatureNoBlockWritten );
@@ -159,6 +162,10 @@ TEST_GROUP_RUNNER( Full_OTA_PAL )
     RUN_TEST_CASE( Full_OTA_PAL, prvPAL_Abort_NullFileHandle );
     RUN_TEST_CASE( Full_OTA_PAL, prvPAL_Abort_NonExistentFile );
 
+    #if ( otaconfigCHECKPOINT_INTERVAL_BLOCKS > 0U )
+        RUN_TEST_CASE( Full_OTA_PAL, prvPAL_ResumeFileForRx_SavedCheckpoint );
+    #endif
+
     /* RUN_TEST_CASE( Full_OTA_PAL, prvPAL_WriteBlock_NullParameters ); */ /* Not supported yet. */
     RUN_TEST_CASE( Full_OTA_PAL, prvPAL_WriteBlock_WriteSingleByte );
     RUN_TEST_CASE( Full_OTA_PAL, prvPAL_WriteBlock_WriteManyBlocks );
@@ -243,6 +250,48 @@ TEST( Full_OTA_PAL, prvPAL_CloseFile_ValidSignature )
     }
 }
 
+/**
+ * @brief Test prvPAL_CloseFile with a valid signature when the first part of the
+ * file was already hashed as it was received, the way the OTA agent does when the
+ * PAL starts a signature verification context. Verify the success.
+ */
+TEST( Full_OTA_PAL, prvPAL_CloseFile_ValidSignatureHashedWhileReceiving )
+{
+    OTA_Err_t xOtaStatus;
+    Sig256_t xSig = { 0 };
+
+    xOtaFile.pucFilePath = ( uint8_t * ) ( "test_happy_path_image.bin" );
+    xOtaStatus = prvPAL_CreateFileForRx( &xOtaFile );
+    TEST_ASSERT_EQUAL( kOTA_Err_None, xOtaStatus );
+
+    /* We still want to close the file if the test fails somewhere here. */
+    if( TEST_PROTECT() )
+    {
+        xOtaStatus = prvPAL_WriteBlock( &xOtaFile,
+                                        0,
+                                        ucDummyData,
+                                        sizeof( ucDummyData ) );
+        TEST_ASSERT_EQUAL( sizeof( ucDummyData ), xOtaStatus );
+
+        /* Platforms that don't hash while receiving leave the context NULL and
+         * read the whole file back instead. */
+        if( xOtaFile.pvSigVerifyContext != NULL )
+        {
+            CRYPTO_SignatureVerificationUpdate( xOtaFile.pvSigVerifyContext, ucDummyData, sizeof( ucDummyData ) / 2 );
+            xOtaFile.ulHashedBytes = sizeof( ucDummyData ) / 2;
+        }
+
+        xOtaFile.pxSignature = &xSig;
+        xOtaFile.pxSignature->usSize = ucValidSignatureLength;
+        memcpy( xOtaFile.pxSignature->ucData, ucValidSignature, ucValidSignatureLength );
+        xOtaFile.pucCertFilepath = ( uint8_t * ) otatestpalCERTIFICATE_FILE;
+
+        xOtaStatus = prvPAL_CloseFile( &xOtaFile );
+        TEST_ASSERT_EQUAL_INT( kOTA_Err_None, xOtaStatus );
+        TEST_ASSERT_NULL( xOtaFile.pvSigVerifyContext );
+    }
+}
+
 extern CK_RV xProvisionCertificate( CK_SESSION_HANDLE xSession,
                                     uint8_t * pucCodeSignCertificate,
                                     size_t xCertificateLength,
@@ -566,6 +615,62 @@ TEST( Full_OTA_PAL, prvPAL_Abort_NonExistentFile )
     TEST_ASSERT_EQUAL_INT( kOTA_Err_None, ( xOtaStatus & ~kOTA_PAL_ErrMask ) );
 }
 
+#if ( otaconfigCHECKPOINT_INTERVAL_BLOCKS > 0U )
+
+/**
+ * @brief Store a checkpoint, then resume the file. Verify the checkpoint is read back and
+ * that an erased checkpoint can't be resumed.
+ */
+    TEST( Full_OTA_PAL, prvPAL_ResumeFileForRx_SavedCheckpoint )
+    {
+        OTA_Err_t xOtaStatus;
+        int16_t sNumBytesWritten;
+        uint8_t ucCheckpoint[ 16 ];
+        uint8_t ucReadCheckpoint[ sizeof( ucCheckpoint ) + 1 ];
+        uint32_t ulSize = 0;
+        uint32_t ulIndex;
+
+        for( ulIndex = 0; ulIndex < sizeof( ucCheckpoint ); ulIndex++ )
+        {
+            ucCheckpoint[ ulIndex ] = ( uint8_t ) ulIndex;
+        }
+
+        xOtaFile.pucFilePath = ( uint8_t * ) otatestpalFIRMWARE_FILE;
+        xOtaFile.ulFileSize = sizeof( ucDummyData );
+
+        xOtaStatus = prvPAL_CreateFileForRx( &xOtaFile );
+        TEST_ASSERT_EQUAL( kOTA_Err_None, xOtaStatus );
+
+        sNumBytesWritten = prvPAL_WriteBlock( &xOtaFile, 0, ucDummyData, sizeof( ucDummyData ) );
+        TEST_ASSERT_EQUAL( sizeof( ucDummyData ), sNumBytesWritten );
+
+        xOtaStatus = prvPAL_SaveCheckpoint( &xOtaFile, ucCheckpoint, sizeof( ucCheckpoint ) );
+        TEST_ASSERT_EQUAL( kOTA_Err_None, xOtaStatus );
+
+        /* Close the file as a reset would, without erasing it. */
+        xOtaStatus = prvPAL_Abort( &xOtaFile );
+        TEST_ASSERT_EQUAL( kOTA_Err_None, xOtaStatus );
+
+        xOtaStatus = prvPAL_ResumeFileForRx( &xOtaFile, ucReadCheckpoint, sizeof( ucReadCheckpoint ), &ulSize );
+        TEST_ASSERT_EQUAL( kOTA_Err_None, xOtaStatus );
+        TEST_ASSERT_EQUAL( sizeof( ucCheckpoint ), ulSize );
+        TEST_ASSERT_EQUAL_MEMORY( ucCheckpoint, ucReadCheckpoint, sizeof( ucCheckpoint ) );
+        TEST_ASSERT_NULL( xOtaFile.pvSigVerifyContext );
+
+        /* A checkpoint that doesn't fit in the buffer is not returned. */
+        xOtaStatus = prvPAL_Abort( &xOtaFile );
+        TEST_ASSERT_EQUAL( kOTA_Err_None, xOtaStatus );
+        xOtaStatus = prvPAL_ResumeFileForRx( &xOtaFile, ucReadCheckpoint, sizeof( ucCheckpoint ) - 1, &ulSize );
+        TEST_ASSERT_EQUAL( kOTA_Err_NoCheckpoint, xOtaStatus );
+
+        xOtaStatus = prvPAL_SaveCheckpoint( &xOtaFile, NULL, 0 );
+        TEST_ASSERT_EQUAL( kOTA_Err_None, xOtaStatus );
+
+        xOtaStatus = prvPAL_ResumeFileForRx( &xOtaFile, ucReadCheckpoint, sizeof( ucReadCheckpoint ), &ulSize );
+        TEST_ASSERT_EQUAL( kOTA_Err_NoCheckpoint, xOtaStatus );
+    }
+#endif /* if ( otaconfigCHECKPOINT_INTERVAL_BLOCKS > 0U ) */
+
 /**
  * Write one byte of data and verify success.
  */
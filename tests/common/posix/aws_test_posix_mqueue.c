@@ -46,11 +46,12 @@
  * platform-specific.
  */
 /**@{ */
-#define posixtestMQ_INVALID_MQD           ( ( mqd_t ) -1 )                         /**< An invalid message queue descriptor. */
-#define posixtestMQ_SMALL_MESSAGE         "Hello"                                  /**< A small test message sent over the mq tests. */
-#define posixtestMQ_SMALL_MESSAGE_SIZE    ( sizeof( posixtestMQ_SMALL_MESSAGE ) )  /**< Length (including null-terminator) of posixtestMQ_SMALL_MESSAGE. */
-#define posixtestMQ_DEFAULT_NAME          "/myqueue"                               /**< Default name of message queues in this test. */
-#define posixtestMQ_DEFAULT_MODE          0600                                     /**< Default mode argument for mq_open. */
+#define posixtestMQ_INVALID_MQD           ( ( mqd_t ) -1 )                           /**< An invalid message queue descriptor. */
+#define posixtestMQ_SMALL_MESSAGE         "Hello"                                    /**< A small test message sent over the mq tests. */
+#define posixtestMQ_SMALL_MESSAGE_SIZE    ( sizeof( posixtestMQ_SMALL_MESSAGE ) )    /**< Length (including null-terminator) of posixtestMQ_SMALL_MESSAGE. */
+#define posixtestMQ_DEFAULT_NAME          "/myqueue"                                 /**< Default name of message queues in this test. */
+#define posixtestMQ_DEFAULT_MODE          0600                                       /**< Default mode argument for mq_open. */
+#define posixtestMQ_INDEXED_NAME_SIZE     ( sizeof( posixtestMQ_DEFAULT_NAME ) + 5 ) /**< Size of the names made by prvMakeQueueName. */
 /**@} */
 
 /* Default queue attributes used in these tests. */
@@ -64,6 +65,36 @@ struct mq_attr xDefaultQueueAttr =
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Make the name of one of the queues of a test which opens several,
+ * posixtestMQ_DEFAULT_NAME followed by xIndex in decimal.
+ *
+ * @param[out] pcName Buffer of posixtestMQ_INDEXED_NAME_SIZE bytes.
+ * @param[in] xIndex Index of the queue, less than 100000.
+ */
+static void prvMakeQueueName( char * pcName,
+                              size_t xIndex )
+{
+    size_t xLength = sizeof( posixtestMQ_DEFAULT_NAME ) - 1;
+    size_t xDivisor = 1;
+
+    memcpy( pcName, posixtestMQ_DEFAULT_NAME, xLength );
+
+    while( xIndex / xDivisor >= 10 )
+    {
+        xDivisor *= 10;
+    }
+
+    for( ; xDivisor > 0; xDivisor /= 10 )
+    {
+        pcName[ xLength++ ] = ( char ) ( '0' + ( ( xIndex / xDivisor ) % 10 ) );
+    }
+
+    pcName[ xLength ] = '\0';
+}
+
+/*-----------------------------------------------------------*/
+
 TEST_GROUP( Full_POSIX_MQUEUE );
 
 /*-----------------------------------------------------------*/
@@ -93,6 +124,10 @@ TEST_GROUP_RUNNER( Full_POSIX_MQUEUE )
     RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_send_receive );
     /*RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_send_receive_invalidParams ); */
     RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_send_receive_nonblock );
+    RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_send_receive_empty );
+    RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_send_receive_max_size );
+    RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_open_name_collisions );
+    RUN_TEST_CASE( Full_POSIX_MQUEUE, mq_open_reuse_freed_queue );
 }
 
 /*-----------------------------------------------------------*/
@@ -550,3 +585,306 @@ TEST( Full_POSIX_MQUEUE, mq_send_receive_nonblock )
 }
 
 /*-----------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_MQUEUE, mq_send_receive_empty )
+{
+    int iStatus = 0;
+    volatile mqd_t xMqId = posixtestMQ_INVALID_MQD;
+    char pcReceiveBuffer[ posixtestMQ_SMALL_MESSAGE_SIZE ] = { 0 };
+    struct mq_attr xQueueAttr = { 0 };
+
+    if( TEST_PROTECT() )
+    {
+        xMqId = mq_open( posixtestMQ_DEFAULT_NAME,
+                         O_CREAT | O_RDWR | O_NONBLOCK,
+                         posixtestMQ_DEFAULT_MODE,
+                         &xDefaultQueueAttr );
+        TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+
+        /* Send an empty message between two others. */
+        iStatus = mq_send( xMqId, posixtestMQ_SMALL_MESSAGE, posixtestMQ_SMALL_MESSAGE_SIZE, 0 );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        iStatus = mq_send( xMqId, posixtestMQ_SMALL_MESSAGE, 0, 0 );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        iStatus = mq_send( xMqId, posixtestMQ_SMALL_MESSAGE, posixtestMQ_SMALL_MESSAGE_SIZE, 0 );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+        /* The empty message counts as a message. */
+        iStatus = mq_getattr( xMqId, &xQueueAttr );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        TEST_ASSERT_EQUAL_INT( 3, xQueueAttr.mq_curmsgs );
+
+        /* The messages are received in order, the empty one with a length
+         * of 0 rather than an error. */
+        iStatus = ( int ) mq_receive( xMqId, pcReceiveBuffer, posixtestMQ_SMALL_MESSAGE_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( posixtestMQ_SMALL_MESSAGE_SIZE, iStatus );
+        iStatus = ( int ) mq_receive( xMqId, pcReceiveBuffer, posixtestMQ_SMALL_MESSAGE_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        iStatus = ( int ) mq_receive( xMqId, pcReceiveBuffer, posixtestMQ_SMALL_MESSAGE_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( posixtestMQ_SMALL_MESSAGE_SIZE, iStatus );
+        TEST_ASSERT_EQUAL_STRING( posixtestMQ_SMALL_MESSAGE, pcReceiveBuffer );
+
+        /* The queue is now empty. */
+        iStatus = ( int ) mq_receive( xMqId, pcReceiveBuffer, posixtestMQ_SMALL_MESSAGE_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( -1, iStatus );
+        TEST_ASSERT_EQUAL_INT( EAGAIN, errno );
+    }
+
+    ( void ) mq_close( xMqId );
+    ( void ) mq_unlink( posixtestMQ_DEFAULT_NAME );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_MQUEUE, mq_send_receive_max_size )
+{
+    int iStatus = 0;
+    volatile mqd_t xMqId = posixtestMQ_INVALID_MQD;
+    char pcSendBuffer[ posixconfigMQ_MAX_SIZE + 1 ] = { 0 };
+    char pcReceiveBuffer[ posixconfigMQ_MAX_SIZE ] = { 0 };
+    struct mq_attr xQueueAttr =
+    {
+        .mq_flags   = 0,
+        .mq_maxmsg  = posixconfigMQ_MAX_MESSAGES,
+        .mq_msgsize = posixconfigMQ_MAX_SIZE,
+        .mq_curmsgs = 0
+    };
+    size_t xRound = 0, xMessage = 0, x = 0;
+
+    if( TEST_PROTECT() )
+    {
+        xMqId = mq_open( posixtestMQ_DEFAULT_NAME,
+                         O_CREAT | O_RDWR | O_NONBLOCK,
+                         posixtestMQ_DEFAULT_MODE,
+                         &xQueueAttr );
+        TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+
+        /* A message larger than mq_msgsize is not sent. */
+        iStatus = mq_send( xMqId, pcSendBuffer, posixconfigMQ_MAX_SIZE + 1, 0 );
+        TEST_ASSERT_EQUAL_INT( -1, iStatus );
+        TEST_ASSERT_EQUAL_INT( EMSGSIZE, errno );
+
+        /* Move the messages of the rounds below off the start of the queue's
+         * storage, so that some of them wrap around its end. */
+        iStatus = mq_send( xMqId, posixtestMQ_SMALL_MESSAGE, posixtestMQ_SMALL_MESSAGE_SIZE, 0 );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        iStatus = ( int ) mq_receive( xMqId, pcReceiveBuffer, posixconfigMQ_MAX_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( posixtestMQ_SMALL_MESSAGE_SIZE, iStatus );
+
+        for( xRound = 0; xRound < 3; xRound++ )
+        {
+            /* Exactly mq_maxmsg messages of mq_msgsize fit. */
+            for( xMessage = 0; xMessage < posixconfigMQ_MAX_MESSAGES; xMessage++ )
+            {
+                for( x = 0; x < posixconfigMQ_MAX_SIZE; x++ )
+                {
+                    pcSendBuffer[ x ] = ( char ) ( xRound + xMessage + x );
+                }
+
+                iStatus = mq_send( xMqId, pcSendBuffer, posixconfigMQ_MAX_SIZE, 0 );
+                TEST_ASSERT_EQUAL_INT( 0, iStatus );
+            }
+
+            iStatus = mq_send( xMqId, pcSendBuffer, posixconfigMQ_MAX_SIZE, 0 );
+            TEST_ASSERT_EQUAL_INT( -1, iStatus );
+            TEST_ASSERT_EQUAL_INT( EAGAIN, errno );
+
+            /* They are received whole and in order. */
+            for( xMessage = 0; xMessage < posixconfigMQ_MAX_MESSAGES; xMessage++ )
+            {
+                iStatus = ( int ) mq_receive( xMqId, pcReceiveBuffer, posixconfigMQ_MAX_SIZE, NULL );
+                TEST_ASSERT_EQUAL_INT( posixconfigMQ_MAX_SIZE, iStatus );
+
+                for( x = 0; x < posixconfigMQ_MAX_SIZE; x++ )
+                {
+                    TEST_ASSERT_EQUAL_INT8( ( char ) ( xRound + xMessage + x ), pcReceiveBuffer[ x ] );
+                }
+            }
+
+            iStatus = ( int ) mq_receive( xMqId, pcReceiveBuffer, posixconfigMQ_MAX_SIZE, NULL );
+            TEST_ASSERT_EQUAL_INT( -1, iStatus );
+            TEST_ASSERT_EQUAL_INT( EAGAIN, errno );
+        }
+    }
+
+    ( void ) mq_close( xMqId );
+    ( void ) mq_unlink( posixtestMQ_DEFAULT_NAME );
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_MQUEUE, mq_open_name_collisions )
+{
+    #if ( posixconfigMQ_HASH_BUCKETS < posixconfigMQ_MAX_QUEUES )
+        int iStatus = 0;
+        volatile mqd_t xMqIds[ posixconfigMQ_HASH_BUCKETS + 1 ];
+        volatile mqd_t xMqId = posixtestMQ_INVALID_MQD;
+        char pcName[ posixtestMQ_INDEXED_NAME_SIZE ] = { 0 };
+        char cMessage = 0;
+        size_t x = 0;
+
+        for( x = 0; x <= posixconfigMQ_HASH_BUCKETS; x++ )
+        {
+            xMqIds[ x ] = posixtestMQ_INVALID_MQD;
+        }
+
+        if( TEST_PROTECT() )
+        {
+            /* Open more queues than there are buckets in the table of names,
+             * so that at least two names share a bucket. */
+            for( x = 0; x <= posixconfigMQ_HASH_BUCKETS; x++ )
+            {
+                prvMakeQueueName( pcName, x );
+                xMqIds[ x ] = mq_open( pcName,
+                                       O_CREAT | O_EXCL | O_RDWR | O_NONBLOCK,
+                                       posixtestMQ_DEFAULT_MODE,
+                                       &xDefaultQueueAttr );
+                TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqIds[ x ] );
+            }
+
+            /* Each name finds its own queue: a message sent through a
+             * descriptor from opening the name again arrives on the queue
+             * of the first descriptor. */
+            for( x = 0; x <= posixconfigMQ_HASH_BUCKETS; x++ )
+            {
+                prvMakeQueueName( pcName, x );
+                xMqId = mq_open( pcName, O_RDWR | O_NONBLOCK, posixtestMQ_DEFAULT_MODE, NULL );
+                TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+
+                cMessage = ( char ) x;
+                iStatus = mq_send( xMqId, &cMessage, 1, 0 );
+                TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+                iStatus = mq_close( xMqId );
+                TEST_ASSERT_EQUAL_INT( 0, iStatus );
+                xMqId = posixtestMQ_INVALID_MQD;
+            }
+
+            for( x = 0; x <= posixconfigMQ_HASH_BUCKETS; x++ )
+            {
+                iStatus = ( int ) mq_receive( xMqIds[ x ], pcName, sizeof( pcName ), NULL );
+                TEST_ASSERT_EQUAL_INT( 1, iStatus );
+                TEST_ASSERT_EQUAL_INT( ( int ) x, pcName[ 0 ] );
+            }
+
+            /* Removing one name leaves the others in its bucket. */
+            prvMakeQueueName( pcName, 0 );
+            iStatus = mq_close( xMqIds[ 0 ] );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+            xMqIds[ 0 ] = posixtestMQ_INVALID_MQD;
+            iStatus = mq_unlink( pcName );
+            TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+            xMqId = mq_open( pcName, O_RDWR, posixtestMQ_DEFAULT_MODE, NULL );
+            TEST_ASSERT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+            TEST_ASSERT_EQUAL_INT( ENOENT, errno );
+
+            for( x = 1; x <= posixconfigMQ_HASH_BUCKETS; x++ )
+            {
+                prvMakeQueueName( pcName, x );
+                xMqId = mq_open( pcName, O_CREAT | O_EXCL, posixtestMQ_DEFAULT_MODE, NULL );
+                TEST_ASSERT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+                TEST_ASSERT_EQUAL_INT( EEXIST, errno );
+            }
+        }
+
+        /* Clean up resources used by test. */
+        ( void ) mq_close( xMqId );
+
+        for( x = 0; x <= posixconfigMQ_HASH_BUCKETS; x++ )
+        {
+            prvMakeQueueName( pcName, x );
+            ( void ) mq_close( xMqIds[ x ] );
+            ( void ) mq_unlink( pcName );
+        }
+    #else /* if ( posixconfigMQ_HASH_BUCKETS < posixconfigMQ_MAX_QUEUES ) */
+        TEST_IGNORE_MESSAGE( "posixconfigMQ_MAX_QUEUES is not more than posixconfigMQ_HASH_BUCKETS." );
+    #endif /* if ( posixconfigMQ_HASH_BUCKETS < posixconfigMQ_MAX_QUEUES ) */
+}
+
+/*-----------------------------------------------------------*/
+
+TEST( Full_POSIX_MQUEUE, mq_open_reuse_freed_queue )
+{
+    int iStatus = 0;
+    volatile mqd_t xMqIds[ posixconfigMQ_MAX_QUEUES ];
+    volatile mqd_t xMqId = posixtestMQ_INVALID_MQD;
+    mqd_t xFreedMqId = posixtestMQ_INVALID_MQD;
+    char pcName[ posixtestMQ_INDEXED_NAME_SIZE ] = { 0 };
+    char pcReceiveBuffer[ posixtestMQ_SMALL_MESSAGE_SIZE ] = { 0 };
+    struct mq_attr xQueueAttr = { 0 };
+    size_t x = 0;
+
+    for( x = 0; x < posixconfigMQ_MAX_QUEUES; x++ )
+    {
+        xMqIds[ x ] = posixtestMQ_INVALID_MQD;
+    }
+
+    if( TEST_PROTECT() )
+    {
+        /* Open as many queues as can exist at one time. */
+        for( x = 0; x < posixconfigMQ_MAX_QUEUES; x++ )
+        {
+            prvMakeQueueName( pcName, x );
+            xMqIds[ x ] = mq_open( pcName, O_CREAT | O_RDWR | O_NONBLOCK, posixtestMQ_DEFAULT_MODE, &xDefaultQueueAttr );
+            TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqIds[ x ] );
+        }
+
+        /* One more fails. */
+        prvMakeQueueName( pcName, posixconfigMQ_MAX_QUEUES );
+        xMqId = mq_open( pcName, O_CREAT | O_RDWR | O_NONBLOCK, posixtestMQ_DEFAULT_MODE, &xDefaultQueueAttr );
+        TEST_ASSERT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+        TEST_ASSERT_EQUAL_INT( ENOSPC, errno );
+
+        /* Free one queue. Its descriptor is no longer valid. */
+        xFreedMqId = xMqIds[ 0 ];
+        prvMakeQueueName( pcName, 0 );
+        iStatus = mq_close( xMqIds[ 0 ] );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        xMqIds[ 0 ] = posixtestMQ_INVALID_MQD;
+        iStatus = mq_unlink( pcName );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+
+        iStatus = mq_getattr( xFreedMqId, &xQueueAttr );
+        TEST_ASSERT_EQUAL_INT( -1, iStatus );
+        TEST_ASSERT_EQUAL_INT( EBADF, errno );
+
+        /* Its place is used by a new queue, which gets a different
+         * descriptor. */
+        prvMakeQueueName( pcName, posixconfigMQ_MAX_QUEUES );
+        xMqId = mq_open( pcName, O_CREAT | O_RDWR | O_NONBLOCK, posixtestMQ_DEFAULT_MODE, &xDefaultQueueAttr );
+        TEST_ASSERT_NOT_EQUAL( posixtestMQ_INVALID_MQD, xMqId );
+        TEST_ASSERT_NOT_EQUAL( xFreedMqId, xMqId );
+
+        /* The freed descriptor still does not reach any queue, including
+         * the new one. */
+        iStatus = mq_send( xFreedMqId, posixtestMQ_SMALL_MESSAGE, posixtestMQ_SMALL_MESSAGE_SIZE, 0 );
+        TEST_ASSERT_EQUAL_INT( -1, iStatus );
+        TEST_ASSERT_EQUAL_INT( EBADF, errno );
+
+        iStatus = ( int ) mq_receive( xMqId, pcReceiveBuffer, posixtestMQ_SMALL_MESSAGE_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( -1, iStatus );
+        TEST_ASSERT_EQUAL_INT( EAGAIN, errno );
+
+        /* The new queue works. */
+        iStatus = mq_send( xMqId, posixtestMQ_SMALL_MESSAGE, posixtestMQ_SMALL_MESSAGE_SIZE, 0 );
+        TEST_ASSERT_EQUAL_INT( 0, iStatus );
+        iStatus = ( int ) mq_receive( xMqId, pcReceiveBuffer, posixtestMQ_SMALL_MESSAGE_SIZE, NULL );
+        TEST_ASSERT_EQUAL_INT( posixtestMQ_SMALL_MESSAGE_SIZE, iStatus );
+        TEST_ASSERT_EQUAL_STRING( posixtestMQ_SMALL_MESSAGE, pcReceiveBuffer );
+    }
+
+    /* Clean up resources used by test. */
+    prvMakeQueueName( pcName, posixconfigMQ_MAX_QUEUES );
+    ( void ) mq_close( xMqId );
+    ( void ) mq_unlink( pcName );
+
+    for( x = 0; x < posixconfigMQ_MAX_QUEUES; x++ )
+    {
+        prvMakeQueueName( pcName, x );
+        ( void ) mq_close( xMqIds[ x ] );
+        ( void ) mq_unlink( pcName );
+    }
+}
@@ -136,6 +136,26 @@ static void RunTests( void )
         RUN_TEST_GROUP( Full_DEFENDER );
     #endif
 
+    #if ( testrunnerFULL_TASK_PROFILE_ENABLED == 1 )
+        RUN_TEST_GROUP( Full_TASK_PROFILE );
+    #endif
+
+    #if ( testrunnerFULL_TIMERS_ENABLED == 1 )
+        RUN_TEST_GROUP( Full_TIMERS );
+    #endif
+
+    #if ( testrunnerFULL_STREAM_BUFFER_ENABLED == 1 )
+        RUN_TEST_GROUP( Full_STREAM_BUFFER );
+    #endif
+
+    #if ( testrunnerFULL_QUEUE_MULTIPLE_ENABLED == 1 )
+        RUN_TEST_GROUP( Full_QUEUE_MULTIPLE );
+    #endif
+
+    #if ( testrunnerFULL_FAST_MUTEX_ENABLED == 1 )
+        RUN_TEST_GROUP( Full_FAST_MUTEX );
+    #endif
+
     #if ( testrunnerFULL_POSIX_ENABLED == 1 )
         RUN_TEST_GROUP( Full_POSIX_CLOCK );
         RUN_TEST_GROUP( Full_POSIX_MQUEUE );
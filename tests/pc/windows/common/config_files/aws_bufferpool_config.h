@@ -38,7 +38,9 @@
 
 /**
  * @brief The size of each buffer in the static buffer pool.
+ *
+ * Holds an OTA stream message of the largest block, 2KB of file data plus its header.
  */
-#define bufferpoolconfigBUFFER_SIZE    ( 2048 )
+#define bufferpoolconfigBUFFER_SIZE    ( 2048 + 256 )
 
 #endif /* _AWS_BUFFER_POOL_CONFIG_H_ */
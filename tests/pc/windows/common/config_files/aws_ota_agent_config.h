@@ -43,6 +43,14 @@
  */
 #define otaconfigLOG2_FILE_BLOCK_SIZE           10UL
 
+/**
+ * @brief Log 2 of the largest block requested from the OTA service.
+ *
+ * Blocks of up to 2KB are requested when the link doesn't lose any, which needs a buffer pool
+ * buffer that holds a 2KB block with its CBOR header and MQTT framing.
+ */
+#define otaconfigMAX_LOG2_FILE_BLOCK_SIZE       11UL
+
 /**
  * @brief Milliseconds to wait for the self test phase to succeed before we force reset.
  */
@@ -71,4 +79,37 @@
  */
 #define otaconfigMAX_THINGNAME_LEN              64U
 
+/**
+ * @brief The number of received blocks after which a checkpoint of the download is stored.
+ *
+ * The Windows PAL stores the checkpoint in a file next to the receive file.
+ */
+#define otaconfigCHECKPOINT_INTERVAL_BLOCKS     16U
+
+/**
+ * @brief Log 2 of the largest window of compressed OTA files.
+ *
+ * The Windows PAL writes the decompressed image at any offset, so compressed files are accepted.
+ */
+#define otaconfigDECOMPRESS_WINDOW_BITS         12U
+
+/**
+ * @brief Size in bytes of the buffer used to apply delta OTA files.
+ *
+ * The Windows PAL reads the running image from BaseImage.bin in the working directory.
+ */
+#define otaconfigDELTA_BUFFER_SIZE              1024U
+
+/**
+ * @brief Size in bytes of the pages of the OTA write-behind buffer.
+ *
+ * The Windows PAL writes files, so the page size only sets the size of the writes.
+ */
+#define otaconfigWRITE_BEHIND_PAGE_SIZE         4096U
+
+/**
+ * @brief The number of page buffers of the OTA write-behind buffer.
+ */
+#define otaconfigWRITE_BEHIND_PAGES             4U
+
 #endif /* _AWS_OTA_AGENT_CONFIG_H_ */
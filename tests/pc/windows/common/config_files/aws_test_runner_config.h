@@ -39,6 +39,7 @@
 /* Supported tests. 0 = Disabled, 1 = Enabled */
 #define testrunnerFULL_CBOR_ENABLED                0
 #define testrunnerFULL_CRYPTO_ENABLED              0
+#define testrunnerFULL_FAST_MUTEX_ENABLED          0
 #define testrunnerFULL_FREERTOS_TCP_ENABLED        0
 #define testrunnerFULL_DEFENDER_ENABLED            0
 #define testrunnerFULL_GGD_ENABLED                 0
@@ -49,8 +50,12 @@
 #define testrunnerFULL_MQTT_STRESS_TEST_ENABLED    0
 #define testrunnerFULL_PKCS11_ENABLED              0
 #define testrunnerFULL_POSIX_ENABLED               0
+#define testrunnerFULL_QUEUE_MULTIPLE_ENABLED      0
 #define testrunnerFULL_SHADOW_ENABLED              0
+#define testrunnerFULL_STREAM_BUFFER_ENABLED       0
+#define testrunnerFULL_TASK_PROFILE_ENABLED        0
 #define testrunnerFULL_TCP_ENABLED                 1
+#define testrunnerFULL_TIMERS_ENABLED              0
 #define testrunnerFULL_TLS_ENABLED                 0
 #define testrunnerFULL_MEMORYLEAK_ENABLED          0
 #define testrunnerFULL_OTA_CBOR_ENABLED            0
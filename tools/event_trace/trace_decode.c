@@ -0,0 +1,601 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file trace_decode.c
+ * @brief Decodes the records of the built in FreeRTOS event recorder on a host.
+ *
+ * Usage:
+ *   trace_decode [-f time stamp Hz] [-o JSON file] trace file
+ *
+ * Reads the records of lib/include/event_trace.h, as drained from a target, and writes them as
+ * Chrome trace events to the JSON file, which chrome://tracing and Perfetto open: a slice for
+ * each time a task ran, instant events for the queue events, and a counter of the heap in use.
+ * Prints a table of the tasks with their wake latency, from when a task was made ready until it
+ * ran, and the length of the slices they ran for, and histograms of both.
+ *
+ * The records are in the byte order of the target, which the start record at the start of the
+ * trace tells. A trace without it is taken to be little endian. The time stamps are 32 bits and are extended on the assumption that less than 2^32 counts pass between
+ * two records, 4.3 s at 1 GHz.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The events of event_trace.h. */
+#define EVENT_TASK_CREATE              1U
+#define EVENT_TASK_DELETE              2U
+#define EVENT_TASK_SWITCHED_IN         3U
+#define EVENT_TASK_READY               4U
+#define EVENT_QUEUE_SEND               5U
+#define EVENT_QUEUE_SEND_FROM_ISR      6U
+#define EVENT_QUEUE_RECEIVE            7U
+#define EVENT_QUEUE_RECEIVE_FROM_ISR   8U
+#define EVENT_MALLOC                   9U
+#define EVENT_FREE                     10U
+#define EVENT_DROPPED                  11U
+#define EVENT_START                    12U
+
+#define RECORD_SIZE                    16U
+#define MAX_TASKS                      65536U
+#define NAME_LEN                       16U
+#define ISR_TID                        0U     /* The thread of the events from interrupts. */
+#define HISTOGRAM_BUCKETS              24U    /* Powers of 2 of ns, up to 8 s. */
+#define BLOCK_TABLE_SIZE               65536U /* For the sizes of the allocated blocks. */
+#define DEFAULT_HZ                     1000000000.0
+
+/*-----------------------------------------------------------*/
+
+typedef struct Record
+{
+    uint64_t ullTime; /* The time stamp extended to 64 bits. */
+    uint8_t ucEvent;
+    uint8_t ucInfo;
+    uint16_t usTask;
+    uint32_t ulObject;
+    uint32_t ulValue;
+} Record_t;
+
+/* The samples of a wake latency or a slice length, in ns. */
+typedef struct Samples
+{
+    double * pdNs;
+    size_t xCount;
+    size_t xSize;
+    uint64_t ullHistogram[ HISTOGRAM_BUCKETS ];
+} Samples_t;
+
+typedef struct Task
+{
+    char cName[ NAME_LEN ];
+    int lSeen;
+    int lReady;            /* Made ready and not run since. */
+    uint64_t ullReadyTime;
+    Samples_t xLatency;
+    Samples_t xSlices;
+} Task_t;
+
+typedef struct Block
+{
+    uint32_t ulAddress;
+    uint32_t ulSize;
+} Block_t;
+
+/*-----------------------------------------------------------*/
+
+static Task_t * pxTasks;
+static Block_t * pxBlocks;
+static FILE * pxJson;
+static double dHz = DEFAULT_HZ;
+static uint64_t ullFirstTime;
+static int lFirstEvent = 1;
+static uint64_t ullHeapBytes;
+static uint64_t ullDropped;
+static int lBigEndian = 0;
+
+/*-----------------------------------------------------------*/
+
+/* Read a field of a record in the byte order of the target. */
+static uint32_t prvRead32( const uint8_t * pucData )
+{
+    if( lBigEndian != 0 )
+    {
+        return ( ( uint32_t ) pucData[ 0 ] << 24 ) | ( ( uint32_t ) pucData[ 1 ] << 16 ) |
+               ( ( uint32_t ) pucData[ 2 ] << 8 ) | ( uint32_t ) pucData[ 3 ];
+    }
+
+    return ( uint32_t ) pucData[ 0 ] | ( ( uint32_t ) pucData[ 1 ] << 8 ) |
+           ( ( uint32_t ) pucData[ 2 ] << 16 ) | ( ( uint32_t ) pucData[ 3 ] << 24 );
+}
+
+static uint16_t prvRead16( const uint8_t * pucData )
+{
+    if( lBigEndian != 0 )
+    {
+        return ( uint16_t ) ( ( pucData[ 0 ] << 8 ) | pucData[ 1 ] );
+    }
+
+    return ( uint16_t ) ( pucData[ 0 ] | ( pucData[ 1 ] << 8 ) );
+}
+
+/* Take the byte order of the target from the byte order mark of a start record, 0x01020304. */
+static int prvReadByteOrder( const uint8_t * pucMark )
+{
+    static const uint8_t ucLittle[ 4 ] = { 4U, 3U, 2U, 1U };
+    static const uint8_t ucBig[ 4 ] = { 1U, 2U, 3U, 4U };
+
+    if( memcmp( pucMark, ucLittle, 4U ) == 0 )
+    {
+        lBigEndian = 0;
+    }
+    else if( memcmp( pucMark, ucBig, 4U ) == 0 )
+    {
+        lBigEndian = 1;
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static double prvNs( uint64_t ullCounts )
+{
+    return ( double ) ullCounts * 1e9 / dHz;
+}
+
+/* The time of a record in us since the first record, as Chrome trace events take it. */
+static double prvUs( uint64_t ullTime )
+{
+    return prvNs( ullTime - ullFirstTime ) / 1000.0;
+}
+
+static void prvAddSample( Samples_t * pxSamples,
+                          double dNs )
+{
+    uint32_t ulBucket = 0U;
+
+    if( pxSamples->xCount == pxSamples->xSize )
+    {
+        pxSamples->xSize = ( pxSamples->xSize == 0U ) ? 1024U : pxSamples->xSize * 2U;
+        pxSamples->pdNs = realloc( pxSamples->pdNs, pxSamples->xSize * sizeof( double ) );
+
+        if( pxSamples->pdNs == NULL )
+        {
+            fprintf( stderr, "Out of memory.\n" );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    pxSamples->pdNs[ pxSamples->xCount++ ] = dNs;
+
+    while( ( ulBucket < ( HISTOGRAM_BUCKETS - 1U ) ) && ( dNs >= ( double ) ( 1000ULL << ulBucket ) ) )
+    {
+        ulBucket++;
+    }
+
+    pxSamples->ullHistogram[ ulBucket ]++;
+}
+
+static const char * prvTaskName( uint32_t ulTask )
+{
+    static char cName[ NAME_LEN ];
+
+    if( pxTasks[ ulTask ].cName[ 0 ] != '\0' )
+    {
+        return pxTasks[ ulTask ].cName;
+    }
+
+    ( void ) snprintf( cName, sizeof( cName ), "task %u", ( unsigned ) ulTask );
+
+    return cName;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvJsonEvent( const char * pcFormat,
+                          ... )
+{
+    va_list xArgs;
+
+    if( pxJson != NULL )
+    {
+        fputs( ( lFirstEvent != 0 ) ? "\n" : ",\n", pxJson );
+        lFirstEvent = 0;
+        va_start( xArgs, pcFormat );
+        ( void ) vfprintf( pxJson, pcFormat, xArgs );
+        va_end( xArgs );
+    }
+}
+
+static void prvSlice( uint32_t ulTask,
+                      uint64_t ullStart,
+                      uint64_t ullEnd )
+{
+    prvAddSample( &pxTasks[ ulTask ].xSlices, prvNs( ullEnd - ullStart ) );
+    prvJsonEvent( "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                  prvTaskName( ulTask ), ( unsigned ) ulTask, prvUs( ullStart ), prvUs( ullEnd ) - prvUs( ullStart ) );
+}
+
+static const char * prvQueueEventName( const Record_t * pxRecord )
+{
+    /* The queue types of queue.h: 0 is a queue or a queue set, 1 a mutex, 2 a counting semaphore,
+     * 3 a binary semaphore and 4 a recursive mutex. */
+    int lSemaphore = ( pxRecord->ucInfo >= 1U ) && ( pxRecord->ucInfo <= 4U );
+    int lSend = ( pxRecord->ucEvent == EVENT_QUEUE_SEND ) || ( pxRecord->ucEvent == EVENT_QUEUE_SEND_FROM_ISR );
+
+    if( lSemaphore != 0 )
+    {
+        return ( lSend != 0 ) ? "give" : "take";
+    }
+
+    return ( lSend != 0 ) ? "send" : "receive";
+}
+
+/* Remember the size of an allocated block, so its free can be taken off the heap in use. The free
+ * records the size of the whole block, which may be larger than the allocation. */
+static void prvHeapEvent( const Record_t * pxRecord )
+{
+    uint32_t ulSlot = ( pxRecord->ulObject >> 3 ) % BLOCK_TABLE_SIZE, ulProbe;
+
+    for( ulProbe = 0U; ulProbe < BLOCK_TABLE_SIZE; ulProbe++, ulSlot = ( ulSlot + 1U ) % BLOCK_TABLE_SIZE )
+    {
+        if( pxRecord->ucEvent == EVENT_MALLOC )
+        {
+            if( ( pxBlocks[ ulSlot ].ulAddress == 0U ) || ( pxBlocks[ ulSlot ].ulAddress == pxRecord->ulObject ) )
+            {
+                pxBlocks[ ulSlot ].ulAddress = pxRecord->ulObject;
+                pxBlocks[ ulSlot ].ulSize = pxRecord->ulValue;
+                ullHeapBytes += pxRecord->ulValue;
+                break;
+            }
+        }
+        else if( pxBlocks[ ulSlot ].ulAddress == pxRecord->ulObject )
+        {
+            ullHeapBytes -= pxBlocks[ ulSlot ].ulSize;
+            pxBlocks[ ulSlot ].ulSize = 0U;
+
+            /* Keep the slot taken by an address that is never used, so the probes of the other
+             * blocks still find them. */
+            pxBlocks[ ulSlot ].ulAddress = 1U;
+            break;
+        }
+        else if( pxBlocks[ ulSlot ].ulAddress == 0U )
+        {
+            /* Allocated before the trace started. */
+            break;
+        }
+    }
+
+    prvJsonEvent( "{\"name\":\"heap\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"bytes\":%llu}}",
+                  prvUs( pxRecord->ullTime ), ( unsigned long long ) ullHeapBytes );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvCompareDoubles( const void * pvA,
+                              const void * pvB )
+{
+    double dA = *( const double * ) pvA;
+    double dB = *( const double * ) pvB;
+
+    return ( dA > dB ) - ( dA < dB );
+}
+
+static void prvPrintStats( Samples_t * pxSamples )
+{
+    double dSum = 0.0;
+    size_t x;
+
+    if( pxSamples->xCount == 0U )
+    {
+        printf( " %8u %10s %10s %10s", 0U, "-", "-", "-" );
+        return;
+    }
+
+    qsort( pxSamples->pdNs, pxSamples->xCount, sizeof( double ), prvCompareDoubles );
+
+    for( x = 0U; x < pxSamples->xCount; x++ )
+    {
+        dSum += pxSamples->pdNs[ x ];
+    }
+
+    printf( " %8u %10.2f %10.2f %10.2f", ( unsigned ) pxSamples->xCount, dSum / ( double ) pxSamples->xCount / 1000.0,
+            pxSamples->pdNs[ ( pxSamples->xCount * 99U ) / 100U ] / 1000.0, pxSamples->pdNs[ pxSamples->xCount - 1U ] / 1000.0 );
+}
+
+static void prvPrintHistogram( const char * pcTitle,
+                               size_t xOffset )
+{
+    uint64_t ullTotal[ HISTOGRAM_BUCKETS ] = { 0U }, ullMax = 0U;
+    uint32_t ulTask, ulBucket, ulFirst = HISTOGRAM_BUCKETS, ulLast = 0U;
+    const Samples_t * pxSamples;
+
+    for( ulTask = 0U; ulTask < MAX_TASKS; ulTask++ )
+    {
+        pxSamples = ( const Samples_t * ) ( ( const uint8_t * ) &pxTasks[ ulTask ] + xOffset );
+
+        for( ulBucket = 0U; ulBucket < HISTOGRAM_BUCKETS; ulBucket++ )
+        {
+            ullTotal[ ulBucket ] += pxSamples->ullHistogram[ ulBucket ];
+        }
+    }
+
+    for( ulBucket = 0U; ulBucket < HISTOGRAM_BUCKETS; ulBucket++ )
+    {
+        if( ullTotal[ ulBucket ] > 0U )
+        {
+            ulFirst = ( ulFirst == HISTOGRAM_BUCKETS ) ? ulBucket : ulFirst;
+            ulLast = ulBucket;
+            ullMax = ( ullTotal[ ulBucket ] > ullMax ) ? ullTotal[ ulBucket ] : ullMax;
+        }
+    }
+
+    printf( "\n%s, all tasks:\n", pcTitle );
+
+    for( ulBucket = ulFirst; ulBucket <= ulLast; ulBucket++ )
+    {
+        printf( "  < %9.0f us %10llu %.*s\n", ( double ) ( 1ULL << ulBucket ), ( unsigned long long ) ullTotal[ ulBucket ],
+                ( int ) ( ( ullTotal[ ulBucket ] * 50U + ullMax - 1U ) / ullMax ), "##################################################" );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    const char * pcTracePath = NULL, * pcJsonPath = NULL;
+    uint8_t ucData[ RECORD_SIZE ];
+    Record_t xRecord;
+    FILE * pxTrace;
+    uint64_t ullRecords = 0U, ullSliceStart = 0U;
+    uint32_t ulLastStamp = 0U, ulStamp, ulRunning = MAX_TASKS, ulTask;
+    char cName[ 9 ];
+    int lArg;
+
+    for( lArg = 1; lArg < argc; lArg++ )
+    {
+        if( ( strcmp( argv[ lArg ], "-f" ) == 0 ) && ( lArg + 1 < argc ) )
+        {
+            dHz = strtod( argv[ ++lArg ], NULL );
+        }
+        else if( ( strcmp( argv[ lArg ], "-o" ) == 0 ) && ( lArg + 1 < argc ) )
+        {
+            pcJsonPath = argv[ ++lArg ];
+        }
+        else
+        {
+            pcTracePath = argv[ lArg ];
+        }
+    }
+
+    if( ( pcTracePath == NULL ) || ( dHz <= 0.0 ) )
+    {
+        fprintf( stderr, "usage: %s [-f time stamp Hz] [-o JSON file] trace file\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    pxTrace = fopen( pcTracePath, "rb" );
+    pxTasks = calloc( MAX_TASKS, sizeof( Task_t ) );
+    pxBlocks = calloc( BLOCK_TABLE_SIZE, sizeof( Block_t ) );
+
+    if( ( pxTrace == NULL ) || ( pxTasks == NULL ) || ( pxBlocks == NULL ) )
+    {
+        fprintf( stderr, "Failed to read %s.\n", pcTracePath );
+        return EXIT_FAILURE;
+    }
+
+    if( pcJsonPath != NULL )
+    {
+        pxJson = fopen( pcJsonPath, "w" );
+
+        if( pxJson == NULL )
+        {
+            fprintf( stderr, "Failed to write %s.\n", pcJsonPath );
+            return EXIT_FAILURE;
+        }
+
+        fputs( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", pxJson );
+    }
+
+    while( fread( ucData, 1U, RECORD_SIZE, pxTrace ) == RECORD_SIZE )
+    {
+        /* The start record is the first one of the ring and only tells the byte order. The event
+         * is a single byte, so it is found in either. */
+        if( ucData[ 4 ] == EVENT_START )
+        {
+            if( prvReadByteOrder( &ucData[ 8 ] ) != 0 )
+            {
+                fprintf( stderr, "%s has a start record of an unknown byte order.\n", pcTracePath );
+                return EXIT_FAILURE;
+            }
+
+            continue;
+        }
+
+        ulStamp = prvRead32( &ucData[ 0 ] );
+
+        if( ullRecords == 0U )
+        {
+            ullFirstTime = ulStamp;
+            xRecord.ullTime = ulStamp;
+        }
+        else
+        {
+            xRecord.ullTime += ( uint32_t ) ( ulStamp - ulLastStamp );
+        }
+
+        ulLastStamp = ulStamp;
+        ullRecords++;
+        xRecord.ucEvent = ucData[ 4 ];
+        xRecord.ucInfo = ucData[ 5 ];
+        xRecord.usTask = prvRead16( &ucData[ 6 ] );
+        xRecord.ulObject = prvRead32( &ucData[ 8 ] );
+        xRecord.ulValue = prvRead32( &ucData[ 12 ] );
+        ulTask = xRecord.usTask;
+
+        switch( xRecord.ucEvent )
+        {
+            case EVENT_TASK_CREATE:
+                ( void ) memcpy( cName, &ucData[ 8 ], 8U );
+                cName[ 8 ] = '\0';
+                ( void ) snprintf( pxTasks[ ulTask ].cName, NAME_LEN, "%s", cName );
+                pxTasks[ ulTask ].lSeen = 1;
+                break;
+
+            case EVENT_TASK_DELETE:
+                prvJsonEvent( "{\"name\":\"delete %s\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"ts\":%.3f}",
+                              prvTaskName( ulTask ), prvUs( xRecord.ullTime ) );
+                break;
+
+            case EVENT_TASK_READY:
+
+                if( pxTasks[ ulTask ].lReady == 0 )
+                {
+                    pxTasks[ ulTask ].lReady = 1;
+                    pxTasks[ ulTask ].ullReadyTime = xRecord.ullTime;
+                }
+
+                break;
+
+            case EVENT_TASK_SWITCHED_IN:
+                pxTasks[ ulTask ].lSeen = 1;
+
+                /* A task that was made ready has been selected, so its wait is over. The
+                 * scheduler also selects the running task again, which doesn't end its slice. */
+                if( pxTasks[ ulTask ].lReady != 0 )
+                {
+                    prvAddSample( &pxTasks[ ulTask ].xLatency, prvNs( xRecord.ullTime - pxTasks[ ulTask ].ullReadyTime ) );
+                    pxTasks[ ulTask ].lReady = 0;
+                }
+
+                if( ulTask != ulRunning )
+                {
+                    if( ulRunning < MAX_TASKS )
+                    {
+                        prvSlice( ulRunning, ullSliceStart, xRecord.ullTime );
+                    }
+
+                    ulRunning = ulTask;
+                    ullSliceStart = xRecord.ullTime;
+                }
+
+                break;
+
+            case EVENT_QUEUE_SEND:
+            case EVENT_QUEUE_RECEIVE:
+            case EVENT_QUEUE_SEND_FROM_ISR:
+            case EVENT_QUEUE_RECEIVE_FROM_ISR:
+                prvJsonEvent( "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                              "\"args\":{\"queue\":\"0x%08x\",\"items before\":%u}}",
+                              prvQueueEventName( &xRecord ),
+                              ( unsigned ) ( ( ( xRecord.ucEvent == EVENT_QUEUE_SEND ) || ( xRecord.ucEvent == EVENT_QUEUE_RECEIVE ) ) ?
+                                             ( ( ulRunning < MAX_TASKS ) ? ulRunning : ISR_TID ) : ISR_TID ),
+                              prvUs( xRecord.ullTime ), ( unsigned ) xRecord.ulObject, ( unsigned ) xRecord.ulValue );
+                break;
+
+            case EVENT_MALLOC:
+            case EVENT_FREE:
+
+                if( xRecord.ulObject != 0U )
+                {
+                    prvHeapEvent( &xRecord );
+                }
+                else
+                {
+                    prvJsonEvent( "{\"name\":\"malloc failed\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"ts\":%.3f,\"args\":{\"bytes\":%u}}",
+                                  prvUs( xRecord.ullTime ), ( unsigned ) xRecord.ulValue );
+                }
+
+                break;
+
+            case EVENT_DROPPED:
+                ullDropped += xRecord.ulValue;
+                prvJsonEvent( "{\"name\":\"%u dropped\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"ts\":%.3f}",
+                              ( unsigned ) xRecord.ulValue, prvUs( xRecord.ullTime ) );
+                break;
+
+            default:
+                /* An event of the application's own. */
+                prvJsonEvent( "{\"name\":\"event %u\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"ts\":%.3f,"
+                              "\"args\":{\"object\":%u,\"value\":%u}}",
+                              ( unsigned ) xRecord.ucEvent, prvUs( xRecord.ullTime ), ( unsigned ) xRecord.ulObject,
+                              ( unsigned ) xRecord.ulValue );
+                break;
+        }
+    }
+
+    ( void ) fclose( pxTrace );
+
+    if( ullRecords == 0U )
+    {
+        fprintf( stderr, "No records in %s.\n", pcTracePath );
+        return EXIT_FAILURE;
+    }
+
+    if( pxJson != NULL )
+    {
+        prvJsonEvent( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"interrupts\"}}", ISR_TID );
+
+        for( ulTask = 0U; ulTask < MAX_TASKS; ulTask++ )
+        {
+            if( pxTasks[ ulTask ].lSeen != 0 )
+            {
+                prvJsonEvent( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                              ( unsigned ) ulTask, prvTaskName( ulTask ) );
+            }
+        }
+
+        fputs( "\n]}\n", pxJson );
+        ( void ) fclose( pxJson );
+    }
+
+    printf( "%llu records over %.3f ms, %llu dropped\n\n", ( unsigned long long ) ullRecords,
+            prvNs( xRecord.ullTime - ullFirstTime ) / 1e6, ( unsigned long long ) ullDropped );
+    printf( "%-16s %8s %10s %10s %10s %8s %10s %10s %10s\n", "", "wakes", "mean us", "p99 us", "max us",
+            "slices", "mean us", "p99 us", "max us" );
+
+    for( ulTask = 0U; ulTask < MAX_TASKS; ulTask++ )
+    {
+        if( pxTasks[ ulTask ].lSeen != 0 )
+        {
+            printf( "%-16s", prvTaskName( ulTask ) );
+            prvPrintStats( &pxTasks[ ulTask ].xLatency );
+            prvPrintStats( &pxTasks[ ulTask ].xSlices );
+            printf( "\n" );
+        }
+    }
+
+    prvPrintHistogram( "Wake latency", offsetof( Task_t, xLatency ) );
+    prvPrintHistogram( "Slice length", offsetof( Task_t, xSlices ) );
+
+    return EXIT_SUCCESS;
+}
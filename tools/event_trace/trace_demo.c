@@ -0,0 +1,356 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file trace_demo.c
+ * @brief Records a trace of a small FreeRTOS application with the built in event recorder.
+ *
+ * Usage:
+ *   trace_demo [seconds] [trace file]
+ *
+ * Runs a producer and a consumer task that pass items through a queue, a task that allocates
+ * and frees blocks of the heap, and the tick hook, which sends to a queue from the interrupt
+ * context of the port, for the given number of seconds, 2 by default. A task of low priority
+ * drains the recorder to the trace file, trace.bin by default, every 10 ms. Then the cost of
+ * recording an event is measured and reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+    #include <x86intrin.h>
+#endif
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "event_trace.h"
+
+#define DEFAULT_SECONDS          2U
+#define DRAIN_PERIOD_MS          10U
+#define QUEUE_LENGTH             8U
+#define TICK_HOOK_PERIOD         5U         /* Ticks between the sends of the tick hook. */
+#define MAX_BLOCKS               16U
+#define COST_ROUNDS              256U       /* Each of configEVENT_TRACE_RECORDS - 1 events. */
+#define DEMO_EVENT               ( ( uint8_t ) 200 ) /* An event of the application's own. */
+#define DRAIN_TASK_PRIORITY      ( tskIDLE_PRIORITY + 1 )
+#define WORKER_TASK_PRIORITY     ( tskIDLE_PRIORITY + 2 )
+#define PRODUCER_TASK_PRIORITY   ( tskIDLE_PRIORITY + 3 )
+#define CONSUMER_TASK_PRIORITY   ( tskIDLE_PRIORITY + 4 )
+#define TASK_STACK_SIZE          ( configMINIMAL_STACK_SIZE * 2 )
+
+/*-----------------------------------------------------------*/
+
+static uint32_t ulSeconds = DEFAULT_SECONDS;
+static const char * pcTracePath = "trace.bin";
+static FILE * pxTraceFile;
+static QueueHandle_t xItemQueue;
+static QueueHandle_t xTickQueue;
+static volatile BaseType_t xStopping = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xTime;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+
+static uint64_t prvNowCycles( void )
+{
+    #if defined( __x86_64__ ) || defined( __i386__ )
+        return __rdtsc();
+    #else
+        return 0U;
+    #endif
+}
+
+uint32_t ulTraceTimestamp( void )
+{
+    return ( uint32_t ) prvNowNs();
+}
+
+void vAssertCalled( const char * pcFile,
+                    uint32_t ulLine )
+{
+    fprintf( stderr, "Assert failed at %s:%u.\n", pcFile, ( unsigned ) ulLine );
+    abort();
+}
+
+/* The interrupt context of the port, which sends the tick count to a queue every few ticks until
+ * the demo stops. The tick hook is called with the scheduler suspended too. */
+
+void vApplicationTickHook( void )
+{
+    TickType_t xTicks = xTaskGetTickCountFromISR();
+    BaseType_t xWoken = pdFALSE;
+
+    if( ( xStopping == pdFALSE ) && ( xTickQueue != NULL ) && ( ( xTicks % TICK_HOOK_PERIOD ) == 0U ) )
+    {
+        ( void ) xQueueSendFromISR( xTickQueue, &xTicks, &xWoken );
+        portYIELD_FROM_ISR( xWoken );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* A xorshift generator with its state in the task. rand() takes a lock of the C library, which a
+ * task of higher priority would wait for forever if the task holding it were switched out. */
+
+static uint32_t prvRandom( uint32_t * pulState )
+{
+    uint32_t ulValue = *pulState;
+
+    ulValue ^= ulValue << 13;
+    ulValue ^= ulValue >> 17;
+    ulValue ^= ulValue << 5;
+    *pulState = ulValue;
+
+    return ulValue;
+}
+
+/* Sends a burst of items every tick to the consumer, which has a higher priority, so each send
+ * wakes the consumer. */
+
+static void prvProducerTask( void * pvParameters )
+{
+    uint32_t ulItem = 0U, ulBurst, ulRandom = 1U;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        for( ulBurst = 1U + ( prvRandom( &ulRandom ) % 4U ); ulBurst > 0U; ulBurst-- )
+        {
+            ( void ) xQueueSend( xItemQueue, &ulItem, portMAX_DELAY );
+            ulItem++;
+        }
+
+        vTaskDelay( 1 );
+    }
+}
+
+static void prvConsumerTask( void * pvParameters )
+{
+    uint32_t ulItem;
+    TickType_t xTicks;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        if( xQueueReceive( xItemQueue, &ulItem, 0 ) != pdPASS )
+        {
+            if( xQueueReceive( xTickQueue, &xTicks, 0 ) != pdPASS )
+            {
+                ( void ) xQueueReceive( xItemQueue, &ulItem, 1 );
+            }
+        }
+    }
+}
+
+/* Allocates and frees blocks of random sizes and spins for a while between them, so it is
+ * preempted by the other tasks. */
+
+static void prvWorkerTask( void * pvParameters )
+{
+    void * pvBlocks[ MAX_BLOCKS ] = { NULL };
+    uint32_t ulBlock, ulRandom = 2U;
+    volatile uint32_t ulSpin;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        ulBlock = prvRandom( &ulRandom ) % MAX_BLOCKS;
+
+        if( pvBlocks[ ulBlock ] != NULL )
+        {
+            vPortFree( pvBlocks[ ulBlock ] );
+            pvBlocks[ ulBlock ] = NULL;
+        }
+        else
+        {
+            pvBlocks[ ulBlock ] = pvPortMalloc( 16U + ( ( size_t ) prvRandom( &ulRandom ) % 1024U ) );
+        }
+
+        for( ulSpin = 0U; ulSpin < 20000U; ulSpin++ )
+        {
+        }
+
+        if( ( prvRandom( &ulRandom ) % 8U ) == 0U )
+        {
+            vTaskDelay( 1 );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvWriteToFile( void * pvContext,
+                              const uint8_t * pucData,
+                              size_t xLength )
+{
+    return fwrite( pucData, 1U, xLength, ( FILE * ) pvContext );
+}
+
+/* Called with the scheduler suspended. Times events of the application's own, in rounds that
+ * fill the ring but one record, which is emptied between the rounds, so every event is recorded
+ * and none is dropped. The time stamp of the host takes most of that, while on a target it is a
+ * read of a cycle counter, so it is timed on its own as well. */
+
+static void prvMeasureCost( void )
+{
+    EventTraceRecord_t xRecord;
+    uint64_t ullNs = 0U, ullCycles = 0U, ullClockNs = 0U, ullClockCycles = 0U, ullStartNs, ullStartCycles;
+    uint32_t ulRound, ulEvent;
+    const uint32_t ulEvents = configEVENT_TRACE_RECORDS - 1U;
+    const double dEvents = ( double ) COST_ROUNDS * ulEvents;
+    volatile uint32_t ulTimestamp;
+
+    for( ulRound = 0U; ulRound < COST_ROUNDS; ulRound++ )
+    {
+        while( xEventTraceRead( &xRecord, 1U ) > 0U )
+        {
+        }
+
+        ullStartNs = prvNowNs();
+        ullStartCycles = prvNowCycles();
+
+        for( ulEvent = 0U; ulEvent < ulEvents; ulEvent++ )
+        {
+            vEventTraceRecord( DEMO_EVENT, 0U, 0U, ulEvent, ulRound );
+        }
+
+        ullCycles += prvNowCycles() - ullStartCycles;
+        ullNs += prvNowNs() - ullStartNs;
+
+        ullStartNs = prvNowNs();
+        ullStartCycles = prvNowCycles();
+
+        for( ulEvent = 0U; ulEvent < ulEvents; ulEvent++ )
+        {
+            ulTimestamp = portEVENT_TRACE_TIMESTAMP();
+        }
+
+        ullClockCycles += prvNowCycles() - ullStartCycles;
+        ullClockNs += prvNowNs() - ullStartNs;
+    }
+
+    ( void ) ulTimestamp;
+
+    printf( "record: %.1f ns, %.1f cycles\n", ( double ) ullNs / dEvents, ( double ) ullCycles / dEvents );
+    printf( "time stamp: %.1f ns, %.1f cycles\n", ( double ) ullClockNs / dEvents, ( double ) ullClockCycles / dEvents );
+    printf( "record without the time stamp: %.1f ns, %.1f cycles\n", ( double ) ( ullNs - ullClockNs ) / dEvents,
+            ( double ) ( ullCycles - ullClockCycles ) / dEvents );
+}
+
+/* Drains the recorder to the trace file, and stops the demo after the given time. */
+
+static void prvDrainTask( void * pvParameters )
+{
+    const TickType_t xEnd = xTaskGetTickCount() + pdMS_TO_TICKS( ulSeconds * 1000U );
+    size_t xRecords = 0U;
+    uint32_t ulDropped;
+
+    ( void ) pvParameters;
+
+    while( xTaskGetTickCount() < xEnd )
+    {
+        vTaskDelay( pdMS_TO_TICKS( DRAIN_PERIOD_MS ) );
+        xRecords += xEventTraceDrain( prvWriteToFile, pxTraceFile );
+    }
+
+    /* Stop the other tasks and the tick hook before the last drain. The other tasks stay
+     * suspended until the demo exits. */
+    vTaskSuspendAll();
+    xStopping = pdTRUE;
+    xRecords += xEventTraceDrain( prvWriteToFile, pxTraceFile );
+    ulDropped = ulEventTraceDropped();
+
+    ( void ) fclose( pxTraceFile );
+    printf( "%u records written to %s, %u dropped\n", ( unsigned ) xRecords, pcTracePath,
+            ( unsigned ) ulDropped );
+
+    prvMeasureCost();
+    exit( ( ulDropped == 0U ) ? EXIT_SUCCESS : EXIT_FAILURE );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvCreateTask( TaskFunction_t pxTask,
+                           const char * pcName,
+                           UBaseType_t uxPriority )
+{
+    if( xTaskCreate( pxTask, pcName, TASK_STACK_SIZE, NULL, uxPriority, NULL ) != pdPASS )
+    {
+        fprintf( stderr, "Failed to create a task.\n" );
+        exit( EXIT_FAILURE );
+    }
+}
+
+int main( int argc,
+          char ** argv )
+{
+    if( argc > 1 )
+    {
+        ulSeconds = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( argc > 2 )
+    {
+        pcTracePath = argv[ 2 ];
+    }
+
+    if( ulSeconds == 0U )
+    {
+        fprintf( stderr, "usage: %s [seconds] [trace file]\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    pxTraceFile = fopen( pcTracePath, "wb" );
+    xItemQueue = xQueueCreate( QUEUE_LENGTH, sizeof( uint32_t ) );
+    xTickQueue = xQueueCreate( QUEUE_LENGTH, sizeof( TickType_t ) );
+
+    if( ( pxTraceFile == NULL ) || ( xItemQueue == NULL ) || ( xTickQueue == NULL ) )
+    {
+        fprintf( stderr, "Failed to open %s.\n", pcTracePath );
+        return EXIT_FAILURE;
+    }
+
+    prvCreateTask( prvProducerTask, "Producer", PRODUCER_TASK_PRIORITY );
+    prvCreateTask( prvConsumerTask, "Consumer", CONSUMER_TASK_PRIORITY );
+    prvCreateTask( prvWorkerTask, "Worker", WORKER_TASK_PRIORITY );
+    prvCreateTask( prvDrainTask, "Drain", DRAIN_TASK_PRIORITY );
+
+    vTaskStartScheduler();
+
+    return EXIT_FAILURE;
+}
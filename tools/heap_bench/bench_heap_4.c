@@ -0,0 +1,39 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file bench_heap_4.c
+ * @brief heap_4.c with its functions renamed, so heap_bench links it together with the other heap.
+ */
+
+#define pvPortMalloc                       pvHeap4Malloc
+#define vPortFree                          vHeap4Free
+#define xPortGetFreeHeapSize               xHeap4GetFreeHeapSize
+#define xPortGetMinimumEverFreeHeapSize    xHeap4GetMinimumEverFreeHeapSize
+#define vPortGetHeapStats                  vHeap4GetHeapStats
+#define vPortInitialiseBlocks              vHeap4InitialiseBlocks
+#define vPortDefineHeapRegions             vHeap4DefineHeapRegions
+
+#include "heap_4.c"
@@ -0,0 +1,507 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file heap_bench.c
+ * @brief Replays allocation traces against heap_4.c and heap_6.c.
+ *
+ * Usage:
+ *   heap_bench [-r random operations] [trace file ...]
+ *
+ * Each workload is a sequence of allocations and frees: a random one with sizes from 8 bytes
+ * to 2 KB and up to RANDOM_MAX_LIVE blocks allocated at a time, and one per trace file. A trace
+ * has a line "m <address> <size>" per allocation and "f <address>" per free, as written by
+ * tools/ota_throughput with -m. The workloads are replayed against both heaps, which are linked
+ * into the tool with their functions renamed and given the same configTOTAL_HEAP_SIZE bytes.
+ * Every operation is timed, every allocated block is filled and checked again before it is
+ * freed, and the heap must be back to a single free block after each workload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define DEFAULT_RANDOM_OPS    200000U
+#define RANDOM_MAX_LIVE       400U
+#define STATS_INTERVAL        32U  /* Operations between samples of the fragmentation. */
+#define MAX_LINE_LEN          128U
+
+/* An allocation or a free of a workload. The blocks of a workload are numbered in order of
+ * allocation. */
+
+typedef struct
+{
+    uint32_t ulBlock;
+    uint32_t ulSize;  /* 0 for a free. */
+} Op_t;
+
+typedef struct
+{
+    const char * pcName;
+    Op_t * pxOps;
+    uint32_t ulOps;
+    uint32_t ulBlocks;
+} Workload_t;
+
+typedef struct
+{
+    const char * pcName;
+    void * ( * pvMalloc )( size_t xSize );
+    void ( * vFree )( void * pv );
+    void ( * vGetHeapStats )( HeapStats_t * pxHeapStats );
+    size_t ( * xGetFreeHeapSize )( void );
+    size_t xInitialFree;
+} Heap_t;
+
+/* Statistics of a run of the operations of one kind. */
+
+typedef struct
+{
+    uint32_t * pulNs;
+    uint32_t ulCount;
+} Timing_t;
+
+extern void * pvHeap4Malloc( size_t xSize );
+extern void vHeap4Free( void * pv );
+extern void vHeap4GetHeapStats( HeapStats_t * pxHeapStats );
+extern size_t xHeap4GetFreeHeapSize( void );
+extern void * pvHeap6Malloc( size_t xSize );
+extern void vHeap6Free( void * pv );
+extern void vHeap6GetHeapStats( HeapStats_t * pxHeapStats );
+extern size_t xHeap6GetFreeHeapSize( void );
+extern void vHeap6DefineHeapRegions( const HeapRegion_t * const pxHeapRegions );
+
+/* heap_4.c is built with configAPPLICATION_ALLOCATED_HEAP, and heap_6.c gets a region of the same
+ * size. */
+uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+static uint8_t ucHeap6[ configTOTAL_HEAP_SIZE ];
+
+static Heap_t xHeaps[] =
+{
+    { "heap_4", pvHeap4Malloc, vHeap4Free, vHeap4GetHeapStats, xHeap4GetFreeHeapSize, 0U },
+    { "heap_6", pvHeap6Malloc, vHeap6Free, vHeap6GetHeapStats, xHeap6GetFreeHeapSize, 0U },
+};
+
+#define NUM_HEAPS    ( sizeof( xHeaps ) / sizeof( xHeaps[ 0 ] ) )
+
+static uint32_t ulRandom = 0x2545F491UL;
+
+/*-----------------------------------------------------------*/
+
+/* The heaps suspend the scheduler around their lists. There is no scheduler here. */
+
+void vTaskSuspendAll( void )
+{
+}
+
+BaseType_t xTaskResumeAll( void )
+{
+    return pdFALSE;
+}
+
+void vAssertCalled( const char * pcFile,
+                    uint32_t ulLine )
+{
+    fprintf( stderr, "Assertion failed in %s line %u.\n", pcFile, ( unsigned ) ulLine );
+    abort();
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( void )
+{
+    /* xorshift32. */
+    ulRandom ^= ulRandom << 13;
+    ulRandom ^= ulRandom >> 17;
+    ulRandom ^= ulRandom << 5;
+
+    return ulRandom;
+}
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000ULL ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+static int prvCompareNs( const void * pvA,
+                         const void * pvB )
+{
+    uint32_t ulA = *( const uint32_t * ) pvA, ulB = *( const uint32_t * ) pvB;
+
+    return ( ulA > ulB ) - ( ulA < ulB );
+}
+
+static BaseType_t prvAddOp( Workload_t * pxWork,
+                            uint32_t * pulCapacity,
+                            uint32_t ulBlock,
+                            uint32_t ulSize )
+{
+    Op_t * pxOps;
+
+    if( pxWork->ulOps == *pulCapacity )
+    {
+        *pulCapacity = ( *pulCapacity == 0U ) ? 1024U : ( *pulCapacity * 2U );
+        pxOps = realloc( pxWork->pxOps, *pulCapacity * sizeof( Op_t ) );
+
+        if( pxOps == NULL )
+        {
+            return pdFAIL;
+        }
+
+        pxWork->pxOps = pxOps;
+    }
+
+    pxWork->pxOps[ pxWork->ulOps ].ulBlock = ulBlock;
+    pxWork->pxOps[ pxWork->ulOps ].ulSize = ulSize;
+    pxWork->ulOps++;
+
+    return pdPASS;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Random sizes, and random blocks freed, with the number of allocated blocks wandering between
+ * none and RANDOM_MAX_LIVE. */
+
+static BaseType_t prvMakeRandomWorkload( Workload_t * pxWork,
+                                         uint32_t ulOps )
+{
+    uint32_t ulLive[ RANDOM_MAX_LIVE ];
+    uint32_t ulLiveCount = 0U, ulCapacity = 0U, ulIndex, ulSize;
+    BaseType_t xResult = pdPASS;
+
+    pxWork->pcName = "random";
+
+    while( ( xResult == pdPASS ) && ( pxWork->ulOps < ulOps ) )
+    {
+        if( ( ulLiveCount == 0U ) || ( ( ulLiveCount < RANDOM_MAX_LIVE ) && ( ( prvRandom() & 1U ) != 0U ) ) )
+        {
+            ulSize = 8U << ( prvRandom() % 8U );
+            ulSize += prvRandom() % ulSize;
+            ulLive[ ulLiveCount++ ] = pxWork->ulBlocks;
+            xResult = prvAddOp( pxWork, &ulCapacity, pxWork->ulBlocks++, ulSize );
+        }
+        else
+        {
+            ulIndex = prvRandom() % ulLiveCount;
+            xResult = prvAddOp( pxWork, &ulCapacity, ulLive[ ulIndex ], 0U );
+            ulLive[ ulIndex ] = ulLive[ --ulLiveCount ];
+        }
+    }
+
+    return xResult;
+}
+
+/* Blocks are identified by their address in the trace, which is reused once the block is freed.
+ * Frees of blocks allocated before the trace started are left out. */
+
+static BaseType_t prvReadTrace( Workload_t * pxWork,
+                                const char * pcPath )
+{
+    FILE * pxFile = fopen( pcPath, "r" );
+    char cLine[ MAX_LINE_LEN ];
+    unsigned long long ullAddress, * pullLiveAddress = NULL;
+    uint32_t * pulLiveBlock = NULL;
+    uint32_t ulLiveCount = 0U, ulLiveCapacity = 0U, ulCapacity = 0U, ulIndex;
+    unsigned uSize;
+    BaseType_t xResult = pdPASS;
+
+    pxWork->pcName = pcPath;
+
+    if( pxFile == NULL )
+    {
+        fprintf( stderr, "Failed to open the trace %s.\n", pcPath );
+        return pdFAIL;
+    }
+
+    while( ( xResult == pdPASS ) && ( fgets( cLine, sizeof( cLine ), pxFile ) != NULL ) )
+    {
+        if( sscanf( cLine, "m %llx %u", &ullAddress, &uSize ) == 2 )
+        {
+            if( ulLiveCount == ulLiveCapacity )
+            {
+                ulLiveCapacity = ( ulLiveCapacity == 0U ) ? 256U : ( ulLiveCapacity * 2U );
+                pullLiveAddress = realloc( pullLiveAddress, ulLiveCapacity * sizeof( *pullLiveAddress ) );
+                pulLiveBlock = realloc( pulLiveBlock, ulLiveCapacity * sizeof( *pulLiveBlock ) );
+
+                if( ( pullLiveAddress == NULL ) || ( pulLiveBlock == NULL ) )
+                {
+                    xResult = pdFAIL;
+                    break;
+                }
+            }
+
+            pullLiveAddress[ ulLiveCount ] = ullAddress;
+            pulLiveBlock[ ulLiveCount++ ] = pxWork->ulBlocks;
+            xResult = prvAddOp( pxWork, &ulCapacity, pxWork->ulBlocks++, ( uSize > 0U ) ? ( uint32_t ) uSize : 1U );
+        }
+        else if( sscanf( cLine, "f %llx", &ullAddress ) == 1 )
+        {
+            for( ulIndex = ulLiveCount; ulIndex > 0U; ulIndex-- )
+            {
+                if( pullLiveAddress[ ulIndex - 1U ] == ullAddress )
+                {
+                    xResult = prvAddOp( pxWork, &ulCapacity, pulLiveBlock[ ulIndex - 1U ], 0U );
+                    ulLiveCount--;
+                    pullLiveAddress[ ulIndex - 1U ] = pullLiveAddress[ ulLiveCount ];
+                    pulLiveBlock[ ulIndex - 1U ] = pulLiveBlock[ ulLiveCount ];
+                    break;
+                }
+            }
+        }
+    }
+
+    free( pullLiveAddress );
+    free( pulLiveBlock );
+    ( void ) fclose( pxFile );
+
+    if( xResult != pdPASS )
+    {
+        fprintf( stderr, "Out of memory reading the trace %s.\n", pcPath );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPrintTiming( Timing_t * pxTiming )
+{
+    uint64_t ullSumNs = 0U;
+    uint32_t ulIndex;
+
+    if( pxTiming->ulCount == 0U )
+    {
+        printf( " %7s %6s %7s", "-", "-", "-" );
+        return;
+    }
+
+    for( ulIndex = 0U; ulIndex < pxTiming->ulCount; ulIndex++ )
+    {
+        ullSumNs += pxTiming->pulNs[ ulIndex ];
+    }
+
+    qsort( pxTiming->pulNs, pxTiming->ulCount, sizeof( uint32_t ), prvCompareNs );
+    printf( " %7.1f %6u %7u", ( double ) ullSumNs / pxTiming->ulCount,
+            ( unsigned ) pxTiming->pulNs[ ( ( uint64_t ) pxTiming->ulCount * 99U ) / 100U ],
+            ( unsigned ) pxTiming->pulNs[ pxTiming->ulCount - 1U ] );
+}
+
+/* Replay a workload against a heap and print the results. The heap must be empty before and is
+ * empty again after. */
+
+static BaseType_t prvReplay( const Workload_t * pxWork,
+                             Heap_t * pxHeap )
+{
+    void ** ppvBlocks = calloc( pxWork->ulBlocks, sizeof( void * ) );
+    uint32_t * pulSizes = calloc( pxWork->ulBlocks, sizeof( uint32_t ) );
+    Timing_t xMalloc = { calloc( pxWork->ulOps, sizeof( uint32_t ) ), 0U };
+    Timing_t xFree = { calloc( pxWork->ulOps, sizeof( uint32_t ) ), 0U };
+    const Op_t * pxOp;
+    HeapStats_t xStats;
+    uint64_t ullStartNs;
+    double dFragmentation = 0.0;
+    size_t xMinFree = pxHeap->xInitialFree, xMaxFreeBlocks = 0U;
+    uint32_t ulIndex, ulSamples = 0U, ulFailed = 0U, ulByte;
+    uint8_t * pucBlock;
+    void * pv;
+    BaseType_t xResult = pdPASS;
+
+    if( ( ppvBlocks == NULL ) || ( pulSizes == NULL ) || ( xMalloc.pulNs == NULL ) || ( xFree.pulNs == NULL ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        return pdFAIL;
+    }
+
+    for( ulIndex = 0U; ( xResult == pdPASS ) && ( ulIndex < pxWork->ulOps ); ulIndex++ )
+    {
+        pxOp = &pxWork->pxOps[ ulIndex ];
+
+        if( pxOp->ulSize != 0U )
+        {
+            ullStartNs = prvNowNs();
+            pv = pxHeap->pvMalloc( pxOp->ulSize );
+            xMalloc.pulNs[ xMalloc.ulCount++ ] = ( uint32_t ) ( prvNowNs() - ullStartNs );
+
+            if( pv == NULL )
+            {
+                ulFailed++;
+            }
+            else if( ( ( size_t ) pv & portBYTE_ALIGNMENT_MASK ) != 0U )
+            {
+                fprintf( stderr, "%s returned an unaligned block.\n", pxHeap->pcName );
+                xResult = pdFAIL;
+            }
+            else
+            {
+                /* Fill the block, so a block that overlaps another is found when either is
+                 * freed. */
+                memset( pv, ( int ) ( pxOp->ulBlock & 0xffU ), pxOp->ulSize );
+                ppvBlocks[ pxOp->ulBlock ] = pv;
+                pulSizes[ pxOp->ulBlock ] = pxOp->ulSize;
+            }
+        }
+        else if( ppvBlocks[ pxOp->ulBlock ] != NULL )
+        {
+            pucBlock = ppvBlocks[ pxOp->ulBlock ];
+
+            for( ulByte = 0U; ulByte < pulSizes[ pxOp->ulBlock ]; ulByte++ )
+            {
+                if( pucBlock[ ulByte ] != ( uint8_t ) pxOp->ulBlock )
+                {
+                    fprintf( stderr, "%s overwrote an allocated block.\n", pxHeap->pcName );
+                    xResult = pdFAIL;
+                    break;
+                }
+            }
+
+            ullStartNs = prvNowNs();
+            pxHeap->vFree( pucBlock );
+            xFree.pulNs[ xFree.ulCount++ ] = ( uint32_t ) ( prvNowNs() - ullStartNs );
+            ppvBlocks[ pxOp->ulBlock ] = NULL;
+        }
+
+        if( ( ulIndex % STATS_INTERVAL ) == 0U )
+        {
+            pxHeap->vGetHeapStats( &xStats );
+
+            if( xStats.xAvailableHeapSpaceInBytes > 0U )
+            {
+                dFragmentation += 1.0 - ( ( double ) xStats.xSizeOfLargestFreeBlockInBytes / xStats.xAvailableHeapSpaceInBytes );
+                ulSamples++;
+            }
+
+            if( xStats.xNumberOfFreeBlocks > xMaxFreeBlocks )
+            {
+                xMaxFreeBlocks = xStats.xNumberOfFreeBlocks;
+            }
+        }
+
+        if( pxHeap->xGetFreeHeapSize() < xMinFree )
+        {
+            xMinFree = pxHeap->xGetFreeHeapSize();
+        }
+    }
+
+    /* Free what the workload left allocated. */
+    for( ulIndex = 0U; ulIndex < pxWork->ulBlocks; ulIndex++ )
+    {
+        pxHeap->vFree( ppvBlocks[ ulIndex ] );
+    }
+
+    pxHeap->vGetHeapStats( &xStats );
+
+    if( ( xResult == pdPASS ) &&
+        ( ( xStats.xAvailableHeapSpaceInBytes != pxHeap->xInitialFree ) || ( xStats.xNumberOfFreeBlocks != 1U ) ) )
+    {
+        fprintf( stderr, "%s isn't a single free block of %u bytes again after %s.\n",
+                 pxHeap->pcName, ( unsigned ) pxHeap->xInitialFree, pxWork->pcName );
+        xResult = pdFAIL;
+    }
+
+    if( xResult == pdPASS )
+    {
+        printf( "%-24s %-7s %8u", pxWork->pcName, pxHeap->pcName, ( unsigned ) pxWork->ulOps );
+        prvPrintTiming( &xMalloc );
+        prvPrintTiming( &xFree );
+        printf( " %7u %8.1f %7.1f %7u\n", ( unsigned ) ulFailed, ( pxHeap->xInitialFree - xMinFree ) / 1024.0,
+                ( ulSamples > 0U ) ? ( 100.0 * dFragmentation / ulSamples ) : 0.0, ( unsigned ) xMaxFreeBlocks );
+    }
+
+    free( ppvBlocks );
+    free( pulSizes );
+    free( xMalloc.pulNs );
+    free( xFree.pulNs );
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    const HeapRegion_t xRegions[] =
+    {
+        { ucHeap6, sizeof( ucHeap6 ) },
+        { NULL,    0U              }
+    };
+    Workload_t xWork;
+    HeapStats_t xStats;
+    uint32_t ulRandomOps = DEFAULT_RANDOM_OPS, ulHeap;
+    int lArg = 1;
+    BaseType_t xResult = pdPASS;
+
+    if( ( argc > 2 ) && ( strcmp( argv[ 1 ], "-r" ) == 0 ) )
+    {
+        ulRandomOps = ( uint32_t ) strtoul( argv[ 2 ], NULL, 10 );
+        lArg = 3;
+    }
+
+    vHeap6DefineHeapRegions( xRegions );
+
+    /* heap_4.c sets itself up on the first allocation. */
+    vHeap4Free( pvHeap4Malloc( 1U ) );
+
+    for( ulHeap = 0U; ulHeap < NUM_HEAPS; ulHeap++ )
+    {
+        xHeaps[ ulHeap ].vGetHeapStats( &xStats );
+        xHeaps[ ulHeap ].xInitialFree = xStats.xAvailableHeapSpaceInBytes;
+    }
+
+    printf( "%-24s %-7s %8s %7s %6s %7s %7s %6s %7s %7s %8s %7s %7s\n", "workload", "heap", "ops",
+            "malloc", "p99", "max", "free", "p99", "max", "failed", "peak KB", "frag %", "blocks" );
+
+    for( ; ( xResult == pdPASS ) && ( lArg <= argc ); lArg++ )
+    {
+        memset( &xWork, 0, sizeof( xWork ) );
+
+        if( lArg == argc )
+        {
+            xResult = ( ulRandomOps > 0U ) ? prvMakeRandomWorkload( &xWork, ulRandomOps ) : pdPASS;
+        }
+        else
+        {
+            xResult = prvReadTrace( &xWork, argv[ lArg ] );
+        }
+
+        for( ulHeap = 0U; ( xResult == pdPASS ) && ( ulHeap < NUM_HEAPS ) && ( xWork.ulOps > 0U ); ulHeap++ )
+        {
+            xResult = prvReplay( &xWork, &xHeaps[ ulHeap ] );
+        }
+
+        free( xWork.pxOps );
+    }
+
+    return ( xResult == pdPASS ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
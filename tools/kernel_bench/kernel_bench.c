@@ -0,0 +1,1192 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file kernel_bench.c
+ * @brief Benchmarks of the FreeRTOS kernel on the Linux/POSIX simulator port.
+ *
+ * Usage:
+ *   kernel_bench [iterations] [timer periods] [-b baseline] [-t tolerance in percent]
+ *
+ * Measures the time the kernel takes for a context switch, a queue round trip between two
+ * tasks, a semaphore give and take, and the wake up of a task by a semaphore and by a task
+ * notification, the jitter of a software timer, the time the timer service takes for a
+ * command and for an expiry with 10, 100 and 1000 active timers, and the time to pass data
+ * through a stream buffer and a message buffer by copying it and in place, and the time per item
+ * to pass batches of 1 to 32 items through a queue, and the time to take and give a mutex, a fast
+ * mutex and a reader-writer lock, alone and shared by tasks that look up a table. Each benchmark runs
+ * in tasks of its own, which are deleted again afterwards. The times include the thread switches of the simulator,
+ * so they are only comparable between runs on the same host. With a baseline, which is the
+ * output of an earlier run, the tool exits with an error if the mean of a benchmark is more
+ * than the tolerance above the baseline. The timer jitter is mostly that of the host timer, so
+ * it is reported but not checked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "timers.h"
+#include "stream_buffer.h"
+#include "message_buffer.h"
+#include "fast_mutex.h"
+
+#define DEFAULT_ITERATIONS           10000U
+#define DEFAULT_TIMER_PERIODS        500U
+#define DEFAULT_TOLERANCE_PERCENT    25U
+#define SEMAPHORE_BATCH              100U  /* Give and take pairs per semaphore and lock sample. */
+#define TIMER_PERIOD_TICKS           2U
+#define TIMER_COMMAND_MIN_TICKS      1000U /* The periods the timer command benchmarks set. */
+#define TIMER_COMMAND_MAX_TICKS      60000U
+#define TIMER_EXPIRY_TICKS           10U   /* The period of the timers that all expire together. */
+#define TIMER_EXPIRY_ROUNDS          100U  /* At most, so few timers don't take long. */
+#define STREAM_BUFFER_BYTES          4096U
+#define STREAM_CHUNK_BYTES           1000U /* Not a divisor of the buffer size, so chunks wrap. */
+#define QUEUE_BATCH_MAX              32U   /* The length of the queue of the batch benchmarks. */
+#define TABLE_ENTRIES                64U   /* The entries of the table the lock benchmarks share. */
+#define TABLE_TASKS                  4U
+#define TABLE_WRITE_PERIOD           16U   /* Each task updates an entry every so many lookups. */
+#define RUN_TASK_PRIORITY            ( tskIDLE_PRIORITY + 1 )
+#define LOW_TASK_PRIORITY            ( tskIDLE_PRIORITY + 2 )
+#define HIGH_TASK_PRIORITY           ( tskIDLE_PRIORITY + 3 )
+#define SETUP_PRIORITY               ( tskIDLE_PRIORITY + 4 ) /* Of the run task while it creates the tasks of a benchmark. */
+#define TASK_STACK_SIZE              ( configMINIMAL_STACK_SIZE * 2 )
+#define MAX_NAME_LEN                 24U
+
+/* A benchmark and its result. */
+
+typedef struct
+{
+    const char * pcName;
+    void ( * pvRun )( void );       /* Fills the samples, in ns. */
+    BaseType_t xCheckBaseline;      /* pdFALSE if the result depends on the host timer more than on the kernel. */
+    uint32_t ulSamples;
+    double dMeanNs;
+    uint32_t ulP99Ns;
+    uint32_t ulMaxNs;
+} Benchmark_t;
+
+static void prvContextSwitch( void );
+static void prvQueuePingPong( void );
+static void prvSemaphore( void );
+static void prvSemaphoreWake( void );
+static void prvNotifyWake( void );
+static void prvTimerJitter( void );
+static void prvTimerCommand10( void );
+static void prvTimerCommand100( void );
+static void prvTimerCommand1000( void );
+static void prvTimerExpiry10( void );
+static void prvTimerExpiry100( void );
+static void prvTimerExpiry1000( void );
+static void prvStreamCopy( void );
+static void prvStreamInPlace( void );
+static void prvMessageCopy( void );
+static void prvMessageInPlace( void );
+static void prvQueueBatch1( void );
+static void prvQueueBatch2( void );
+static void prvQueueBatch4( void );
+static void prvQueueBatch8( void );
+static void prvQueueBatch16( void );
+static void prvQueueBatch32( void );
+static void prvMutex( void );
+static void prvFastMutex( void );
+static void prvRWLockRead( void );
+static void prvTableMutex( void );
+static void prvTableFastMutex( void );
+static void prvTableRWLock( void );
+
+static Benchmark_t xBenchmarks[] =
+{
+    { "context_switch", prvContextSwitch, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "queue_ping_pong", prvQueuePingPong, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "semaphore", prvSemaphore, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "semaphore_wake", prvSemaphoreWake, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "notify_wake", prvNotifyWake, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "timer_jitter", prvTimerJitter, pdFALSE, 0U, 0.0, 0U, 0U },
+    { "timer_command_10", prvTimerCommand10, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "timer_command_100", prvTimerCommand100, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "timer_command_1000", prvTimerCommand1000, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "timer_expiry_10", prvTimerExpiry10, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "timer_expiry_100", prvTimerExpiry100, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "timer_expiry_1000", prvTimerExpiry1000, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "stream_copy", prvStreamCopy, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "stream_in_place", prvStreamInPlace, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "message_copy", prvMessageCopy, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "message_in_place", prvMessageInPlace, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "queue_batch_1", prvQueueBatch1, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "queue_batch_2", prvQueueBatch2, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "queue_batch_4", prvQueueBatch4, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "queue_batch_8", prvQueueBatch8, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "queue_batch_16", prvQueueBatch16, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "queue_batch_32", prvQueueBatch32, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "mutex", prvMutex, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "fast_mutex", prvFastMutex, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "rwlock_read", prvRWLockRead, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "table_mutex", prvTableMutex, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "table_fast_mutex", prvTableFastMutex, pdTRUE, 0U, 0.0, 0U, 0U },
+    { "table_rwlock", prvTableRWLock, pdTRUE, 0U, 0.0, 0U, 0U },
+};
+
+#define NUM_BENCHMARKS    ( sizeof( xBenchmarks ) / sizeof( xBenchmarks[ 0 ] ) )
+
+/* Parameters of the run. */
+
+static uint32_t ulIterations = DEFAULT_ITERATIONS;
+static uint32_t ulTimerPeriods = DEFAULT_TIMER_PERIODS;
+static uint32_t ulTolerancePercent = DEFAULT_TOLERANCE_PERCENT;
+static const char * pcBaselinePath = NULL;
+
+/* The samples of the running benchmark, and the state shared by its tasks. */
+
+static uint32_t * pulSamples;
+static uint32_t ulMaxSamples;
+static volatile uint32_t ulSampleCount;
+static volatile uint64_t ullStartNs;
+static TaskHandle_t xRunTask;
+static TaskHandle_t xHighTask;
+static QueueHandle_t xPingQueue;
+static QueueHandle_t xPongQueue;
+static SemaphoreHandle_t xSemaphore;
+static TimerHandle_t * pxTimers;
+static TickType_t xLastExpiryTick;
+static uint32_t ulExpiryRounds;
+static BaseType_t xExpiryDone;
+static uint8_t ucChunk[ STREAM_CHUNK_BYTES ];
+static volatile uint32_t ulChecksum;
+static uint32_t ulBatchItems;
+static FastMutex_t xFastMutex;
+static RWLock_t xRWLock;
+static uint32_t ulLockKind;
+static uint32_t ulTable[ TABLE_ENTRIES ];
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xTime;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+
+#if ( configUSE_TASK_PROFILING == 1 )
+
+    uint32_t ulRunTimeCounter( void )
+    {
+        return ( uint32_t ) ( prvNowNs() / 1000U );
+    }
+
+#endif
+
+static void prvAddSample( uint64_t ullNs )
+{
+    if( ulSampleCount < ulMaxSamples )
+    {
+        pulSamples[ ulSampleCount ] = ( ullNs > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) ullNs;
+        ulSampleCount++;
+    }
+}
+
+void vAssertCalled( const char * pcFile,
+                    uint32_t ulLine )
+{
+    fprintf( stderr, "Assert failed at %s:%u.\n", pcFile, ( unsigned ) ulLine );
+    abort();
+}
+
+/* Create a task of a benchmark, which notifies the run task when it is done and deletes itself. */
+
+static void prvCreateTask( TaskFunction_t pxTask,
+                           UBaseType_t uxPriority,
+                           TaskHandle_t * pxHandle )
+{
+    if( xTaskCreate( pxTask, "Bench", TASK_STACK_SIZE, NULL, uxPriority, pxHandle ) != pdPASS )
+    {
+        fprintf( stderr, "Failed to create a task.\n" );
+        exit( EXIT_FAILURE );
+    }
+}
+
+static void prvTaskDone( void )
+{
+    ( void ) xTaskNotifyGive( xRunTask );
+    vTaskDelete( NULL );
+}
+
+/* The run task creates the tasks of a benchmark at a priority above them, so they all exist
+ * before the first one runs, then lets them run and waits until they are done. */
+
+static void prvWaitForTasks( uint32_t ulTasks )
+{
+    vTaskPrioritySet( NULL, RUN_TASK_PRIORITY );
+
+    while( ulTasks > 0U )
+    {
+        ( void ) ulTaskNotifyTake( pdFALSE, portMAX_DELAY );
+        ulTasks--;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Two tasks of the same priority yield to each other. Each sample is the time from a yield of
+ * one task to the return from the yield of the other. */
+
+static void prvYieldTask( void * pvParameters )
+{
+    uint32_t ulCount;
+
+    ( void ) pvParameters;
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        if( ullStartNs != 0U )
+        {
+            prvAddSample( prvNowNs() - ullStartNs );
+        }
+
+        ullStartNs = prvNowNs();
+        taskYIELD();
+    }
+
+    prvTaskDone();
+}
+
+static void prvContextSwitch( void )
+{
+    ullStartNs = 0U;
+    prvCreateTask( prvYieldTask, LOW_TASK_PRIORITY, NULL );
+    prvCreateTask( prvYieldTask, LOW_TASK_PRIORITY, NULL );
+    prvWaitForTasks( 2U );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task sends a message to a higher priority task, which sends it back. Each sample is the
+ * round trip, two queue sends, two receives and two context switches. */
+
+static void prvPongTask( void * pvParameters )
+{
+    uint32_t ulMessage;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        ( void ) xQueueReceive( xPingQueue, &ulMessage, portMAX_DELAY );
+        ( void ) xQueueSend( xPongQueue, &ulMessage, portMAX_DELAY );
+
+        if( ulMessage == 0U )
+        {
+            prvTaskDone();
+        }
+    }
+}
+
+static void prvPingTask( void * pvParameters )
+{
+    uint32_t ulMessage, ulCount;
+    uint64_t ullPingNs;
+
+    ( void ) pvParameters;
+
+    for( ulCount = ulIterations; ulCount > 0U; ulCount-- )
+    {
+        ullPingNs = prvNowNs();
+        ulMessage = ulCount - 1U;
+        ( void ) xQueueSend( xPingQueue, &ulMessage, portMAX_DELAY );
+        ( void ) xQueueReceive( xPongQueue, &ulMessage, portMAX_DELAY );
+        prvAddSample( prvNowNs() - ullPingNs );
+    }
+
+    prvTaskDone();
+}
+
+static void prvQueuePingPong( void )
+{
+    xPingQueue = xQueueCreate( 1U, sizeof( uint32_t ) );
+    xPongQueue = xQueueCreate( 1U, sizeof( uint32_t ) );
+    configASSERT( ( xPingQueue != NULL ) && ( xPongQueue != NULL ) );
+
+    prvCreateTask( prvPongTask, HIGH_TASK_PRIORITY, NULL );
+    prvCreateTask( prvPingTask, LOW_TASK_PRIORITY, NULL );
+    prvWaitForTasks( 2U );
+
+    vQueueDelete( xPingQueue );
+    vQueueDelete( xPongQueue );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task gives and takes a binary semaphore nobody else waits for. Each sample is the mean of a
+ * batch of give and take pairs, as a single pair takes little more than reading the clock. */
+
+static void prvSemaphoreTask( void * pvParameters )
+{
+    uint32_t ulCount, ulPair;
+    uint64_t ullBatchNs;
+
+    ( void ) pvParameters;
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        ullBatchNs = prvNowNs();
+
+        for( ulPair = 0U; ulPair < SEMAPHORE_BATCH; ulPair++ )
+        {
+            ( void ) xSemaphoreGive( xSemaphore );
+            ( void ) xSemaphoreTake( xSemaphore, 0U );
+        }
+
+        prvAddSample( ( prvNowNs() - ullBatchNs ) / SEMAPHORE_BATCH );
+    }
+
+    prvTaskDone();
+}
+
+static void prvSemaphore( void )
+{
+    xSemaphore = xSemaphoreCreateBinary();
+    configASSERT( xSemaphore != NULL );
+
+    prvCreateTask( prvSemaphoreTask, LOW_TASK_PRIORITY, NULL );
+    prvWaitForTasks( 1U );
+
+    vSemaphoreDelete( xSemaphore );
+    xSemaphore = NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task wakes a higher priority task that waits for a semaphore or a notification. Each sample
+ * is the time from the give by the lower priority task to the return of the higher priority
+ * task from its wait. */
+
+static void prvWaitTask( void * pvParameters )
+{
+    uint32_t ulCount;
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        if( pvParameters != NULL )
+        {
+            ( void ) xSemaphoreTake( xSemaphore, portMAX_DELAY );
+        }
+        else
+        {
+            ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+        }
+
+        prvAddSample( prvNowNs() - ullStartNs );
+    }
+
+    prvTaskDone();
+}
+
+static void prvWakeTask( void * pvParameters )
+{
+    uint32_t ulCount;
+
+    ( void ) pvParameters;
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        ullStartNs = prvNowNs();
+
+        if( xSemaphore != NULL )
+        {
+            ( void ) xSemaphoreGive( xSemaphore );
+        }
+        else
+        {
+            ( void ) xTaskNotifyGive( xHighTask );
+        }
+    }
+
+    prvTaskDone();
+}
+
+static void prvSemaphoreWake( void )
+{
+    xSemaphore = xSemaphoreCreateBinary();
+    configASSERT( xSemaphore != NULL );
+
+    if( xTaskCreate( prvWaitTask, "Bench", TASK_STACK_SIZE, xSemaphore, HIGH_TASK_PRIORITY, NULL ) != pdPASS )
+    {
+        fprintf( stderr, "Failed to create a task.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    prvCreateTask( prvWakeTask, LOW_TASK_PRIORITY, NULL );
+    prvWaitForTasks( 2U );
+
+    vSemaphoreDelete( xSemaphore );
+    xSemaphore = NULL;
+}
+
+static void prvNotifyWake( void )
+{
+    prvCreateTask( prvWaitTask, HIGH_TASK_PRIORITY, &xHighTask );
+    prvCreateTask( prvWakeTask, LOW_TASK_PRIORITY, NULL );
+    prvWaitForTasks( 2U );
+}
+
+/*-----------------------------------------------------------*/
+
+/* An auto reload timer expires every few ticks. Each sample is the deviation of the time between
+ * two calls of the timer callback from the period of the timer, in either direction. */
+
+static void prvTimerCallback( TimerHandle_t xTimer )
+{
+    const uint64_t ullPeriodNs = ( ( uint64_t ) TIMER_PERIOD_TICKS * 1000000000ULL ) / configTICK_RATE_HZ;
+    uint64_t ullNowNs = prvNowNs();
+    uint64_t ullIntervalNs;
+
+    if( ullStartNs != 0U )
+    {
+        ullIntervalNs = ullNowNs - ullStartNs;
+        prvAddSample( ( ullIntervalNs > ullPeriodNs ) ? ( ullIntervalNs - ullPeriodNs ) : ( ullPeriodNs - ullIntervalNs ) );
+    }
+
+    ullStartNs = ullNowNs;
+
+    /* The timer service calls the callback again for periods the host made it miss before it
+     * stops the timer, so the run task is only notified once. */
+    if( ulSampleCount == ulTimerPeriods )
+    {
+        ( void ) xTimerStop( xTimer, 0U );
+        ( void ) xTaskNotifyGive( xRunTask );
+    }
+}
+
+static void prvTimerJitter( void )
+{
+    TimerHandle_t xTimer;
+
+    ullStartNs = 0U;
+    xTimer = xTimerCreate( "Bench", TIMER_PERIOD_TICKS, pdTRUE, NULL, prvTimerCallback );
+    configASSERT( xTimer != NULL );
+
+    ( void ) xTimerStart( xTimer, portMAX_DELAY );
+    prvWaitForTasks( 1U );
+    ( void ) xTimerDelete( xTimer, portMAX_DELAY );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Create the given number of timers, which are deleted again by prvDeleteTimers(). */
+
+static void prvCreateTimers( uint32_t ulTimers,
+                             TickType_t xPeriod,
+                             UBaseType_t uxAutoReload,
+                             TimerCallbackFunction_t pxCallback )
+{
+    uint32_t ulTimer;
+
+    pxTimers = malloc( ulTimers * sizeof( TimerHandle_t ) );
+    configASSERT( pxTimers != NULL );
+
+    for( ulTimer = 0U; ulTimer < ulTimers; ulTimer++ )
+    {
+        pxTimers[ ulTimer ] = xTimerCreate( "Bench", xPeriod, uxAutoReload, NULL, pxCallback );
+        configASSERT( pxTimers[ ulTimer ] != NULL );
+    }
+}
+
+static void prvDeleteTimers( uint32_t ulTimers )
+{
+    uint32_t ulTimer;
+
+    for( ulTimer = 0U; ulTimer < ulTimers; ulTimer++ )
+    {
+        ( void ) xTimerDelete( pxTimers[ ulTimer ], portMAX_DELAY );
+    }
+
+    free( pxTimers );
+    pxTimers = NULL;
+}
+
+static void prvIdleTimerCallback( TimerHandle_t xTimer )
+{
+    ( void ) xTimer;
+}
+
+/* The given number of timers run with random periods of 1 to 60 seconds. Each sample is the
+ * time xTimerChangePeriod() takes to give one of them a new random period, which includes the
+ * timer service task moving the timer, as it has a higher priority than the run task. */
+
+static void prvTimerCommand( uint32_t ulTimers )
+{
+    uint32_t ulCount;
+    uint64_t ullStartNs;
+    TickType_t xPeriod;
+    TimerHandle_t xTimer;
+
+    srand( 1 );
+    prvCreateTimers( ulTimers, TIMER_COMMAND_MAX_TICKS, pdFALSE, prvIdleTimerCallback );
+
+    for( ulCount = 0U; ulCount < ulTimers; ulCount++ )
+    {
+        xPeriod = TIMER_COMMAND_MIN_TICKS + ( TickType_t ) ( ( uint32_t ) rand() % ( TIMER_COMMAND_MAX_TICKS - TIMER_COMMAND_MIN_TICKS ) );
+        ( void ) xTimerChangePeriod( pxTimers[ ulCount ], xPeriod, portMAX_DELAY );
+    }
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        xTimer = pxTimers[ ( uint32_t ) rand() % ulTimers ];
+        xPeriod = TIMER_COMMAND_MIN_TICKS + ( TickType_t ) ( ( uint32_t ) rand() % ( TIMER_COMMAND_MAX_TICKS - TIMER_COMMAND_MIN_TICKS ) );
+
+        ullStartNs = prvNowNs();
+        ( void ) xTimerChangePeriod( xTimer, xPeriod, portMAX_DELAY );
+        prvAddSample( prvNowNs() - ullStartNs );
+    }
+
+    prvDeleteTimers( ulTimers );
+}
+
+static void prvTimerCommand10( void )
+{
+    prvTimerCommand( 10U );
+}
+
+static void prvTimerCommand100( void )
+{
+    prvTimerCommand( 100U );
+}
+
+static void prvTimerCommand1000( void )
+{
+    prvTimerCommand( 1000U );
+}
+
+/* The given number of auto reload timers all expire on the same tick, again and again. Each
+ * sample is the time from the callback of one timer to the callback of the next on the same tick,
+ * in which the timer service task reloads the timer and finds the next. */
+
+static void prvExpiryCallback( TimerHandle_t xTimer )
+{
+    uint64_t ullNowNs = prvNowNs();
+    TickType_t xNow = xTaskGetTickCount();
+
+    ( void ) xTimer;
+
+    if( xNow == xLastExpiryTick )
+    {
+        prvAddSample( ullNowNs - ullStartNs );
+    }
+    else
+    {
+        xLastExpiryTick = xNow;
+        ulExpiryRounds++;
+
+        if( ( xExpiryDone == pdFALSE ) && ( ( ulSampleCount >= ulIterations ) || ( ulExpiryRounds == TIMER_EXPIRY_ROUNDS ) ) )
+        {
+            xExpiryDone = pdTRUE;
+            ( void ) xTaskNotifyGive( xRunTask );
+        }
+    }
+
+    ullStartNs = prvNowNs();
+}
+
+static void prvTimerExpiry( uint32_t ulTimers )
+{
+    TickType_t xStart;
+    uint32_t ulTimer;
+
+    prvCreateTimers( ulTimers, TIMER_EXPIRY_TICKS, pdTRUE, prvExpiryCallback );
+    xLastExpiryTick = portMAX_DELAY;
+    ulExpiryRounds = 0U;
+    xExpiryDone = pdFALSE;
+
+    /* The timers are started as if at the same time, so they expire together. */
+    xStart = xTaskGetTickCount();
+
+    for( ulTimer = 0U; ulTimer < ulTimers; ulTimer++ )
+    {
+        ( void ) xTimerGenericCommand( pxTimers[ ulTimer ], tmrCOMMAND_START, xStart, NULL, portMAX_DELAY );
+    }
+
+    prvWaitForTasks( 1U );
+    prvDeleteTimers( ulTimers );
+}
+
+static void prvTimerExpiry10( void )
+{
+    prvTimerExpiry( 10U );
+}
+
+static void prvTimerExpiry100( void )
+{
+    prvTimerExpiry( 100U );
+}
+
+static void prvTimerExpiry1000( void )
+{
+    prvTimerExpiry( 1000U );
+}
+
+/*-----------------------------------------------------------*/
+
+/* The run task writes a chunk of data to a stream buffer or a message buffer and reads it back,
+ * so there are no thread switches. Each sample is the time to write the chunk, pass it through
+ * the buffer and read it. The copy benchmarks write and read a chunk of their own, which
+ * xStreamBufferSend() and xStreamBufferReceive() copy to and from the buffer. The in place
+ * benchmarks write to the regions xStreamBufferReserve() returns and read from those
+ * xStreamBufferPeek() returns instead. The chunk is written with memset() and only its first and
+ * last bytes are read, so the samples are mostly the buffer functions and their copies. */
+
+static void prvWriteBytes( uint8_t * pucData,
+                           size_t xLength,
+                           uint32_t ulSeed )
+{
+    if( xLength > 0U )
+    {
+        ( void ) memset( pucData, ( int ) ( ulSeed & 0xffU ), xLength );
+    }
+}
+
+static uint32_t prvReadBytes( const uint8_t * pucData,
+                              size_t xLength )
+{
+    return ( xLength > 0U ) ? ( uint32_t ) pucData[ 0 ] + pucData[ xLength - 1U ] : 0U;
+}
+
+static void prvBufferCopy( StreamBufferHandle_t xBuffer )
+{
+    uint32_t ulCount;
+    uint64_t ullStartNs;
+    size_t xReceived;
+
+    configASSERT( xBuffer != NULL );
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        ullStartNs = prvNowNs();
+        prvWriteBytes( ucChunk, STREAM_CHUNK_BYTES, ulCount );
+        ( void ) xStreamBufferSend( xBuffer, ucChunk, STREAM_CHUNK_BYTES, 0U );
+        xReceived = xStreamBufferReceive( xBuffer, ucChunk, STREAM_CHUNK_BYTES, 0U );
+        configASSERT( xReceived == STREAM_CHUNK_BYTES );
+        ulChecksum += prvReadBytes( ucChunk, xReceived );
+        prvAddSample( prvNowNs() - ullStartNs );
+    }
+
+    vStreamBufferDelete( xBuffer );
+}
+
+static void prvBufferInPlace( StreamBufferHandle_t xBuffer )
+{
+    StreamBufferRegions_t xRegions;
+    uint32_t ulCount;
+    uint64_t ullStartNs;
+    size_t xReserved, xReceived;
+
+    configASSERT( xBuffer != NULL );
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        ullStartNs = prvNowNs();
+        xReserved = xStreamBufferReserve( xBuffer, STREAM_CHUNK_BYTES, &xRegions, 0U );
+        configASSERT( xReserved == STREAM_CHUNK_BYTES );
+        prvWriteBytes( xRegions.pucData[ 0 ], xRegions.xLength[ 0 ], ulCount );
+        prvWriteBytes( xRegions.pucData[ 1 ], xRegions.xLength[ 1 ], ulCount );
+        ( void ) xStreamBufferCommit( xBuffer, xReserved );
+
+        xReceived = xStreamBufferPeek( xBuffer, &xRegions, 0U );
+        configASSERT( xReceived == STREAM_CHUNK_BYTES );
+        ulChecksum += prvReadBytes( xRegions.pucData[ 0 ], xRegions.xLength[ 0 ] );
+        ulChecksum += prvReadBytes( xRegions.pucData[ 1 ], xRegions.xLength[ 1 ] );
+        ( void ) xStreamBufferConsume( xBuffer, xReceived );
+        prvAddSample( prvNowNs() - ullStartNs );
+    }
+
+    vStreamBufferDelete( xBuffer );
+}
+
+static void prvStreamCopy( void )
+{
+    prvBufferCopy( xStreamBufferCreate( STREAM_BUFFER_BYTES, 1U ) );
+}
+
+static void prvStreamInPlace( void )
+{
+    prvBufferInPlace( xStreamBufferCreate( STREAM_BUFFER_BYTES, 1U ) );
+}
+
+static void prvMessageCopy( void )
+{
+    prvBufferCopy( ( StreamBufferHandle_t ) xMessageBufferCreate( STREAM_BUFFER_BYTES ) );
+}
+
+static void prvMessageInPlace( void )
+{
+    prvBufferInPlace( ( StreamBufferHandle_t ) xMessageBufferCreate( STREAM_BUFFER_BYTES ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task sends batches of items with xQueueSendMultiple() to a higher priority task, which
+ * receives up to a queue full at a time with xQueueReceiveMultiple(). Each sample is the time to
+ * send a batch divided by the items in it, so it includes the share of each item of the switch
+ * to the receiver, its receive and the switch back. */
+
+static void prvBatchReceiveTask( void * pvParameters )
+{
+    uint32_t ulItems[ QUEUE_BATCH_MAX ];
+    uint32_t ulReceived = 0U;
+
+    ( void ) pvParameters;
+
+    while( ulReceived < ( ulIterations * ulBatchItems ) )
+    {
+        ulReceived += ( uint32_t ) xQueueReceiveMultiple( xPingQueue, ulItems, QUEUE_BATCH_MAX, portMAX_DELAY );
+    }
+
+    prvTaskDone();
+}
+
+static void prvBatchSendTask( void * pvParameters )
+{
+    uint32_t ulItems[ QUEUE_BATCH_MAX ] = { 0U };
+    uint32_t ulCount;
+    uint64_t ullBatchNs;
+
+    ( void ) pvParameters;
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        ullBatchNs = prvNowNs();
+        ( void ) xQueueSendMultiple( xPingQueue, ulItems, ulBatchItems, portMAX_DELAY );
+        prvAddSample( ( prvNowNs() - ullBatchNs ) / ulBatchItems );
+    }
+
+    prvTaskDone();
+}
+
+static void prvQueueBatch( uint32_t ulItems )
+{
+    ulBatchItems = ulItems;
+    xPingQueue = xQueueCreate( QUEUE_BATCH_MAX, sizeof( uint32_t ) );
+    configASSERT( xPingQueue != NULL );
+
+    prvCreateTask( prvBatchReceiveTask, HIGH_TASK_PRIORITY, NULL );
+    prvCreateTask( prvBatchSendTask, LOW_TASK_PRIORITY, NULL );
+    prvWaitForTasks( 2U );
+
+    vQueueDelete( xPingQueue );
+}
+
+static void prvQueueBatch1( void )
+{
+    prvQueueBatch( 1U );
+}
+
+static void prvQueueBatch2( void )
+{
+    prvQueueBatch( 2U );
+}
+
+static void prvQueueBatch4( void )
+{
+    prvQueueBatch( 4U );
+}
+
+static void prvQueueBatch8( void )
+{
+    prvQueueBatch( 8U );
+}
+
+static void prvQueueBatch16( void )
+{
+    prvQueueBatch( 16U );
+}
+
+static void prvQueueBatch32( void )
+{
+    prvQueueBatch( QUEUE_BATCH_MAX );
+}
+
+/*-----------------------------------------------------------*/
+
+/* The lock benchmarks take and give a mutex of semphr.h, a fast mutex or a reader-writer lock,
+ * which writers hold alone and readers share. */
+
+#define LOCK_MUTEX         0U
+#define LOCK_FAST_MUTEX    1U
+#define LOCK_RWLOCK        2U
+
+static void prvLock( BaseType_t xWrite )
+{
+    if( ulLockKind == LOCK_MUTEX )
+    {
+        ( void ) xSemaphoreTake( xSemaphore, portMAX_DELAY );
+    }
+    else if( ulLockKind == LOCK_FAST_MUTEX )
+    {
+        ( void ) xFastMutexTake( &xFastMutex, portMAX_DELAY );
+    }
+    else if( xWrite == pdFALSE )
+    {
+        ( void ) xRWLockReadTake( &xRWLock, portMAX_DELAY );
+    }
+    else
+    {
+        ( void ) xRWLockWriteTake( &xRWLock, portMAX_DELAY );
+    }
+}
+
+static void prvUnlock( BaseType_t xWrite )
+{
+    if( ulLockKind == LOCK_MUTEX )
+    {
+        ( void ) xSemaphoreGive( xSemaphore );
+    }
+    else if( ulLockKind == LOCK_FAST_MUTEX )
+    {
+        ( void ) xFastMutexGive( &xFastMutex );
+    }
+    else if( xWrite == pdFALSE )
+    {
+        ( void ) xRWLockReadGive( &xRWLock );
+    }
+    else
+    {
+        ( void ) xRWLockWriteGive( &xRWLock );
+    }
+}
+
+static void prvCreateLock( uint32_t ulKind )
+{
+    ulLockKind = ulKind;
+
+    if( ulKind == LOCK_MUTEX )
+    {
+        xSemaphore = xSemaphoreCreateMutex();
+        configASSERT( xSemaphore != NULL );
+    }
+    else if( ulKind == LOCK_FAST_MUTEX )
+    {
+        vFastMutexInit( &xFastMutex );
+    }
+    else
+    {
+        vRWLockInit( &xRWLock );
+    }
+}
+
+static void prvDeleteLock( void )
+{
+    if( ulLockKind == LOCK_MUTEX )
+    {
+        vSemaphoreDelete( xSemaphore );
+        xSemaphore = NULL;
+    }
+}
+
+/* A task takes and gives a lock nobody else wants, for reading in the case of the reader-writer
+ * lock. Each sample is the mean of a batch of take and give pairs. */
+
+static void prvUncontendedTask( void * pvParameters )
+{
+    uint32_t ulCount, ulPair;
+    uint64_t ullBatchNs;
+
+    ( void ) pvParameters;
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        ullBatchNs = prvNowNs();
+
+        for( ulPair = 0U; ulPair < SEMAPHORE_BATCH; ulPair++ )
+        {
+            prvLock( pdFALSE );
+            prvUnlock( pdFALSE );
+        }
+
+        prvAddSample( ( prvNowNs() - ullBatchNs ) / SEMAPHORE_BATCH );
+    }
+
+    prvTaskDone();
+}
+
+static void prvUncontended( uint32_t ulKind )
+{
+    prvCreateLock( ulKind );
+    prvCreateTask( prvUncontendedTask, LOW_TASK_PRIORITY, NULL );
+    prvWaitForTasks( 1U );
+    prvDeleteLock();
+}
+
+static void prvMutex( void )
+{
+    prvUncontended( LOCK_MUTEX );
+}
+
+static void prvFastMutex( void )
+{
+    prvUncontended( LOCK_FAST_MUTEX );
+}
+
+static void prvRWLockRead( void )
+{
+    prvUncontended( LOCK_RWLOCK );
+}
+
+/* Tasks of the same priority look up keys in a shared table under a lock, and every few lookups
+ * update an entry, holding the reader-writer lock for writing. The tick switches between them,
+ * sometimes while one holds the lock, and then the others wait for it, unless they only read
+ * under the reader-writer lock. Each sample is the time for a batch of lookups of one task
+ * divided by the lookups in it, including the time the task waited or was switched out. */
+
+static void prvTableTask( void * pvParameters )
+{
+    uint32_t ulCount, ulLookup, ulEntry, ulKey = ( uint32_t ) ( uintptr_t ) pvParameters;
+    uint64_t ullBatchNs;
+
+    for( ulCount = 0U; ulCount < ( ulIterations / TABLE_TASKS ); ulCount++ )
+    {
+        ullBatchNs = prvNowNs();
+
+        for( ulLookup = 0U; ulLookup < SEMAPHORE_BATCH; ulLookup++ )
+        {
+            ulKey = ( ulKey * 1103515245U ) + 12345U;
+
+            if( ( ulLookup % TABLE_WRITE_PERIOD ) == 0U )
+            {
+                prvLock( pdTRUE );
+                ulTable[ ulKey % TABLE_ENTRIES ] = ulKey;
+                prvUnlock( pdTRUE );
+            }
+            else
+            {
+                prvLock( pdFALSE );
+
+                for( ulEntry = 0U; ulEntry < TABLE_ENTRIES; ulEntry++ )
+                {
+                    if( ulTable[ ulEntry ] == ulKey )
+                    {
+                        ulChecksum += ulEntry;
+                        break;
+                    }
+                }
+
+                prvUnlock( pdFALSE );
+            }
+        }
+
+        prvAddSample( ( prvNowNs() - ullBatchNs ) / SEMAPHORE_BATCH );
+    }
+
+    prvTaskDone();
+}
+
+static void prvTable( uint32_t ulKind )
+{
+    uint32_t ulTask;
+
+    prvCreateLock( ulKind );
+
+    for( ulTask = 0U; ulTask < TABLE_TASKS; ulTask++ )
+    {
+        if( xTaskCreate( prvTableTask, "Bench", TASK_STACK_SIZE, ( void * ) ( uintptr_t ) ( ulTask + 1U ),
+                         LOW_TASK_PRIORITY, NULL ) != pdPASS )
+        {
+            fprintf( stderr, "Failed to create a task.\n" );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    prvWaitForTasks( TABLE_TASKS );
+    prvDeleteLock();
+}
+
+static void prvTableMutex( void )
+{
+    prvTable( LOCK_MUTEX );
+}
+
+static void prvTableFastMutex( void )
+{
+    prvTable( LOCK_FAST_MUTEX );
+}
+
+static void prvTableRWLock( void )
+{
+    prvTable( LOCK_RWLOCK );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvCompareSamples( const void * pvA,
+                              const void * pvB )
+{
+    uint32_t ulA = *( const uint32_t * ) pvA;
+    uint32_t ulB = *( const uint32_t * ) pvB;
+
+    return ( ulA > ulB ) - ( ulA < ulB );
+}
+
+/* Compare the means against those of the same benchmarks in an earlier output of the tool. */
+
+static BaseType_t prvCheckBaseline( void )
+{
+    FILE * pxFile = fopen( pcBaselinePath, "r" );
+    char cLine[ 256 ], cName[ MAX_NAME_LEN ];
+    double dMeanNs, dLimitNs;
+    unsigned uSamples;
+    uint32_t ulIndex;
+    BaseType_t xPassed = pdTRUE;
+
+    if( pxFile == NULL )
+    {
+        fprintf( stderr, "Failed to read the baseline %s.\n", pcBaselinePath );
+        return pdFALSE;
+    }
+
+    while( fgets( cLine, sizeof( cLine ), pxFile ) != NULL )
+    {
+        if( sscanf( cLine, "%23s %u %lf", cName, &uSamples, &dMeanNs ) != 3 )
+        {
+            continue;
+        }
+
+        dLimitNs = dMeanNs * ( 100.0 + ulTolerancePercent ) / 100.0;
+
+        for( ulIndex = 0U; ulIndex < NUM_BENCHMARKS; ulIndex++ )
+        {
+            if( ( strcmp( cName, xBenchmarks[ ulIndex ].pcName ) == 0 ) &&
+                ( xBenchmarks[ ulIndex ].xCheckBaseline == pdTRUE ) &&
+                ( xBenchmarks[ ulIndex ].dMeanNs > dLimitNs ) )
+            {
+                printf( "%s regressed: %.1f ns, baseline %.1f ns.\n", cName, xBenchmarks[ ulIndex ].dMeanNs, dMeanNs );
+                xPassed = pdFALSE;
+            }
+        }
+    }
+
+    ( void ) fclose( pxFile );
+
+    return xPassed;
+}
+
+static void prvRunTask( void * pvParameters )
+{
+    Benchmark_t * pxBench;
+    uint64_t ullSumNs;
+    uint32_t ulIndex, ulSample;
+    BaseType_t xPassed = pdTRUE;
+
+    ( void ) pvParameters;
+
+    printf( "%-*s %8s %10s %10s %10s\n", ( int ) MAX_NAME_LEN - 4, "benchmark", "samples", "mean ns", "p99 ns", "max ns" );
+
+    for( ulIndex = 0U; ulIndex < NUM_BENCHMARKS; ulIndex++ )
+    {
+        pxBench = &xBenchmarks[ ulIndex ];
+        ulSampleCount = 0U;
+        vTaskPrioritySet( NULL, SETUP_PRIORITY );
+        pxBench->pvRun();
+
+        pxBench->ulSamples = ulSampleCount;
+
+        if( pxBench->ulSamples > 0U )
+        {
+            qsort( pulSamples, pxBench->ulSamples, sizeof( uint32_t ), prvCompareSamples );
+
+            for( ullSumNs = 0U, ulSample = 0U; ulSample < pxBench->ulSamples; ulSample++ )
+            {
+                ullSumNs += pulSamples[ ulSample ];
+            }
+
+            pxBench->dMeanNs = ( double ) ullSumNs / pxBench->ulSamples;
+            pxBench->ulP99Ns = pulSamples[ ( ( uint64_t ) pxBench->ulSamples * 99U ) / 100U ];
+            pxBench->ulMaxNs = pulSamples[ pxBench->ulSamples - 1U ];
+        }
+
+        printf( "%-*s %8u %10.1f %10u %10u\n", ( int ) MAX_NAME_LEN - 4, pxBench->pcName, ( unsigned ) pxBench->ulSamples,
+                pxBench->dMeanNs, ( unsigned ) pxBench->ulP99Ns, ( unsigned ) pxBench->ulMaxNs );
+        ( void ) fflush( stdout );
+    }
+
+    if( pcBaselinePath != NULL )
+    {
+        xPassed = prvCheckBaseline();
+    }
+
+    exit( ( xPassed == pdTRUE ) ? EXIT_SUCCESS : EXIT_FAILURE );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t * pulArgs[] = { &ulIterations, &ulTimerPeriods };
+    uint32_t ulArg = 0U;
+    int lArg;
+
+    for( lArg = 1; lArg < argc; lArg++ )
+    {
+        if( ( strcmp( argv[ lArg ], "-b" ) == 0 ) && ( lArg + 1 < argc ) )
+        {
+            pcBaselinePath = argv[ ++lArg ];
+        }
+        else if( ( strcmp( argv[ lArg ], "-t" ) == 0 ) && ( lArg + 1 < argc ) )
+        {
+            ulTolerancePercent = ( uint32_t ) strtoul( argv[ ++lArg ], NULL, 10 );
+        }
+        else if( ulArg < ( sizeof( pulArgs ) / sizeof( pulArgs[ 0 ] ) ) )
+        {
+            *pulArgs[ ulArg++ ] = ( uint32_t ) strtoul( argv[ lArg ], NULL, 10 );
+        }
+    }
+
+    if( ( ulIterations == 0U ) || ( ulTimerPeriods == 0U ) )
+    {
+        fprintf( stderr, "usage: %s [iterations] [timer periods] [-b baseline] [-t tolerance in percent]\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    /* Each benchmark keeps at most one sample per iteration, the timer one per period. */
+    ulMaxSamples = ( ulTimerPeriods > ulIterations ) ? ulTimerPeriods : ulIterations;
+    pulSamples = malloc( ulMaxSamples * sizeof( uint32_t ) );
+
+    if( ( pulSamples == NULL ) ||
+        ( xTaskCreate( prvRunTask, "Run", TASK_STACK_SIZE, NULL, RUN_TASK_PRIORITY, &xRunTask ) != pdPASS ) )
+    {
+        fprintf( stderr, "Failed to create the run task.\n" );
+        return EXIT_FAILURE;
+    }
+
+    vTaskStartScheduler();
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,654 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file mqtt_bench.c
+ * @brief QoS 1 publish throughput of the MQTT agent at several round trip times, on a host
+ * FreeRTOS port.
+ *
+ * Usage:
+ *   mqtt_bench [messages] [round trip in ms ...] [-v]
+ *
+ * For each round trip time, the tool connects the MQTT agent to a stand-in for a broker and
+ * publishes the given number of QoS 1 messages, first one after the other with
+ * MQTT_AGENT_Publish and then with MQTT_AGENT_PublishAsync, which keeps up to
+ * mqttconfigMAX_INFLIGHT_PUBLISHES of them in-flight. The agent and the core library are
+ * unchanged. Only the secure sockets are replaced, by a link that answers each packet the agent
+ * sends once the round trip time has passed. The link runs in its own task on the tick, so the
+ * time is real.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Amazon FreeRTOS includes. */
+#include "aws_mqtt_agent.h"
+#include "aws_mqtt_agent_config.h"
+#include "aws_mqtt_agent_config_defaults.h"
+#include "aws_bufferpool.h"
+#include "aws_secure_sockets.h"
+
+#define CLIENT_ID                "mqtt_bench"
+#define TOPIC                    "mqtt_bench/telemetry"
+#define MESSAGE                  "{\"temperature\":21.5,\"humidity\":40}"
+#define MAX_ROUND_TRIPS          8U
+#define MAX_REPLIES              64U   /* Replies in flight on the link, more than the agent can wait for. */
+#define MAX_REPLY_SIZE           4U    /* CONNACK, PUBACK and PINGRESP. */
+#define UPLINK_BUFFER_SIZE       2048U /* Holds a packet the agent sent in more than one write. */
+#define DOWNLINK_BUFFER_SIZE     256U
+#define LINK_TASK_PRIORITY       ( configMAX_PRIORITIES - 1 )
+#define RUN_TASK_PRIORITY        ( configMAX_PRIORITIES - 4 )
+#define LINK_TASK_STACK_SIZE     ( configMINIMAL_STACK_SIZE * 4 )
+#define RUN_TASK_STACK_SIZE      ( configMINIMAL_STACK_SIZE * 4 )
+#define TIMEOUT_TICKS            pdMS_TO_TICKS( 10000UL )
+#define DEFAULT_MESSAGES         100U
+
+/* An answer of the broker on its way to the device. */
+
+typedef struct
+{
+    TickType_t xDeliverTick; /* Tick at which the answer arrives. */
+    uint8_t ucLength;
+    uint8_t ucData[ MAX_REPLY_SIZE ];
+} Reply_t;
+
+/* Parameters of the run. */
+
+static uint32_t ulMessages = DEFAULT_MESSAGES;
+static uint32_t ulRoundTripMs[ MAX_ROUND_TRIPS ] = { 1U, 10U, 50U };
+static uint32_t ulRoundTrips = 3U;
+static BaseType_t xVerbose = pdFALSE;
+
+/* The link and the stand-in for the broker. All of it is protected by xLinkLock. */
+
+static SemaphoreHandle_t xLinkLock;
+static TickType_t xRoundTripTicks;
+static BaseType_t xSocketOpen = pdFALSE;
+static void ( * pxWakeupCallback )( Socket_t ) = NULL;
+static Reply_t xReplies[ MAX_REPLIES ]; /* Ring of the answers in flight, in order of arrival. */
+static uint32_t ulReplyHead, ulReplyCount;
+static uint8_t ucUplink[ UPLINK_BUFFER_SIZE ];
+static uint32_t ulUplinkLength;
+static uint8_t ucDownlink[ DOWNLINK_BUFFER_SIZE ];
+static uint32_t ulDownlinkLength;
+static uint32_t ulPublishes; /* Publishes that reached the broker. */
+
+/* Results of the asynchronous publishes. */
+
+static SemaphoreHandle_t xCompleted;
+static volatile uint32_t ulFailed;
+
+/*-----------------------------------------------------------*/
+
+/* Only log if asked to. */
+
+void vLoggingPrintf( const char * pcFormat,
+                     ... )
+{
+    va_list xArgs;
+
+    if( xVerbose == pdTRUE )
+    {
+        va_start( xArgs, pcFormat );
+        ( void ) vfprintf( stderr, pcFormat, xArgs );
+        va_end( xArgs );
+    }
+}
+
+/* The agent creates its task and queues statically, so the idle and timer tasks are static
+ * too. */
+
+void vApplicationGetIdleTaskMemory( StaticTask_t ** ppxIdleTaskTCBBuffer,
+                                    StackType_t ** ppxIdleTaskStackBuffer,
+                                    uint32_t * pulIdleTaskStackSize )
+{
+    static StaticTask_t xIdleTaskTCB;
+    static StackType_t uxIdleTaskStack[ configMINIMAL_STACK_SIZE ];
+
+    *ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = uxIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
+                                     StackType_t ** ppxTimerTaskStackBuffer,
+                                     uint32_t * pulTimerTaskStackSize )
+{
+    static StaticTask_t xTimerTaskTCB;
+    static StackType_t uxTimerTaskStack[ configTIMER_TASK_STACK_DEPTH ];
+
+    *ppxTimerTaskTCBBuffer = &xTimerTaskTCB;
+    *ppxTimerTaskStackBuffer = uxTimerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+
+/* The link task wakes on every tick, so the kernel never expects to be idle long enough to call
+ * the tickless idle sleep of the port. Sleep until the next tick here instead. */
+
+void vApplicationIdleHook( void )
+{
+    vTaskSuspendAll();
+    vPortSuppressTicksAndSleep( 1 );
+    ( void ) xTaskResumeAll();
+}
+
+/*-----------------------------------------------------------*/
+
+/* Send an answer to the device, which arrives a round trip after the packet it answers was
+ * sent. Must be called with xLinkLock held. */
+
+static void prvReply( const uint8_t * pucData,
+                      uint8_t ucLength )
+{
+    Reply_t * pxReply;
+
+    configASSERT( ulReplyCount < MAX_REPLIES );
+    pxReply = &( xReplies[ ( ulReplyHead + ulReplyCount ) % MAX_REPLIES ] );
+    pxReply->xDeliverTick = xTaskGetTickCount() + xRoundTripTicks;
+    pxReply->ucLength = ucLength;
+    memcpy( pxReply->ucData, pucData, ucLength );
+    ulReplyCount++;
+}
+
+/* Answer a packet of the device the way a broker would. Must be called with xLinkLock held. */
+
+static void prvServe( const uint8_t * pucPacket,
+                      uint32_t ulHeaderLength,
+                      uint32_t ulRemainingLength )
+{
+    const uint8_t * pucVariable = pucPacket + ulHeaderLength;
+    uint8_t ucAnswer[ MAX_REPLY_SIZE ];
+    uint32_t ulTopicLength;
+
+    switch( pucPacket[ 0 ] >> 4 )
+    {
+        case 1: /* CONNECT, accepted. */
+            ucAnswer[ 0 ] = 0x20U;
+            ucAnswer[ 1 ] = 0x02U;
+            ucAnswer[ 2 ] = 0x00U;
+            ucAnswer[ 3 ] = 0x00U;
+            prvReply( ucAnswer, 4U );
+            break;
+
+        case 3: /* PUBLISH, acknowledged if it is QoS 1. */
+            ulPublishes++;
+
+            if( ( ( pucPacket[ 0 ] >> 1 ) & 0x03U ) == 1U )
+            {
+                ulTopicLength = ( ( uint32_t ) pucVariable[ 0 ] << 8 ) | pucVariable[ 1 ];
+                configASSERT( ulRemainingLength >= ulTopicLength + 4U );
+                ucAnswer[ 0 ] = 0x40U;
+                ucAnswer[ 1 ] = 0x02U;
+                ucAnswer[ 2 ] = pucVariable[ 2U + ulTopicLength ];
+                ucAnswer[ 3 ] = pucVariable[ 3U + ulTopicLength ];
+                prvReply( ucAnswer, 4U );
+            }
+
+            break;
+
+        case 12: /* PINGREQ. */
+            ucAnswer[ 0 ] = 0xD0U;
+            ucAnswer[ 1 ] = 0x00U;
+            prvReply( ucAnswer, 2U );
+            break;
+
+        default: /* DISCONNECT, and packets the tool does not send. */
+            break;
+    }
+}
+
+/* The link task delivers the answers that arrived by the current tick and wakes up the MQTT
+ * task to read them. */
+
+static void prvLinkTask( void * pvParameters )
+{
+    void ( * pxCallback )( Socket_t );
+    BaseType_t xDelivered;
+    Reply_t * pxReply;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        xDelivered = pdFALSE;
+        ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+
+        while( ulReplyCount > 0U )
+        {
+            pxReply = &( xReplies[ ulReplyHead ] );
+
+            if( ( TickType_t ) ( xTaskGetTickCount() - pxReply->xDeliverTick ) > ( portMAX_DELAY / 2U ) )
+            {
+                /* Not arrived yet. */
+                break;
+            }
+
+            configASSERT( ulDownlinkLength + pxReply->ucLength <= DOWNLINK_BUFFER_SIZE );
+            memcpy( &( ucDownlink[ ulDownlinkLength ] ), pxReply->ucData, pxReply->ucLength );
+            ulDownlinkLength += pxReply->ucLength;
+            ulReplyHead = ( ulReplyHead + 1U ) % MAX_REPLIES;
+            ulReplyCount--;
+            xDelivered = pdTRUE;
+        }
+
+        pxCallback = ( xSocketOpen == pdTRUE ) ? pxWakeupCallback : NULL;
+        ( void ) xSemaphoreGive( xLinkLock );
+
+        /* The callback may block to post to the command queue of the MQTT task, so it is
+         * called without the lock. */
+        if( ( xDelivered == pdTRUE ) && ( pxCallback != NULL ) )
+        {
+            pxCallback( ( Socket_t ) &xSocketOpen );
+        }
+
+        vTaskDelay( 1 );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* The secure sockets stand-in. The agent only has one socket open at a time. */
+
+Socket_t SOCKETS_Socket( int32_t lDomain,
+                         int32_t lType,
+                         int32_t lProtocol )
+{
+    ( void ) lDomain;
+    ( void ) lType;
+    ( void ) lProtocol;
+
+    ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+    configASSERT( xSocketOpen == pdFALSE );
+    xSocketOpen = pdTRUE;
+    pxWakeupCallback = NULL;
+    ulReplyCount = 0U;
+    ulUplinkLength = 0U;
+    ulDownlinkLength = 0U;
+    ( void ) xSemaphoreGive( xLinkLock );
+
+    return ( Socket_t ) &xSocketOpen;
+}
+
+int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
+                            int32_t lLevel,
+                            int32_t lOptionName,
+                            const void * pvOptionValue,
+                            size_t xOptionLength )
+{
+    ( void ) xSocket;
+    ( void ) lLevel;
+    ( void ) xOptionLength;
+
+    if( lOptionName == SOCKETS_SO_WAKEUP_CALLBACK )
+    {
+        ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+        pxWakeupCallback = ( void ( * )( Socket_t ) )pvOptionValue;
+        ( void ) xSemaphoreGive( xLinkLock );
+    }
+
+    return SOCKETS_ERROR_NONE;
+}
+
+int32_t SOCKETS_Connect( Socket_t xSocket,
+                         SocketsSockaddr_t * pxAddress,
+                         Socklen_t xAddressLength )
+{
+    ( void ) xSocket;
+    ( void ) pxAddress;
+    ( void ) xAddressLength;
+
+    return SOCKETS_ERROR_NONE;
+}
+
+/* The broker reads the packets as they are sent. A packet may be split over writes, or a write
+ * hold several packets batched by the agent. */
+
+int32_t SOCKETS_Send( Socket_t xSocket,
+                      const void * pvBuffer,
+                      size_t xDataLength,
+                      uint32_t ulFlags )
+{
+    uint32_t ulOffset = 0U, ulHeaderLength, ulRemainingLength, ulShift;
+    int32_t lReturn = ( int32_t ) xDataLength;
+
+    ( void ) xSocket;
+    ( void ) ulFlags;
+
+    ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+
+    if( xSocketOpen == pdFALSE )
+    {
+        lReturn = SOCKETS_ECLOSED;
+    }
+    else
+    {
+        configASSERT( ulUplinkLength + xDataLength <= UPLINK_BUFFER_SIZE );
+        memcpy( &( ucUplink[ ulUplinkLength ] ), pvBuffer, xDataLength );
+        ulUplinkLength += ( uint32_t ) xDataLength;
+
+        for( ; ; )
+        {
+            /* Decode the remaining length of the fixed header. */
+            ulHeaderLength = 1U;
+            ulRemainingLength = 0U;
+            ulShift = 0U;
+
+            while( ( ulOffset + ulHeaderLength < ulUplinkLength ) && ( ulShift < 28U ) )
+            {
+                ulRemainingLength |= ( uint32_t ) ( ucUplink[ ulOffset + ulHeaderLength ] & 0x7FU ) << ulShift;
+                ulShift += 7U;
+
+                if( ( ucUplink[ ulOffset + ulHeaderLength++ ] & 0x80U ) == 0U )
+                {
+                    ulShift = UINT32_MAX;
+                }
+            }
+
+            if( ( ulShift != UINT32_MAX ) || ( ulOffset + ulHeaderLength + ulRemainingLength > ulUplinkLength ) )
+            {
+                /* The rest of the packet is still to come. */
+                break;
+            }
+
+            prvServe( &( ucUplink[ ulOffset ] ), ulHeaderLength, ulRemainingLength );
+            ulOffset += ulHeaderLength + ulRemainingLength;
+        }
+
+        memmove( ucUplink, &( ucUplink[ ulOffset ] ), ulUplinkLength - ulOffset );
+        ulUplinkLength -= ulOffset;
+    }
+
+    ( void ) xSemaphoreGive( xLinkLock );
+
+    return lReturn;
+}
+
+int32_t SOCKETS_Recv( Socket_t xSocket,
+                      void * pvBuffer,
+                      size_t xBufferLength,
+                      uint32_t ulFlags )
+{
+    uint32_t ulLength;
+    int32_t lReturn;
+
+    ( void ) xSocket;
+    ( void ) ulFlags;
+
+    ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+
+    ulLength = ( ulDownlinkLength < xBufferLength ) ? ulDownlinkLength : ( uint32_t ) xBufferLength;
+
+    if( ulLength > 0U )
+    {
+        memcpy( pvBuffer, ucDownlink, ulLength );
+        memmove( ucDownlink, &( ucDownlink[ ulLength ] ), ulDownlinkLength - ulLength );
+        ulDownlinkLength -= ulLength;
+        lReturn = ( int32_t ) ulLength;
+    }
+    else
+    {
+        lReturn = ( xSocketOpen == pdTRUE ) ? SOCKETS_EWOULDBLOCK : SOCKETS_ECLOSED;
+    }
+
+    ( void ) xSemaphoreGive( xLinkLock );
+
+    return lReturn;
+}
+
+int32_t SOCKETS_Shutdown( Socket_t xSocket,
+                          uint32_t ulHow )
+{
+    ( void ) xSocket;
+    ( void ) ulHow;
+
+    ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+    xSocketOpen = pdFALSE;
+    ulDownlinkLength = 0U;
+    ( void ) xSemaphoreGive( xLinkLock );
+
+    return SOCKETS_ERROR_NONE;
+}
+
+int32_t SOCKETS_Close( Socket_t xSocket )
+{
+    return SOCKETS_Shutdown( xSocket, SOCKETS_SHUT_RDWR );
+}
+
+uint32_t SOCKETS_GetHostByName( const char * pcHostName )
+{
+    ( void ) pcHostName;
+
+    return SOCKETS_inet_addr_quick( 127, 0, 0, 1 );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPublishCompleteCallback( void * pvCallbackContext,
+                                        const MQTTAgentPublishParams_t * const pxPublishParams,
+                                        MQTTAgentReturnCode_t xResult )
+{
+    ( void ) pvCallbackContext;
+    ( void ) pxPublishParams;
+
+    if( xResult != eMQTTAgentSuccess )
+    {
+        ulFailed++;
+    }
+
+    ( void ) xSemaphoreGive( xCompleted );
+}
+
+/* Publish the messages with both APIs at one round trip time. Returns the ticks each took, or
+ * pdFAIL if a publish failed. */
+
+static BaseType_t prvRunRoundTrip( uint32_t ulRoundTrip,
+                                   TickType_t * pxBlockingTicks,
+                                   TickType_t * pxAsyncTicks )
+{
+    MQTTAgentHandle_t xMQTTHandle = NULL;
+    MQTTAgentConnectParams_t xConnectParams;
+    MQTTAgentPublishParams_t xPublishParams;
+    TickType_t xStart;
+    BaseType_t xResult = pdFAIL, xConnected = pdFALSE;
+    uint32_t ulIndex;
+
+    ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+    xRoundTripTicks = pdMS_TO_TICKS( ulRoundTrip );
+    ulPublishes = 0U;
+    ( void ) xSemaphoreGive( xLinkLock );
+    ulFailed = 0U;
+
+    memset( &( xConnectParams ), 0x00, sizeof( xConnectParams ) );
+    xConnectParams.pcURL = "127.0.0.1";
+    xConnectParams.xFlags = mqttagentURL_IS_IP_ADDRESS;
+    xConnectParams.usPort = 1883;
+    xConnectParams.pucClientId = ( const uint8_t * ) CLIENT_ID;
+    xConnectParams.usClientIdLength = ( uint16_t ) strlen( CLIENT_ID );
+
+    memset( &( xPublishParams ), 0x00, sizeof( xPublishParams ) );
+    xPublishParams.pucTopic = ( const uint8_t * ) TOPIC;
+    xPublishParams.usTopicLength = ( uint16_t ) strlen( TOPIC );
+    xPublishParams.pvData = MESSAGE;
+    xPublishParams.ulDataLength = ( uint32_t ) strlen( MESSAGE );
+    xPublishParams.xQoS = eMQTTQoS1;
+
+    if( MQTT_AGENT_Create( &xMQTTHandle ) != eMQTTAgentSuccess )
+    {
+        return pdFAIL;
+    }
+
+    if( MQTT_AGENT_Connect( xMQTTHandle, &xConnectParams, TIMEOUT_TICKS ) == eMQTTAgentSuccess )
+    {
+        xConnected = pdTRUE;
+
+        /* One round trip per message. */
+        xStart = xTaskGetTickCount();
+
+        for( ulIndex = 0U; ulIndex < ulMessages; ulIndex++ )
+        {
+            if( MQTT_AGENT_Publish( xMQTTHandle, &( xPublishParams ), TIMEOUT_TICKS ) != eMQTTAgentSuccess )
+            {
+                break;
+            }
+        }
+
+        *pxBlockingTicks = xTaskGetTickCount() - xStart;
+
+        if( ulIndex == ulMessages )
+        {
+            /* Keep the window full. */
+            xStart = xTaskGetTickCount();
+
+            for( ulIndex = 0U; ulIndex < ulMessages; ulIndex++ )
+            {
+                if( MQTT_AGENT_PublishAsync( xMQTTHandle, &( xPublishParams ), prvPublishCompleteCallback, NULL, TIMEOUT_TICKS ) != eMQTTAgentSuccess )
+                {
+                    break;
+                }
+            }
+
+            xResult = ( ulIndex == ulMessages ) ? pdPASS : pdFAIL;
+
+            /* Wait for the ones that were accepted. */
+            while( ulIndex-- > 0U )
+            {
+                if( xSemaphoreTake( xCompleted, TIMEOUT_TICKS ) == pdFALSE )
+                {
+                    xResult = pdFAIL;
+                    break;
+                }
+            }
+
+            *pxAsyncTicks = xTaskGetTickCount() - xStart;
+        }
+    }
+
+    if( xConnected == pdTRUE )
+    {
+        ( void ) MQTT_AGENT_Disconnect( xMQTTHandle, TIMEOUT_TICKS );
+    }
+
+    ( void ) MQTT_AGENT_Delete( xMQTTHandle );
+
+    if( ( ulFailed != 0U ) || ( ulPublishes != 2U * ulMessages ) )
+    {
+        xResult = pdFAIL;
+    }
+
+    return xResult;
+}
+
+static void prvRunTask( void * pvParameters )
+{
+    TickType_t xBlockingTicks = 0, xAsyncTicks = 0;
+    uint32_t ulRoundTrip;
+
+    ( void ) pvParameters;
+
+    printf( "%u QoS 1 publishes per API, window of %u\n\n", ( unsigned ) ulMessages, ( unsigned ) mqttconfigMAX_INFLIGHT_PUBLISHES );
+    printf( "round trip ms   blocking msg/s   window msg/s   speedup\n" );
+
+    for( ulRoundTrip = 0U; ulRoundTrip < ulRoundTrips; ulRoundTrip++ )
+    {
+        if( prvRunRoundTrip( ulRoundTripMs[ ulRoundTrip ], &xBlockingTicks, &xAsyncTicks ) != pdPASS )
+        {
+            fprintf( stderr, "Publishing failed at a round trip of %u ms.\n", ( unsigned ) ulRoundTripMs[ ulRoundTrip ] );
+            exit( EXIT_FAILURE );
+        }
+
+        /* Avoid dividing by zero on runs shorter than a tick. */
+        xBlockingTicks = configMAX( xBlockingTicks, ( TickType_t ) 1 );
+        xAsyncTicks = configMAX( xAsyncTicks, ( TickType_t ) 1 );
+
+        printf( "%12u   %14.1f   %12.1f   %7.2f\n",
+                ( unsigned ) ulRoundTripMs[ ulRoundTrip ],
+                ( double ) ulMessages * configTICK_RATE_HZ / ( double ) xBlockingTicks,
+                ( double ) ulMessages * configTICK_RATE_HZ / ( double ) xAsyncTicks,
+                ( double ) xBlockingTicks / ( double ) xAsyncTicks );
+    }
+
+    exit( EXIT_SUCCESS );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    BaseType_t xMessagesGiven = pdFALSE, xRoundTripsGiven = pdFALSE;
+    int lArg;
+
+    for( lArg = 1; lArg < argc; lArg++ )
+    {
+        if( strcmp( argv[ lArg ], "-v" ) == 0 )
+        {
+            xVerbose = pdTRUE;
+        }
+        else if( xMessagesGiven == pdFALSE )
+        {
+            ulMessages = ( uint32_t ) strtoul( argv[ lArg ], NULL, 10 );
+            xMessagesGiven = pdTRUE;
+        }
+        else if( ( xRoundTripsGiven == pdFALSE ) || ( ulRoundTrips < MAX_ROUND_TRIPS ) )
+        {
+            if( xRoundTripsGiven == pdFALSE )
+            {
+                ulRoundTrips = 0U;
+                xRoundTripsGiven = pdTRUE;
+            }
+
+            ulRoundTripMs[ ulRoundTrips++ ] = ( uint32_t ) strtoul( argv[ lArg ], NULL, 10 );
+        }
+    }
+
+    if( ulMessages == 0U )
+    {
+        fprintf( stderr, "usage: %s [messages] [round trip in ms ...] [-v]\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    xLinkLock = xSemaphoreCreateMutex();
+    xCompleted = xSemaphoreCreateCounting( ulMessages, 0 );
+
+    if( ( xLinkLock == NULL ) || ( xCompleted == NULL ) ||
+        ( BUFFERPOOL_Init() != pdPASS ) || ( MQTT_AGENT_Init() != pdPASS ) ||
+        ( xTaskCreate( prvLinkTask, "Link", LINK_TASK_STACK_SIZE, NULL, LINK_TASK_PRIORITY, NULL ) != pdPASS ) ||
+        ( xTaskCreate( prvRunTask, "Run", RUN_TASK_STACK_SIZE, NULL, RUN_TASK_PRIORITY, NULL ) != pdPASS ) )
+    {
+        fprintf( stderr, "Failed to create the tasks.\n" );
+        return EXIT_FAILURE;
+    }
+
+    vTaskStartScheduler();
+
+    return EXIT_FAILURE;
+}
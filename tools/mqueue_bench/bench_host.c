@@ -0,0 +1,142 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file bench_host.c
+ * @brief Host side of the POSIX message queue benchmark: the clock, the report and main().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench_host.h"
+
+#define DEFAULT_ITERATIONS    10000U
+#define MAX_NAME_LEN          24U
+
+/*-----------------------------------------------------------*/
+
+uint64_t ullBenchNowNs( void )
+{
+    struct timespec xTime;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+
+static int prvCompareSamples( const void * pvA,
+                              const void * pvB )
+{
+    uint32_t ulA = *( const uint32_t * ) pvA;
+    uint32_t ulB = *( const uint32_t * ) pvB;
+
+    return ( ulA > ulB ) - ( ulA < ulB );
+}
+
+void vBenchReport( const char * pcName,
+                   uint32_t * pulSamples,
+                   uint32_t ulSamples )
+{
+    uint64_t ullSumNs = 0U;
+    uint32_t ulSample;
+
+    if( ulSamples == 0U )
+    {
+        vBenchFail( "A benchmark took no samples." );
+    }
+
+    qsort( pulSamples, ulSamples, sizeof( uint32_t ), prvCompareSamples );
+
+    for( ulSample = 0U; ulSample < ulSamples; ulSample++ )
+    {
+        ullSumNs += pulSamples[ ulSample ];
+    }
+
+    printf( "%-*s %8u %10.1f %10u %10u\n", ( int ) MAX_NAME_LEN - 4, pcName, ( unsigned ) ulSamples,
+            ( double ) ullSumNs / ulSamples, ( unsigned ) pulSamples[ ( ( uint64_t ) ulSamples * 99U ) / 100U ],
+            ( unsigned ) pulSamples[ ulSamples - 1U ] );
+    ( void ) fflush( stdout );
+}
+
+void vBenchReportValue( const char * pcName,
+                        uint32_t ulValue,
+                        const char * pcUnit )
+{
+    printf( "%-*s %8u %s\n", ( int ) MAX_NAME_LEN - 4, pcName, ( unsigned ) ulValue, pcUnit );
+    ( void ) fflush( stdout );
+}
+
+void vBenchFail( const char * pcMessage )
+{
+    fprintf( stderr, "%s\n", pcMessage );
+    exit( EXIT_FAILURE );
+}
+
+void vBenchExit( void )
+{
+    exit( EXIT_SUCCESS );
+}
+
+void vAssertCalled( const char * pcFile,
+                    uint32_t ulLine )
+{
+    fprintf( stderr, "Assert failed at %s:%u.\n", pcFile, ( unsigned ) ulLine );
+    abort();
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulIterations = DEFAULT_ITERATIONS;
+    uint32_t * pulSamples;
+
+    if( argc > 1 )
+    {
+        ulIterations = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+    }
+
+    if( ulIterations == 0U )
+    {
+        fprintf( stderr, "usage: %s [iterations]\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    pulSamples = malloc( ulIterations * sizeof( uint32_t ) );
+
+    if( pulSamples == NULL )
+    {
+        vBenchFail( "Failed to allocate the samples." );
+    }
+
+    printf( "%-*s %8s %10s %10s %10s\n", ( int ) MAX_NAME_LEN - 4, "benchmark", "samples", "mean ns", "p99 ns", "max ns" );
+    vBenchStart( ulIterations, pulSamples );
+
+    return EXIT_FAILURE;
+}
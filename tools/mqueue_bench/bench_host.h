@@ -0,0 +1,58 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file bench_host.h
+ * @brief Host side of the POSIX message queue benchmark.
+ *
+ * The FreeRTOS+POSIX headers define POSIX types and functions of their own, so
+ * mqueue_bench.c can't include the headers of the host. The functions that
+ * need them are in bench_host.c.
+ */
+
+#ifndef BENCH_HOST_H
+#define BENCH_HOST_H
+
+#include <stdint.h>
+
+/* Defined in bench_host.c. */
+
+uint64_t ullBenchNowNs( void );
+void vBenchReport( const char * pcName,
+                   uint32_t * pulSamples,
+                   uint32_t ulSamples );
+void vBenchReportValue( const char * pcName,
+                        uint32_t ulValue,
+                        const char * pcUnit );
+void vBenchFail( const char * pcMessage );
+void vBenchExit( void );
+
+/* Defined in mqueue_bench.c. Creates the task of the benchmarks, which keep up to ulIterations
+ * samples each in pulSamples, and starts the scheduler. */
+
+void vBenchStart( uint32_t ulIterations,
+                  uint32_t * pulSamples );
+
+#endif /* BENCH_HOST_H */
@@ -0,0 +1,342 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file mqueue_bench.c
+ * @brief Benchmarks of the FreeRTOS+POSIX message queues on the Linux/POSIX simulator port.
+ *
+ * Usage:
+ *   mqueue_bench [iterations]
+ *
+ * Measures the time of mq_open() and mq_close() of an existing queue among 1, 32 and 256
+ * queues, of a nonblocking mq_send() and mq_receive() of messages of 16 and 128 bytes by one
+ * task, and of a round trip of a message through two queues between two tasks. It also reports
+ * the number of messages of 16 bytes that fit in a queue of 10 messages of 128 bytes, and the
+ * heap that queue takes when it is empty and when it is full. The times include the thread
+ * switches of the simulator, so they are only comparable between runs on the same host.
+ */
+
+#include <string.h>
+
+/* FreeRTOS+POSIX includes. */
+#include "FreeRTOS_POSIX.h"
+#include "FreeRTOS_POSIX/errno.h"
+#include "FreeRTOS_POSIX/fcntl.h"
+#include "FreeRTOS_POSIX/mqueue.h"
+
+#include "bench_host.h"
+
+#define MAX_QUEUES                256U  /* The most queues of the open benchmarks. */
+#define QUEUE_MESSAGES            10
+#define QUEUE_MESSAGE_SIZE        128
+#define SEND_RECEIVE_BATCH        10U   /* Messages per send and receive sample. */
+#define SMALL_MESSAGE_SIZE        16U
+#define RUN_TASK_PRIORITY         ( tskIDLE_PRIORITY + 1 )
+#define ECHO_TASK_PRIORITY        ( tskIDLE_PRIORITY + 2 )
+#define TASK_STACK_SIZE           ( configMINIMAL_STACK_SIZE * 2 )
+#define QUEUE_NAME_PREFIX         "/bench_queue_"
+#define QUEUE_NAME_LEN            ( sizeof( QUEUE_NAME_PREFIX ) + 10U )
+#define PING_QUEUE_NAME           "/bench_ping"
+#define PONG_QUEUE_NAME           "/bench_pong"
+
+static uint32_t ulIterations;
+static uint32_t * pulSamples;
+static uint32_t ulSampleCount;
+static TaskHandle_t xRunTask;
+static mqd_t xQueues[ MAX_QUEUES ];
+static char cMessage[ QUEUE_MESSAGE_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+static void prvAddSample( uint64_t ullNs )
+{
+    if( ulSampleCount < ulIterations )
+    {
+        pulSamples[ ulSampleCount ] = ( ullNs > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) ullNs;
+        ulSampleCount++;
+    }
+}
+
+static void prvReport( const char * pcName )
+{
+    vBenchReport( pcName, pulSamples, ulSampleCount );
+    ulSampleCount = 0U;
+}
+
+static mqd_t prvOpenQueue( const char * pcName,
+                           int lFlags )
+{
+    struct mq_attr xAttr = { 0, QUEUE_MESSAGES, QUEUE_MESSAGE_SIZE, 0 };
+    mqd_t xQueue = mq_open( pcName, O_CREAT | O_EXCL | O_RDWR | lFlags, 0600, &xAttr );
+
+    if( xQueue == ( mqd_t ) -1 )
+    {
+        vBenchFail( "Failed to create a queue." );
+    }
+
+    return xQueue;
+}
+
+static void prvDeleteQueue( mqd_t xQueue,
+                            const char * pcName )
+{
+    if( ( mq_close( xQueue ) != 0 ) || ( mq_unlink( pcName ) != 0 ) )
+    {
+        vBenchFail( "Failed to delete a queue." );
+    }
+}
+
+/* Names of the same length that differ only at the end, the worst case for strcmp(). */
+
+static void prvQueueName( char * pcName,
+                          uint32_t ulQueue )
+{
+    char * pcDigit = pcName + sizeof( QUEUE_NAME_PREFIX ) - 1U + 3U;
+
+    ( void ) memcpy( pcName, QUEUE_NAME_PREFIX, sizeof( QUEUE_NAME_PREFIX ) - 1U );
+    *pcDigit = '\0';
+
+    do
+    {
+        pcDigit--;
+        *pcDigit = ( char ) ( '0' + ( ulQueue % 10U ) );
+        ulQueue /= 10U;
+    } while( pcDigit > pcName + sizeof( QUEUE_NAME_PREFIX ) - 1U );
+}
+
+/*-----------------------------------------------------------*/
+
+/* With ulQueues queues open, a task opens and closes them in turn. Each sample is an open and a
+ * close of a queue that exists. */
+
+static void prvOpenClose( uint32_t ulQueues )
+{
+    char cName[ QUEUE_NAME_LEN ];
+    uint32_t ulQueue, ulCount;
+    uint64_t ullStartNs;
+    mqd_t xQueue;
+
+    for( ulQueue = 0U; ulQueue < ulQueues; ulQueue++ )
+    {
+        prvQueueName( cName, ulQueue );
+        xQueues[ ulQueue ] = prvOpenQueue( cName, 0 );
+    }
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        prvQueueName( cName, ulCount % ulQueues );
+        ullStartNs = ullBenchNowNs();
+        xQueue = mq_open( cName, O_RDWR, 0600, NULL );
+        ( void ) mq_close( xQueue );
+        prvAddSample( ullBenchNowNs() - ullStartNs );
+
+        if( xQueue == ( mqd_t ) -1 )
+        {
+            vBenchFail( "Failed to open a queue." );
+        }
+    }
+
+    for( ulQueue = 0U; ulQueue < ulQueues; ulQueue++ )
+    {
+        prvQueueName( cName, ulQueue );
+        prvDeleteQueue( xQueues[ ulQueue ], cName );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task sends a batch of messages to a nonblocking queue and receives them again. Each sample
+ * is the mean of a send and a receive in the batch. */
+
+static void prvSendReceive( size_t xBytes )
+{
+    char cBuffer[ QUEUE_MESSAGE_SIZE ];
+    uint32_t ulCount, ulMessage;
+    uint64_t ullStartNs;
+    mqd_t xQueue = prvOpenQueue( PING_QUEUE_NAME, O_NONBLOCK );
+
+    for( ulCount = 0U; ulCount < ulIterations; ulCount++ )
+    {
+        ullStartNs = ullBenchNowNs();
+
+        for( ulMessage = 0U; ulMessage < SEND_RECEIVE_BATCH; ulMessage++ )
+        {
+            if( mq_send( xQueue, cMessage, xBytes, 0 ) != 0 )
+            {
+                vBenchFail( "Failed to send a message." );
+            }
+        }
+
+        for( ulMessage = 0U; ulMessage < SEND_RECEIVE_BATCH; ulMessage++ )
+        {
+            if( mq_receive( xQueue, cBuffer, sizeof( cBuffer ), NULL ) != ( ssize_t ) xBytes )
+            {
+                vBenchFail( "Failed to receive a message." );
+            }
+        }
+
+        prvAddSample( ( ullBenchNowNs() - ullStartNs ) / SEND_RECEIVE_BATCH );
+    }
+
+    prvDeleteQueue( xQueue, PING_QUEUE_NAME );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A task sends a message to a task of higher priority, which sends it back on a second queue.
+ * Each sample is the round trip: two sends, two receives and two context switches. */
+
+static void prvEchoTask( void * pvParameters )
+{
+    char cBuffer[ QUEUE_MESSAGE_SIZE ];
+    mqd_t xPing = mq_open( PING_QUEUE_NAME, O_RDWR, 0600, NULL );
+    mqd_t xPong = mq_open( PONG_QUEUE_NAME, O_RDWR, 0600, NULL );
+    ssize_t xBytes;
+
+    ( void ) pvParameters;
+
+    do
+    {
+        xBytes = mq_receive( xPing, cBuffer, sizeof( cBuffer ), NULL );
+        ( void ) mq_send( xPong, cBuffer, ( size_t ) xBytes, 0 );
+    } while( cBuffer[ 0 ] != 0 );
+
+    ( void ) mq_close( xPing );
+    ( void ) mq_close( xPong );
+    ( void ) xTaskNotifyGive( xRunTask );
+    vTaskDelete( NULL );
+}
+
+static void prvPingPong( void )
+{
+    char cBuffer[ QUEUE_MESSAGE_SIZE ];
+    uint32_t ulCount;
+    uint64_t ullStartNs;
+    mqd_t xPing = prvOpenQueue( PING_QUEUE_NAME, 0 );
+    mqd_t xPong = prvOpenQueue( PONG_QUEUE_NAME, 0 );
+
+    if( xTaskCreate( prvEchoTask, "Echo", TASK_STACK_SIZE, NULL, ECHO_TASK_PRIORITY, NULL ) != pdPASS )
+    {
+        vBenchFail( "Failed to create a task." );
+    }
+
+    for( ulCount = ulIterations; ulCount > 0U; ulCount-- )
+    {
+        /* The last message is 0, which stops the echo task. */
+        cMessage[ 0 ] = ( char ) ( ulCount > 1U );
+        ullStartNs = ullBenchNowNs();
+        ( void ) mq_send( xPing, cMessage, SMALL_MESSAGE_SIZE, 0 );
+        ( void ) mq_receive( xPong, cBuffer, sizeof( cBuffer ), NULL );
+        prvAddSample( ullBenchNowNs() - ullStartNs );
+    }
+
+    ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+    prvDeleteQueue( xPing, PING_QUEUE_NAME );
+    prvDeleteQueue( xPong, PONG_QUEUE_NAME );
+    cMessage[ 0 ] = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Fill a queue of 10 messages of 128 bytes with messages of 16 bytes, and report how many fit
+ * and the heap the queue takes before and after. */
+
+static void prvCapacity( void )
+{
+    size_t xFreeHeap = xPortGetFreeHeapSize();
+    mqd_t xQueue = prvOpenQueue( PING_QUEUE_NAME, O_NONBLOCK );
+    size_t xEmptyHeap = xFreeHeap - xPortGetFreeHeapSize();
+    uint32_t ulMessages = 0U;
+
+    while( mq_send( xQueue, cMessage, SMALL_MESSAGE_SIZE, 0 ) == 0 )
+    {
+        ulMessages++;
+    }
+
+    if( errno != EAGAIN )
+    {
+        vBenchFail( "Failed to fill a queue." );
+    }
+
+    vBenchReportValue( "capacity_16", ulMessages, "messages of 16 bytes in a queue of 10 x 128 bytes" );
+    vBenchReportValue( "heap_empty", ( uint32_t ) xEmptyHeap, "bytes of heap of the queue" );
+    vBenchReportValue( "heap_full", ( uint32_t ) ( xFreeHeap - xPortGetFreeHeapSize() ), "bytes of heap of the queue when full" );
+
+    prvDeleteQueue( xQueue, PING_QUEUE_NAME );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRunTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    prvOpenClose( 1U );
+    prvReport( "open_close_1" );
+    prvOpenClose( 32U );
+    prvReport( "open_close_32" );
+    prvOpenClose( 256U );
+    prvReport( "open_close_256" );
+    prvSendReceive( SMALL_MESSAGE_SIZE );
+    prvReport( "send_receive_16" );
+    prvSendReceive( QUEUE_MESSAGE_SIZE );
+    prvReport( "send_receive_128" );
+    prvPingPong();
+    prvReport( "ping_pong_16" );
+    prvCapacity();
+
+    vBenchExit();
+}
+
+/*-----------------------------------------------------------*/
+
+void vBenchStart( uint32_t ulBenchIterations,
+                  uint32_t * pulBenchSamples )
+{
+    ulIterations = ulBenchIterations;
+    pulSamples = pulBenchSamples;
+    ( void ) memset( cMessage, 0x55, sizeof( cMessage ) );
+
+    if( xTaskCreate( prvRunTask, "Run", TASK_STACK_SIZE, NULL, RUN_TASK_PRIORITY, &xRunTask ) != pdPASS )
+    {
+        vBenchFail( "Failed to create the run task." );
+    }
+
+    vTaskStartScheduler();
+}
+
+/* The idle task is created statically, as static allocation is enabled for FreeRTOS+POSIX. */
+
+void vApplicationGetIdleTaskMemory( StaticTask_t ** ppxIdleTaskTCBBuffer,
+                                    StackType_t ** ppxIdleTaskStackBuffer,
+                                    uint32_t * pulIdleTaskStackSize )
+{
+    static StaticTask_t xIdleTaskTCB;
+    static StackType_t uxIdleTaskStack[ configMINIMAL_STACK_SIZE ];
+
+    *ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = uxIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
@@ -0,0 +1,445 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_compress.c
+ * @brief Host tool that compresses OTA images for the OTA agent's compressed file mode
+ * and benchmarks the device side decompressor.
+ *
+ * Usage:
+ *   ota_compress [-w window_bits] [-l length_bits] <image> <compressed image>
+ *   ota_compress -b [image]
+ *
+ * The benchmark compresses the image (or a generated firmware-like image) at several
+ * window sizes and reports the compression ratio, the decompression throughput and the
+ * RAM used by the decompressor.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "aws_ota_decompress.h"
+
+#define DEFAULT_WINDOW_BITS    10U
+#define DEFAULT_LENGTH_BITS    4U
+#define HASH_BITS              15U
+#define MAX_CHAIN              256U
+#define BENCH_BLOCK_SIZE       4096U    /* Compressed data is passed to the decompressor in blocks of this size, like OTA file blocks. */
+#define BENCH_MIN_SECONDS      0.5      /* Each window size is timed for at least this long. */
+#define GENERATED_IMAGE_SIZE   ( 512U * 1024U )
+
+typedef struct
+{
+    uint8_t * pucData;
+    size_t xSize;
+    size_t xCapacity;
+    uint32_t ulBits;
+    uint32_t ulBitCount;
+} BitWriter_t;
+
+typedef struct
+{
+    const uint8_t * pucExpected;
+    uint32_t ulWrites;
+    int lMismatch;
+} Sink_t;
+
+static void prvPutBits( BitWriter_t * pxWriter,
+                        uint32_t ulValue,
+                        uint32_t ulCount )
+{
+    pxWriter->ulBits = ( pxWriter->ulBits << ulCount ) | ( ulValue & ( ( 1UL << ulCount ) - 1UL ) );
+    pxWriter->ulBitCount += ulCount;
+
+    while( pxWriter->ulBitCount >= 8U )
+    {
+        pxWriter->ulBitCount -= 8U;
+
+        if( pxWriter->xSize == pxWriter->xCapacity )
+        {
+            pxWriter->xCapacity = ( pxWriter->xCapacity * 2U ) + 64U;
+            pxWriter->pucData = realloc( pxWriter->pucData, pxWriter->xCapacity );
+
+            if( pxWriter->pucData == NULL )
+            {
+                fprintf( stderr, "Out of memory.\n" );
+                exit( 1 );
+            }
+        }
+
+        pxWriter->pucData[ pxWriter->xSize++ ] = ( uint8_t ) ( pxWriter->ulBits >> pxWriter->ulBitCount );
+    }
+}
+
+static uint32_t prvHash( const uint8_t * pucData )
+{
+    uint32_t ulKey = ( ( uint32_t ) pucData[ 0 ] << 16 ) ^ ( ( uint32_t ) pucData[ 1 ] << 8 ) ^ pucData[ 2 ];
+
+    return ( uint32_t ) ( ulKey * 2654435761U ) >> ( 32U - HASH_BITS );
+}
+
+/* Greedy LZSS compression with hash chains. Returns a buffer holding the compressed file. */
+
+static uint8_t * prvCompress( const uint8_t * pucImage,
+                              size_t xSize,
+                              uint32_t ulWindowBits,
+                              uint32_t ulLengthBits,
+                              size_t * pxCompressedSize )
+{
+    BitWriter_t xWriter = { 0 };
+    uint32_t ulWindow = 1UL << ulWindowBits;
+    uint32_t ulMaxLength = 1UL << ulLengthBits;
+    uint32_t ulBreakEven = ( ( 1U + ulWindowBits + ulLengthBits ) / 9U ) + 1U; /* Shortest match cheaper than literals. */
+    int32_t * plHead = malloc( sizeof( int32_t ) << HASH_BITS );
+    int32_t * plPrev = malloc( sizeof( int32_t ) * ( xSize + 1U ) );
+    size_t xPos = 0, xInserted = 0;
+    uint32_t ulIndex;
+
+    if( ( plHead == NULL ) || ( plPrev == NULL ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( 1 );
+    }
+
+    for( ulIndex = 0; ulIndex < ( 1UL << HASH_BITS ); ulIndex++ )
+    {
+        plHead[ ulIndex ] = -1;
+    }
+
+    /* Header. */
+    for( ulIndex = 0; ulIndex < 4U; ulIndex++ )
+    {
+        prvPutBits( &xWriter, ( uint32_t ) "LZSS"[ ulIndex ], 8U );
+    }
+
+    prvPutBits( &xWriter, ulWindowBits, 8U );
+    prvPutBits( &xWriter, ulLengthBits, 8U );
+    prvPutBits( &xWriter, 0U, 16U );
+
+    for( ulIndex = 0; ulIndex < 4U; ulIndex++ )
+    {
+        prvPutBits( &xWriter, ( uint32_t ) ( xSize >> ( 8U * ulIndex ) ), 8U );
+    }
+
+    while( xPos < xSize )
+    {
+        uint32_t ulBestLength = 0, ulBestOffset = 0, ulChain = 0;
+
+        /* Add the positions before xPos to the hash chains. */
+        for( ; ( xInserted < xPos ) && ( ( xInserted + 3U ) <= xSize ); xInserted++ )
+        {
+            uint32_t ulHash = prvHash( &pucImage[ xInserted ] );
+            plPrev[ xInserted ] = plHead[ ulHash ];
+            plHead[ ulHash ] = ( int32_t ) xInserted;
+        }
+
+        if( ( xPos + 3U ) <= xSize )
+        {
+            int32_t lCandidate = plHead[ prvHash( &pucImage[ xPos ] ) ];
+
+            while( ( lCandidate >= 0 ) && ( ( xPos - ( size_t ) lCandidate ) <= ulWindow ) && ( ulChain++ < MAX_CHAIN ) )
+            {
+                uint32_t ulLength = 0;
+
+                while( ( ulLength < ulMaxLength ) && ( ( xPos + ulLength ) < xSize ) &&
+                       ( pucImage[ ( size_t ) lCandidate + ulLength ] == pucImage[ xPos + ulLength ] ) )
+                {
+                    ulLength++;
+                }
+
+                if( ulLength > ulBestLength )
+                {
+                    ulBestLength = ulLength;
+                    ulBestOffset = ( uint32_t ) ( xPos - ( size_t ) lCandidate );
+                }
+
+                lCandidate = plPrev[ lCandidate ];
+            }
+        }
+
+        if( ( ulBestLength >= ulBreakEven ) && ( ulBestLength >= 2U ) )
+        {
+            prvPutBits( &xWriter, 0U, 1U );
+            prvPutBits( &xWriter, ulBestOffset - 1U, ulWindowBits );
+            prvPutBits( &xWriter, ulBestLength - 1U, ulLengthBits );
+            xPos += ulBestLength;
+        }
+        else
+        {
+            prvPutBits( &xWriter, 1U, 1U );
+            prvPutBits( &xWriter, pucImage[ xPos ], 8U );
+            xPos++;
+        }
+    }
+
+    /* Pad the last byte with zero bits. */
+    if( xWriter.ulBitCount > 0U )
+    {
+        prvPutBits( &xWriter, 0U, 8U - xWriter.ulBitCount );
+    }
+
+    free( plHead );
+    free( plPrev );
+    *pxCompressedSize = xWriter.xSize;
+
+    return xWriter.pucData;
+}
+
+static uint8_t * prvReadFile( const char * pcPath,
+                              size_t * pxSize )
+{
+    FILE * pxFile = fopen( pcPath, "rb" );
+    uint8_t * pucData = NULL;
+    long lSize;
+
+    if( pxFile != NULL )
+    {
+        fseek( pxFile, 0, SEEK_END );
+        lSize = ftell( pxFile );
+        fseek( pxFile, 0, SEEK_SET );
+        pucData = malloc( ( lSize > 0 ) ? ( size_t ) lSize : 1U );
+
+        if( ( pucData != NULL ) && ( fread( pucData, 1, ( size_t ) lSize, pxFile ) == ( size_t ) lSize ) )
+        {
+            *pxSize = ( size_t ) lSize;
+        }
+        else
+        {
+            free( pucData );
+            pucData = NULL;
+        }
+
+        fclose( pxFile );
+    }
+
+    if( pucData == NULL )
+    {
+        fprintf( stderr, "Can't read %s.\n", pcPath );
+    }
+
+    return pucData;
+}
+
+/* Generate an image resembling firmware: runs of instruction-like words with repeated
+ * patterns, literal pools, padding and a little noise. */
+
+static uint8_t * prvGenerateImage( size_t xSize )
+{
+    uint8_t * pucData = malloc( xSize );
+    uint32_t ulSeed = 12345U;
+    size_t xPos = 0;
+
+    while( ( pucData != NULL ) && ( xPos < xSize ) )
+    {
+        uint32_t ulKind, ulLength, ulIndex;
+
+        ulSeed = ( ulSeed * 1103515245U ) + 12345U;
+        ulKind = ( ulSeed >> 16 ) % 10U;
+        ulLength = 16U + ( ( ulSeed >> 8 ) % 240U );
+
+        for( ulIndex = 0; ( ulIndex < ulLength ) && ( xPos < xSize ); ulIndex++, xPos++ )
+        {
+            if( ulKind == 0U )
+            {
+                pucData[ xPos ] = 0xffU; /* Padding. */
+            }
+            else if( ( ulKind < 6U ) && ( xPos >= 512U ) )
+            {
+                pucData[ xPos ] = pucData[ xPos - 64U - ( ( ulSeed >> 4 ) % 448U ) ]; /* Repeated code sequences. */
+            }
+            else
+            {
+                ulSeed = ( ulSeed * 1103515245U ) + 12345U;
+                pucData[ xPos ] = ( uint8_t ) ( ( ulSeed >> 16 ) & ( ( ulKind < 8U ) ? 0x3fU : 0xffU ) );
+            }
+        }
+    }
+
+    return pucData;
+}
+
+static int32_t prvCheckOutput( void * pvContext,
+                               uint32_t ulOffset,
+                               const uint8_t * pucData,
+                               uint32_t ulSize )
+{
+    Sink_t * pxSink = pvContext;
+
+    pxSink->ulWrites++;
+
+    if( memcmp( &pxSink->pucExpected[ ulOffset ], pucData, ulSize ) != 0 )
+    {
+        pxSink->lMismatch = 1;
+    }
+
+    return ( int32_t ) ulSize;
+}
+
+static double prvSeconds( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( double ) xNow.tv_sec + ( ( double ) xNow.tv_nsec / 1e9 );
+}
+
+static int prvBenchmark( const uint8_t * pucImage,
+                         size_t xSize )
+{
+    static const uint32_t ulWindowBits[] = { 8U, 9U, 10U, 11U, 12U, 13U, 14U };
+    uint32_t ulCase;
+    int lResult = 0;
+
+    printf( "Image: %u bytes, decompressed in %u byte blocks.\n\n", ( unsigned ) xSize, BENCH_BLOCK_SIZE );
+    printf( "window  length  compressed   ratio   writes   MB/s    RAM (state + window)\n" );
+
+    for( ulCase = 0; ulCase < ( sizeof( ulWindowBits ) / sizeof( ulWindowBits[ 0 ] ) ); ulCase++ )
+    {
+        uint32_t ulBits = ulWindowBits[ ulCase ];
+        uint32_t ulLengthBits = ( ulBits / 2U ) > 3U ? ( ulBits / 2U ) : 4U;
+        size_t xCompressedSize, xOffset;
+        uint8_t * pucCompressed = prvCompress( pucImage, xSize, ulBits, ulLengthBits, &xCompressedSize );
+        uint8_t * pucWindow = malloc( 1UL << ulBits );
+        OTA_Decompress_t xCtx;
+        OTA_DecompressResult_t eResult = eDecompress_Result_Continue;
+        Sink_t xSink = { pucImage, 0, 0 };
+        uint32_t ulRuns = 0;
+        double dStart = prvSeconds(), dElapsed;
+
+        do
+        {
+            xSink.ulWrites = 0;
+            OTA_Decompress_Init( &xCtx, pucWindow, 1UL << ulBits, prvCheckOutput, &xSink );
+
+            for( xOffset = 0; xOffset < xCompressedSize; xOffset += BENCH_BLOCK_SIZE )
+            {
+                size_t xBlock = ( ( xCompressedSize - xOffset ) < BENCH_BLOCK_SIZE ) ? ( xCompressedSize - xOffset ) : BENCH_BLOCK_SIZE;
+                eResult = OTA_Decompress_Update( &xCtx, &pucCompressed[ xOffset ], ( uint32_t ) xBlock );
+            }
+
+            ulRuns++;
+            dElapsed = prvSeconds() - dStart;
+        } while( dElapsed < BENCH_MIN_SECONDS );
+
+        if( ( eResult != eDecompress_Result_Complete ) || ( OTA_Decompress_Finish( &xCtx ) != eDecompress_Result_Complete ) || ( xSink.lMismatch != 0 ) )
+        {
+            printf( "W=%u: decompressed image doesn't match!\n", ulBits );
+            lResult = 1;
+        }
+
+        printf( "%6u  %6u  %10u  %5.1f%%  %7u  %6.1f  %u + %u = %u bytes\n",
+                ulBits,
+                ulLengthBits,
+                ( unsigned ) xCompressedSize,
+                100.0 * ( double ) xCompressedSize / ( double ) ( ( xSize > 0U ) ? xSize : 1U ),
+                xSink.ulWrites,
+                ( ( double ) xSize * ulRuns ) / ( dElapsed * 1e6 ),
+                ( unsigned ) sizeof( OTA_Decompress_t ),
+                ( unsigned ) ( 1UL << ulBits ),
+                ( unsigned ) ( sizeof( OTA_Decompress_t ) + ( 1UL << ulBits ) ) );
+
+        free( pucWindow );
+        free( pucCompressed );
+    }
+
+    return lResult;
+}
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulWindowBits = DEFAULT_WINDOW_BITS;
+    uint32_t ulLengthBits = DEFAULT_LENGTH_BITS;
+    uint8_t * pucImage = NULL;
+    size_t xSize = 0, xCompressedSize;
+    int lArg = 1, lResult = 1;
+
+    if( ( argc >= 2 ) && ( strcmp( argv[ 1 ], "-b" ) == 0 ) )
+    {
+        pucImage = ( argc >= 3 ) ? prvReadFile( argv[ 2 ], &xSize ) : prvGenerateImage( xSize = GENERATED_IMAGE_SIZE );
+
+        if( pucImage != NULL )
+        {
+            lResult = prvBenchmark( pucImage, xSize );
+        }
+    }
+    else
+    {
+        while( ( lArg + 1 < argc ) && ( argv[ lArg ][ 0 ] == '-' ) )
+        {
+            if( strcmp( argv[ lArg ], "-w" ) == 0 )
+            {
+                ulWindowBits = ( uint32_t ) atoi( argv[ lArg + 1 ] );
+            }
+            else if( strcmp( argv[ lArg ], "-l" ) == 0 )
+            {
+                ulLengthBits = ( uint32_t ) atoi( argv[ lArg + 1 ] );
+            }
+
+            lArg += 2;
+        }
+
+        if( ( argc - lArg ) != 2 )
+        {
+            fprintf( stderr, "Usage: %s [-w window_bits] [-l length_bits] <image> <compressed image>\n"
+                             "       %s -b [image]\n", argv[ 0 ], argv[ 0 ] );
+        }
+        else if( ( ulWindowBits < OTA_DECOMPRESS_MIN_WINDOW_BITS ) || ( ulWindowBits > OTA_DECOMPRESS_MAX_WINDOW_BITS ) ||
+                 ( ulLengthBits < 3U ) || ( ulLengthBits >= ulWindowBits ) )
+        {
+            fprintf( stderr, "The window must be %u to %u bits and the length 3 bits to one less than the window.\n",
+                     OTA_DECOMPRESS_MIN_WINDOW_BITS, OTA_DECOMPRESS_MAX_WINDOW_BITS );
+        }
+        else if( ( pucImage = prvReadFile( argv[ lArg ], &xSize ) ) != NULL )
+        {
+            uint8_t * pucCompressed = prvCompress( pucImage, xSize, ulWindowBits, ulLengthBits, &xCompressedSize );
+            FILE * pxFile = fopen( argv[ lArg + 1 ], "wb" );
+
+            if( ( pxFile != NULL ) && ( fwrite( pucCompressed, 1, xCompressedSize, pxFile ) == xCompressedSize ) )
+            {
+                printf( "%u bytes compressed to %u bytes with a %u byte window.\n",
+                        ( unsigned ) xSize, ( unsigned ) xCompressedSize, 1U << ulWindowBits );
+                lResult = 0;
+            }
+            else
+            {
+                fprintf( stderr, "Can't write %s.\n", argv[ lArg + 1 ] );
+            }
+
+            if( pxFile != NULL )
+            {
+                fclose( pxFile );
+            }
+
+            free( pucCompressed );
+        }
+    }
+
+    free( pucImage );
+
+    return lResult;
+}
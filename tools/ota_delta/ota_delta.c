@@ -0,0 +1,672 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_delta.c
+ * @brief Host tool that creates delta files for the OTA agent's delta file mode and
+ * benchmarks the device side patch applier.
+ *
+ * Usage:
+ *   ota_delta <base image> <new image> <delta file>
+ *   ota_delta -b [base image new image]
+ *
+ * The delta file is checked by applying it with the device side applier before it is
+ * written. The benchmark reports the delta size, the applier throughput and its RAM use.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "aws_ota_delta.h"
+
+#define HASH_BITS               16U
+#define MAX_CHAIN               64U
+#define MIN_MATCH               8U       /* Shortest exact match that starts a copy or add operation. */
+#define MIN_COPY                32U      /* Shortest exact run within a match that gets its own copy operation. */
+#define MAX_EXTEND_SLACK        64U      /* A match is not extended further than this past its last improvement. */
+#define BENCH_BLOCK_SIZE        4096U    /* The delta file is passed to the applier in blocks of this size, like OTA file blocks. */
+#define BENCH_MIN_SECONDS       0.5      /* Each buffer size is timed for at least this long. */
+#define GENERATED_IMAGE_SIZE    ( 512U * 1024U )
+#define GENERATED_LOAD_ADDRESS  0x08000000UL
+
+typedef struct
+{
+    uint8_t * pucData;
+    size_t xSize;
+    size_t xCapacity;
+} Writer_t;
+
+typedef struct
+{
+    const uint8_t * pucBase;
+    size_t xBaseSize;
+    const uint8_t * pucExpected;
+    uint32_t ulWrites;
+    uint32_t ulReads;
+    int32_t lMismatch;
+} Sink_t;
+
+static void prvPutByte( Writer_t * pxWriter,
+                        uint8_t ucByte )
+{
+    if( pxWriter->xSize == pxWriter->xCapacity )
+    {
+        pxWriter->xCapacity = ( pxWriter->xCapacity * 2U ) + 64U;
+        pxWriter->pucData = realloc( pxWriter->pucData, pxWriter->xCapacity );
+
+        if( pxWriter->pucData == NULL )
+        {
+            fprintf( stderr, "Out of memory.\n" );
+            exit( 1 );
+        }
+    }
+
+    pxWriter->pucData[ pxWriter->xSize++ ] = ucByte;
+}
+
+static void prvPutNumber( Writer_t * pxWriter,
+                          uint32_t ulValue )
+{
+    while( ulValue >= 0x80U )
+    {
+        prvPutByte( pxWriter, ( uint8_t ) ( ulValue | 0x80U ) );
+        ulValue >>= 7;
+    }
+
+    prvPutByte( pxWriter, ( uint8_t ) ulValue );
+}
+
+static void prvPutWord( Writer_t * pxWriter,
+                        uint32_t ulValue )
+{
+    prvPutByte( pxWriter, ( uint8_t ) ulValue );
+    prvPutByte( pxWriter, ( uint8_t ) ( ulValue >> 8 ) );
+    prvPutByte( pxWriter, ( uint8_t ) ( ulValue >> 16 ) );
+    prvPutByte( pxWriter, ( uint8_t ) ( ulValue >> 24 ) );
+}
+
+/* Write a copy or add operation. The seek moves the base position to ulBaseOffset. */
+
+static void prvPutBaseOperation( Writer_t * pxWriter,
+                                 uint8_t ucOperation,
+                                 const uint8_t * pucBase,
+                                 const uint8_t * pucImage,
+                                 uint32_t ulBaseOffset,
+                                 uint32_t ulLength,
+                                 uint32_t * pulBasePosition )
+{
+    int32_t lSeek = ( int32_t ) ( ulBaseOffset - *pulBasePosition );
+    uint32_t ulIndex;
+
+    prvPutByte( pxWriter, ucOperation );
+    prvPutNumber( pxWriter, ulLength );
+    prvPutNumber( pxWriter, ( ( uint32_t ) lSeek << 1 ) ^ ( uint32_t ) ( lSeek >> 31 ) );
+
+    if( ucOperation == OTA_DELTA_OP_ADD )
+    {
+        for( ulIndex = 0; ulIndex < ulLength; ulIndex++ )
+        {
+            prvPutByte( pxWriter, ( uint8_t ) ( pucImage[ ulIndex ] - pucBase[ ulBaseOffset + ulIndex ] ) );
+        }
+    }
+
+    *pulBasePosition = ulBaseOffset + ulLength;
+}
+
+/* Write a match of ulLength image bytes with the base image at ulBaseOffset. Long exact runs are
+ * copied and the rest, which has some differing bytes, is added. */
+
+static void prvPutMatch( Writer_t * pxWriter,
+                         const uint8_t * pucBase,
+                         const uint8_t * pucImage,
+                         uint32_t ulBaseOffset,
+                         uint32_t ulLength,
+                         uint32_t * pulBasePosition )
+{
+    uint32_t ulStart = 0, ulIndex = 0, ulRun;
+
+    while( ulIndex < ulLength )
+    {
+        for( ulRun = 0; ( ( ulIndex + ulRun ) < ulLength ) && ( pucImage[ ulIndex + ulRun ] == pucBase[ ulBaseOffset + ulIndex + ulRun ] ); ulRun++ )
+        {
+        }
+
+        if( ( ulRun >= MIN_COPY ) || ( ( ulIndex + ulRun ) == ulLength ) )
+        {
+            if( ulIndex > ulStart )
+            {
+                prvPutBaseOperation( pxWriter, OTA_DELTA_OP_ADD, pucBase, &pucImage[ ulStart ], ulBaseOffset + ulStart, ulIndex - ulStart, pulBasePosition );
+            }
+
+            if( ulRun > 0U )
+            {
+                prvPutBaseOperation( pxWriter, OTA_DELTA_OP_COPY, pucBase, &pucImage[ ulIndex ], ulBaseOffset + ulIndex, ulRun, pulBasePosition );
+            }
+
+            ulStart = ulIndex + ulRun;
+        }
+
+        ulIndex += ( ulRun > 0U ) ? ulRun : 1U;
+    }
+
+    if( ulLength > ulStart )
+    {
+        prvPutBaseOperation( pxWriter, OTA_DELTA_OP_ADD, pucBase, &pucImage[ ulStart ], ulBaseOffset + ulStart, ulLength - ulStart, pulBasePosition );
+    }
+}
+
+static void prvPutInsert( Writer_t * pxWriter,
+                          const uint8_t * pucImage,
+                          uint32_t ulLength )
+{
+    uint32_t ulIndex;
+
+    if( ulLength > 0U )
+    {
+        prvPutByte( pxWriter, OTA_DELTA_OP_INSERT );
+        prvPutNumber( pxWriter, ulLength );
+
+        for( ulIndex = 0; ulIndex < ulLength; ulIndex++ )
+        {
+            prvPutByte( pxWriter, pucImage[ ulIndex ] );
+        }
+    }
+}
+
+static uint32_t prvHash( const uint8_t * pucData )
+{
+    uint32_t ulLow = ( uint32_t ) pucData[ 0 ] | ( ( uint32_t ) pucData[ 1 ] << 8 ) | ( ( uint32_t ) pucData[ 2 ] << 16 ) | ( ( uint32_t ) pucData[ 3 ] << 24 );
+    uint32_t ulHigh = ( uint32_t ) pucData[ 4 ] | ( ( uint32_t ) pucData[ 5 ] << 8 ) | ( ( uint32_t ) pucData[ 6 ] << 16 ) | ( ( uint32_t ) pucData[ 7 ] << 24 );
+
+    return ( ( ulLow * 2654435761U ) ^ ( ulHigh * 2246822519U ) ) >> ( 32U - HASH_BITS );
+}
+
+static uint32_t prvMatchLength( const uint8_t * pucA,
+                                const uint8_t * pucB,
+                                uint32_t ulMax )
+{
+    uint32_t ulLength = 0;
+
+    while( ( ulLength < ulMax ) && ( pucA[ ulLength ] == pucB[ ulLength ] ) )
+    {
+        ulLength++;
+    }
+
+    return ulLength;
+}
+
+/* Create a delta file rebuilding pucImage from pucBase. Each image position is looked up in a hash
+ * index of 8 byte strings of the base image, and the base position following the previous match is
+ * tried first. A match is extended past differing bytes for as long as most bytes still match, like
+ * bsdiff does, so that code that only moved becomes one add operation with mostly zero differences. */
+
+static uint8_t * prvDiff( const uint8_t * pucBase,
+                          size_t xBaseSize,
+                          const uint8_t * pucImage,
+                          size_t xSize,
+                          size_t * pxDeltaSize )
+{
+    Writer_t xWriter = { NULL, 0, 0 };
+    int32_t * plHead = malloc( sizeof( int32_t ) << HASH_BITS );
+    int32_t * plPrev = malloc( sizeof( int32_t ) * ( xBaseSize + 1U ) );
+    uint32_t ulPos = 0, ulInsertStart = 0, ulBasePosition = 0;
+    uint32_t ulIndex;
+
+    prvPutByte( &xWriter, 'O' );
+    prvPutByte( &xWriter, 'T' );
+    prvPutByte( &xWriter, 'A' );
+    prvPutByte( &xWriter, 'D' );
+    prvPutWord( &xWriter, ( uint32_t ) xBaseSize );
+    prvPutWord( &xWriter, ( uint32_t ) xSize );
+
+    memset( plHead, 0xff, sizeof( int32_t ) << HASH_BITS );
+
+    for( ulIndex = 0; ( ulIndex + MIN_MATCH ) <= xBaseSize; ulIndex++ )
+    {
+        uint32_t ulHash = prvHash( &pucBase[ ulIndex ] );
+        plPrev[ ulIndex ] = plHead[ ulHash ];
+        plHead[ ulHash ] = ( int32_t ) ulIndex;
+    }
+
+    while( ( ulPos + MIN_MATCH ) <= xSize )
+    {
+        uint32_t ulBest = 0, ulBestOffset = 0, ulChain = 0, ulLength;
+        uint32_t ulExpected = ulBasePosition + ( ulPos - ulInsertStart );
+        int32_t lCandidate;
+
+        /* The base image usually continues where the last match ended. */
+        if( ulExpected < xBaseSize )
+        {
+            ulBest = prvMatchLength( &pucBase[ ulExpected ], &pucImage[ ulPos ],
+                                     ( uint32_t ) ( ( ( xBaseSize - ulExpected ) < ( xSize - ulPos ) ) ? ( xBaseSize - ulExpected ) : ( xSize - ulPos ) ) );
+            ulBestOffset = ulExpected;
+        }
+
+        for( lCandidate = plHead[ prvHash( &pucImage[ ulPos ] ) ];
+             ( lCandidate >= 0 ) && ( ulChain < MAX_CHAIN ) && ( ulBest < 256U );
+             lCandidate = plPrev[ lCandidate ], ulChain++ )
+        {
+            uint32_t ulMax = ( uint32_t ) ( ( ( xBaseSize - ( size_t ) lCandidate ) < ( xSize - ulPos ) ) ? ( xBaseSize - ( size_t ) lCandidate ) : ( xSize - ulPos ) );
+
+            ulLength = prvMatchLength( &pucBase[ lCandidate ], &pucImage[ ulPos ], ulMax );
+
+            if( ulLength > ulBest )
+            {
+                ulBest = ulLength;
+                ulBestOffset = ( uint32_t ) lCandidate;
+            }
+        }
+
+        if( ulBest >= MIN_MATCH )
+        {
+            /* Extend the match while twice the matching bytes minus the length keeps growing. */
+            int32_t lScore = 0, lBestScore = 0;
+            uint32_t ulExtended = 0;
+
+            for( ulLength = 0;
+                 ( ( ulPos + ulLength ) < xSize ) && ( ( ulBestOffset + ulLength ) < xBaseSize ) && ( ( ulLength - ulExtended ) <= MAX_EXTEND_SLACK );
+                 )
+            {
+                lScore += ( pucImage[ ulPos + ulLength ] == pucBase[ ulBestOffset + ulLength ] ) ? 1 : -1;
+                ulLength++;
+
+                if( lScore > lBestScore )
+                {
+                    lBestScore = lScore;
+                    ulExtended = ulLength;
+                }
+            }
+
+            prvPutInsert( &xWriter, &pucImage[ ulInsertStart ], ulPos - ulInsertStart );
+            prvPutMatch( &xWriter, pucBase, &pucImage[ ulPos ], ulBestOffset, ulExtended, &ulBasePosition );
+            ulPos += ulExtended;
+            ulInsertStart = ulPos;
+        }
+        else
+        {
+            ulPos++;
+        }
+    }
+
+    prvPutInsert( &xWriter, &pucImage[ ulInsertStart ], ( uint32_t ) xSize - ulInsertStart );
+
+    free( plHead );
+    free( plPrev );
+    *pxDeltaSize = xWriter.xSize;
+
+    return xWriter.pucData;
+}
+
+static uint8_t * prvReadFile( const char * pcPath,
+                              size_t * pxSize )
+{
+    FILE * pxFile = fopen( pcPath, "rb" );
+    uint8_t * pucData = NULL;
+    long lSize;
+
+    if( pxFile != NULL )
+    {
+        fseek( pxFile, 0, SEEK_END );
+        lSize = ftell( pxFile );
+        fseek( pxFile, 0, SEEK_SET );
+        pucData = malloc( ( lSize > 0 ) ? ( size_t ) lSize : 1U );
+
+        if( ( pucData != NULL ) && ( fread( pucData, 1, ( size_t ) lSize, pxFile ) == ( size_t ) lSize ) )
+        {
+            *pxSize = ( size_t ) lSize;
+        }
+        else
+        {
+            free( pucData );
+            pucData = NULL;
+        }
+
+        fclose( pxFile );
+    }
+
+    if( pucData == NULL )
+    {
+        fprintf( stderr, "Can't read %s.\n", pcPath );
+    }
+
+    return pucData;
+}
+
+/* Generate an image resembling firmware: runs of instruction-like words with repeated patterns,
+ * literal pools of addresses within the image, padding and a little noise. */
+
+static uint8_t * prvGenerateImage( size_t xSize )
+{
+    uint8_t * pucData = malloc( xSize );
+    uint32_t ulSeed = 12345U;
+    size_t xPos = 0;
+
+    while( ( pucData != NULL ) && ( xPos < xSize ) )
+    {
+        uint32_t ulKind, ulLength, ulIndex, ulAddress;
+
+        ulSeed = ( ulSeed * 1103515245U ) + 12345U;
+        ulKind = ( ulSeed >> 16 ) % 10U;
+        ulLength = 16U + ( ( ulSeed >> 8 ) % 240U );
+
+        if( ulKind == 9U )
+        {
+            /* A literal pool of word aligned addresses within the image. */
+            xPos &= ~( size_t ) 3U;
+
+            for( ulIndex = 0; ( ulIndex < ( ulLength / 4U ) ) && ( ( xPos + 4U ) <= xSize ); ulIndex++, xPos += 4U )
+            {
+                ulSeed = ( ulSeed * 1103515245U ) + 12345U;
+                ulAddress = GENERATED_LOAD_ADDRESS + ( ( ulSeed >> 4 ) % ( uint32_t ) xSize );
+                memcpy( &pucData[ xPos ], &ulAddress, sizeof( ulAddress ) );
+            }
+        }
+
+        for( ulIndex = 0; ( ulIndex < ulLength ) && ( xPos < xSize ); ulIndex++, xPos++ )
+        {
+            if( ulKind == 0U )
+            {
+                pucData[ xPos ] = 0xffU; /* Padding. */
+            }
+            else if( ( ulKind < 6U ) && ( xPos >= 512U ) )
+            {
+                pucData[ xPos ] = pucData[ xPos - 64U - ( ( ulSeed >> 4 ) % 448U ) ]; /* Repeated code sequences. */
+            }
+            else
+            {
+                ulSeed = ( ulSeed * 1103515245U ) + 12345U;
+                pucData[ xPos ] = ( uint8_t ) ( ( ulSeed >> 16 ) & ( ( ulKind < 8U ) ? 0x3fU : 0xffU ) );
+            }
+        }
+    }
+
+    return pucData;
+}
+
+/* Generate a patch release of a generated image: a few functions change or grow, which moves the
+ * code after them, so every address in a literal pool beyond the first change moves as well. */
+
+static uint8_t * prvGeneratePatchRelease( const uint8_t * pucBase,
+                                          size_t xBaseSize,
+                                          size_t * pxSize )
+{
+    static const uint32_t ulChanges[][ 2 ] = /* Position per mille of the image, bytes inserted. */
+    {
+        { 120U, 96U }, { 410U, 0U }, { 415U, 24U }, { 700U, 160U }, { 905U, 8U }
+    };
+    size_t xCapacity = xBaseSize + 1024U, xIn = 0, xOut = 0;
+    uint8_t * pucImage = malloc( xCapacity );
+    uint32_t ulSeed = 777U, ulChange, ulIndex, ulShift = 0, ulWord;
+
+    for( ulChange = 0; ulChange < ( sizeof( ulChanges ) / sizeof( ulChanges[ 0 ] ) ); ulChange++ )
+    {
+        size_t xAt = ( ( xBaseSize * ulChanges[ ulChange ][ 0 ] ) / 1000U ) & ~( size_t ) 3U;
+
+        memcpy( &pucImage[ xOut ], &pucBase[ xIn ], xAt - xIn );
+        xOut += xAt - xIn;
+        xIn = xAt;
+
+        /* Rewrite 32 bytes of the function and add the new code after them. */
+        for( ulIndex = 0; ulIndex < ( 32U + ulChanges[ ulChange ][ 1 ] ); ulIndex++ )
+        {
+            ulSeed = ( ulSeed * 1103515245U ) + 12345U;
+            pucImage[ xOut++ ] = ( uint8_t ) ( ulSeed >> 16 );
+        }
+
+        xIn += 32U;
+    }
+
+    memcpy( &pucImage[ xOut ], &pucBase[ xIn ], xBaseSize - xIn );
+    xOut += xBaseSize - xIn;
+
+    /* Relocate the addresses. Inserted bytes are multiples of 4, so literal pools stay aligned. */
+    for( ulIndex = 0; ( ulIndex + 4U ) <= xOut; ulIndex += 4U )
+    {
+        memcpy( &ulWord, &pucImage[ ulIndex ], sizeof( ulWord ) );
+
+        if( ( ulWord >= GENERATED_LOAD_ADDRESS ) && ( ulWord < ( GENERATED_LOAD_ADDRESS + xBaseSize ) ) )
+        {
+            for( ulChange = 0, ulShift = 0; ulChange < ( sizeof( ulChanges ) / sizeof( ulChanges[ 0 ] ) ); ulChange++ )
+            {
+                if( ( ulWord - GENERATED_LOAD_ADDRESS ) >= ( ( xBaseSize * ulChanges[ ulChange ][ 0 ] ) / 1000U ) )
+                {
+                    ulShift += ulChanges[ ulChange ][ 1 ];
+                }
+            }
+
+            ulWord += ulShift;
+            memcpy( &pucImage[ ulIndex ], &ulWord, sizeof( ulWord ) );
+        }
+    }
+
+    *pxSize = xOut;
+
+    return pucImage;
+}
+
+static int32_t prvReadBase( void * pvContext,
+                            uint32_t ulOffset,
+                            uint8_t * pucData,
+                            uint32_t ulSize )
+{
+    Sink_t * pxSink = pvContext;
+
+    pxSink->ulReads++;
+    memcpy( pucData, &pxSink->pucBase[ ulOffset ], ulSize );
+
+    return 0;
+}
+
+static int32_t prvCheckBase( void * pvContext,
+                             uint32_t ulBaseSize,
+                             uint8_t * pucBuffer,
+                             uint32_t ulBufferSize )
+{
+    Sink_t * pxSink = pvContext;
+
+    ( void ) pucBuffer;
+    ( void ) ulBufferSize;
+
+    return ( ulBaseSize == pxSink->xBaseSize ) ? 0 : -1;
+}
+
+static int32_t prvCheckOutput( void * pvContext,
+                               uint32_t ulOffset,
+                               const uint8_t * pucData,
+                               uint32_t ulSize )
+{
+    Sink_t * pxSink = pvContext;
+
+    pxSink->ulWrites++;
+
+    if( memcmp( &pxSink->pucExpected[ ulOffset ], pucData, ulSize ) != 0 )
+    {
+        pxSink->lMismatch = 1;
+    }
+
+    return ( int32_t ) ulSize;
+}
+
+/* Apply the delta file in OTA sized blocks and check the result against the new image. */
+
+static int prvApply( const uint8_t * pucDelta,
+                     size_t xDeltaSize,
+                     uint8_t * pucBuffer,
+                     uint32_t ulBufferSize,
+                     Sink_t * pxSink )
+{
+    OTA_Delta_t xCtx;
+    OTA_DeltaResult_t eResult = eDelta_Result_Continue;
+    size_t xOffset;
+
+    pxSink->ulWrites = 0;
+    pxSink->ulReads = 0;
+    OTA_Delta_Init( &xCtx, pucBuffer, ulBufferSize, prvReadBase, prvCheckBase, prvCheckOutput, pxSink );
+
+    for( xOffset = 0; ( xOffset < xDeltaSize ) && ( eResult >= eDelta_Result_Continue ); xOffset += BENCH_BLOCK_SIZE )
+    {
+        size_t xBlock = ( ( xDeltaSize - xOffset ) < BENCH_BLOCK_SIZE ) ? ( xDeltaSize - xOffset ) : BENCH_BLOCK_SIZE;
+        eResult = OTA_Delta_Update( &xCtx, &pucDelta[ xOffset ], ( uint32_t ) xBlock );
+    }
+
+    return ( ( eResult == eDelta_Result_Complete ) && ( OTA_Delta_Finish( &xCtx ) == eDelta_Result_Complete ) && ( pxSink->lMismatch == 0 ) ) ? 0 : 1;
+}
+
+static double prvSeconds( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( double ) xNow.tv_sec + ( ( double ) xNow.tv_nsec / 1e9 );
+}
+
+static int prvBenchmark( const uint8_t * pucBase,
+                         size_t xBaseSize,
+                         const uint8_t * pucImage,
+                         size_t xSize )
+{
+    static const uint32_t ulBufferSizes[] = { 64U, 256U, 1024U, 4096U };
+    Sink_t xSink = { pucBase, xBaseSize, pucImage, 0, 0, 0 };
+    size_t xDeltaSize;
+    double dStart = prvSeconds(), dElapsed;
+    uint8_t * pucDelta = prvDiff( pucBase, xBaseSize, pucImage, xSize, &xDeltaSize );
+    uint32_t ulCase;
+    int lResult = 0;
+
+    dElapsed = prvSeconds() - dStart;
+    printf( "Base image: %u bytes, new image: %u bytes.\n", ( unsigned ) xBaseSize, ( unsigned ) xSize );
+    printf( "Delta file: %u bytes (%.1f%% of the new image, %.1fx smaller), created in %.2f s.\n",
+            ( unsigned ) xDeltaSize,
+            100.0 * ( double ) xDeltaSize / ( double ) ( ( xSize > 0U ) ? xSize : 1U ),
+            ( double ) xSize / ( double ) xDeltaSize,
+            dElapsed );
+    printf( "Applied in %u byte blocks.\n\n", BENCH_BLOCK_SIZE );
+    printf( "buffer   reads   writes   MB/s    RAM (state + buffer)\n" );
+
+    for( ulCase = 0; ulCase < ( sizeof( ulBufferSizes ) / sizeof( ulBufferSizes[ 0 ] ) ); ulCase++ )
+    {
+        uint8_t * pucBuffer = malloc( ulBufferSizes[ ulCase ] );
+        uint32_t ulRuns = 0;
+
+        dStart = prvSeconds();
+
+        do
+        {
+            if( prvApply( pucDelta, xDeltaSize, pucBuffer, ulBufferSizes[ ulCase ], &xSink ) != 0 )
+            {
+                lResult = 1;
+            }
+
+            ulRuns++;
+            dElapsed = prvSeconds() - dStart;
+        } while( dElapsed < BENCH_MIN_SECONDS );
+
+        if( lResult != 0 )
+        {
+            printf( "Buffer of %u bytes: new image doesn't match!\n", ulBufferSizes[ ulCase ] );
+        }
+
+        printf( "%6u  %6u  %7u  %6.1f  %u + %u = %u bytes\n",
+                ulBufferSizes[ ulCase ],
+                xSink.ulReads,
+                xSink.ulWrites,
+                ( ( double ) xSize * ulRuns ) / ( dElapsed * 1e6 ),
+                ( unsigned ) sizeof( OTA_Delta_t ),
+                ulBufferSizes[ ulCase ],
+                ( unsigned ) ( sizeof( OTA_Delta_t ) + ulBufferSizes[ ulCase ] ) );
+
+        free( pucBuffer );
+    }
+
+    free( pucDelta );
+
+    return lResult;
+}
+
+int main( int argc,
+          char ** argv )
+{
+    uint8_t * pucBase = NULL, * pucImage = NULL, * pucDelta = NULL;
+    size_t xBaseSize = 0, xSize = 0, xDeltaSize;
+    int lResult = 1;
+
+    if( ( argc >= 2 ) && ( strcmp( argv[ 1 ], "-b" ) == 0 ) )
+    {
+        if( argc >= 4 )
+        {
+            pucBase = prvReadFile( argv[ 2 ], &xBaseSize );
+            pucImage = prvReadFile( argv[ 3 ], &xSize );
+        }
+        else
+        {
+            pucBase = prvGenerateImage( xBaseSize = GENERATED_IMAGE_SIZE );
+            pucImage = ( pucBase != NULL ) ? prvGeneratePatchRelease( pucBase, xBaseSize, &xSize ) : NULL;
+        }
+
+        if( ( pucBase != NULL ) && ( pucImage != NULL ) )
+        {
+            lResult = prvBenchmark( pucBase, xBaseSize, pucImage, xSize );
+        }
+    }
+    else if( argc != 4 )
+    {
+        fprintf( stderr, "Usage: %s <base image> <new image> <delta file>\n"
+                         "       %s -b [base image new image]\n", argv[ 0 ], argv[ 0 ] );
+    }
+    else if( ( ( pucBase = prvReadFile( argv[ 1 ], &xBaseSize ) ) != NULL ) &&
+             ( ( pucImage = prvReadFile( argv[ 2 ], &xSize ) ) != NULL ) )
+    {
+        Sink_t xSink = { pucBase, xBaseSize, pucImage, 0, 0, 0 };
+        uint8_t ucBuffer[ 256 ];
+        FILE * pxFile;
+
+        pucDelta = prvDiff( pucBase, xBaseSize, pucImage, xSize, &xDeltaSize );
+
+        if( prvApply( pucDelta, xDeltaSize, ucBuffer, sizeof( ucBuffer ), &xSink ) != 0 )
+        {
+            fprintf( stderr, "The delta file doesn't rebuild the new image.\n" );
+        }
+        else if( ( ( pxFile = fopen( argv[ 3 ], "wb" ) ) == NULL ) ||
+                 ( fwrite( pucDelta, 1, xDeltaSize, pxFile ) != xDeltaSize ) ||
+                 ( fclose( pxFile ) != 0 ) )
+        {
+            fprintf( stderr, "Can't write %s.\n", argv[ 3 ] );
+        }
+        else
+        {
+            printf( "%u byte image as a %u byte delta file from the %u byte base image.\n",
+                    ( unsigned ) xSize, ( unsigned ) xDeltaSize, ( unsigned ) xBaseSize );
+            lResult = 0;
+        }
+    }
+
+    free( pucDelta );
+    free( pucImage );
+    free( pucBase );
+
+    return lResult;
+}
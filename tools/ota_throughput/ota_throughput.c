@@ -0,0 +1,1116 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_throughput.c
+ * @brief End to end throughput benchmark of the OTA agent on a host FreeRTOS port.
+ *
+ * Usage:
+ *   ota_throughput [image size in KB] [loss in percent] [reorder in percent] [latency in ms] [link KB/s] [-v] [-c close ms] [-m heap trace] [-a]
+ *
+ * The OTA agent downloads a signed image from a stand-in for the MQTT agent and the AWS IoT
+ * job and stream services, and writes it with the POSIX file PAL. The stand-in answers the job
+ * request with a job document for the image and each stream request with the blocks it asks
+ * for. Messages to the device share a link of the given bandwidth and latency that loses and
+ * reorders the given percentage of them; requests from the device are delayed by the latency
+ * and lost the same way. As with MQTT, only QoS 0 messages are lost: the job request and the
+ * job document are QoS 1, so the broker would send them again. The link runs in its own task on the tick, so the time is real.
+ *
+ * The tool reports the time from the delivery of the job document to the OTA complete callback,
+ * the host CPU time the agent took per OTA file block, without the CPU time of the link, and
+ * the FreeRTOS heap the download took at its peak. The received file is compared to the image.
+ * With -a it also reports the heap in use by each task and call site at the end of the download.
+ * With -c the PAL takes the given time longer to close the file, and the run fails if the link
+ * task waited that long for the agent to return a message lent to it.
+ */
+
+/* _GNU_SOURCE for dladdr(). */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dlfcn.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Amazon FreeRTOS includes. */
+#include "aws_mqtt_agent.h"
+#include "aws_ota_agent.h"
+#include "aws_ota_agent_config.h"
+#include "aws_ota_cbor_internal.h"
+#include "aws_ota_pal.h"
+#include "aws_application_version.h"
+#include "aws_crypto.h"
+#include "cbor.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/base64.h"
+
+#define THING_NAME               "ota_throughput"
+#define JOB_ID                   "ota-throughput"
+#define STREAM_NAME              "ota-throughput"
+#define FILE_PATH                "ota_throughput.bin"
+#define CERT_FILE                "ecdsa-sha256-signer.crt.pem"
+#define KEY_FILE                 "ecdsa-sha256-signer.key.pem"
+#define TEST_FILES_DIR           "../../tests/common/ota/test_files/" /* Relative to this directory. */
+#define FILE_BLOCK_SIZE          ( 1UL << otaconfigLOG2_FILE_BLOCK_SIZE )
+#define MAX_SUBSCRIPTIONS        8U
+#define MAX_TOPIC_LEN            128U
+#define MAX_BITMAP_SIZE          128U  /* OTA_MAX_BLOCK_BITMAP_SIZE of the agent. */
+#define MQTT_HEADER_SIZE         4U    /* Fixed header and topic length of a QoS 0 publish. */
+#define CBOR_HEADER_SIZE         96U   /* Room for the fields of a stream data message. */
+#define REORDER_BURST_MSGS       8U    /* A reordered message is held for up to this many messages more. */
+#define LINK_TASK_PRIORITY       ( configMAX_PRIORITIES - 1 )
+#define RUN_TASK_PRIORITY        ( configMAX_PRIORITIES - 2 )
+#define LINK_TASK_STACK_SIZE     ( configMINIMAL_STACK_SIZE * 4 )
+#define RUN_TASK_STACK_SIZE      ( configMINIMAL_STACK_SIZE * 4 )
+#define AGENT_READY_TICKS        pdMS_TO_TICKS( 10000UL )
+#define AGENT_SHUTDOWN_TICKS     pdMS_TO_TICKS( 10000UL )
+#define MIN_TIMEOUT_MS           60000UL
+#define DEFAULT_IMAGE_KB         256U
+#define DEFAULT_LOSS_PERCENT     1U
+#define DEFAULT_REORDER_PERCENT  1U
+#define DEFAULT_LATENCY_MS       40U
+#define DEFAULT_LINK_KBPS        200U
+#define HEAP_EVENTS_PER_READ     256U
+#define HEAP_REPORT_CALL_SITES   16U   /* The call sites with the highest peak reported by -a. */
+
+/* A message on the simulated link. */
+
+typedef struct LinkMsg
+{
+    struct LinkMsg * pxNext;
+    uint64_t ullDeliverUs;       /* Time at which the message arrives. */
+    BaseType_t xToDevice;        /* Sent by the services to the device, otherwise by the device. */
+    uint16_t usTopicLength;
+    uint32_t ulDataLength;
+    uint8_t * pucTopic;          /* Both point into the memory of the message. */
+    uint8_t * pucData;
+} LinkMsg_t;
+
+/* A subscription of the OTA agent. */
+
+typedef struct
+{
+    char cTopic[ MAX_TOPIC_LEN ];
+    MQTTPublishCallback_t pxCallback;
+    void * pvContext;
+} Subscription_t;
+
+/* Parameters of the run. */
+
+static uint32_t ulImageKB = DEFAULT_IMAGE_KB;
+static uint32_t ulLossPercent = DEFAULT_LOSS_PERCENT;
+static uint32_t ulReorderPercent = DEFAULT_REORDER_PERCENT;
+static uint32_t ulLatencyMs = DEFAULT_LATENCY_MS;
+static uint32_t ulLinkKBps = DEFAULT_LINK_KBPS;
+static BaseType_t xVerbose = pdFALSE;
+static FILE * pxHeapTrace = NULL;
+static BaseType_t xHeapReport = pdFALSE;
+static uint32_t ulHeapEventsDropped = 0;
+static uint32_t ulCloseDelayMs = 0;
+
+/* The image, its signature and the job document that announces it. */
+
+static uint8_t * pucImage;
+static uint32_t ulImageSize;
+static char * pcJobDoc;
+static char cCertPath[ PATH_MAX ];
+static char cWorkDir[] = "/tmp/ota_throughputXXXXXX";
+
+/* The link and the stand-in for the services. All of it is protected by xLinkLock. */
+
+static SemaphoreHandle_t xLinkLock;
+static LinkMsg_t * pxPending;            /* Messages in flight, in order of arrival. */
+static uint64_t ullDownlinkFreeUs;       /* Time at which the link to the device is free to send. */
+static Subscription_t xSubscriptions[ MAX_SUBSCRIPTIONS ];
+static BaseType_t xJobSent = pdFALSE;
+static uint32_t ulRandom = 0x2545F491UL;
+
+/* Results, written by the link task and the OTA complete callback. */
+
+static TaskHandle_t xRunTask;
+static volatile TickType_t xJobDeliveredTick;
+static volatile OTA_JobEvent_t eJobEvent;
+static volatile uint64_t ullLinkCpuNs;   /* CPU time of the link task. */
+static volatile uint32_t ulRequests;     /* Stream requests that reached the service. */
+static volatile uint32_t ulMessages;     /* Stream data messages sent to the device. */
+static volatile uint32_t ulLostMessages; /* Messages lost in either direction. */
+static volatile uint64_t ullMaxHeldNs;   /* Longest time the link task waited in a subscription callback. */
+static volatile BaseType_t xCloseWrapped = pdFALSE;
+
+/* Declare the firmware version structure for all to see. */
+const AppVersion32_t xAppFirmwareVersion =
+{
+    .u.x.ucMajor = APP_VERSION_MAJOR,
+    .u.x.ucMinor = APP_VERSION_MINOR,
+    .u.x.usBuild = APP_VERSION_BUILD,
+};
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( void )
+{
+    ulRandom ^= ulRandom << 13;
+    ulRandom ^= ulRandom >> 17;
+    ulRandom ^= ulRandom << 5;
+
+    return ulRandom;
+}
+
+static uint64_t prvNowUs( void )
+{
+    return ( ( uint64_t ) xTaskGetTickCount() * 1000000ULL ) / ( uint64_t ) configTICK_RATE_HZ;
+}
+
+static uint64_t prvCpuNs( clockid_t xClock )
+{
+    struct timespec xTime;
+
+    ( void ) clock_gettime( xClock, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+
+/* Only log if asked to, the agent logs every block. */
+
+void vLoggingPrintf( const char * pcFormat,
+                     ... )
+{
+    va_list xArgs;
+
+    if( xVerbose == pdTRUE )
+    {
+        va_start( xArgs, pcFormat );
+        ( void ) vfprintf( stderr, pcFormat, xArgs );
+        va_end( xArgs );
+    }
+}
+
+/* Write the allocations from and frees to the FreeRTOS heap recorded since the last call to
+ * the heap trace, which tools/heap_bench replays. The events hold the low 32 bits of each
+ * address, which are unique within the heap. */
+
+static void prvWriteHeapEvents( void )
+{
+    static HeapEvent_t xEvents[ HEAP_EVENTS_PER_READ ];
+    UBaseType_t uxCount, uxEvent;
+    uint32_t ulDropped;
+
+    do
+    {
+        uxCount = uxPortReadHeapEvents( xEvents, HEAP_EVENTS_PER_READ, &ulDropped );
+        ulHeapEventsDropped += ulDropped;
+
+        for( uxEvent = 0; uxEvent < uxCount; uxEvent++ )
+        {
+            if( xEvents[ uxEvent ].ulSize == portHEAP_EVENT_FREE )
+            {
+                fprintf( pxHeapTrace, "f %08x\n", ( unsigned ) xEvents[ uxEvent ].ulAddress );
+            }
+            else
+            {
+                fprintf( pxHeapTrace, "m %08x %u\n", ( unsigned ) xEvents[ uxEvent ].ulAddress, ( unsigned ) xEvents[ uxEvent ].ulSize );
+            }
+        }
+    } while( uxCount == HEAP_EVENTS_PER_READ );
+}
+
+/* Sort the call sites by their peak, the highest first. */
+
+static int prvComparePeak( const void * pvA,
+                           const void * pvB )
+{
+    const HeapCallSiteUsage_t * pxA = pvA;
+    const HeapCallSiteUsage_t * pxB = pvB;
+
+    return ( pxA->xPeakBytes < pxB->xPeakBytes ) - ( pxA->xPeakBytes > pxB->xPeakBytes );
+}
+
+/* Print the heap in use by each task, and by the call sites with the highest peak. A call site
+ * is printed as an offset into the binary, for addr2line. */
+
+static void prvPrintHeapUsage( void )
+{
+    static HeapTaskUsage_t xTasks[ configHEAP_ACCOUNTING_MAX_TASKS ];
+    static HeapCallSiteUsage_t xCallSites[ configHEAP_ACCOUNTING_MAX_CALL_SITES ];
+    char cSite[ 64 ];
+    UBaseType_t uxCount, uxEntry;
+    Dl_info xInfo;
+    const char * pcFile;
+
+    uxCount = uxPortGetHeapTaskUsage( xTasks, configHEAP_ACCOUNTING_MAX_TASKS );
+    printf( "\ntask               live B     peak B\n" );
+
+    for( uxEntry = 0; uxEntry < uxCount; uxEntry++ )
+    {
+        if( ( uxEntry == 0 ) || ( xTasks[ uxEntry ].pcTaskName[ 0 ] != '\0' ) )
+        {
+            printf( "%-15s  %8u  %9u%s\n", ( uxEntry == 0 ) ? "(no task)" : xTasks[ uxEntry ].pcTaskName,
+                    ( unsigned ) xTasks[ uxEntry ].xLiveBytes, ( unsigned ) xTasks[ uxEntry ].xPeakBytes,
+                    ( ( uxEntry != 0 ) && ( xTasks[ uxEntry ].pvTask == NULL ) ) ? "  (deleted)" : "" );
+        }
+    }
+
+    uxCount = uxPortGetHeapCallSiteUsage( xCallSites, configHEAP_ACCOUNTING_MAX_CALL_SITES );
+    qsort( xCallSites, uxCount, sizeof( xCallSites[ 0 ] ), prvComparePeak );
+    printf( "\ncall site                  live B     peak B  allocations\n" );
+
+    for( uxEntry = 0; ( uxEntry < uxCount ) && ( uxEntry < HEAP_REPORT_CALL_SITES ) && ( xCallSites[ uxEntry ].xAllocations > 0U ); uxEntry++ )
+    {
+        if( xCallSites[ uxEntry ].pvCallSite == NULL )
+        {
+            ( void ) snprintf( cSite, sizeof( cSite ), "(other)" );
+        }
+        else if( ( dladdr( xCallSites[ uxEntry ].pvCallSite, &xInfo ) != 0 ) && ( xInfo.dli_fname != NULL ) )
+        {
+            pcFile = strrchr( xInfo.dli_fname, '/' );
+            ( void ) snprintf( cSite, sizeof( cSite ), "%s+0x%lx", ( pcFile != NULL ) ? pcFile + 1 : xInfo.dli_fname,
+                               ( unsigned long ) ( ( const char * ) xCallSites[ uxEntry ].pvCallSite - ( const char * ) xInfo.dli_fbase ) );
+        }
+        else
+        {
+            ( void ) snprintf( cSite, sizeof( cSite ), "%p", xCallSites[ uxEntry ].pvCallSite );
+        }
+
+        printf( "%-24s  %8u  %9u  %11u\n", cSite, ( unsigned ) xCallSites[ uxEntry ].xLiveBytes,
+                ( unsigned ) xCallSites[ uxEntry ].xPeakBytes, ( unsigned ) xCallSites[ uxEntry ].xAllocations );
+    }
+}
+
+/* The agent creates its queue and timers statically, so the idle and timer tasks are static
+ * too. */
+
+void vApplicationGetIdleTaskMemory( StaticTask_t ** ppxIdleTaskTCBBuffer,
+                                    StackType_t ** ppxIdleTaskStackBuffer,
+                                    uint32_t * pulIdleTaskStackSize )
+{
+    static StaticTask_t xIdleTaskTCB;
+    static StackType_t uxIdleTaskStack[ configMINIMAL_STACK_SIZE ];
+
+    *ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = uxIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
+                                     StackType_t ** ppxTimerTaskStackBuffer,
+                                     uint32_t * pulTimerTaskStackSize )
+{
+    static StaticTask_t xTimerTaskTCB;
+    static StackType_t uxTimerTaskStack[ configTIMER_TASK_STACK_DEPTH ];
+
+    *ppxTimerTaskTCBBuffer = &xTimerTaskTCB;
+    *ppxTimerTaskStackBuffer = uxTimerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+
+/* The link task wakes on every tick, so the kernel never expects to be idle long enough to call
+ * the tickless idle sleep of the port. Sleep until the next tick here instead, so the idle task
+ * takes no host CPU time from the tasks that are measured. The port sleeps with the scheduler
+ * suspended, as it does when the kernel calls it. */
+
+void vApplicationIdleHook( void )
+{
+    vTaskSuspendAll();
+    vPortSuppressTicksAndSleep( 1 );
+    ( void ) xTaskResumeAll();
+}
+
+/*-----------------------------------------------------------*/
+
+/* Put a message on the link. Messages to the device take the bandwidth of the link one after the
+ * other before they are delayed by the latency, and reordered messages are delayed by up to a
+ * few more messages. QoS 0 messages are lost after they took their share of the bandwidth. Must
+ * be called with xLinkLock held. */
+
+static void prvLinkSend( BaseType_t xToDevice,
+                         MQTTQoS_t xQoS,
+                         const char * pcTopic,
+                         const void * pvData,
+                         uint32_t ulDataLength )
+{
+    LinkMsg_t * pxMsg, ** ppxPrev;
+    uint16_t usTopicLength = ( uint16_t ) strlen( pcTopic );
+    uint64_t ullNowUs = prvNowUs();
+    uint64_t ullSendUs = 0U;
+
+    if( xToDevice == pdTRUE )
+    {
+        ullSendUs = ( ( uint64_t ) ( ulDataLength + usTopicLength + MQTT_HEADER_SIZE ) * 1000000ULL ) / ( ( uint64_t ) ulLinkKBps * 1024ULL );
+
+        if( ullDownlinkFreeUs < ullNowUs )
+        {
+            ullDownlinkFreeUs = ullNowUs;
+        }
+
+        ullDownlinkFreeUs += ullSendUs;
+        ullNowUs = ullDownlinkFreeUs;
+    }
+
+    if( ( xQoS == eMQTTQoS0 ) && ( ( prvRandom() % 100U ) < ulLossPercent ) )
+    {
+        ulLostMessages++;
+    }
+    else
+    {
+        pxMsg = malloc( sizeof( LinkMsg_t ) + usTopicLength + ulDataLength );
+
+        if( pxMsg != NULL )
+        {
+            pxMsg->xToDevice = xToDevice;
+            pxMsg->ullDeliverUs = ullNowUs + ( ( uint64_t ) ulLatencyMs * 1000ULL );
+
+            if( ( prvRandom() % 100U ) < ulReorderPercent )
+            {
+                pxMsg->ullDeliverUs += ( uint64_t ) prvRandom() % ( ( REORDER_BURST_MSGS * ullSendUs ) + 1000ULL );
+            }
+
+            pxMsg->usTopicLength = usTopicLength;
+            pxMsg->ulDataLength = ulDataLength;
+            pxMsg->pucTopic = ( uint8_t * ) &pxMsg[ 1 ];
+            pxMsg->pucData = &pxMsg->pucTopic[ usTopicLength ];
+            memcpy( pxMsg->pucTopic, pcTopic, usTopicLength );
+            memcpy( pxMsg->pucData, pvData, ulDataLength );
+
+            /* Keep the messages in flight in order of arrival. */
+            for( ppxPrev = &pxPending; ( *ppxPrev != NULL ) && ( ( *ppxPrev )->ullDeliverUs <= pxMsg->ullDeliverUs ); ppxPrev = &( *ppxPrev )->pxNext )
+            {
+            }
+
+            pxMsg->pxNext = *ppxPrev;
+            *ppxPrev = pxMsg;
+        }
+    }
+}
+
+/* Answer a stream request with a data message per block in its bitmap. Must be called with
+ * xLinkLock held. */
+
+static void prvServeStreamRequest( const LinkMsg_t * pxMsg,
+                                   const char * pcDataTopic )
+{
+    CborParser xParser;
+    CborValue xMap, xValue;
+    CborEncoder xEncoder, xMapEncoder;
+    char cToken[ 32 ] = "";
+    uint8_t ucBitmap[ MAX_BITMAP_SIZE ];
+    size_t xTokenSize = sizeof( cToken );
+    size_t xBitmapSize = sizeof( ucBitmap );
+    int lFileId = -1, lBlockSize = 0, lOffset = 0;
+    uint32_t ulBit, ulBlock, ulSize;
+    uint8_t * pucMsg;
+    CborError xResult;
+
+    xResult = cbor_parser_init( pxMsg->pucData, pxMsg->ulDataLength, 0, &xParser, &xMap );
+
+    if( ( xResult == CborNoError ) && ( cbor_value_map_find_value( &xMap, OTA_CBOR_CLIENTTOKEN_KEY, &xValue ) == CborNoError ) && cbor_value_is_text_string( &xValue ) )
+    {
+        xResult = cbor_value_copy_text_string( &xValue, cToken, &xTokenSize, NULL );
+    }
+
+    if( ( xResult == CborNoError ) && ( cbor_value_map_find_value( &xMap, OTA_CBOR_FILEID_KEY, &xValue ) == CborNoError ) )
+    {
+        xResult = cbor_value_get_int( &xValue, &lFileId );
+    }
+
+    if( ( xResult == CborNoError ) && ( cbor_value_map_find_value( &xMap, OTA_CBOR_BLOCKSIZE_KEY, &xValue ) == CborNoError ) )
+    {
+        xResult = cbor_value_get_int( &xValue, &lBlockSize );
+    }
+
+    if( ( xResult == CborNoError ) && ( cbor_value_map_find_value( &xMap, OTA_CBOR_BLOCKOFFSET_KEY, &xValue ) == CborNoError ) )
+    {
+        xResult = cbor_value_get_int( &xValue, &lOffset );
+    }
+
+    if( ( xResult == CborNoError ) && ( cbor_value_map_find_value( &xMap, OTA_CBOR_BLOCKBITMAP_KEY, &xValue ) == CborNoError ) && cbor_value_is_byte_string( &xValue ) )
+    {
+        xResult = cbor_value_copy_byte_string( &xValue, ucBitmap, &xBitmapSize, NULL );
+    }
+    else
+    {
+        xResult = CborErrorIllegalType;
+    }
+
+    if( ( xResult != CborNoError ) || ( lFileId != 0 ) || ( lBlockSize <= 0 ) || ( lOffset < 0 ) )
+    {
+        fprintf( stderr, "Bad stream request.\n" );
+    }
+    else if( ( pucMsg = malloc( ( size_t ) lBlockSize + CBOR_HEADER_SIZE ) ) != NULL )
+    {
+        ulRequests++;
+
+        for( ulBit = 0U; ulBit < ( uint32_t ) ( xBitmapSize * 8U ); ulBit++ )
+        {
+            ulBlock = ( uint32_t ) lOffset + ulBit;
+
+            if( ( ( ucBitmap[ ulBit >> 3 ] & ( 1U << ( ulBit % 8U ) ) ) != 0U ) &&
+                ( ( ulBlock * ( uint32_t ) lBlockSize ) < ulImageSize ) )
+            {
+                ulSize = ulImageSize - ( ulBlock * ( uint32_t ) lBlockSize );
+
+                if( ulSize > ( uint32_t ) lBlockSize )
+                {
+                    ulSize = ( uint32_t ) lBlockSize;
+                }
+
+                cbor_encoder_init( &xEncoder, pucMsg, ( size_t ) lBlockSize + CBOR_HEADER_SIZE, 0 );
+                ( void ) cbor_encoder_create_map( &xEncoder, &xMapEncoder, 5 );
+                ( void ) cbor_encode_text_stringz( &xMapEncoder, OTA_CBOR_FILEID_KEY );
+                ( void ) cbor_encode_int( &xMapEncoder, lFileId );
+                ( void ) cbor_encode_text_stringz( &xMapEncoder, OTA_CBOR_BLOCKID_KEY );
+                ( void ) cbor_encode_int( &xMapEncoder, ( int64_t ) ulBlock );
+                ( void ) cbor_encode_text_stringz( &xMapEncoder, OTA_CBOR_BLOCKSIZE_KEY );
+                ( void ) cbor_encode_int( &xMapEncoder, ( int64_t ) ulSize );
+                ( void ) cbor_encode_text_stringz( &xMapEncoder, OTA_CBOR_BLOCKPAYLOAD_KEY );
+                ( void ) cbor_encode_byte_string( &xMapEncoder, &pucImage[ ulBlock * ( uint32_t ) lBlockSize ], ulSize );
+                ( void ) cbor_encode_text_stringz( &xMapEncoder, OTA_CBOR_CLIENTTOKEN_KEY );
+                ( void ) cbor_encode_text_stringz( &xMapEncoder, cToken );
+
+                if( cbor_encoder_close_container_checked( &xEncoder, &xMapEncoder ) == CborNoError )
+                {
+                    ulMessages++;
+                    prvLinkSend( pdTRUE, eMQTTQoS0, pcDataTopic, pucMsg, ( uint32_t ) cbor_encoder_get_buffer_size( &xEncoder, pucMsg ) );
+                }
+            }
+        }
+
+        free( pucMsg );
+    }
+}
+
+/* The job and stream services: answer a message the device sent. Job status updates are ignored.
+ * Must be called with xLinkLock held. */
+
+static void prvServe( const LinkMsg_t * pxMsg )
+{
+    char cTopic[ MAX_TOPIC_LEN ];
+    char cReply[ MAX_TOPIC_LEN + sizeof( "/accepted" ) ];
+    static const char cNoJob[] = "{\"clientToken\":\"throughput\"}";
+
+    ( void ) snprintf( cTopic, sizeof( cTopic ), "$aws/things/%s/jobs/$next/get", THING_NAME );
+
+    if( ( pxMsg->usTopicLength == strlen( cTopic ) ) && ( memcmp( pxMsg->pucTopic, cTopic, pxMsg->usTopicLength ) == 0 ) )
+    {
+        /* Announce the image once, then there is no job. */
+        ( void ) snprintf( cReply, sizeof( cReply ), "%s/accepted", cTopic );
+
+        if( xJobSent == pdFALSE )
+        {
+            xJobSent = pdTRUE;
+            prvLinkSend( pdTRUE, eMQTTQoS1, cReply, pcJobDoc, ( uint32_t ) strlen( pcJobDoc ) );
+        }
+        else
+        {
+            prvLinkSend( pdTRUE, eMQTTQoS1, cReply, cNoJob, ( uint32_t ) strlen( cNoJob ) );
+        }
+    }
+    else
+    {
+        ( void ) snprintf( cTopic, sizeof( cTopic ), "$aws/things/%s/streams/%s/get/cbor", THING_NAME, STREAM_NAME );
+
+        if( ( pxMsg->usTopicLength == strlen( cTopic ) ) && ( memcmp( pxMsg->pucTopic, cTopic, pxMsg->usTopicLength ) == 0 ) )
+        {
+            ( void ) snprintf( cReply, sizeof( cReply ), "$aws/things/%s/streams/%s/data/cbor", THING_NAME, STREAM_NAME );
+            prvServeStreamRequest( pxMsg, cReply );
+        }
+    }
+}
+
+/* Deliver a message to the subscription of its topic, in place like the MQTT agent with zero
+ * copy publishes. */
+
+static void prvDeliver( const LinkMsg_t * pxMsg )
+{
+    MQTTPublishData_t xPublishData;
+    MQTTPublishCallback_t pxCallback = NULL;
+    void * pvContext = NULL;
+    char cJobTopic[ MAX_TOPIC_LEN ];
+    uint32_t ulIndex;
+    uint64_t ullStartNs, ullHeldNs;
+
+    ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+
+    for( ulIndex = 0U; ulIndex < MAX_SUBSCRIPTIONS; ulIndex++ )
+    {
+        if( ( xSubscriptions[ ulIndex ].pxCallback != NULL ) &&
+            ( pxMsg->usTopicLength == strlen( xSubscriptions[ ulIndex ].cTopic ) ) &&
+            ( memcmp( pxMsg->pucTopic, xSubscriptions[ ulIndex ].cTopic, pxMsg->usTopicLength ) == 0 ) )
+        {
+            pxCallback = xSubscriptions[ ulIndex ].pxCallback;
+            pvContext = xSubscriptions[ ulIndex ].pvContext;
+        }
+    }
+
+    ( void ) xSemaphoreGive( xLinkLock );
+
+    if( pxCallback != NULL )
+    {
+        ( void ) snprintf( cJobTopic, sizeof( cJobTopic ), "$aws/things/%s/jobs/$next/get/accepted", THING_NAME );
+
+        if( ( xJobDeliveredTick == 0U ) && ( pxMsg->ulDataLength == strlen( pcJobDoc ) ) &&
+            ( pxMsg->usTopicLength == strlen( cJobTopic ) ) && ( memcmp( pxMsg->pucTopic, cJobTopic, pxMsg->usTopicLength ) == 0 ) )
+        {
+            xJobDeliveredTick = xTaskGetTickCount();
+        }
+
+        xPublishData.xQos = eMQTTQoS0;
+        xPublishData.pucTopic = pxMsg->pucTopic;
+        xPublishData.usTopicLength = pxMsg->usTopicLength;
+        xPublishData.pvData = pxMsg->pucData;
+        xPublishData.ulDataLength = pxMsg->ulDataLength;
+        xPublishData.xBuffer = NULL;
+
+        ullStartNs = prvCpuNs( CLOCK_MONOTONIC );
+        ( void ) pxCallback( pvContext, &xPublishData );
+        ullHeldNs = prvCpuNs( CLOCK_MONOTONIC ) - ullStartNs;
+
+        if( ullHeldNs > ullMaxHeldNs )
+        {
+            ullMaxHeldNs = ullHeldNs;
+        }
+    }
+}
+
+/* The PAL closes the file, which also checks its signature, through this wrapper when the tool is
+ * linked with --wrap=prvPAL_CloseFile. With -c it takes the given time longer, as closing and
+ * checking a large image in flash can, to show the link task doesn't wait for it. */
+
+OTA_Err_t __real_prvPAL_CloseFile( OTA_FileContext_t * const C );
+
+OTA_Err_t __wrap_prvPAL_CloseFile( OTA_FileContext_t * const C )
+{
+    xCloseWrapped = pdTRUE;
+    vTaskDelay( pdMS_TO_TICKS( ulCloseDelayMs ) );
+
+    return __real_prvPAL_CloseFile( C );
+}
+
+/* The link task delivers the messages that arrived by the current tick, to the services or to
+ * the device. */
+
+static void prvLinkTask( void * pvParameters )
+{
+    LinkMsg_t * pxMsg;
+    uint64_t ullNowUs;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        ullNowUs = prvNowUs();
+
+        for( ; ; )
+        {
+            ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+            pxMsg = pxPending;
+
+            if( ( pxMsg != NULL ) && ( pxMsg->ullDeliverUs <= ullNowUs ) )
+            {
+                pxPending = pxMsg->pxNext;
+
+                if( pxMsg->xToDevice == pdFALSE )
+                {
+                    prvServe( pxMsg );
+                }
+            }
+            else
+            {
+                pxMsg = NULL;
+            }
+
+            ( void ) xSemaphoreGive( xLinkLock );
+
+            if( pxMsg == NULL )
+            {
+                break;
+            }
+
+            if( pxMsg->xToDevice == pdTRUE )
+            {
+                prvDeliver( pxMsg );
+            }
+
+            free( pxMsg );
+        }
+
+        if( pxHeapTrace != NULL )
+        {
+            prvWriteHeapEvents();
+        }
+
+        ullLinkCpuNs = prvCpuNs( CLOCK_THREAD_CPUTIME_ID );
+        vTaskDelay( 1 );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* The MQTT agent stand-in. The OTA agent only uses these calls of the MQTT agent. */
+
+MQTTAgentReturnCode_t MQTT_AGENT_Subscribe( MQTTAgentHandle_t xMQTTHandle,
+                                            const MQTTAgentSubscribeParams_t * const pxSubscribeParams,
+                                            TickType_t xTimeoutTicks )
+{
+    MQTTAgentReturnCode_t xReturn = eMQTTAgentFailure;
+    uint32_t ulIndex;
+
+    ( void ) xMQTTHandle;
+    ( void ) xTimeoutTicks;
+
+    ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+
+    for( ulIndex = 0U; ( ulIndex < MAX_SUBSCRIPTIONS ) && ( xReturn != eMQTTAgentSuccess ); ulIndex++ )
+    {
+        if( ( xSubscriptions[ ulIndex ].pxCallback == NULL ) && ( pxSubscribeParams->usTopicLength < MAX_TOPIC_LEN ) )
+        {
+            memcpy( xSubscriptions[ ulIndex ].cTopic, pxSubscribeParams->pucTopic, pxSubscribeParams->usTopicLength );
+            xSubscriptions[ ulIndex ].cTopic[ pxSubscribeParams->usTopicLength ] = '\0';
+            xSubscriptions[ ulIndex ].pxCallback = pxSubscribeParams->pxPublishCallback;
+            xSubscriptions[ ulIndex ].pvContext = pxSubscribeParams->pvPublishCallbackContext;
+            xReturn = eMQTTAgentSuccess;
+        }
+    }
+
+    ( void ) xSemaphoreGive( xLinkLock );
+
+    return xReturn;
+}
+
+MQTTAgentReturnCode_t MQTT_AGENT_Unsubscribe( MQTTAgentHandle_t xMQTTHandle,
+                                              const MQTTAgentUnsubscribeParams_t * const pxUnsubscribeParams,
+                                              TickType_t xTimeoutTicks )
+{
+    uint32_t ulIndex;
+
+    ( void ) xMQTTHandle;
+    ( void ) xTimeoutTicks;
+
+    ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+
+    for( ulIndex = 0U; ulIndex < MAX_SUBSCRIPTIONS; ulIndex++ )
+    {
+        if( ( pxUnsubscribeParams->usTopicLength == strlen( xSubscriptions[ ulIndex ].cTopic ) ) &&
+            ( memcmp( pxUnsubscribeParams->pucTopic, xSubscriptions[ ulIndex ].cTopic, pxUnsubscribeParams->usTopicLength ) == 0 ) )
+        {
+            xSubscriptions[ ulIndex ].pxCallback = NULL;
+            xSubscriptions[ ulIndex ].cTopic[ 0 ] = '\0';
+        }
+    }
+
+    ( void ) xSemaphoreGive( xLinkLock );
+
+    return eMQTTAgentSuccess;
+}
+
+MQTTAgentReturnCode_t MQTT_AGENT_Publish( MQTTAgentHandle_t xMQTTHandle,
+                                          const MQTTAgentPublishParams_t * const pxPublishParams,
+                                          TickType_t xTimeoutTicks )
+{
+    char cTopic[ MAX_TOPIC_LEN ];
+    uint16_t usLength = pxPublishParams->usTopicLength;
+
+    ( void ) xMQTTHandle;
+    ( void ) xTimeoutTicks;
+
+    if( usLength >= MAX_TOPIC_LEN )
+    {
+        usLength = MAX_TOPIC_LEN - 1U;
+    }
+
+    memcpy( cTopic, pxPublishParams->pucTopic, usLength );
+    cTopic[ usLength ] = '\0';
+
+    ( void ) xSemaphoreTake( xLinkLock, portMAX_DELAY );
+    prvLinkSend( pdFALSE, pxPublishParams->xQoS, cTopic, pxPublishParams->pvData, pxPublishParams->ulDataLength );
+    ( void ) xSemaphoreGive( xLinkLock );
+
+    return eMQTTAgentSuccess;
+}
+
+MQTTAgentReturnCode_t MQTT_AGENT_ClonePublishData( MQTTAgentHandle_t xMQTTHandle,
+                                                   const MQTTPublishData_t * const pxPublishData,
+                                                   MQTTPublishData_t * const pxClonedPublishData )
+{
+    MQTTAgentReturnCode_t xReturn = eMQTTAgentFailure;
+    uint8_t * pucBuffer = malloc( ( size_t ) pxPublishData->usTopicLength + pxPublishData->ulDataLength );
+
+    ( void ) xMQTTHandle;
+
+    if( pucBuffer != NULL )
+    {
+        memcpy( pucBuffer, pxPublishData->pucTopic, pxPublishData->usTopicLength );
+        memcpy( &pucBuffer[ pxPublishData->usTopicLength ], pxPublishData->pvData, pxPublishData->ulDataLength );
+        *pxClonedPublishData = *pxPublishData;
+        pxClonedPublishData->pucTopic = pucBuffer;
+        pxClonedPublishData->pvData = &pucBuffer[ pxPublishData->usTopicLength ];
+        pxClonedPublishData->xBuffer = ( MQTTBufferHandle_t ) pucBuffer;
+        xReturn = eMQTTAgentSuccess;
+    }
+
+    return xReturn;
+}
+
+MQTTAgentReturnCode_t MQTT_AGENT_ReturnBuffer( MQTTAgentHandle_t xMQTTHandle,
+                                               MQTTBufferHandle_t xBufferHandle )
+{
+    ( void ) xMQTTHandle;
+    free( xBufferHandle );
+
+    return eMQTTAgentSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Random bytes for the signature, which doesn't have to be secure here. */
+
+static int prvSignRandom( void * pvContext,
+                          unsigned char * pucOutput,
+                          size_t xLength )
+{
+    ( void ) pvContext;
+
+    while( xLength > 0U )
+    {
+        xLength--;
+        pucOutput[ xLength ] = ( unsigned char ) prvRandom();
+    }
+
+    return 0;
+}
+
+/* Read a whole file with a terminating zero, as mbedtls parses PEM. */
+
+static uint8_t * prvReadFile( const char * pcPath,
+                              size_t * pxSize )
+{
+    FILE * pxFile = fopen( pcPath, "rb" );
+    uint8_t * pucData = NULL;
+    long lSize = -1L;
+
+    if( pxFile != NULL )
+    {
+        if( fseek( pxFile, 0, SEEK_END ) == 0 )
+        {
+            lSize = ftell( pxFile );
+        }
+
+        if( ( lSize >= 0L ) && ( fseek( pxFile, 0, SEEK_SET ) == 0 ) && ( ( pucData = malloc( ( size_t ) lSize + 1U ) ) != NULL ) )
+        {
+            if( fread( pucData, 1, ( size_t ) lSize, pxFile ) == ( size_t ) lSize )
+            {
+                pucData[ lSize ] = 0U;
+                *pxSize = ( size_t ) lSize + 1U;
+            }
+            else
+            {
+                free( pucData );
+                pucData = NULL;
+            }
+        }
+
+        ( void ) fclose( pxFile );
+    }
+
+    return pucData;
+}
+
+/* Make the image and the job document that announces it, with the image's ECDSA signature
+ * made with the key of the test signer certificate. */
+
+static BaseType_t prvMakeImage( const char * pcKeyPath )
+{
+    mbedtls_pk_context xKey;
+    uint8_t ucHash[ 32 ];
+    uint8_t ucSignature[ MBEDTLS_ECDSA_MAX_LEN ];
+    char cSignature[ ( ( MBEDTLS_ECDSA_MAX_LEN + 2U ) / 3U ) * 4U + 1U ];
+    size_t xSignatureLength = 0U, xBase64Length = 0U;
+    size_t xJobDocSize, xKeySize = 0U;
+    uint8_t * pucKey = prvReadFile( pcKeyPath, &xKeySize );
+    uint32_t ulIndex;
+    BaseType_t xReturn = pdFAIL;
+
+    ulImageSize = ulImageKB * 1024U;
+    pucImage = malloc( ulImageSize );
+
+    if( ( pucImage != NULL ) && ( pucKey != NULL ) )
+    {
+        for( ulIndex = 0U; ulIndex < ulImageSize; ulIndex++ )
+        {
+            pucImage[ ulIndex ] = ( uint8_t ) prvRandom();
+        }
+
+        ( void ) mbedtls_sha256_ret( pucImage, ulImageSize, ucHash, 0 );
+        mbedtls_pk_init( &xKey );
+
+        if( ( mbedtls_pk_parse_key( &xKey, pucKey, xKeySize, NULL, 0 ) == 0 ) &&
+            ( mbedtls_pk_sign( &xKey, MBEDTLS_MD_SHA256, ucHash, sizeof( ucHash ), ucSignature, &xSignatureLength, prvSignRandom, NULL ) == 0 ) &&
+            ( mbedtls_base64_encode( ( unsigned char * ) cSignature, sizeof( cSignature ), &xBase64Length, ucSignature, xSignatureLength ) == 0 ) )
+        {
+            xJobDocSize = 512U + strlen( cCertPath ) + xBase64Length;
+            pcJobDoc = malloc( xJobDocSize );
+
+            if( pcJobDoc != NULL )
+            {
+                ( void ) snprintf( pcJobDoc, xJobDocSize,
+                                   "{\"clientToken\":\"throughput\",\"execution\":{\"jobId\":\"" JOB_ID "\",\"status\":\"QUEUED\","
+                                   "\"jobDocument\":{\"afr_ota\":{\"streamname\":\"" STREAM_NAME "\",\"files\":[{\"filepath\":\"" FILE_PATH "\","
+                                   "\"filesize\":%u,\"fileid\":0,\"certfile\":\"%s\",\"sig-sha256-ecdsa\":\"%s\"}]}}}}",
+                                   ( unsigned ) ulImageSize, cCertPath, cSignature );
+                xReturn = pdPASS;
+            }
+        }
+
+        mbedtls_pk_free( &xKey );
+    }
+
+    free( pucKey );
+
+    return xReturn;
+}
+
+/* Compare the received file to the image. */
+
+static BaseType_t prvCheckFile( void )
+{
+    FILE * pxFile = fopen( FILE_PATH, "rb" );
+    uint8_t * pucFile = malloc( ulImageSize + 1U );
+    BaseType_t xReturn = pdFAIL;
+
+    if( ( pxFile != NULL ) && ( pucFile != NULL ) &&
+        ( fread( pucFile, 1, ulImageSize + 1U, pxFile ) == ulImageSize ) &&
+        ( memcmp( pucFile, pucImage, ulImageSize ) == 0 ) )
+    {
+        xReturn = pdPASS;
+    }
+
+    if( pxFile != NULL )
+    {
+        ( void ) fclose( pxFile );
+    }
+
+    free( pucFile );
+
+    return xReturn;
+}
+
+/* The OTA complete callback. The image is not activated, only the time is taken. */
+
+static void prvOTACompleteCallback( OTA_JobEvent_t eEvent )
+{
+    if( eEvent == eOTA_JobEvent_StartTest )
+    {
+        ( void ) OTA_SetImageState( eOTA_ImageState_Accepted );
+    }
+    else
+    {
+        eJobEvent = eEvent;
+        ( void ) xTaskNotifyGive( xRunTask );
+    }
+}
+
+/* Run the download and report the results. */
+
+static void prvRunTask( void * pvParameters )
+{
+    TickType_t xEndTick, xTimeoutTicks;
+    size_t xFreeHeap;
+    uint64_t ullCpuNs, ullLinkNs;
+    uint32_t ulBlocks, ulMs;
+    BaseType_t xReceived, xPassed = pdFALSE;
+
+    ( void ) pvParameters;
+
+    CRYPTO_ConfigureHeap();
+    xTimeoutTicks = pdMS_TO_TICKS( MIN_TIMEOUT_MS + ( 20UL * ( ulImageKB * 1000UL ) / ulLinkKBps ) );
+
+    xFreeHeap = xPortGetFreeHeapSize();
+    ullCpuNs = prvCpuNs( CLOCK_PROCESS_CPUTIME_ID );
+    ullLinkNs = ullLinkCpuNs;
+
+    if( OTA_AgentInit( ( void * ) &xLinkLock, ( const uint8_t * ) THING_NAME, prvOTACompleteCallback, AGENT_READY_TICKS ) != eOTA_AgentState_Ready )
+    {
+        fprintf( stderr, "The OTA agent failed to start.\n" );
+        xReceived = pdFALSE;
+    }
+    else
+    {
+        xReceived = ( ulTaskNotifyTake( pdTRUE, xTimeoutTicks ) != 0U ) ? pdTRUE : pdFALSE;
+    }
+
+    xEndTick = xTaskGetTickCount();
+    ullCpuNs = prvCpuNs( CLOCK_PROCESS_CPUTIME_ID ) - ullCpuNs - ( ullLinkCpuNs - ullLinkNs );
+
+    if( xReceived == pdFALSE )
+    {
+        fprintf( stderr, "The download didn't complete.\n" );
+    }
+    else if( eJobEvent != eOTA_JobEvent_Activate )
+    {
+        fprintf( stderr, "The download failed.\n" );
+    }
+    else if( prvCheckFile() != pdPASS )
+    {
+        fprintf( stderr, "The received file doesn't match the image.\n" );
+    }
+    else if( ( ulCloseDelayMs > 0U ) && ( xCloseWrapped == pdFALSE ) )
+    {
+        fprintf( stderr, "-c needs the tool to be linked with -Wl,--wrap=prvPAL_CloseFile.\n" );
+    }
+    else if( ( ulCloseDelayMs > 0U ) && ( ullMaxHeldNs >= ( ulCloseDelayMs * 1000000ULL ) ) )
+    {
+        fprintf( stderr, "The link task waited %.1f ms for the agent, which took %u ms to close the file.\n",
+                 ullMaxHeldNs / 1000000.0, ( unsigned ) ulCloseDelayMs );
+    }
+    else
+    {
+        xPassed = pdTRUE;
+        ulBlocks = ( ulImageSize + FILE_BLOCK_SIZE - 1U ) / FILE_BLOCK_SIZE;
+        ulMs = ( uint32_t ) ( ( ( uint64_t ) ( xEndTick - xJobDeliveredTick ) * 1000ULL ) / configTICK_RATE_HZ );
+        printf( "image KB  loss %%  reorder %%  latency ms  link KB/s   seconds    KB/s  CPU us/block  peak heap  requests  messages  lost  held ms\n" );
+        printf( "%8u  %6u  %9u  %10u  %9u  %8.2f  %6.1f  %12.1f  %9u  %8u  %8u  %4u  %7.2f\n",
+                ( unsigned ) ulImageKB, ( unsigned ) ulLossPercent, ( unsigned ) ulReorderPercent, ( unsigned ) ulLatencyMs,
+                ( unsigned ) ulLinkKBps, ulMs / 1000.0, ( ulImageKB * 1000.0 ) / ( ( ulMs > 0U ) ? ulMs : 1U ),
+                ( ullCpuNs / 1000.0 ) / ulBlocks, ( unsigned ) ( xFreeHeap - xPortGetMinimumEverFreeHeapSize() ),
+                ( unsigned ) ulRequests, ( unsigned ) ulMessages, ( unsigned ) ulLostMessages, ullMaxHeldNs / 1000000.0 );
+
+        if( xHeapReport == pdTRUE )
+        {
+            prvPrintHeapUsage();
+        }
+    }
+
+    ( void ) OTA_AgentShutdown( AGENT_SHUTDOWN_TICKS );
+
+    if( pxHeapTrace != NULL )
+    {
+        prvWriteHeapEvents();
+        ( void ) fclose( pxHeapTrace );
+
+        if( ulHeapEventsDropped != 0U )
+        {
+            fprintf( stderr, "%u heap events were dropped, the heap trace is incomplete.\n", ( unsigned ) ulHeapEventsDropped );
+            xPassed = pdFALSE;
+        }
+    }
+
+    ( void ) unlink( FILE_PATH );
+    ( void ) unlink( FILE_PATH ".resume" );
+    ( void ) unlink( "PlatformImageState.txt" );
+    ( void ) chdir( "/" );
+    ( void ) rmdir( cWorkDir );
+
+    exit( ( xPassed == pdTRUE ) ? EXIT_SUCCESS : EXIT_FAILURE );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t * pulArgs[] = { &ulImageKB, &ulLossPercent, &ulReorderPercent, &ulLatencyMs, &ulLinkKBps };
+    char cKeyPath[ PATH_MAX ];
+    int lArg;
+
+    for( lArg = 1; lArg < argc; lArg++ )
+    {
+        if( strcmp( argv[ lArg ], "-v" ) == 0 )
+        {
+            xVerbose = pdTRUE;
+        }
+        else if( strcmp( argv[ lArg ], "-a" ) == 0 )
+        {
+            xHeapReport = pdTRUE;
+        }
+        else if( ( strcmp( argv[ lArg ], "-c" ) == 0 ) && ( lArg + 1 < argc ) )
+        {
+            ulCloseDelayMs = ( uint32_t ) strtoul( argv[ ++lArg ], NULL, 10 );
+        }
+        else if( ( strcmp( argv[ lArg ], "-m" ) == 0 ) && ( lArg + 1 < argc ) )
+        {
+            /* Opened before the tool moves to its working directory. */
+            pxHeapTrace = fopen( argv[ ++lArg ], "w" );
+
+            if( pxHeapTrace == NULL )
+            {
+                fprintf( stderr, "Failed to open the heap trace %s.\n", argv[ lArg ] );
+                return EXIT_FAILURE;
+            }
+        }
+        else if( lArg <= ( int ) ( sizeof( pulArgs ) / sizeof( pulArgs[ 0 ] ) ) )
+        {
+            *pulArgs[ lArg - 1 ] = ( uint32_t ) strtoul( argv[ lArg ], NULL, 10 );
+        }
+    }
+
+    if( ( ulImageKB == 0U ) || ( ulLinkKBps == 0U ) || ( ulLossPercent >= 100U ) || ( ulReorderPercent > 100U ) )
+    {
+        fprintf( stderr, "usage: %s [image size in KB] [loss in percent] [reorder in percent] [latency in ms] [link KB/s] [-v] [-c close ms] [-m heap trace] [-a]\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    /* The certificate is read by the PAL, the key only to sign the image. Both are found before
+     * the tool moves to a directory of its own for the files the PAL writes. */
+    if( ( realpath( TEST_FILES_DIR CERT_FILE, cCertPath ) == NULL ) || ( realpath( TEST_FILES_DIR KEY_FILE, cKeyPath ) == NULL ) )
+    {
+        fprintf( stderr, "Run from the directory of the tool, %s not found.\n", TEST_FILES_DIR );
+        return EXIT_FAILURE;
+    }
+
+    if( prvMakeImage( cKeyPath ) != pdPASS )
+    {
+        fprintf( stderr, "Failed to sign the image.\n" );
+        return EXIT_FAILURE;
+    }
+
+    if( ( mkdtemp( cWorkDir ) == NULL ) || ( chdir( cWorkDir ) != 0 ) )
+    {
+        fprintf( stderr, "Failed to make a working directory.\n" );
+        return EXIT_FAILURE;
+    }
+
+    xLinkLock = xSemaphoreCreateMutex();
+
+    if( ( xLinkLock == NULL ) ||
+        ( xTaskCreate( prvLinkTask, "Link", LINK_TASK_STACK_SIZE, NULL, LINK_TASK_PRIORITY, NULL ) != pdPASS ) ||
+        ( xTaskCreate( prvRunTask, "Run", RUN_TASK_STACK_SIZE, NULL, RUN_TASK_PRIORITY, &xRunTask ) != pdPASS ) )
+    {
+        fprintf( stderr, "Failed to create the tasks.\n" );
+        return EXIT_FAILURE;
+    }
+
+    vTaskStartScheduler();
+
+    return EXIT_FAILURE;
+}
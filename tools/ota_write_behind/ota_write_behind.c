@@ -0,0 +1,369 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2017 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_write_behind.c
+ * @brief Host benchmark of the OTA agent's write-behind buffer on a simulated flash PAL.
+ *
+ * Usage:
+ *   ota_write_behind [image size in KB] [loss in percent] [ms per block]
+ *
+ * An image is received in OTA file blocks over a simulated link and written through a
+ * simulated flash PAL, once with a prvPAL_WriteBlock() call per block and once through the
+ * write-behind buffer with several page buffer counts. The flash is programmed in sectors, so
+ * a write that doesn't cover a whole sector is a read-modify-write of the sector. The flash
+ * runs at the same time as the link and the agent, as the write-behind task would on the
+ * device, and the time is simulated, so the results don't depend on the host.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aws_ota_write_behind.h"
+
+#define FILE_BLOCK_SIZE          1024U /* OTA file block size, 2^otaconfigLOG2_FILE_BLOCK_SIZE. */
+#define BLOCKS_PER_RANGE         8U    /* otaconfigBLOCKS_PER_RANGE. */
+#define OUTSTANDING_RANGES       4U    /* otaconfigMAX_OUTSTANDING_RANGES. */
+#define SECTOR_SIZE              4096U /* Erase and program unit of the simulated flash. */
+#define SECTOR_ERASE_US          45000U
+#define SECTOR_PROGRAM_US        11200U /* 16 pages of 256 bytes at 0.7 ms each. */
+#define SECTOR_READ_US           700U
+#define DEFAULT_IMAGE_KB         512U
+#define DEFAULT_LOSS_PERCENT     2U
+#define DEFAULT_BLOCK_MS         20U   /* Time between blocks on the link, about 50 KB/s. */
+
+/* The simulated flash PAL and the clocks of the agent task and the write-behind task. */
+
+typedef struct
+{
+    uint8_t * pucFlash;            /* Contents of the flash. */
+    uint64_t ullAgentUs;           /* Time at which the agent is done with its current work. */
+    uint64_t ullFlashUs;           /* Time at which the flash is done with all submitted pages. */
+    uint64_t ullCostUs;            /* Flash time of the current prvPAL_WriteBlock() calls. */
+    uint32_t ulErases;             /* Sector erases. */
+    uint32_t ulReadModifyWrites;   /* Sector erases of sectors that were partly written. */
+    uint32_t ulCalls;              /* prvPAL_WriteBlock() calls. */
+    OTA_WriteBehindPage_t * pxQueue[ OTA_WRITE_BEHIND_MAX_PAGES ];
+    uint64_t ullDoneUs[ OTA_WRITE_BEHIND_MAX_PAGES ];
+    uint32_t ulHead;
+    uint32_t ulCount;
+} Sim_t;
+
+static uint32_t ulRandom = 0x2545F491UL;
+static uint32_t ulBlockUs = DEFAULT_BLOCK_MS * 1000U;
+
+static uint32_t prvRandom( void )
+{
+    ulRandom ^= ulRandom << 13;
+    ulRandom ^= ulRandom >> 17;
+    ulRandom ^= ulRandom << 5;
+
+    return ulRandom;
+}
+
+/* The simulated prvPAL_WriteBlock(). Each sector written is erased and programmed as a whole, so
+ * the rest of a sector that is only partly written is read first and programmed again. */
+
+static int32_t prvFlashWrite( void * pvContext,
+                              uint32_t ulOffset,
+                              const uint8_t * pucData,
+                              uint32_t ulSize )
+{
+    Sim_t * pxSim = pvContext;
+    uint32_t ulSector;
+
+    memcpy( &pxSim->pucFlash[ ulOffset ], pucData, ulSize );
+    pxSim->ulCalls++;
+
+    for( ulSector = ulOffset / SECTOR_SIZE; ulSector <= ( ( ulOffset + ulSize - 1U ) / SECTOR_SIZE ); ulSector++ )
+    {
+        if( ( ulOffset > ( ulSector * SECTOR_SIZE ) ) || ( ( ulOffset + ulSize ) < ( ( ulSector + 1U ) * SECTOR_SIZE ) ) )
+        {
+            pxSim->ullCostUs += SECTOR_READ_US;
+            pxSim->ulReadModifyWrites++;
+        }
+
+        pxSim->ullCostUs += SECTOR_ERASE_US + SECTOR_PROGRAM_US;
+        pxSim->ulErases++;
+    }
+
+    return ( int32_t ) ulSize;
+}
+
+/* The write-behind task: pages are programmed in order, each starting once the flash is done with
+ * the previous one and the agent has submitted it. */
+
+static void prvSubmit( void * pvContext,
+                       OTA_WriteBehindPage_t * pxPage )
+{
+    Sim_t * pxSim = pvContext;
+    uint32_t ulSlot = ( pxSim->ulHead + pxSim->ulCount ) % OTA_WRITE_BEHIND_MAX_PAGES;
+
+    pxSim->ullCostUs = 0U;
+    ( void ) OTA_WriteBehind_Program( pxPage, prvFlashWrite, pxSim );
+
+    if( pxSim->ullFlashUs < pxSim->ullAgentUs )
+    {
+        pxSim->ullFlashUs = pxSim->ullAgentUs;
+    }
+
+    pxSim->ullFlashUs += pxSim->ullCostUs;
+    pxSim->pxQueue[ ulSlot ] = pxPage;
+    pxSim->ullDoneUs[ ulSlot ] = pxSim->ullFlashUs;
+    pxSim->ulCount++;
+}
+
+static OTA_WriteBehindPage_t * prvWait( void * pvContext )
+{
+    Sim_t * pxSim = pvContext;
+    OTA_WriteBehindPage_t * pxPage = pxSim->pxQueue[ pxSim->ulHead ];
+
+    if( pxSim->ullAgentUs < pxSim->ullDoneUs[ pxSim->ulHead ] )
+    {
+        pxSim->ullAgentUs = pxSim->ullDoneUs[ pxSim->ulHead ];
+    }
+
+    pxSim->ulHead = ( pxSim->ulHead + 1U ) % OTA_WRITE_BEHIND_MAX_PAGES;
+    pxSim->ulCount--;
+
+    return pxPage;
+}
+
+/* Build the order in which the blocks arrive. Blocks are requested a window of ranges at a time,
+ * and a lost block is received again once the ranges after it were sent. */
+
+static uint32_t * prvArrivalOrder( uint32_t ulNumBlocks,
+                                   uint32_t ulLossPercent )
+{
+    uint32_t * pulOrder = malloc( ulNumBlocks * 2U * sizeof( uint32_t ) );
+    uint32_t * pulLost = malloc( ulNumBlocks * sizeof( uint32_t ) );
+    uint32_t ulIn = 0U, ulOut = 0U, ulLost = 0U, ulNext = 0U, ulSent = 0U;
+
+    if( ( pulOrder == NULL ) || ( pulLost == NULL ) )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( 1 );
+    }
+
+    while( ( ulNext < ulNumBlocks ) || ( ulIn < ulLost ) )
+    {
+        uint32_t ulBlock;
+
+        if( ( ulIn < ulLost ) && ( ( ulNext >= ulNumBlocks ) || ( ( ulSent % ( BLOCKS_PER_RANGE * OUTSTANDING_RANGES ) ) == 0U ) ) )
+        {
+            ulBlock = pulLost[ ulIn++ ]; /* Requested again after a window of blocks. */
+        }
+        else
+        {
+            ulBlock = ulNext++;
+        }
+
+        ulSent++;
+
+        if( ( prvRandom() % 100U ) < ulLossPercent )
+        {
+            pulLost[ ulLost++ ] = ulBlock;
+        }
+        else
+        {
+            pulOrder[ ulOut++ ] = ulBlock;
+        }
+
+        if( ulLost == ulNumBlocks )
+        {
+            ulLost = ulIn; /* Can't happen with a loss below 100%, but don't overrun. */
+        }
+    }
+
+    free( pulLost );
+
+    return pulOrder;
+}
+
+/* Receive the image and report the time it takes. With ulPages 0 each block is written with
+ * prvPAL_WriteBlock() by the agent itself. */
+
+static int prvRun( const uint8_t * pucImage,
+                   uint32_t ulImageSize,
+                   const uint32_t * pulOrder,
+                   uint32_t ulPages,
+                   uint32_t ulPageSize )
+{
+    static uint8_t ucPages[ OTA_WRITE_BEHIND_MAX_PAGES * 4U * SECTOR_SIZE ];
+    OTA_WriteBehind_t xWriteBehind;
+    Sim_t xSim;
+    uint32_t ulNumBlocks = ( ulImageSize + FILE_BLOCK_SIZE - 1U ) / FILE_BLOCK_SIZE;
+    uint32_t ulIndex, ulBlock, ulSize;
+    int32_t lResult = 0;
+
+    memset( &xSim, 0, sizeof( xSim ) );
+    xSim.pucFlash = calloc( 1U, ulImageSize );
+
+    if( xSim.pucFlash == NULL )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( 1 );
+    }
+
+    if( ulPages > 0U )
+    {
+        OTA_WriteBehind_Init( &xWriteBehind, ucPages, ulPageSize, ulPages, ulImageSize, prvSubmit, prvWait, &xSim );
+    }
+
+    for( ulIndex = 0U; ( ulIndex < ulNumBlocks ) && ( lResult >= 0 ); ulIndex++ )
+    {
+        ulBlock = pulOrder[ ulIndex ];
+        ulSize = ( ( ulBlock + 1U ) * FILE_BLOCK_SIZE <= ulImageSize ) ? FILE_BLOCK_SIZE : ( ulImageSize - ( ulBlock * FILE_BLOCK_SIZE ) );
+
+        /* The agent takes the next block once it has arrived and the previous one is written. */
+        if( xSim.ullAgentUs < ( ( uint64_t ) ( ulIndex + 1U ) * ulBlockUs ) )
+        {
+            xSim.ullAgentUs = ( uint64_t ) ( ulIndex + 1U ) * ulBlockUs;
+        }
+
+        if( ulPages > 0U )
+        {
+            lResult = OTA_WriteBehind_Write( &xWriteBehind, ulBlock * FILE_BLOCK_SIZE, &pucImage[ ulBlock * FILE_BLOCK_SIZE ], ulSize );
+        }
+        else
+        {
+            xSim.ullCostUs = 0U;
+            lResult = prvFlashWrite( &xSim, ulBlock * FILE_BLOCK_SIZE, &pucImage[ ulBlock * FILE_BLOCK_SIZE ], ulSize );
+            xSim.ullAgentUs += xSim.ullCostUs;
+        }
+    }
+
+    if( ( ulPages > 0U ) && ( lResult >= 0 ) )
+    {
+        lResult = OTA_WriteBehind_Flush( &xWriteBehind );
+    }
+
+    if( ( lResult < 0 ) || ( memcmp( xSim.pucFlash, pucImage, ulImageSize ) != 0 ) )
+    {
+        printf( "%u pages of %u bytes: the flash doesn't match the image!\n", ulPages, ulPageSize );
+        lResult = -1;
+    }
+    else if( ulPages == 0U )
+    {
+        printf( "  none        %7.2f  %6.1f  %6u  %6u  %6u        -        -       -\n",
+                xSim.ullAgentUs / 1e6, ( ulImageSize / 1024.0 ) / ( xSim.ullAgentUs / 1e6 ),
+                xSim.ulCalls, xSim.ulErases, xSim.ulReadModifyWrites );
+    }
+    else
+    {
+        printf( "%2u x %5u   %7.2f  %6.1f  %6u  %6u  %6u   %6u   %6u  %6u\n",
+                ulPages, ulPageSize,
+                xSim.ullAgentUs / 1e6, ( ulImageSize / 1024.0 ) / ( xSim.ullAgentUs / 1e6 ),
+                xSim.ulCalls, xSim.ulErases, xSim.ulReadModifyWrites,
+                xWriteBehind.ulFullPages, xWriteBehind.ulPartialPages, xWriteBehind.ulWaits );
+    }
+
+    free( xSim.pucFlash );
+
+    return ( lResult < 0 ) ? 1 : 0;
+}
+
+int main( int argc,
+          char ** argv )
+{
+    static const uint32_t ulCases[][ 2 ] =
+    {
+        { 1U, SECTOR_SIZE     },
+        { 2U, SECTOR_SIZE     },
+        { 4U, SECTOR_SIZE     },
+        { 8U, SECTOR_SIZE     },
+        { 2U, 2U * SECTOR_SIZE },
+        { 4U, 2U * SECTOR_SIZE }
+    };
+    uint32_t ulImageSize = DEFAULT_IMAGE_KB * 1024U;
+    uint32_t ulLossPercent = DEFAULT_LOSS_PERCENT;
+    uint32_t ulLoss, ulCase, ulIndex;
+    uint8_t * pucImage;
+    uint32_t * pulOrder;
+    int lFailed = 0;
+
+    if( argc > 1 )
+    {
+        ulImageSize = ( uint32_t ) strtoul( argv[ 1 ], NULL, 0 ) * 1024U;
+    }
+
+    if( argc > 2 )
+    {
+        ulLossPercent = ( uint32_t ) strtoul( argv[ 2 ], NULL, 0 );
+    }
+
+    if( argc > 3 )
+    {
+        ulBlockUs = ( uint32_t ) strtoul( argv[ 3 ], NULL, 0 ) * 1000U;
+    }
+
+    if( ( ulImageSize == 0U ) || ( ulLossPercent >= 100U ) )
+    {
+        fprintf( stderr, "Usage: %s [image size in KB] [loss in percent, below 100] [ms per block]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    /* Make the last block short so that the last page is complete without being full. */
+    ulImageSize -= FILE_BLOCK_SIZE / 2U;
+    pucImage = malloc( ulImageSize );
+
+    if( pucImage == NULL )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        return 1;
+    }
+
+    for( ulIndex = 0U; ulIndex < ulImageSize; ulIndex++ )
+    {
+        pucImage[ ulIndex ] = ( uint8_t ) prvRandom();
+    }
+
+    printf( "%u byte image in %u byte blocks, one every %u ms. Flash sectors of %u bytes take\n"
+            "%u ms to erase and %.1f ms to program, and %.1f ms to read for a read-modify-write.\n",
+            ulImageSize, FILE_BLOCK_SIZE, ulBlockUs / 1000U, SECTOR_SIZE,
+            SECTOR_ERASE_US / 1000U, SECTOR_PROGRAM_US / 1000.0, SECTOR_READ_US / 1000.0 );
+
+    for( ulLoss = 0U; ulLoss <= ulLossPercent; ulLoss += ( ulLossPercent > 0U ) ? ulLossPercent : 1U )
+    {
+        ulRandom = 0x2545F491UL;
+        pulOrder = prvArrivalOrder( ( ulImageSize + FILE_BLOCK_SIZE - 1U ) / FILE_BLOCK_SIZE, ulLoss );
+
+        printf( "\n%u%% of the blocks lost and received again later:\n\n", ulLoss );
+        printf( "pages         seconds    KB/s   writes  erases     RMW     full  partial   waits\n" );
+
+        lFailed |= prvRun( pucImage, ulImageSize, pulOrder, 0U, 0U );
+
+        for( ulCase = 0U; ulCase < ( sizeof( ulCases ) / sizeof( ulCases[ 0 ] ) ); ulCase++ )
+        {
+            lFailed |= prvRun( pucImage, ulImageSize, pulOrder, ulCases[ ulCase ][ 0 ], ulCases[ ulCase ][ 1 ] );
+        }
+
+        free( pulOrder );
+    }
+
+    free( pucImage );
+
+    return lFailed;
+}